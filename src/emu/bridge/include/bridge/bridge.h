@@ -58,5 +58,25 @@ namespace eka2l1 {
                 call(export_fn, layouts, indices(), cpu, pr, data);
             };
         }
+
+        template <typename F>
+        struct static_bridge;
+
+        template <typename T, typename ret, typename... args>
+        struct static_bridge<ret (*)(T *, args...)> {
+            template <ret (*export_fn)(T *, args...)>
+            static void entry(T *data, kernel::process *pr, arm::core *cpu) {
+                constexpr args_layout<args...> layouts = lay_out<typename bridge_type<args>::arm_type...>();
+                call(export_fn, layouts, std::index_sequence_for<args...>(), cpu, pr, data);
+            }
+        };
+
+        /*! \brief Bridge a HLE function to guest, as a plain function.
+         *
+         * Same as bridge, but the function is known at compile time, so the result can be called
+         * without going through a std::function.
+        */
+        template <auto export_fn>
+        constexpr auto bridge_direct = &static_bridge<decltype(export_fn)>::template entry<export_fn>;
     }
 }
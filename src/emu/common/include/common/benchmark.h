@@ -17,8 +17,15 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#pragma once
+
 #include <chrono>
 #include <common/log.h>
+#include <fmt/format.h>
+
+#include <string>
+#include <utility>
+#include <vector>
 
 namespace eka2l1::common {
     struct benchmarker {
@@ -35,4 +42,42 @@ namespace eka2l1::common {
             LOG_TRACE(COMMON, "Function {} runned in {} ms ({} s)", bench_func, std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count(), std::chrono::duration_cast<std::chrono::seconds>(end - start).count());
         }
     };
+
+    /**
+     * @brief Time consecutive stages of a long operation, such as booting the system.
+     */
+    struct stage_benchmarker {
+        std::chrono::time_point<std::chrono::steady_clock> start;
+        std::chrono::time_point<std::chrono::steady_clock> stage_start;
+        std::vector<std::pair<const char *, double>> stages;
+
+        explicit stage_benchmarker() {
+            start = std::chrono::steady_clock::now();
+            stage_start = start;
+        }
+
+        /**
+         * @brief Record the time spent since the previous stage ended, under the given name.
+         */
+        void end_stage(const char *stage_name) {
+            const auto now = std::chrono::steady_clock::now();
+            stages.emplace_back(stage_name, std::chrono::duration<double, std::milli>(now - stage_start).count());
+
+            stage_start = now;
+        }
+
+        /**
+         * @brief Format all recorded stages and the total, in milliseconds, on one line.
+         */
+        std::string summary() const {
+            std::string result;
+
+            for (const auto &[stage_name, stage_ms] : stages) {
+                result += fmt::format("{} {:.1f} ms, ", stage_name, stage_ms);
+            }
+
+            result += fmt::format("total {:.1f} ms", std::chrono::duration<double, std::milli>(stage_start - start).count());
+            return result;
+        }
+    };
 }
@@ -103,5 +103,54 @@ namespace eka2l1 {
             /*! \brief Get all the pages's offsets */
             std::vector<uint32_t> page_offsets(uint32_t initial_off);
         };
+
+        /*! \brief Bytepair compressed data kept in memory, decompressed one page at a time.
+         *
+         *  The store is not modified after load, so pages can be decompressed from several threads.
+         */
+        class bytepair_page_store {
+            std::vector<uint8_t> compressed_;
+            std::vector<uint32_t> page_offsets_;
+
+            uint32_t decompressed_size_ = 0;
+            uint32_t consumed_size_ = 0;
+
+        public:
+            /*! \brief Copy the index table and the pages of a bytepair stream.
+             *
+             *  \param data The compressed stream, starting with the index table.
+             *  \param size Number of bytes available in the buffer.
+             *
+             *  \returns False if the table or the pages do not fit in the buffer.
+             */
+            bool load(const uint8_t *data, size_t size);
+
+            /*! \brief Decompress a page.
+             *
+             *  \param dest Destination, must have space for BYTEPAIR_PAGE_SIZE bytes.
+             *  \param page The page index.
+             *
+             *  \returns Number of bytes decompressed.
+             */
+            uint32_t read_page(uint8_t *dest, uint32_t page) const;
+
+            uint32_t page_count() const {
+                return page_offsets_.empty() ? 0 : static_cast<uint32_t>(page_offsets_.size() - 1);
+            }
+
+            uint32_t decompressed_size() const {
+                return decompressed_size_;
+            }
+
+            /*! \brief Size of the compressed pages held in memory. */
+            size_t compressed_size() const {
+                return compressed_.size();
+            }
+
+            /*! \brief Number of bytes the stream took in the source buffer, including the index table. */
+            uint32_t consumed_size() const {
+                return consumed_size_;
+            }
+        };
     }
 }
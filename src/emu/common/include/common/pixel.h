@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2022 EKA2L1 Team.
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <common/rgb.h>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace eka2l1::common {
+    /**
+     * @brief Memory layout of a row of pixels.
+     *
+     * Names follow the Symbian display modes. Pixels smaller than a byte are packed from the least
+     * significant bit, multi-byte pixels are little-endian.
+     */
+    enum class pixel_format : std::uint8_t {
+        gray2, ///< 1 bpp, black or white.
+        gray4, ///< 2 bpp grayscale.
+        gray16, ///< 4 bpp grayscale.
+        gray256, ///< 8 bpp grayscale.
+        color16, ///< 4 bpp index into a 16 colours palette.
+        color256, ///< 8 bpp index into a 256 colours palette.
+        color4k, ///< 16 bpp, 0x0RGB.
+        color64k, ///< 16 bpp, RGB565.
+        color16m, ///< 24 bpp, bytes B G R.
+        color16mu, ///< 32 bpp, bytes B G R X. The top byte is ignored.
+        color16ma, ///< 32 bpp, bytes B G R A.
+        color16map, ///< 32 bpp, bytes B G R A, colour premultiplied by alpha.
+        rgba8888, ///< 32 bpp, bytes R G B A. The format textures are uploaded in.
+        total
+    };
+
+    /**
+     * @brief Instruction sets the conversion kernels are written for.
+     */
+    enum class pixel_kernel_set : std::uint8_t {
+        automatic, ///< The best set the host supports.
+        scalar,
+        sse2,
+        avx2,
+        neon
+    };
+
+    struct pixel_convert_params {
+        /**
+         * Palette of the source, for color16 and color256. Entries are 0x00BBGGRR, the top byte
+         * is ignored. Without a palette, indexes are treated as gray levels.
+         */
+        const rgba *source_palette_ = nullptr;
+
+        /**
+         * Palette of the destination, for color16 and color256. Each pixel is matched to the
+         * nearest entry.
+         */
+        const rgba *dest_palette_ = nullptr;
+
+        pixel_kernel_set kernels_ = pixel_kernel_set::automatic;
+    };
+
+    std::uint32_t get_pixel_format_bpp(const pixel_format format);
+
+    /**
+     * @brief Get the number of bytes a row of pixels takes, without any alignment.
+     */
+    std::size_t get_pixel_row_size(const pixel_format format, const std::size_t width);
+
+    bool is_pixel_kernel_set_supported(const pixel_kernel_set set);
+
+    /**
+     * @brief Get the kernel set used when conversions ask for the automatic one.
+     */
+    pixel_kernel_set get_best_pixel_kernel_set();
+
+    /**
+     * @brief Convert a row of pixels to another format.
+     *
+     * Conversions that neither start nor end in rgba8888 go through it. Alpha of formats without
+     * one is read as 255.
+     *
+     * @param dest_format   Format to convert to.
+     * @param dest          Destination row.
+     * @param source_format Format to convert from.
+     * @param source        Source row.
+     * @param count         Number of pixels in the row.
+     * @param params        Palettes and kernel set to use.
+     */
+    void convert_pixel_row(const pixel_format dest_format, void *dest, const pixel_format source_format, const void *source,
+        const std::size_t count, const pixel_convert_params &params = {});
+
+    /**
+     * @brief Convert a rectangle of pixels to another format.
+     *
+     * @param dest_stride   Number of bytes between the start of two destination rows.
+     * @param source_stride Number of bytes between the start of two source rows.
+     */
+    void convert_pixels(const pixel_format dest_format, void *dest, const std::size_t dest_stride, const pixel_format source_format,
+        const void *source, const std::size_t source_stride, const std::size_t width, const std::size_t height,
+        const pixel_convert_params &params = {});
+}
@@ -154,7 +154,8 @@ enum class arm_emulator_type {
     unicorn = 0,
     dynarmic = 1,
     r12l1 = 2,
-    dyncom = 3
+    dyncom = 3,
+    tiered = 4
 };
 
 typedef std::uint32_t vaddress;
@@ -31,6 +31,46 @@ namespace eka2l1::common {
     */
     void *map_memory(const std::size_t size);
 
+    /**
+     * \brief Map memory with defined size, whose pages can also be shown at other places.
+     *
+     * The region is committed, decommitted and unmapped the same way as one from map_memory.
+     *
+     * \returns A valid pointer on success. Nullptr is fail.
+     *
+     * \see mirror_memory
+    */
+    void *map_mirrorable_memory(const std::size_t size);
+
+    /**
+     * \brief Make a region show the same pages as another region.
+     *
+     * Writes through one region are seen through the other. The protection of the mirror
+     * is independent from the source.
+     *
+     * \param target Page-aligned pointer inside a region reserved by map_memory.
+     * \param source Page-aligned pointer inside a region mapped by map_mirrorable_memory.
+     * \param size   Size to mirror.
+     * \param perm   Protection of the mirrored pages.
+     *
+     * \returns True on success, false on failure.
+    */
+    bool mirror_memory(void *target, void *source, const std::size_t size, const prot perm);
+
+    /**
+     * \brief Drop mirrored pages, leaving the region reserved with no access.
+     *
+     * \returns True on success, false on failure.
+    */
+    bool unmirror_memory(void *target, const std::size_t size);
+
+    /**
+     * \brief Returns true if the platform can mirror memory.
+     *
+     * POSIX hosts back mirrorable memory with a shared memory object. Windows is not supported.
+    */
+    bool is_memory_mirroring_supported();
+
     /**
      * \brief Unmap an pointer which points to a mapped region
      *
@@ -98,5 +98,12 @@ namespace eka2l1::common {
          * \returns  True on success.
          */
         bool unwatch(const std::int32_t watch_handle);
+
+        /**
+         * \brief   Check if watches on this platform actually report changes.
+         *
+         * Some platforms only have a stub implementation, which accepts watches but never calls back.
+         */
+        bool can_notify() const;
     };
 }
\ No newline at end of file
@@ -24,6 +24,7 @@
 #include <common/log.h>
 
 #include <cstdint>
+#include <cstring>
 #include <functional>
 #include <stack>
 
@@ -108,6 +109,10 @@ namespace eka2l1 {
                 goto not_single;
 
         process_replace:
+            if (dest >= dest_end) {
+                goto done_dest;
+            }
+
             if (data8 >= buf_end) {
                 goto done_data8;
             }
@@ -147,6 +152,11 @@ namespace eka2l1 {
             b = sec_stack.top();
             sec_stack.pop();
 
+            // Pages may be decompressed straight into guest memory, never expand past the destination
+            if (dest >= dest_end) {
+                goto done_dest;
+            }
+
             *dest++ = p1;
             p1 = lookup_table_first[b];
 
@@ -242,5 +252,67 @@ namespace eka2l1 {
 
             return res;
         }
+
+        bool bytepair_page_store::load(const uint8_t *data, size_t size) {
+            static constexpr size_t TABLE_HEADER_SIZE = 10;
+
+            if (size < TABLE_HEADER_SIZE) {
+                return false;
+            }
+
+            ibytepair_stream::index_table_header header;
+            std::memcpy(&header.size_of_data, data, 4);
+            std::memcpy(&header.decompressed_size, data + 4, 4);
+            std::memcpy(&header.number_of_pages, data + 8, 2);
+
+            const size_t table_size = TABLE_HEADER_SIZE + header.number_of_pages * sizeof(uint16_t);
+            if (size < table_size) {
+                return false;
+            }
+
+            page_offsets_.resize(header.number_of_pages + 1);
+
+            uint32_t offset = 0;
+
+            for (uint16_t i = 0; i < header.number_of_pages; i++) {
+                uint16_t page_size = 0;
+                std::memcpy(&page_size, data + TABLE_HEADER_SIZE + i * sizeof(uint16_t), sizeof(uint16_t));
+
+                page_offsets_[i] = offset;
+                offset += page_size;
+            }
+
+            page_offsets_.back() = offset;
+
+            if (size - table_size < offset) {
+                page_offsets_.clear();
+                return false;
+            }
+
+            compressed_.assign(data + table_size, data + table_size + offset);
+
+            decompressed_size_ = static_cast<uint32_t>(header.decompressed_size);
+            consumed_size_ = static_cast<uint32_t>(table_size + offset);
+
+            return true;
+        }
+
+        uint32_t bytepair_page_store::read_page(uint8_t *dest, uint32_t page) const {
+            if (page >= page_count()) {
+                return 0;
+            }
+
+            const uint32_t page_start = page * BYTEPAIR_PAGE_SIZE;
+            const uint32_t dest_size = (decompressed_size_ > page_start) ? common::min<uint32_t>(decompressed_size_ - page_start, BYTEPAIR_PAGE_SIZE) : 0;
+
+            const uint32_t compressed_page_size = page_offsets_[page + 1] - page_offsets_[page];
+            if (!dest_size || !compressed_page_size) {
+                return 0;
+            }
+
+            // The decompressor does not write to the source
+            uint8_t *source = const_cast<uint8_t *>(compressed_.data() + page_offsets_[page]);
+            return static_cast<uint32_t>(bytepair_decompress(dest, dest_size, source, compressed_page_size));
+        }
     }
 }
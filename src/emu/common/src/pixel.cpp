@@ -0,0 +1,1252 @@
+/*
+ * Copyright (c) 2022 EKA2L1 Team.
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <common/cpudetect.h>
+#include <common/pixel.h>
+#include <common/platform.h>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <limits>
+
+#if EKA2L1_ARCH(X86) || EKA2L1_ARCH(X64)
+#include <immintrin.h>
+#define PIXEL_X86_KERNELS 1
+#elif EKA2L1_ARCH(ARM64) || (EKA2L1_ARCH(ARM) && defined(__ARM_NEON))
+#include <arm_neon.h>
+#define PIXEL_NEON_KERNELS 1
+#endif
+
+// Kernels for instruction sets above the build baseline are compiled per function
+#if defined(__GNUC__) || defined(__clang__)
+#define PIXEL_TARGET(isa) __attribute__((target(isa)))
+#else
+#define PIXEL_TARGET(isa)
+#endif
+
+namespace eka2l1::common {
+    namespace {
+        // Converts a row to or from rgba8888. The palette is only read by the palette formats.
+        using pixel_row_func = void (*)(std::uint8_t *dest, const std::uint8_t *source, const std::size_t count, const rgba *palette);
+
+        static constexpr std::size_t FORMAT_COUNT = static_cast<std::size_t>(pixel_format::total);
+
+        // Number of pixels converted to rgba8888 at once, when neither side is rgba8888. A multiple of 8
+        // so that every chunk starts on a byte boundary.
+        static constexpr std::size_t INTERMEDIATE_CHUNK_PIXELS = 256;
+
+        static constexpr std::uint32_t OPAQUE_ALPHA = 0xFF000000;
+
+        struct pixel_kernels {
+            std::array<pixel_row_func, FORMAT_COUNT> unpack_;
+            std::array<pixel_row_func, FORMAT_COUNT> pack_;
+
+            void set_unpack(const pixel_format format, pixel_row_func func) {
+                unpack_[static_cast<std::size_t>(format)] = func;
+            }
+
+            void set_pack(const pixel_format format, pixel_row_func func) {
+                pack_[static_cast<std::size_t>(format)] = func;
+            }
+        };
+
+        constexpr std::array<std::uint16_t, 256> make_unpremultiply_table() {
+            std::array<std::uint16_t, 256> table{};
+
+            for (std::uint32_t alpha = 1; alpha < 256; alpha++) {
+                table[alpha] = static_cast<std::uint16_t>((255 * 256 + alpha / 2) / alpha);
+            }
+
+            return table;
+        }
+
+        // 8.8 fixed point of 255 / alpha. Zero alpha maps to zero, which clears the colour.
+        static constexpr std::array<std::uint16_t, 256> UNPREMULTIPLY_RECIPROCALS = make_unpremultiply_table();
+
+        inline std::uint16_t load_u16(const std::uint8_t *ptr) {
+            std::uint16_t value = 0;
+            std::memcpy(&value, ptr, sizeof(value));
+            return value;
+        }
+
+        inline std::uint32_t load_u32(const std::uint8_t *ptr) {
+            std::uint32_t value = 0;
+            std::memcpy(&value, ptr, sizeof(value));
+            return value;
+        }
+
+        inline void store_u16(std::uint8_t *ptr, const std::uint16_t value) {
+            std::memcpy(ptr, &value, sizeof(value));
+        }
+
+        inline void store_u32(std::uint8_t *ptr, const std::uint32_t value) {
+            std::memcpy(ptr, &value, sizeof(value));
+        }
+
+        inline std::uint32_t make_rgba(const std::uint32_t r, const std::uint32_t g, const std::uint32_t b, const std::uint32_t a) {
+            return r | (g << 8) | (b << 16) | (a << 24);
+        }
+
+        inline std::uint32_t gray_to_rgba(const std::uint32_t level) {
+            return (level * 0x010101) | OPAQUE_ALPHA;
+        }
+
+        inline std::uint32_t rgba_to_luma(const std::uint8_t *pixel) {
+            return (pixel[0] * 77 + pixel[1] * 150 + pixel[2] * 29 + 128) >> 8;
+        }
+
+        // Rounded c * a / 255, exact for all 8-bit inputs
+        inline std::uint32_t premultiply(const std::uint32_t comp, const std::uint32_t alpha) {
+            const std::uint32_t t = comp * alpha + 128;
+            return (t + (t >> 8)) >> 8;
+        }
+
+        inline std::uint32_t unpremultiply(const std::uint32_t comp, const std::uint32_t alpha) {
+            return std::min<std::uint32_t>(255, (comp * UNPREMULTIPLY_RECIPROCALS[alpha] + 128) >> 8);
+        }
+
+        std::uint8_t find_nearest_palette_index(const rgba *palette, const std::size_t palette_size, const std::uint8_t *pixel) {
+            std::uint8_t best_index = 0;
+            std::int32_t best_distance = std::numeric_limits<std::int32_t>::max();
+
+            for (std::size_t i = 0; i < palette_size; i++) {
+                const std::int32_t dr = static_cast<std::int32_t>(palette[i] & 0xFF) - pixel[0];
+                const std::int32_t dg = static_cast<std::int32_t>((palette[i] >> 8) & 0xFF) - pixel[1];
+                const std::int32_t db = static_cast<std::int32_t>((palette[i] >> 16) & 0xFF) - pixel[2];
+                const std::int32_t distance = dr * dr + dg * dg + db * db;
+
+                if (distance < best_distance) {
+                    best_distance = distance;
+                    best_index = static_cast<std::uint8_t>(i);
+
+                    if (!distance) {
+                        break;
+                    }
+                }
+            }
+
+            return best_index;
+        }
+
+        // ======================= SCALAR =======================
+
+        template <std::uint32_t BITS, typename F>
+        void unpack_sub_byte(std::uint8_t *dest, const std::uint8_t *source, const std::size_t count, F expand) {
+            static constexpr std::uint32_t PIXELS_PER_BYTE = 8 / BITS;
+            static constexpr std::uint32_t MASK = (1 << BITS) - 1;
+
+            for (std::size_t i = 0; i < count; i++) {
+                const std::uint32_t value = (source[i / PIXELS_PER_BYTE] >> ((i % PIXELS_PER_BYTE) * BITS)) & MASK;
+                store_u32(dest + i * 4, expand(value));
+            }
+        }
+
+        template <std::uint32_t BITS, typename F>
+        void pack_sub_byte(std::uint8_t *dest, const std::uint8_t *source, const std::size_t count, F reduce) {
+            static constexpr std::uint32_t PIXELS_PER_BYTE = 8 / BITS;
+
+            for (std::size_t i = 0; i < count; i += PIXELS_PER_BYTE) {
+                std::uint8_t packed = 0;
+
+                for (std::uint32_t j = 0; (j < PIXELS_PER_BYTE) && (i + j < count); j++) {
+                    packed |= static_cast<std::uint8_t>(reduce(source + (i + j) * 4) << (j * BITS));
+                }
+
+                dest[i / PIXELS_PER_BYTE] = packed;
+            }
+        }
+
+        void unpack_gray2_scalar(std::uint8_t *dest, const std::uint8_t *source, const std::size_t count, const rgba *palette) {
+            unpack_sub_byte<1>(dest, source, count, [](const std::uint32_t value) {
+                return value ? 0xFFFFFFFF : OPAQUE_ALPHA;
+            });
+        }
+
+        void unpack_gray4_scalar(std::uint8_t *dest, const std::uint8_t *source, const std::size_t count, const rgba *palette) {
+            unpack_sub_byte<2>(dest, source, count, [](const std::uint32_t value) {
+                return gray_to_rgba(value * 85);
+            });
+        }
+
+        void unpack_gray16_scalar(std::uint8_t *dest, const std::uint8_t *source, const std::size_t count, const rgba *palette) {
+            unpack_sub_byte<4>(dest, source, count, [](const std::uint32_t value) {
+                return gray_to_rgba(value * 17);
+            });
+        }
+
+        void unpack_gray256_scalar(std::uint8_t *dest, const std::uint8_t *source, const std::size_t count, const rgba *palette) {
+            for (std::size_t i = 0; i < count; i++) {
+                store_u32(dest + i * 4, gray_to_rgba(source[i]));
+            }
+        }
+
+        void unpack_color16_scalar(std::uint8_t *dest, const std::uint8_t *source, const std::size_t count, const rgba *palette) {
+            unpack_sub_byte<4>(dest, source, count, [palette](const std::uint32_t value) {
+                return palette ? (palette[value] | OPAQUE_ALPHA) : gray_to_rgba(value * 17);
+            });
+        }
+
+        void unpack_color256_scalar(std::uint8_t *dest, const std::uint8_t *source, const std::size_t count, const rgba *palette) {
+            if (!palette) {
+                unpack_gray256_scalar(dest, source, count, palette);
+                return;
+            }
+
+            for (std::size_t i = 0; i < count; i++) {
+                store_u32(dest + i * 4, palette[source[i]] | OPAQUE_ALPHA);
+            }
+        }
+
+        void unpack_color4k_scalar(std::uint8_t *dest, const std::uint8_t *source, const std::size_t count, const rgba *palette) {
+            for (std::size_t i = 0; i < count; i++) {
+                const std::uint32_t pixel = load_u16(source + i * 2);
+                store_u32(dest + i * 4, make_rgba(((pixel >> 8) & 0xF) * 17, ((pixel >> 4) & 0xF) * 17, (pixel & 0xF) * 17, 255));
+            }
+        }
+
+        void unpack_color64k_scalar(std::uint8_t *dest, const std::uint8_t *source, const std::size_t count, const rgba *palette) {
+            for (std::size_t i = 0; i < count; i++) {
+                const std::uint32_t pixel = load_u16(source + i * 2);
+                const std::uint32_t r = pixel >> 11;
+                const std::uint32_t g = (pixel >> 5) & 0x3F;
+                const std::uint32_t b = pixel & 0x1F;
+
+                store_u32(dest + i * 4, make_rgba((r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2), 255));
+            }
+        }
+
+        void unpack_color16m_scalar(std::uint8_t *dest, const std::uint8_t *source, const std::size_t count, const rgba *palette) {
+            for (std::size_t i = 0; i < count; i++) {
+                const std::uint8_t *pixel = source + i * 3;
+                store_u32(dest + i * 4, make_rgba(pixel[2], pixel[1], pixel[0], 255));
+            }
+        }
+
+        void unpack_color16mu_scalar(std::uint8_t *dest, const std::uint8_t *source, const std::size_t count, const rgba *palette) {
+            for (std::size_t i = 0; i < count; i++) {
+                const std::uint8_t *pixel = source + i * 4;
+                store_u32(dest + i * 4, make_rgba(pixel[2], pixel[1], pixel[0], 255));
+            }
+        }
+
+        void unpack_color16ma_scalar(std::uint8_t *dest, const std::uint8_t *source, const std::size_t count, const rgba *palette) {
+            for (std::size_t i = 0; i < count; i++) {
+                const std::uint8_t *pixel = source + i * 4;
+                store_u32(dest + i * 4, make_rgba(pixel[2], pixel[1], pixel[0], pixel[3]));
+            }
+        }
+
+        void unpack_color16map_scalar(std::uint8_t *dest, const std::uint8_t *source, const std::size_t count, const rgba *palette) {
+            for (std::size_t i = 0; i < count; i++) {
+                const std::uint8_t *pixel = source + i * 4;
+                const std::uint32_t alpha = pixel[3];
+
+                store_u32(dest + i * 4, make_rgba(unpremultiply(pixel[2], alpha), unpremultiply(pixel[1], alpha),
+                                            unpremultiply(pixel[0], alpha), alpha));
+            }
+        }
+
+        void copy_rgba8888(std::uint8_t *dest, const std::uint8_t *source, const std::size_t count, const rgba *palette) {
+            std::memcpy(dest, source, count * 4);
+        }
+
+        void pack_gray2_scalar(std::uint8_t *dest, const std::uint8_t *source, const std::size_t count, const rgba *palette) {
+            pack_sub_byte<1>(dest, source, count, [](const std::uint8_t *pixel) {
+                return (rgba_to_luma(pixel) >= 128) ? 1 : 0;
+            });
+        }
+
+        void pack_gray4_scalar(std::uint8_t *dest, const std::uint8_t *source, const std::size_t count, const rgba *palette) {
+            pack_sub_byte<2>(dest, source, count, [](const std::uint8_t *pixel) {
+                return (rgba_to_luma(pixel) + 42) / 85;
+            });
+        }
+
+        void pack_gray16_scalar(std::uint8_t *dest, const std::uint8_t *source, const std::size_t count, const rgba *palette) {
+            pack_sub_byte<4>(dest, source, count, [](const std::uint8_t *pixel) {
+                return (rgba_to_luma(pixel) + 8) / 17;
+            });
+        }
+
+        void pack_gray256_scalar(std::uint8_t *dest, const std::uint8_t *source, const std::size_t count, const rgba *palette) {
+            for (std::size_t i = 0; i < count; i++) {
+                dest[i] = static_cast<std::uint8_t>(rgba_to_luma(source + i * 4));
+            }
+        }
+
+        void pack_color16_scalar(std::uint8_t *dest, const std::uint8_t *source, const std::size_t count, const rgba *palette) {
+            pack_sub_byte<4>(dest, source, count, [palette](const std::uint8_t *pixel) -> std::uint32_t {
+                return palette ? find_nearest_palette_index(palette, 16, pixel) : (rgba_to_luma(pixel) + 8) / 17;
+            });
+        }
+
+        void pack_color256_scalar(std::uint8_t *dest, const std::uint8_t *source, const std::size_t count, const rgba *palette) {
+            if (!palette) {
+                pack_gray256_scalar(dest, source, count, palette);
+                return;
+            }
+
+            // Runs of the same colour are common, skip the search for them
+            std::uint32_t last_color = 0;
+            std::uint8_t last_index = 0;
+            bool has_last = false;
+
+            for (std::size_t i = 0; i < count; i++) {
+                const std::uint32_t color = load_u32(source + i * 4) & 0xFFFFFF;
+
+                if (!has_last || (color != last_color)) {
+                    last_color = color;
+                    last_index = find_nearest_palette_index(palette, 256, source + i * 4);
+                    has_last = true;
+                }
+
+                dest[i] = last_index;
+            }
+        }
+
+        void pack_color4k_scalar(std::uint8_t *dest, const std::uint8_t *source, const std::size_t count, const rgba *palette) {
+            for (std::size_t i = 0; i < count; i++) {
+                const std::uint8_t *pixel = source + i * 4;
+                store_u16(dest + i * 2, static_cast<std::uint16_t>(((pixel[0] >> 4) << 8) | ((pixel[1] >> 4) << 4) | (pixel[2] >> 4)));
+            }
+        }
+
+        void pack_color64k_scalar(std::uint8_t *dest, const std::uint8_t *source, const std::size_t count, const rgba *palette) {
+            for (std::size_t i = 0; i < count; i++) {
+                const std::uint8_t *pixel = source + i * 4;
+                store_u16(dest + i * 2, static_cast<std::uint16_t>(((pixel[0] >> 3) << 11) | ((pixel[1] >> 2) << 5) | (pixel[2] >> 3)));
+            }
+        }
+
+        void pack_color16m_scalar(std::uint8_t *dest, const std::uint8_t *source, const std::size_t count, const rgba *palette) {
+            for (std::size_t i = 0; i < count; i++) {
+                dest[i * 3] = source[i * 4 + 2];
+                dest[i * 3 + 1] = source[i * 4 + 1];
+                dest[i * 3 + 2] = source[i * 4];
+            }
+        }
+
+        void pack_color16mu_scalar(std::uint8_t *dest, const std::uint8_t *source, const std::size_t count, const rgba *palette) {
+            for (std::size_t i = 0; i < count; i++) {
+                const std::uint8_t *pixel = source + i * 4;
+                store_u32(dest + i * 4, make_rgba(pixel[2], pixel[1], pixel[0], 255));
+            }
+        }
+
+        void pack_color16ma_scalar(std::uint8_t *dest, const std::uint8_t *source, const std::size_t count, const rgba *palette) {
+            // Swapping red and blue goes both ways
+            unpack_color16ma_scalar(dest, source, count, palette);
+        }
+
+        void pack_color16map_scalar(std::uint8_t *dest, const std::uint8_t *source, const std::size_t count, const rgba *palette) {
+            for (std::size_t i = 0; i < count; i++) {
+                const std::uint8_t *pixel = source + i * 4;
+                const std::uint32_t alpha = pixel[3];
+
+                store_u32(dest + i * 4, make_rgba(premultiply(pixel[2], alpha), premultiply(pixel[1], alpha),
+                                            premultiply(pixel[0], alpha), alpha));
+            }
+        }
+
+        pixel_kernels make_scalar_kernels() {
+            pixel_kernels kernels;
+
+            kernels.set_unpack(pixel_format::gray2, unpack_gray2_scalar);
+            kernels.set_unpack(pixel_format::gray4, unpack_gray4_scalar);
+            kernels.set_unpack(pixel_format::gray16, unpack_gray16_scalar);
+            kernels.set_unpack(pixel_format::gray256, unpack_gray256_scalar);
+            kernels.set_unpack(pixel_format::color16, unpack_color16_scalar);
+            kernels.set_unpack(pixel_format::color256, unpack_color256_scalar);
+            kernels.set_unpack(pixel_format::color4k, unpack_color4k_scalar);
+            kernels.set_unpack(pixel_format::color64k, unpack_color64k_scalar);
+            kernels.set_unpack(pixel_format::color16m, unpack_color16m_scalar);
+            kernels.set_unpack(pixel_format::color16mu, unpack_color16mu_scalar);
+            kernels.set_unpack(pixel_format::color16ma, unpack_color16ma_scalar);
+            kernels.set_unpack(pixel_format::color16map, unpack_color16map_scalar);
+            kernels.set_unpack(pixel_format::rgba8888, copy_rgba8888);
+
+            kernels.set_pack(pixel_format::gray2, pack_gray2_scalar);
+            kernels.set_pack(pixel_format::gray4, pack_gray4_scalar);
+            kernels.set_pack(pixel_format::gray16, pack_gray16_scalar);
+            kernels.set_pack(pixel_format::gray256, pack_gray256_scalar);
+            kernels.set_pack(pixel_format::color16, pack_color16_scalar);
+            kernels.set_pack(pixel_format::color256, pack_color256_scalar);
+            kernels.set_pack(pixel_format::color4k, pack_color4k_scalar);
+            kernels.set_pack(pixel_format::color64k, pack_color64k_scalar);
+            kernels.set_pack(pixel_format::color16m, pack_color16m_scalar);
+            kernels.set_pack(pixel_format::color16mu, pack_color16mu_scalar);
+            kernels.set_pack(pixel_format::color16ma, pack_color16ma_scalar);
+            kernels.set_pack(pixel_format::color16map, pack_color16map_scalar);
+            kernels.set_pack(pixel_format::rgba8888, copy_rgba8888);
+
+            return kernels;
+        }
+
+#if PIXEL_X86_KERNELS
+        // ======================= SSE2 =======================
+
+        PIXEL_TARGET("sse2")
+        inline void store_gray_sse2(std::uint8_t *dest, const __m128i levels) {
+            const __m128i alpha = _mm_set1_epi32(static_cast<int>(OPAQUE_ALPHA));
+            const __m128i doubled_lo = _mm_unpacklo_epi8(levels, levels);
+            const __m128i doubled_hi = _mm_unpackhi_epi8(levels, levels);
+
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dest), _mm_or_si128(_mm_unpacklo_epi16(doubled_lo, doubled_lo), alpha));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + 16), _mm_or_si128(_mm_unpackhi_epi16(doubled_lo, doubled_lo), alpha));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + 32), _mm_or_si128(_mm_unpacklo_epi16(doubled_hi, doubled_hi), alpha));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + 48), _mm_or_si128(_mm_unpackhi_epi16(doubled_hi, doubled_hi), alpha));
+        }
+
+        PIXEL_TARGET("sse2")
+        inline __m128i swap_red_blue_sse2(const __m128i pixels) {
+            const __m128i alpha_green = _mm_and_si128(pixels, _mm_set1_epi32(static_cast<int>(0xFF00FF00)));
+            const __m128i red_blue = _mm_and_si128(pixels, _mm_set1_epi32(0x00FF00FF));
+
+            return _mm_or_si128(alpha_green, _mm_or_si128(_mm_slli_epi32(red_blue, 16), _mm_srli_epi32(red_blue, 16)));
+        }
+
+        // Keep the alpha byte of the original pixels
+        PIXEL_TARGET("sse2")
+        inline __m128i restore_alpha_sse2(const __m128i pixels, const __m128i original) {
+            const __m128i alpha_mask = _mm_set1_epi32(static_cast<int>(OPAQUE_ALPHA));
+            return _mm_or_si128(_mm_andnot_si128(alpha_mask, pixels), _mm_and_si128(alpha_mask, original));
+        }
+
+        PIXEL_TARGET("sse2")
+        void unpack_gray2_sse2(std::uint8_t *dest, const std::uint8_t *source, const std::size_t count, const rgba *palette) {
+            const __m128i bits = _mm_set_epi8(-128, 64, 32, 16, 8, 4, 2, 1, -128, 64, 32, 16, 8, 4, 2, 1);
+            std::size_t i = 0;
+
+            for (; i + 16 <= count; i += 16) {
+                __m128i packed = _mm_cvtsi32_si128(load_u16(source + i / 8));
+
+                // Spread byte 0 over lanes 0-7, byte 1 over lanes 8-15
+                packed = _mm_unpacklo_epi8(packed, packed);
+                packed = _mm_unpacklo_epi16(packed, packed);
+                packed = _mm_unpacklo_epi32(packed, packed);
+
+                store_gray_sse2(dest + i * 4, _mm_cmpeq_epi8(_mm_and_si128(packed, bits), bits));
+            }
+
+            unpack_gray2_scalar(dest + i * 4, source + i / 8, count - i, palette);
+        }
+
+        PIXEL_TARGET("sse2")
+        void unpack_gray4_sse2(std::uint8_t *dest, const std::uint8_t *source, const std::size_t count, const rgba *palette) {
+            const __m128i mask = _mm_set1_epi8(3);
+            std::size_t i = 0;
+
+            for (; i + 16 <= count; i += 16) {
+                const __m128i packed = _mm_cvtsi32_si128(static_cast<int>(load_u32(source + i / 4)));
+                const __m128i first = _mm_and_si128(packed, mask);
+                const __m128i second = _mm_and_si128(_mm_srli_epi16(packed, 2), mask);
+                const __m128i third = _mm_and_si128(_mm_srli_epi16(packed, 4), mask);
+                const __m128i fourth = _mm_and_si128(_mm_srli_epi16(packed, 6), mask);
+
+                __m128i levels = _mm_unpacklo_epi16(_mm_unpacklo_epi8(first, second), _mm_unpacklo_epi8(third, fourth));
+
+                // Multiply by 85. Each byte is at most 3, so the 16-bit shifts do not cross bytes
+                levels = _mm_or_si128(_mm_or_si128(levels, _mm_slli_epi16(levels, 2)),
+                    _mm_or_si128(_mm_slli_epi16(levels, 4), _mm_slli_epi16(levels, 6)));
+
+                store_gray_sse2(dest + i * 4, levels);
+            }
+
+            unpack_gray4_scalar(dest + i * 4, source + i / 4, count - i, palette);
+        }
+
+        PIXEL_TARGET("sse2")
+        void unpack_gray16_sse2(std::uint8_t *dest, const std::uint8_t *source, const std::size_t count, const rgba *palette) {
+            const __m128i mask = _mm_set1_epi8(0x0F);
+            std::size_t i = 0;
+
+            for (; i + 16 <= count; i += 16) {
+                const __m128i packed = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(source + i / 2));
+                __m128i levels = _mm_unpacklo_epi8(_mm_and_si128(packed, mask), _mm_and_si128(_mm_srli_epi16(packed, 4), mask));
+
+                // Multiply by 17
+                levels = _mm_or_si128(levels, _mm_slli_epi16(levels, 4));
+                store_gray_sse2(dest + i * 4, levels);
+            }
+
+            unpack_gray16_scalar(dest + i * 4, source + i / 2, count - i, palette);
+        }
+
+        PIXEL_TARGET("sse2")
+        void unpack_gray256_sse2(std::uint8_t *dest, const std::uint8_t *source, const std::size_t count, const rgba *palette) {
+            std::size_t i = 0;
+
+            for (; i + 16 <= count; i += 16) {
+                store_gray_sse2(dest + i * 4, _mm_loadu_si128(reinterpret_cast<const __m128i *>(source + i)));
+            }
+
+            unpack_gray256_scalar(dest + i * 4, source + i, count - i, palette);
+        }
+
+        PIXEL_TARGET("sse2")
+        void unpack_color256_sse2(std::uint8_t *dest, const std::uint8_t *source, const std::size_t count, const rgba *palette) {
+            if (!palette) {
+                unpack_gray256_sse2(dest, source, count, palette);
+                return;
+            }
+
+            unpack_color256_scalar(dest, source, count, palette);
+        }
+
+        PIXEL_TARGET("sse2")
+        void unpack_color4k_sse2(std::uint8_t *dest, const std::uint8_t *source, const std::size_t count, const rgba *palette) {
+            const __m128i mask = _mm_set1_epi16(0xF);
+            const __m128i alpha = _mm_set1_epi16(static_cast<short>(0xFF00));
+            std::size_t i = 0;
+
+            for (; i + 8 <= count; i += 8) {
+                const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i *>(source + i * 2));
+
+                __m128i r = _mm_and_si128(_mm_srli_epi16(pixels, 8), mask);
+                __m128i g = _mm_and_si128(_mm_srli_epi16(pixels, 4), mask);
+                __m128i b = _mm_and_si128(pixels, mask);
+
+                r = _mm_or_si128(r, _mm_slli_epi16(r, 4));
+                g = _mm_or_si128(g, _mm_slli_epi16(g, 4));
+                b = _mm_or_si128(b, _mm_slli_epi16(b, 4));
+
+                const __m128i rg = _mm_or_si128(r, _mm_slli_epi16(g, 8));
+                const __m128i ba = _mm_or_si128(b, alpha);
+
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + i * 4), _mm_unpacklo_epi16(rg, ba));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + i * 4 + 16), _mm_unpackhi_epi16(rg, ba));
+            }
+
+            unpack_color4k_scalar(dest + i * 4, source + i * 2, count - i, palette);
+        }
+
+        PIXEL_TARGET("sse2")
+        void unpack_color64k_sse2(std::uint8_t *dest, const std::uint8_t *source, const std::size_t count, const rgba *palette) {
+            const __m128i alpha = _mm_set1_epi16(static_cast<short>(0xFF00));
+            std::size_t i = 0;
+
+            for (; i + 8 <= count; i += 8) {
+                const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i *>(source + i * 2));
+
+                __m128i r = _mm_srli_epi16(pixels, 11);
+                __m128i g = _mm_and_si128(_mm_srli_epi16(pixels, 5), _mm_set1_epi16(0x3F));
+                __m128i b = _mm_and_si128(pixels, _mm_set1_epi16(0x1F));
+
+                r = _mm_or_si128(_mm_slli_epi16(r, 3), _mm_srli_epi16(r, 2));
+                g = _mm_or_si128(_mm_slli_epi16(g, 2), _mm_srli_epi16(g, 4));
+                b = _mm_or_si128(_mm_slli_epi16(b, 3), _mm_srli_epi16(b, 2));
+
+                const __m128i rg = _mm_or_si128(r, _mm_slli_epi16(g, 8));
+                const __m128i ba = _mm_or_si128(b, alpha);
+
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + i * 4), _mm_unpacklo_epi16(rg, ba));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + i * 4 + 16), _mm_unpackhi_epi16(rg, ba));
+            }
+
+            unpack_color64k_scalar(dest + i * 4, source + i * 2, count - i, palette);
+        }
+
+        PIXEL_TARGET("sse2")
+        void unpack_color16mu_sse2(std::uint8_t *dest, const std::uint8_t *source, const std::size_t count, const rgba *palette) {
+            const __m128i alpha = _mm_set1_epi32(static_cast<int>(OPAQUE_ALPHA));
+            std::size_t i = 0;
+
+            for (; i + 4 <= count; i += 4) {
+                const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i *>(source + i * 4));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + i * 4), _mm_or_si128(swap_red_blue_sse2(pixels), alpha));
+            }
+
+            unpack_color16mu_scalar(dest + i * 4, source + i * 4, count - i, palette);
+        }
+
+        PIXEL_TARGET("sse2")
+        void swap_red_blue_row_sse2(std::uint8_t *dest, const std::uint8_t *source, const std::size_t count, const rgba *palette) {
+            std::size_t i = 0;
+
+            for (; i + 4 <= count; i += 4) {
+                const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i *>(source + i * 4));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + i * 4), swap_red_blue_sse2(pixels));
+            }
+
+            unpack_color16ma_scalar(dest + i * 4, source + i * 4, count - i, palette);
+        }
+
+        // Components of two pixels widened to 16-bit, times the reciprocal of their alpha
+        PIXEL_TARGET("sse2")
+        inline __m128i unpremultiply_sse2(const __m128i comps, const __m128i reciprocals) {
+            const __m128i product_lo = _mm_mullo_epi16(comps, reciprocals);
+            const __m128i product_hi = _mm_mulhi_epu16(comps, reciprocals);
+            const __m128i round = _mm_set1_epi32(128);
+            const __m128i max = _mm_set1_epi32(255);
+
+            __m128i first = _mm_srli_epi32(_mm_add_epi32(_mm_unpacklo_epi16(product_lo, product_hi), round), 8);
+            __m128i second = _mm_srli_epi32(_mm_add_epi32(_mm_unpackhi_epi16(product_lo, product_hi), round), 8);
+
+            // Colour brighter than the alpha is invalid, clamp it like the scalar path
+            const __m128i first_over = _mm_cmpgt_epi32(first, max);
+            const __m128i second_over = _mm_cmpgt_epi32(second, max);
+
+            first = _mm_or_si128(_mm_andnot_si128(first_over, first), _mm_and_si128(first_over, max));
+            second = _mm_or_si128(_mm_andnot_si128(second_over, second), _mm_and_si128(second_over, max));
+
+            return _mm_packs_epi32(first, second);
+        }
+
+        PIXEL_TARGET("sse2")
+        void unpack_color16map_sse2(std::uint8_t *dest, const std::uint8_t *source, const std::size_t count, const rgba *palette) {
+            const __m128i zero = _mm_setzero_si128();
+            std::size_t i = 0;
+
+            for (; i + 4 <= count; i += 4) {
+                const std::uint8_t *pixel = source + i * 4;
+                const __m128i pixels = swap_red_blue_sse2(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pixel)));
+
+                const short recip0 = static_cast<short>(UNPREMULTIPLY_RECIPROCALS[pixel[3]]);
+                const short recip1 = static_cast<short>(UNPREMULTIPLY_RECIPROCALS[pixel[7]]);
+                const short recip2 = static_cast<short>(UNPREMULTIPLY_RECIPROCALS[pixel[11]]);
+                const short recip3 = static_cast<short>(UNPREMULTIPLY_RECIPROCALS[pixel[15]]);
+
+                const __m128i result_lo = unpremultiply_sse2(_mm_unpacklo_epi8(pixels, zero),
+                    _mm_set_epi16(recip1, recip1, recip1, recip1, recip0, recip0, recip0, recip0));
+                const __m128i result_hi = unpremultiply_sse2(_mm_unpackhi_epi8(pixels, zero),
+                    _mm_set_epi16(recip3, recip3, recip3, recip3, recip2, recip2, recip2, recip2));
+
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + i * 4), restore_alpha_sse2(_mm_packus_epi16(result_lo, result_hi), pixels));
+            }
+
+            unpack_color16map_scalar(dest + i * 4, source + i * 4, count - i, palette);
+        }
+
+        PIXEL_TARGET("sse2")
+        inline __m128i pack_four_color4k_sse2(const __m128i pixels) {
+            const __m128i r = _mm_slli_epi32(_mm_and_si128(pixels, _mm_set1_epi32(0xF0)), 4);
+            const __m128i g = _mm_and_si128(_mm_srli_epi32(pixels, 8), _mm_set1_epi32(0xF0));
+            const __m128i b = _mm_and_si128(_mm_srli_epi32(pixels, 20), _mm_set1_epi32(0xF));
+
+            return _mm_or_si128(r, _mm_or_si128(g, b));
+        }
+
+        PIXEL_TARGET("sse2")
+        inline __m128i pack_four_color64k_sse2(const __m128i pixels) {
+            const __m128i r = _mm_slli_epi32(_mm_and_si128(pixels, _mm_set1_epi32(0xF8)), 8);
+            const __m128i g = _mm_and_si128(_mm_srli_epi32(pixels, 5), _mm_set1_epi32(0x07E0));
+            const __m128i b = _mm_and_si128(_mm_srli_epi32(pixels, 19), _mm_set1_epi32(0x1F));
+
+            // Sign extend the 16-bit value, so the signed pack keeps its bits
+            return _mm_srai_epi32(_mm_slli_epi32(_mm_or_si128(r, _mm_or_si128(g, b)), 16), 16);
+        }
+
+        PIXEL_TARGET("sse2")
+        void pack_color4k_sse2(std::uint8_t *dest, const std::uint8_t *source, const std::size_t count, const rgba *palette) {
+            std::size_t i = 0;
+
+            for (; i + 8 <= count; i += 8) {
+                const __m128i first = pack_four_color4k_sse2(_mm_loadu_si128(reinterpret_cast<const __m128i *>(source + i * 4)));
+                const __m128i second = pack_four_color4k_sse2(_mm_loadu_si128(reinterpret_cast<const __m128i *>(source + i * 4 + 16)));
+
+                // Values fit in 12 bits, so the signed pack keeps them
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + i * 2), _mm_packs_epi32(first, second));
+            }
+
+            pack_color4k_scalar(dest + i * 2, source + i * 4, count - i, palette);
+        }
+
+        PIXEL_TARGET("sse2")
+        void pack_color64k_sse2(std::uint8_t *dest, const std::uint8_t *source, const std::size_t count, const rgba *palette) {
+            std::size_t i = 0;
+
+            for (; i + 8 <= count; i += 8) {
+                const __m128i first = pack_four_color64k_sse2(_mm_loadu_si128(reinterpret_cast<const __m128i *>(source + i * 4)));
+                const __m128i second = pack_four_color64k_sse2(_mm_loadu_si128(reinterpret_cast<const __m128i *>(source + i * 4 + 16)));
+
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + i * 2), _mm_packs_epi32(first, second));
+            }
+
+            pack_color64k_scalar(dest + i * 2, source + i * 4, count - i, palette);
+        }
+
+        PIXEL_TARGET("sse2")
+        void pack_color16mu_sse2(std::uint8_t *dest, const std::uint8_t *source, const std::size_t count, const rgba *palette) {
+            // Also marks the unused byte as opaque
+            unpack_color16mu_sse2(dest, source, count, palette);
+        }
+
+        PIXEL_TARGET("sse2")
+        inline __m128i premultiply_sse2(const __m128i comps) {
+            const __m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(comps, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+            const __m128i product = _mm_add_epi16(_mm_mullo_epi16(comps, alpha), _mm_set1_epi16(128));
+
+            return _mm_srli_epi16(_mm_add_epi16(product, _mm_srli_epi16(product, 8)), 8);
+        }
+
+        PIXEL_TARGET("sse2")
+        void pack_color16map_sse2(std::uint8_t *dest, const std::uint8_t *source, const std::size_t count, const rgba *palette) {
+            const __m128i zero = _mm_setzero_si128();
+            std::size_t i = 0;
+
+            for (; i + 4 <= count; i += 4) {
+                const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i *>(source + i * 4));
+                const __m128i result = _mm_packus_epi16(premultiply_sse2(_mm_unpacklo_epi8(pixels, zero)),
+                    premultiply_sse2(_mm_unpackhi_epi8(pixels, zero)));
+
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + i * 4), swap_red_blue_sse2(restore_alpha_sse2(result, pixels)));
+            }
+
+            pack_color16map_scalar(dest + i * 4, source + i * 4, count - i, palette);
+        }
+
+        pixel_kernels make_sse2_kernels() {
+            pixel_kernels kernels = make_scalar_kernels();
+
+            kernels.set_unpack(pixel_format::gray2, unpack_gray2_sse2);
+            kernels.set_unpack(pixel_format::gray4, unpack_gray4_sse2);
+            kernels.set_unpack(pixel_format::gray16, unpack_gray16_sse2);
+            kernels.set_unpack(pixel_format::gray256, unpack_gray256_sse2);
+            kernels.set_unpack(pixel_format::color256, unpack_color256_sse2);
+            kernels.set_unpack(pixel_format::color4k, unpack_color4k_sse2);
+            kernels.set_unpack(pixel_format::color64k, unpack_color64k_sse2);
+            kernels.set_unpack(pixel_format::color16mu, unpack_color16mu_sse2);
+            kernels.set_unpack(pixel_format::color16ma, swap_red_blue_row_sse2);
+            kernels.set_unpack(pixel_format::color16map, unpack_color16map_sse2);
+
+            kernels.set_pack(pixel_format::color4k, pack_color4k_sse2);
+            kernels.set_pack(pixel_format::color64k, pack_color64k_sse2);
+            kernels.set_pack(pixel_format::color16mu, pack_color16mu_sse2);
+            kernels.set_pack(pixel_format::color16ma, swap_red_blue_row_sse2);
+            kernels.set_pack(pixel_format::color16map, pack_color16map_sse2);
+
+            return kernels;
+        }
+
+        // ======================= AVX2 =======================
+
+        PIXEL_TARGET("avx2")
+        void unpack_gray256_avx2(std::uint8_t *dest, const std::uint8_t *source, const std::size_t count, const rgba *palette) {
+            const __m256i alpha = _mm256_set1_epi32(static_cast<int>(OPAQUE_ALPHA));
+            std::size_t i = 0;
+
+            for (; i + 32 <= count; i += 32) {
+                const __m256i levels = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(source + i));
+                const __m256i doubled_lo = _mm256_unpacklo_epi8(levels, levels);
+                const __m256i doubled_hi = _mm256_unpackhi_epi8(levels, levels);
+
+                // Unpacks work inside each 128-bit lane, so quad 0 holds pixels 0-3 and 16-19
+                const __m256i quad0 = _mm256_or_si256(_mm256_unpacklo_epi16(doubled_lo, doubled_lo), alpha);
+                const __m256i quad1 = _mm256_or_si256(_mm256_unpackhi_epi16(doubled_lo, doubled_lo), alpha);
+                const __m256i quad2 = _mm256_or_si256(_mm256_unpacklo_epi16(doubled_hi, doubled_hi), alpha);
+                const __m256i quad3 = _mm256_or_si256(_mm256_unpackhi_epi16(doubled_hi, doubled_hi), alpha);
+
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(dest + i * 4), _mm256_permute2x128_si256(quad0, quad1, 0x20));
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(dest + i * 4 + 32), _mm256_permute2x128_si256(quad2, quad3, 0x20));
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(dest + i * 4 + 64), _mm256_permute2x128_si256(quad0, quad1, 0x31));
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(dest + i * 4 + 96), _mm256_permute2x128_si256(quad2, quad3, 0x31));
+            }
+
+            unpack_gray256_sse2(dest + i * 4, source + i, count - i, palette);
+        }
+
+        PIXEL_TARGET("avx2")
+        void unpack_color256_avx2(std::uint8_t *dest, const std::uint8_t *source, const std::size_t count, const rgba *palette) {
+            if (!palette) {
+                unpack_gray256_avx2(dest, source, count, palette);
+                return;
+            }
+
+            const __m256i alpha = _mm256_set1_epi32(static_cast<int>(OPAQUE_ALPHA));
+            std::size_t i = 0;
+
+            for (; i + 8 <= count; i += 8) {
+                const __m256i indexes = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(source + i)));
+                const __m256i colors = _mm256_i32gather_epi32(reinterpret_cast<const int *>(palette), indexes, 4);
+
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(dest + i * 4), _mm256_or_si256(colors, alpha));
+            }
+
+            unpack_color256_scalar(dest + i * 4, source + i, count - i, palette);
+        }
+
+        PIXEL_TARGET("avx2")
+        void unpack_color64k_avx2(std::uint8_t *dest, const std::uint8_t *source, const std::size_t count, const rgba *palette) {
+            const __m256i alpha = _mm256_set1_epi16(static_cast<short>(0xFF00));
+            std::size_t i = 0;
+
+            for (; i + 16 <= count; i += 16) {
+                const __m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(source + i * 2));
+
+                __m256i r = _mm256_srli_epi16(pixels, 11);
+                __m256i g = _mm256_and_si256(_mm256_srli_epi16(pixels, 5), _mm256_set1_epi16(0x3F));
+                __m256i b = _mm256_and_si256(pixels, _mm256_set1_epi16(0x1F));
+
+                r = _mm256_or_si256(_mm256_slli_epi16(r, 3), _mm256_srli_epi16(r, 2));
+                g = _mm256_or_si256(_mm256_slli_epi16(g, 2), _mm256_srli_epi16(g, 4));
+                b = _mm256_or_si256(_mm256_slli_epi16(b, 3), _mm256_srli_epi16(b, 2));
+
+                const __m256i rg = _mm256_or_si256(r, _mm256_slli_epi16(g, 8));
+                const __m256i ba = _mm256_or_si256(b, alpha);
+
+                const __m256i first = _mm256_unpacklo_epi16(rg, ba);
+                const __m256i second = _mm256_unpackhi_epi16(rg, ba);
+
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(dest + i * 4), _mm256_permute2x128_si256(first, second, 0x20));
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(dest + i * 4 + 32), _mm256_permute2x128_si256(first, second, 0x31));
+            }
+
+            unpack_color64k_sse2(dest + i * 4, source + i * 2, count - i, palette);
+        }
+
+        PIXEL_TARGET("avx2")
+        void unpack_color16m_avx2(std::uint8_t *dest, const std::uint8_t *source, const std::size_t count, const rgba *palette) {
+            const __m256i shuffle = _mm256_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1,
+                2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1);
+            const __m256i alpha = _mm256_set1_epi32(static_cast<int>(OPAQUE_ALPHA));
+            std::size_t i = 0;
+
+            // Each half loads 16 bytes for 4 pixels, stay 2 pixels away from the end of the row
+            for (; i + 10 <= count; i += 8) {
+                const __m128i first = _mm_loadu_si128(reinterpret_cast<const __m128i *>(source + i * 3));
+                const __m128i second = _mm_loadu_si128(reinterpret_cast<const __m128i *>(source + i * 3 + 12));
+                const __m256i pixels = _mm256_inserti128_si256(_mm256_castsi128_si256(first), second, 1);
+
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(dest + i * 4), _mm256_or_si256(_mm256_shuffle_epi8(pixels, shuffle), alpha));
+            }
+
+            unpack_color16m_scalar(dest + i * 4, source + i * 3, count - i, palette);
+        }
+
+        PIXEL_TARGET("avx2")
+        void unpack_color16mu_avx2(std::uint8_t *dest, const std::uint8_t *source, const std::size_t count, const rgba *palette) {
+            const __m256i shuffle = _mm256_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+                2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+            const __m256i alpha = _mm256_set1_epi32(static_cast<int>(OPAQUE_ALPHA));
+            std::size_t i = 0;
+
+            for (; i + 8 <= count; i += 8) {
+                const __m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(source + i * 4));
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(dest + i * 4), _mm256_or_si256(_mm256_shuffle_epi8(pixels, shuffle), alpha));
+            }
+
+            unpack_color16mu_sse2(dest + i * 4, source + i * 4, count - i, palette);
+        }
+
+        PIXEL_TARGET("avx2")
+        void swap_red_blue_row_avx2(std::uint8_t *dest, const std::uint8_t *source, const std::size_t count, const rgba *palette) {
+            const __m256i shuffle = _mm256_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+                2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+            std::size_t i = 0;
+
+            for (; i + 8 <= count; i += 8) {
+                const __m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(source + i * 4));
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(dest + i * 4), _mm256_shuffle_epi8(pixels, shuffle));
+            }
+
+            swap_red_blue_row_sse2(dest + i * 4, source + i * 4, count - i, palette);
+        }
+
+        PIXEL_TARGET("avx2")
+        void pack_color16m_avx2(std::uint8_t *dest, const std::uint8_t *source, const std::size_t count, const rgba *palette) {
+            const __m256i shuffle = _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+                2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+            std::size_t i = 0;
+
+            // Each half stores 16 bytes for 4 pixels, the next store or the tail overwrites the extra 4
+            for (; i + 10 <= count; i += 8) {
+                const __m256i pixels = _mm256_shuffle_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(source + i * 4)), shuffle);
+
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + i * 3), _mm256_castsi256_si128(pixels));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + i * 3 + 12), _mm256_extracti128_si256(pixels, 1));
+            }
+
+            pack_color16m_scalar(dest + i * 3, source + i * 4, count - i, palette);
+        }
+
+        pixel_kernels make_avx2_kernels() {
+            pixel_kernels kernels = make_sse2_kernels();
+
+            kernels.set_unpack(pixel_format::gray256, unpack_gray256_avx2);
+            kernels.set_unpack(pixel_format::color256, unpack_color256_avx2);
+            kernels.set_unpack(pixel_format::color64k, unpack_color64k_avx2);
+            kernels.set_unpack(pixel_format::color16m, unpack_color16m_avx2);
+            kernels.set_unpack(pixel_format::color16mu, unpack_color16mu_avx2);
+            kernels.set_unpack(pixel_format::color16ma, swap_red_blue_row_avx2);
+
+            kernels.set_pack(pixel_format::color16m, pack_color16m_avx2);
+            kernels.set_pack(pixel_format::color16mu, unpack_color16mu_avx2);
+            kernels.set_pack(pixel_format::color16ma, swap_red_blue_row_avx2);
+
+            return kernels;
+        }
+#endif
+
+#if PIXEL_NEON_KERNELS
+        // ======================= NEON =======================
+
+        void unpack_gray256_neon(std::uint8_t *dest, const std::uint8_t *source, const std::size_t count, const rgba *palette) {
+            std::size_t i = 0;
+
+            for (; i + 16 <= count; i += 16) {
+                const uint8x16_t levels = vld1q_u8(source + i);
+
+                uint8x16x4_t pixels;
+                pixels.val[0] = levels;
+                pixels.val[1] = levels;
+                pixels.val[2] = levels;
+                pixels.val[3] = vdupq_n_u8(0xFF);
+
+                vst4q_u8(dest + i * 4, pixels);
+            }
+
+            unpack_gray256_scalar(dest + i * 4, source + i, count - i, palette);
+        }
+
+        void unpack_color256_neon(std::uint8_t *dest, const std::uint8_t *source, const std::size_t count, const rgba *palette) {
+            // No gather, the palette lookup stays scalar
+            if (!palette) {
+                unpack_gray256_neon(dest, source, count, palette);
+                return;
+            }
+
+            unpack_color256_scalar(dest, source, count, palette);
+        }
+
+        void unpack_color64k_neon(std::uint8_t *dest, const std::uint8_t *source, const std::size_t count, const rgba *palette) {
+            std::size_t i = 0;
+
+            for (; i + 8 <= count; i += 8) {
+                const uint16x8_t pixels = vreinterpretq_u16_u8(vld1q_u8(source + i * 2));
+
+                uint8x8_t r = vand_u8(vmovn_u16(vshrq_n_u16(pixels, 8)), vdup_n_u8(0xF8));
+                uint8x8_t g = vand_u8(vmovn_u16(vshrq_n_u16(pixels, 3)), vdup_n_u8(0xFC));
+                uint8x8_t b = vmovn_u16(vshlq_n_u16(pixels, 3));
+
+                uint8x8x4_t result;
+                result.val[0] = vorr_u8(r, vshr_n_u8(r, 5));
+                result.val[1] = vorr_u8(g, vshr_n_u8(g, 6));
+                result.val[2] = vorr_u8(b, vshr_n_u8(b, 5));
+                result.val[3] = vdup_n_u8(0xFF);
+
+                vst4_u8(dest + i * 4, result);
+            }
+
+            unpack_color64k_scalar(dest + i * 4, source + i * 2, count - i, palette);
+        }
+
+        void unpack_color16m_neon(std::uint8_t *dest, const std::uint8_t *source, const std::size_t count, const rgba *palette) {
+            std::size_t i = 0;
+
+            for (; i + 16 <= count; i += 16) {
+                const uint8x16x3_t bgr = vld3q_u8(source + i * 3);
+
+                uint8x16x4_t result;
+                result.val[0] = bgr.val[2];
+                result.val[1] = bgr.val[1];
+                result.val[2] = bgr.val[0];
+                result.val[3] = vdupq_n_u8(0xFF);
+
+                vst4q_u8(dest + i * 4, result);
+            }
+
+            unpack_color16m_scalar(dest + i * 4, source + i * 3, count - i, palette);
+        }
+
+        template <bool FORCE_OPAQUE>
+        void swap_red_blue_row_neon(std::uint8_t *dest, const std::uint8_t *source, const std::size_t count, const rgba *palette) {
+            std::size_t i = 0;
+
+            for (; i + 16 <= count; i += 16) {
+                uint8x16x4_t pixels = vld4q_u8(source + i * 4);
+
+                const uint8x16_t first = pixels.val[0];
+                pixels.val[0] = pixels.val[2];
+                pixels.val[2] = first;
+
+                if (FORCE_OPAQUE) {
+                    pixels.val[3] = vdupq_n_u8(0xFF);
+                }
+
+                vst4q_u8(dest + i * 4, pixels);
+            }
+
+            if (FORCE_OPAQUE) {
+                unpack_color16mu_scalar(dest + i * 4, source + i * 4, count - i, palette);
+            } else {
+                unpack_color16ma_scalar(dest + i * 4, source + i * 4, count - i, palette);
+            }
+        }
+
+        void pack_color64k_neon(std::uint8_t *dest, const std::uint8_t *source, const std::size_t count, const rgba *palette) {
+            std::size_t i = 0;
+
+            for (; i + 8 <= count; i += 8) {
+                const uint8x8x4_t pixels = vld4_u8(source + i * 4);
+
+                const uint16x8_t r = vshll_n_u8(vand_u8(pixels.val[0], vdup_n_u8(0xF8)), 8);
+                const uint16x8_t g = vshll_n_u8(vand_u8(pixels.val[1], vdup_n_u8(0xFC)), 3);
+                const uint16x8_t b = vmovl_u8(vshr_n_u8(pixels.val[2], 3));
+
+                vst1q_u8(dest + i * 2, vreinterpretq_u8_u16(vorrq_u16(r, vorrq_u16(g, b))));
+            }
+
+            pack_color64k_scalar(dest + i * 2, source + i * 4, count - i, palette);
+        }
+
+        void pack_color16m_neon(std::uint8_t *dest, const std::uint8_t *source, const std::size_t count, const rgba *palette) {
+            std::size_t i = 0;
+
+            for (; i + 16 <= count; i += 16) {
+                const uint8x16x4_t pixels = vld4q_u8(source + i * 4);
+
+                uint8x16x3_t bgr;
+                bgr.val[0] = pixels.val[2];
+                bgr.val[1] = pixels.val[1];
+                bgr.val[2] = pixels.val[0];
+
+                vst3q_u8(dest + i * 3, bgr);
+            }
+
+            pack_color16m_scalar(dest + i * 3, source + i * 4, count - i, palette);
+        }
+
+        inline uint8x8_t premultiply_neon(const uint8x8_t comps, const uint8x8_t alpha) {
+            // (t + ((t + 128) >> 8) + 128) >> 8, same as the scalar rounding
+            const uint16x8_t product = vmull_u8(comps, alpha);
+            return vrshrn_n_u16(vrsraq_n_u16(product, product, 8), 8);
+        }
+
+        void pack_color16map_neon(std::uint8_t *dest, const std::uint8_t *source, const std::size_t count, const rgba *palette) {
+            std::size_t i = 0;
+
+            for (; i + 8 <= count; i += 8) {
+                const uint8x8x4_t pixels = vld4_u8(source + i * 4);
+
+                uint8x8x4_t result;
+                result.val[0] = premultiply_neon(pixels.val[2], pixels.val[3]);
+                result.val[1] = premultiply_neon(pixels.val[1], pixels.val[3]);
+                result.val[2] = premultiply_neon(pixels.val[0], pixels.val[3]);
+                result.val[3] = pixels.val[3];
+
+                vst4_u8(dest + i * 4, result);
+            }
+
+            pack_color16map_scalar(dest + i * 4, source + i * 4, count - i, palette);
+        }
+
+        pixel_kernels make_neon_kernels() {
+            pixel_kernels kernels = make_scalar_kernels();
+
+            kernels.set_unpack(pixel_format::gray256, unpack_gray256_neon);
+            kernels.set_unpack(pixel_format::color256, unpack_color256_neon);
+            kernels.set_unpack(pixel_format::color64k, unpack_color64k_neon);
+            kernels.set_unpack(pixel_format::color16m, unpack_color16m_neon);
+            kernels.set_unpack(pixel_format::color16mu, swap_red_blue_row_neon<true>);
+            kernels.set_unpack(pixel_format::color16ma, swap_red_blue_row_neon<false>);
+
+            kernels.set_pack(pixel_format::color64k, pack_color64k_neon);
+            kernels.set_pack(pixel_format::color16m, pack_color16m_neon);
+            kernels.set_pack(pixel_format::color16mu, swap_red_blue_row_neon<true>);
+            kernels.set_pack(pixel_format::color16ma, swap_red_blue_row_neon<false>);
+            kernels.set_pack(pixel_format::color16map, pack_color16map_neon);
+
+            return kernels;
+        }
+#endif
+
+#if PIXEL_X86_KERNELS || EKA2L1_ARCH(ARM) || EKA2L1_ARCH(ARM64)
+        const cpu_info &get_host_cpu_info() {
+            static const cpu_info info = [] {
+                cpu_info result;
+                result.detect();
+
+                return result;
+            }();
+
+            return info;
+        }
+#endif
+
+        const pixel_kernels &get_pixel_kernels(pixel_kernel_set set) {
+            if (set == pixel_kernel_set::automatic) {
+                set = get_best_pixel_kernel_set();
+            } else if (!is_pixel_kernel_set_supported(set)) {
+                set = pixel_kernel_set::scalar;
+            }
+
+            static const pixel_kernels scalar_kernels = make_scalar_kernels();
+
+            switch (set) {
+#if PIXEL_X86_KERNELS
+            case pixel_kernel_set::sse2: {
+                static const pixel_kernels sse2_kernels = make_sse2_kernels();
+                return sse2_kernels;
+            }
+
+            case pixel_kernel_set::avx2: {
+                static const pixel_kernels avx2_kernels = make_avx2_kernels();
+                return avx2_kernels;
+            }
+#endif
+
+#if PIXEL_NEON_KERNELS
+            case pixel_kernel_set::neon: {
+                static const pixel_kernels neon_kernels = make_neon_kernels();
+                return neon_kernels;
+            }
+#endif
+
+            default:
+                break;
+            }
+
+            return scalar_kernels;
+        }
+
+        bool is_palette_format(const pixel_format format) {
+            return (format == pixel_format::color16) || (format == pixel_format::color256);
+        }
+    }
+
+    std::uint32_t get_pixel_format_bpp(const pixel_format format) {
+        switch (format) {
+        case pixel_format::gray2:
+            return 1;
+
+        case pixel_format::gray4:
+            return 2;
+
+        case pixel_format::gray16:
+        case pixel_format::color16:
+            return 4;
+
+        case pixel_format::gray256:
+        case pixel_format::color256:
+            return 8;
+
+        case pixel_format::color4k:
+        case pixel_format::color64k:
+            return 16;
+
+        case pixel_format::color16m:
+            return 24;
+
+        default:
+            break;
+        }
+
+        return 32;
+    }
+
+    std::size_t get_pixel_row_size(const pixel_format format, const std::size_t width) {
+        return (width * get_pixel_format_bpp(format) + 7) / 8;
+    }
+
+    bool is_pixel_kernel_set_supported(const pixel_kernel_set set) {
+        switch (set) {
+        case pixel_kernel_set::automatic:
+        case pixel_kernel_set::scalar:
+            return true;
+
+#if PIXEL_X86_KERNELS
+        case pixel_kernel_set::sse2:
+            return get_host_cpu_info().bSSE2;
+
+        case pixel_kernel_set::avx2:
+            return get_host_cpu_info().bAVX2;
+#endif
+
+#if PIXEL_NEON_KERNELS
+        case pixel_kernel_set::neon:
+#if EKA2L1_ARCH(ARM64)
+            return true;
+#else
+            return get_host_cpu_info().bNEON;
+#endif
+#endif
+
+        default:
+            break;
+        }
+
+        return false;
+    }
+
+    pixel_kernel_set get_best_pixel_kernel_set() {
+        static const pixel_kernel_set best = [] {
+            static constexpr pixel_kernel_set PREFERENCE[] = { pixel_kernel_set::avx2, pixel_kernel_set::sse2, pixel_kernel_set::neon };
+
+            for (const pixel_kernel_set set : PREFERENCE) {
+                if (is_pixel_kernel_set_supported(set)) {
+                    return set;
+                }
+            }
+
+            return pixel_kernel_set::scalar;
+        }();
+
+        return best;
+    }
+
+    void convert_pixel_row(const pixel_format dest_format, void *dest, const pixel_format source_format, const void *source,
+        const std::size_t count, const pixel_convert_params &params) {
+        if (!count || (dest_format >= pixel_format::total) || (source_format >= pixel_format::total)) {
+            return;
+        }
+
+        std::uint8_t *dest8 = reinterpret_cast<std::uint8_t *>(dest);
+        const std::uint8_t *source8 = reinterpret_cast<const std::uint8_t *>(source);
+
+        if ((dest_format == source_format) && (!is_palette_format(dest_format) || (params.source_palette_ == params.dest_palette_))) {
+            std::memcpy(dest8, source8, get_pixel_row_size(dest_format, count));
+            return;
+        }
+
+        const pixel_kernels &kernels = get_pixel_kernels(params.kernels_);
+        const pixel_row_func unpack = kernels.unpack_[static_cast<std::size_t>(source_format)];
+        const pixel_row_func pack = kernels.pack_[static_cast<std::size_t>(dest_format)];
+
+        if (source_format == pixel_format::rgba8888) {
+            pack(dest8, source8, count, params.dest_palette_);
+            return;
+        }
+
+        if (dest_format == pixel_format::rgba8888) {
+            unpack(dest8, source8, count, params.source_palette_);
+            return;
+        }
+
+        alignas(32) std::uint8_t intermediate[INTERMEDIATE_CHUNK_PIXELS * 4];
+
+        for (std::size_t done = 0; done < count; done += INTERMEDIATE_CHUNK_PIXELS) {
+            const std::size_t chunk = std::min(count - done, INTERMEDIATE_CHUNK_PIXELS);
+
+            unpack(intermediate, source8 + get_pixel_row_size(source_format, done), chunk, params.source_palette_);
+            pack(dest8 + get_pixel_row_size(dest_format, done), intermediate, chunk, params.dest_palette_);
+        }
+    }
+
+    void convert_pixels(const pixel_format dest_format, void *dest, const std::size_t dest_stride, const pixel_format source_format,
+        const void *source, const std::size_t source_stride, const std::size_t width, const std::size_t height,
+        const pixel_convert_params &params) {
+        std::uint8_t *dest8 = reinterpret_cast<std::uint8_t *>(dest);
+        const std::uint8_t *source8 = reinterpret_cast<const std::uint8_t *>(source);
+
+        for (std::size_t y = 0; y < height; y++) {
+            convert_pixel_row(dest_format, dest8 + y * dest_stride, source_format, source8 + y * source_stride, width, params);
+        }
+    }
+}
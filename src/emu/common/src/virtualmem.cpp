@@ -27,9 +27,15 @@
 #elif EKA2L1_PLATFORM(UNIX) || EKA2L1_PLATFORM(DARWIN)
 #include <sys/mman.h>
 #include <sys/stat.h>
+#include <sys/syscall.h>
 
 #include <fcntl.h>
 #include <unistd.h>
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string>
 #endif
 
 namespace eka2l1::common {
@@ -43,12 +49,134 @@ namespace eka2l1::common {
 #endif
     }
 
+#if !EKA2L1_PLATFORM(WIN32)
+    namespace {
+        // Mirrorable regions are views of an unnamed shared memory object. Mirroring maps the same
+        // object again at another place, which works the same way on every POSIX host.
+        struct mirrorable_region {
+            std::size_t size_;
+            int fd_;
+        };
+
+        std::mutex mirrorable_lock;
+        std::map<std::uint8_t *, mirrorable_region> mirrorable_regions;
+
+        int create_shared_memory_object() {
+#if defined(__linux__) && defined(SYS_memfd_create)
+            // Also there on Android, which has no shm_open. MFD_CLOEXEC is 1.
+            return static_cast<int>(syscall(SYS_memfd_create, "eka2l1-mirrorable", 1U));
+#else
+            static std::atomic<std::uint32_t> counter{ 0 };
+            const std::string name = "/eka2l1-" + std::to_string(getpid()) + "-" + std::to_string(counter++);
+
+            const int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+
+            if (fd != -1) {
+                // The object lives on as long as the descriptor does
+                shm_unlink(name.c_str());
+            }
+
+            return fd;
+#endif
+        }
+    }
+#endif
+
+    void *map_mirrorable_memory(const std::size_t size) {
+#if EKA2L1_PLATFORM(WIN32)
+        // Would need placeholders (VirtualAlloc2 and MapViewOfFile3), which are not used yet
+        return map_memory(size);
+#else
+        const int fd = create_shared_memory_object();
+
+        if (fd == -1) {
+            return nullptr;
+        }
+
+        if (ftruncate(fd, static_cast<off_t>(size)) == -1) {
+            close(fd);
+            return nullptr;
+        }
+
+        void *result = mmap(nullptr, size, PROT_NONE, MAP_SHARED, fd, 0);
+
+        if (result == MAP_FAILED) {
+            close(fd);
+            return nullptr;
+        }
+
+        const std::lock_guard<std::mutex> guard(mirrorable_lock);
+        mirrorable_regions.emplace(reinterpret_cast<std::uint8_t *>(result), mirrorable_region{ size, fd });
+
+        return result;
+#endif
+    }
+
+    bool mirror_memory(void *target, void *source, const std::size_t size, const prot perm) {
+#if EKA2L1_PLATFORM(WIN32)
+        return false;
+#else
+        std::uint8_t *source_ptr = reinterpret_cast<std::uint8_t *>(source);
+        int fd = -1;
+        off_t offset = 0;
+
+        {
+            const std::lock_guard<std::mutex> guard(mirrorable_lock);
+            auto ite = mirrorable_regions.upper_bound(source_ptr);
+
+            if (ite == mirrorable_regions.begin()) {
+                return false;
+            }
+
+            --ite;
+
+            if (source_ptr + size > ite->first + ite->second.size_) {
+                return false;
+            }
+
+            fd = ite->second.fd_;
+            offset = static_cast<off_t>(source_ptr - ite->first);
+        }
+
+        // One call, no matter if the target was mirrored before
+        void *result = mmap(target, size, translate_protection(perm), MAP_SHARED | MAP_FIXED, fd, offset);
+        return result != MAP_FAILED;
+#endif
+    }
+
+    bool unmirror_memory(void *target, const std::size_t size) {
+#if EKA2L1_PLATFORM(WIN32)
+        return false;
+#else
+        void *result = mmap(target, size, PROT_NONE, MAP_ANONYMOUS | MAP_PRIVATE | MAP_NORESERVE | MAP_FIXED, -1, 0);
+        return result != MAP_FAILED;
+#endif
+    }
+
+    bool is_memory_mirroring_supported() {
+#if EKA2L1_PLATFORM(WIN32)
+        return false;
+#else
+        return true;
+#endif
+    }
+
     bool unmap_memory(void *ptr, const std::size_t size) {
 #if EKA2L1_PLATFORM(WIN32)
         const auto result = VirtualFree(ptr, 0, MEM_RELEASE);
 
         if (!result) {
 #else
+        {
+            const std::lock_guard<std::mutex> guard(mirrorable_lock);
+            auto ite = mirrorable_regions.find(reinterpret_cast<std::uint8_t *>(ptr));
+
+            if (ite != mirrorable_regions.end()) {
+                close(ite->second.fd_);
+                mirrorable_regions.erase(ite);
+            }
+        }
+
         const int result = munmap(ptr, size);
 
         if (result == -1) {
@@ -43,4 +43,12 @@ namespace eka2l1::common {
     bool directory_watcher::unwatch(const std::int32_t watch_handle) {
         return watcher_->unwatch(watch_handle);
     }
+
+    bool directory_watcher::can_notify() const {
+#if EKA2L1_PLATFORM(WIN32) || EKA2L1_PLATFORM(UNIX)
+        return true;
+#else
+        return false;
+#endif
+    }
 }
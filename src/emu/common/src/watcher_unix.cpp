@@ -20,6 +20,9 @@
 #include "watcher_unix.h"
 #include <common/log.h>
 
+#include <cerrno>
+
+#include <poll.h>
 #include <sys/inotify.h>
 
 namespace eka2l1::common {
@@ -34,6 +37,17 @@ namespace eka2l1::common {
             return;
         }
 
+        // Written on destruction, so that the wait thread does not stay blocked on reading events
+        stop_event_ = eventfd(0, 0);
+
+        if (stop_event_ == -1) {
+            LOG_ERROR(COMMON, "Error creating stop event for INotify wait thread!");
+            close(instance_);
+            instance_ = -1;
+
+            return;
+        }
+
         // 512 is maximum event count
         events_.resize(EVENT_MAX_SIZE * 512);
 
@@ -41,23 +55,46 @@ namespace eka2l1::common {
             std::vector<directory_change> changes;
 
             auto flush_changes = [&](const int wd) {
-                // Flush changes
+                // Flush changes. The callback is called without holding the lock, so that it may take
+                // its own locks, which are also held while adding watches.
+                std::unique_lock<std::mutex> guard(lock_);
                 auto ite = std::find(container_.begin(), container_.end(), wd);
 
                 if (ite != container_.end()) {
-                    auto &callback = callbacks_[std::distance(container_.begin(), ite)];
-                    callback.callback_pair_.first(callback.callback_pair_.second, changes);
+                    const auto callback_pair = callbacks_[std::distance(container_.begin(), ite)].callback_pair_;
+                    guard.unlock();
 
-                    changes.clear();
+                    callback_pair.first(callback_pair.second, changes);
                 }
+
+                changes.clear();
             };
 
             while (!should_stop) {
+                pollfd wait_fds[2];
+                wait_fds[0].fd = instance_;
+                wait_fds[0].events = POLLIN;
+                wait_fds[1].fd = stop_event_;
+                wait_fds[1].events = POLLIN;
+
+                if (poll(wait_fds, 2, -1) == -1) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+
+                    LOG_ERROR(COMMON, "Error waiting for notify event!");
+                    break;
+                }
+
+                if (should_stop || (wait_fds[1].revents & POLLIN)) {
+                    break;
+                }
+
                 const ssize_t length = read(instance_, &events_[0], events_.size());
 
                 if (length == -1) {
                     LOG_ERROR(COMMON, "Error reading notify event!");
-                    should_stop = true;
+                    break;
                 }
 
                 std::size_t i = 0;
@@ -100,12 +137,12 @@ namespace eka2l1::common {
                         change.change_ |= directory_change_action_modified;
                     }
 
-                    changes.push_back(change);
-
                     if ((last_wd != -1) && (last_wd != evt->wd)) {
-                        flush_changes(evt->wd);
+                        flush_changes(last_wd);
                     }
 
+                    changes.push_back(change);
+
                     last_wd = evt->wd;
                     i += evt->len + sizeof(struct inotify_event);
                 }
@@ -118,17 +155,28 @@ namespace eka2l1::common {
     }
 
     directory_watcher_impl::~directory_watcher_impl() {
-        for (auto &wd : container_) {
-            inotify_rm_watch(instance_, wd);
+        if (instance_ == -1) {
+            return;
         }
 
         should_stop = true;
+
+        const std::uint64_t stop_signal = 1;
+        write(stop_event_, &stop_signal, sizeof(stop_signal));
+
         wait_thread_->join();
 
+        for (auto &wd : container_) {
+            inotify_rm_watch(instance_, wd);
+        }
+
+        close(stop_event_);
         close(instance_);
     }
 
     bool directory_watcher_impl::unwatch(const std::int32_t watch_handle) {
+        const std::lock_guard<std::mutex> guard(lock_);
+
         // Find in container
         auto ite = std::find(container_.begin(), container_.end(), watch_handle);
 
@@ -174,6 +222,11 @@ namespace eka2l1::common {
 
     std::int32_t directory_watcher_impl::watch(const std::string &folder, directory_watcher_callback callback,
         void *callback_userdata, const std::uint32_t mask) {
+        if (instance_ == -1) {
+            return 0;
+        }
+
+        const std::lock_guard<std::mutex> guard(lock_);
         const int wd_handle = inotify_add_watch(instance_, folder.c_str(), IN_CREATE | IN_DELETE | IN_MODIFY);
 
         if (wd_handle == -1) {
@@ -39,6 +39,7 @@ namespace eka2l1::common {
         std::vector<std::uint8_t> events_;
 
         int instance_;
+        int stop_event_;
 
         std::atomic<bool> should_stop;
 
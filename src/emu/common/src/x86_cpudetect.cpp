@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) 2022 EKA2L1 Team.
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <common/platform.h>
+
+#if EKA2L1_ARCH(X86) || EKA2L1_ARCH(X64)
+
+#include <common/cpudetect.h>
+
+#include <cstdint>
+#include <cstring>
+#include <thread>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+static void do_cpuid(std::uint32_t *regs, const std::uint32_t leaf, const std::uint32_t subleaf = 0) {
+#ifdef _MSC_VER
+    __cpuidex(reinterpret_cast<int *>(regs), static_cast<int>(leaf), static_cast<int>(subleaf));
+#else
+    __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+// Only valid to call when CPUID reports OSXSAVE
+static std::uint64_t do_xgetbv(const std::uint32_t index) {
+#ifdef _MSC_VER
+    return _xgetbv(index);
+#else
+    std::uint32_t eax = 0;
+    std::uint32_t edx = 0;
+
+    __asm__ __volatile__("xgetbv"
+                         : "=a"(eax), "=d"(edx)
+                         : "c"(index));
+
+    return (static_cast<std::uint64_t>(edx) << 32) | eax;
+#endif
+}
+
+namespace eka2l1::common {
+    // Detects the various cpu features
+    void cpu_info::detect() {
+        std::memset(this, 0, sizeof(*this));
+
+#if EKA2L1_ARCH(X64)
+        OS64bit = true;
+        Mode64bit = true;
+#endif
+
+        num_cores = static_cast<int>(std::thread::hardware_concurrency());
+        if (num_cores <= 0) {
+            num_cores = 1;
+        }
+
+        logical_cpu_count = num_cores;
+
+        std::uint32_t regs[4] = { 0 };
+
+        // Vendor string, EBX EDX ECX
+        do_cpuid(regs, 0);
+        const std::uint32_t max_std_leaf = regs[0];
+
+        std::memcpy(cpu_string, &regs[1], 4);
+        std::memcpy(cpu_string + 4, &regs[3], 4);
+        std::memcpy(cpu_string + 8, &regs[2], 4);
+
+        if (std::strcmp(cpu_string, "GenuineIntel") == 0) {
+            vendor = VENDOR_INTEL;
+        } else if (std::strcmp(cpu_string, "AuthenticAMD") == 0) {
+            vendor = VENDOR_AMD;
+        } else {
+            vendor = VENDOR_OTHER;
+        }
+
+        do_cpuid(regs, 0x80000000);
+        const std::uint32_t max_ex_leaf = regs[0];
+
+        if (max_ex_leaf >= 0x80000004) {
+            for (std::uint32_t i = 0; i < 3; i++) {
+                do_cpuid(regs, 0x80000002 + i);
+                std::memcpy(brand_string + i * 16, regs, 16);
+            }
+        } else {
+            std::strcpy(brand_string, cpu_string);
+        }
+
+        if (max_std_leaf >= 1) {
+            do_cpuid(regs, 1);
+
+            const std::uint32_t ecx = regs[2];
+            const std::uint32_t edx = regs[3];
+
+            HTT = (edx >> 28) & 1;
+            bFXSR = (edx >> 24) & 1;
+            bSSE = (edx >> 25) & 1;
+            bSSE2 = (edx >> 26) & 1;
+            bSSE3 = ecx & 1;
+            bSSSE3 = (ecx >> 9) & 1;
+            bFMA = (ecx >> 12) & 1;
+            bSSE4_1 = (ecx >> 19) & 1;
+            bSSE4_2 = (ecx >> 20) & 1;
+            bMOVBE = (ecx >> 22) & 1;
+            bPOPCNT = (ecx >> 23) & 1;
+            bAES = (ecx >> 25) & 1;
+
+            // AVX needs the OS to save the YMM state on context switch
+            if (((ecx >> 27) & 1) && ((ecx >> 28) & 1)) {
+                bAVX = (do_xgetbv(0) & 0x6) == 0x6;
+            }
+
+            // FMA shares the YMM state with AVX
+            bFMA = bFMA && bAVX;
+
+            if (max_std_leaf >= 7) {
+                do_cpuid(regs, 7);
+
+                bAVX2 = bAVX && ((regs[1] >> 5) & 1);
+                bBMI1 = (regs[1] >> 3) & 1;
+                bBMI2 = (regs[1] >> 8) & 1;
+            }
+        }
+
+        if (max_ex_leaf >= 0x80000001) {
+            do_cpuid(regs, 0x80000001);
+
+            bLAHFSAHF64 = regs[2] & 1;
+            bLZCNT = (regs[2] >> 5) & 1;
+            bSSE4A = (regs[2] >> 6) & 1;
+            bLongMode = (regs[3] >> 29) & 1;
+        }
+
+        CPU64bit = bLongMode;
+    }
+}
+
+#endif
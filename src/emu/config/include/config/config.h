@@ -97,8 +97,11 @@ namespace eka2l1::config {
         bool log_ipc{ false };
         bool log_passed{ false };
         bool log_exports{ false };
+        bool profile_svc{ false };
 
         std::string cpu_backend{ "dynarmic" };
+        int tiered_hot_block_threshold{ 64 }; // Tiered execution only exists with 12l1r, on 32-bit ARM hosts
+        bool fastmem{ false };
         int device{ 0 };
         int language{ -1 };
         int emulator_language{ -1 };
@@ -115,6 +118,7 @@ namespace eka2l1::config {
         bool enable_srv_drm{ true };
 
         bool fbs_enable_compression_queue{ false };
+        int fs_io_worker_count{ 2 };
         bool enable_btrace{ false };
 
         bool stop_warn_touch_disabled{ false };
@@ -123,6 +127,11 @@ namespace eka2l1::config {
         bool nearest_neighbor_filtering{ true };
         bool integer_scaling{ true };
         bool cpu_load_save{ true };
+        bool persistent_jit_cache{ false }; // Not with dynarmic. Turns off demand_paged_code
+        bool persistent_rom_index{ true };
+        bool demand_paged_code{ false };
+        bool persistent_icon_cache{ false };
+        int icon_cache_size{ 16 };
         bool mime_detection{ true };
 
         std::atomic<bool> stepping{ false };
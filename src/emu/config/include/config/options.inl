@@ -37,7 +37,10 @@ OPTION(log-ipc, log_ipc, false)
 OPTION(log-svc, log_svc, false)
 OPTION(log-passed, log_passed, false)
 OPTION(log-exports, log_exports, false)
+OPTION(profile-svc, profile_svc, false)
 OPTION(cpu, cpu_backend, "dynarmic")
+OPTION(tiered-hot-block-threshold, tiered_hot_block_threshold, 64)
+OPTION(fastmem, fastmem, false)
 OPTION(device, device, 0)
 OPTION(language, language, -1)
 OPTION(emulator-language, emulator_language, -1)
@@ -49,6 +52,7 @@ OPTION(enable-srv-rights, enable_srv_rights, true)
 OPTION(enable-srv-sa, enable_srv_sa, true)
 OPTION(enable-srv-drm, enable_srv_drm, true)
 OPTION(fbs-enable-compression-queue, fbs_enable_compression_queue, false)
+OPTION(fs-io-worker-count, fs_io_worker_count, 2)
 OPTION(enable-btrace, enable_btrace, false)
 OPTION(stop-warn-touchscreen-disabled, stop_warn_touch_disabled, false)
 OPTION(dump-imb-range-code, dump_imb_range_code, false)
@@ -56,6 +60,11 @@ OPTION(hide-mouse-in-screen-space, hide_mouse_in_screen_space, false)
 OPTION(enable-nearest-neighbor-filter, nearest_neighbor_filtering, true)
 OPTION(integer-scaling, integer_scaling, true)
 OPTION(cpu-load-save, cpu_load_save, true)
+OPTION(persistent-jit-cache, persistent_jit_cache, false)
+OPTION(persistent-rom-index, persistent_rom_index, true)
+OPTION(demand-paged-code, demand_paged_code, false)
+OPTION(persistent-icon-cache, persistent_icon_cache, false)
+OPTION(icon-cache-size, icon_cache_size, 16)
 OPTION(mime-detection, mime_detection, true)
 OPTION(rtos-level, rtos_level, "mid")
 OPTION(ui-new-style, ui_new_style, true)
@@ -80,6 +80,8 @@ namespace eka2l1::arm {
         void set_tlb_page(address vaddr, std::uint8_t *ptr, prot protection) override;
         void dirty_tlb_page(address addr) override;
         void flush_tlb() override;
+        void set_tlb_asid(const std::int32_t id) override;
+        void flush_tlb_asid(const std::int32_t id) override;
 
         void clear_instruction_cache() override;
         void imb_range(address addr, std::size_t size) override;
@@ -89,5 +91,13 @@ namespace eka2l1::arm {
         }
 
         std::uint32_t get_num_instruction_executed() override;
+
+        bool can_translate_ahead() const override {
+            return true;
+        }
+
+        void set_translate_on_entry(const bool enable) override;
+        bool precompile_block(const address addr, const bool thumb, const std::uint32_t fpscr) override;
+        std::size_t collect_translated_blocks(const address start, const address end, std::vector<translated_block_info> &blocks) override;
     };
 }
\ No newline at end of file
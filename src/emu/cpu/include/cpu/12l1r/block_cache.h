@@ -53,6 +53,7 @@ namespace eka2l1::arm::r12l1 {
         std::uint32_t inst_count_;
 
         bool thumb_;
+        std::uint32_t fpscr_;
 
         std::vector<block_link> links_;
 
@@ -89,9 +90,15 @@ namespace eka2l1::arm::r12l1 {
         // The block that is returned by this is consistent in memory
         translated_block *lookup_block(const vaddress start_addr);
 
+        void remove_block(const vaddress start_addr);
         void flush_range(const vaddress range_start, const vaddress range_end);
         void flush_all();
 
+        /**
+         * @brief Get all blocks that starts in the given range.
+         */
+        std::vector<translated_block *> blocks_in_range(const vaddress range_start, const vaddress range_end);
+
         void set_on_block_invalidate_callback(on_block_invalidate_callback_type cb) {
             invalidate_callback_ = cb;
         }
@@ -79,7 +79,8 @@ namespace eka2l1::arm::r12l1 {
     public:
         enum {
             FLAG_ENABLE_FUZZ = 1 << 1,
-            FLAG_FUZZ_LAST_SYSCALL = 1 << 2
+            FLAG_FUZZ_LAST_SYSCALL = 1 << 2,
+            FLAG_NO_TRANSLATE_ON_ENTRY = 1 << 3
         };
 
         explicit dashixiong_block(r12l1_core *parent);
@@ -88,6 +89,10 @@ namespace eka2l1::arm::r12l1 {
         translated_block *compile_new_block(core_state *state, const vaddress addr);
         translated_block *get_block(const vaddress addr);
 
+        block_cache &get_block_cache() {
+            return cache_;
+        }
+
         void emit_block_links(translated_block *block);
         void emit_return_to_dispatch(translated_block *block, const bool fast_hint);
         void edit_block_links(translated_block *dest, bool unlink = false);
@@ -131,6 +136,12 @@ namespace eka2l1::arm::r12l1 {
         bool write_ex_qword(const vaddress addr, const std::uint64_t val);
 
 #if R12L1_ENABLE_FUZZ
+        template <typename T>
+        static bool fuzz_monitor_read(void *userdata, core *cc, address addr, T *data);
+
+        template <typename T>
+        static std::int32_t fuzz_monitor_write(void *userdata, core *cc, address addr, T value, T expected);
+
         void fuzz_start();
         bool fuzz_execute();
         void fuzz_compare(core_state *state);
@@ -142,6 +153,10 @@ namespace eka2l1::arm::r12l1 {
             return flags_;
         }
 
+        void set_translate_on_entry(const bool enable) {
+            flags_ = enable ? (flags_ & ~FLAG_NO_TRANSLATE_ON_ENTRY) : (flags_ | FLAG_NO_TRANSLATE_ON_ENTRY);
+        }
+
         std::uint32_t current_compiling_fpscr() const {
             return current_fpscr_;
         }
@@ -46,22 +46,98 @@ namespace eka2l1::arm::r12l1 {
     static constexpr std::uint32_t TLB_ENTRY_COUNT = 1 << TLB_LOOKUP_BIT_COUNT;
     static constexpr std::uint32_t TLB_ENTRY_MASK = TLB_ENTRY_COUNT - 1;
 
+    // Number of address spaces whose entries are kept around
+    static constexpr std::uint32_t TLB_SET_COUNT = 8;
+    static constexpr std::int32_t TLB_SET_NO_ASID = -1;
+
+    /**
+     * @brief Software TLB with a set of entries for each of the recently used address spaces.
+     *
+     * Switching address space only switches the active set, so entries of a process survive
+     * until it runs again. Invalidating a page drops it from all sets, since the TLB does not
+     * know which address space the page belongs to.
+     */
     struct tlb {
     public:
-        tlb_entry entries[TLB_ENTRY_COUNT];
+        tlb_entry sets[TLB_SET_COUNT][TLB_ENTRY_COUNT];
+        std::int32_t set_asids[TLB_SET_COUNT];
+        std::uint64_t set_last_use[TLB_SET_COUNT];
+
+        tlb_entry *entries; ///< Entries of the active address space.
+        std::size_t active_set;
+        std::uint64_t use_counter;
 
         std::size_t page_bits;
         std::size_t page_mask;
 
         explicit tlb(std::size_t page_bits)
-            : page_bits(page_bits) {
+            : set_asids()
+            , entries(sets[0])
+            , active_set(0)
+            , use_counter(0)
+            , page_bits(page_bits) {
             page_mask = (1 << page_bits) - 1;
             flush();
         }
 
         void flush() {
             // Using memfill to speed up this process
-            std::memset(entries, 0, sizeof(tlb_entry) * TLB_ENTRY_COUNT);
+            std::memset(sets, 0, sizeof(sets));
+
+            for (std::size_t i = 0; i < TLB_SET_COUNT; i++) {
+                set_asids[i] = (i == active_set) ? set_asids[i] : TLB_SET_NO_ASID;
+                set_last_use[i] = 0;
+            }
+        }
+
+        /**
+         * @brief Drop all entries of an address space, for example because its ID is reused.
+         */
+        void flush_asid(const std::int32_t id) {
+            for (std::size_t i = 0; i < TLB_SET_COUNT; i++) {
+                if (set_asids[i] == id) {
+                    std::memset(sets[i], 0, sizeof(sets[i]));
+                }
+            }
+        }
+
+        /**
+         * @brief Make entries of an address space the active ones.
+         * @returns True if the active entries pointer has changed.
+         */
+        bool switch_asid(const std::int32_t id) {
+            if (set_asids[active_set] == id) {
+                return false;
+            }
+
+            std::size_t target = TLB_SET_COUNT;
+            std::size_t victim = 0;
+
+            for (std::size_t i = 0; i < TLB_SET_COUNT; i++) {
+                if (set_asids[i] == id) {
+                    target = i;
+                    break;
+                }
+
+                if (set_last_use[i] < set_last_use[victim]) {
+                    victim = i;
+                }
+            }
+
+            if (target == TLB_SET_COUNT) {
+                // Reuse the least recently used set
+                target = victim;
+
+                std::memset(sets[target], 0, sizeof(sets[target]));
+                set_asids[target] = id;
+            }
+
+            set_last_use[active_set] = ++use_counter;
+
+            active_set = target;
+            entries = sets[target];
+
+            return true;
         }
 
         void add(vaddress addr, std::uint8_t *host, const std::uint32_t perm) {
@@ -97,10 +173,12 @@ namespace eka2l1::arm::r12l1 {
             const std::size_t tlb_index = page_index & (TLB_ENTRY_COUNT - 1);
             const vaddress addr_normed = addr & ~page_mask;
 
-            tlb_entry &entry = entries[tlb_index];
+            for (std::size_t i = 0; i < TLB_SET_COUNT; i++) {
+                tlb_entry &entry = sets[i][tlb_index];
 
-            if ((entry.read_addr == addr_normed) || (entry.write_addr == addr_normed) || (entry.execute_addr == addr_normed)) {
-                std::memset(&entry, 0, sizeof(tlb_entry));
+                if ((entry.read_addr == addr_normed) || (entry.write_addr == addr_normed) || (entry.execute_addr == addr_normed)) {
+                    std::memset(&entry, 0, sizeof(tlb_entry));
+                }
             }
         }
 
@@ -124,4 +202,4 @@ namespace eka2l1::arm::r12l1 {
             return nullptr;
         }
     };
-}
\ No newline at end of file
+}
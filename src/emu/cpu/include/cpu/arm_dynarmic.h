@@ -28,12 +28,14 @@
 
 #include <map>
 #include <memory>
+#include <vector>
 
 namespace eka2l1 {
     class ntimer;
 
     namespace arm {
         class dynarmic_core_callback;
+        class dynarmic_core_cp15;
 
         class dynarmic_exclusive_monitor : public exclusive_monitor {
         private:
@@ -61,19 +63,39 @@ namespace eka2l1 {
         class dynarmic_core : public core {
             friend class dynarmic_core_callback;
 
-            std::unique_ptr<Dynarmic::A32::Jit> jit;
+            Dynarmic::A32::Jit *jit; ///< The JIT instance in use, either of the two below.
+            std::unique_ptr<Dynarmic::A32::Jit> tlb_jit;
+
             std::unique_ptr<dynarmic_core_callback> cb;
+            std::shared_ptr<dynarmic_core_cp15> cp15;
+            Dynarmic::ExclusiveMonitor *global_monitor;
+
+            // Fastmem code has the region base built in. The region belongs to the core, and its MMU
+            // remaps it on address space switch, so one instance serves all address spaces.
+            std::unique_ptr<Dynarmic::A32::Jit> fastmem_jit;
+            std::uint8_t *fastmem_base;
 
             arm::dyncom_core interpreter;
             Dynarmic::TLB<9> tlb_obj;
 
+            // Entries of address spaces that are not running. Dynarmic holds a pointer to the
+            // entries of tlb_obj, so switching copies them in and out.
+            std::vector<Dynarmic::TLB<9>> saved_tlbs;
+            std::vector<std::int32_t> saved_tlb_asids;
+            std::vector<std::uint64_t> saved_tlb_last_use;
+
+            std::int32_t tlb_asid;
+            std::uint64_t tlb_use_counter;
+
             std::uint32_t ticks_executed{ 0 };
             std::uint32_t ticks_target{ 0 };
 
             bool interpreter_callback_inited;
 
+            void switch_jit(Dynarmic::A32::Jit *target);
+
         public:
-            explicit dynarmic_core(arm::exclusive_monitor *monitor);
+            explicit dynarmic_core(arm::exclusive_monitor *monitor, const std::size_t core_number = 0);
             ~dynarmic_core() override;
 
             void run(const std::uint32_t instruction_count) override;
@@ -106,6 +128,9 @@ namespace eka2l1 {
             void set_tlb_page(address vaddr, std::uint8_t *ptr, prot protection) override;
             void dirty_tlb_page(address addr) override;
             void flush_tlb() override;
+            void set_tlb_asid(const std::int32_t id) override;
+            void flush_tlb_asid(const std::int32_t id) override;
+            void set_fastmem_base(std::uint8_t *base) override;
 
             void clear_instruction_cache() override;
 
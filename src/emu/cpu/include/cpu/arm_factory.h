@@ -35,9 +35,13 @@ namespace eka2l1 {
          * This factory methods provide various CPU translator backend for you to choose. The CPU must accompanies
          * with other system like kernel or timing, in order to help for emulation.
          * 
+         * \param monitor     The exclusive monitor shared by all cores.
+         * \param arm_type    The translator backend.
+         * \param core_number Index of the core in the exclusive monitor. Must be lower than the monitor's core count.
+         * 
          * \returns An instance to the CPU executor.
          */
-        core_instance create_core(exclusive_monitor *monitor, arm_emulator_type arm_type);
+        core_instance create_core(exclusive_monitor *monitor, arm_emulator_type arm_type, const std::size_t core_number = 0);
 
         exclusive_monitor_instance create_exclusive_monitor(arm_emulator_type arm_type, const std::size_t core_count);
     }
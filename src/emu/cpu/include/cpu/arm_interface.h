@@ -20,8 +20,11 @@
 #pragma once
 
 #include <array>
+#include <cstddef>
 #include <functional>
 #include <memory>
+#include <type_traits>
+#include <vector>
 
 #include <common/types.h>
 
@@ -40,24 +43,94 @@ namespace eka2l1::arm {
 
     using address = std::uint32_t;
 
-    using memory_operation_8bit_func = std::function<bool(address, std::uint8_t *)>;
-    using memory_operation_16bit_func = std::function<bool(address, std::uint16_t *)>;
-    using memory_operation_32bit_func = std::function<bool(address, std::uint32_t *)>;
-    using memory_operation_64bit_func = std::function<bool(address, std::uint64_t *)>;
-    using memory_operation_ew_8bit_func = std::function<std::int32_t(address, std::uint8_t, std::uint8_t)>;
-    using memory_operation_ew_16bit_func = std::function<std::int32_t(address, std::uint16_t, std::uint16_t)>;
-    using memory_operation_ew_32bit_func = std::function<std::int32_t(address, std::uint32_t, std::uint32_t)>;
-    using memory_operation_ew_64bit_func = std::function<std::int32_t(address, std::uint64_t, std::uint64_t)>;
-
-    using memory_read_with_core_8bit_func = std::function<bool(core *, address, std::uint8_t *)>;
-    using memory_read_with_core_16bit_func = std::function<bool(core *, address, std::uint16_t *)>;
-    using memory_read_with_core_32bit_func = std::function<bool(core *, address, std::uint32_t *)>;
-    using memory_read_with_core_64bit_func = std::function<bool(core *, address, std::uint64_t *)>;
-
-    using memory_write_exclusive_with_core_8bit_func = std::function<std::int32_t(core *, address, std::uint8_t, std::uint8_t)>;
-    using memory_write_exclusive_with_core_16bit_func = std::function<std::int32_t(core *, address, std::uint16_t, std::uint16_t)>;
-    using memory_write_exclusive_with_core_32bit_func = std::function<std::int32_t(core *, address, std::uint32_t, std::uint32_t)>;
-    using memory_write_exclusive_with_core_64bit_func = std::function<std::int32_t(core *, address, std::uint64_t, std::uint64_t)>;
+    /**
+     * @brief Describe the start of a block of guest code that has been translated by a backend.
+     *
+     * These are enough for a backend to translate the same block again without executing it.
+     */
+    struct translated_block_info {
+        address addr_;
+        bool thumb_;
+        std::uint32_t fpscr_;
+    };
+
+    /**
+     * @brief A guest instruction as decoded by a backend, with the handler that was picked for it.
+     *
+     * Handler indexes are only valid for the backend and the build that produced them.
+     */
+    struct decoded_inst_info {
+        std::uint32_t word_; ///< Word given to the handler, after any Thumb expansion.
+        std::uint32_t code_; ///< Guest code the instruction was decoded from, little-endian.
+        std::uint16_t handler_; ///< Handler index in the backend's tables.
+        std::uint16_t size_; ///< Size of the guest code taken, in bytes.
+    };
+
+    /**
+     * @brief A block of guest code decoded by a backend, which it can load again without decoding.
+     */
+    struct decoded_block_info {
+        address addr_;
+        bool thumb_;
+        std::vector<decoded_inst_info> insts_;
+    };
+
+    /**
+     * @brief A memory callback bound to a plain function and a context pointer.
+     *
+     * A call costs one direct function pointer call, with no allocation or type erasure, which matters
+     * on the TLB miss and exclusive access paths.
+     */
+    template <typename Signature>
+    class fast_callback;
+
+    template <typename R, typename... Args>
+    class fast_callback<R(Args...)> {
+    public:
+        using bound_function = R (*)(void *userdata, Args... args);
+
+    private:
+        bound_function func_ = nullptr;
+        void *userdata_ = nullptr;
+
+    public:
+        fast_callback() = default;
+
+        fast_callback(std::nullptr_t) {
+        }
+
+        void bind(bound_function func, void *userdata) {
+            func_ = func;
+            userdata_ = userdata;
+        }
+
+        R operator()(Args... args) const {
+            return func_(userdata_, args...);
+        }
+
+        explicit operator bool() const {
+            return func_ != nullptr;
+        }
+    };
+
+    using memory_operation_8bit_func = fast_callback<bool(address, std::uint8_t *)>;
+    using memory_operation_16bit_func = fast_callback<bool(address, std::uint16_t *)>;
+    using memory_operation_32bit_func = fast_callback<bool(address, std::uint32_t *)>;
+    using memory_operation_64bit_func = fast_callback<bool(address, std::uint64_t *)>;
+    using memory_operation_ew_8bit_func = fast_callback<std::int32_t(address, std::uint8_t, std::uint8_t)>;
+    using memory_operation_ew_16bit_func = fast_callback<std::int32_t(address, std::uint16_t, std::uint16_t)>;
+    using memory_operation_ew_32bit_func = fast_callback<std::int32_t(address, std::uint32_t, std::uint32_t)>;
+    using memory_operation_ew_64bit_func = fast_callback<std::int32_t(address, std::uint64_t, std::uint64_t)>;
+
+    using memory_read_with_core_8bit_func = fast_callback<bool(core *, address, std::uint8_t *)>;
+    using memory_read_with_core_16bit_func = fast_callback<bool(core *, address, std::uint16_t *)>;
+    using memory_read_with_core_32bit_func = fast_callback<bool(core *, address, std::uint32_t *)>;
+    using memory_read_with_core_64bit_func = fast_callback<bool(core *, address, std::uint64_t *)>;
+
+    using memory_write_exclusive_with_core_8bit_func = fast_callback<std::int32_t(core *, address, std::uint8_t, std::uint8_t)>;
+    using memory_write_exclusive_with_core_16bit_func = fast_callback<std::int32_t(core *, address, std::uint16_t, std::uint16_t)>;
+    using memory_write_exclusive_with_core_32bit_func = fast_callback<std::int32_t(core *, address, std::uint32_t, std::uint32_t)>;
+    using memory_write_exclusive_with_core_64bit_func = fast_callback<std::int32_t(core *, address, std::uint64_t, std::uint64_t)>;
 
     using system_call_handler_func = std::function<void(const std::uint32_t)>;
     using handle_exception_func = std::function<bool(exception_type, const std::uint32_t)>;
@@ -193,6 +266,40 @@ namespace eka2l1::arm {
         virtual void dirty_tlb_page(const address addr) = 0;
         virtual void flush_tlb() = 0;
 
+        /**
+         * @brief Switch the TLB to the entries of an address space.
+         *
+         * Backends that can keep entries of multiple address spaces around switch to the set of
+         * the given ID, so that entries are still valid when the address space runs again. Others
+         * simply flush the TLB.
+         *
+         * @param id The ID of the address space that is about to run.
+         */
+        virtual void set_tlb_asid(const std::int32_t id) {
+            flush_tlb();
+        }
+
+        /**
+         * @brief Drop all TLB entries kept for an address space.
+         *
+         * Must be called when an address space ID is given to a new address space.
+         */
+        virtual void flush_tlb_asid(const std::int32_t id) {
+            flush_tlb();
+        }
+
+        /**
+         * @brief Give the host region where the running address space is mirrored, for fastmem.
+         *
+         * Backends that support it load and store at base + address directly, and go through the
+         * memory callbacks when such access faults. The MMU of the core keeps the region in sync with
+         * the running address space, so this is only called again if the region itself changes.
+         *
+         * @param base Start of the 4 GiB region. Null to go through the TLB.
+         */
+        virtual void set_fastmem_base(std::uint8_t *base) {
+        }
+
         virtual void clear_instruction_cache() = 0;
         virtual void imb_range(address addr, std::size_t size) = 0;
 
@@ -201,5 +308,101 @@ namespace eka2l1::arm {
         }
 
         virtual std::uint32_t get_num_instruction_executed() = 0;
+
+        /**
+         * @brief Check if the backend can translate code without running it.
+         *
+         * Backends that can implement precompile_block and set_translate_on_entry, and may translate
+         * on another thread while they are not running.
+         */
+        virtual bool can_translate_ahead() const {
+            return false;
+        }
+
+        /**
+         * @brief Set if blocks that are not translated yet are translated when reached.
+         *
+         * When disabled, a run stops at the first block which is not translated, with the PC at its start.
+         * Only backends that can translate ahead of time support disabling it.
+         */
+        virtual void set_translate_on_entry(const bool enable) {
+        }
+
+        /**
+         * @brief Check if the backend can translate blocks on a worker thread, while it runs code.
+         */
+        virtual bool can_translate_in_background() const {
+            return false;
+        }
+
+        /**
+         * @brief Queue blocks to be translated on the worker thread, without waiting for them.
+         *
+         * Only supported by backends that can translate in background.
+         *
+         * @param code_base Guest address of the code the blocks are in.
+         * @param code      Host copy of the code. Not used after the call returns.
+         * @param code_size Size of the code in bytes.
+         * @param blocks    The blocks to translate.
+         *
+         * @returns Number of blocks queued.
+         */
+        virtual std::size_t queue_precompile_blocks(const address code_base, const std::uint8_t *code, const std::size_t code_size,
+            const std::vector<translated_block_info> &blocks) {
+            return 0;
+        }
+
+        /**
+         * @brief Translate a block of code ahead of time, if the backend supports it.
+         *
+         * @param addr      Start address of the block.
+         * @param thumb     True if the block should be decoded as Thumb.
+         * @param fpscr     FPSCR value the block is expected to run with.
+         *
+         * @returns True if the block is now translated.
+         */
+        virtual bool precompile_block(const address addr, const bool thumb, const std::uint32_t fpscr) {
+            return false;
+        }
+
+        /**
+         * @brief Collect all translated blocks which starts in the given address range.
+         * @returns Number of blocks added to the list.
+         */
+        virtual std::size_t collect_translated_blocks(const address start, const address end, std::vector<translated_block_info> &blocks) {
+            return 0;
+        }
+
+        /**
+         * @brief Check if the backend can export its decoded blocks, and import them in a later run.
+         */
+        virtual bool can_import_decoded_blocks() const {
+            return false;
+        }
+
+        /**
+         * @brief Export decoded blocks which start in the given address range.
+         * @returns Number of blocks added to the list.
+         */
+        virtual std::size_t export_decoded_blocks(const address start, const address end, std::vector<decoded_block_info> &blocks) {
+            return 0;
+        }
+
+        /**
+         * @brief Load decoded blocks, so that they run without being decoded again.
+         *
+         * Blocks whose recorded code does not match the given code are skipped.
+         *
+         * @param code_base Guest address of the code the blocks are in.
+         * @param code      Host copy of the code.
+         * @param code_size Size of the code in bytes.
+         * @param blocks    The blocks to load.
+         *
+         * @returns Number of blocks loaded.
+         */
+        virtual std::size_t import_decoded_blocks(const address code_base, const std::uint8_t *code, const std::size_t code_size,
+            const std::vector<decoded_block_info> &blocks) {
+            return 0;
+        }
     };
 }
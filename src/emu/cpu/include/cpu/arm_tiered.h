@@ -0,0 +1,209 @@
+/*
+ * Copyright (c) 2022 EKA2L1 Team.
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cpu/arm_interface.h>
+#include <cpu/dyncom/arm_dyncom.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+namespace eka2l1::arm {
+    /**
+     * @brief Forward exclusive accesses of an inner core as if the outer core did them.
+     *
+     * The memory system looks up the address space by the core that does the access, which
+     * must be the core it knows about.
+     */
+    class forward_exclusive_monitor : public exclusive_monitor {
+        exclusive_monitor *target_;
+        core *owner_;
+
+    public:
+        explicit forward_exclusive_monitor(exclusive_monitor *target, core *owner);
+
+        std::uint8_t exclusive_read8(core *cc, address vaddr) override;
+        std::uint16_t exclusive_read16(core *cc, address vaddr) override;
+        std::uint32_t exclusive_read32(core *cc, address vaddr) override;
+        std::uint64_t exclusive_read64(core *cc, address vaddr) override;
+        void clear_exclusive() override;
+
+        bool exclusive_write8(core *cc, address vaddr, std::uint8_t value) override;
+        bool exclusive_write16(core *cc, address vaddr, std::uint16_t value) override;
+        bool exclusive_write32(core *cc, address vaddr, std::uint32_t value) override;
+        bool exclusive_write64(core *cc, address vaddr, std::uint64_t value) override;
+    };
+
+    /**
+     * @brief A core which starts running code in the interpreter, and moves hot code to the JIT.
+     *
+     * Every block entry is counted by the interpreter. Once a block reaches the hot threshold, its code
+     * is snapshotted and sent to a worker thread, which translates it on the JIT core while the
+     * interpreter keeps running. When the translation is done the interpreter stops at the next entry
+     * of that block, and the JIT runs from there until it reaches a block that is not translated yet.
+     *
+     * The JIT must be able to translate ahead of time, without translating cold code on entry. Only 12l1r
+     * can, so tiering is only available on 32-bit ARM hosts. Dynarmic translates a block when it first runs
+     * it, and has no entry point to translate without running. With any other backend, everything is
+     * interpreted and no worker thread is started.
+     */
+    class tiered_core : public core {
+    private:
+        struct compile_request {
+            address block_key_;
+            std::uint32_t fpscr_;
+            std::uint32_t generation_;
+
+            // Shared by all blocks queued from the same code
+            address snapshot_base_;
+            std::shared_ptr<const std::vector<std::uint32_t>> snapshot_;
+        };
+
+        std::unique_ptr<forward_exclusive_monitor> interpreter_monitor_;
+        std::unique_ptr<dyncom_core> interpreter_;
+        std::unique_ptr<core> jit_;
+
+        core *active_;
+        std::size_t page_bits_;
+        std::uint32_t hot_block_threshold_;
+
+        std::thread compile_thread_;
+        std::mutex jit_lock_; ///< Guards the translation cache of the JIT. Never waited on to run code.
+        std::mutex queue_lock_;
+        std::condition_variable queue_cond_;
+
+        std::queue<compile_request> compile_queue_;
+        std::vector<address> ready_blocks_;
+        std::vector<address> rejected_blocks_;
+        std::unordered_set<address> compiled_blocks_;
+
+        std::atomic<std::uint32_t> generation_;
+        std::atomic<bool> compile_thread_should_stop_;
+        bool stop_requested_;
+        std::atomic<std::thread::id> jit_runner_; ///< Thread running code on the JIT, with the JIT lock held.
+
+        std::uint32_t last_interpreted_;
+        std::uint32_t last_compiled_;
+
+        std::uint64_t total_interpreted_;
+        std::uint64_t total_compiled_;
+        std::uint64_t total_hot_blocks_;
+
+        static bool read_snapshot_code(void *userdata, address addr, std::uint32_t *data);
+        void compile_thread_loop();
+
+        void queue_hot_blocks();
+        void drain_ready_blocks();
+
+        std::unique_lock<std::mutex> lock_jit();
+        void switch_to(core *target);
+        void forget_compiled_blocks(const address addr, const std::size_t size);
+
+    public:
+        explicit tiered_core(exclusive_monitor *monitor, const arm_emulator_type jit_type, const std::size_t page_bits,
+            const std::size_t core_number = 0);
+        ~tiered_core() override;
+
+        /**
+         * @brief Set the number of entries after which a block is sent to the JIT.
+         */
+        void set_hot_block_threshold(const std::uint32_t threshold);
+
+        void run(const std::uint32_t instruction_count) override;
+        void stop() override;
+        void step() override;
+
+        std::uint32_t get_reg(size_t idx) override;
+        std::uint32_t get_sp() override;
+        std::uint32_t get_pc() override;
+        std::uint32_t get_vfp(size_t idx) override;
+
+        void set_reg(size_t idx, std::uint32_t val) override;
+        void set_pc(std::uint32_t val) override;
+        void set_sp(std::uint32_t val) override;
+        void set_lr(std::uint32_t val) override;
+        void set_vfp(size_t idx, std::uint32_t val) override;
+
+        std::uint32_t get_cpsr() override;
+        std::uint32_t get_fpscr() override;
+        std::uint32_t get_lr() override;
+        void set_cpsr(std::uint32_t val) override;
+        void set_fpscr(std::uint32_t val) override;
+
+        void save_context(thread_context &ctx) override;
+        void load_context(const thread_context &ctx) override;
+
+        bool is_thumb_mode() override;
+
+        void set_tlb_page(address vaddr, std::uint8_t *ptr, prot protection) override;
+        void dirty_tlb_page(address addr) override;
+        void flush_tlb() override;
+        void set_tlb_asid(const std::int32_t id) override;
+        void flush_tlb_asid(const std::int32_t id) override;
+        void set_fastmem_base(std::uint8_t *base) override;
+
+        void clear_instruction_cache() override;
+        void imb_range(address addr, std::size_t size) override;
+
+        bool should_clear_old_memory_map() const override {
+            return jit_ && jit_->should_clear_old_memory_map();
+        }
+
+        /**
+         * @brief Get the number of instructions executed by the last run, on both tiers.
+         */
+        std::uint32_t get_num_instruction_executed() override;
+
+        std::uint32_t get_num_instruction_interpreted() const {
+            return last_interpreted_;
+        }
+
+        std::uint32_t get_num_instruction_compiled() const {
+            return last_compiled_;
+        }
+
+        bool can_translate_ahead() const override {
+            return jit_ != nullptr;
+        }
+
+        bool can_translate_in_background() const override {
+            return jit_ != nullptr;
+        }
+
+        bool precompile_block(const address addr, const bool thumb, const std::uint32_t fpscr) override;
+        std::size_t queue_precompile_blocks(const address code_base, const std::uint8_t *code, const std::size_t code_size,
+            const std::vector<translated_block_info> &blocks) override;
+        std::size_t collect_translated_blocks(const address start, const address end, std::vector<translated_block_info> &blocks) override;
+
+        bool can_import_decoded_blocks() const override {
+            return true;
+        }
+
+        std::size_t export_decoded_blocks(const address start, const address end, std::vector<decoded_block_info> &blocks) override;
+        std::size_t import_decoded_blocks(const address code_base, const std::uint8_t *code, const std::size_t code_size,
+            const std::vector<decoded_block_info> &blocks) override;
+    };
+}
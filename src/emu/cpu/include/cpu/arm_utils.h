@@ -28,11 +28,13 @@ namespace eka2l1::arm {
     static constexpr const char *unicorn_jit_backend_name = "unicorn"; ///< Unicorn recompiler backend name
     static constexpr const char *r12l1_jit_backend_name = "r12l1"; ///< EKA2L1's ARM recompiler backend name
     static constexpr const char *dyncom_jit_backend_name = "dyncom"; ///< Citra's ARM interpreter, repurposed for EKA2L1
+    static constexpr const char *tiered_jit_backend_name = "tiered"; ///< Interpreter first, hot code moved to the recompiler
 
     static constexpr const char *dynarmic_jit_backend_formal_name = "Dynarmic"; ///< Dynarmic recompiler backend name
     static constexpr const char *unicorn_jit_backend_formal_name = "Unicorn"; ///< Unicorn recompiler backend name
     static constexpr const char *r12l1_jit_backend_formal_name = "r12l1"; ///< EKA2L1's ARM recompiler backend name
     static constexpr const char *dyncom_jit_backend_formal_name = "Dyncom"; ///< Citra's ARM interpreter, repurposed for EKA2L1
+    static constexpr const char *tiered_jit_backend_formal_name = "Tiered"; ///< Interpreter first, hot code moved to the recompiler
 
     /**
      * \brief Dump the given thread context to log.
@@ -62,6 +62,8 @@ namespace eka2l1::arm {
         void set_tlb_page(address vaddr, std::uint8_t *ptr, prot protection) override;
         void dirty_tlb_page(address addr) override;
         void flush_tlb() override;
+        void set_tlb_asid(const std::int32_t id) override;
+        void flush_tlb_asid(const std::int32_t id) override;
 
         void clear_instruction_cache() override;
 
@@ -72,5 +74,36 @@ namespace eka2l1::arm {
         bool should_clear_old_memory_map() const override {
             return false;
         }
+
+        bool can_import_decoded_blocks() const override {
+            return true;
+        }
+
+        std::size_t export_decoded_blocks(const address start, const address end, std::vector<decoded_block_info> &blocks) override;
+        std::size_t import_decoded_blocks(const address code_base, const std::uint8_t *code, const std::size_t code_size,
+            const std::vector<decoded_block_info> &blocks) override;
+
+        /**
+         * @brief Set the number of entries a block needs before it is reported as hot.
+         * @param threshold     The threshold. Zero disables block profiling.
+         */
+        void set_hot_block_threshold(const std::uint32_t threshold);
+
+        /**
+         * @brief Take all blocks that became hot since the last call.
+         * @returns Block addresses, with bit 0 set for Thumb blocks.
+         */
+        std::vector<address> take_hot_blocks();
+
+        /**
+         * @brief Stop execution at the next entry of a block, so it can be run elsewhere.
+         * @param block_key     Block address, with bit 0 set for Thumb.
+         */
+        void add_handover_block(const address block_key);
+
+        /**
+         * @brief Forget profiling and handover state of blocks in the given range.
+         */
+        void forget_blocks(const address addr, const std::size_t size);
     };
 }
\ No newline at end of file
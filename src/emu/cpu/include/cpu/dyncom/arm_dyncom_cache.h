@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2022 EKA2L1 Team.
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <common/types.h>
+#include <cpu/arm_interface.h>
+
+#include <array>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace eka2l1::arm {
+    /**
+     * @brief Map of guest blocks to their decoded instructions in the translation buffer.
+     *
+     * Keys are block addresses with bit 0 set for Thumb. A direct-mapped table sits in front of the
+     * hash map, so most lookups at block dispatch are a single compare. Blocks are also indexed by
+     * the guest pages they cover, so that a code change only drops the blocks it overlaps.
+     */
+    class dyncom_block_cache {
+    public:
+        static constexpr std::size_t NOT_FOUND = static_cast<std::size_t>(-1);
+
+    private:
+        static constexpr std::size_t FAST_LOOKUP_BITS = 12;
+        static constexpr std::size_t FAST_LOOKUP_SIZE = 1 << FAST_LOOKUP_BITS;
+        static constexpr std::uint32_t PAGE_BITS = 12;
+
+        // Ranges larger than this are invalidated by walking all blocks instead of the page index
+        static constexpr std::uint64_t MAX_PAGE_WALK = 256;
+
+        struct block_info {
+            address start_;
+            address end_;
+            std::size_t offset_;
+            std::vector<decoded_inst_info> insts_;
+        };
+
+        struct fast_lookup_entry {
+            std::uint32_t key_ = 0;
+            std::size_t offset_ = NOT_FOUND;
+        };
+
+        std::array<fast_lookup_entry, FAST_LOOKUP_SIZE> fast_lookup_;
+        std::unordered_map<std::uint32_t, block_info> blocks_;
+        std::unordered_map<std::uint32_t, std::vector<std::uint32_t>> page_blocks_;
+
+        static std::size_t fast_lookup_index(const std::uint32_t key) {
+            return (key >> 1) & (FAST_LOOKUP_SIZE - 1);
+        }
+
+        std::size_t find_slow(const std::uint32_t key);
+        void drop(const std::uint32_t key);
+
+    public:
+        /**
+         * @brief Get the translation buffer offset of a block.
+         *
+         * @param key Block address, with bit 0 set for Thumb.
+         * @returns Offset of the first decoded instruction, or NOT_FOUND.
+         */
+        std::size_t find(const std::uint32_t key) {
+            const fast_lookup_entry &entry = fast_lookup_[fast_lookup_index(key)];
+
+            if ((entry.key_ == key) && (entry.offset_ != NOT_FOUND)) {
+                return entry.offset_;
+            }
+
+            return find_slow(key);
+        }
+
+        /**
+         * @brief Add a translated block.
+         *
+         * @param key    Block address, with bit 0 set for Thumb.
+         * @param end    Address after the last guest instruction of the block.
+         * @param offset Offset of the first decoded instruction in the translation buffer.
+         * @param insts  How each instruction of the block was decoded.
+         */
+        void add(const std::uint32_t key, const address end, const std::size_t offset, std::vector<decoded_inst_info> insts = {});
+
+        /**
+         * @brief Export all blocks which start in the given guest range.
+         * @returns Number of blocks added to the list.
+         */
+        std::size_t export_blocks(const address start, const address end, std::vector<decoded_block_info> &blocks) const;
+
+        /**
+         * @brief Drop all blocks that overlap the given guest range.
+         *
+         * @returns The number of blocks dropped.
+         */
+        std::size_t invalidate(const address addr, const std::size_t size);
+
+        void clear();
+
+        std::size_t size() const {
+            return blocks_.size();
+        }
+    };
+}
@@ -4,6 +4,16 @@
 
 #pragma once
 
+#include <cpu/arm_interface.h>
+
+#include <cstdint>
+#include <vector>
+
 struct ARMul_State;
 
 unsigned InterpreterMainLoop(ARMul_State *state, std::uint32_t &num_instrs);
+
+// Rebuilds a block from how it was decoded before, without reading or decoding guest code. Returns false
+// if the block is already translated, the translation buffer is full or the instructions do not form a block.
+bool InterpreterLoadBlock(ARMul_State *state, const std::uint32_t addr, const bool thumb,
+    const std::vector<eka2l1::arm::decoded_inst_info> &insts);
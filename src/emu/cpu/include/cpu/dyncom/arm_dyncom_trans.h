@@ -468,6 +468,22 @@ struct blx_1_thumb {
     unsigned int instr;
 };
 
+// Fused Thumb idioms. The register lists are ARM style, with LR and PC at bit 14 and 15.
+struct push_pop_thumb {
+    unsigned int reg_list;
+    unsigned int count;
+};
+struct ldr_lit_thumb {
+    unsigned int Rd;
+    unsigned int addr;
+};
+struct cmp_b_cond_thumb {
+    unsigned int Rn;
+    unsigned int imm;
+    unsigned int cond;
+    unsigned int branch_imm;
+};
+
 struct pkh_inst {
     unsigned int Rm;
     unsigned int Rn;
@@ -492,3 +508,17 @@ typedef ARM_INST_PTR (*transop_fp_t)(ARMul_State *, unsigned int, int);
 
 extern const transop_fp_t arm_instruction_trans[];
 extern const std::size_t arm_instruction_trans_len;
+
+// Thumb idioms that get their own handler instead of the generic ARM one. Their handler index
+// follows the last entry of arm_instruction_trans. Translators also get the instruction address.
+typedef ARM_INST_PTR (*thumb_fused_transop_fp_t)(ARMul_State *, unsigned int, std::uint32_t, int);
+
+enum class ThumbFusedOp {
+    PUSH,
+    POP,
+    LDR_LITERAL,
+    CMP_BRANCH,
+    COUNT
+};
+
+extern const thumb_fused_transop_fp_t thumb_fused_trans[];
@@ -20,7 +20,10 @@
 #include <array>
 #include <common/types.h>
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
+#include <cpu/dyncom/arm_dyncom_cache.h>
 #include <cpu/dyncom/arm_regformat.h>
 
 namespace eka2l1::arm {
@@ -31,6 +34,10 @@ namespace eka2l1::arm {
 
 #define TRANS_CACHE_SIZE (64 * 1024 * 2000)
 
+// Space that must be left in the translation buffer before a block is translated. A block stops at
+// the end of a page, so it never takes more than this.
+#define TRANS_CACHE_FLUSH_MARGIN (1024 * 1024)
+
 // Signal levels
 enum { LOW = 0,
     HIGH = 1,
@@ -241,9 +248,18 @@ public:
     char trans_cache_buf[TRANS_CACHE_SIZE];
     size_t trans_cache_buf_top = 0;
 
-    // TODO(bunnei): Move this cache to a better place - it should be per codeset (likely per
-    // process for our purposes), not per ARMul_State (which tracks CPU core state).
-    std::unordered_map<std::uint32_t, std::size_t> instruction_cache;
+    // Translated blocks. Guest code addresses are global, so the cache lives across thread switches
+    // and is only invalidated when code changes.
+    eka2l1::arm::dyncom_block_cache block_cache;
+
+    // Block profiling for tiered execution. Keys are block addresses, with bit 0 set for Thumb.
+    // Disabled when the threshold is zero.
+    std::uint32_t hot_block_threshold = 0;
+    std::unordered_map<std::uint32_t, std::uint32_t> block_hits;
+    std::vector<std::uint32_t> hot_blocks;
+
+    // Blocks that another core can run. Execution stops when one of these is reached.
+    std::unordered_set<std::uint32_t> handover_blocks;
 
 private:
     void ResetMPCoreCP15Registers();
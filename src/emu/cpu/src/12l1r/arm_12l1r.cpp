@@ -166,6 +166,17 @@ namespace eka2l1::arm {
         mem_cache_.flush();
     }
 
+    void r12l1_core::set_tlb_asid(const std::int32_t id) {
+        if (mem_cache_.switch_asid(id)) {
+            // Generated code loads the entries pointer from the state
+            jit_state_.entries_ = mem_cache_.entries;
+        }
+    }
+
+    void r12l1_core::flush_tlb_asid(const std::int32_t id) {
+        mem_cache_.flush_asid(id);
+    }
+
     void r12l1_core::clear_instruction_cache() {
         big_block_->flush_all();
     }
@@ -177,4 +188,44 @@ namespace eka2l1::arm {
     std::uint32_t r12l1_core::get_num_instruction_executed() {
         return target_ticks_run_ - jit_state_.ticks_left_;
     }
-}
\ No newline at end of file
+
+    void r12l1_core::set_translate_on_entry(const bool enable) {
+        big_block_->set_translate_on_entry(enable);
+    }
+
+    bool r12l1_core::precompile_block(const address addr, const bool thumb, const std::uint32_t fpscr) {
+        if (big_block_->get_block(addr)) {
+            return true;
+        }
+
+        // This may be called while guest code is waiting for a kernel call to return. Never let
+        // the cache reset itself under the running block.
+        if (big_block_->get_space_left() <= r12l1::THRESHOLD_LEFT_TO_RESET_CACHE * 2) {
+            return false;
+        }
+
+        // Do not leave an empty block in the cache if the code is not mapped yet
+        std::uint32_t first_inst = 0;
+        if (!read_code(addr & ~3, &first_inst)) {
+            return false;
+        }
+
+        // Translation only needs the mode and FPSCR. Do not read the running state, this may be called
+        // from another thread.
+        r12l1::core_state temp_state;
+        temp_state.cpsr_ = thumb ? 0x20 : 0;
+        temp_state.fpscr_ = fpscr;
+
+        return big_block_->compile_new_block(&temp_state, addr) != nullptr;
+    }
+
+    std::size_t r12l1_core::collect_translated_blocks(const address start, const address end, std::vector<translated_block_info> &blocks) {
+        const std::vector<r12l1::translated_block *> translated = big_block_->get_block_cache().blocks_in_range(start, end);
+
+        for (r12l1::translated_block *block : translated) {
+            blocks.push_back({ block->start_address(), block->thumb_, block->fpscr_ });
+        }
+
+        return translated.size();
+    }
+}
@@ -54,7 +54,8 @@ namespace eka2l1::arm::r12l1 {
         , translated_code_(nullptr)
         , translated_size_(0)
         , inst_count_(0)
-        , thumb_(false) {
+        , thumb_(false)
+        , fpscr_(0) {
     }
 
     block_cache::block_cache()
@@ -84,6 +85,19 @@ namespace eka2l1::arm::r12l1 {
         return nullptr;
     }
 
+    void block_cache::remove_block(const vaddress start_addr) {
+        auto bl_res = blocks_.find(start_addr);
+        if (bl_res == blocks_.end()) {
+            return;
+        }
+
+        if (invalidate_callback_) {
+            invalidate_callback_(bl_res->second.get());
+        }
+
+        blocks_.erase(bl_res);
+    }
+
     void block_cache::flush_range(const vaddress range_start, const vaddress range_end) {
         // From JitBlockCache.cpp in PPSSPP!
         do {
@@ -111,6 +125,16 @@ namespace eka2l1::arm::r12l1 {
         } while (false);
     }
 
+    std::vector<translated_block *> block_cache::blocks_in_range(const vaddress range_start, const vaddress range_end) {
+        std::vector<translated_block *> result;
+
+        for (auto ite = blocks_.lower_bound(range_start); (ite != blocks_.end()) && (ite->first < range_end); ite++) {
+            result.push_back(ite->second.get());
+        }
+
+        return result;
+    }
+
     void block_cache::flush_all() {
         // Just clear all of it
         blocks_.clear();
@@ -43,6 +43,11 @@ namespace eka2l1::arm::r12l1 {
     }
 
     static translated_block *dashixiong_compile_new_block_proxy(dashixiong_block *self, core_state *state, const vaddress addr) {
+        // Breaks out of the dispatch with the PC still at the block
+        if (self->config_flags() & dashixiong_block::FLAG_NO_TRANSLATE_ON_ENTRY) {
+            return nullptr;
+        }
+
         return self->compile_new_block(state, addr);
     }
 
@@ -710,6 +715,7 @@ namespace eka2l1::arm::r12l1 {
         bool should_continue = false;
 
         block->thumb_ = is_thumb;
+        block->fpscr_ = state->fpscr_;
         current_fpscr_ = state->fpscr_;
 
         // LOG_TRACE(CPU_12L1R, "Compiling new block PC=0x{:X}, host=0x{:X}, thumb={}", addr,
@@ -762,6 +768,10 @@ namespace eka2l1::arm::r12l1 {
 
                 if (!read_res) {
                     LOG_ERROR(CPU_12L1R, "Error while reading instruction at address 0x{:X}!", addr);
+
+                    end_write();
+                    cache_.remove_block(addr);
+
                     return nullptr;
                 }
 
@@ -770,6 +780,10 @@ namespace eka2l1::arm::r12l1 {
             } else {
                 if (!parent_->read_code(addr + block->size_, &inst)) {
                     LOG_ERROR(CPU_12L1R, "Error while reading instruction at address 0x{:X}!", addr);
+
+                    end_write();
+                    cache_.remove_block(addr);
+
                     return nullptr;
                 }
 
@@ -819,38 +833,51 @@ namespace eka2l1::arm::r12l1 {
     }
 
 #if R12L1_ENABLE_FUZZ
+    template <typename T>
+    bool dashixiong_block::fuzz_monitor_read(void *userdata, core *cc, address addr, T *data) {
+        dashixiong_block *self = static_cast<dashixiong_block *>(userdata);
+        exclusive_monitor *monitor = self->parent_->monitor_;
+
+        if constexpr (sizeof(T) == 1) {
+            return monitor->read_8bit(self->parent_, addr, data);
+        } else if constexpr (sizeof(T) == 2) {
+            return monitor->read_16bit(self->parent_, addr, data);
+        } else if constexpr (sizeof(T) == 4) {
+            return monitor->read_32bit(self->parent_, addr, data);
+        } else {
+            return monitor->read_64bit(self->parent_, addr, data);
+        }
+    }
+
+    template <typename T>
+    std::int32_t dashixiong_block::fuzz_monitor_write(void *userdata, core *cc, address addr, T value, T expected) {
+        dashixiong_block *self = static_cast<dashixiong_block *>(userdata);
+        exclusive_monitor *monitor = self->parent_->monitor_;
+
+        if constexpr (sizeof(T) == 1) {
+            return monitor->write_8bit(self->parent_, addr, value, expected);
+        } else if constexpr (sizeof(T) == 2) {
+            return monitor->write_16bit(self->parent_, addr, value, expected);
+        } else if constexpr (sizeof(T) == 4) {
+            return monitor->write_32bit(self->parent_, addr, value, expected);
+        } else {
+            return monitor->write_64bit(self->parent_, addr, value, expected);
+        }
+    }
+
     void dashixiong_block::fuzz_start() {
         if (!(flags_ & FLAG_ENABLE_FUZZ)) {
             if (!interpreter_) {
                 interpreter_monitor_ = std::make_unique<exclusive_monitor>(parent_->monitor_->get_processor_count());
-                interpreter_monitor_->read_8bit = [this](core *cc, address addr, std::uint8_t *dat) {
-                    return parent_->monitor_->read_8bit(parent_, addr, dat);
-                };
-
-                interpreter_monitor_->read_16bit = [this](core *cc, address addr, std::uint16_t *dat) {
-                    return parent_->monitor_->read_16bit(parent_, addr, dat);
-                };
-
-                interpreter_monitor_->read_32bit = [this](core *cc, address addr, std::uint32_t *dat) {
-                    return parent_->monitor_->read_32bit(parent_, addr, dat);
-                };
-
-                interpreter_monitor_->read_64bit = [this](core *cc, address addr, std::uint64_t *dat) {
-                    return parent_->monitor_->read_64bit(parent_, addr, dat);
-                };
-
-                interpreter_monitor_->write_8bit = [&](core *cc, address addr, std::uint8_t v1, std::uint8_t v2) -> std::int32_t {
-                    return parent_->monitor_->write_8bit(parent_, addr, v1, v2);
-                };
-                interpreter_monitor_->write_16bit = [&](core *cc, address addr, std::uint16_t v1, std::uint16_t v2) -> std::int32_t {
-                    return parent_->monitor_->write_16bit(parent_, addr, v1, v2);
-                };
-                interpreter_monitor_->write_32bit = [&](core *cc, address addr, std::uint32_t v1, std::uint32_t v2) -> std::int32_t {
-                    return parent_->monitor_->write_32bit(parent_, addr, v1, v2);
-                };
-                interpreter_monitor_->write_64bit = [&](core *cc, address addr, std::uint64_t v1, std::uint64_t v2) -> std::int32_t {
-                    return parent_->monitor_->write_64bit(parent_, addr, v1, v2);
-                };
+                interpreter_monitor_->read_8bit.bind(fuzz_monitor_read<std::uint8_t>, this);
+                interpreter_monitor_->read_16bit.bind(fuzz_monitor_read<std::uint16_t>, this);
+                interpreter_monitor_->read_32bit.bind(fuzz_monitor_read<std::uint32_t>, this);
+                interpreter_monitor_->read_64bit.bind(fuzz_monitor_read<std::uint64_t>, this);
+
+                interpreter_monitor_->write_8bit.bind(fuzz_monitor_write<std::uint8_t>, this);
+                interpreter_monitor_->write_16bit.bind(fuzz_monitor_write<std::uint16_t>, this);
+                interpreter_monitor_->write_32bit.bind(fuzz_monitor_write<std::uint32_t>, this);
+                interpreter_monitor_->write_64bit.bind(fuzz_monitor_write<std::uint64_t>, this);
 
                 interpreter_ = std::make_unique<dyncom_core>(interpreter_monitor_.get(), parent_->mem_cache_.page_bits);
                 dyncom_core *interpreter_ptr = interpreter_.get();
@@ -28,163 +28,97 @@ namespace eka2l1::arm {
         return result;
     }
 
-    std::unique_ptr<r12l1_core> make_test_cpu(test_env &environment) {
-        std::unique_ptr<r12l1_core> core = std::make_unique<r12l1_core>(&environment.monitor_, 12);
-        test_env *environment_ptr = &environment;
+    template <typename Env>
+    static bool read_env_code(void *userdata, const address addr, std::uint32_t *result) {
+        Env *environment = static_cast<Env *>(userdata);
+        *result = *reinterpret_cast<std::uint32_t *>(reinterpret_cast<std::uint8_t *>(environment->code_.data()) + addr);
 
-        core->set_reg(13, static_cast<std::uint32_t>(environment.stack_.size()));
+        return true;
+    }
+
+    // Data is read from the code and written to the stack
+    template <typename T>
+    static bool read_env_data(void *userdata, const address addr, T *result) {
+        test_env *environment = static_cast<test_env *>(userdata);
+        *result = *reinterpret_cast<T *>(reinterpret_cast<std::uint8_t *>(environment->code_.data()) + addr);
+
+        return true;
+    }
+
+    template <typename T>
+    static bool write_env_data(void *userdata, const address addr, T *result) {
+        test_env *environment = static_cast<test_env *>(userdata);
+        *reinterpret_cast<T *>(reinterpret_cast<std::uint8_t *>(environment->stack_.data()) + addr) = *result;
+
+        return true;
+    }
 
-        core->read_code = [environment_ptr](const address addr, std::uint32_t *result) {
-            std::uint32_t *data = reinterpret_cast<std::uint32_t*>(
-                    reinterpret_cast<std::uint8_t*>(environment_ptr->code_.data()) + addr);
+    template <typename T>
+    static bool read_env_tlb_data(void *userdata, const address addr, T *result) {
+        test_env_tlb *environment = static_cast<test_env_tlb *>(userdata);
+        std::uint8_t *data_ptr = environment->pointer(addr);
 
-            *result = *data;
-            return true;
-        };
+        if (!data_ptr) {
+            return false;
+        }
 
-        core->read_8bit =  [environment_ptr](const address addr, std::uint8_t *result) {
-            *result = *(reinterpret_cast<std::uint8_t*>(environment_ptr->code_.data()) + addr);
-            return true;
-        };
+        *result = *reinterpret_cast<T *>(data_ptr);
+        environment->core_->set_tlb_page(addr, data_ptr, prot_read_write);
 
-        core->write_8bit =  [environment_ptr](const address addr, std::uint8_t *result) {
-            *(reinterpret_cast<std::uint8_t*>(environment_ptr->stack_.data()) + addr) = *result;
-            return true;
-        };
+        return true;
+    }
 
-        core->read_16bit =  [environment_ptr](const address addr, std::uint16_t *result) {
-            *result = *reinterpret_cast<std::uint16_t*>
-                (reinterpret_cast<std::uint8_t*>(environment_ptr->code_.data()) + addr);
+    template <typename T>
+    static bool write_env_tlb_data(void *userdata, const address addr, T *result) {
+        test_env_tlb *environment = static_cast<test_env_tlb *>(userdata);
+        std::uint8_t *data_ptr = environment->pointer(addr);
 
-            return true;
-        };
+        if (!data_ptr) {
+            return false;
+        }
 
-        core->write_16bit =  [environment_ptr](const address addr, std::uint16_t *result) {
-            *(reinterpret_cast<std::uint16_t*>(reinterpret_cast<std::uint8_t*>(environment_ptr->stack_.data()) + addr)) = *result;
-            return true;
-        };
+        *reinterpret_cast<T *>(data_ptr) = *result;
+        environment->core_->set_tlb_page(addr, data_ptr, prot_read_write);
 
-        core->read_32bit =  [environment_ptr](const address addr, std::uint32_t *result) {
-            *result = *reinterpret_cast<std::uint32_t*>
-                (reinterpret_cast<std::uint8_t*>(environment_ptr->code_.data()) + addr);
+        return true;
+    }
 
-            return true;
-        };
+    std::unique_ptr<r12l1_core> make_test_cpu(test_env &environment) {
+        std::unique_ptr<r12l1_core> core = std::make_unique<r12l1_core>(&environment.monitor_, 12);
 
-        core->write_32bit =  [environment_ptr](const address addr, std::uint32_t *result) {
-            *(reinterpret_cast<std::uint32_t*>(reinterpret_cast<std::uint8_t*>(environment_ptr->stack_.data()) + addr)) = *result;
-            return true;
-        };
+        core->set_reg(13, static_cast<std::uint32_t>(environment.stack_.size()));
 
-        core->read_64bit =  [environment_ptr](const address addr, std::uint64_t *result) {
-            *result = *reinterpret_cast<std::uint64_t*>
-                (reinterpret_cast<std::uint8_t*>(environment_ptr->code_.data()) + addr);
+        core->read_code.bind(read_env_code<test_env>, &environment);
 
-            return true;
-        };
+        core->read_8bit.bind(read_env_data<std::uint8_t>, &environment);
+        core->read_16bit.bind(read_env_data<std::uint16_t>, &environment);
+        core->read_32bit.bind(read_env_data<std::uint32_t>, &environment);
+        core->read_64bit.bind(read_env_data<std::uint64_t>, &environment);
 
-        core->write_64bit =  [environment_ptr](const address addr, std::uint64_t *result) {
-            *(reinterpret_cast<std::uint64_t*>(
-                    reinterpret_cast<std::uint8_t*>(environment_ptr->stack_.data()) + addr)) = *result;
-            return true;
-        };
+        core->write_8bit.bind(write_env_data<std::uint8_t>, &environment);
+        core->write_16bit.bind(write_env_data<std::uint16_t>, &environment);
+        core->write_32bit.bind(write_env_data<std::uint32_t>, &environment);
+        core->write_64bit.bind(write_env_data<std::uint64_t>, &environment);
 
         return core;
     }
 
     std::unique_ptr<r12l1_core> make_test_cpu(test_env_tlb &environment) {
         std::unique_ptr<r12l1_core> core = std::make_unique<r12l1_core>(&environment.monitor_, test_env_tlb::ENV_PAGE_BITS);
-        test_env_tlb *environment_ptr = &environment;
-        r12l1_core *core_ptr = core.get();
-
-        core->read_code = [environment_ptr](const address addr, std::uint32_t *result) {
-            std::uint32_t *data = reinterpret_cast<std::uint32_t*>(
-                    reinterpret_cast<std::uint8_t*>(environment_ptr->code_.data()) + addr);
-
-            *result = *data;
-            return true;
-        };
-
-        core->read_8bit =  [environment_ptr, core_ptr](const address addr, std::uint8_t *result) {
-            std::uint8_t *data_ptr = environment_ptr->pointer(addr);
-            if (!data_ptr) {
-                return false;
-            }
-            *result = *data_ptr;
-            core_ptr->set_tlb_page(addr, data_ptr, prot_read_write);
-            return true;
-        };
-
-        core->write_8bit =  [environment_ptr, core_ptr](const address addr, std::uint8_t *result) {
-            std::uint8_t *data_ptr = environment_ptr->pointer(addr);
-            if (!data_ptr) {
-                return false;
-            }
-            *data_ptr = *result;
-            core_ptr->set_tlb_page(addr, data_ptr, prot_read_write);
-            return true;
-        };
-
-        core->read_16bit =  [environment_ptr, core_ptr](const address addr, std::uint16_t *result) {
-            std::uint16_t *data_ptr = reinterpret_cast<std::uint16_t*>(environment_ptr->pointer(addr));
-            if (!data_ptr) {
-                return false;
-            }
-            *result = *data_ptr;
-            core_ptr->set_tlb_page(addr, reinterpret_cast<std::uint8_t*>(data_ptr), prot_read_write);
-            return true;
-        };
-
-        core->write_16bit =  [environment_ptr, core_ptr](const address addr, std::uint16_t *result) {
-            std::uint16_t *data_ptr = reinterpret_cast<std::uint16_t*>(environment_ptr->pointer(addr));
-            if (!data_ptr) {
-                return false;
-            }
-            *data_ptr = *result;
-            core_ptr->set_tlb_page(addr, reinterpret_cast<std::uint8_t*>(data_ptr), prot_read_write);
-            return true;
-        };
-
-        core->read_32bit =  [environment_ptr, core_ptr](const address addr, std::uint32_t *result) {
-            std::uint32_t *data_ptr = reinterpret_cast<std::uint32_t*>(environment_ptr->pointer(addr));
-            if (!data_ptr) {
-                return false;
-            }
-            *result = *data_ptr;
-            core_ptr->set_tlb_page(addr, reinterpret_cast<std::uint8_t*>(data_ptr), prot_read_write);
-            return true;
-        };
-
-        core->write_32bit =  [environment_ptr, core_ptr](const address addr, std::uint32_t *result) {
-            std::uint32_t *data_ptr = reinterpret_cast<std::uint32_t*>(environment_ptr->pointer(addr));
-            if (!data_ptr) {
-                return false;
-            }
-            *data_ptr = *result;
-            core_ptr->set_tlb_page(addr, reinterpret_cast<std::uint8_t*>(data_ptr), prot_read_write);
-            return true;
-        };
-
-        core->read_64bit =  [environment_ptr, core_ptr](const address addr, std::uint64_t *result) {
-            std::uint64_t *data_ptr = reinterpret_cast<std::uint64_t*>(environment_ptr->pointer(addr));
-            if (!data_ptr) {
-                return false;
-            }
-            *result = *data_ptr;
-            core_ptr->set_tlb_page(addr, reinterpret_cast<std::uint8_t*>(data_ptr), prot_read_write);
-            return true;
-        };
-
-        core->write_64bit =  [environment_ptr, core_ptr](const address addr, std::uint64_t *result) {
-            std::uint64_t *data_ptr = reinterpret_cast<std::uint64_t*>(environment_ptr->pointer(addr));
-            if (!data_ptr) {
-                return false;
-            }
-            *data_ptr = *result;
-            core_ptr->set_tlb_page(addr, reinterpret_cast<std::uint8_t*>(data_ptr), prot_read_write);
-            return true;
-        };
+        environment.core_ = core.get();
+
+        core->read_code.bind(read_env_code<test_env_tlb>, &environment);
+
+        core->read_8bit.bind(read_env_tlb_data<std::uint8_t>, &environment);
+        core->read_16bit.bind(read_env_tlb_data<std::uint16_t>, &environment);
+        core->read_32bit.bind(read_env_tlb_data<std::uint32_t>, &environment);
+        core->read_64bit.bind(read_env_tlb_data<std::uint64_t>, &environment);
+
+        core->write_8bit.bind(write_env_tlb_data<std::uint8_t>, &environment);
+        core->write_16bit.bind(write_env_tlb_data<std::uint16_t>, &environment);
+        core->write_32bit.bind(write_env_tlb_data<std::uint32_t>, &environment);
+        core->write_64bit.bind(write_env_tlb_data<std::uint64_t>, &environment);
 
         return core;
     }
-}
\ No newline at end of file
+}
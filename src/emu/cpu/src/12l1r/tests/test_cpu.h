@@ -24,6 +24,7 @@ namespace eka2l1::arm {
         std::vector<std::uint32_t> code_;
         std::vector<std::vector<std::uint8_t>> pages_;
         r12l1::exclusive_monitor monitor_;
+        r12l1_core *core_ = nullptr; ///< Core whose TLB is filled on a miss.
 
         explicit test_env_tlb(const std::uint32_t mem_size);
         void fill_tlb(r12l1_core &core);
@@ -27,6 +27,9 @@
 #include <dynarmic/interface/A32/coprocessor.h>
 
 namespace eka2l1::arm {
+    // Number of address spaces whose TLB entries are kept besides the running one
+    static constexpr std::size_t DYNARMIC_SAVED_TLB_COUNT = 7;
+
     class dynarmic_core_cp15 : public Dynarmic::A32::Coprocessor {
         std::uint32_t uprw;
         std::uint32_t data_sync_barrier;
@@ -306,8 +309,10 @@ namespace eka2l1::arm {
     };
 
     std::unique_ptr<Dynarmic::A32::Jit> make_jit(std::unique_ptr<dynarmic_core_callback> &callback, Dynarmic::TLB<9> &tlb_obj,
-        std::shared_ptr<dynarmic_core_cp15> cp15, Dynarmic::ExclusiveMonitor *monitor) {
+        std::shared_ptr<dynarmic_core_cp15> cp15, Dynarmic::ExclusiveMonitor *monitor, const std::size_t core_number,
+        std::uint8_t *fastmem_base = nullptr) {
         Dynarmic::A32::UserConfig config;
+        config.processor_id = core_number;
         config.callbacks = callback.get();
         config.coprocessors[15] = cp15;
         config.tlb_entries = tlb_obj.entries.data();
@@ -316,19 +321,40 @@ namespace eka2l1::arm {
         config.define_unpredictable_behaviour = true;
         config.arch_version = Dynarmic::A32::ArchVersion::v6T2;
 
+        if (fastmem_base) {
+            // A faulting access goes to the callbacks, which mirror the page for the next time. Faults come
+            // from pages not mirrored yet, mostly after an address space switch, or code pages being written.
+            // Blocks stay on fastmem, recompiling them with TLB accesses would make them slow for good.
+            config.fastmem_pointer = fastmem_base;
+            config.recompile_on_fastmem_failure = false;
+        }
+
         return std::make_unique<Dynarmic::A32::Jit>(config);
     }
 
-    dynarmic_core::dynarmic_core(arm::exclusive_monitor *monitor)
-        : tlb_obj(12)
+    dynarmic_core::dynarmic_core(arm::exclusive_monitor *monitor, const std::size_t core_number)
+        : jit(nullptr)
+        , global_monitor(nullptr)
+        , fastmem_base(nullptr)
+        , tlb_obj(12)
+        , saved_tlbs(DYNARMIC_SAVED_TLB_COUNT, Dynarmic::TLB<9>(12))
+        , saved_tlb_asids(DYNARMIC_SAVED_TLB_COUNT, -1)
+        , saved_tlb_last_use(DYNARMIC_SAVED_TLB_COUNT, 0)
+        , tlb_asid(0)
+        , tlb_use_counter(0)
         , interpreter(monitor, 12)
         , interpreter_callback_inited(false) {
-        std::shared_ptr<dynarmic_core_cp15> cp15 = std::make_shared<dynarmic_core_cp15>();
+        cp15 = std::make_shared<dynarmic_core_cp15>();
         cb = std::make_unique<dynarmic_core_callback>(*this, cp15);
 
         auto monitor_bb = reinterpret_cast<dynarmic_exclusive_monitor *>(monitor);
+        global_monitor = &monitor_bb->monitor_;
 
-        jit = make_jit(cb, tlb_obj, cp15, &monitor_bb->monitor_);
+        set_core_number(core_number);
+        interpreter.set_core_number(core_number);
+
+        tlb_jit = make_jit(cb, tlb_obj, cp15, global_monitor, core_number);
+        jit = tlb_jit.get();
     }
 
     dynarmic_core::~dynarmic_core() {
@@ -467,18 +493,110 @@ namespace eka2l1::arm {
 
     void dynarmic_core::dirty_tlb_page(address addr) {
         tlb_obj.MakeDirty(addr);
+
+        for (Dynarmic::TLB<9> &saved : saved_tlbs) {
+            saved.MakeDirty(addr);
+        }
     }
 
     void dynarmic_core::flush_tlb() {
         tlb_obj.Flush();
+
+        for (std::size_t i = 0; i < saved_tlbs.size(); i++) {
+            saved_tlbs[i].Flush();
+            saved_tlb_asids[i] = -1;
+        }
+    }
+
+    void dynarmic_core::set_fastmem_base(std::uint8_t *base) {
+        if (base != fastmem_base) {
+            fastmem_base = base;
+
+            switch_jit(tlb_jit.get());
+            fastmem_jit = base ? make_jit(cb, tlb_obj, cp15, global_monitor, core_number(), base) : nullptr;
+        }
+
+        if (fastmem_jit) {
+            switch_jit(fastmem_jit.get());
+        }
+    }
+
+    void dynarmic_core::switch_jit(Dynarmic::A32::Jit *target) {
+        if (target == jit) {
+            return;
+        }
+
+        target->Regs() = jit->Regs();
+        target->ExtRegs() = jit->ExtRegs();
+        target->SetCpsr(jit->Cpsr());
+        target->SetFpscr(jit->Fpscr());
+
+        jit = target;
+    }
+
+    void dynarmic_core::set_tlb_asid(const std::int32_t id) {
+        if (id == tlb_asid) {
+            return;
+        }
+
+        std::size_t slot = 0;
+        bool found = false;
+
+        for (std::size_t i = 0; i < saved_tlbs.size(); i++) {
+            if (saved_tlb_asids[i] == id) {
+                slot = i;
+                found = true;
+                break;
+            }
+
+            if (saved_tlb_last_use[i] < saved_tlb_last_use[slot]) {
+                slot = i;
+            }
+        }
+
+        // Park the current entries in the slot, and take the ones stored there if they belong to the target
+        std::swap(tlb_obj.entries, saved_tlbs[slot].entries);
+
+        if (!found) {
+            tlb_obj.Flush();
+        }
+
+        saved_tlb_asids[slot] = tlb_asid;
+        saved_tlb_last_use[slot] = ++tlb_use_counter;
+
+        tlb_asid = id;
+    }
+
+    void dynarmic_core::flush_tlb_asid(const std::int32_t id) {
+        if (id == tlb_asid) {
+            tlb_obj.Flush();
+            return;
+        }
+
+        for (std::size_t i = 0; i < saved_tlbs.size(); i++) {
+            if (saved_tlb_asids[i] == id) {
+                saved_tlbs[i].Flush();
+                saved_tlb_asids[i] = -1;
+            }
+        }
     }
 
     void dynarmic_core::clear_instruction_cache() {
-        jit->ClearCache();
+        tlb_jit->ClearCache();
+        interpreter.clear_instruction_cache();
+
+        if (fastmem_jit) {
+            fastmem_jit->ClearCache();
+        }
     }
 
     void dynarmic_core::imb_range(address addr, std::size_t size) {
-        jit->InvalidateCacheRange(addr, size);
+        tlb_jit->InvalidateCacheRange(addr, size);
+        interpreter.imb_range(addr, size);
+
+        if (fastmem_jit) {
+            fastmem_jit->InvalidateCacheRange(addr, size);
+        }
     }
 
     std::uint32_t dynarmic_core::get_num_instruction_executed() {
@@ -19,6 +19,7 @@
  */
 #include <common/platform.h>
 #include <cpu/arm_factory.h>
+#include <cpu/arm_tiered.h>
 
 #include <cpu/dyncom/arm_dyncom.h>
 
@@ -31,7 +32,7 @@
 #include <cpu/12l1r/exclusive_monitor.h>
 
 namespace eka2l1::arm {
-    core_instance create_core(exclusive_monitor *monitor, arm_emulator_type arm_type) {
+    static core_instance create_core_impl(exclusive_monitor *monitor, arm_emulator_type arm_type, const std::size_t core_number) {
         switch (arm_type) {
         case arm_emulator_type::unicorn:
             return nullptr;
@@ -41,12 +42,18 @@ namespace eka2l1::arm {
             return std::make_unique<r12l1_core>(monitor, 12);
 #else
         case arm_emulator_type::dynarmic:
-            return std::make_unique<dynarmic_core>(monitor);
+            return std::make_unique<dynarmic_core>(monitor, core_number);
 #endif
 
         case arm_emulator_type::dyncom:
             return std::make_unique<dyncom_core>(monitor, 12);
 
+#if EKA2L1_ARCH(ARM)
+        // Dynarmic can not translate without running, the tiered core has nothing to move hot code to
+        case arm_emulator_type::tiered:
+            return std::make_unique<tiered_core>(monitor, arm_emulator_type::r12l1, 12, core_number);
+#endif
+
         default:
             break;
         }
@@ -54,6 +61,16 @@ namespace eka2l1::arm {
         return nullptr;
     }
 
+    core_instance create_core(exclusive_monitor *monitor, arm_emulator_type arm_type, const std::size_t core_number) {
+        core_instance result = create_core_impl(monitor, arm_type, core_number);
+
+        if (result) {
+            result->set_core_number(core_number);
+        }
+
+        return result;
+    }
+
     exclusive_monitor_instance create_exclusive_monitor(arm_emulator_type arm_type, const std::size_t core_count) {
         switch (arm_type) {
         case arm_emulator_type::unicorn:
@@ -64,6 +81,7 @@ namespace eka2l1::arm {
 
 #if EKA2L1_ARCH(ARM)
         case arm_emulator_type::r12l1:
+        case arm_emulator_type::tiered:
             return std::make_unique<r12l1::exclusive_monitor>(core_count);
 #else
         case arm_emulator_type::dynarmic:
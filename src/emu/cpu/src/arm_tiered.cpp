@@ -0,0 +1,701 @@
+/*
+ * Copyright (c) 2022 EKA2L1 Team.
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cpu/arm_factory.h>
+#include <cpu/arm_tiered.h>
+#include <cpu/arm_utils.h>
+
+#include <common/log.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace eka2l1::arm {
+    // Amount of code copied for the compile thread. Blocks longer than this are translated on entry.
+    static constexpr std::uint32_t TIERED_SNAPSHOT_MAX_WORDS = 0x100;
+
+    forward_exclusive_monitor::forward_exclusive_monitor(exclusive_monitor *target, core *owner)
+        : target_(target)
+        , owner_(owner) {
+    }
+
+    std::uint8_t forward_exclusive_monitor::exclusive_read8(core *cc, address vaddr) {
+        return target_->exclusive_read8(owner_, vaddr);
+    }
+
+    std::uint16_t forward_exclusive_monitor::exclusive_read16(core *cc, address vaddr) {
+        return target_->exclusive_read16(owner_, vaddr);
+    }
+
+    std::uint32_t forward_exclusive_monitor::exclusive_read32(core *cc, address vaddr) {
+        return target_->exclusive_read32(owner_, vaddr);
+    }
+
+    std::uint64_t forward_exclusive_monitor::exclusive_read64(core *cc, address vaddr) {
+        return target_->exclusive_read64(owner_, vaddr);
+    }
+
+    void forward_exclusive_monitor::clear_exclusive() {
+        target_->clear_exclusive();
+    }
+
+    bool forward_exclusive_monitor::exclusive_write8(core *cc, address vaddr, std::uint8_t value) {
+        return target_->exclusive_write8(owner_, vaddr, value);
+    }
+
+    bool forward_exclusive_monitor::exclusive_write16(core *cc, address vaddr, std::uint16_t value) {
+        return target_->exclusive_write16(owner_, vaddr, value);
+    }
+
+    bool forward_exclusive_monitor::exclusive_write32(core *cc, address vaddr, std::uint32_t value) {
+        return target_->exclusive_write32(owner_, vaddr, value);
+    }
+
+    bool forward_exclusive_monitor::exclusive_write64(core *cc, address vaddr, std::uint64_t value) {
+        return target_->exclusive_write64(owner_, vaddr, value);
+    }
+
+    template <typename T>
+    static bool forward_read(void *userdata, address addr, T *data) {
+        core *from = static_cast<core *>(userdata);
+
+        if constexpr (sizeof(T) == 1) {
+            return from->read_8bit(addr, data);
+        } else if constexpr (sizeof(T) == 2) {
+            return from->read_16bit(addr, data);
+        } else if constexpr (sizeof(T) == 4) {
+            return from->read_32bit(addr, data);
+        } else {
+            return from->read_64bit(addr, data);
+        }
+    }
+
+    template <typename T>
+    static bool forward_write(void *userdata, address addr, T *data) {
+        core *from = static_cast<core *>(userdata);
+
+        if constexpr (sizeof(T) == 1) {
+            return from->write_8bit(addr, data);
+        } else if constexpr (sizeof(T) == 2) {
+            return from->write_16bit(addr, data);
+        } else if constexpr (sizeof(T) == 4) {
+            return from->write_32bit(addr, data);
+        } else {
+            return from->write_64bit(addr, data);
+        }
+    }
+
+    template <typename T>
+    static std::int32_t forward_exclusive_write(void *userdata, address addr, T value, T expected) {
+        core *from = static_cast<core *>(userdata);
+
+        if constexpr (sizeof(T) == 1) {
+            return from->exclusive_write_8bit(addr, value, expected);
+        } else if constexpr (sizeof(T) == 2) {
+            return from->exclusive_write_16bit(addr, value, expected);
+        } else if constexpr (sizeof(T) == 4) {
+            return from->exclusive_write_32bit(addr, value, expected);
+        } else {
+            return from->exclusive_write_64bit(addr, value, expected);
+        }
+    }
+
+    static bool forward_read_code(void *userdata, address addr, std::uint32_t *data) {
+        return static_cast<core *>(userdata)->read_code(addr, data);
+    }
+
+    static void forward_callbacks(core *from, core *to) {
+        // Callbacks of the outer core are only set after construction, so look them up on each call
+        to->read_8bit.bind(forward_read<std::uint8_t>, from);
+        to->read_16bit.bind(forward_read<std::uint16_t>, from);
+        to->read_32bit.bind(forward_read<std::uint32_t>, from);
+        to->read_64bit.bind(forward_read<std::uint64_t>, from);
+        to->write_8bit.bind(forward_write<std::uint8_t>, from);
+        to->write_16bit.bind(forward_write<std::uint16_t>, from);
+        to->write_32bit.bind(forward_write<std::uint32_t>, from);
+        to->write_64bit.bind(forward_write<std::uint64_t>, from);
+        to->read_code.bind(forward_read_code, from);
+
+        to->exclusive_write_8bit.bind(forward_exclusive_write<std::uint8_t>, from);
+        to->exclusive_write_16bit.bind(forward_exclusive_write<std::uint16_t>, from);
+        to->exclusive_write_32bit.bind(forward_exclusive_write<std::uint32_t>, from);
+        to->exclusive_write_64bit.bind(forward_exclusive_write<std::uint64_t>, from);
+
+        to->system_call_handler = [from](const std::uint32_t num) { from->system_call_handler(num); };
+        to->exception_handler = [from](exception_type type, const std::uint32_t data) {
+            return from->exception_handler(type, data);
+        };
+    }
+
+    tiered_core::tiered_core(exclusive_monitor *monitor, const arm_emulator_type jit_type, const std::size_t page_bits,
+        const std::size_t core_number)
+        : active_(nullptr)
+        , page_bits_(page_bits)
+        , hot_block_threshold_(0)
+        , generation_(0)
+        , compile_thread_should_stop_(false)
+        , stop_requested_(false)
+        , jit_runner_(std::thread::id())
+        , last_interpreted_(0)
+        , last_compiled_(0)
+        , total_interpreted_(0)
+        , total_compiled_(0)
+        , total_hot_blocks_(0) {
+        interpreter_monitor_ = std::make_unique<forward_exclusive_monitor>(monitor, this);
+        interpreter_ = std::make_unique<dyncom_core>(interpreter_monitor_.get(), page_bits);
+        jit_ = create_core(monitor, jit_type, core_number);
+
+        if (jit_ && !jit_->can_translate_ahead()) {
+            jit_.reset();
+        }
+
+        if (!jit_) {
+            LOG_ERROR(CPU, "Backend {} can not translate ahead of time, only interpreting",
+                arm_emulator_type_to_string(jit_type));
+        } else {
+            forward_callbacks(this, jit_.get());
+            jit_->set_translate_on_entry(false);
+        }
+
+        forward_callbacks(this, interpreter_.get());
+        active_ = interpreter_.get();
+
+        // Nothing is ever queued without a JIT to translate for
+        if (jit_) {
+            compile_thread_ = std::thread([this]() { compile_thread_loop(); });
+        }
+    }
+
+    tiered_core::~tiered_core() {
+        {
+            const std::lock_guard<std::mutex> guard(queue_lock_);
+            compile_thread_should_stop_ = true;
+        }
+
+        queue_cond_.notify_all();
+
+        if (compile_thread_.joinable()) {
+            compile_thread_.join();
+        }
+
+        if (total_interpreted_ || total_compiled_) {
+            LOG_INFO(CPU, "Tiered core: {} instructions interpreted, {} run on the JIT, {} blocks became hot",
+                total_interpreted_, total_compiled_, total_hot_blocks_);
+        }
+    }
+
+    void tiered_core::set_hot_block_threshold(const std::uint32_t threshold) {
+        hot_block_threshold_ = jit_ ? threshold : 0;
+        interpreter_->set_hot_block_threshold(hot_block_threshold_);
+    }
+
+    bool tiered_core::read_snapshot_code(void *userdata, address addr, std::uint32_t *data) {
+        const compile_request *request = static_cast<const compile_request *>(userdata);
+        const std::uint32_t word = (addr - request->snapshot_base_) >> 2;
+
+        if ((addr < request->snapshot_base_) || (word >= request->snapshot_->size())) {
+            return false;
+        }
+
+        *data = (*request->snapshot_)[word];
+        return true;
+    }
+
+    void tiered_core::compile_thread_loop() {
+        while (true) {
+            compile_request request;
+
+            {
+                std::unique_lock<std::mutex> lock(queue_lock_);
+                queue_cond_.wait(lock, [this]() { return compile_thread_should_stop_ || !compile_queue_.empty(); });
+
+                if (compile_thread_should_stop_) {
+                    return;
+                }
+
+                request = std::move(compile_queue_.front());
+                compile_queue_.pop();
+            }
+
+            // Only the translation cache is shared with the emulation thread, which keeps interpreting
+            // while this is held
+            const std::lock_guard<std::mutex> jit_guard(jit_lock_);
+
+            if (request.generation_ != generation_) {
+                // Code may have changed after the snapshot. Profile the block again.
+                const std::lock_guard<std::mutex> guard(queue_lock_);
+                rejected_blocks_.push_back(request.block_key_);
+
+                continue;
+            }
+
+            // The memory system belongs to the emulation thread, only read from the snapshot here
+            const memory_operation_32bit_func original_read_code = jit_->read_code;
+            jit_->read_code.bind(read_snapshot_code, &request);
+
+            const bool compiled = jit_->precompile_block(request.block_key_ & ~1, request.block_key_ & 1, request.fpscr_);
+            jit_->read_code = original_read_code;
+
+            const std::lock_guard<std::mutex> guard(queue_lock_);
+            (compiled ? ready_blocks_ : rejected_blocks_).push_back(request.block_key_);
+        }
+    }
+
+    void tiered_core::queue_hot_blocks() {
+        if (!jit_) {
+            return;
+        }
+
+        const std::vector<address> hot_blocks = interpreter_->take_hot_blocks();
+        if (hot_blocks.empty()) {
+            return;
+        }
+
+        const std::uint32_t page_size = 1 << page_bits_;
+
+        for (const address block_key : hot_blocks) {
+            if (compiled_blocks_.count(block_key)) {
+                continue;
+            }
+
+            compile_request request;
+            request.block_key_ = block_key;
+            request.fpscr_ = interpreter_->get_fpscr();
+            request.generation_ = generation_;
+            request.snapshot_base_ = block_key & ~3;
+
+            // Stop at the end of the page, the next one may not be mapped
+            const std::uint32_t words_to_page_end = (page_size - (request.snapshot_base_ & (page_size - 1))) >> 2;
+            const std::uint32_t word_count = std::min(words_to_page_end, TIERED_SNAPSHOT_MAX_WORDS);
+
+            auto snapshot = std::make_shared<std::vector<std::uint32_t>>();
+            snapshot->reserve(word_count);
+
+            for (std::uint32_t i = 0; i < word_count; i++) {
+                std::uint32_t word = 0;
+                if (!read_code(request.snapshot_base_ + (i << 2), &word)) {
+                    break;
+                }
+
+                snapshot->push_back(word);
+            }
+
+            if (snapshot->empty()) {
+                continue;
+            }
+
+            request.snapshot_ = std::move(snapshot);
+
+            total_hot_blocks_++;
+
+            const std::lock_guard<std::mutex> guard(queue_lock_);
+            compile_queue_.push(std::move(request));
+        }
+
+        queue_cond_.notify_one();
+    }
+
+    void tiered_core::drain_ready_blocks() {
+        const std::lock_guard<std::mutex> guard(queue_lock_);
+
+        for (const address block_key : ready_blocks_) {
+            compiled_blocks_.insert(block_key);
+            interpreter_->add_handover_block(block_key);
+        }
+
+        for (const address block_key : rejected_blocks_) {
+            interpreter_->forget_blocks(block_key & ~1, 1);
+        }
+
+        ready_blocks_.clear();
+        rejected_blocks_.clear();
+    }
+
+    std::unique_lock<std::mutex> tiered_core::lock_jit() {
+        // Kernel calls made by code running on the JIT come back here with the lock already held
+        return (jit_runner_ == std::this_thread::get_id()) ? std::unique_lock<std::mutex>() : std::unique_lock<std::mutex>(jit_lock_);
+    }
+
+    void tiered_core::switch_to(core *target) {
+        if (active_ == target) {
+            return;
+        }
+
+        thread_context context;
+        active_->save_context(context);
+
+        if (target == interpreter_.get()) {
+            // Loading the context on the interpreter drops its decoded instructions, which are still valid here
+            for (std::size_t i = 0; i < context.cpu_registers.size(); i++) {
+                interpreter_->set_reg(i, context.cpu_registers[i]);
+            }
+
+            for (std::size_t i = 0; i < context.fpu_registers.size(); i++) {
+                interpreter_->set_vfp(i, context.fpu_registers[i]);
+            }
+
+            interpreter_->set_cpsr(context.cpsr);
+            interpreter_->set_fpscr(context.fpscr);
+        } else {
+            target->load_context(context);
+        }
+
+        active_ = target;
+    }
+
+    void tiered_core::forget_compiled_blocks(const address addr, const std::size_t size) {
+        const std::uint64_t end = static_cast<std::uint64_t>(addr) + size;
+
+        auto in_range = [addr, end](const address block_key) {
+            const address block_addr = block_key & ~1;
+            return (block_addr >= addr) && (block_addr < end);
+        };
+
+        for (auto ite = compiled_blocks_.begin(); ite != compiled_blocks_.end();) {
+            ite = in_range(*ite) ? compiled_blocks_.erase(ite) : std::next(ite);
+        }
+
+        const std::lock_guard<std::mutex> guard(queue_lock_);
+        ready_blocks_.erase(std::remove_if(ready_blocks_.begin(), ready_blocks_.end(), in_range), ready_blocks_.end());
+    }
+
+    void tiered_core::run(const std::uint32_t instruction_count) {
+        last_interpreted_ = 0;
+        last_compiled_ = 0;
+        stop_requested_ = false;
+
+        if (jit_) {
+            jit_->set_core_number(core_number());
+        }
+
+        std::uint32_t instructions_left = instruction_count;
+
+        while (instructions_left && !stop_requested_) {
+            drain_ready_blocks();
+
+            const address block_key = get_pc() | (is_thumb_mode() ? 1 : 0);
+            std::uint32_t executed = 0;
+
+            // While the worker is translating, keep interpreting instead of waiting for it
+            std::unique_lock<std::mutex> jit_guard(jit_lock_, std::defer_lock);
+
+            if (compiled_blocks_.count(block_key) && jit_guard.try_lock()) {
+                switch_to(jit_.get());
+
+                // Returns at the first block that is not translated
+                jit_runner_ = std::this_thread::get_id();
+                jit_->run(instructions_left);
+                jit_runner_ = std::thread::id();
+
+                jit_guard.unlock();
+
+                executed = jit_->get_num_instruction_executed();
+                last_compiled_ += executed;
+
+                if (!executed && !stop_requested_) {
+                    // The JIT dropped the block, profile it again
+                    compiled_blocks_.erase(block_key);
+                    interpreter_->forget_blocks(block_key & ~1, 1);
+
+                    continue;
+                }
+            } else {
+                switch_to(interpreter_.get());
+                interpreter_->run(instructions_left);
+
+                executed = interpreter_->get_num_instruction_executed();
+                last_interpreted_ += executed;
+
+                queue_hot_blocks();
+            }
+
+            if (!executed) {
+                break;
+            }
+
+            instructions_left -= std::min(instructions_left, executed);
+        }
+
+        total_interpreted_ += last_interpreted_;
+        total_compiled_ += last_compiled_;
+    }
+
+    void tiered_core::stop() {
+        stop_requested_ = true;
+        active_->stop();
+    }
+
+    void tiered_core::step() {
+        // The JIT may not have the current block, the interpreter always runs it
+        switch_to(interpreter_.get());
+        interpreter_->step();
+    }
+
+#define TIERED_FORWARD(expr) return active_->expr
+
+    std::uint32_t tiered_core::get_reg(size_t idx) {
+        TIERED_FORWARD(get_reg(idx));
+    }
+
+    std::uint32_t tiered_core::get_sp() {
+        TIERED_FORWARD(get_sp());
+    }
+
+    std::uint32_t tiered_core::get_pc() {
+        TIERED_FORWARD(get_pc());
+    }
+
+    std::uint32_t tiered_core::get_vfp(size_t idx) {
+        TIERED_FORWARD(get_vfp(idx));
+    }
+
+    void tiered_core::set_reg(size_t idx, std::uint32_t val) {
+        TIERED_FORWARD(set_reg(idx, val));
+    }
+
+    void tiered_core::set_pc(std::uint32_t val) {
+        TIERED_FORWARD(set_pc(val));
+    }
+
+    void tiered_core::set_sp(std::uint32_t val) {
+        TIERED_FORWARD(set_sp(val));
+    }
+
+    void tiered_core::set_lr(std::uint32_t val) {
+        TIERED_FORWARD(set_lr(val));
+    }
+
+    void tiered_core::set_vfp(size_t idx, std::uint32_t val) {
+        TIERED_FORWARD(set_vfp(idx, val));
+    }
+
+    std::uint32_t tiered_core::get_cpsr() {
+        TIERED_FORWARD(get_cpsr());
+    }
+
+    std::uint32_t tiered_core::get_fpscr() {
+        TIERED_FORWARD(get_fpscr());
+    }
+
+    std::uint32_t tiered_core::get_lr() {
+        TIERED_FORWARD(get_lr());
+    }
+
+    void tiered_core::set_cpsr(std::uint32_t val) {
+        TIERED_FORWARD(set_cpsr(val));
+    }
+
+    void tiered_core::set_fpscr(std::uint32_t val) {
+        TIERED_FORWARD(set_fpscr(val));
+    }
+
+    void tiered_core::save_context(thread_context &ctx) {
+        TIERED_FORWARD(save_context(ctx));
+    }
+
+    bool tiered_core::is_thumb_mode() {
+        TIERED_FORWARD(is_thumb_mode());
+    }
+
+#undef TIERED_FORWARD
+
+    void tiered_core::load_context(const thread_context &ctx) {
+        interpreter_->load_context(ctx);
+
+        if (jit_) {
+            jit_->load_context(ctx);
+        }
+    }
+
+    void tiered_core::set_tlb_page(address vaddr, std::uint8_t *ptr, prot protection) {
+        interpreter_->set_tlb_page(vaddr, ptr, protection);
+
+        if (jit_) {
+            jit_->set_tlb_page(vaddr, ptr, protection);
+        }
+    }
+
+    void tiered_core::dirty_tlb_page(address addr) {
+        interpreter_->dirty_tlb_page(addr);
+
+        if (jit_) {
+            jit_->dirty_tlb_page(addr);
+        }
+    }
+
+    void tiered_core::flush_tlb() {
+        interpreter_->flush_tlb();
+
+        if (jit_) {
+            jit_->flush_tlb();
+        }
+    }
+
+    void tiered_core::set_tlb_asid(const std::int32_t id) {
+        interpreter_->set_tlb_asid(id);
+
+        if (jit_) {
+            jit_->set_tlb_asid(id);
+        }
+    }
+
+    void tiered_core::set_fastmem_base(std::uint8_t *base) {
+        // Only the JIT can use it
+        if (jit_) {
+            jit_->set_fastmem_base(base);
+        }
+    }
+
+    void tiered_core::flush_tlb_asid(const std::int32_t id) {
+        interpreter_->flush_tlb_asid(id);
+
+        if (jit_) {
+            jit_->flush_tlb_asid(id);
+        }
+    }
+
+    void tiered_core::clear_instruction_cache() {
+        {
+            const std::lock_guard<std::mutex> guard(queue_lock_);
+
+            generation_++;
+            compile_queue_ = std::queue<compile_request>();
+            ready_blocks_.clear();
+            rejected_blocks_.clear();
+        }
+
+        compiled_blocks_.clear();
+
+        // Resetting the threshold drops all profile data
+        interpreter_->set_hot_block_threshold(0);
+        interpreter_->set_hot_block_threshold(hot_block_threshold_);
+        interpreter_->clear_instruction_cache();
+
+        if (jit_) {
+            const std::unique_lock<std::mutex> jit_guard = lock_jit();
+            jit_->clear_instruction_cache();
+        }
+    }
+
+    void tiered_core::imb_range(address addr, std::size_t size) {
+        {
+            const std::lock_guard<std::mutex> guard(queue_lock_);
+            generation_++;
+        }
+
+        forget_compiled_blocks(addr, size);
+
+        interpreter_->forget_blocks(addr, size);
+        interpreter_->imb_range(addr, size);
+
+        if (jit_) {
+            const std::unique_lock<std::mutex> jit_guard = lock_jit();
+            jit_->imb_range(addr, size);
+        }
+    }
+
+    std::uint32_t tiered_core::get_num_instruction_executed() {
+        return last_interpreted_ + last_compiled_;
+    }
+
+    bool tiered_core::precompile_block(const address addr, const bool thumb, const std::uint32_t fpscr) {
+        if (!jit_) {
+            return false;
+        }
+
+        const std::unique_lock<std::mutex> jit_guard = lock_jit();
+        if (!jit_->precompile_block(addr, thumb, fpscr)) {
+            return false;
+        }
+
+        // Blocks translated ahead of time do not need to be profiled first
+        const address block_key = addr | (thumb ? 1 : 0);
+
+        compiled_blocks_.insert(block_key);
+        interpreter_->add_handover_block(block_key);
+
+        return true;
+    }
+
+    std::size_t tiered_core::queue_precompile_blocks(const address code_base, const std::uint8_t *code, const std::size_t code_size,
+        const std::vector<translated_block_info> &blocks) {
+        if (!jit_ || blocks.empty() || (code_base & 3)) {
+            return 0;
+        }
+
+        auto snapshot = std::make_shared<std::vector<std::uint32_t>>(code_size >> 2);
+        std::memcpy(snapshot->data(), code, snapshot->size() << 2);
+
+        std::size_t queued = 0;
+
+        {
+            const std::lock_guard<std::mutex> guard(queue_lock_);
+
+            for (const translated_block_info &block : blocks) {
+                const address block_key = block.addr_ | (block.thumb_ ? 1 : 0);
+
+                if ((block.addr_ < code_base) || (block.addr_ - code_base >= code_size) || compiled_blocks_.count(block_key)) {
+                    continue;
+                }
+
+                compile_request request;
+                request.block_key_ = block_key;
+                request.fpscr_ = block.fpscr_;
+                request.generation_ = generation_;
+                request.snapshot_base_ = code_base;
+                request.snapshot_ = snapshot;
+
+                compile_queue_.push(std::move(request));
+                queued++;
+            }
+        }
+
+        queue_cond_.notify_one();
+        return queued;
+    }
+
+    std::size_t tiered_core::collect_translated_blocks(const address start, const address end, std::vector<translated_block_info> &blocks) {
+        if (!jit_) {
+            return 0;
+        }
+
+        if (jit_runner_ == std::this_thread::get_id()) {
+            return jit_->collect_translated_blocks(start, end, blocks);
+        }
+
+        // Another thread may be running code on this core, which can be waiting for the caller to leave
+        // the kernel. Skip the core then.
+        const std::unique_lock<std::mutex> jit_guard(jit_lock_, std::try_to_lock);
+        if (!jit_guard.owns_lock()) {
+            return 0;
+        }
+
+        return jit_->collect_translated_blocks(start, end, blocks);
+    }
+
+    std::size_t tiered_core::export_decoded_blocks(const address start, const address end, std::vector<decoded_block_info> &blocks) {
+        // Blocks start interpreted, so the interpreter has decoded every block that ran
+        return interpreter_->export_decoded_blocks(start, end, blocks);
+    }
+
+    std::size_t tiered_core::import_decoded_blocks(const address code_base, const std::uint8_t *code, const std::size_t code_size,
+        const std::vector<decoded_block_info> &blocks) {
+        return interpreter_->import_decoded_blocks(code_base, code, code_size, blocks);
+    }
+}
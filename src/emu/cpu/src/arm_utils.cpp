@@ -50,6 +50,9 @@ namespace eka2l1::arm {
         case arm_emulator_type::r12l1:
             return r12l1_jit_backend_formal_name;
 
+        case arm_emulator_type::tiered:
+            return tiered_jit_backend_formal_name;
+
         default:
             break;
         }
@@ -74,6 +77,10 @@ namespace eka2l1::arm {
             return arm_emulator_type::r12l1;
         }
 
+        if (backend_lowered == tiered_jit_backend_name) {
+            return arm_emulator_type::tiered;
+        }
+
         return arm_emulator_type::dynarmic;
     }
 }
\ No newline at end of file
@@ -23,6 +23,8 @@
 
 #include <common/log.h>
 
+#include <cstring>
+
 namespace eka2l1::arm {
     dyncom_core::dyncom_core(arm::exclusive_monitor *monitor, const std::size_t page_bits)
         : monitor_(monitor)
@@ -129,8 +131,6 @@ namespace eka2l1::arm {
     }
 
     void dyncom_core::load_context(const thread_context &ctx) {
-        clear_instruction_cache();
-
         for (uint8_t i = 0; i < 16; i++) {
             state_->Reg[i] = ctx.cpu_registers[i];
         }
@@ -157,16 +157,106 @@ namespace eka2l1::arm {
         mem_cache_.flush();
     }
 
+    void dyncom_core::set_tlb_asid(const std::int32_t id) {
+        mem_cache_.switch_asid(id);
+    }
+
+    void dyncom_core::flush_tlb_asid(const std::int32_t id) {
+        mem_cache_.flush_asid(id);
+    }
+
     void dyncom_core::clear_instruction_cache() {
-        state_->instruction_cache.clear();
+        state_->block_cache.clear();
         state_->trans_cache_buf_top = 0;
     }
 
     void dyncom_core::imb_range(address addr, std::size_t size) {
-        clear_instruction_cache();
+        // The decoded instructions stay in the buffer until it fills up
+        state_->block_cache.invalidate(addr, size);
     }
 
     std::uint32_t dyncom_core::get_num_instruction_executed() {
         return ticks_executed_;
     }
+
+    std::size_t dyncom_core::export_decoded_blocks(const address start, const address end, std::vector<decoded_block_info> &blocks) {
+        return state_->block_cache.export_blocks(start, end, blocks);
+    }
+
+    std::size_t dyncom_core::import_decoded_blocks(const address code_base, const std::uint8_t *code, const std::size_t code_size,
+        const std::vector<decoded_block_info> &blocks) {
+        std::size_t loaded = 0;
+
+        for (const decoded_block_info &block : blocks) {
+            if (block.addr_ < code_base) {
+                continue;
+            }
+
+            // The code may have changed since the block was decoded, so compare it before trusting the block
+            std::size_t offset = block.addr_ - code_base;
+            bool matches = true;
+
+            for (const decoded_inst_info &inst : block.insts_) {
+                std::uint32_t guest_code = 0;
+
+                if ((inst.size_ > sizeof(guest_code)) || (offset + inst.size_ > code_size)) {
+                    matches = false;
+                    break;
+                }
+
+                std::memcpy(&guest_code, code + offset, inst.size_);
+
+                if (guest_code != inst.code_) {
+                    matches = false;
+                    break;
+                }
+
+                offset += inst.size_;
+            }
+
+            if (matches && InterpreterLoadBlock(state_.get(), block.addr_, block.thumb_, block.insts_)) {
+                loaded++;
+            }
+        }
+
+        return loaded;
+    }
+
+    void dyncom_core::set_hot_block_threshold(const std::uint32_t threshold) {
+        state_->hot_block_threshold = threshold;
+
+        if (!threshold) {
+            state_->block_hits.clear();
+            state_->hot_blocks.clear();
+            state_->handover_blocks.clear();
+        }
+    }
+
+    std::vector<address> dyncom_core::take_hot_blocks() {
+        std::vector<address> blocks;
+        blocks.swap(state_->hot_blocks);
+
+        return blocks;
+    }
+
+    void dyncom_core::add_handover_block(const address block_key) {
+        state_->handover_blocks.insert(block_key);
+    }
+
+    void dyncom_core::forget_blocks(const address addr, const std::size_t size) {
+        const std::uint64_t end = static_cast<std::uint64_t>(addr) + size;
+
+        auto in_range = [addr, end](const std::uint32_t block_key) {
+            const std::uint32_t block_addr = block_key & ~1;
+            return (block_addr >= addr) && (block_addr < end);
+        };
+
+        for (auto ite = state_->block_hits.begin(); ite != state_->block_hits.end();) {
+            ite = in_range(ite->first) ? state_->block_hits.erase(ite) : std::next(ite);
+        }
+
+        for (auto ite = state_->handover_blocks.begin(); ite != state_->handover_blocks.end();) {
+            ite = in_range(*ite) ? state_->handover_blocks.erase(ite) : std::next(ite);
+        }
+    }
 }
\ No newline at end of file
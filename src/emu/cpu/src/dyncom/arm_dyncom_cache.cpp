@@ -0,0 +1,159 @@
+/*
+ * Copyright (c) 2022 EKA2L1 Team.
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cpu/dyncom/arm_dyncom_cache.h>
+
+#include <algorithm>
+
+namespace eka2l1::arm {
+    std::size_t dyncom_block_cache::find_slow(const std::uint32_t key) {
+        auto ite = blocks_.find(key);
+        if (ite == blocks_.end()) {
+            return NOT_FOUND;
+        }
+
+        fast_lookup_entry &entry = fast_lookup_[fast_lookup_index(key)];
+        entry.key_ = key;
+        entry.offset_ = ite->second.offset_;
+
+        return entry.offset_;
+    }
+
+    void dyncom_block_cache::add(const std::uint32_t key, const address end, const std::size_t offset, std::vector<decoded_inst_info> insts) {
+        const address start = key & ~1;
+        blocks_[key] = block_info{ start, end, offset, std::move(insts) };
+
+        const std::uint32_t last_page = (std::max(end, start + 1) - 1) >> PAGE_BITS;
+
+        for (std::uint32_t page = start >> PAGE_BITS; page <= last_page; page++) {
+            page_blocks_[page].push_back(key);
+        }
+
+        fast_lookup_entry &entry = fast_lookup_[fast_lookup_index(key)];
+        entry.key_ = key;
+        entry.offset_ = offset;
+    }
+
+    std::size_t dyncom_block_cache::export_blocks(const address start, const address end, std::vector<decoded_block_info> &blocks) const {
+        std::size_t count = 0;
+
+        for (const auto &[key, info] : blocks_) {
+            if ((info.start_ < start) || (info.start_ >= end) || info.insts_.empty()) {
+                continue;
+            }
+
+            blocks.push_back(decoded_block_info{ info.start_, (key & 1) != 0, info.insts_ });
+            count++;
+        }
+
+        return count;
+    }
+
+    void dyncom_block_cache::drop(const std::uint32_t key) {
+        fast_lookup_entry &entry = fast_lookup_[fast_lookup_index(key)];
+
+        if (entry.key_ == key) {
+            entry.offset_ = NOT_FOUND;
+        }
+
+        blocks_.erase(key);
+    }
+
+    std::size_t dyncom_block_cache::invalidate(const address addr, const std::size_t size) {
+        if (!size) {
+            return 0;
+        }
+
+        const std::uint64_t end = static_cast<std::uint64_t>(addr) + size;
+        const std::uint64_t first_page = addr >> PAGE_BITS;
+        const std::uint64_t last_page = (end - 1) >> PAGE_BITS;
+
+        auto overlaps = [addr, end](const block_info &info) {
+            return (info.start_ < end) && (info.end_ > addr);
+        };
+
+        std::size_t dropped = 0;
+
+        if (last_page - first_page >= MAX_PAGE_WALK) {
+            // Mostly whole chunks being unmapped. Page lists of other pages may keep the dropped keys,
+            // those are skipped when their page is walked.
+            for (auto ite = blocks_.begin(); ite != blocks_.end();) {
+                if (overlaps(ite->second)) {
+                    fast_lookup_entry &entry = fast_lookup_[fast_lookup_index(ite->first)];
+                    if (entry.key_ == ite->first) {
+                        entry.offset_ = NOT_FOUND;
+                    }
+
+                    ite = blocks_.erase(ite);
+                    dropped++;
+                } else {
+                    ite++;
+                }
+            }
+
+            for (auto ite = page_blocks_.begin(); ite != page_blocks_.end();) {
+                if ((ite->first >= first_page) && (ite->first <= last_page)) {
+                    ite = page_blocks_.erase(ite);
+                } else {
+                    ite++;
+                }
+            }
+
+            return dropped;
+        }
+
+        for (std::uint64_t page = first_page; page <= last_page; page++) {
+            auto page_ite = page_blocks_.find(static_cast<std::uint32_t>(page));
+            if (page_ite == page_blocks_.end()) {
+                continue;
+            }
+
+            std::vector<std::uint32_t> &keys = page_ite->second;
+
+            keys.erase(std::remove_if(keys.begin(), keys.end(), [&](const std::uint32_t key) {
+                auto block_ite = blocks_.find(key);
+                if (block_ite == blocks_.end()) {
+                    return true;
+                }
+
+                if (!overlaps(block_ite->second)) {
+                    return false;
+                }
+
+                drop(key);
+                dropped++;
+
+                return true;
+            }),
+                keys.end());
+
+            if (keys.empty()) {
+                page_blocks_.erase(page_ite);
+            }
+        }
+
+        return dropped;
+    }
+
+    void dyncom_block_cache::clear() {
+        fast_lookup_.fill(fast_lookup_entry{});
+        blocks_.clear();
+        page_blocks_.clear();
+    }
+}
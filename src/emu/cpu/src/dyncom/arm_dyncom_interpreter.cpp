@@ -6,6 +6,7 @@
 
 #include <algorithm>
 #include <cinttypes>
+#include <common/algorithm.h>
 #include <common/log.h>
 #include <common/types.h>
 #include <cpu/dyncom/arm_dyncom_dec.h>
@@ -791,6 +792,9 @@ static ThumbDecodeStatus decode_thumb_instruction(ARMul_State *cpu, std::uint32_
             ret = ThumbDecodeStatus::UNDEFINED;
             break;
         }
+
+        // Branch handlers take the Thumb instruction itself
+        *arm_inst = tinstr;
     }
     return ret;
 }
@@ -798,22 +802,86 @@ static ThumbDecodeStatus decode_thumb_instruction(ARMul_State *cpu, std::uint32_
 enum { KEEP_GOING,
     FETCH_EXCEPTION };
 
+// Translates the Thumb idioms that have their own handler. Returns the size of the guest code taken,
+// or zero if the instruction is not one of them.
+static unsigned int InterpreterTranslateThumbFused(ARMul_State *cpu, const std::uint32_t inst, const std::uint32_t phys_addr,
+    ARM_INST_PTR &inst_base, std::uint32_t &handler_word) {
+    const std::uint32_t tinst = GetThumbInstruction(inst, phys_addr);
+
+    std::uint32_t fused_inst = tinst;
+    unsigned int fused_size = 2;
+    ThumbFusedOp op;
+
+    if ((tinst & 0xFE00) == 0xB400) {
+        op = ThumbFusedOp::PUSH;
+    } else if ((tinst & 0xFE00) == 0xBC00) {
+        op = ThumbFusedOp::POP;
+    } else if ((tinst & 0xF800) == 0x4800) {
+        op = ThumbFusedOp::LDR_LITERAL;
+    } else if ((tinst & 0xF800) == 0x2800) {
+        // CMP with immediate, fused with a conditional branch right after it on the same page
+        const std::uint32_t next_addr = phys_addr + 2;
+        if ((next_addr & 0xFFF) == 0) {
+            return 0;
+        }
+
+        const std::uint32_t next_word = (next_addr & 2) ? inst : cpu->ReadCode(next_addr & 0xFFFFFFFC);
+        const std::uint32_t branch = GetThumbInstruction(next_word, next_addr);
+
+        // Condition 0b1110 is undefined and 0b1111 is SWI
+        if (((branch & 0xF000) != 0xD000) || (((branch >> 8) & 0xF) >= 0xE)) {
+            return 0;
+        }
+
+        fused_inst = tinst | (branch << 16);
+        fused_size = 4;
+        op = ThumbFusedOp::CMP_BRANCH;
+    } else {
+        return 0;
+    }
+
+    const int idx = static_cast<int>(arm_instruction_trans_len) + static_cast<int>(op);
+    inst_base = thumb_fused_trans[static_cast<int>(op)](cpu, fused_inst, phys_addr, idx);
+    handler_word = fused_inst;
+
+    return fused_size;
+}
+
+// Translates one instruction, and records how it was decoded so the block can be loaded again later
 static unsigned int InterpreterTranslateInstruction(ARMul_State *cpu, const std::uint32_t phys_addr,
-    ARM_INST_PTR &inst_base) {
+    ARM_INST_PTR &inst_base, eka2l1::arm::decoded_inst_info &decoded) {
     std::uint32_t inst_size = 4;
     std::uint32_t inst = cpu->ReadCode(phys_addr & 0xFFFFFFFC);
 
     // If we are in Thumb mode, we'll translate one Thumb instruction to the corresponding ARM
     // instruction
     if (cpu->TFlag) {
+        std::uint32_t handler_word = 0;
+
+        const unsigned int fused_size = InterpreterTranslateThumbFused(cpu, inst, phys_addr, inst_base, handler_word);
+        if (fused_size != 0) {
+            // Fused idioms are given their guest code as is
+            decoded = { handler_word, handler_word, static_cast<std::uint16_t>(inst_base->idx), static_cast<std::uint16_t>(fused_size) };
+            return fused_size;
+        }
+
         std::uint32_t arm_inst;
         ThumbDecodeStatus state = decode_thumb_instruction(cpu, inst, phys_addr, &arm_inst, &inst_size, &inst_base);
 
+        decoded.code_ = GetThumbInstruction(inst, phys_addr);
+        decoded.size_ = static_cast<std::uint16_t>(inst_size);
+
         // We have translated the Thumb branch instruction in the Thumb decoder
         if (state == ThumbDecodeStatus::BRANCH) {
+            decoded.word_ = arm_inst;
+            decoded.handler_ = static_cast<std::uint16_t>(inst_base->idx);
+
             return inst_size;
         }
         inst = arm_inst;
+    } else {
+        decoded.code_ = inst;
+        decoded.size_ = static_cast<std::uint16_t>(inst_size);
     }
 
     int idx;
@@ -826,6 +894,9 @@ static unsigned int InterpreterTranslateInstruction(ARMul_State *cpu, const std:
     }
     inst_base = arm_instruction_trans[idx](cpu, inst, idx);
 
+    decoded.word_ = inst;
+    decoded.handler_ = static_cast<std::uint16_t>(idx);
+
     return inst_size;
 }
 
@@ -842,8 +913,10 @@ static int InterpreterTranslateBlock(ARMul_State *cpu, std::size_t &bb_start, st
     std::uint32_t phys_addr = addr;
     std::uint32_t pc_start = cpu->Reg[15];
 
+    std::vector<eka2l1::arm::decoded_inst_info> insts;
+
     while (ret == TransExtData::NON_BRANCH) {
-        unsigned int inst_size = InterpreterTranslateInstruction(cpu, phys_addr, inst_base);
+        unsigned int inst_size = InterpreterTranslateInstruction(cpu, phys_addr, inst_base, insts.emplace_back());
 
         size++;
 
@@ -855,7 +928,7 @@ static int InterpreterTranslateBlock(ARMul_State *cpu, std::size_t &bb_start, st
         ret = inst_base->br;
     };
 
-    cpu->instruction_cache[pc_start] = bb_start;
+    cpu->block_cache.add(pc_start | (cpu->TFlag ? 1 : 0), phys_addr, bb_start, std::move(insts));
 
     return KEEP_GOING;
 }
@@ -865,19 +938,71 @@ static int InterpreterTranslateSingle(ARMul_State *cpu, std::size_t &bb_start, s
     bb_start = cpu->trans_cache_buf_top;
 
     std::uint32_t phys_addr = addr;
-    std::uint32_t pc_start = cpu->Reg[15];
+    eka2l1::arm::decoded_inst_info decoded;
 
-    InterpreterTranslateInstruction(cpu, phys_addr, inst_base);
+    InterpreterTranslateInstruction(cpu, phys_addr, inst_base, decoded);
 
     if (inst_base->br == TransExtData::NON_BRANCH) {
         inst_base->br = TransExtData::SINGLE_STEP;
     }
 
-    cpu->instruction_cache[pc_start] = bb_start;
-
+    // Not cached, a block found later at this address would only run one instruction
     return KEEP_GOING;
 }
 
+bool InterpreterLoadBlock(ARMul_State *cpu, const std::uint32_t addr, const bool thumb,
+    const std::vector<eka2l1::arm::decoded_inst_info> &insts) {
+    const std::uint32_t block_key = addr | (thumb ? 1 : 0);
+    const std::size_t handler_count = arm_instruction_trans_len + static_cast<std::size_t>(ThumbFusedOp::COUNT);
+
+    if (insts.empty() || (cpu->block_cache.find(block_key) != eka2l1::arm::dyncom_block_cache::NOT_FOUND)) {
+        return false;
+    }
+
+    if (cpu->trans_cache_buf_top + TRANS_CACHE_FLUSH_MARGIN > TRANS_CACHE_SIZE) {
+        return false;
+    }
+
+    for (const eka2l1::arm::decoded_inst_info &decoded : insts) {
+        if (decoded.handler_ >= handler_count) {
+            return false;
+        }
+    }
+
+    const std::size_t bb_start = cpu->trans_cache_buf_top;
+    std::uint32_t phys_addr = addr;
+
+    for (std::size_t i = 0; i < insts.size(); i++) {
+        const eka2l1::arm::decoded_inst_info &decoded = insts[i];
+        const int idx = decoded.handler_;
+
+        ARM_INST_PTR inst_base = nullptr;
+
+        if (idx < static_cast<int>(arm_instruction_trans_len)) {
+            inst_base = arm_instruction_trans[idx](cpu, decoded.word_, idx);
+        } else {
+            inst_base = thumb_fused_trans[idx - static_cast<int>(arm_instruction_trans_len)](cpu, decoded.word_, phys_addr, idx);
+        }
+
+        phys_addr += decoded.size_;
+
+        if ((phys_addr & 0xfff) == 0) {
+            inst_base->br = TransExtData::END_OF_PAGE;
+        }
+
+        // Only the last instruction may leave the block, and it must
+        const bool is_last = (i + 1 == insts.size());
+
+        if ((inst_base->br == TransExtData::NON_BRANCH) == is_last) {
+            cpu->trans_cache_buf_top = bb_start;
+            return false;
+        }
+    }
+
+    cpu->block_cache.add(block_key, phys_addr, bb_start, insts);
+    return true;
+}
+
 static int clz(unsigned int x) {
     int n;
     if (x == 0)
@@ -1349,10 +1474,18 @@ unsigned InterpreterMainLoop(ARMul_State *cpu, std::uint32_t &num_instrs) {
     case 201:                                  \
         goto BLX_1_THUMB;                      \
     case 202:                                  \
-        goto DISPATCH;                         \
+        goto PUSH_THUMB;                       \
     case 203:                                  \
-        goto INIT_INST_LENGTH;                 \
+        goto POP_THUMB;                        \
     case 204:                                  \
+        goto LDR_LIT_THUMB;                    \
+    case 205:                                  \
+        goto CMP_B_COND_THUMB;                 \
+    case 206:                                  \
+        goto DISPATCH;                         \
+    case 207:                                  \
+        goto INIT_INST_LENGTH;                 \
+    case 208:                                  \
         goto END;                              \
     }
 #endif
@@ -1578,6 +1711,10 @@ unsigned InterpreterMainLoop(ARMul_State *cpu, std::uint32_t &num_instrs) {
         &&BL_1_THUMB,
         &&BL_2_THUMB,
         &&BLX_1_THUMB,
+        &&PUSH_THUMB,
+        &&POP_THUMB,
+        &&LDR_LIT_THUMB,
+        &&CMP_B_COND_THUMB,
         &&DISPATCH,
         &&INIT_INST_LENGTH,
         &&END };
@@ -1586,6 +1723,7 @@ unsigned InterpreterMainLoop(ARMul_State *cpu, std::uint32_t &num_instrs) {
     unsigned int addr;
 
     std::size_t ptr;
+    std::uint32_t block_key;
 
     LOAD_NZCVT;
 DISPATCH : {
@@ -1600,16 +1738,35 @@ DISPATCH : {
     else
         cpu->Reg[15] &= 0xfffffffc;
 
-    // Find the cached instruction cream, otherwise translate it...
-    auto itr = cpu->instruction_cache.find(cpu->Reg[15]);
-    if (itr != cpu->instruction_cache.end()) {
-        ptr = itr->second;
-    } else if (cpu->NumInstrsToExecute != 1) {
-        if (InterpreterTranslateBlock(cpu, ptr, cpu->Reg[15]) == FETCH_EXCEPTION)
-            goto END;
-    } else {
-        if (InterpreterTranslateSingle(cpu, ptr, cpu->Reg[15]) == FETCH_EXCEPTION)
+    block_key = cpu->Reg[15] | (cpu->TFlag ? 1 : 0);
+
+    if (cpu->hot_block_threshold) {
+        if ((num_instrs != 0) && cpu->handover_blocks.count(block_key)) {
             goto END;
+        }
+
+        if (++cpu->block_hits[block_key] == cpu->hot_block_threshold) {
+            cpu->hot_blocks.push_back(block_key);
+        }
+    }
+
+    // Find the cached instruction cream, otherwise translate it...
+    ptr = cpu->block_cache.find(block_key);
+
+    if (ptr == eka2l1::arm::dyncom_block_cache::NOT_FOUND) {
+        if (cpu->trans_cache_buf_top + TRANS_CACHE_FLUSH_MARGIN > TRANS_CACHE_SIZE) {
+            // Dropped blocks are never reclaimed one by one, start over once the buffer is full
+            cpu->block_cache.clear();
+            cpu->trans_cache_buf_top = 0;
+        }
+
+        if (cpu->NumInstrsToExecute != 1) {
+            if (InterpreterTranslateBlock(cpu, ptr, cpu->Reg[15]) == FETCH_EXCEPTION)
+                goto END;
+        } else {
+            if (InterpreterTranslateSingle(cpu, ptr, cpu->Reg[15]) == FETCH_EXCEPTION)
+                goto END;
+        }
     }
 
     inst_base = (arm_inst *)&cpu->trans_cache_buf[ptr];
@@ -4307,6 +4464,82 @@ BLX_1_THUMB : {
     INC_PC(sizeof(blx_1_thumb));
     goto DISPATCH;
 }
+PUSH_THUMB : {
+    push_pop_thumb *inst_cream = (push_pop_thumb *)inst_base->component;
+    addr = cpu->Reg[13] - (inst_cream->count << 2);
+    cpu->Reg[13] = addr;
+
+    for (std::uint32_t list = inst_cream->reg_list; list != 0; list &= list - 1) {
+        cpu->WriteMemory32(addr, cpu->Reg[eka2l1::common::find_least_significant_bit_one(list)]);
+        addr += 4;
+    }
+
+    cpu->Reg[15] += 2;
+    INC_PC(sizeof(push_pop_thumb));
+    FETCH_INST;
+    GOTO_NEXT_INST;
+}
+POP_THUMB : {
+    push_pop_thumb *inst_cream = (push_pop_thumb *)inst_base->component;
+    addr = cpu->Reg[13];
+    cpu->Reg[13] = addr + (inst_cream->count << 2);
+
+    for (std::uint32_t list = inst_cream->reg_list & 0xFF; list != 0; list &= list - 1) {
+        cpu->Reg[eka2l1::common::find_least_significant_bit_one(list)] = cpu->ReadMemory32(addr);
+        addr += 4;
+    }
+
+    if (inst_cream->reg_list & (1 << 15)) {
+        // For armv5t, should enter thumb when bits[0] is non-zero.
+        const std::uint32_t value = cpu->ReadMemory32(addr);
+        cpu->TFlag = value & 0x1;
+        cpu->Reg[15] = value & 0xFFFFFFFE;
+        INC_PC(sizeof(push_pop_thumb));
+        goto DISPATCH;
+    }
+
+    cpu->Reg[15] += 2;
+    INC_PC(sizeof(push_pop_thumb));
+    FETCH_INST;
+    GOTO_NEXT_INST;
+}
+LDR_LIT_THUMB : {
+    ldr_lit_thumb *inst_cream = (ldr_lit_thumb *)inst_base->component;
+    RD = cpu->ReadMemory32(inst_cream->addr);
+
+    cpu->Reg[15] += 2;
+    INC_PC(sizeof(ldr_lit_thumb));
+    FETCH_INST;
+    GOTO_NEXT_INST;
+}
+CMP_B_COND_THUMB : {
+    cmp_b_cond_thumb *inst_cream = (cmp_b_cond_thumb *)inst_base->component;
+
+    bool carry;
+    bool overflow;
+    std::uint32_t result = AddWithCarry(RN, ~inst_cream->imm, 1, &carry, &overflow);
+
+    UPDATE_NFLAG(result);
+    UPDATE_ZFLAG(result);
+    cpu->CFlag = carry;
+    cpu->VFlag = overflow;
+
+    // Two instructions are counted. If the budget ends between them, stop on the branch.
+    if (num_instrs >= cpu->NumInstrsToExecute) {
+        cpu->Reg[15] += 2;
+        goto END;
+    }
+
+    num_instrs++;
+
+    if (CondPassed(cpu, inst_cream->cond))
+        cpu->Reg[15] = cpu->Reg[15] + 6 + inst_cream->branch_imm;
+    else
+        cpu->Reg[15] += 4;
+
+    INC_PC(sizeof(cmp_b_cond_thumb));
+    goto DISPATCH;
+}
 
 UQADD8_INST:
 UQADD16_INST:
@@ -1,4 +1,5 @@
 #include <cassert>
+#include <common/algorithm.h>
 #include <common/log.h>
 #include <common/types.h>
 #include <cpu/dyncom/arm_dyncom_trans.h>
@@ -1695,6 +1696,61 @@ static ARM_INST_PTR INTERPRETER_TRANSLATE(blx_1_thumb)(ARMul_State *state, unsig
     return inst_base;
 }
 
+static ARM_INST_PTR INTERPRETER_TRANSLATE(push_thumb)(ARMul_State *state, unsigned int tinst, std::uint32_t addr, int index) {
+    arm_inst *inst_base = (arm_inst *)AllocBuffer(state, sizeof(arm_inst) + sizeof(push_pop_thumb));
+    push_pop_thumb *inst_cream = (push_pop_thumb *)inst_base->component;
+
+    inst_cream->reg_list = (tinst & 0xFF) | (BIT(tinst, 8) << 14);
+    inst_cream->count = eka2l1::common::count_bit_set(inst_cream->reg_list);
+
+    inst_base->cond = ConditionCode::AL;
+    inst_base->idx = index;
+    inst_base->br = TransExtData::NON_BRANCH;
+    return inst_base;
+}
+static ARM_INST_PTR INTERPRETER_TRANSLATE(pop_thumb)(ARMul_State *state, unsigned int tinst, std::uint32_t addr, int index) {
+    arm_inst *inst_base = (arm_inst *)AllocBuffer(state, sizeof(arm_inst) + sizeof(push_pop_thumb));
+    push_pop_thumb *inst_cream = (push_pop_thumb *)inst_base->component;
+
+    inst_cream->reg_list = (tinst & 0xFF) | (BIT(tinst, 8) << 15);
+    inst_cream->count = eka2l1::common::count_bit_set(inst_cream->reg_list);
+
+    inst_base->cond = ConditionCode::AL;
+    inst_base->idx = index;
+    inst_base->br = BIT(tinst, 8) ? TransExtData::INDIRECT_BRANCH : TransExtData::NON_BRANCH;
+    return inst_base;
+}
+static ARM_INST_PTR INTERPRETER_TRANSLATE(ldr_lit_thumb)(ARMul_State *state, unsigned int tinst, std::uint32_t addr, int index) {
+    arm_inst *inst_base = (arm_inst *)AllocBuffer(state, sizeof(arm_inst) + sizeof(ldr_lit_thumb));
+    ldr_lit_thumb *inst_cream = (ldr_lit_thumb *)inst_base->component;
+
+    // The literal is relative to the word-aligned PC, which is known at translation time
+    inst_cream->Rd = BITS(tinst, 8, 10);
+    inst_cream->addr = ((addr + 4) & 0xFFFFFFFC) + ((tinst & 0xFF) << 2);
+
+    inst_base->cond = ConditionCode::AL;
+    inst_base->idx = index;
+    inst_base->br = TransExtData::NON_BRANCH;
+    return inst_base;
+}
+static ARM_INST_PTR INTERPRETER_TRANSLATE(cmp_b_cond_thumb)(ARMul_State *state, unsigned int tinst, std::uint32_t addr, int index) {
+    arm_inst *inst_base = (arm_inst *)AllocBuffer(state, sizeof(arm_inst) + sizeof(cmp_b_cond_thumb));
+    cmp_b_cond_thumb *inst_cream = (cmp_b_cond_thumb *)inst_base->component;
+
+    // Low half is the CMP, high half is the conditional branch following it
+    const unsigned int branch = tinst >> 16;
+
+    inst_cream->Rn = BITS(tinst, 8, 10);
+    inst_cream->imm = tinst & 0xFF;
+    inst_cream->cond = (branch >> 8) & 0xF;
+    inst_cream->branch_imm = ((branch & 0x7F) << 1) | ((branch & (1 << 7)) ? 0xFFFFFF00 : 0);
+
+    inst_base->cond = ConditionCode::AL;
+    inst_base->idx = index;
+    inst_base->br = TransExtData::DIRECT_BRANCH;
+    return inst_base;
+}
+
 static ARM_INST_PTR INTERPRETER_TRANSLATE(uqadd8)(ARMul_State *state, unsigned int inst, int index) {
     arm_inst *const inst_base = (arm_inst *)AllocBuffer(state, sizeof(arm_inst) + sizeof(generic_arm_inst));
     generic_arm_inst *const inst_cream = (generic_arm_inst *)inst_base->component;
@@ -2014,3 +2070,12 @@ const transop_fp_t arm_instruction_trans[] = {
 };
 
 const std::size_t arm_instruction_trans_len = sizeof(arm_instruction_trans) / sizeof(transop_fp_t);
+
+const thumb_fused_transop_fp_t thumb_fused_trans[] = {
+    INTERPRETER_TRANSLATE(push_thumb),
+    INTERPRETER_TRANSLATE(pop_thumb),
+    INTERPRETER_TRANSLATE(ldr_lit_thumb),
+    INTERPRETER_TRANSLATE(cmp_b_cond_thumb),
+};
+
+static_assert(sizeof(thumb_fused_trans) / sizeof(thumb_fused_transop_fp_t) == static_cast<std::size_t>(ThumbFusedOp::COUNT));
@@ -75,6 +75,7 @@ namespace eka2l1::drivers {
         GLuint sprite_vao;
         GLuint sprite_vbo;
         GLuint sprite_ibo;
+        GLuint sprite_batch_ibo;
 
         GLuint brush_vao;
         GLuint brush_vbo;
@@ -155,6 +156,7 @@ namespace eka2l1::drivers {
 
         void clear(command &cmd);
         void draw_bitmap(command &cmd);
+        void draw_bitmaps(command &cmd);
         void draw_rectangle(command &cmd);
         void clip_rect(command &cmd);
         void clip_region(command &cmd);
@@ -66,6 +66,7 @@ namespace eka2l1::drivers {
         graphics_driver_resize_bitmap,
         graphics_driver_read_bitmap,
         graphics_driver_clip_region,
+        graphics_driver_draw_bitmaps,
 
         // Mode 1: Advance - Lower access to functions
         graphics_driver_create_shader_module,
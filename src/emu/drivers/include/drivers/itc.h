@@ -321,6 +321,23 @@ namespace eka2l1::drivers {
 
         void resize_bitmap(drivers::handle h, const eka2l1::vec2 &new_size);
 
+        /**
+         * \brief Read a region of a bitmap back to host memory, without waiting for it.
+         *
+         * The read happens when the command list is executed. The buffer must stay alive until then, and
+         * the status is set under the driver's lock once the data is in the buffer: 1 on success, 0 on failure.
+         * Rows are aligned to 4 bytes.
+         *
+         * \param h           The handle to the bitmap to read.
+         * \param pos         The top-left of the region to read.
+         * \param size        The size of the region to read.
+         * \param bpp         The bits per pixel to read the data in. Same as the synchronous read_bitmap.
+         * \param buffer_ptr  The buffer to read the data to.
+         * \param status      Pointer to the status to notify. It must be -100 when queued.
+         */
+        void read_bitmap(drivers::handle h, const eka2l1::point &pos, const eka2l1::object_size &size,
+            const std::uint32_t bpp, std::uint8_t *buffer_ptr, int *status);
+
         /**
          * \brief Update a bitmap' data region.
          *
@@ -379,6 +396,21 @@ namespace eka2l1::drivers {
             const eka2l1::rect &source_rect, const eka2l1::vec2 &origin = eka2l1::vec2(0, 0),
             const float rotation = 0.0f, const std::uint32_t flags = 0);
 
+        /**
+         * \brief Draw many regions of a bitmap to currently binded bitmap in one call.
+         *
+         * Each pair of rectangles is drawn as with draw_bitmap, with no mask and no rotation. The rectangles
+         * are copied, so the arrays can be freed right after.
+         *
+         * \param h             The handle of the bitmap to blit.
+         * \param dest_rects    The destination rectangles on the screen.
+         * \param source_rects  The source rectangles to strip, one for each destination.
+         * \param count         Number of rectangles in each array.
+         * \param flags         Drawing flags. Only bitmap_draw_flag_use_brush is respected.
+         */
+        void draw_bitmaps(drivers::handle h, const eka2l1::rect *dest_rects, const eka2l1::rect *source_rects,
+            const std::size_t count, const std::uint32_t flags = 0);
+
         /**
          * \brief Draw a rectangle with brush color.
          * 
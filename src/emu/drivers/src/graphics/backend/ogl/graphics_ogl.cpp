@@ -198,11 +198,11 @@ namespace eka2l1::drivers {
 
         GLuint vao_to_del[3] = { sprite_vao, brush_vao, pen_vao };
         GLuint vbo_to_del[3] = { sprite_vbo, brush_vbo, pen_vbo };
-        GLuint ibo_to_del[2] = { sprite_ibo, pen_ibo };
+        GLuint ibo_to_del[3] = { sprite_ibo, sprite_batch_ibo, pen_ibo };
 
         glDeleteVertexArrays(3, vao_to_del);
         glDeleteBuffers(3, vbo_to_del);
-        glDeleteBuffers(2, ibo_to_del);
+        glDeleteBuffers(3, ibo_to_del);
     }
 
     bool ogl_graphics_driver::support_extension(const graphics_driver_extension ext) {
@@ -248,6 +248,9 @@ namespace eka2l1::drivers {
     static constexpr const char *pen_v_path = "resources//pen.vert";
     static constexpr const char *pen_f_path = "resources//pen.frag";
 
+    // Quads of one batched bitmap draw that fit the 16-bit index buffer
+    static constexpr std::size_t SPRITE_BATCH_MAX_QUADS = 4096;
+
     void ogl_graphics_driver::do_init() {
         auto sprite_norm_vertex_module = std::make_unique<ogl_shader_module>(sprite_norm_v_path, shader_module_type::vertex);        
         auto brush_vertex_module = std::make_unique<ogl_shader_module>(brush_v_path, shader_module_type::vertex);
@@ -327,6 +330,20 @@ namespace eka2l1::drivers {
         glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 
+        // Quads of a batched draw share the sprite winding, offset by four vertices each
+        std::vector<GLushort> batch_indices(SPRITE_BATCH_MAX_QUADS * 6);
+
+        for (std::size_t i = 0; i < SPRITE_BATCH_MAX_QUADS; i++) {
+            for (std::size_t j = 0; j < 6; j++) {
+                batch_indices[i * 6 + j] = static_cast<GLushort>(i * 4 + indices[j]);
+            }
+        }
+
+        glGenBuffers(1, &sprite_batch_ibo);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, sprite_batch_ibo);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, batch_indices.size() * sizeof(GLushort), batch_indices.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
         glGenBuffers(1, &pen_ibo);
 
         color_loc = sprite_program->get_uniform_location("u_color").value_or(-1);
@@ -744,6 +761,111 @@ namespace eka2l1::drivers {
         glBindVertexArray(0);
     }
 
+    void ogl_graphics_driver::draw_bitmaps(command &cmd) {
+        drivers::handle to_draw = static_cast<drivers::handle>(cmd.data_[0]);
+        const std::size_t count = static_cast<std::size_t>(cmd.data_[1]);
+        eka2l1::rect *rects = reinterpret_cast<eka2l1::rect *>(cmd.data_[2]);
+        const std::uint32_t flags = static_cast<std::uint32_t>(cmd.data_[3]);
+
+        if (!sprite_program) {
+            do_init();
+        }
+
+        bitmap *bmp = get_bitmap(to_draw);
+        texture *draw_texture = nullptr;
+
+        if (!bmp) {
+            draw_texture = reinterpret_cast<texture *>(get_graphics_object(to_draw));
+        } else {
+            draw_texture = bmp->tex.get();
+        }
+
+        if (!draw_texture) {
+            LOG_ERROR(DRIVER_GRAPHICS, "Invalid bitmap handle to draw");
+            delete[] rects;
+
+            return;
+        }
+
+        const eka2l1::rect *dest_rects = rects;
+        const eka2l1::rect *source_rects = rects + count;
+
+        const eka2l1::vec2 tex_size = draw_texture->get_size();
+        const float texel_width = 1.0f / tex_size.x;
+        const float texel_height = 1.0f / tex_size.y;
+
+        // Same corners as draw_bitmap, but already placed on the target, so one model matrix fits all quads
+        static const float corners[4][2] = {
+            { 0.0f, 1.0f },
+            { 1.0f, 0.0f },
+            { 0.0f, 0.0f },
+            { 1.0f, 1.0f }
+        };
+
+        std::vector<GLfloat> verts(count * 4 * 4);
+        GLfloat *vert = verts.data();
+
+        for (std::size_t i = 0; i < count; i++) {
+            eka2l1::rect source_rect = source_rects[i];
+            eka2l1::rect dest_rect = dest_rects[i];
+
+            if (source_rect.empty()) {
+                source_rect.top = eka2l1::vec2(0, 0);
+                source_rect.size = tex_size;
+            }
+
+            if (dest_rect.size.x == 0) {
+                dest_rect.size.x = source_rect.size.x;
+            }
+
+            if (dest_rect.size.y == 0) {
+                dest_rect.size.y = source_rect.size.y;
+            }
+
+            for (std::size_t j = 0; j < 4; j++) {
+                *vert++ = dest_rect.top.x + corners[j][0] * dest_rect.size.x;
+                *vert++ = dest_rect.top.y + corners[j][1] * dest_rect.size.y;
+                *vert++ = (source_rect.top.x + corners[j][0] * source_rect.size.x) * texel_width;
+                *vert++ = (source_rect.top.y + corners[j][1] * source_rect.size.y) * texel_height;
+            }
+        }
+
+        delete[] rects;
+
+        sprite_program->use(this);
+
+        glBindVertexArray(sprite_vao);
+        glBindBuffer(GL_ARRAY_BUFFER, sprite_vbo);
+        glBufferData(GL_ARRAY_BUFFER, verts.size() * sizeof(GLfloat), verts.data(), GL_STREAM_DRAW);
+
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, static_cast<GLuint>(draw_texture->driver_handle()));
+
+        const glm::mat4 model_matrix = glm::identity<glm::mat4>();
+        const GLfloat color[] = { 255.0f, 255.0f, 255.0f, 255.0f };
+
+        glUniformMatrix4fv(model_loc, 1, false, glm::value_ptr(model_matrix));
+        glUniformMatrix4fv(proj_loc, 1, false, glm::value_ptr(projection_matrix));
+        glUniform4fv(color_loc, 1, (flags & bitmap_draw_flag_use_brush) ? brush_color.elements.data() : color);
+
+        glEnableVertexAttribArray(in_position_loc);
+        glEnableVertexAttribArray(in_texcoord_loc);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, sprite_batch_ibo);
+
+        // The index buffer covers a limited number of quads, move the attribute base for the rest
+        for (std::size_t first = 0; first < count; first += SPRITE_BATCH_MAX_QUADS) {
+            const std::size_t quad_count = common::min<std::size_t>(count - first, SPRITE_BATCH_MAX_QUADS);
+            const std::size_t base_offset = first * 4 * 4 * sizeof(GLfloat);
+
+            glVertexAttribPointer(in_position_loc, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(GLfloat), (GLvoid *)(base_offset));
+            glVertexAttribPointer(in_texcoord_loc, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(GLfloat), (GLvoid *)(base_offset + 2 * sizeof(GLfloat)));
+
+            glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(quad_count * 6), GL_UNSIGNED_SHORT, 0);
+        }
+
+        glBindVertexArray(0);
+    }
+
     void ogl_graphics_driver::clip_rect(command &cmd) {
         eka2l1::rect clip_rect;
         unpack_u64_to_2u32(cmd.data_[0], clip_rect.top.x, clip_rect.top.y);
@@ -1740,6 +1862,11 @@ namespace eka2l1::drivers {
             break;
         }
 
+        case graphics_driver_draw_bitmaps: {
+            draw_bitmaps(cmd);
+            break;
+        }
+
         case graphics_driver_clip_rect:
         case graphics_driver_clip_bitmap_rect: {
             clip_rect(cmd);
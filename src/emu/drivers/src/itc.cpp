@@ -22,6 +22,7 @@
 #include <drivers/graphics/graphics.h>
 #include <drivers/itc.h>
 
+#include <algorithm>
 #include <chrono>
 #include <cstring>
 
@@ -309,6 +310,18 @@ namespace eka2l1::drivers {
         cmd->data_[1] = PACK_2U32_TO_U64(new_size.x, new_size.y);
     }
 
+    void graphics_command_builder::read_bitmap(drivers::handle h, const eka2l1::point &pos, const eka2l1::object_size &size,
+        const std::uint32_t bpp, std::uint8_t *buffer_ptr, int *status) {
+        command *cmd = list_.retrieve_next();
+        cmd->opcode_ = graphics_driver_read_bitmap;
+        cmd->data_[0] = h;
+        cmd->data_[1] = PACK_2U32_TO_U64(pos.x, pos.y);
+        cmd->data_[2] = PACK_2U32_TO_U64(size.x, size.y);
+        cmd->data_[3] = bpp;
+        cmd->data_[4] = reinterpret_cast<std::uint64_t>(buffer_ptr);
+        cmd->status_ = status;
+    }
+
     void graphics_command_builder::update_bitmap(drivers::handle h, const char *data, const std::size_t size,
         const eka2l1::vec2 &offset, const eka2l1::vec2 &dim, const std::size_t pixels_per_line, const bool need_copy) {
         // Copy data
@@ -356,6 +369,26 @@ namespace eka2l1::drivers {
         cmd->data_[7] = (static_cast<std::uint64_t>(flags) << 32) | *reinterpret_cast<const std::uint32_t*>(&rotation);
     }
 
+    void graphics_command_builder::draw_bitmaps(drivers::handle h, const eka2l1::rect *dest_rects, const eka2l1::rect *source_rects,
+        const std::size_t count, const std::uint32_t flags) {
+        if (!count) {
+            return;
+        }
+
+        // Destinations first, then sources. The driver frees the list after drawing
+        eka2l1::rect *rects_copied = new eka2l1::rect[count * 2];
+        std::copy(dest_rects, dest_rects + count, rects_copied);
+        std::copy(source_rects, source_rects + count, rects_copied + count);
+
+        command *cmd = list_.retrieve_next();
+        cmd->opcode_ = graphics_driver_draw_bitmaps;
+
+        cmd->data_[0] = h;
+        cmd->data_[1] = count;
+        cmd->data_[2] = reinterpret_cast<std::uint64_t>(rects_copied);
+        cmd->data_[3] = flags;
+    }
+
     void graphics_command_builder::bind_bitmap(const drivers::handle h) {
         command *cmd = list_.retrieve_next();
 
@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) 2022 EKA2L1 Team.
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <common/types.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace eka2l1::common {
+    class bytepair_page_store;
+}
+
+namespace eka2l1::kernel {
+    class chunk;
+    class codeseg;
+    class process;
+
+    struct paged_code_fixup {
+        std::uint32_t offset_;
+        std::uint32_t value_;
+    };
+
+    /**
+     * @brief Code chunk of an attached codeseg, which text pages are only filled when touched.
+     *
+     * Imports and relocations that land on a paged page are kept here, grouped by page, until
+     * the page is filled.
+     */
+    struct paged_code_info {
+        kernel::codeseg *seg_;
+
+        // Null when the chunk is shared by every process
+        kernel::process *owner_;
+        kernel::chunk *code_chunk_;
+
+        address run_addr_;
+        std::uint32_t code_delta_;
+        std::uint32_t data_delta_;
+
+        std::vector<std::vector<paged_code_fixup>> page_imports_;
+        std::vector<std::vector<std::uint64_t>> page_relocations_;
+        std::vector<bool> filled_;
+        std::uint32_t pages_left_;
+    };
+
+    /**
+     * @brief Fill text pages of loaded images on first touch.
+     *
+     * Bytepair compressed images keep their text compressed until the guest accesses it. The access
+     * faults, and the kernel asks the pager to commit, decompress and fix up the page before the access
+     * is retried.
+     *
+     * On each fault, the pages that follow are queued to a worker thread, which decompresses them ahead
+     * into a small staging area. Committing and fixing up pages is always done on the faulting thread.
+     *
+     * Faults may come from several cores at once, so the ranges and their fill state are only touched
+     * with the range lock held.
+     */
+    class code_pager {
+    private:
+        using staged_key = std::pair<const common::bytepair_page_store *, std::uint32_t>;
+
+        struct prefetch_request {
+            std::shared_ptr<common::bytepair_page_store> store_;
+            std::uint32_t page_;
+        };
+
+        std::vector<paged_code_info *> ranges_;
+        std::mutex ranges_lock_;
+
+        std::uint32_t read_ahead_pages_;
+
+        std::thread prefetch_thread_;
+        std::mutex prefetch_lock_;
+        std::condition_variable prefetch_cond_;
+
+        std::deque<prefetch_request> prefetch_queue_;
+        std::map<staged_key, std::vector<std::uint8_t>> staged_;
+        std::map<const common::bytepair_page_store *, std::uint32_t> live_stores_;
+
+        bool should_stop_;
+
+        std::uint64_t pages_filled_;
+        std::uint64_t pages_prefetched_;
+
+        void prefetch_thread_loop();
+        void queue_read_ahead(paged_code_info &info, const std::uint32_t page);
+
+        paged_code_info *find_range(kernel::process *pr, const address addr);
+        void fill_all_locked(paged_code_info *info);
+        void remove_locked(paged_code_info *info);
+
+    public:
+        explicit code_pager(const std::uint32_t read_ahead_pages);
+        ~code_pager();
+
+        void add(paged_code_info *info);
+        void remove(paged_code_info *info);
+        void clear();
+
+        /**
+         * @brief Fill the page that holds the faulting address, if it's a paged code page.
+         *
+         * @param pr   The process that did the access.
+         * @param addr The faulting address.
+         *
+         * @returns True if the page has been filled and the access can be retried.
+         */
+        bool handle_fault(kernel::process *pr, const address addr);
+
+        /**
+         * @brief Fill every page left of a paged code chunk and stop tracking it.
+         */
+        void fill_all(paged_code_info *info);
+
+        /**
+         * @brief Fill the pages of a paged code chunk that a host range covers.
+         *
+         * For data found through a host pointer only, like the inline buffer of a literal descriptor.
+         *
+         * @param pr   The process that reads the range.
+         * @param host Start of the range.
+         * @param size Size of the range in bytes.
+         *
+         * @returns True if the range was in a paged code chunk.
+         */
+        bool fill_host_range(kernel::process *pr, const std::uint8_t *host, const std::size_t size);
+
+        /**
+         * @brief Get the decompressed content of a page.
+         *
+         * The page is taken from the staging area when the worker has already done it.
+         *
+         * @returns False if the page can not be decompressed.
+         */
+        bool read_page(const std::shared_ptr<common::bytepair_page_store> &store, const std::uint32_t page, std::uint8_t *dest);
+
+        std::uint64_t pages_filled() const {
+            return pages_filled_;
+        }
+
+        std::uint64_t pages_prefetched() const {
+            return pages_prefetched_;
+        }
+    };
+}
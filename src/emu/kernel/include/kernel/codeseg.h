@@ -21,14 +21,20 @@
 #pragma once
 
 #include <common/linked.h>
+#include <kernel/codepager.h>
 #include <kernel/kernel_obj.h>
 #include <mem/ptr.h>
 #include <utils/sec.h>
 
+#include <memory>
 #include <tuple>
 #include <vector>
 
 namespace eka2l1 {
+    namespace common {
+        class bytepair_page_store;
+    }
+
     namespace kernel {
         class chunk;
         class process;
@@ -82,6 +88,11 @@ namespace eka2l1::kernel {
 
         std::uint8_t *constant_data;
         std::uint8_t *code_data;
+
+        // Compressed pages for the first paged_code_size bytes of the code. code_data is not
+        // filled for those bytes.
+        std::shared_ptr<common::bytepair_page_store> code_pages;
+        std::uint32_t paged_code_size = 0;
     };
 
     enum codeseg_state {
@@ -153,7 +164,13 @@ namespace eka2l1::kernel {
         epoc::security_info sinfo;
 
         std::unique_ptr<std::uint8_t[]> constant_data;
+
+        // With paged code, this only holds the code after paged_code_size_
         std::unique_ptr<std::uint8_t[]> code_data;
+        std::shared_ptr<common::bytepair_page_store> code_pages_;
+        std::uint32_t paged_code_size_{ 0 };
+
+        std::vector<std::unique_ptr<paged_code_info>> paged_codes_;
 
         bool mark{ false };
 
@@ -174,6 +191,14 @@ namespace eka2l1::kernel {
         void calculate_hash();
         void free_attached_data(attached_info &info);
 
+        void copy_code(std::uint8_t *dest);
+        void unpage_code();
+        void apply_relocation(std::uint8_t *code_ptr, std::uint8_t *data_ptr, const std::uint64_t relocate_info,
+            const std::uint32_t code_delta, const std::uint32_t data_delta);
+
+        void drop_paged_code(chunk_ptr code_chunk);
+        void fill_all_code_pages(chunk_ptr code_chunk);
+
     public:
         /*! \brief Create a new codeseg
          *
@@ -299,5 +324,19 @@ namespace eka2l1::kernel {
         void set_entry_point_disabled();
 
         address relocate(kernel::process *pr, const address addr_on_base);
+
+        const std::shared_ptr<common::bytepair_page_store> &get_code_pages() const {
+            return code_pages_;
+        }
+
+        /**
+         * @brief Commit a paged code page, decompress it and apply the imports and relocations on it.
+         *
+         * @param info The paged code chunk.
+         * @param page Index of the page in the code chunk.
+         *
+         * @returns True on success.
+         */
+        bool fill_code_page(paged_code_info &info, const std::uint32_t page);
     };
 }
\ No newline at end of file
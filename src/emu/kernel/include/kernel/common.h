@@ -40,9 +40,12 @@ namespace eka2l1 {
 }
 
 namespace eka2l1::hle {
+    using import_func_ptr = void (*)(kernel_system *, kernel::process *, arm::core *);
+
     struct epoc_import_func {
         std::function<void(kernel_system *, kernel::process *, arm::core *)> func;
         std::string name;
+        import_func_ptr direct = nullptr; ///< Same as func, callable without the std::function. May be null.
     };
 
     using func_map = std::unordered_map<uint32_t, eka2l1::hle::epoc_import_func>;
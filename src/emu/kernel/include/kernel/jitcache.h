@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2022 EKA2L1 Team.
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <common/types.h>
+#include <cpu/arm_interface.h>
+
+#include <cstdint>
+#include <map>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace eka2l1::kernel {
+    class codeseg;
+    class process;
+
+    /**
+     * @brief Persist translations of immutable code segments across runs.
+     *
+     * Translated host code can not be serialized as is, since it embeds pointers to the running
+     * emulator. Two things are stored instead, relative to the code segment's run address, in a file
+     * named by the content hash of the segment:
+     *
+     * - How the interpreter decoded each block, with the handler picked for every instruction. Loading
+     *   them skips decoding entirely, which is most of the interpreter's cost on code that runs once.
+     * - The start of every block the JIT translated. Those are queued for translation on the core's
+     *   worker thread when the owning process first runs, while its code starts interpreted.
+     *
+     * Cores that can do neither, which is dynarmic, can not use it: dynarmic can not export or import
+     * its translated code, nor translate a block without running it.
+     *
+     * Files also store the emulator build they were made with, so that they are thrown away when the
+     * translator may have changed.
+     */
+    class jit_cache {
+    private:
+        struct block_entry {
+            bool thumb_;
+            bool translated_;
+            std::uint32_t fpscr_;
+            std::vector<arm::decoded_inst_info> insts_;
+        };
+
+        struct profile {
+            std::map<std::uint32_t, block_entry> blocks_;
+            bool loaded_ = false;
+            bool dirty_ = false;
+        };
+
+        struct tracked_segment {
+            kernel::codeseg *seg_;
+            kernel::process *process_;
+
+            address run_addr_;
+            std::uint32_t text_size_;
+            std::uint64_t key_;
+
+            bool warmed_;
+        };
+
+        std::string root_;
+        std::string build_id_;
+
+        std::unordered_map<std::uint64_t, profile> profiles_;
+        std::vector<tracked_segment> tracked_;
+
+        // Code segments that has been modified at runtime. Their content no longer matches the key
+        std::set<std::uint64_t> poisoned_;
+
+        std::uint64_t total_warmed_;
+        std::uint64_t total_collected_;
+
+        std::string file_path(const std::uint64_t key) const;
+        profile &get_profile(const std::uint64_t key);
+
+        bool load_profile(const std::uint64_t key, profile &target);
+        bool save_profile(const std::uint64_t key, profile &target);
+
+        void collect_segment(const std::vector<arm::core *> &cores, tracked_segment &segment);
+
+    public:
+        explicit jit_cache(const std::string &root, const std::string &build_id);
+
+        static std::uint64_t content_key(const std::uint8_t *code, const std::size_t size);
+
+        /**
+         * @brief Start tracking a code segment that has just been attached to a process.
+         *
+         * @param seg           The code segment.
+         * @param pr            The process that the segment is attached to.
+         * @param run_addr      Address where the code runs in the process.
+         * @param pristine_code Pointer to the code before relocation and import patching.
+         */
+        void track(kernel::codeseg *seg, kernel::process *pr, const address run_addr, const std::uint8_t *pristine_code);
+
+        /**
+         * @brief Load decoded blocks of all segments attached to a process, and queue their JIT
+         * translated blocks for translation on the core.
+         *
+         * Does not wait for the translation. Must be called when the process's address space is the
+         * current one on the core.
+         */
+        void warm(arm::core *cc, kernel::process *pr);
+
+        /**
+         * @brief Record blocks of a segment translated on any core, before it is detached from a process.
+         */
+        void collect(const std::vector<arm::core *> &cores, kernel::codeseg *seg, kernel::process *pr);
+
+        /**
+         * @brief Record blocks of all tracked segments translated on any core, and write them to disk.
+         */
+        void collect_all(const std::vector<arm::core *> &cores);
+
+        /**
+         * @brief Drop cache entries of code segments modified by an IMB range.
+         */
+        void invalidate(kernel::process *pr, const address addr, const std::size_t size);
+    };
+}
@@ -36,6 +36,8 @@
 #include <kernel/mutex.h>
 #include <kernel/object_ix.h>
 #include <kernel/process.h>
+#include <kernel/property_store.h>
+#include <kernel/registry.h>
 #include <kernel/scheduler.h>
 #include <kernel/sema.h>
 #include <kernel/timer.h>
@@ -52,6 +54,7 @@
 #include <common/wildcard.h>
 
 #include <kernel/ipc.h>
+#include <kernel/jitcache.h>
 #include <mem/ptr.h>
 
 #include <cpu/arm_analyser.h>
@@ -301,6 +304,12 @@ namespace eka2l1 {
         std::vector<kernel_obj_unq_ptr> logical_channels_;
         std::vector<kernel_obj_unq_ptr> undertakers_;
 
+        //! Every object above, by unique ID
+        kernel::object_registry<kernel::kernel_obj> registry_;
+
+        //! Properties by category and key, and their changes waiting for the next reschedule
+        kernel::property_store<service::property> prop_store_;
+
         std::unique_ptr<kernel::btrace> btrace_inst_;
         std::unique_ptr<hle::lib_manager> lib_mngr_;
         std::unique_ptr<kernel::thread_scheduler> thr_sch_;
@@ -314,6 +323,8 @@ namespace eka2l1 {
         disasm *disassembler_;
 
         arm::core *cpu_;
+        std::vector<arm::core *> secondary_cpus_;
+
         loader::rom *rom_info_;
 
         //! Handles for some globally shared processes
@@ -322,6 +333,8 @@ namespace eka2l1 {
 
         mutable std::atomic<kernel::uid> uid_counter_;
         void *rom_map_;
+        std::size_t rom_copy_size_; ///< Size of the ROM copy made for fastmem. 0 if the ROM file is mapped.
+        std::size_t rom_size_;
 
         std::uint64_t base_time_;
         std::uint32_t cpu_hz_;
@@ -360,6 +373,8 @@ namespace eka2l1 {
 
         kernel::chunk *custom_code_chunk;
         kernel::codedump_collector codedump_collector_;
+        std::unique_ptr<kernel::jit_cache> jit_cache_;
+        std::unique_ptr<kernel::code_pager> code_pager_;
 
         address exception_handler_guard_;
 
@@ -393,6 +408,7 @@ namespace eka2l1 {
         }
 
         bool cpu_exception_handler(arm::core *core, arm::exception_type exception_type, const std::uint32_t exception_data);
+        void install_cpu_handlers(arm::core *cc);
 
         void call_ipc_send_callbacks(const std::string &server_name, const int ord, const ipc_arg &args,
             address reqsts_addr, kernel::thread *callee);
@@ -462,6 +478,7 @@ namespace eka2l1 {
             }
 
             servers_.push_back(std::move(svr));
+            registry_.add(servers_.back()->unique_id(), servers_.back().get());
         }
 
         bool destroy(kernel_obj_ptr obj);
@@ -475,7 +492,14 @@ namespace eka2l1 {
         bool unsubscribe_prop(prop_ident_pair ident);
 
         property_ptr get_prop(int category, int key); // Get property by category and key
-        property_ptr delete_prop(int category, int key);
+        bool delete_prop(int category, int key); // Returns false if no such property is defined
+
+        /**
+         * @brief Queue the subscribers of a property to be completed on the next reschedule.
+         *
+         * Changes made before that are published once. Caller must hold the kernel lock.
+         */
+        void queue_property_change(property_ptr prop);
 
         void complete_undertakers(kernel::thread *literally_dies);
 
@@ -495,6 +519,20 @@ namespace eka2l1 {
         codeseg_ptr pull_codeseg_by_ep(const address ep);
 
         bool map_rom(const mem::vm_address addr, const std::string &path);
+        void unmap_rom();
+
+        /**
+         * @brief Get the host view of the ROM mapped by map_rom.
+         *
+         * @returns Pointer to the first byte of the ROM, or nullptr if no ROM is mapped.
+         */
+        const std::uint8_t *get_rom_map() const {
+            return reinterpret_cast<const std::uint8_t *>(rom_map_);
+        }
+
+        std::size_t get_rom_size() const {
+            return rom_map_ ? rom_size_ : 0;
+        }
         bool should_panic_be_blocked(kernel::thread *thr, const std::string &category, const std::int32_t code);
 
         epocver get_epoc_version() const {
@@ -526,9 +564,38 @@ namespace eka2l1 {
 
         /**
          * @brief Get the currently active CPU.
+         *
+         * With more than one core, this is the core bound to the calling host thread.
          */
         arm::core *get_cpu();
 
+        /**
+         * @brief Add a core that runs guest threads in parallel with the primary one.
+         *
+         * Only used by the scheduler tests for now. The system runs one core, since page tables are
+         * not locked against guest code running on other cores.
+         *
+         * @returns Index of the new core, which the host thread driving it must bind itself to.
+         */
+        std::uint32_t add_cpu(arm::core *cc);
+
+        /**
+         * @brief Get the number of cores guest threads are scheduled on.
+         */
+        std::size_t cpu_count() const {
+            return secondary_cpus_.size() + 1;
+        }
+
+        /**
+         * @brief Get a core by its index. Index 0 is the primary core.
+         */
+        arm::core *get_cpu(const std::uint32_t index);
+
+        /**
+         * @brief Get all cores, the primary core first.
+         */
+        std::vector<arm::core *> get_cpus();
+
         int get_ipc_realtime_signal_event() const {
             return realtime_ipc_signal_evt_;
         }
@@ -577,6 +644,22 @@ namespace eka2l1 {
             return codedump_collector_;
         }
 
+        /**
+         * @brief Get the persistent JIT cache.
+         * @returns Null if the cache is not enabled.
+         */
+        kernel::jit_cache *get_jit_cache() {
+            return jit_cache_.get();
+        }
+
+        /**
+         * @brief Get the pager that fills code pages of loaded images on access.
+         * @returns Null if demand paged code is not enabled.
+         */
+        kernel::code_pager *get_code_pager() {
+            return code_pager_.get();
+        }
+
         void set_current_language(const language new_lang);
 
         // Expose for scripting, indeed very dirty
@@ -660,52 +743,29 @@ namespace eka2l1 {
             return get_by_name_and_type<T>(name, obj_type);
         }
 
+        using object_read_guard = kernel::object_registry<kernel::kernel_obj>::read_guard;
+
+        /*! \brief Allow objects looked up by ID to be used without the kernel lock.
+         *
+         * Objects destroyed while the guard is alive are freed after it's gone.
+        */
+        object_read_guard guard_object_reads() const {
+            return object_read_guard(registry_);
+        }
+
         /*! \brief Get kernel object by ID
+         *
+         * Can be called without the kernel lock, while holding the guard from guard_object_reads.
         */
         template <typename T>
         T *get_by_id(const kernel::uid uid) {
-            const kernel::object_type obj_type = get_object_type<T>();
+            kernel::kernel_obj *obj = registry_.find(uid);
 
-            switch (obj_type) {
-                // It's gurantee that object are sorted by unique id, by just adding it
-                // Deletion will not affect that fact.
-#define OBJECT_SEARCH(obj_type, obj_map)                                                                             \
-    case kernel::object_type::obj_type: {                                                                            \
-        auto res = std::lower_bound(obj_map.begin(), obj_map.end(), nullptr, [&](const auto &lhs, const auto &rhs) { \
-            return lhs->unique_id() < uid;                                                                           \
-        });                                                                                                          \
-        if ((res != obj_map.end()) && (res->get()->unique_id() == uid)) {                                                                                  \
-            return reinterpret_cast<T *>(res->get());                                                                \
-        }                                                                                                            \
-        return nullptr;                                                                                              \
-    }
-
-                OBJECT_SEARCH(mutex, mutexes_)
-                OBJECT_SEARCH(sema, semas_)
-                OBJECT_SEARCH(condvar, condvars_)
-                OBJECT_SEARCH(chunk, chunks_)
-                OBJECT_SEARCH(thread, threads_)
-                OBJECT_SEARCH(process, processes_)
-                OBJECT_SEARCH(change_notifier, change_notifiers_)
-                OBJECT_SEARCH(library, libraries_)
-                OBJECT_SEARCH(codeseg, codesegs_)
-                OBJECT_SEARCH(server, servers_)
-                OBJECT_SEARCH(prop, props_)
-                OBJECT_SEARCH(prop_ref, prop_refs_)
-                OBJECT_SEARCH(session, sessions_)
-                OBJECT_SEARCH(timer, timers_)
-                OBJECT_SEARCH(msg_queue, message_queues_)
-                OBJECT_SEARCH(logical_device, logical_devices_)
-                OBJECT_SEARCH(logical_channel, logical_channels_)
-                OBJECT_SEARCH(undertaker, undertakers_)
-
-#undef OBJECT_SEARCH
-
-            default:
-                break;
+            if (!obj || (obj->get_object_type() != get_object_type<T>())) {
+                return nullptr;
             }
 
-            return nullptr;
+            return reinterpret_cast<T *>(obj);
         }
 
         template <typename T>
@@ -716,6 +776,8 @@ namespace eka2l1 {
     case type:                                                     \
         additional_setup;                                          \
         container.push_back(std::move(obj));                       \
+        registry_.add(container.back()->unique_id(),               \
+            container.back().get());                               \
         return reinterpret_cast<T *>(container.back().get());
 
             switch (obj_type) {
@@ -723,7 +785,7 @@ namespace eka2l1 {
                 ADD_OBJECT_TO_CONTAINER(kernel::object_type::process, processes_, setup_new_process(reinterpret_cast<process_ptr>(obj.get())));
                 ADD_OBJECT_TO_CONTAINER(kernel::object_type::chunk, chunks_, )
                 ADD_OBJECT_TO_CONTAINER(kernel::object_type::server, servers_, )
-                ADD_OBJECT_TO_CONTAINER(kernel::object_type::prop, props_, )
+                ADD_OBJECT_TO_CONTAINER(kernel::object_type::prop, props_, prop_store_.add(reinterpret_cast<property_ptr>(obj.get())))
                 ADD_OBJECT_TO_CONTAINER(kernel::object_type::prop_ref, prop_refs_, )
                 ADD_OBJECT_TO_CONTAINER(kernel::object_type::session, sessions_, )
                 ADD_OBJECT_TO_CONTAINER(kernel::object_type::library, libraries_, )
@@ -24,8 +24,10 @@
 #include <common/types.h>
 
 #include <kernel/common.h>
+#include <kernel/svctable.h>
 #include <mem/ptr.h>
 
+#include <array>
 #include <functional>
 #include <map>
 #include <memory>
@@ -136,6 +138,11 @@ namespace eka2l1 {
             std::vector<patch_pending_entry> patch_pendings_;
             std::map<address, address> trampoline_lookup_;
 
+            svc_table svc_table_; ///< Dispatch tables, built from the registered SVCs.
+            bool profile_svc_;
+
+            void dump_svc_profile();
+
         protected:
             const std::uint8_t *entry_points_call_routine_;
             const std::uint8_t *thread_entry_routine_;
@@ -149,7 +156,7 @@ namespace eka2l1 {
             void jump_trampoline_through_svc();
 
         public:
-            std::unordered_map<sid, epoc_import_func> svc_funcs_;
+            std::unordered_map<sid, epoc_import_func> svc_funcs_; ///< Registered SVCs. Dispatch goes through tables built from this.
             std::vector<std::u16string> search_paths;
 
             explicit lib_manager(kernel_system *kern, io_system *ios, memory_system *mems);
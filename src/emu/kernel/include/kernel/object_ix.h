@@ -20,6 +20,8 @@ namespace eka2l1 {
         };
 
         static constexpr std::uint32_t MAX_HANDLE_COUNT = 0x8000;
+        static constexpr std::uint32_t HANDLE_CHUNK_SHIFT = 5;
+        static constexpr std::uint32_t HANDLE_CHUNK_SIZE = 1 << HANDLE_CHUNK_SHIFT;
 
         struct handle_inspect_info {
             bool handle_array_local;
@@ -47,24 +49,43 @@ namespace eka2l1 {
             bool free = true;
         };
 
-        /*! \brief The ultimate object handles holder. */
+        /*! \brief The ultimate object handles holder.
+         *
+         * Records are allocated in chunks of HANDLE_CHUNK_SIZE as handles are opened, up to MAX_HANDLE_COUNT,
+         * so a table takes memory proportional to the most handles it had open at once. Closed slots are
+         * kept in a free list and reused first.
+         */
         class object_ix {
-            uint64_t uid;
+            using record_chunk = std::array<object_ix_record, HANDLE_CHUNK_SIZE>;
 
-            size_t next_instance;
+            uint64_t uid = 0;
 
-            std::array<object_ix_record, MAX_HANDLE_COUNT> objects;
+            size_t next_instance = 0;
+
+            std::vector<std::unique_ptr<record_chunk>> chunks;
+            std::vector<std::uint16_t> free_slots;
             std::vector<std::uint32_t> handles;
 
-            handle_array_owner owner;
-            size_t totals;
+            handle_array_owner owner = handle_array_owner::thread;
+            size_t totals = 0;
 
             uint32_t make_handle(size_t index);
 
-            kernel_system *kern;
+            object_ix_record *get_record(const std::uint32_t index) {
+                if ((index >> HANDLE_CHUNK_SHIFT) >= chunks.size()) {
+                    return nullptr;
+                }
+
+                return &(*chunks[index >> HANDLE_CHUNK_SHIFT])[index & (HANDLE_CHUNK_SIZE - 1)];
+            }
+
+            bool grow();
+            void rebuild_free_slots();
+
+            kernel_system *kern = nullptr;
 
         public:
-            explicit object_ix() {}
+            explicit object_ix() = default;
             explicit object_ix(kernel_system *kern, handle_array_owner owner);
 
             void do_state(common::chunkyseri &seri);
@@ -109,6 +130,11 @@ namespace eka2l1 {
                 return totals;
             }
 
+            /*! \brief Get the number of handle slots currently allocated. */
+            std::size_t capacity() const {
+                return chunks.size() * HANDLE_CHUNK_SIZE;
+            }
+
             /*! \brief Get the last handle created. 0 if none left */
             std::uint32_t last_handle();
 
@@ -26,6 +26,7 @@
 #include <kernel/kernel_obj.h>
 #include <kernel/mutex.h>
 #include <kernel/object_ix.h>
+#include <kernel/smp/balancer.h>
 #include <kernel/thread.h>
 #include <mem/process.h>
 #include <utils/reqsts.h>
@@ -184,6 +185,8 @@ namespace eka2l1::kernel {
 
         std::int32_t generation_;
 
+        smp::schedulable_stats smp_stats_; ///< Core assignment and run time, for the load balancer.
+
         // Это оскорбления, первое слово оскорбляет человека, а второе говорят для
         // увеличения эмоций.
         common::identity_container<process_uid_type_change_callback_elem> uid_change_callbacks;
@@ -278,7 +281,21 @@ namespace eka2l1::kernel {
 
         kernel_obj_ptr get_object(const std::uint32_t handle);
 
-        void *get_ptr_on_addr_space(address addr);
+        /**
+         * @brief Get the host pointer of an address in this process's address space.
+         *
+         * Paged code pages in the given range are filled first, since the kernel reads through host pointers
+         * and never faults.
+         *
+         * @param addr The address.
+         * @param size Number of bytes the caller is going to access.
+         */
+        void *get_ptr_on_addr_space(address addr, const std::size_t size = 1);
+
+        /**
+         * @brief Fill paged code pages that a host range in this process's address space covers.
+         */
+        void fill_paged_host_range(const void *host, const std::size_t size);
 
         std::optional<std::uint32_t> read_dword_data_from(process *from_process, address addr);
         bool write_dword_data_to(process *to_process, address addr, const std::uint32_t target_data);
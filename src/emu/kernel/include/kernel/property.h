@@ -55,14 +55,22 @@ namespace eka2l1 {
         public:
             typedef void (*data_change_callback_handler)(void *userdata, service::property *prop);
 
+            // Most binary properties are a package of a few integers
+            static constexpr std::uint32_t INLINE_DATA_SIZE = 32;
+
         protected:
             int ndata;
-            std::vector<uint8_t> bindata;
+
+            std::array<uint8_t, INLINE_DATA_SIZE> inline_data;
+            std::vector<uint8_t> large_data; ///< Only used for values larger than the inline storage.
 
             uint32_t data_len;
 
             service::property_type data_type;
 
+            bool held_by_kernel; ///< The kernel keeps the object alive while it is defined, references do otherwise.
+            bool defined_by_guest; ///< False for properties of HLE services, which keep pointers to them.
+
             threadsafe_cn_queue<epoc::notify_info *> subscription_queue;
 
             using data_change_callback = std::pair<void *, data_change_callback_handler>;
@@ -70,6 +78,13 @@ namespace eka2l1 {
 
             void fire_data_change_callbacks();
 
+            uint8_t *data_ptr() {
+                return (data_len <= INLINE_DATA_SIZE) ? inline_data.data() : large_data.data();
+            }
+
+            /*! \brief Make room for a value of given size, keeping the current bytes that still fit. */
+            void resize_data(const uint32_t new_len);
+
         public:
             explicit property(kernel_system *kern);
 
@@ -80,15 +95,27 @@ namespace eka2l1 {
              */
             void add_data_change_callback(void *userdata, data_change_callback_handler handler);
 
-            void define(service::property_type pt, uint32_t pre_allocated);
+            void define(service::property_type pt, uint32_t pre_allocated, const bool by_guest = false);
 
             bool is_defined();
 
+            bool is_defined_by_guest() const {
+                return defined_by_guest;
+            }
+
+            /**
+             * \brief Delete the definition of the property.
+             *
+             * Pending subscriptions complete with not found. The object is freed right away if no reference
+             * is attached to it, else with the last one, unless the property is defined again before that.
+             */
+            void undefine();
+
             /**
              * \brief Set the property value (integer).
              *
-             * If the property type is not integer, this return false, else
-             * it will set the value and notify the request.		
+             * If the property type is not integer, this return false, else it will set the value,
+             * run the data change callbacks and queue a notification of subscribers for the next reschedule.
              *
              * \param val The value to set.
 			*/
@@ -97,8 +124,8 @@ namespace eka2l1 {
             /**
              * \brief Set the property value (bin).
              *
-             * If the property type is not binary, this return false, else
-             * it will set the value and notify the request.	
+             * If the property type is not binary, this return false, else it will set the value,
+             * run the data change callbacks and queue a notification of subscribers for the next reschedule.
              * 
              * \param data The pointer to binary data.	
              * \param arr_length The binary data length.
@@ -115,16 +142,27 @@ namespace eka2l1 {
             int get_int();
             std::vector<uint8_t> get_bin();
 
+            /**
+             * \brief Get the binary value without copying it.
+             *
+             * The pointer is valid until the property is set or defined again.
+             */
+            const uint8_t *get_bin_ptr() const {
+                return (data_len <= INLINE_DATA_SIZE) ? inline_data.data() : large_data.data();
+            }
+
+            uint32_t get_bin_size() const {
+                return data_len;
+            }
+
             template <typename T>
             std::optional<T> get_pkg() {
-                auto bin = get_bin();
-
-                if (bin.size() != sizeof(T)) {
+                if (data_len != sizeof(T)) {
                     return std::optional<T>{};
                 }
 
                 T ret;
-                memcpy(&ret, bin.data(), bin.size());
+                memcpy(&ret, get_bin_ptr(), sizeof(T));
 
                 return ret;
             }
@@ -134,6 +172,9 @@ namespace eka2l1 {
 
             /*! \brief Notify the request that there is data change */
             void notify_request(const std::int32_t err);
+
+            /*! \brief Complete the subscriptions for the last change. Called by the kernel on reschedule. */
+            void publish_change();
         };
 
         struct property_reference : public kernel::kernel_obj {
@@ -144,6 +185,8 @@ namespace eka2l1 {
             explicit property_reference(kernel_system *kern, property *prop);
             ~property_reference() override;
 
+            int destroy() override;
+
             /**
              * \brief       Get the property kernel object.
              * \returns     The property object.
@@ -0,0 +1,213 @@
+/*
+ * Copyright (c) 2022 EKA2L1 Team.
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace eka2l1::kernel {
+    /**
+     * @brief Index of properties by category and key, and the list of properties waiting to publish a change.
+     *
+     * Properties get their category and key after they are created, so a new property first waits in a
+     * small list and is moved to the hash index by the next lookup that misses. When two properties
+     * share an identity, the one created first is found, like the linear search this replaces.
+     *
+     * Changes are not published to guest subscribers when the value is set. The property is queued once,
+     * however many times it is set, and all queued properties publish together when the kernel reschedules. The type must
+     * have a public std::pair<int, int> base holding the category and the key.
+     *
+     * Not thread-safe, the kernel lock must be held.
+     */
+    template <typename T>
+    class property_store {
+        // Publishing may set other properties, which are published in the same flush up to this many rounds
+        static constexpr std::size_t MAX_FLUSH_ROUNDS = 8;
+
+        std::unordered_map<std::uint64_t, T *> index_;
+        std::vector<T *> unkeyed_;
+        std::vector<T *> shadowed_; ///< Properties hidden by an indexed one with the same identity.
+
+        std::vector<T *> pending_;
+        std::unordered_set<T *> pending_set_;
+        std::vector<T *> flushing_;
+
+        static std::uint64_t make_key(const int category, const int key) {
+            return (static_cast<std::uint64_t>(static_cast<std::uint32_t>(category)) << 32) | static_cast<std::uint32_t>(key);
+        }
+
+        static bool has_identity(const T *prop) {
+            return (prop->first != 0) || (prop->second != 0);
+        }
+
+        void index_unkeyed() {
+            auto new_end = std::remove_if(unkeyed_.begin(), unkeyed_.end(), [this](T *prop) {
+                if (!has_identity(prop)) {
+                    return false;
+                }
+
+                if (!index_.emplace(make_key(prop->first, prop->second), prop).second) {
+                    shadowed_.push_back(prop);
+                }
+
+                return true;
+            });
+
+            unkeyed_.erase(new_end, unkeyed_.end());
+        }
+
+    public:
+        /**
+         * @brief Add a newly created property. Its identity may be assigned later.
+         */
+        void add(T *prop) {
+            unkeyed_.push_back(prop);
+        }
+
+        /**
+         * @brief Forget a property, before it is freed.
+         */
+        void remove(T *prop) {
+            auto ite = index_.find(make_key(prop->first, prop->second));
+
+            if ((ite != index_.end()) && (ite->second == prop)) {
+                index_.erase(ite);
+
+                // Another property with the same identity may wait to take its place
+                auto shadowed = std::find_if(shadowed_.begin(), shadowed_.end(), [prop](T *other) {
+                    return (other->first == prop->first) && (other->second == prop->second);
+                });
+
+                if (shadowed != shadowed_.end()) {
+                    index_.emplace(make_key(prop->first, prop->second), *shadowed);
+                    shadowed_.erase(shadowed);
+                }
+            } else {
+                unkeyed_.erase(std::remove(unkeyed_.begin(), unkeyed_.end(), prop), unkeyed_.end());
+                shadowed_.erase(std::remove(shadowed_.begin(), shadowed_.end(), prop), shadowed_.end());
+            }
+
+            if (pending_set_.erase(prop)) {
+                pending_.erase(std::remove(pending_.begin(), pending_.end(), prop), pending_.end());
+            }
+
+            std::replace(flushing_.begin(), flushing_.end(), prop, static_cast<T *>(nullptr));
+        }
+
+        /**
+         * @brief Find a property by its category and key.
+         *
+         * @returns Null if no property has this identity.
+         */
+        T *find(const int category, const int key) {
+            auto ite = index_.find(make_key(category, key));
+
+            if (ite != index_.end()) {
+                return ite->second;
+            }
+
+            if (unkeyed_.empty()) {
+                return nullptr;
+            }
+
+            index_unkeyed();
+
+            ite = index_.find(make_key(category, key));
+            if (ite != index_.end()) {
+                return ite->second;
+            }
+
+            // Only properties that still have no identity are left
+            auto unkeyed_ite = std::find_if(unkeyed_.begin(), unkeyed_.end(), [=](T *prop) {
+                return (prop->first == category) && (prop->second == key);
+            });
+
+            return (unkeyed_ite == unkeyed_.end()) ? nullptr : *unkeyed_ite;
+        }
+
+        /**
+         * @brief Queue a property to publish its change on the next flush.
+         *
+         * @returns True if nothing was queued before, and a flush must be scheduled.
+         */
+        bool queue_change(T *prop) {
+            if (!pending_set_.insert(prop).second) {
+                return false;
+            }
+
+            pending_.push_back(prop);
+            return pending_.size() == 1;
+        }
+
+        /**
+         * @brief Publish the queued changes, in the order they were first queued.
+         *
+         * @param publish Called once for each queued property.
+         * @returns Number of properties published.
+         */
+        template <typename F>
+        std::size_t flush(F publish) {
+            std::size_t published = 0;
+
+            for (std::size_t round = 0; (round < MAX_FLUSH_ROUNDS) && !pending_.empty(); round++) {
+                flushing_.swap(pending_);
+                pending_.clear();
+
+                // Properties set again while publishing are queued for the next round
+                for (T *prop : flushing_) {
+                    if (prop) {
+                        pending_set_.erase(prop);
+                    }
+                }
+
+                for (std::size_t i = 0; i < flushing_.size(); i++) {
+                    if (flushing_[i]) {
+                        publish(flushing_[i]);
+                        published++;
+                    }
+                }
+
+                flushing_.clear();
+            }
+
+            return published;
+        }
+
+        bool has_pending_changes() const {
+            return !pending_.empty();
+        }
+
+        void clear() {
+            index_.clear();
+            unkeyed_.clear();
+            shadowed_.clear();
+            pending_.clear();
+            pending_set_.clear();
+            flushing_.clear();
+        }
+
+        std::size_t size() const {
+            return index_.size() + unkeyed_.size() + shadowed_.size();
+        }
+    };
+}
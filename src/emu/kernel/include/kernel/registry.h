@@ -0,0 +1,290 @@
+/*
+ * Copyright (c) 2022 EKA2L1 Team.
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace eka2l1::kernel {
+    /**
+     * @brief Index of kernel objects by unique ID, readable without the kernel lock.
+     *
+     * Objects live in a slot table, in the slot picked by the low bits of their ID. Each slot keeps the
+     * full ID of its object next to the pointer, so the high bits act as the generation of the slot: a
+     * stale ID never matches an object that has taken the slot since. Colliding IDs probe the next slots,
+     * which only happens when objects from far apart in time are alive together.
+     *
+     * Lookups take no lock. A reader holds a read_guard while it uses what it found, and anything taken
+     * out of the table (objects and old tables after a grow) is only freed once no reader is left inside
+     * a guard. Readers are short and rare off the kernel thread, so that happens on the next write most of
+     * the time. Writers must hold the kernel lock.
+     */
+    template <typename T>
+    class object_registry {
+    public:
+        using uid_type = std::uint64_t;
+
+    private:
+        static constexpr std::size_t INITIAL_CAPACITY = 1024;
+        static constexpr uid_type EMPTY_SLOT = 0;
+        static constexpr uid_type TOMBSTONE_SLOT = ~0ULL;
+
+        struct slot {
+            std::atomic<uid_type> uid_{ EMPTY_SLOT };
+            std::atomic<T *> obj_{ nullptr };
+        };
+
+        struct table {
+            std::size_t mask_;
+            std::unique_ptr<slot[]> slots_;
+
+            explicit table(const std::size_t capacity)
+                : mask_(capacity - 1)
+                , slots_(std::make_unique<slot[]>(capacity)) {
+            }
+        };
+
+        std::atomic<table *> table_;
+        std::vector<std::unique_ptr<table>> tables_; ///< The active table is the last one. Others wait for readers to leave.
+
+        std::size_t count_;
+        std::size_t tombstones_;
+
+        mutable std::atomic<std::uint32_t> readers_;
+        std::vector<std::unique_ptr<T>> retired_;
+
+        void insert_to(table &target, const uid_type uid, T *obj) {
+            for (std::size_t i = static_cast<std::size_t>(uid) & target.mask_;; i = (i + 1) & target.mask_) {
+                const uid_type current = target.slots_[i].uid_.load(std::memory_order_relaxed);
+
+                if ((current == EMPTY_SLOT) || (current == TOMBSTONE_SLOT)) {
+                    if (current == TOMBSTONE_SLOT) {
+                        tombstones_--;
+                    }
+
+                    // Publish the object before the ID, a reader that matches the ID then sees the object.
+                    // Release too, so a reader that sees this object also sees the ID retired before it.
+                    target.slots_[i].obj_.store(obj, std::memory_order_release);
+                    target.slots_[i].uid_.store(uid, std::memory_order_release);
+
+                    return;
+                }
+            }
+        }
+
+        void rebuild(const std::size_t capacity) {
+            auto new_table = std::make_unique<table>(capacity);
+            table *old_table = table_.load(std::memory_order_relaxed);
+
+            tombstones_ = 0;
+
+            for (std::size_t i = 0; i <= old_table->mask_; i++) {
+                const uid_type uid = old_table->slots_[i].uid_.load(std::memory_order_relaxed);
+
+                if ((uid != EMPTY_SLOT) && (uid != TOMBSTONE_SLOT)) {
+                    insert_to(*new_table, uid, old_table->slots_[i].obj_.load(std::memory_order_relaxed));
+                }
+            }
+
+            table_.store(new_table.get(), std::memory_order_seq_cst);
+            tables_.push_back(std::move(new_table));
+        }
+
+    public:
+        /**
+         * @brief Mark the calling thread as using objects looked up from the registry.
+         *
+         * Objects removed while any guard is alive are kept around until the last guard goes away.
+         */
+        class read_guard {
+            const object_registry *registry_;
+
+        public:
+            explicit read_guard(const object_registry &registry)
+                : registry_(&registry) {
+                // Sequentially consistent, so a writer either sees the reader or the reader sees the removal
+                registry_->readers_.fetch_add(1, std::memory_order_seq_cst);
+            }
+
+            ~read_guard() {
+                registry_->readers_.fetch_sub(1, std::memory_order_seq_cst);
+            }
+
+            read_guard(const read_guard &) = delete;
+            read_guard &operator=(const read_guard &) = delete;
+        };
+
+        explicit object_registry()
+            : count_(0)
+            , tombstones_(0)
+            , readers_(0) {
+            tables_.push_back(std::make_unique<table>(INITIAL_CAPACITY));
+            table_ = tables_.back().get();
+        }
+
+        ~object_registry() {
+            clear();
+        }
+
+        /**
+         * @brief Find an object by its ID.
+         *
+         * Without the kernel lock, the caller must hold a read_guard for as long as it uses the result.
+         *
+         * @returns Null if no object with this ID is registered.
+         */
+        T *find(const uid_type uid) const {
+            if ((uid == EMPTY_SLOT) || (uid == TOMBSTONE_SLOT)) {
+                return nullptr;
+            }
+
+            const table *target = table_.load(std::memory_order_seq_cst);
+
+            for (std::size_t i = static_cast<std::size_t>(uid) & target->mask_;; i = (i + 1) & target->mask_) {
+                const uid_type current = target->slots_[i].uid_.load(std::memory_order_acquire);
+
+                if (current == uid) {
+                    T *obj = target->slots_[i].obj_.load(std::memory_order_acquire);
+
+                    // The slot may have been emptied and given to another object between the two loads.
+                    // Writers retire the ID before storing a new pointer, so check the ID still holds.
+                    if (target->slots_[i].uid_.load(std::memory_order_acquire) != uid) {
+                        return nullptr;
+                    }
+
+                    return obj;
+                }
+
+                if (current == EMPTY_SLOT) {
+                    return nullptr;
+                }
+            }
+        }
+
+        /**
+         * @brief Register an object under its ID.
+         */
+        void add(const uid_type uid, T *obj) {
+            if ((uid == EMPTY_SLOT) || (uid == TOMBSTONE_SLOT) || !obj) {
+                return;
+            }
+
+            table *target = table_.load(std::memory_order_relaxed);
+
+            // Keep at most half of the slots taken, so probes stay short
+            if ((count_ + tombstones_ + 1) * 2 > target->mask_ + 1) {
+                rebuild(((count_ + 1) * 4 > target->mask_ + 1) ? (target->mask_ + 1) * 2 : (target->mask_ + 1));
+                target = table_.load(std::memory_order_relaxed);
+            }
+
+            insert_to(*target, uid, obj);
+            count_++;
+
+            reclaim();
+        }
+
+        /**
+         * @brief Unregister an object. Its memory is not touched.
+         *
+         * @returns True if the object was registered.
+         */
+        bool remove(const uid_type uid) {
+            if ((uid == EMPTY_SLOT) || (uid == TOMBSTONE_SLOT)) {
+                return false;
+            }
+
+            table *target = table_.load(std::memory_order_relaxed);
+
+            for (std::size_t i = static_cast<std::size_t>(uid) & target->mask_;; i = (i + 1) & target->mask_) {
+                const uid_type current = target->slots_[i].uid_.load(std::memory_order_relaxed);
+
+                if (current == uid) {
+                    // Keep the probe chain going for IDs placed after this one
+                    target->slots_[i].uid_.store(TOMBSTONE_SLOT, std::memory_order_seq_cst);
+                    target->slots_[i].obj_.store(nullptr, std::memory_order_release);
+
+                    count_--;
+                    tombstones_++;
+
+                    return true;
+                }
+
+                if (current == EMPTY_SLOT) {
+                    return false;
+                }
+            }
+        }
+
+        /**
+         * @brief Unregister an object and free it once no reader can be using it.
+         */
+        void retire(const uid_type uid, std::unique_ptr<T> obj) {
+            remove(uid);
+            retired_.push_back(std::move(obj));
+
+            reclaim();
+        }
+
+        /**
+         * @brief Free retired objects and old tables if no reader is around.
+         *
+         * @returns True if nothing is left waiting.
+         */
+        bool reclaim() {
+            if (retired_.empty() && (tables_.size() == 1)) {
+                return true;
+            }
+
+            if (readers_.load(std::memory_order_seq_cst) != 0) {
+                return false;
+            }
+
+            retired_.clear();
+            tables_.erase(tables_.begin(), tables_.end() - 1);
+
+            return true;
+        }
+
+        /**
+         * @brief Unregister all objects and free what was retired. No reader may be around.
+         */
+        void clear() {
+            tables_.clear();
+            tables_.push_back(std::make_unique<table>(INITIAL_CAPACITY));
+            table_ = tables_.back().get();
+
+            retired_.clear();
+
+            count_ = 0;
+            tombstones_ = 0;
+        }
+
+        std::size_t size() const {
+            return count_;
+        }
+
+        std::size_t pending_reclaim_count() const {
+            return retired_.size();
+        }
+    };
+}
@@ -26,11 +26,14 @@
 #include <common/queue.h>
 #include <common/sync.h>
 
+#include <kernel/smp/scheduler.h>
+
 #include <algorithm>
 #include <condition_variable>
 #include <cstdint>
 #include <functional>
 #include <map>
+#include <memory>
 #include <mutex>
 #include <queue>
 #include <tuple>
@@ -55,34 +58,60 @@ namespace eka2l1 {
 
         class thread_scheduler {
         private:
-            kernel::thread *readys[64];
-            std::uint32_t ready_mask[2]{ 0, 0 };
-
-            kernel::thread *crr_thread;
-            kernel::process *crr_process;
+            std::vector<std::unique_ptr<smp::sub_scheduler>> cores;
 
             ntimer *timing;
             kernel_system *kern;
-            arm::core *run_core;
-
-            mem::mmu_base *core_mmu;
 
             int wakeup_evt;
             int yield_evt;
             std::uint32_t ticks_yield;
 
-            common::event idle_event;
+            std::uint64_t last_balance_time;
 
         protected:
-            kernel::thread *next_ready_thread();
-            void switch_context(kernel::thread *oldt, kernel::thread *newt);
+            smp::sub_scheduler &current_core() const;
+            smp::sub_scheduler &core_of(kernel::thread *thr);
+
+            kernel::thread *next_ready_thread(smp::sub_scheduler &sub);
+            void switch_context(smp::sub_scheduler &sub, kernel::thread *oldt, kernel::thread *newt);
             void call_process_switch_callbacks(kernel::process *old, kernel::process *new_one);
 
+            /**
+             * @brief Make the core that the thread is queued on pick its next thread.
+             */
+            void reschedule_core_of(kernel::thread *thr);
+
+            void migrate_process(kernel::process *pr, const std::uint32_t target_core);
+
+            /**
+             * @brief Rebalance if a balance period has passed since the last one.
+             */
+            void rebalance_if_due();
+
         public:
             // The constructor also register all the needed event
             explicit thread_scheduler(kernel_system *kern, ntimer *timing, arm::core *cpu);
             ~thread_scheduler();
 
+            /**
+             * @brief Add a core that runs threads in parallel with the others.
+             *
+             * The core is driven by a host thread that binds itself to the returned index.
+             *
+             * @returns Index of the new core.
+             */
+            std::uint32_t add_core(arm::core *cpu);
+
+            std::size_t core_count() const {
+                return cores.size();
+            }
+
+            /**
+             * @brief Spread processes over cores by how much they ran since the last balance.
+             */
+            void rebalance();
+
             void stop_idling();
 
             void queue_thread_ready(kernel::thread *thr);
@@ -101,13 +130,8 @@ namespace eka2l1 {
                 return false;
             }
 
-            kernel::thread *current_thread() const {
-                return crr_thread;
-            }
-
-            kernel::process *current_process() const {
-                return crr_process;
-            }
+            kernel::thread *current_thread() const;
+            kernel::process *current_process() const;
         };
     }
 }
@@ -140,6 +140,14 @@ namespace eka2l1 {
 
             virtual int destroy() override;
 
+            /**
+             * \brief Finish the requests that are still being served on other host threads.
+             *
+             * Called when the kernel is wiped out, before any session is destroyed. Called without the
+             * kernel lock.
+             */
+            virtual void finish_pending_requests() {}
+
             int deliver(ipc_msg_ptr msg);
             void receive(ipc_msg_ptr &msg);
 
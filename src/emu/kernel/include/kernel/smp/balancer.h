@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2022 EKA2L1 Team.
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace eka2l1::kernel::smp {
+    /**
+     * \brief Load statistics of a schedulable group, which is a process in our case.
+     *
+     * All threads of a group run on the same core, so that a core does not have to switch address
+     * space more than needed, and so threads sharing data don't fight over it across cores.
+     */
+    struct schedulable_stats {
+        std::int32_t core_ = -1; ///< The core the group runs on. -1 if none of its threads has been queued yet.
+        std::uint64_t run_time_ = 0; ///< Total time its threads have run, in microseconds.
+        std::uint64_t balanced_run_time_ = 0; ///< Run time at the last periodic balance.
+    };
+
+    /**
+     * \brief A schedulable group to be placed by the load balancer.
+     */
+    struct balance_candidate {
+        std::uint32_t run_units_; ///< Load units used since last balance, between 0 and cpu_availability::idle_unit.
+        bool heavy_; ///< Heavy groups want a core on their own.
+        bool movable_; ///< False if the group can not leave its core now, for example it's running.
+
+        std::uint32_t current_core_;
+        std::uint32_t target_core_; ///< Filled by the balancer.
+    };
+
+    enum : std::uint32_t {
+        BALANCE_PERIOD_TICKS = 107, ///< Nanokernel ticks between two periodic balances.
+        INACTIVE_LOAD_UNITS = 16, ///< Groups using less than this many units stay where they are.
+        HEAVY_PRIORITY = 25 ///< Groups with priority above this are heavy.
+    };
+
+    /**
+     * \brief Turn time spent running into load units.
+     *
+     * \param delta_target Time spent running between two balances.
+     * \param delta_time   Time between two balances.
+     *
+     * \returns Load units, between 0 and cpu_availability::idle_unit.
+     */
+    std::uint32_t calculate_load_units(std::uint64_t delta_target, std::uint64_t delta_time);
+
+    /**
+     * \brief Check if a group should be balanced as heavy.
+     *
+     * \param priority   The highest real priority of the group's threads.
+     * \param run_units  Load units used since last balance.
+     */
+    bool is_heavy(const int priority, const std::uint32_t run_units);
+
+    /**
+     * \brief Pick a core for every candidate, spreading the load evenly.
+     *
+     * Non-heavy groups are placed first, from the largest load to the smallest, each on the core
+     * with the lowest load so far. Heavy groups come next, from the smallest load to the largest. As
+     * long as there are enough cores left they get one on their own, otherwise they are spread like
+     * the rest. Inactive and unmovable groups stay on their core. Ties are resolved in favour of the
+     * current core, so groups are not moved around for nothing.
+     *
+     * \param candidates  The groups to place. The target core of each one is filled in.
+     * \param core_count  Number of cores.
+     */
+    void balance(std::vector<balance_candidate> &candidates, const std::uint32_t core_count);
+}
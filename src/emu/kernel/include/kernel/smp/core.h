@@ -0,0 +1,39 @@
+/*
+ * Copyright (c) 2022 EKA2L1 Team.
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+namespace eka2l1::kernel::smp {
+    /**
+     * \brief Bind the calling host thread to an emulated core.
+     *
+     * Kernel calls made from this host thread afterwards, such as getting the current thread or the
+     * running CPU, act on the bound core. Host threads that are never bound act on core 0.
+     *
+     * \param index The index of the core.
+     */
+    void bind_current_core(const std::uint32_t index);
+
+    /**
+     * \brief Get the index of the core that the calling host thread drives.
+     */
+    std::uint32_t current_core();
+}
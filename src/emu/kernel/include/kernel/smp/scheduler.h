@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2022 EKA2L1 Team.
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <common/sync.h>
+
+#include <cstdint>
+
+namespace eka2l1 {
+    namespace arm {
+        class core;
+    }
+
+    namespace mem {
+        class mmu_base;
+    }
+
+    namespace kernel {
+        class thread;
+        class process;
+    }
+}
+
+namespace eka2l1::kernel::smp {
+    /**
+     * \brief Scheduling state of a single core.
+     *
+     * Each core has its own ready queues, one for each of the 64 priorities, and picks the highest
+     * priority thread in them. A thread is queued on the core that its process is assigned to.
+     */
+    struct sub_scheduler {
+        std::uint32_t index_;
+
+        arm::core *run_core_;
+        mem::mmu_base *core_mmu_;
+
+        kernel::thread *readys_[64];
+        std::uint32_t ready_mask_[2];
+
+        kernel::thread *crr_thread_;
+        kernel::process *crr_process_;
+
+        std::uint32_t group_count_; ///< Number of processes assigned to this core.
+        common::event idle_event_;
+
+        explicit sub_scheduler(const std::uint32_t index, arm::core *run_core);
+    };
+}
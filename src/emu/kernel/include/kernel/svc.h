@@ -43,9 +43,9 @@
 #include <cstdint>
 #include <unordered_map>
 
-#define BRIDGE_REGISTER(func_sid, func)                                               \
-    {                                                                                 \
-        func_sid, eka2l1::hle::epoc_import_func { eka2l1::hle::bridge(&func), #func } \
+#define BRIDGE_REGISTER(func_sid, func)                                                                               \
+    {                                                                                                                 \
+        func_sid, eka2l1::hle::epoc_import_func { eka2l1::hle::bridge(&func), #func, eka2l1::hle::bridge_direct<&func> } \
     }
 
 #define BRIDGE_FUNC(ret, name, ...) ret name(kernel_system *kern, ##__VA_ARGS__)
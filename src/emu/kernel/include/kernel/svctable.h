@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2022 EKA2L1 Team.
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <kernel/common.h>
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace eka2l1::hle {
+    /**
+     * \brief SVCs by number, one dense table for each group of 0x10000 numbers.
+     *
+     * Group 0x00 is the slow executive and 0x80 the fast executive. EKA1 and the emulator's own
+     * calls take a few of the other groups.
+     */
+    class svc_table {
+    public:
+        struct slot {
+            const epoc_import_func *func_ = nullptr;
+
+            std::uint64_t call_count_ = 0;
+            std::uint64_t host_time_ns_ = 0;
+        };
+
+        enum : std::uint32_t {
+            GROUP_SHIFT = 16,
+            GROUP_COUNT = 256,
+            INDEX_MASK = 0xFFFF
+        };
+
+    private:
+        std::array<std::vector<slot>, GROUP_COUNT> groups_;
+
+    public:
+        /**
+         * \brief Rebuild the tables from registered SVCs.
+         *
+         * The slots point to the functions in the map, which must outlive the table. Call counts are reset.
+         *
+         * \param funcs The registered SVCs.
+         * \returns Number of SVCs ignored, because their number is out of range.
+         */
+        std::size_t build(const func_map &funcs);
+
+        /**
+         * \brief Find the slot of an SVC.
+         * \returns Null if the number is out of range, or no SVC is registered with it.
+         */
+        slot *find(const std::uint32_t svcnum);
+
+        /**
+         * \brief Report the SVCs called since the tables were built, as JSON, the most expensive first.
+         *
+         * Host time is also given converted to guest CPU cycles at the given clock, to compare it with
+         * the guest's own time slices. It is not a measured guest cost.
+         *
+         * \param cpu_hz Clock of the emulated CPU.
+         * \returns Empty if no SVC was called.
+         */
+        std::string profile_json(const std::uint64_t cpu_hz) const;
+    };
+}
@@ -45,6 +45,7 @@ namespace eka2l1 {
             int callback_type;
 
             signal_info info;
+            event_handle pending_event;
             bool outstanding;
 
         public:
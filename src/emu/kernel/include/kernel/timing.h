@@ -26,7 +26,9 @@
 #include <cstdint>
 #include <functional>
 #include <mutex>
+#include <optional>
 #include <thread>
+#include <unordered_map>
 #include <vector>
 
 namespace eka2l1 {
@@ -55,6 +57,90 @@ namespace eka2l1 {
         uint64_t event_user_data;
     };
 
+    using event_handle = std::uint64_t;
+    static constexpr event_handle INVALID_EVENT_HANDLE = 0;
+
+    /**
+     * @brief Pending timer events, ordered by due time.
+     *
+     * Events are kept in a binary min-heap. Each event also owns a slot that tracks its position in the heap,
+     * so it can be cancelled by handle in O(log n) without searching. A handle carries the generation of its
+     * slot, a stale handle never cancels the event that reuses the slot.
+     *
+     * Events due at the same time come out in the order they were pushed.
+     */
+    class event_queue {
+    private:
+        struct heap_node {
+            event evt_;
+            std::uint64_t order_;
+            std::uint32_t slot_;
+        };
+
+        struct slot {
+            std::uint32_t heap_index_;
+            std::uint32_t generation_;
+        };
+
+        std::vector<heap_node> heap_;
+        std::vector<slot> slots_;
+        std::vector<std::uint32_t> free_slots_;
+
+        // Lookup by user data, for cancelling with the event type and user data pair
+        std::unordered_multimap<std::uint64_t, std::uint32_t> slots_by_data_;
+
+        std::uint64_t order_counter_;
+
+        bool before(const std::size_t lhs, const std::size_t rhs) const;
+        void place(const std::size_t index, heap_node &&node);
+
+        void sift_up(std::size_t index);
+        void sift_down(std::size_t index);
+
+        void remove_at(const std::size_t index);
+        void unlink_data(const heap_node &node);
+
+    public:
+        explicit event_queue();
+
+        /**
+         * @brief Add an event to the queue.
+         * @returns Handle that can be used to cancel the event while it is pending.
+         */
+        event_handle push(const event &evt);
+
+        /**
+         * @brief Cancel a pending event.
+         * @returns False if the event has already fired or been cancelled.
+         */
+        bool cancel(const event_handle handle);
+
+        /**
+         * @brief Cancel a pending event by its type and user data.
+         *
+         * If multiple events match, the one due last is cancelled.
+         */
+        bool cancel(const int event_type, const std::uint64_t userdata);
+
+        /**
+         * @brief Get the event that is due first, or nullptr if there is none.
+         */
+        const event *top() const {
+            return heap_.empty() ? nullptr : &heap_.front().evt_;
+        }
+
+        event pop();
+        void clear();
+
+        bool empty() const {
+            return heap_.empty();
+        }
+
+        std::size_t size() const {
+            return heap_.size();
+        }
+    };
+
     namespace common {
         class chunkyseri;
     }
@@ -66,7 +152,7 @@ namespace eka2l1 {
      */
     class ntimer {
     private:
-        std::vector<event> events_;
+        event_queue events_;
         std::mutex lock_;
 
         common::event new_event_evt_;
@@ -151,8 +237,14 @@ namespace eka2l1 {
         void unregister_all_events();
         void remove_event(int event_type);
 
-        void schedule_event(int64_t us_into_future, int event_type, std::uint64_t userdata);
+        /**
+         * @brief Schedule an event to fire after the given number of microseconds.
+         * @returns Handle to unschedule the event with.
+         */
+        event_handle schedule_event(int64_t us_into_future, int event_type, std::uint64_t userdata);
+
         bool unschedule_event(int event_type, uint64_t userdata);
+        bool unschedule_event(const event_handle handle);
 
         bool set_clock_frequency_mhz(const std::uint32_t cpu_mhz);
         std::uint32_t get_clock_frequency_mhz();
@@ -0,0 +1,275 @@
+/*
+ * Copyright (c) 2022 EKA2L1 Team.
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <common/bytepair.h>
+#include <common/log.h>
+#include <common/thread.h>
+
+#include <kernel/chunk.h>
+#include <kernel/codepager.h>
+#include <kernel/codeseg.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace eka2l1::kernel {
+    // Decompressed pages waiting to be taken by a fault. Older ones are not kept if the guest never comes
+    static constexpr std::size_t MAX_STAGED_PAGES = 64;
+
+    code_pager::code_pager(const std::uint32_t read_ahead_pages)
+        : read_ahead_pages_(read_ahead_pages)
+        , should_stop_(false)
+        , pages_filled_(0)
+        , pages_prefetched_(0) {
+        if (read_ahead_pages_) {
+            prefetch_thread_ = std::thread([this]() {
+                prefetch_thread_loop();
+            });
+        }
+    }
+
+    code_pager::~code_pager() {
+        {
+            const std::lock_guard<std::mutex> guard(prefetch_lock_);
+            should_stop_ = true;
+        }
+
+        prefetch_cond_.notify_one();
+
+        if (prefetch_thread_.joinable()) {
+            prefetch_thread_.join();
+        }
+
+        if (pages_filled_) {
+            LOG_INFO(KERNEL, "Code pager filled {} pages, {} of them prefetched", pages_filled_, pages_prefetched_);
+        }
+    }
+
+    void code_pager::prefetch_thread_loop() {
+        common::set_thread_name("Code prefetcher");
+
+        while (true) {
+            prefetch_request request;
+
+            {
+                std::unique_lock<std::mutex> guard(prefetch_lock_);
+                prefetch_cond_.wait(guard, [this]() {
+                    return should_stop_ || !prefetch_queue_.empty();
+                });
+
+                if (should_stop_) {
+                    break;
+                }
+
+                request = std::move(prefetch_queue_.front());
+                prefetch_queue_.pop_front();
+            }
+
+            std::vector<std::uint8_t> content(common::BYTEPAIR_PAGE_SIZE);
+            if (!request.store_->read_page(content.data(), request.page_)) {
+                continue;
+            }
+
+            const std::lock_guard<std::mutex> guard(prefetch_lock_);
+
+            // The image may have been unloaded while the page was decompressed
+            if ((live_stores_.find(request.store_.get()) != live_stores_.end()) && (staged_.size() < MAX_STAGED_PAGES)) {
+                staged_.emplace(staged_key{ request.store_.get(), request.page_ }, std::move(content));
+            }
+        }
+    }
+
+    void code_pager::add(paged_code_info *info) {
+        const std::lock_guard<std::mutex> ranges_guard(ranges_lock_);
+        const std::lock_guard<std::mutex> guard(prefetch_lock_);
+
+        ranges_.push_back(info);
+        live_stores_[info->seg_->get_code_pages().get()]++;
+    }
+
+    void code_pager::remove(paged_code_info *info) {
+        const std::lock_guard<std::mutex> ranges_guard(ranges_lock_);
+        remove_locked(info);
+    }
+
+    void code_pager::remove_locked(paged_code_info *info) {
+        auto ite = std::find(ranges_.begin(), ranges_.end(), info);
+        if (ite == ranges_.end()) {
+            return;
+        }
+
+        ranges_.erase(ite);
+
+        const std::lock_guard<std::mutex> guard(prefetch_lock_);
+        const common::bytepair_page_store *store = info->seg_->get_code_pages().get();
+
+        auto store_ite = live_stores_.find(store);
+        if ((store_ite != live_stores_.end()) && (--store_ite->second == 0)) {
+            live_stores_.erase(store_ite);
+
+            prefetch_queue_.erase(std::remove_if(prefetch_queue_.begin(), prefetch_queue_.end(), [store](const prefetch_request &request) {
+                return request.store_.get() == store;
+            }),
+                prefetch_queue_.end());
+
+            for (auto staged_ite = staged_.begin(); staged_ite != staged_.end();) {
+                if (staged_ite->first.first == store) {
+                    staged_ite = staged_.erase(staged_ite);
+                } else {
+                    staged_ite++;
+                }
+            }
+        }
+    }
+
+    void code_pager::clear() {
+        const std::lock_guard<std::mutex> ranges_guard(ranges_lock_);
+        ranges_.clear();
+
+        const std::lock_guard<std::mutex> guard(prefetch_lock_);
+
+        prefetch_queue_.clear();
+        staged_.clear();
+        live_stores_.clear();
+    }
+
+    void code_pager::queue_read_ahead(paged_code_info &info, const std::uint32_t page) {
+        const std::uint32_t last_page = std::min<std::uint32_t>(page + read_ahead_pages_, static_cast<std::uint32_t>(info.filled_.size() - 1));
+        const std::shared_ptr<common::bytepair_page_store> &store = info.seg_->get_code_pages();
+
+        bool queued = false;
+
+        {
+            const std::lock_guard<std::mutex> guard(prefetch_lock_);
+
+            for (std::uint32_t next = page + 1; next <= last_page; next++) {
+                if (info.filled_[next] || (staged_.find(staged_key{ store.get(), next }) != staged_.end())) {
+                    continue;
+                }
+
+                const bool already_queued = std::any_of(prefetch_queue_.begin(), prefetch_queue_.end(), [&](const prefetch_request &request) {
+                    return (request.store_ == store) && (request.page_ == next);
+                });
+
+                if (!already_queued && (staged_.size() + prefetch_queue_.size() < MAX_STAGED_PAGES)) {
+                    prefetch_queue_.push_back(prefetch_request{ store, next });
+                    queued = true;
+                }
+            }
+        }
+
+        if (queued) {
+            prefetch_cond_.notify_one();
+        }
+    }
+
+    paged_code_info *code_pager::find_range(kernel::process *pr, const address addr) {
+        auto ite = std::find_if(ranges_.begin(), ranges_.end(), [=](paged_code_info *info) {
+            return (!info->owner_ || (info->owner_ == pr)) && (addr >= info->run_addr_)
+                && (addr - info->run_addr_ < info->filled_.size() * common::BYTEPAIR_PAGE_SIZE);
+        });
+
+        return (ite == ranges_.end()) ? nullptr : *ite;
+    }
+
+    bool code_pager::handle_fault(kernel::process *pr, const address addr) {
+        const std::lock_guard<std::mutex> guard(ranges_lock_);
+
+        paged_code_info *info = find_range(pr, addr);
+        if (!info) {
+            return false;
+        }
+
+        const std::uint32_t page = (addr - info->run_addr_) / common::BYTEPAIR_PAGE_SIZE;
+
+        if (!info->seg_->fill_code_page(*info, page)) {
+            return false;
+        }
+
+        if (info->pages_left_ == 0) {
+            remove_locked(info);
+        } else if (read_ahead_pages_) {
+            queue_read_ahead(*info, page);
+        }
+
+        return true;
+    }
+
+    void code_pager::fill_all_locked(paged_code_info *info) {
+        for (std::uint32_t i = 0; (i < info->filled_.size()) && (info->pages_left_ != 0); i++) {
+            info->seg_->fill_code_page(*info, i);
+        }
+
+        remove_locked(info);
+    }
+
+    void code_pager::fill_all(paged_code_info *info) {
+        const std::lock_guard<std::mutex> guard(ranges_lock_);
+        fill_all_locked(info);
+    }
+
+    bool code_pager::fill_host_range(kernel::process *pr, const std::uint8_t *host, const std::size_t size) {
+        const std::lock_guard<std::mutex> guard(ranges_lock_);
+
+        auto ite = std::find_if(ranges_.begin(), ranges_.end(), [=](paged_code_info *info) {
+            const std::uint8_t *base = reinterpret_cast<const std::uint8_t *>(info->code_chunk_->host_base());
+            return (!info->owner_ || (info->owner_ == pr)) && (host >= base)
+                && (static_cast<std::size_t>(host - base) < info->filled_.size() * common::BYTEPAIR_PAGE_SIZE);
+        });
+
+        if (ite == ranges_.end()) {
+            return false;
+        }
+
+        paged_code_info *info = *ite;
+
+        const std::size_t offset = host - reinterpret_cast<const std::uint8_t *>(info->code_chunk_->host_base());
+        const std::size_t last_page = std::min<std::size_t>((offset + std::max<std::size_t>(size, 1) - 1) / common::BYTEPAIR_PAGE_SIZE,
+            info->filled_.size() - 1);
+
+        for (std::size_t page = offset / common::BYTEPAIR_PAGE_SIZE; page <= last_page; page++) {
+            info->seg_->fill_code_page(*info, static_cast<std::uint32_t>(page));
+        }
+
+        if (info->pages_left_ == 0) {
+            remove_locked(info);
+        }
+
+        return true;
+    }
+
+    bool code_pager::read_page(const std::shared_ptr<common::bytepair_page_store> &store, const std::uint32_t page, std::uint8_t *dest) {
+        pages_filled_++;
+
+        {
+            const std::lock_guard<std::mutex> guard(prefetch_lock_);
+            auto ite = staged_.find(staged_key{ store.get(), page });
+
+            if (ite != staged_.end()) {
+                std::memcpy(dest, ite->second.data(), ite->second.size());
+                staged_.erase(ite);
+
+                pages_prefetched_++;
+                return true;
+            }
+        }
+
+        return store->read_page(dest, page) != 0;
+    }
+}
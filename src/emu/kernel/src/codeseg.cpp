@@ -19,6 +19,7 @@
  */
 
 #include <common/algorithm.h>
+#include <common/bytepair.h>
 #include <common/log.h>
 #include <kernel/codeseg.h>
 #include <kernel/kernel.h>
@@ -63,8 +64,18 @@ namespace eka2l1::kernel {
         }
 
         if (code_addr == 0) {
-            code_data = std::make_unique<std::uint8_t[]>(info.code_size);
-            std::copy(info.code_data, info.code_data + info.code_size, code_data.get());
+            if (info.code_pages) {
+                paged_code_size_ = info.paged_code_size;
+                code_pages_ = info.code_pages;
+            }
+
+            code_data = std::make_unique<std::uint8_t[]>(info.code_size - paged_code_size_);
+            std::copy(info.code_data + paged_code_size_, info.code_data + info.code_size, code_data.get());
+
+            // Pages are only filled on access through the pager
+            if (paged_code_size_ && (!kern->get_code_pager() || (kern->get_memory_system()->get_page_size() != common::BYTEPAIR_PAGE_SIZE))) {
+                unpage_code();
+            }
         }
 
         relocation_list = info.relocation_list;
@@ -72,6 +83,7 @@ namespace eka2l1::kernel {
 
     int codeseg::destroy() {
         if (code_chunk_shared) {
+            drop_paged_code(code_chunk_shared);
             kern->destroy(code_chunk_shared);
         }
 
@@ -172,6 +184,23 @@ namespace eka2l1::kernel {
         bool code_chunk_for_reuse = eligible_for_codeseg_reuse();
         bool need_patch_and_reloc = true;
 
+        std::unique_ptr<paged_code_info> paged_code;
+
+        // Fixups that cross the end of a paged page can not be applied on one page fill
+        bool paged_code_straddled = false;
+
+        auto is_paged_fixup = [&](const std::uint32_t offset) {
+            if (!paged_code || (offset >= paged_code_size_)) {
+                return false;
+            }
+
+            if ((offset % common::BYTEPAIR_PAGE_SIZE) > common::BYTEPAIR_PAGE_SIZE - sizeof(std::uint32_t)) {
+                paged_code_straddled = true;
+            }
+
+            return true;
+        };
+
         unmark();
         increase_access_count();
 
@@ -183,6 +212,40 @@ namespace eka2l1::kernel {
 
                 code_chunk->open_to(new_foe);
                 the_addr_of_code_run = code_chunk->base(new_foe).ptr_address();
+            } else if (code_pages_) {
+                // Only the pages after the text are committed now, the rest is filled on access
+                code_chunk = kern->create<kernel::chunk>(mem, code_chunk_for_reuse ? nullptr : new_foe, "", 0, 0, code_size_align, prot_read_write_exec, kernel::chunk_type::disconnected,
+                    kernel::chunk_access::code, kernel::chunk_attrib::none);
+
+                if (!code_chunk_for_reuse) {
+                    code_chunk->open_to(new_foe);
+                }
+
+                the_addr_of_code_run = code_chunk->base(new_foe).ptr_address();
+                code_base_ptr = reinterpret_cast<std::uint8_t *>(code_chunk->host_base());
+
+                if ((code_size_align > paged_code_size_) && !code_chunk->commit(paged_code_size_, code_size_align - paged_code_size_)) {
+                    LOG_ERROR(KERNEL, "Unable to commit code memory of {}", name());
+                    return false;
+                }
+
+                std::copy(code_data.get(), code_data.get() + code_size - paged_code_size_, code_base_ptr + paged_code_size_); // .code
+
+                const std::uint32_t page_count = paged_code_size_ / common::BYTEPAIR_PAGE_SIZE;
+
+                paged_code = std::make_unique<paged_code_info>();
+                paged_code->seg_ = this;
+                paged_code->owner_ = code_chunk_for_reuse ? nullptr : new_foe;
+                paged_code->code_chunk_ = code_chunk;
+                paged_code->run_addr_ = the_addr_of_code_run;
+                paged_code->page_imports_.resize(page_count);
+                paged_code->page_relocations_.resize(page_count);
+                paged_code->filled_.resize(page_count, false);
+                paged_code->pages_left_ = page_count;
+
+                if (code_chunk_for_reuse) {
+                    code_chunk_shared = code_chunk;
+                }
             } else {
                 code_chunk = kern->create<kernel::chunk>(mem, code_chunk_for_reuse ? nullptr : new_foe, "", 0, code_size_align, code_size_align, prot_read_write_exec, kernel::chunk_type::normal,
                     kernel::chunk_access::code, kernel::chunk_attrib::none);
@@ -260,6 +323,12 @@ namespace eka2l1::kernel {
 
         attaches.emplace_back(std::make_unique<attached_info>(this, new_foe, dt_chunk, code_chunk));
 
+        kernel::jit_cache *cache = kern->get_jit_cache();
+        if (cache && !code_pages_) {
+            // Key the cache with the code before imports and relocations are applied
+            cache->track(this, new_foe, the_addr_of_code_run, code_addr ? code_base_ptr : code_data.get());
+        }
+
         // Attach all of its dependencies
         for (auto &dependency : dependencies) {
             dependency.dep_->attach(new_foe);
@@ -277,6 +346,11 @@ namespace eka2l1::kernel {
                             LOG_ERROR(KERNEL, "Invalid ordinal {}, requested from {}", ord, dependency.dep_->name());
                         }
 
+                        if (is_paged_fixup(offset_to_apply)) {
+                            paged_code->page_imports_[offset_to_apply / common::BYTEPAIR_PAGE_SIZE].push_back(paged_code_fixup{ offset_to_apply, addr + adj });
+                            continue;
+                        }
+
                         *reinterpret_cast<std::uint32_t *>(&code_base_ptr[offset_to_apply]) = addr + adj;
                     }
                 }
@@ -284,80 +358,183 @@ namespace eka2l1::kernel {
         }
 
         if (need_patch_and_reloc) {
-            if (!relocation_list.empty()) {
-                const std::uint32_t code_delta = the_addr_of_code_run - code_base;
-                const std::uint32_t data_delta = the_addr_of_data_run - data_base;
+            const std::uint32_t code_delta = the_addr_of_code_run - code_base;
+            const std::uint32_t data_delta = the_addr_of_data_run - data_base;
 
-                // Relocate the image
-                for (const std::uint64_t relocate_info : relocation_list) {
-                    const loader::relocation_type rel_type = static_cast<loader::relocation_type>((relocate_info >> 32) & 0xFFFF);
-                    const std::uint32_t offset_to_relocate = static_cast<std::uint32_t>(relocate_info);
+            // Relocate the image
+            for (const std::uint64_t relocate_info : relocation_list) {
+                const loader::relocate_section sect_type = static_cast<loader::relocate_section>((relocate_info >> 48) & 0xFFFF);
+                const std::uint32_t offset_to_relocate = static_cast<std::uint32_t>(relocate_info);
 
-                    loader::relocate_section sect_type = static_cast<loader::relocate_section>((relocate_info >> 48) & 0xFFFF);
-                    address the_delta = 0;
+                if ((sect_type == loader::relocate_section_text) && is_paged_fixup(offset_to_relocate)) {
+                    paged_code->page_relocations_[offset_to_relocate / common::BYTEPAIR_PAGE_SIZE].push_back(relocate_info);
+                    continue;
+                }
 
-                    std::uint8_t *base_ptr = nullptr;
+                apply_relocation(code_base_ptr, data_base_ptr, relocate_info, code_delta, data_delta);
+            }
 
-                    switch (sect_type) {
-                    case loader::relocate_section_text:
-                        base_ptr = code_base_ptr;
-                        break;
+            if (paged_code) {
+                paged_code->code_delta_ = code_delta;
+                paged_code->data_delta_ = data_delta;
 
-                    case loader::relocate_section_data:
-                        base_ptr = data_base_ptr;
-                        break;
+                paged_codes_.push_back(std::move(paged_code));
+                kern->get_code_pager()->add(paged_codes_.back().get());
 
-                    default:
-                        break;
-                    }
+                if (paged_code_straddled) {
+                    fill_all_code_pages(code_chunk);
+                }
+            }
+        }
 
-                    std::uint32_t *to_relocate_ptr = reinterpret_cast<std::uint32_t *>(&base_ptr[offset_to_relocate]);
+        if (new_foe)
+            new_foe->codeseg_list.push(&attaches.back()->process_link);
 
-                    switch (rel_type) {
-                    case loader::relocation_type::data:
-                        the_delta = data_delta;
-                        break;
+        kern->run_codeseg_loaded_callback(obj_name, new_foe, this);
 
-                    case loader::relocation_type::text:
-                        the_delta = code_delta;
-                        break;
+        return true;
+    }
 
-                    case loader::relocation_type::inferred: {
-                        // This one is harder
-                        std::uint32_t val = *to_relocate_ptr;
+    void codeseg::apply_relocation(std::uint8_t *code_ptr, std::uint8_t *data_ptr, const std::uint64_t relocate_info,
+        const std::uint32_t code_delta, const std::uint32_t data_delta) {
+        const loader::relocation_type rel_type = static_cast<loader::relocation_type>((relocate_info >> 32) & 0xFFFF);
+        const std::uint32_t offset_to_relocate = static_cast<std::uint32_t>(relocate_info);
 
-                        if ((code_base <= val) && (val <= code_base + code_size)) {
-                            the_delta = code_delta;
-                        } else if ((data_base <= val) && (val <= data_base + data_size + bss_size)) {
-                            the_delta = data_delta;
-                        } else {
-                            LOG_ERROR(KERNEL, "Unable to infer the relocation type of offset 0x{:X}", val);
-                        }
+        loader::relocate_section sect_type = static_cast<loader::relocate_section>((relocate_info >> 48) & 0xFFFF);
+        address the_delta = 0;
 
-                        break;
-                    }
+        std::uint8_t *base_ptr = nullptr;
 
-                    case loader::relocation_type::reserved:
-                        continue;
+        switch (sect_type) {
+        case loader::relocate_section_text:
+            base_ptr = code_ptr;
+            break;
 
-                    default:
-                        LOG_ERROR(KERNEL, "Unknown code relocation type {}", static_cast<std::uint32_t>(rel_type));
-                        break;
-                    }
+        case loader::relocate_section_data:
+            base_ptr = data_ptr;
+            break;
 
-                    *to_relocate_ptr = *to_relocate_ptr + the_delta;
-                }
+        default:
+            break;
+        }
+
+        std::uint32_t *to_relocate_ptr = reinterpret_cast<std::uint32_t *>(&base_ptr[offset_to_relocate]);
+
+        switch (rel_type) {
+        case loader::relocation_type::data:
+            the_delta = data_delta;
+            break;
+
+        case loader::relocation_type::text:
+            the_delta = code_delta;
+            break;
+
+        case loader::relocation_type::inferred: {
+            // This one is harder
+            std::uint32_t val = *to_relocate_ptr;
+
+            if ((code_base <= val) && (val <= code_base + code_size)) {
+                the_delta = code_delta;
+            } else if ((data_base <= val) && (val <= data_base + data_size + bss_size)) {
+                the_delta = data_delta;
+            } else {
+                LOG_ERROR(KERNEL, "Unable to infer the relocation type of offset 0x{:X}", val);
             }
+
+            break;
         }
 
-        if (new_foe)
-            new_foe->codeseg_list.push(&attaches.back()->process_link);
+        case loader::relocation_type::reserved:
+            return;
 
-        kern->run_codeseg_loaded_callback(obj_name, new_foe, this);
+        default:
+            LOG_ERROR(KERNEL, "Unknown code relocation type {}", static_cast<std::uint32_t>(rel_type));
+            break;
+        }
+
+        *to_relocate_ptr = *to_relocate_ptr + the_delta;
+    }
+
+    void codeseg::copy_code(std::uint8_t *dest) {
+        for (std::uint32_t i = 0; i < paged_code_size_ / common::BYTEPAIR_PAGE_SIZE; i++) {
+            code_pages_->read_page(dest + i * common::BYTEPAIR_PAGE_SIZE, i);
+        }
+
+        std::copy(code_data.get(), code_data.get() + code_size - paged_code_size_, dest + paged_code_size_);
+    }
+
+    void codeseg::unpage_code() {
+        std::unique_ptr<std::uint8_t[]> full_code = std::make_unique<std::uint8_t[]>(code_size);
+        copy_code(full_code.get());
+
+        code_data = std::move(full_code);
+        code_pages_.reset();
+        paged_code_size_ = 0;
+    }
+
+    bool codeseg::fill_code_page(paged_code_info &info, const std::uint32_t page) {
+        if (info.filled_[page]) {
+            return true;
+        }
+
+        const std::uint32_t offset = page * common::BYTEPAIR_PAGE_SIZE;
+
+        if (!info.code_chunk_->commit(offset, common::BYTEPAIR_PAGE_SIZE)) {
+            LOG_ERROR(KERNEL, "Unable to commit code page {} of {}", page, name());
+            return false;
+        }
+
+        std::uint8_t *code_ptr = reinterpret_cast<std::uint8_t *>(info.code_chunk_->host_base());
+
+        if (!kern->get_code_pager()->read_page(code_pages_, page, code_ptr + offset)) {
+            LOG_ERROR(KERNEL, "Unable to decompress code page {} of {}", page, name());
+        }
+
+        for (const paged_code_fixup &fixup : info.page_imports_[page]) {
+            *reinterpret_cast<std::uint32_t *>(code_ptr + fixup.offset_) = fixup.value_;
+        }
+
+        // Only text relocations are deferred, the data chunk is not needed
+        for (const std::uint64_t relocate_info : info.page_relocations_[page]) {
+            apply_relocation(code_ptr, nullptr, relocate_info, info.code_delta_, info.data_delta_);
+        }
+
+        info.page_imports_[page] = std::vector<paged_code_fixup>();
+        info.page_relocations_[page] = std::vector<std::uint64_t>();
+        info.filled_[page] = true;
+        info.pages_left_--;
 
         return true;
     }
 
+    void codeseg::fill_all_code_pages(chunk_ptr code_chunk) {
+        auto ite = std::find_if(paged_codes_.begin(), paged_codes_.end(), [=](const std::unique_ptr<paged_code_info> &info) {
+            return info->code_chunk_ == code_chunk;
+        });
+
+        if (ite == paged_codes_.end()) {
+            return;
+        }
+
+        kern->get_code_pager()->fill_all(ite->get());
+    }
+
+    void codeseg::drop_paged_code(chunk_ptr code_chunk) {
+        auto ite = std::find_if(paged_codes_.begin(), paged_codes_.end(), [=](const std::unique_ptr<paged_code_info> &info) {
+            return info->code_chunk_ == code_chunk;
+        });
+
+        if (ite == paged_codes_.end()) {
+            return;
+        }
+
+        if (code_pager *pager = kern->get_code_pager()) {
+            pager->remove(ite->get());
+        }
+
+        paged_codes_.erase(ite);
+    }
+
     void codeseg::free_attached_data(attached_info &info) {
         auto ite = std::find_if(attaches.begin(), attaches.end(), [&](const std::unique_ptr<attached_info> &ptr) {
             return ptr.get() == &info;
@@ -368,6 +545,10 @@ namespace eka2l1::kernel {
             return;
         }
 
+        if (kernel::jit_cache *cache = kern->get_jit_cache()) {
+            cache->collect(kern->get_cpus(), this, info.attached_process);
+        }
+
         if (info.data_chunk) {
             if (info.data_chunk->position_access() != kernel::chunk_access::dll_static_data) {
                 kern->destroy(info.data_chunk);
@@ -382,6 +563,7 @@ namespace eka2l1::kernel {
         }
 
         if (!code_chunk_shared && info.code_chunk) {
+            drop_paged_code(info.code_chunk);
             kern->destroy(info.code_chunk);
         }
 
@@ -545,6 +727,8 @@ namespace eka2l1::kernel {
         attached_info *attach_info = attach_info_ptr->get();
 
         if (base) {
+            // The caller reads or patches the code directly from the host
+            fill_all_code_pages(attach_info->code_chunk);
             *base = reinterpret_cast<std::uint8_t *>(attach_info->code_chunk->host_base());
         }
 
@@ -806,7 +990,15 @@ namespace eka2l1::kernel {
         XXH32_state_t *state = XXH32_createState();
 
         XXH32_reset(state, 0x5B001101);
-        XXH32_update(state, code_data.get(), code_size);
+
+        if (code_pages_) {
+            std::vector<std::uint8_t> full_code(code_size);
+            copy_code(full_code.data());
+
+            XXH32_update(state, full_code.data(), code_size);
+        } else {
+            XXH32_update(state, code_data.get(), code_size);
+        }
 
         hash_ = XXH32_digest(state);
         XXH32_freeState(state);
@@ -0,0 +1,345 @@
+/*
+ * Copyright (c) 2022 EKA2L1 Team.
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <common/buffer.h>
+#include <common/fileutils.h>
+#include <common/log.h>
+#include <common/path.h>
+
+#include <kernel/codeseg.h>
+#include <kernel/jitcache.h>
+#include <kernel/process.h>
+
+#include <fmt/format.h>
+#include <xxHash/xxhash.h>
+
+#include <algorithm>
+#include <chrono>
+
+namespace eka2l1::kernel {
+    static constexpr std::uint32_t JIT_CACHE_MAGIC = 0x4354494A; // JITC
+    static constexpr std::uint32_t JIT_CACHE_VERSION = 2;
+
+    static constexpr std::uint32_t JIT_CACHE_BLOCK_FLAG_THUMB = 1 << 0;
+    static constexpr std::uint32_t JIT_CACHE_BLOCK_FLAG_TRANSLATED = 1 << 1;
+
+    // Blocks stop at a branch or the end of a page, so a longer one can only come from a broken file
+    static constexpr std::uint32_t JIT_CACHE_MAX_BLOCK_INSTS = 2048;
+
+    jit_cache::jit_cache(const std::string &root, const std::string &build_id)
+        : root_(root)
+        , build_id_(build_id)
+        , total_warmed_(0)
+        , total_collected_(0) {
+        common::create_directories(root_);
+    }
+
+    std::uint64_t jit_cache::content_key(const std::uint8_t *code, const std::size_t size) {
+        return XXH64(code, size, 0x4A495443);
+    }
+
+    std::string jit_cache::file_path(const std::uint64_t key) const {
+        return eka2l1::add_path(root_, fmt::format("{:016X}.jcache", key));
+    }
+
+    jit_cache::profile &jit_cache::get_profile(const std::uint64_t key) {
+        profile &target = profiles_[key];
+
+        if (!target.loaded_) {
+            load_profile(key, target);
+            target.loaded_ = true;
+        }
+
+        return target;
+    }
+
+    bool jit_cache::load_profile(const std::uint64_t key, profile &target) {
+        common::ro_std_file_stream stream(file_path(key), true);
+
+        if (!stream.valid()) {
+            return false;
+        }
+
+        std::uint32_t magic = 0;
+        std::uint32_t version = 0;
+
+        if ((stream.read(&magic, sizeof(magic)) != sizeof(magic)) || (magic != JIT_CACHE_MAGIC)) {
+            return false;
+        }
+
+        if ((stream.read(&version, sizeof(version)) != sizeof(version)) || (version != JIT_CACHE_VERSION)) {
+            return false;
+        }
+
+        std::uint32_t build_id_length = 0;
+        if ((stream.read(&build_id_length, sizeof(build_id_length)) != sizeof(build_id_length)) || (build_id_length > 256)) {
+            return false;
+        }
+
+        std::string build_id(build_id_length, '\0');
+        if (stream.read(build_id.data(), build_id_length) != build_id_length) {
+            return false;
+        }
+
+        if (build_id != build_id_) {
+            // Translator may have changed, the file will be rewritten on next save
+            LOG_TRACE(KERNEL, "JIT cache {:016X} is from build {}, ignored", key, build_id);
+            return false;
+        }
+
+        std::uint64_t stored_key = 0;
+        std::uint32_t count = 0;
+
+        if ((stream.read(&stored_key, sizeof(stored_key)) != sizeof(stored_key)) || (stored_key != key)) {
+            return false;
+        }
+
+        if (stream.read(&count, sizeof(count)) != sizeof(count)) {
+            return false;
+        }
+
+        for (std::uint32_t i = 0; i < count; i++) {
+            // Offset, FPSCR, flags and instruction count
+            std::uint32_t block_data[4];
+
+            if ((stream.read(block_data, sizeof(block_data)) != sizeof(block_data)) || (block_data[3] > JIT_CACHE_MAX_BLOCK_INSTS)) {
+                target.blocks_.clear();
+                return false;
+            }
+
+            block_entry entry{ (block_data[2] & JIT_CACHE_BLOCK_FLAG_THUMB) != 0, (block_data[2] & JIT_CACHE_BLOCK_FLAG_TRANSLATED) != 0,
+                block_data[1] };
+
+            entry.insts_.resize(block_data[3]);
+
+            for (arm::decoded_inst_info &inst : entry.insts_) {
+                std::uint32_t inst_data[3];
+
+                if (stream.read(inst_data, sizeof(inst_data)) != sizeof(inst_data)) {
+                    target.blocks_.clear();
+                    return false;
+                }
+
+                inst.word_ = inst_data[0];
+                inst.code_ = inst_data[1];
+                inst.handler_ = static_cast<std::uint16_t>(inst_data[2] & 0xFFFF);
+                inst.size_ = static_cast<std::uint16_t>(inst_data[2] >> 16);
+            }
+
+            target.blocks_.emplace(block_data[0], std::move(entry));
+        }
+
+        return true;
+    }
+
+    bool jit_cache::save_profile(const std::uint64_t key, profile &target) {
+        common::wo_std_file_stream stream(file_path(key), true);
+
+        if (!stream.valid()) {
+            LOG_WARN(KERNEL, "Unable to write JIT cache file {}", file_path(key));
+            return false;
+        }
+
+        const std::uint32_t build_id_length = static_cast<std::uint32_t>(build_id_.length());
+        const std::uint32_t count = static_cast<std::uint32_t>(target.blocks_.size());
+
+        stream.write(&JIT_CACHE_MAGIC, sizeof(JIT_CACHE_MAGIC));
+        stream.write(&JIT_CACHE_VERSION, sizeof(JIT_CACHE_VERSION));
+        stream.write(&build_id_length, sizeof(build_id_length));
+        stream.write(build_id_.data(), build_id_length);
+        stream.write(&key, sizeof(key));
+        stream.write(&count, sizeof(count));
+
+        for (const auto &[offset, entry] : target.blocks_) {
+            const std::uint32_t flags = (entry.thumb_ ? JIT_CACHE_BLOCK_FLAG_THUMB : 0) | (entry.translated_ ? JIT_CACHE_BLOCK_FLAG_TRANSLATED : 0);
+            const std::uint32_t block_data[4] = { offset, entry.fpscr_, flags, static_cast<std::uint32_t>(entry.insts_.size()) };
+
+            stream.write(block_data, sizeof(block_data));
+
+            for (const arm::decoded_inst_info &inst : entry.insts_) {
+                const std::uint32_t inst_data[3] = { inst.word_, inst.code_, inst.handler_ | (static_cast<std::uint32_t>(inst.size_) << 16) };
+                stream.write(inst_data, sizeof(inst_data));
+            }
+        }
+
+        target.dirty_ = false;
+        return true;
+    }
+
+    void jit_cache::track(kernel::codeseg *seg, kernel::process *pr, const address run_addr, const std::uint8_t *pristine_code) {
+        if (!pristine_code || !seg->get_text_size()) {
+            return;
+        }
+
+        tracked_segment segment;
+        segment.seg_ = seg;
+        segment.process_ = pr;
+        segment.run_addr_ = run_addr;
+        segment.text_size_ = seg->get_text_size();
+        segment.key_ = content_key(pristine_code, seg->get_code_size());
+        segment.warmed_ = false;
+
+        tracked_.push_back(segment);
+    }
+
+    void jit_cache::warm(arm::core *cc, kernel::process *pr) {
+        std::size_t loaded = 0;
+        std::size_t queued = 0;
+        const auto start = std::chrono::steady_clock::now();
+
+        for (tracked_segment &segment : tracked_) {
+            if (segment.warmed_ || (segment.process_ != pr)) {
+                continue;
+            }
+
+            segment.warmed_ = true;
+
+            if (poisoned_.count(segment.key_)) {
+                continue;
+            }
+
+            const std::uint8_t *code = reinterpret_cast<const std::uint8_t *>(pr->get_ptr_on_addr_space(segment.run_addr_, segment.text_size_));
+            if (!code) {
+                continue;
+            }
+
+            profile &prof = get_profile(segment.key_);
+
+            std::vector<arm::decoded_block_info> decoded_blocks;
+            std::vector<arm::translated_block_info> blocks;
+
+            for (const auto &[offset, entry] : prof.blocks_) {
+                if (offset >= segment.text_size_) {
+                    continue;
+                }
+
+                if (!entry.insts_.empty()) {
+                    decoded_blocks.push_back({ segment.run_addr_ + offset, entry.thumb_, entry.insts_ });
+                }
+
+                if (entry.translated_) {
+                    blocks.push_back({ segment.run_addr_ + offset, entry.thumb_, entry.fpscr_ });
+                }
+            }
+
+            loaded += cc->import_decoded_blocks(segment.run_addr_, code, segment.text_size_, decoded_blocks);
+
+            // The worker translates them while the process runs
+            queued += cc->queue_precompile_blocks(segment.run_addr_, code, segment.text_size_, blocks);
+        }
+
+        if (loaded || queued) {
+            total_warmed_ += loaded + queued;
+
+            LOG_TRACE(KERNEL, "Loaded {} decoded blocks and queued {} blocks for translation for process {} in {} us", loaded,
+                queued, pr->name(), std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+        }
+    }
+
+    void jit_cache::collect_segment(const std::vector<arm::core *> &cores, tracked_segment &segment) {
+        if (poisoned_.count(segment.key_)) {
+            return;
+        }
+
+        // Each core has its own translations
+        std::vector<arm::decoded_block_info> decoded_blocks;
+        std::vector<arm::translated_block_info> blocks;
+
+        for (arm::core *cc : cores) {
+            cc->export_decoded_blocks(segment.run_addr_, segment.run_addr_ + segment.text_size_, decoded_blocks);
+            cc->collect_translated_blocks(segment.run_addr_, segment.run_addr_ + segment.text_size_, blocks);
+        }
+
+        if (decoded_blocks.empty() && blocks.empty()) {
+            return;
+        }
+
+        profile &prof = get_profile(segment.key_);
+
+        for (arm::decoded_block_info &block : decoded_blocks) {
+            auto [ite, added] = prof.blocks_.try_emplace(block.addr_ - segment.run_addr_, block_entry{ block.thumb_, false, 0 });
+
+            if (added) {
+                total_collected_++;
+            }
+
+            if (ite->second.insts_.empty()) {
+                ite->second.insts_ = std::move(block.insts_);
+                prof.dirty_ = true;
+            }
+        }
+
+        for (const arm::translated_block_info &block : blocks) {
+            auto [ite, added] = prof.blocks_.try_emplace(block.addr_ - segment.run_addr_, block_entry{ block.thumb_, false, block.fpscr_ });
+
+            if (added) {
+                total_collected_++;
+            }
+
+            if (!ite->second.translated_) {
+                ite->second.translated_ = true;
+                ite->second.fpscr_ = block.fpscr_;
+                prof.dirty_ = true;
+            }
+        }
+
+        if (prof.dirty_) {
+            save_profile(segment.key_, prof);
+        }
+    }
+
+    void jit_cache::collect(const std::vector<arm::core *> &cores, kernel::codeseg *seg, kernel::process *pr) {
+        auto ite = std::find_if(tracked_.begin(), tracked_.end(), [seg, pr](const tracked_segment &segment) {
+            return (segment.seg_ == seg) && (segment.process_ == pr);
+        });
+
+        if (ite == tracked_.end()) {
+            return;
+        }
+
+        collect_segment(cores, *ite);
+        tracked_.erase(ite);
+    }
+
+    void jit_cache::collect_all(const std::vector<arm::core *> &cores) {
+        for (tracked_segment &segment : tracked_) {
+            collect_segment(cores, segment);
+        }
+
+        tracked_.clear();
+
+        LOG_INFO(KERNEL, "JIT cache: {} blocks loaded or queued for translation ahead of time, {} new blocks recorded", total_warmed_,
+            total_collected_);
+    }
+
+    void jit_cache::invalidate(kernel::process *pr, const address addr, const std::size_t size) {
+        for (const tracked_segment &segment : tracked_) {
+            if ((segment.process_ != pr) || (addr >= segment.run_addr_ + segment.text_size_) || (addr + size <= segment.run_addr_)) {
+                continue;
+            }
+
+            if (poisoned_.insert(segment.key_).second) {
+                LOG_TRACE(KERNEL, "Code segment {} modified itself, dropping its JIT cache", segment.seg_->name());
+
+                profiles_.erase(segment.key_);
+                common::remove(file_path(segment.key_));
+            }
+        }
+    }
+}
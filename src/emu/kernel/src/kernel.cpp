@@ -27,6 +27,7 @@
 #include <cpu/arm_interface.h>
 #include <cpu/arm_utils.h>
 
+#include <common/algorithm.h>
 #include <common/armemitter.h>
 #include <common/buffer.h>
 #include <common/chunkyseri.h>
@@ -43,8 +44,10 @@
 #include <kernel/libmanager.h>
 #include <kernel/guomen_process.h>
 #include <kernel/scheduler.h>
+#include <kernel/smp/core.h>
 #include <kernel/thread.h>
 #include <loader/romimage.h>
+#include <mem/control.h>
 #include <mem/mem.h>
 #include <mem/ptr.h>
 #include <vfs/vfs.h>
@@ -55,9 +58,13 @@
 #include <re2/re2.h>
 
 #include <common/time.h>
+#include <common/version.h>
 #include <config/config.h>
 
 namespace eka2l1 {
+    // Text pages decompressed ahead of the guest after each code page fault
+    static constexpr std::uint32_t CODE_PAGER_READ_AHEAD_PAGES = 8;
+
     void kernel_global_data::reset() {
         // Reset all these to 0
         char_set_.char_data_set_ = 0;
@@ -76,11 +83,14 @@ namespace eka2l1 {
         , app_settings_(settings)
         , disassembler_(disassembler)
         , cpu_(cpu)
+        , mem_(nullptr)
         , rom_info_(rom_info)
         , kernel_handles_(this, kernel::handle_array_owner::kernel)
         , realtime_ipc_signal_evt_(0)
         , uid_counter_(0)
         , rom_map_(nullptr)
+        , rom_copy_size_(0)
+        , rom_size_(0)
         , kern_ver_(epocver::epoc94)
         , lang_(language::en)
         , global_data_chunk_(nullptr)
@@ -103,17 +113,25 @@ namespace eka2l1 {
         wiping_ = true;
         timing_->remove_event(realtime_ipc_signal_evt_);
 
-        if (rom_map_) {
-            common::unmap_file(rom_map_);
+        unmap_rom();
+
+        // Record translated blocks while the code is still mapped
+        if (jit_cache_) {
+            jit_cache_->collect_all(get_cpus());
         }
 
-        rom_map_ = nullptr;
+#define OBJECT_CONTAINER_UNREGISTER(container) \
+    for (auto &obj : container) {              \
+        if (obj)                               \
+            registry_.remove(obj->unique_id()); \
+    }
 
 #define OBJECT_CONTAINER_CLEANUP(container) \
     for (auto &obj : container) {           \
         if (obj)                            \
             obj->destroy();                 \
     }                                       \
+    OBJECT_CONTAINER_UNREGISTER(container)  \
     container.clear();
 
 #define OBJECT_CONTAINER_CLEANUP_KEEP_OBJECTS(container) \
@@ -123,8 +141,15 @@ namespace eka2l1 {
     }
 
 #define OBJECT_CONTAINER_CLEAR(container) \
+    OBJECT_CONTAINER_UNREGISTER(container) \
     container.clear();
 
+        // Requests served on host threads still complete through their sessions
+        for (auto &obj : servers_) {
+            if (obj)
+                reinterpret_cast<service::server *>(obj.get())->finish_pending_requests();
+        }
+
         // Delete one by one in order. Do not change the order
         OBJECT_CONTAINER_CLEANUP(sessions_);
         OBJECT_CONTAINER_CLEANUP(servers_);
@@ -135,6 +160,8 @@ namespace eka2l1 {
         OBJECT_CONTAINER_CLEANUP(change_notifiers_);
         OBJECT_CONTAINER_CLEANUP(undertakers_);
         OBJECT_CONTAINER_CLEANUP(prop_refs_);
+
+        prop_store_.clear();
         OBJECT_CONTAINER_CLEANUP(props_);
         OBJECT_CONTAINER_CLEANUP(chunks_);
 
@@ -153,10 +180,20 @@ namespace eka2l1 {
         OBJECT_CONTAINER_CLEAR(threads_);
         OBJECT_CONTAINER_CLEAR(processes_);
 
+        if (code_pager_) {
+            code_pager_->clear();
+        }
+
+        registry_.clear();
+
         if (btrace_inst_)
             btrace_inst_->close_trace_session();
 
-        cpu_->clear_instruction_cache();
+        // Destroyed chunks already dropped the code they held. Only pages still tracked are left.
+        if (mem_) {
+            mem_->get_control()->invalidate_all_code();
+        }
+
         wiping_ = false;
     }
 
@@ -165,11 +202,42 @@ namespace eka2l1 {
 
         thr_sch_ = std::make_unique<kernel::thread_scheduler>(this, timing_, cpu_);
 
+        for (arm::core *cc : secondary_cpus_) {
+            thr_sch_->add_core(cc);
+        }
+
+        // Cached JIT blocks are translated on the core's worker, other cores would stall the process start instead
+        const bool jit_cache_usable = cpu_->can_import_decoded_blocks() || cpu_->can_translate_in_background();
+
+        if (conf_ && conf_->persistent_jit_cache && !jit_cache_usable) {
+            LOG_WARN(KERNEL, "The persistent JIT cache is ignored, the CPU backend can not export or import its translated code");
+        }
+
+        if (conf_ && conf_->persistent_jit_cache && jit_cache_usable) {
+            jit_cache_ = std::make_unique<kernel::jit_cache>(eka2l1::add_path(conf_->storage, "cache/jit/"),
+                fmt::format("{}-{}", GIT_BRANCH, GIT_COMMIT_HASH));
+        } else {
+            jit_cache_.reset();
+        }
+
+        // The JIT cache keys segments with their whole code, which paged code does not keep around
+        if (conf_ && conf_->demand_paged_code && jit_cache_) {
+            LOG_WARN(KERNEL, "Demand paged code is disabled, it can not be used together with the persistent JIT cache");
+        }
+
+        if (conf_ && conf_->demand_paged_code && !jit_cache_) {
+            code_pager_ = std::make_unique<kernel::code_pager>(CODE_PAGER_READ_AHEAD_PAGES);
+        } else {
+            code_pager_.reset();
+        }
+
         // Instantiate btrace
         btrace_inst_ = std::make_unique<kernel::btrace>(this, io_);
 
         // Create real time IPC event
         realtime_ipc_signal_evt_ = timing_->register_event("RealTimeIpc", [this](std::uint64_t userdata, std::uint64_t cycles_late) {
+            const object_read_guard guard = guard_object_reads();
+
             kernel::thread *thr = get_by_id<kernel::thread>(static_cast<kernel::uid>(userdata));
             assert(thr);
 
@@ -192,13 +260,10 @@ namespace eka2l1 {
         static_data_chunk_cursor_ = 0;
 
         dll_global_data_offset_.clear();
-
-        // Clear CPU caches. No reason to keep it.
-        cpu_->clear_instruction_cache();
     }
 
     void kernel_system::cpu_exception_thread_handle(arm::core *core) {
-        std::uint8_t *pc_data = reinterpret_cast<std::uint8_t *>(crr_process()->get_ptr_on_addr_space(core->get_pc()));
+        std::uint8_t *pc_data = reinterpret_cast<std::uint8_t *>(crr_process()->get_ptr_on_addr_space(core->get_pc(), sizeof(std::uint32_t)));
 
         if (pc_data) {
             const std::string disassemble_inst = disassembler_->disassemble(pc_data,
@@ -208,7 +273,7 @@ namespace eka2l1 {
             LOG_TRACE(KERNEL, "Last instruction: {} (0x{:x})", disassemble_inst, (core->get_cpsr() & 0x20) ? *reinterpret_cast<std::uint16_t *>(pc_data) : *reinterpret_cast<std::uint32_t *>(pc_data));
         }
 
-        pc_data = reinterpret_cast<std::uint8_t *>(crr_process()->get_ptr_on_addr_space(core->get_lr()));
+        pc_data = reinterpret_cast<std::uint8_t *>(crr_process()->get_ptr_on_addr_space(core->get_lr(), sizeof(std::uint32_t)));
 
         if (pc_data) {
             const std::string disassemble_inst = disassembler_->disassemble(pc_data,
@@ -230,7 +295,7 @@ namespace eka2l1 {
 
     bool kernel_system::cpu_exception_handle_unpredictable(arm::core *core, const address occurred) {
         auto read_crr_func = [&](const address addr) -> std::uint32_t {
-            const std::uint32_t *val = reinterpret_cast<std::uint32_t *>(crr_process()->get_ptr_on_addr_space(addr));
+            const std::uint32_t *val = reinterpret_cast<std::uint32_t *>(crr_process()->get_ptr_on_addr_space(addr, sizeof(std::uint32_t)));
             return val ? *val : 0;
         };
 
@@ -342,6 +407,10 @@ namespace eka2l1 {
     }
 
     bool kernel_system::cpu_handle_access_violation(arm::core *core, const address occurred, const bool read) {
+        if (code_pager_ && code_pager_->handle_fault(crr_process(), occurred)) {
+            return true;
+        }
+
         if (is_eka1()) {
             if ((occurred >= mem::kern_mapping_eka1) && (occurred <= mem::kern_mapping_eka1_end)) {
                 setup_stub_io_mapping(occurred);
@@ -481,28 +550,36 @@ namespace eka2l1 {
         kern_ver_ = ver;
         lib_mngr_ = std::make_unique<hle::lib_manager>(this, io_, mem_);
 
+        install_cpu_handlers(cpu_);
+
+        for (arm::core *cc : secondary_cpus_) {
+            install_cpu_handlers(cc);
+        }
+    }
+
+    void kernel_system::install_cpu_handlers(arm::core *cc) {
         // Set CPU SVC handler
-        cpu_->system_call_handler = [this](const std::uint32_t ordinal) {
+        cc->system_call_handler = [this, cc](const std::uint32_t ordinal) {
             // crr_thread()->add_last_syscall(ordinal);
             get_lib_manager()->call_svc(ordinal);
 
             // EKA1 does not use BX LR to jump back, they let kernel do it
             if (is_eka1()) {
-                const std::uint32_t jump_back = cpu_->get_lr();
-                std::uint32_t cpsr = cpu_->get_cpsr() & ~0x20;
+                const std::uint32_t jump_back = cc->get_lr();
+                std::uint32_t cpsr = cc->get_cpsr() & ~0x20;
 
                 if (jump_back & 0b1) {
                     cpsr |= 0x20;
                 }
 
                 // Set pc and ARM/thumb flag
-                cpu_->set_pc(jump_back & ~0b1);
-                cpu_->set_cpsr(cpsr);
+                cc->set_pc(jump_back & ~0b1);
+                cc->set_cpsr(cpsr);
             }
         };
 
-        cpu_->exception_handler = [this](arm::exception_type exception_type, const std::uint32_t data) -> bool {
-            return cpu_exception_handler(cpu_, exception_type, data);
+        cc->exception_handler = [this, cc](arm::exception_type exception_type, const std::uint32_t data) -> bool {
+            return cpu_exception_handler(cc, exception_type, data);
         };
     }
 
@@ -590,11 +667,44 @@ namespace eka2l1 {
     }
 
     arm::core *kernel_system::get_cpu() {
-        return cpu_;
+        return get_cpu(kernel::smp::current_core());
+    }
+
+    arm::core *kernel_system::get_cpu(const std::uint32_t index) {
+        if ((index == 0) || (index > secondary_cpus_.size())) {
+            return cpu_;
+        }
+
+        return secondary_cpus_[index - 1];
+    }
+
+    std::vector<arm::core *> kernel_system::get_cpus() {
+        std::vector<arm::core *> cores = { cpu_ };
+        cores.insert(cores.end(), secondary_cpus_.begin(), secondary_cpus_.end());
+
+        return cores;
+    }
+
+    std::uint32_t kernel_system::add_cpu(arm::core *cc) {
+        secondary_cpus_.push_back(cc);
+
+        if (lib_mngr_) {
+            install_cpu_handlers(cc);
+        }
+
+        return thr_sch_->add_core(cc);
     }
 
     void kernel_system::reschedule() {
         lock();
+
+        // Subscribers woken up by the changes are considered in this schedule
+        if (prop_store_.has_pending_changes()) {
+            prop_store_.flush([](property_ptr prop) {
+                prop->publish_change();
+            });
+        }
+
         thr_sch_->reschedule();
         unlock();
     }
@@ -778,6 +888,10 @@ namespace eka2l1 {
             return true;
         }
 
+        if (obj->get_object_type() == kernel::object_type::prop) {
+            prop_store_.remove(reinterpret_cast<property_ptr>(obj));
+        }
+
         switch (obj->get_object_type()) {
 #define OBJECT_SEARCH(obj_type, obj_map)                                                                         \
     case kernel::object_type::obj_type: {                                                                        \
@@ -787,6 +901,8 @@ namespace eka2l1 {
         if (res == obj_map.end())                                                                                \
             return false;                                                                                        \
         (*res)->destroy();                                                                                       \
+        const kernel::uid retired_uid = (*res)->unique_id();                                                     \
+        registry_.retire(retired_uid, std::move(*res));                                                          \
         obj_map.erase(res);                                                                                      \
         return true;                                                                                             \
     }
@@ -1016,42 +1132,27 @@ namespace eka2l1 {
     }
 
     property_ptr kernel_system::get_prop(int category, int key) {
-        auto prop_res = std::find_if(props_.begin(), props_.end(),
-            [=](const auto &prop_obj) {
-                property_ptr prop = reinterpret_cast<property_ptr>(prop_obj.get());
-                if (prop->first == category && prop->second == key) {
-                    return true;
-                }
+        return prop_store_.find(category, key);
+    }
 
-                return false;
-            });
+    bool kernel_system::delete_prop(int category, int key) {
+        property_ptr prop = prop_store_.find(category, key);
 
-        if (prop_res == props_.end()) {
-            return property_ptr(nullptr);
+        if (!prop || !prop->is_defined()) {
+            return false;
         }
 
-        return reinterpret_cast<property_ptr>(prop_res->get());
+        // Freed now if no reference is attached, else when the last one is closed
+        prop->undefine();
+        return true;
     }
 
-    property_ptr kernel_system::delete_prop(int category, int key) {
-        auto prop_res = std::find_if(props_.begin(), props_.end(),
-            [=](const auto &prop_obj) {
-                property_ptr prop = reinterpret_cast<property_ptr>(prop_obj.get());
-                if (prop->first == category && prop->second == key) {
-                    return true;
-                }
-
-                return false;
-            });
-
-        if (prop_res == props_.end()) {
-            return property_ptr(nullptr);
+    void kernel_system::queue_property_change(property_ptr prop) {
+        if (prop_store_.queue_change(prop)) {
+            // Get to the reschedule that publishes it soon, even from a host thread or an idle core
+            prepare_reschedule();
+            stop_cores_idling();
         }
-
-        property_ptr prop_ptr = reinterpret_cast<property_ptr>(prop_res->get());
-        props_.erase(prop_res);
-
-        return prop_ptr;
     }
 
     kernel::handle kernel_system::mirror(kernel::thread *own_thread, kernel::handle handle, kernel::owner_type owner) {
@@ -1284,13 +1385,38 @@ namespace eka2l1 {
     }
 
     bool kernel_system::map_rom(const mem::vm_address addr, const std::string &path) {
-        rom_map_ = common::map_file(path, prot_read_write, 0, true);
         const std::size_t rom_size = common::file_size(path);
+        mem::control_base *control = mem_->get_control();
+
+        if (control->fastmem_enabled()) {
+            // A private file mapping can't be mirrored into fastmem regions. Copy the ROM to memory that can.
+            const std::size_t copy_size = common::align(rom_size, control->page_size());
+            rom_map_ = control->reserve_host_memory(copy_size);
+
+            if (rom_map_ && common::commit(rom_map_, copy_size, prot_read_write)) {
+                common::ro_std_file_stream rom_stream(path, true);
+
+                if (rom_stream.valid() && (rom_stream.read(rom_map_, rom_size) == rom_size)) {
+                    rom_copy_size_ = copy_size;
+                } else {
+                    common::unmap_memory(rom_map_, copy_size);
+                    rom_map_ = nullptr;
+                }
+            } else if (rom_map_) {
+                common::unmap_memory(rom_map_, copy_size);
+                rom_map_ = nullptr;
+            }
+        }
+
+        if (!rom_map_) {
+            rom_map_ = common::map_file(path, prot_read_write, 0, true);
+        }
 
         if (!rom_map_) {
             return false;
         }
 
+        rom_size_ = rom_size;
         LOG_TRACE(KERNEL, "Rom mapped to address: 0x{:x}", reinterpret_cast<std::uint64_t>(rom_map_));
 
         // Don't care about the result as long as it's not null.
@@ -1301,13 +1427,27 @@ namespace eka2l1 {
         if (!rom_chunk) {
             LOG_ERROR(KERNEL, "Can't create ROM chunk!");
 
-            common::unmap_file(rom_map_);
+            unmap_rom();
             return false;
         }
 
         return true;
     }
 
+    void kernel_system::unmap_rom() {
+        if (rom_map_) {
+            if (rom_copy_size_) {
+                common::unmap_memory(rom_map_, rom_copy_size_);
+            } else {
+                common::unmap_file(rom_map_);
+            }
+        }
+
+        rom_map_ = nullptr;
+        rom_copy_size_ = 0;
+        rom_size_ = 0;
+    }
+
     void kernel_system::stop_cores_idling() {
         if (should_core_idle_when_inactive()) {
             thr_sch_->stop_idling();
@@ -19,6 +19,7 @@
 
 #include <common/algorithm.h>
 #include <common/armemitter.h>
+#include <common/buffer.h>
 #include <common/cvt.h>
 #include <common/fileutils.h>
 #include <common/ini.h>
@@ -26,6 +27,8 @@
 #include <common/path.h>
 #include <common/random.h>
 
+#include <fmt/format.h>
+
 #include <kernel/common.h>
 #include <kernel/libmanager.h>
 #include <kernel/reg.h>
@@ -43,7 +46,9 @@
 #include <kernel/codeseg.h>
 #include <kernel/kernel.h>
 
+#include <algorithm>
 #include <cctype>
+#include <chrono>
 
 namespace eka2l1::hle {
     static std::array<std::u16string, 2> LDD_SKIP_LOAD_LIST = {
@@ -245,6 +250,9 @@ namespace eka2l1::hle {
 
         if (force_code_addr != 0) {
             info.code_load_addr = force_code_addr;
+        } else {
+            info.code_pages = img->code_pages;
+            info.paged_code_size = img->paged_code_size;
         }
 
         codeseg_ptr cs = kern->create<kernel::codeseg>(get_e32_codeseg_name_from_path(path), info);
@@ -854,7 +862,8 @@ namespace eka2l1::hle {
 
                 eka2l1::ro_file_stream image_data_stream(f.get());
 
-                auto parse_result = loader::parse_e32img(reinterpret_cast<common::ro_stream *>(&image_data_stream));
+                auto parse_result = loader::parse_e32img(reinterpret_cast<common::ro_stream *>(&image_data_stream), true,
+                    kern_->get_code_pager() != nullptr);
                 if (parse_result != std::nullopt) {
                     f->close();
                     result.first = std::move(parse_result);
@@ -958,7 +967,8 @@ namespace eka2l1::hle {
 
                 return load_as_romimg(*romimg, lib_path, is_driver_lib);
             } else {
-                auto e32img = loader::parse_e32img(reinterpret_cast<common::ro_stream *>(&image_data_stream));
+                auto e32img = loader::parse_e32img(reinterpret_cast<common::ro_stream *>(&image_data_stream), true,
+                    kern_->get_code_pager() != nullptr);
                 if (!e32img) {
                     return nullptr;
                 }
@@ -1049,6 +1059,27 @@ namespace eka2l1::hle {
         }
     }
 
+    void lib_manager::dump_svc_profile() {
+        static constexpr const char *SVC_PROFILE_FILE_NAME = "svcprofile.json";
+
+        const std::string result = svc_table_.profile_json(kern_->capped_cpu_hz());
+
+        if (result.empty()) {
+            return;
+        }
+
+        const std::string path = eka2l1::add_path(kern_->get_config()->storage, SVC_PROFILE_FILE_NAME);
+        common::wo_std_file_stream stream(path, false);
+
+        if (!stream.valid()) {
+            LOG_WARN(KERNEL, "Unable to write SVC profile to {}", path);
+            return;
+        }
+
+        stream.write(result.data(), result.size());
+        LOG_INFO(KERNEL, "SVC profile written to {}", path);
+    }
+
     bool lib_manager::call_svc(sid svcnum) {
         // Lock the kernel so SVC call can operate in safety
         kern_->lock();
@@ -1061,22 +1092,37 @@ namespace eka2l1::hle {
             return true;
         }
 
-        auto res = svc_funcs_.find(svcnum);
+        svc_table::slot *slot = svc_table_.find(svcnum);
 
-        if (res == svc_funcs_.end()) {
+        if (!slot) {
             LOG_ERROR(KERNEL, "Unimplement system call: 0x{:X}!", svcnum);
 
             kern_->unlock();
             return false;
         }
 
-        epoc_import_func func = res->second;
+        const epoc_import_func &func = *slot->func_;
 
         if (kern_->get_config()->log_svc) {
             LOG_TRACE(KERNEL, "Calling SVC 0x{:x} {}", svcnum, func.name);
         }
 
-        func.func(kern_, kern_->crr_process(), kern_->get_cpu());
+        std::chrono::steady_clock::time_point start;
+
+        if (profile_svc_) {
+            start = std::chrono::steady_clock::now();
+        }
+
+        if (func.direct) {
+            func.direct(kern_, kern_->crr_process(), kern_->get_cpu());
+        } else {
+            func.func(kern_, kern_->crr_process(), kern_->get_cpu());
+        }
+
+        if (profile_svc_) {
+            slot->call_count_++;
+            slot->host_time_ns_ += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        }
 
         kern_->unlock();
         return true;
@@ -1221,7 +1267,8 @@ namespace eka2l1::hle {
         , rom_drv_(drive_invalid)
         , additional_mode_(0)
         , entry_points_call_routine_(nullptr)
-        , thread_entry_routine_(nullptr) {
+        , thread_entry_routine_(nullptr)
+        , profile_svc_(false) {
         hle::symbols sb;
         std::string lib_name;
 
@@ -1277,6 +1324,12 @@ namespace eka2l1::hle {
             break;
         }
 
+        svc_table_.build(svc_funcs_);
+
+        if (kern_->get_config()) {
+            profile_svc_ = kern_->get_config()->profile_svc;
+        }
+
         if (kern_->is_eka1()) {
             search_paths.push_back(u"\\System\\Libs\\");
             search_paths.push_back(u"\\System\\Programs\\");
@@ -1290,6 +1343,10 @@ namespace eka2l1::hle {
     }
 
     lib_manager::~lib_manager() {
+        if (profile_svc_) {
+            dump_svc_profile();
+        }
+
         svc_funcs_.clear();
     }
 
@@ -82,26 +82,53 @@ namespace eka2l1::kernel {
         return handle;
     }
 
-    std::uint32_t object_ix::add_object(kernel_obj_ptr obj) {
-        auto slot = std::find_if(objects.begin(), objects.end(), [](const object_ix_record &record) {
-            return record.free;
-        });
+    bool object_ix::grow() {
+        if (chunks.size() * HANDLE_CHUNK_SIZE >= MAX_HANDLE_COUNT) {
+            return false;
+        }
+
+        const std::uint32_t first_index = static_cast<std::uint32_t>(chunks.size() * HANDLE_CHUNK_SIZE);
+        chunks.push_back(std::make_unique<record_chunk>());
+
+        // Hand out the lowest index of the new chunk first
+        for (std::uint32_t i = HANDLE_CHUNK_SIZE; i > 0; i--) {
+            free_slots.push_back(static_cast<std::uint16_t>(first_index + i - 1));
+        }
 
-        if (slot != objects.end()) {
-            next_instance = (next_instance + 1) & HANDLE_NEXT_INSTANCE_MASK;
-            std::uint32_t ret_handle = make_handle(slot - objects.begin());
+        return true;
+    }
 
-            slot->associated_handle = ret_handle;
-            slot->free = false;
-            slot->object = obj;
+    void object_ix::rebuild_free_slots() {
+        free_slots.clear();
 
-            obj->increase_access_count();
+        for (std::uint32_t i = static_cast<std::uint32_t>(capacity()); i > 0; i--) {
+            if (get_record(i - 1)->free) {
+                free_slots.push_back(static_cast<std::uint16_t>(i - 1));
+            }
+        }
+    }
 
-            totals++;
-            return ret_handle;
+    std::uint32_t object_ix::add_object(kernel_obj_ptr obj) {
+        if (free_slots.empty() && !grow()) {
+            return INVALID_HANDLE;
         }
 
-        return INVALID_HANDLE;
+        const std::uint16_t index = free_slots.back();
+        free_slots.pop_back();
+
+        object_ix_record *slot = get_record(index);
+
+        next_instance = (next_instance + 1) & HANDLE_NEXT_INSTANCE_MASK;
+        std::uint32_t ret_handle = make_handle(index);
+
+        slot->associated_handle = ret_handle;
+        slot->free = false;
+        slot->object = obj;
+
+        obj->increase_access_count();
+
+        totals++;
+        return ret_handle;
     }
 
     std::uint32_t object_ix::last_handle() {
@@ -133,13 +160,14 @@ namespace eka2l1::kernel {
 
     kernel_obj_ptr object_ix::get_object(std::uint32_t handle) {
         handle_inspect_info info = inspect_handle(handle);
+        object_ix_record *record = get_record(info.object_ix_index);
 
-        if (info.object_ix_index < objects.size()) {
-            if (objects[info.object_ix_index].free) {
+        if (record) {
+            if (record->free) {
                 return nullptr;
             }
 
-            return objects[info.object_ix_index].object;
+            return record->object;
         }
 
         LOG_WARN(KERNEL, "Can't find object with handle: 0x{:x}", handle);
@@ -151,8 +179,10 @@ namespace eka2l1::kernel {
         handle_inspect_info info = inspect_handle(handle);
         int ret_value = 0;
 
-        if (info.object_ix_index < objects.size()) {
-            kernel_obj_ptr obj = objects[info.object_ix_index].object;
+        object_ix_record *record = get_record(info.object_ix_index);
+
+        if (record) {
+            kernel_obj_ptr obj = record->object;
 
             if (!obj) {
                 return -1;
@@ -161,8 +191,10 @@ namespace eka2l1::kernel {
             ret_value = obj->decrease_access_count();
             totals--;
 
-            objects[info.object_ix_index].free = true;
-            objects[info.object_ix_index].object = nullptr;
+            record->free = true;
+            record->object = nullptr;
+
+            free_slots.push_back(static_cast<std::uint16_t>(info.object_ix_index));
 
             // Find the handle in unclosed handle list
             auto iterator = std::find(handles.begin(), handles.end(), handle);
@@ -177,18 +209,29 @@ namespace eka2l1::kernel {
     }
 
     void object_ix::reset() {
-        for (auto &index : objects) {
-            if (index.free == false) {
-                index.object->decrease_access_count();
-                index.free = true;
+        for (auto &chunk : chunks) {
+            for (auto &index : *chunk) {
+                if (index.free == false) {
+                    index.object->decrease_access_count();
+                    index.free = true;
+                }
             }
         }
+
+        // Owner is dying, give the memory back
+        chunks.clear();
+        free_slots.clear();
+        handles.clear();
+
+        totals = 0;
     }
 
     bool object_ix::has(kernel_obj_ptr obj) {
-        for (const auto &index : objects) {
-            if ((index.object == obj) && (index.free == false)) {
-                return true;
+        for (const auto &chunk : chunks) {
+            for (const auto &index : *chunk) {
+                if ((index.object == obj) && (index.free == false)) {
+                    return true;
+                }
             }
         }
 
@@ -198,9 +241,11 @@ namespace eka2l1::kernel {
     std::uint32_t object_ix::count(kernel_obj_ptr obj) {
         std::uint32_t so_far = 0;
 
-        for (const auto &index : objects) {
-            if ((index.free == false) && (index.object == obj)) {
-                so_far++;
+        for (const auto &chunk : chunks) {
+            for (const auto &index : *chunk) {
+                if ((index.free == false) && (index.object == obj)) {
+                    so_far++;
+                }
             }
         }
 
@@ -229,8 +274,8 @@ namespace eka2l1::kernel {
         std::uint32_t slot_count = 0;
 
         if (seri.get_seri_mode() == common::SERI_MODE_WRITE) {
-            for (std::size_t i = 0; i < objects.size(); i++) {
-                if (!objects[i].free) {
+            for (std::uint32_t i = 0; i < capacity(); i++) {
+                if (!get_record(i)->free) {
                     slot_count++;
                     slot_used.push(static_cast<std::uint16_t>(i));
                 }
@@ -248,20 +293,37 @@ namespace eka2l1::kernel {
                 next_slot_use = slot_used.top();
                 slot_used.pop();
 
-                obj_id = objects[next_slot_use].object->unique_id();
+                obj_id = get_record(next_slot_use)->object->unique_id();
             }
 
             seri.absorb(next_slot_use);
             seri.absorb(obj_id);
-            seri.absorb(objects[next_slot_use].associated_handle);
+
+            if (seri.get_seri_mode() == common::SERI_MODE_READ) {
+                while ((next_slot_use < MAX_HANDLE_COUNT) && (next_slot_use >= capacity())) {
+                    grow();
+                }
+            }
+
+            object_ix_record *record = get_record(next_slot_use);
+            if (!record) {
+                LOG_ERROR(KERNEL, "Handle slot {} in saved state is out of range", next_slot_use);
+                return;
+            }
+
+            seri.absorb(record->associated_handle);
 
             if (seri.get_seri_mode() == common::SERI_MODE_READ) {
                 // TODO
-                //objects[next_slot_use].object = kern->get_kernel_obj_raw(obj_id);
-                objects[next_slot_use].free = false;
+                //record->object = kern->get_kernel_obj_raw(obj_id);
+                record->free = false;
             }
         }
 
+        if (seri.get_seri_mode() == common::SERI_MODE_READ) {
+            rebuild_free_slots();
+        }
+
         // Hey, we need to save last thread handle too
         seri.absorb_container(handles);
     }
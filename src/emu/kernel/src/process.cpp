@@ -27,6 +27,7 @@
 #include <kernel/kernel.h>
 #include <mem/mem.h>
 
+#include <kernel/codepager.h>
 #include <kernel/codeseg.h>
 #include <kernel/libmanager.h>
 #include <kernel/process.h>
@@ -444,12 +445,41 @@ namespace eka2l1::kernel {
         decrease_access_count();
     }
 
-    void *process::get_ptr_on_addr_space(address addr) {
+    void *process::get_ptr_on_addr_space(address addr, const std::size_t size) {
         if (!mm_impl_) {
             return nullptr;
         }
 
-        return mem->get_control()->get_host_pointer(mm_impl_->address_space_id(), addr);
+        mem::control_base *control = mem->get_control();
+        const mem::asid id = mm_impl_->address_space_id();
+
+        void *result = control->get_host_pointer(id, addr);
+
+        kernel::code_pager *pager = kern->get_code_pager();
+        if (!pager) {
+            return result;
+        }
+
+        // Paged code pages have no host pointer until they are filled, so only those take the pager
+        const std::uint64_t page_mask = ~static_cast<std::uint64_t>(mem->get_page_size() - 1);
+        const std::uint64_t end = static_cast<std::uint64_t>(addr) + std::max<std::size_t>(size, 1);
+
+        for (std::uint64_t page_addr = addr & page_mask; page_addr < end; page_addr += mem->get_page_size()) {
+            const address check_addr = static_cast<address>(std::max<std::uint64_t>(page_addr, addr));
+            const bool mapped = (check_addr == addr) ? (result != nullptr) : (control->get_host_pointer(id, check_addr) != nullptr);
+
+            if (!mapped && !pager->handle_fault(this, check_addr)) {
+                break;
+            }
+        }
+
+        return result ? result : control->get_host_pointer(id, addr);
+    }
+
+    void process::fill_paged_host_range(const void *host, const std::size_t size) {
+        if (kernel::code_pager *pager = kern->get_code_pager()) {
+            pager->fill_host_range(this, reinterpret_cast<const std::uint8_t *>(host), size);
+        }
     }
 
     // EKA2L1 doesn't use multicore yet, so rendezvous and logon
@@ -682,7 +712,11 @@ namespace eka2l1::kernel {
 }
 
 namespace eka2l1 {
-    void *get_raw_pointer(kernel::process *pr, address addr) {
-        return pr->get_ptr_on_addr_space(addr);
+    void *get_raw_pointer(kernel::process *pr, address addr, const std::size_t size) {
+        return pr->get_ptr_on_addr_space(addr, size);
+    }
+
+    void fill_raw_host_range(kernel::process *pr, const void *host, const std::size_t size) {
+        pr->fill_paged_host_range(host, size);
     }
 }
@@ -25,14 +25,19 @@
 
 #include <common/log.h>
 
+#include <cstring>
+
 namespace eka2l1 {
     namespace service {
         property::property(kernel_system *kern)
             : kernel::kernel_obj(kern, "", nullptr, kernel::access_type::global_access)
+            , ndata(0)
             , data_len(0)
-            , data_type(service::property_type::unk) {
+            , data_type(service::property_type::unk)
+            , held_by_kernel(true)
+            , defined_by_guest(false) {
             obj_type = kernel::object_type::prop;
-            bindata.reserve(512);
+            inline_data.fill(0);
 
             increase_access_count();
         }
@@ -41,6 +46,38 @@ namespace eka2l1 {
             return data_type != service::property_type::unk;
         }
 
+        void property::undefine() {
+            data_type = service::property_type::unk;
+            data_len = 0;
+
+            large_data.clear();
+            notify_request(epoc::error_not_found);
+
+            if (held_by_kernel) {
+                held_by_kernel = false;
+
+                // May free this property, so must come last
+                decrease_access_count();
+            }
+        }
+
+        void property::resize_data(const uint32_t new_len) {
+            if (new_len <= INLINE_DATA_SIZE) {
+                if (data_len > INLINE_DATA_SIZE) {
+                    std::memcpy(inline_data.data(), large_data.data(), new_len);
+                }
+            } else {
+                if (data_len <= INLINE_DATA_SIZE) {
+                    large_data.resize(new_len);
+                    std::memcpy(large_data.data(), inline_data.data(), data_len);
+                } else {
+                    large_data.resize(new_len);
+                }
+            }
+
+            data_len = new_len;
+        }
+
         void property::add_data_change_callback(void *userdata, data_change_callback_handler handler) {
             data_change_callbacks.push_back({ userdata, handler });
         }
@@ -51,24 +88,31 @@ namespace eka2l1 {
             }
         }
 
-        void property::define(service::property_type pt, uint32_t pre_allocated) {
+        void property::define(service::property_type pt, uint32_t pre_allocated, const bool by_guest) {
+            if (!held_by_kernel) {
+                // Deleted, but kept alive by references until now
+                held_by_kernel = true;
+                increase_access_count();
+            }
+
             data_type = pt;
-            data_len = pre_allocated;
+            defined_by_guest = by_guest;
 
             if (pre_allocated > 512) {
                 LOG_WARN(KERNEL, "Property trying to alloc more then 512 bytes, limited to 512 bytes");
-                data_len = 512;
+                pre_allocated = 512;
             }
 
-            bindata.resize(data_len);
+            resize_data(pre_allocated);
         }
 
         bool property::set_int(int val) {
             if (data_type == service::property_type::int_data) {
                 ndata = val;
-                notify_request(epoc::error_none);
 
+                // Host callbacks see every change. Guest subscribers are completed once on the next reschedule.
                 fire_data_change_callbacks();
+                kern->queue_property_change(this);
 
                 return true;
             }
@@ -77,15 +121,14 @@ namespace eka2l1 {
         }
 
         bool property::set(uint8_t *bdata, uint32_t arr_length) {
-            if (arr_length > data_len) {
-                bindata.resize(arr_length);
+            if (arr_length != data_len) {
+                resize_data(arr_length);
             }
 
-            memcpy(bindata.data(), bdata, arr_length);
-            data_len = arr_length;
+            std::memcpy(data_ptr(), bdata, arr_length);
 
-            notify_request(epoc::error_none);
             fire_data_change_callbacks();
+            kern->queue_property_change(this);
 
             return true;
         }
@@ -99,12 +142,8 @@ namespace eka2l1 {
         }
 
         std::vector<uint8_t> property::get_bin() {
-            std::vector<uint8_t> local;
-            local.resize(data_len);
-
-            memcpy(local.data(), bindata.data(), data_len);
-
-            return local;
+            const uint8_t *data = get_bin_ptr();
+            return std::vector<uint8_t>(data, data + data_len);
         }
 
         void property::subscribe(epoc::notify_info &info) {
@@ -132,6 +171,10 @@ namespace eka2l1 {
             }
         }
 
+        void property::publish_change() {
+            notify_request(epoc::error_none);
+        }
+
         property_reference::property_reference(kernel_system *kern, property *prop)
             : kernel::kernel_obj(kern, "", prop)
             , prop_(prop) {
@@ -142,6 +185,16 @@ namespace eka2l1 {
             cancel();
         }
 
+        int property_reference::destroy() {
+            cancel();
+
+            // Dropping the property's access count may free it, if it was deleted
+            const int result = kernel::kernel_obj::destroy();
+            prop_ = nullptr;
+
+            return result;
+        }
+
         bool property_reference::subscribe(const epoc::notify_info &info) {
             if (!nof_.empty()) {
                 return false;
@@ -154,7 +207,7 @@ namespace eka2l1 {
         }
 
         bool property_reference::cancel() {
-            return prop_->cancel(nof_);
+            return prop_ && prop_->cancel(nof_);
         }
     }
 }
@@ -26,25 +26,53 @@
 
 #include <functional>
 #include <kernel/kernel.h>
+#include <kernel/process.h>
 #include <kernel/scheduler.h>
+#include <kernel/smp/balancer.h>
+#include <kernel/smp/core.h>
 #include <kernel/thread.h>
 #include <kernel/timing.h>
 #include <mem/mem.h>
 #include <mem/mmu.h>
 #include <mem/process.h>
 
+namespace eka2l1::kernel {
+    // Secondary cores wake up this often when idle, to notice that the emulator is paused or exiting
+    static constexpr std::uint64_t SECONDARY_CORE_IDLE_WAIT_US = 2000;
+
+    // Microseconds in a nanokernel tick
+    static constexpr std::uint64_t NANOKERNEL_TICK_US = 1000;
+}
+
+namespace eka2l1::kernel::smp {
+    sub_scheduler::sub_scheduler(const std::uint32_t index, arm::core *run_core)
+        : index_(index)
+        , run_core_(run_core)
+        , core_mmu_(nullptr)
+        , crr_thread_(nullptr)
+        , crr_process_(nullptr)
+        , group_count_(0) {
+        // !!!
+        std::fill(readys_, readys_ + sizeof(readys_) / sizeof(readys_[0]), nullptr);
+
+        ready_mask_[0] = 0;
+        ready_mask_[1] = 0;
+
+        idle_event_.reset();
+    }
+}
+
 namespace eka2l1::kernel {
     thread_scheduler::thread_scheduler(kernel_system *kern, ntimer *timing, arm::core *cpu)
         : kern(kern)
         , timing(timing)
-        , run_core(cpu)
-        , core_mmu(nullptr)
-        , crr_thread(nullptr)
-        , crr_process(nullptr) {
+        , last_balance_time(0) {
         wakeup_evt = timing->get_register_event("SchedulerWakeUpThread");
 
         if (wakeup_evt == -1) {
             wakeup_evt = timing->register_event("SchedulerWakeUpThread", [kern](std::uint64_t userdata, std::uint64_t cycles_late) {
+                // Runs on the timer thread, the thread must not be freed while it's being woken up
+                const kernel_system::object_read_guard guard = kern->guard_object_reads();
                 kernel::thread *thr = kern->get_by_id<kernel::thread>(static_cast<kernel::uid>(userdata));
 
                 if (thr == nullptr) {
@@ -55,25 +83,111 @@ namespace eka2l1::kernel {
             });
         }
 
-        // !!!
-        std::fill(readys, readys + sizeof(readys) / sizeof(readys[0]), nullptr);
-        idle_event.reset();
+        cores.push_back(std::make_unique<smp::sub_scheduler>(0, cpu));
     }
 
     thread_scheduler::~thread_scheduler() {
-        stop_idling();
+        for (auto &sub : cores) {
+            sub->idle_event_.set();
+        }
+    }
+
+    std::uint32_t thread_scheduler::add_core(arm::core *cpu) {
+        const std::uint32_t index = static_cast<std::uint32_t>(cores.size());
+        cores.push_back(std::make_unique<smp::sub_scheduler>(index, cpu));
+
+        if (index == 1) {
+            last_balance_time = timing->microseconds();
+        }
+
+        return index;
+    }
+
+    void thread_scheduler::rebalance_if_due() {
+        const std::uint64_t now = timing->microseconds();
+
+        if (now < last_balance_time) {
+            // The timer was reset
+            last_balance_time = now;
+            return;
+        }
+
+        if (now - last_balance_time >= smp::BALANCE_PERIOD_TICKS * NANOKERNEL_TICK_US) {
+            rebalance();
+        }
+    }
+
+    smp::sub_scheduler &thread_scheduler::current_core() const {
+        const std::uint32_t index = smp::current_core();
+        return *cores[(index < cores.size()) ? index : 0];
+    }
+
+    smp::sub_scheduler &thread_scheduler::core_of(kernel::thread *thr) {
+        kernel::process *pr = thr->owning_process();
+
+        if (!pr) {
+            return *cores[0];
+        }
+
+        smp::schedulable_stats &stats = pr->smp_stats_;
+
+        if ((stats.core_ < 0) || (stats.core_ >= static_cast<std::int32_t>(cores.size()))) {
+            // First time this process is queued. Take the core with the fewest processes, until
+            // the balancer knows better.
+            std::uint32_t target = 0;
+
+            for (std::uint32_t i = 1; i < cores.size(); i++) {
+                if (cores[i]->group_count_ < cores[target]->group_count_) {
+                    target = i;
+                }
+            }
+
+            stats.core_ = static_cast<std::int32_t>(target);
+            cores[target]->group_count_++;
+        }
+
+        return *cores[stats.core_];
+    }
+
+    kernel::thread *thread_scheduler::current_thread() const {
+        return current_core().crr_thread_;
+    }
+
+    kernel::process *thread_scheduler::current_process() const {
+        return current_core().crr_process_;
     }
 
     void thread_scheduler::stop_idling() {
         if (kern->should_core_idle_when_inactive()) {
-            idle_event.set();
+            for (auto &sub : cores) {
+                sub->idle_event_.set();
+            }
         }
     }
 
-    void thread_scheduler::switch_context(kernel::thread *oldt, kernel::thread *newt) {
+    void thread_scheduler::reschedule_core_of(kernel::thread *thr) {
+        smp::sub_scheduler &sub = core_of(thr);
+
+        if (&sub == &current_core()) {
+            kern->prepare_reschedule();
+            return;
+        }
+
+        // The core runs on another host thread, stop its slice early
+        sub.run_core_->stop();
+        sub.idle_event_.set();
+    }
+
+    void thread_scheduler::switch_context(smp::sub_scheduler &sub, kernel::thread *oldt, kernel::thread *newt) {
         if (oldt) {
+            const std::uint64_t run_time_before = oldt->total_real_run_time;
+
             oldt->real_time_active_end();
-            run_core->save_context(oldt->ctx);
+            sub.run_core_->save_context(oldt->ctx);
+
+            if (kernel::process *pr = oldt->owning_process()) {
+                pr->smp_stats_.run_time_ += oldt->total_real_run_time - run_time_before;
+            }
 
             if (oldt->state == thread_state::run) {
                 oldt->state = thread_state::ready;
@@ -83,85 +197,98 @@ namespace eka2l1::kernel {
             oldt->decrease_access_count();
         }
 
-        memory_system *mem = kern->get_memory_system();
-
-        if (!core_mmu) {
-            core_mmu = mem->get_mmu(run_core);
-        }
-
         if (newt) {
+            if (!sub.core_mmu_) {
+                sub.core_mmu_ = kern->get_memory_system()->get_mmu(sub.run_core_);
+            }
+
             // cancel wake up
             // timing->unschedule_event(wakeup_evt, newt->unique_id());
-            crr_thread = newt;
-            crr_thread->state = thread_state::run;
-            crr_thread->increase_access_count();
-            crr_thread->real_time_active_begin();
-
-            mem::mem_model_process *mm_process = crr_process ? crr_process->get_mem_model() : nullptr;
+            sub.crr_thread_ = newt;
+            newt->state = thread_state::run;
+            newt->increase_access_count();
+            newt->real_time_active_begin();
 
-            if (crr_process != newt->owning_process()) {
+            if (sub.crr_process_ != newt->owning_process()) {
                 // Call the callbacks and release the process, no longerneed to read it
-                kern->call_process_switch_callbacks(run_core, crr_process, newt->owning_process());
+                kern->call_process_switch_callbacks(sub.run_core_, sub.crr_process_, newt->owning_process());
 
-                if (crr_process)
-                    crr_process->decrease_access_count();
+                if (sub.crr_process_)
+                    sub.crr_process_->decrease_access_count();
 
                 // Reference the use of the new process here
-                crr_process = newt->owning_process();
-                crr_process->increase_access_count();
+                sub.crr_process_ = newt->owning_process();
+                sub.crr_process_->increase_access_count();
 
-                mm_process = crr_process->get_mem_model();
+                mem::mem_model_process *mm_process = sub.crr_process_->get_mem_model();
 
-                core_mmu->set_current_addr_space(mm_process->address_space_id());
+                // The MMU drops pages of the old address space from its fastmem region. The region stays the same.
+                sub.core_mmu_->set_current_addr_space(mm_process->address_space_id());
+                sub.run_core_->set_fastmem_base(sub.core_mmu_->fastmem_base());
 
-                run_core->flush_tlb();
+                // Entries of the new address space may still be around from its last run
+                sub.run_core_->set_tlb_asid(mm_process->address_space_id());
 
-                // NOTE: This is not needed now
-                //run_core->set_asid(mm_process->address_space_id());
+                if (kernel::jit_cache *cache = kern->get_jit_cache()) {
+                    cache->warm(sub.run_core_, sub.crr_process_);
+                }
             }
 
-            run_core->load_context(crr_thread->ctx);
-            //LOG_TRACE(KERNEL, "Switched to {}", crr_thread->name());
+            sub.run_core_->load_context(newt->ctx);
+            //LOG_TRACE(KERNEL, "Switched to {}", newt->name());
         } else {
             // No current thread is eligible to run. Let the core that this scheduler currently handle sleeps.
-            crr_thread = nullptr;
+            sub.crr_thread_ = nullptr;
 
             // Let free access to kernel now
-            if (kern->should_core_idle_when_inactive()) {
+            if (sub.index_ != 0) {
+                // Secondary cores have nothing else to do, but must still notice a pause or an exit
+                kern->unlock();
+                sub.idle_event_.wait_for(SECONDARY_CORE_IDLE_WAIT_US);
+                sub.idle_event_.reset();
+                kern->lock();
+            } else if (kern->should_core_idle_when_inactive()) {
                 kern->unlock();
-                idle_event.wait();
-                idle_event.reset();
+                sub.idle_event_.wait();
+                sub.idle_event_.reset();
                 kern->lock();
             }
         }
     }
 
-    kernel::thread *thread_scheduler::next_ready_thread() {
-        if (ready_mask[0] != 0) {
+    kernel::thread *thread_scheduler::next_ready_thread(smp::sub_scheduler &sub) {
+        if (sub.ready_mask_[0] != 0) {
             // Check the most significant bit and get the non-empty read queue
-            int non_empty = common::find_most_significant_bit_one(ready_mask[0]);
+            int non_empty = common::find_most_significant_bit_one(sub.ready_mask_[0]);
 
             if (non_empty > 0) {
-                return readys[non_empty - 1];
+                return sub.readys_[non_empty - 1];
             }
         }
 
-        if (ready_mask[1] == 0) {
+        if (sub.ready_mask_[1] == 0) {
             return nullptr;
         }
 
-        const int non_empty = common::find_most_significant_bit_one(ready_mask[1]);
+        const int non_empty = common::find_most_significant_bit_one(sub.ready_mask_[1]);
 
         if (non_empty > 0) {
-            return readys[non_empty + 31];
+            return sub.readys_[non_empty + 31];
         }
 
         return nullptr;
     }
 
     void thread_scheduler::reschedule() {
-        kernel::thread *crr_thread = current_thread();
-        kernel::thread *next_thread = next_ready_thread();
+        smp::sub_scheduler &sub = current_core();
+
+        if ((sub.index_ == 0) && (cores.size() > 1)) {
+            // The primary core does the periodic balance, like the nanokernel's balance timer does on core 0
+            rebalance_if_due();
+        }
+
+        kernel::thread *crr_thread = sub.crr_thread_;
+        kernel::thread *next_thread = next_ready_thread(sub);
 
         if (next_thread && next_thread->time == 0) {
             // Restart the time
@@ -170,13 +297,13 @@ namespace eka2l1::kernel {
 
             if (next_thread->scheduler_link.next != next_thread || next_thread->scheduler_link.previous != next_thread) {
                 // Move it to the end, and get the new thread next to it.
-                readys[next_thread->real_priority] = next_thread->scheduler_link.next;
+                sub.readys_[next_thread->real_priority] = next_thread->scheduler_link.next;
                 next_thread = next_thread->scheduler_link.next;
             } else {
                 // Deque the thread from ready queue in order to get the next highest priority and ready thread
                 dequeue_thread_from_ready(next_thread);
 
-                next_thread = next_ready_thread();
+                next_thread = next_ready_thread(sub);
                 queue_thread_ready(old_friend);
             }
 
@@ -186,43 +313,41 @@ namespace eka2l1::kernel {
             }
         }
 
-        switch_context(crr_thread, next_thread);
+        switch_context(sub, crr_thread, next_thread);
     }
 
     void thread_scheduler::queue_thread_ready(kernel::thread *thr) {
+        smp::sub_scheduler &sub = core_of(thr);
+
         // If the ready queue at the target's thread priority is empty, add it
-        if (readys[thr->real_priority] == nullptr) {
-            readys[thr->real_priority] = thr;
-            ready_mask[thr->real_priority >> 5] |= (1 << (thr->real_priority & 31));
+        if (sub.readys_[thr->real_priority] == nullptr) {
+            sub.readys_[thr->real_priority] = thr;
+            sub.ready_mask_[thr->real_priority >> 5] |= (1 << (thr->real_priority & 31));
 
             thr->scheduler_link.next = thr;
             thr->scheduler_link.previous = thr;
+        } else {
+            // Add it to the end.
+            // The first thread in the queue has previous link linked to the last element
+            thr->scheduler_link.previous = sub.readys_[thr->real_priority]->scheduler_link.previous;
 
-            // Well no need to idle anymore :D
-            if (kern->should_core_idle_when_inactive() && !crr_thread)
-                idle_event.set();
+            // Since our target thread is the last in the ready queue, the next pointer of our target thread
+            // should points to the beginning of the ready queue
+            thr->scheduler_link.next = sub.readys_[thr->real_priority];
 
-            return;
+            thr->scheduler_link.previous->scheduler_link.next = thr;
+            sub.readys_[thr->real_priority]->scheduler_link.previous = thr;
         }
 
-        // Add it to the end.
-        // The first thread in the queue has previous link linked to the last element
-        thr->scheduler_link.previous = readys[thr->real_priority]->scheduler_link.previous;
-
-        // Since our target thread is the last in the ready queue, the next pointer of our target thread
-        // should points to the beginning of the ready queue
-        thr->scheduler_link.next = readys[thr->real_priority];
-
-        thr->scheduler_link.previous->scheduler_link.next = thr;
-        readys[thr->real_priority]->scheduler_link.previous = thr;
-
         // Well no need to idle anymore :D
-        if (kern->should_core_idle_when_inactive() && !crr_thread)
-            idle_event.set();
+        if (!sub.crr_thread_ && ((sub.index_ != 0) || kern->should_core_idle_when_inactive()))
+            sub.idle_event_.set();
     }
 
     void thread_scheduler::dequeue_thread_from_ready(kernel::thread *thr) {
-        if (!(ready_mask[thr->real_priority >> 5] & (1 << (thr->real_priority & 31)))) {
+        smp::sub_scheduler &sub = core_of(thr);
+
+        if (!(sub.ready_mask_[thr->real_priority >> 5] & (1 << (thr->real_priority & 31)))) {
             // The ready queue for this priority is empty. So what the hell
             return;
         }
@@ -232,8 +357,8 @@ namespace eka2l1::kernel {
             thr->scheduler_link.next = nullptr;
             thr->scheduler_link.previous = nullptr;
 
-            readys[thr->real_priority] = nullptr;
-            ready_mask[thr->real_priority >> 5] &= ~(1 << (thr->real_priority & 31));
+            sub.readys_[thr->real_priority] = nullptr;
+            sub.ready_mask_[thr->real_priority >> 5] &= ~(1 << (thr->real_priority & 31));
 
             return;
         }
@@ -242,11 +367,11 @@ namespace eka2l1::kernel {
         thr->scheduler_link.next->scheduler_link.previous = thr->scheduler_link.previous;
         thr->scheduler_link.previous->scheduler_link.next = thr->scheduler_link.next;
 
-        if (thr == readys[thr->real_priority]) {
+        if (thr == sub.readys_[thr->real_priority]) {
             // The ready queue at the priority has the target thread as first element, before
             // it being removed. So let's set the first element to next robin-rounded thread
             // of the target thread
-            readys[thr->real_priority] = thr->scheduler_link.next;
+            sub.readys_[thr->real_priority] = thr->scheduler_link.next;
         }
 
         // Empty the link
@@ -263,13 +388,13 @@ namespace eka2l1::kernel {
         thr->state = thread_state::ready;
 
         queue_thread_ready(thr);
-        kern->prepare_reschedule();
+        reschedule_core_of(thr);
 
         return true;
     }
 
     bool thread_scheduler::sleep(kernel::thread *thr, uint32_t sl_time, const bool deque) {
-        if (crr_thread != thr) {
+        if (current_core().crr_thread_ != thr) {
             return false;
         }
 
@@ -290,7 +415,7 @@ namespace eka2l1::kernel {
     }
 
     void thread_scheduler::unschedule_wakeup() {
-        timing->unschedule_event(wakeup_evt, crr_thread->unique_id());
+        timing->unschedule_event(wakeup_evt, current_core().crr_thread_->unique_id());
     }
 
     bool thread_scheduler::wait(kernel::thread *thr) {
@@ -301,7 +426,7 @@ namespace eka2l1::kernel {
         }
 
         dequeue_thread_from_ready(thr);
-        kern->prepare_reschedule();
+        reschedule_core_of(thr);
 
         return true;
     }
@@ -325,8 +450,7 @@ namespace eka2l1::kernel {
         thr->time = thr->timeslice;
 
         queue_thread_ready(thr);
-
-        kern->prepare_reschedule();
+        reschedule_core_of(thr);
 
         return true;
     }
@@ -357,10 +481,109 @@ namespace eka2l1::kernel {
 
         thr->state = thread_state::stop;
 
-        if (crr_thread == thr) {
-            kern->prepare_reschedule();
+        if (core_of(thr).crr_thread_ == thr) {
+            reschedule_core_of(thr);
         }
 
         return true;
     }
+
+    void thread_scheduler::migrate_process(kernel::process *pr, const std::uint32_t target_core) {
+        std::vector<kernel::thread *> queued;
+
+        common::double_linked_queue_element *elem = pr->thread_list.first();
+        common::double_linked_queue_element *end = pr->thread_list.end();
+
+        // Take the ready threads off the old core's queues before the process changes core
+        while (elem && (elem != end)) {
+            kernel::thread *thr = E_LOFF(elem, kernel::thread, process_thread_link);
+
+            if (thr->scheduler_link.next != nullptr) {
+                dequeue_thread_from_ready(thr);
+                queued.push_back(thr);
+            }
+
+            elem = elem->next;
+        }
+
+        cores[pr->smp_stats_.core_]->group_count_--;
+        cores[target_core]->group_count_++;
+
+        pr->smp_stats_.core_ = static_cast<std::int32_t>(target_core);
+
+        for (kernel::thread *thr : queued) {
+            queue_thread_ready(thr);
+        }
+
+        if (!queued.empty()) {
+            reschedule_core_of(queued.front());
+        }
+    }
+
+    void thread_scheduler::rebalance() {
+        if (cores.size() < 2) {
+            return;
+        }
+
+        const std::uint64_t now = timing->microseconds();
+        const std::uint64_t delta_time = now - last_balance_time;
+
+        last_balance_time = now;
+
+        std::vector<kernel::process *> groups;
+        std::vector<smp::balance_candidate> candidates;
+
+        for (auto &sub : cores) {
+            sub->group_count_ = 0;
+        }
+
+        for (auto &obj : kern->get_process_list()) {
+            kernel::process *pr = reinterpret_cast<kernel::process *>(obj.get());
+
+            if (!pr || (pr->smp_stats_.core_ < 0)) {
+                continue;
+            }
+
+            smp::schedulable_stats &stats = pr->smp_stats_;
+            cores[stats.core_]->group_count_++;
+
+            smp::balance_candidate candidate;
+            candidate.run_units_ = smp::calculate_load_units(stats.run_time_ - stats.balanced_run_time_, delta_time);
+            candidate.current_core_ = static_cast<std::uint32_t>(stats.core_);
+            candidate.target_core_ = candidate.current_core_;
+            candidate.movable_ = true;
+
+            stats.balanced_run_time_ = stats.run_time_;
+
+            int priority = 0;
+
+            common::double_linked_queue_element *elem = pr->thread_list.first();
+            common::double_linked_queue_element *end = pr->thread_list.end();
+
+            while (elem && (elem != end)) {
+                priority = common::max(priority, E_LOFF(elem, kernel::thread, process_thread_link)->real_priority);
+                elem = elem->next;
+            }
+
+            // A process with a thread on a core can not move until that thread is switched out
+            for (auto &sub : cores) {
+                if (sub->crr_thread_ && (sub->crr_thread_->owning_process() == pr)) {
+                    candidate.movable_ = false;
+                }
+            }
+
+            candidate.heavy_ = smp::is_heavy(priority, candidate.run_units_);
+
+            groups.push_back(pr);
+            candidates.push_back(candidate);
+        }
+
+        smp::balance(candidates, static_cast<std::uint32_t>(cores.size()));
+
+        for (std::size_t i = 0; i < candidates.size(); i++) {
+            if (candidates[i].target_core_ != candidates[i].current_core_) {
+                migrate_process(groups[i], candidates[i].target_core_);
+            }
+        }
+    }
 }
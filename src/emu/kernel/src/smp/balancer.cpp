@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2022 EKA2L1 Team.
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <kernel/smp/avail.h>
+#include <kernel/smp/balancer.h>
+
+#include <algorithm>
+
+namespace eka2l1::kernel::smp {
+    std::uint32_t calculate_load_units(std::uint64_t delta_target, std::uint64_t delta_time) {
+        if (delta_time == 0) {
+            return 0;
+        }
+
+        // Keep the multiplication below from overflowing
+        while (delta_time >= (1ULL << 20)) {
+            delta_time >>= 1;
+            delta_target >>= 1;
+        }
+
+        if (delta_time == 0) {
+            return 0;
+        }
+
+        // Half of the time is added so that a small load does not get rounded to nothing
+        const std::uint64_t units = ((delta_target * cpu_availability::idle_unit) + (delta_time / 2)) / delta_time;
+        return static_cast<std::uint32_t>(std::min<std::uint64_t>(units, cpu_availability::idle_unit));
+    }
+
+    bool is_heavy(const int priority, const std::uint32_t run_units) {
+        return (priority > HEAVY_PRIORITY) && (run_units >= INACTIVE_LOAD_UNITS);
+    }
+
+    static std::uint32_t pick_core(const cpu_availability &avail, const std::uint32_t preferred) {
+        const std::uint32_t lowest = avail.find_lowest_load();
+
+        if ((preferred < avail.num_cores()) && (avail.remains[preferred] == avail.remains[lowest])) {
+            return preferred;
+        }
+
+        return lowest;
+    }
+
+    void balance(std::vector<balance_candidate> &candidates, const std::uint32_t core_count) {
+        if (core_count == 0) {
+            return;
+        }
+
+        cpu_availability avail(core_count);
+        std::vector<balance_candidate *> sorted;
+
+        for (balance_candidate &candidate : candidates) {
+            if (candidate.current_core_ >= core_count) {
+                candidate.current_core_ = 0;
+            }
+
+            candidate.target_core_ = candidate.current_core_;
+
+            if ((core_count == 1) || !candidate.movable_ || (candidate.run_units_ < INACTIVE_LOAD_UNITS)) {
+                // Stays where it is, but still weighs on its core
+                avail.add_load(candidate.current_core_, candidate.run_units_);
+                continue;
+            }
+
+            sorted.push_back(&candidate);
+        }
+
+        // Non-heavy first, largest load first. Heavy at the end, smallest load first.
+        std::stable_sort(sorted.begin(), sorted.end(), [](const balance_candidate *lhs, const balance_candidate *rhs) {
+            if (lhs->heavy_ != rhs->heavy_) {
+                return !lhs->heavy_;
+            }
+
+            return lhs->heavy_ ? (lhs->run_units_ < rhs->run_units_) : (lhs->run_units_ > rhs->run_units_);
+        });
+
+        std::size_t heavy_left = std::count_if(sorted.begin(), sorted.end(), [](const balance_candidate *candidate) {
+            return candidate->heavy_;
+        });
+
+        for (balance_candidate *candidate : sorted) {
+            const std::uint32_t core = pick_core(avail, candidate->current_core_);
+            candidate->target_core_ = core;
+
+            if (!candidate->heavy_) {
+                avail.add_load(core, candidate->run_units_);
+                continue;
+            }
+
+            const std::size_t free_cores = std::count_if(avail.remains.begin(), avail.remains.end(), [](const std::int32_t remain) {
+                return remain > 0;
+            });
+
+            if (heavy_left <= free_cores) {
+                // Enough cores for every heavy one left, take this one whole
+                avail.set_load_max(core);
+            } else {
+                avail.add_load(core, candidate->run_units_);
+            }
+
+            heavy_left--;
+        }
+    }
+}
@@ -0,0 +1,32 @@
+/*
+ * Copyright (c) 2022 EKA2L1 Team.
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <kernel/smp/core.h>
+
+namespace eka2l1::kernel::smp {
+    static thread_local std::uint32_t current_core_index = 0;
+
+    void bind_current_core(const std::uint32_t index) {
+        current_core_index = index;
+    }
+
+    std::uint32_t current_core() {
+        return current_core_index;
+    }
+}
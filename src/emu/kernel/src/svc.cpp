@@ -1481,6 +1481,10 @@ namespace eka2l1::epoc {
         if (addr_space_ptr && (size <= 0x100000)) {
             kern->run_imb_range_callback(crr_process, addr.ptr_address(), size);
 
+            if (kernel::jit_cache *cache = kern->get_jit_cache()) {
+                cache->invalidate(crr_process, addr.ptr_address(), size);
+            }
+
             if (kern->get_config()->dump_imb_range_code) {
                 auto start = std::chrono::system_clock::now();
                 std::time_t end_time = std::chrono::system_clock::to_time_t(start);
@@ -2523,18 +2527,20 @@ namespace eka2l1::epoc {
         }
 
         std::uint8_t *data_ptr = data.get(crr_pr);
-        auto data_vec = prop->get_bin();
+        const std::uint32_t data_size = prop->get_bin_size();
 
-        const std::size_t size_to_copy = std::min<std::size_t>(data_vec.size(), datlength);
+        const std::size_t size_to_copy = std::min<std::size_t>(data_size, datlength);
         std::int32_t return_code = epoc::error_none;
 
-        if (data_vec.size() > datlength) {
+        if (data_size > datlength) {
             // The given buffer can't hold ours.
             return_code = epoc::error_overflow;
         }
 
         // Whether the buffer is too small, we still have to either copy truncated or full data.
-        std::copy(data_vec.begin(), data_vec.begin() + size_to_copy, data.get(kern->crr_process()));
+        if (size_to_copy) {
+            std::memcpy(data_ptr, prop->get_bin_ptr(), size_to_copy);
+        }
 
         if (return_code != epoc::error_none) {
             return return_code;
@@ -2610,18 +2616,24 @@ namespace eka2l1::epoc {
             prop->second = key;
         }
 
-        prop->define(prop_type, info->size);
+        prop->define(prop_type, info->size, true);
 
         return epoc::error_none;
     }
 
     BRIDGE_FUNC(std::int32_t, property_delete, std::int32_t cage, std::int32_t key) {
-        property_ptr prop = kern->delete_prop(cage, key);
+        property_ptr prop = kern->get_prop(cage, key);
 
         if (!prop || !prop->is_defined()) {
             return epoc::error_not_found;
         }
 
+        // Like properties owned by a system server on the device. HLE services keep pointers to theirs.
+        if (!prop->is_defined_by_guest()) {
+            return epoc::error_permission_denied;
+        }
+
+        kern->delete_prop(cage, key);
         return epoc::error_none;
     }
 
@@ -2704,22 +2716,23 @@ namespace eka2l1::epoc {
             return epoc::error_not_found;
         }
 
-        std::vector<uint8_t> dat = prop->get_property_object()->get_bin();
+        service::property *prop_obj = prop->get_property_object();
+        const std::uint32_t data_size = prop_obj->get_bin_size();
 
-        if (dat.size() == 0) {
+        if (data_size == 0) {
             return epoc::error_argument;
         }
 
-        const std::size_t size_to_copy = std::min<std::size_t>(dat.size(), buffer_size);
+        const std::size_t size_to_copy = std::min<std::size_t>(data_size, buffer_size);
         std::int32_t return_code = epoc::error_none;
 
-        if (dat.size() > buffer_size) {
+        if (data_size > buffer_size) {
             // The given buffer can't hold ours.
             return_code = epoc::error_overflow;
         }
 
         // Whether the buffer is too small, we still have to either copy truncated or full data.
-        std::copy(dat.begin(), dat.begin() + size_to_copy, buffer_ptr_guest.get(kern->crr_process()));
+        std::memcpy(buffer_ptr_guest.get(kern->crr_process()), prop_obj->get_bin_ptr(), size_to_copy);
 
         if (return_code != epoc::error_none) {
             return return_code;
@@ -3133,7 +3146,7 @@ namespace eka2l1::epoc {
             return epoc::error_none;
         }
 
-        std::uint8_t *dest_of_operate = reinterpret_cast<std::uint8_t *>(process_to_operate->get_ptr_on_addr_space(addr));
+        std::uint8_t *dest_of_operate = reinterpret_cast<std::uint8_t *>(process_to_operate->get_ptr_on_addr_space(addr, len));
 
         if (!dest_of_operate) {
             LOG_WARN(KERNEL, "Destination to operate is null, return success still.");
@@ -3353,7 +3366,7 @@ namespace eka2l1::epoc {
         typedef bool (*reality_func)(void *data);
 
         const std::uint32_t current = kern->get_cpu()->get_pc();
-        std::uint64_t *data = reinterpret_cast<std::uint64_t *>(kern->crr_process()->get_ptr_on_addr_space(current - 20));
+        std::uint64_t *data = reinterpret_cast<std::uint64_t *>(kern->crr_process()->get_ptr_on_addr_space(current - 20, 2 * sizeof(std::uint64_t)));
 
         kernel::thread *thr = kern->crr_thread();
         kern->get_cpu()->save_context(thr->get_thread_context());
@@ -4577,7 +4590,7 @@ namespace eka2l1::epoc {
             prop->second = create_info->arg1_;
         }
 
-        prop->define(static_cast<service::property_type>(create_info->arg2_), create_info->arg3_);
+        prop->define(static_cast<service::property_type>(create_info->arg2_), create_info->arg3_, true);
 
         finish_status_request_eka1(target_thread, finish_signal, epoc::error_none);
         return epoc::error_none;
@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2022 EKA2L1 Team.
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <common/log.h>
+#include <kernel/svctable.h>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <utility>
+
+namespace eka2l1::hle {
+    std::size_t svc_table::build(const func_map &funcs) {
+        for (auto &group : groups_) {
+            group.clear();
+        }
+
+        std::size_t ignored = 0;
+
+        for (auto &[svcnum, func] : funcs) {
+            const std::uint32_t group = svcnum >> GROUP_SHIFT;
+            const std::uint32_t index = svcnum & INDEX_MASK;
+
+            if (group >= GROUP_COUNT) {
+                LOG_WARN(KERNEL, "SVC 0x{:X} ({}) is out of range, ignored", svcnum, func.name);
+                ignored++;
+
+                continue;
+            }
+
+            std::vector<slot> &table = groups_[group];
+
+            if (table.size() <= index) {
+                table.resize(index + 1);
+            }
+
+            // Elements of an unordered_map don't move, keep pointing to them
+            table[index].func_ = &func;
+        }
+
+        return ignored;
+    }
+
+    svc_table::slot *svc_table::find(const std::uint32_t svcnum) {
+        const std::uint32_t group = svcnum >> GROUP_SHIFT;
+        const std::uint32_t index = svcnum & INDEX_MASK;
+
+        if ((group >= GROUP_COUNT) || (index >= groups_[group].size())) {
+            return nullptr;
+        }
+
+        slot *result = &groups_[group][index];
+        return result->func_ ? result : nullptr;
+    }
+
+    std::string svc_table::profile_json(const std::uint64_t cpu_hz) const {
+        std::vector<std::pair<std::uint32_t, const slot *>> called;
+
+        for (std::uint32_t group = 0; group < GROUP_COUNT; group++) {
+            for (std::uint32_t index = 0; index < groups_[group].size(); index++) {
+                if (groups_[group][index].call_count_) {
+                    called.emplace_back((group << GROUP_SHIFT) | index, &groups_[group][index]);
+                }
+            }
+        }
+
+        if (called.empty()) {
+            return std::string();
+        }
+
+        // Most expensive first
+        std::sort(called.begin(), called.end(), [](const auto &lhs, const auto &rhs) {
+            return lhs.second->host_time_ns_ > rhs.second->host_time_ns_;
+        });
+
+        std::string result = "{\n    \"svcs\": [\n";
+
+        for (std::size_t i = 0; i < called.size(); i++) {
+            const slot &entry = *called[i].second;
+            const std::uint64_t host_cycles = static_cast<std::uint64_t>(static_cast<double>(entry.host_time_ns_) * cpu_hz / 1000000000.0);
+
+            result += fmt::format("        {{ \"number\": \"0x{:X}\", \"name\": \"{}\", \"calls\": {}, \"host_time_us\": {}, "
+                                  "\"host_time_in_guest_cycles\": {} }}{}\n",
+                called[i].first, entry.func_->name, entry.call_count_, entry.host_time_ns_ / 1000, host_cycles,
+                (i + 1 == called.size()) ? "" : ",");
+        }
+
+        result += "    ]\n}\n";
+        return result;
+    }
+}
@@ -35,6 +35,7 @@ namespace eka2l1 {
             kernel::access_type access)
             : kernel_obj(kern, name, nullptr, access)
             , timing(timing)
+            , pending_event(INVALID_EVENT_HANDLE)
             , outstanding(false) {
             obj_type = object_type::timer;
 
@@ -46,7 +47,7 @@ namespace eka2l1 {
         }
 
         timer::~timer() {
-            timing->unschedule_event(callback_type, reinterpret_cast<std::uint64_t>(&info));
+            timing->unschedule_event(pending_event);
         }
 
         bool timer::after(kernel::thread *requester, eka2l1::ptr<epoc::request_status> sts, std::uint64_t us_signal) {
@@ -64,7 +65,7 @@ namespace eka2l1 {
             // Simulate some timeslice delay, and not finish immediately
             // Some games just set the microseconds to signal to 1, and then when it's report superfast, it acts weird!
             // For example: DDragon, which signals an object that has not yet been set to active in time! (cancel was called but ineffective cause finish got to it first)
-            timing->schedule_event(common::max<std::uint64_t>(MINIMUM_US_AFTER, us_signal), 
+            pending_event = timing->schedule_event(common::max<std::uint64_t>(MINIMUM_US_AFTER, us_signal),
                 callback_type, reinterpret_cast<std::uint64_t>(&info));
             return true;
         }
@@ -96,7 +97,7 @@ namespace eka2l1 {
             // If the timer hasn't finished yet, please unschedule it.
             if (outstanding) {
                 // Cancel
-                timing->unschedule_event(callback_type, reinterpret_cast<std::uint64_t>(&info));
+                timing->unschedule_event(pending_event);
             }
 
             return request_finish();
@@ -32,6 +32,189 @@
 #include <vector>
 
 namespace eka2l1 {
+    static constexpr std::uint32_t EVENT_HANDLE_SLOT_BITS = 32;
+
+    static event_handle make_event_handle(const std::uint32_t slot, const std::uint32_t generation) {
+        return (static_cast<event_handle>(generation) << EVENT_HANDLE_SLOT_BITS) | slot;
+    }
+
+    event_queue::event_queue()
+        : order_counter_(0) {
+    }
+
+    bool event_queue::before(const std::size_t lhs, const std::size_t rhs) const {
+        const heap_node &lhs_node = heap_[lhs];
+        const heap_node &rhs_node = heap_[rhs];
+
+        if (lhs_node.evt_.event_time != rhs_node.evt_.event_time) {
+            return lhs_node.evt_.event_time < rhs_node.evt_.event_time;
+        }
+
+        return lhs_node.order_ < rhs_node.order_;
+    }
+
+    void event_queue::place(const std::size_t index, heap_node &&node) {
+        slots_[node.slot_].heap_index_ = static_cast<std::uint32_t>(index);
+        heap_[index] = std::move(node);
+    }
+
+    void event_queue::sift_up(std::size_t index) {
+        while (index > 0) {
+            const std::size_t parent = (index - 1) / 2;
+
+            if (!before(index, parent)) {
+                break;
+            }
+
+            heap_node temp = std::move(heap_[parent]);
+            place(parent, std::move(heap_[index]));
+            place(index, std::move(temp));
+
+            index = parent;
+        }
+    }
+
+    void event_queue::sift_down(std::size_t index) {
+        const std::size_t count = heap_.size();
+
+        while (true) {
+            const std::size_t left = index * 2 + 1;
+            const std::size_t right = left + 1;
+
+            std::size_t smallest = index;
+
+            if ((left < count) && before(left, smallest)) {
+                smallest = left;
+            }
+
+            if ((right < count) && before(right, smallest)) {
+                smallest = right;
+            }
+
+            if (smallest == index) {
+                break;
+            }
+
+            heap_node temp = std::move(heap_[smallest]);
+            place(smallest, std::move(heap_[index]));
+            place(index, std::move(temp));
+
+            index = smallest;
+        }
+    }
+
+    void event_queue::unlink_data(const heap_node &node) {
+        auto range = slots_by_data_.equal_range(node.evt_.event_user_data);
+
+        for (auto ite = range.first; ite != range.second; ite++) {
+            if (ite->second == node.slot_) {
+                slots_by_data_.erase(ite);
+                break;
+            }
+        }
+
+        // Handles to this slot are now stale
+        slots_[node.slot_].generation_++;
+        free_slots_.push_back(node.slot_);
+    }
+
+    void event_queue::remove_at(const std::size_t index) {
+        unlink_data(heap_[index]);
+
+        const std::size_t last = heap_.size() - 1;
+
+        if (index != last) {
+            place(index, std::move(heap_[last]));
+            heap_.pop_back();
+
+            // The moved node may belong either above or below its new spot
+            if ((index > 0) && before(index, (index - 1) / 2)) {
+                sift_up(index);
+            } else {
+                sift_down(index);
+            }
+        } else {
+            heap_.pop_back();
+        }
+    }
+
+    event_handle event_queue::push(const event &evt) {
+        std::uint32_t slot_index = 0;
+
+        if (free_slots_.empty()) {
+            slot_index = static_cast<std::uint32_t>(slots_.size());
+            slots_.push_back({ 0, 1 });
+        } else {
+            slot_index = free_slots_.back();
+            free_slots_.pop_back();
+        }
+
+        heap_node node;
+        node.evt_ = evt;
+        node.order_ = order_counter_++;
+        node.slot_ = slot_index;
+
+        heap_.emplace_back();
+        place(heap_.size() - 1, std::move(node));
+        sift_up(heap_.size() - 1);
+
+        slots_by_data_.emplace(evt.event_user_data, slot_index);
+        return make_event_handle(slot_index, slots_[slot_index].generation_);
+    }
+
+    bool event_queue::cancel(const event_handle handle) {
+        const std::uint32_t slot_index = static_cast<std::uint32_t>(handle & 0xFFFFFFFF);
+        const std::uint32_t generation = static_cast<std::uint32_t>(handle >> EVENT_HANDLE_SLOT_BITS);
+
+        if ((slot_index >= slots_.size()) || (slots_[slot_index].generation_ != generation)) {
+            return false;
+        }
+
+        remove_at(slots_[slot_index].heap_index_);
+        return true;
+    }
+
+    bool event_queue::cancel(const int event_type, const std::uint64_t userdata) {
+        auto range = slots_by_data_.equal_range(userdata);
+        std::optional<std::size_t> target;
+
+        for (auto ite = range.first; ite != range.second; ite++) {
+            const std::size_t index = slots_[ite->second].heap_index_;
+
+            if (heap_[index].evt_.event_type != event_type) {
+                continue;
+            }
+
+            if (!target.has_value() || before(target.value(), index)) {
+                target = index;
+            }
+        }
+
+        if (!target.has_value()) {
+            return false;
+        }
+
+        remove_at(target.value());
+        return true;
+    }
+
+    event event_queue::pop() {
+        event evt = heap_.front().evt_;
+        remove_at(0);
+
+        return evt;
+    }
+
+    void event_queue::clear() {
+        for (const heap_node &node : heap_) {
+            slots_[node.slot_].generation_++;
+            free_slots_.push_back(node.slot_);
+        }
+
+        heap_.clear();
+        slots_by_data_.clear();
+    }
+
     ntimer::ntimer(const std::uint32_t cpu_hz) {
         CPU_HZ_ = cpu_hz;
         should_stop_ = false;
@@ -143,14 +326,8 @@ namespace eka2l1 {
         std::unique_lock<std::mutex> unq(lock_);
         std::uint64_t global_timer = teletimer_->microseconds();
 
-        while (!events_.empty() && events_.back().event_time <= global_timer) {
-            event evt = std::move(events_.back());
-            events_.pop_back();
-
-            std::stable_sort(events_.begin(), events_.end(), [](const event &lhs, const event &rhs) {
-                return lhs.event_time > rhs.event_time;
-            });
-
+        while (!events_.empty() && events_.top()->event_time <= global_timer) {
+            const event evt = events_.pop();
             unq.unlock();
 
             if (event_types_[evt.event_type].callback) {
@@ -162,13 +339,13 @@ namespace eka2l1 {
         }
 
         if (!events_.empty()) {
-            return static_cast<std::uint64_t>(events_.back().event_time - global_timer);
+            return static_cast<std::uint64_t>(events_.top()->event_time - global_timer);
         }
 
         return std::nullopt;
     }
 
-    void ntimer::schedule_event(int64_t us_into_future, int event_type, std::uint64_t userdata) {
+    event_handle ntimer::schedule_event(int64_t us_into_future, int event_type, std::uint64_t userdata) {
         const std::lock_guard<std::mutex> guard(lock_);
 
         event evt;
@@ -177,35 +354,24 @@ namespace eka2l1 {
         evt.event_type = event_type;
         evt.event_user_data = userdata;
 
-        bool should_nof = (events_.empty()) || (events_.back().event_time > evt.event_time);
-        events_.push_back(evt);
-
-        std::stable_sort(events_.begin(), events_.end(), [](const event &lhs, const event &rhs) {
-            return lhs.event_time > rhs.event_time;
-        });
+        bool should_nof = (events_.empty()) || (events_.top()->event_time > evt.event_time);
+        const event_handle handle = events_.push(evt);
 
         if (should_nof) {
             new_event_evt_.set();
         }
+
+        return handle;
     }
 
     bool ntimer::unschedule_event(int event_type, uint64_t userdata) {
         const std::lock_guard<std::mutex> guard(lock_);
+        return events_.cancel(event_type, userdata);
+    }
 
-        auto res = std::find_if(events_.begin(), events_.end(),
-            [&](auto evt) { return (evt.event_type == event_type) && (evt.event_user_data == userdata); });
-
-        if (res != events_.end()) {
-            events_.erase(res);
-
-            std::stable_sort(events_.begin(), events_.end(), [](const event &lhs, const event &rhs) {
-                return lhs.event_time > rhs.event_time;
-            });
-
-            return true;
-        }
-
-        return false;
+    bool ntimer::unschedule_event(const event_handle handle) {
+        const std::lock_guard<std::mutex> guard(lock_);
+        return events_.cancel(handle);
     }
 
     bool ntimer::set_clock_frequency_mhz(const std::uint32_t cpu_mhz) {
@@ -35,6 +35,7 @@ namespace eka2l1 {
 
     namespace common {
         class ro_stream;
+        class bytepair_page_store;
     }
 
     /*! \brief Contains the loader for E32Image, ROMImage, SIS. */
@@ -192,6 +193,11 @@ namespace eka2l1 {
             bool has_extended_header = false;
 
             std::vector<std::string> dll_names;
+
+            // Text pages that were left compressed when parsing with paged code. The first
+            // paged_code_size bytes of the code section in data are not filled.
+            std::shared_ptr<common::bytepair_page_store> code_pages;
+            std::uint32_t paged_code_size = 0;
         };
 
         /**
@@ -213,10 +219,12 @@ namespace eka2l1 {
          * 
          * @param stream     The stream to parse from.
          * @param read_reloc If this is true, relocation section will be parsed.
+         * @param page_code  If this is true and the image is bytepair compressed, pages that only hold text
+         *                   are kept compressed in code_pages, to be decompressed when they are touched.
          * 
          * @returns An optional contains E32 Image. Nullopt if invalid.
          */
-        std::optional<e32img> parse_e32img(common::ro_stream *stream, bool read_reloc = true);
+        std::optional<e32img> parse_e32img(common::ro_stream *stream, bool read_reloc = true, const bool page_code = false);
 
         /**
          * @brief Check if the stream content is E32 Image.
@@ -69,4 +69,12 @@ namespace eka2l1::loader {
 
     bool convert_nvg_to_svg(common::ro_stream &in, common::wo_stream &out, std::vector<nvg_convert_error_description> &errors,
         nvg_options *options = nullptr);
+
+    /**
+     * @brief Read the viewport declared in the header of an NVG file.
+     *
+     * @param viewport Array of four floats receiving x, y, width and height of the view box.
+     * @returns False if the stream is not an NVG file.
+     */
+    bool get_nvg_viewport(common::ro_stream &in, float *viewport);
 }
\ No newline at end of file
@@ -26,6 +26,7 @@
 #include <cstdint>
 #include <optional>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace eka2l1 {
@@ -219,14 +220,65 @@ namespace eka2l1 {
             }
         };
 
+        /**
+         * @brief Flat lookup table over the files and directories of the first root directory.
+         *
+         * Keys are paths without the drive, lowercased, with components separated by a single backslash.
+         * Values point into the directory tree, so the owning ROM must not be copied (moving is fine).
+         */
+        struct rom_index {
+            std::unordered_map<std::u16string, rom_entry *> files;
+            std::unordered_map<std::u16string, rom_dir *> dirs;
+
+            // True if the directory tree was restored from a saved index, instead of parsed from the ROM.
+            bool restored = false;
+
+            bool empty() const {
+                return files.empty() && dirs.empty();
+            }
+
+            void clear() {
+                files.clear();
+                dirs.clear();
+            }
+        };
+
         struct rom {
             rom_header header;
             rom_section_header section_header;
 
             root_dir_list root;
+            rom_index index;
+
+            rom() = default;
+            rom(const rom &rhs) = delete;
+            rom &operator=(const rom &rhs) = delete;
+            rom(rom &&rhs) = default;
+            rom &operator=(rom &&rhs) = default;
+
+            /**
+             * @brief Build the lookup index from the directory tree.
+             *
+             * Lookups walk the tree one component at a time while the index is empty.
+             */
+            void build_index();
+
+            /**
+             * @brief Restore the directory tree from a stream written by save_index, and index it.
+             *
+             * The tree is stored flat and already sorted, so this avoids seeking through the whole ROM.
+             * The stream is rejected if it was written for a ROM with a different header.
+             *
+             * @returns True on success. On failure, the tree and index are left untouched.
+             */
+            bool load_index(common::ro_stream *stream);
+            bool save_index(common::wo_stream *stream);
 
             loader::rom_dir *burn_tree_find_dir(const std::string &vir_path);
+            loader::rom_dir *burn_tree_find_dir(const std::u16string &vir_path);
+
             std::optional<loader::rom_entry> burn_tree_find_entry(const std::string &vir_path);
+            std::optional<loader::rom_entry> burn_tree_find_entry(const std::u16string &vir_path);
         };
 
         enum rom_defrag_error {
@@ -235,7 +287,14 @@ namespace eka2l1 {
             ROM_DEFRAG_ERROR_READ_WRITE_FAIL = -3
         };
 
-        std::optional<rom> load_rom(common::ro_stream *stream);
+        /**
+         * @brief Parse the ROM header and directory tree, and index its entries.
+         *
+         * @param stream        The ROM binary stream.
+         * @param index_stream  Optional stream of an index saved with rom::save_index for this ROM.
+         *                      When it can not be used, the index is built from the tree.
+         */
+        std::optional<rom> load_rom(common::ro_stream *stream, common::ro_stream *index_stream = nullptr);
 
         /**
          * @brief Defragment any pages of ROM that's compressed or just unzip the ROM overall
@@ -316,7 +316,7 @@ namespace eka2l1::loader {
         return epoc::error_none;
     }
 
-    std::optional<e32img> parse_e32img(common::ro_stream *stream, bool read_reloc) {
+    std::optional<e32img> parse_e32img(common::ro_stream *stream, bool read_reloc, const bool page_code) {
         if (!stream) {
             return std::nullopt;
         }
@@ -376,8 +376,34 @@ namespace eka2l1::loader {
                 common::ro_buf_stream raw_bp_stream(reinterpret_cast<std::uint8_t *>(&temp[0]), temp.size());
                 common::ibytepair_stream bpstream(reinterpret_cast<common::ro_stream *>(&raw_bp_stream));
 
-                auto codesize = bpstream.read_pages(&img.data[img.header.code_offset], img.header.code_size);
-                auto restsize = bpstream.read_pages(&img.data[img.header.code_offset + img.header.code_size], img.uncompressed_size);
+                if (page_code && (img.header.text_size >= common::BYTEPAIR_PAGE_SIZE)) {
+                    auto store = std::make_shared<common::bytepair_page_store>();
+
+                    if (store->load(reinterpret_cast<const std::uint8_t *>(temp.data()), temp.size())) {
+                        // Pages that also hold the import address table or the export directory are needed
+                        // by the loader, only pages with nothing but text are left compressed.
+                        const std::uint32_t paged_count = common::min<std::uint32_t>(store->page_count(),
+                            img.header.text_size / common::BYTEPAIR_PAGE_SIZE);
+
+                        for (std::uint32_t i = paged_count; i < store->page_count(); i++) {
+                            store->read_page(reinterpret_cast<std::uint8_t *>(&img.data[img.header.code_offset + i * common::BYTEPAIR_PAGE_SIZE]), i);
+                        }
+
+                        img.paged_code_size = paged_count * common::BYTEPAIR_PAGE_SIZE;
+                        img.code_pages = std::move(store);
+
+                        raw_bp_stream.seek(img.code_pages->consumed_size(), common::seek_where::beg);
+                    } else {
+                        LOG_WARN(LOADER, "Bytepair code table is invalid, decompressing the code section fully");
+                        raw_bp_stream.seek(0, common::seek_where::beg);
+                    }
+                }
+
+                if (!img.code_pages) {
+                    bpstream.read_pages(&img.data[img.header.code_offset], img.header.code_size);
+                }
+
+                bpstream.read_pages(&img.data[img.header.code_offset + img.header.code_size], img.uncompressed_size);
             }
         } else {
             img.uncompressed_size = static_cast<uint32_t>(file_size);
@@ -700,7 +700,7 @@ namespace eka2l1::loader {
                 aspect_ratio_mode = " preserveAspectRatio=\"xMinYMin meet\"";
                 break;
             case NVG_PRESERVE_ASPECT_RATIO_SLICE:
-                aspect_ratio_mode = "preserveAspectRatio=\"xMidYMid slice\"";
+                aspect_ratio_mode = " preserveAspectRatio=\"xMidYMid slice\"";
                 break;
             default:
                 break;
@@ -794,4 +794,13 @@ namespace eka2l1::loader {
 
         return false;
     }
-}
\ No newline at end of file
+
+    bool get_nvg_viewport(common::ro_stream &in, float *viewport) {
+        char signature[3];
+        if ((in.read(0, signature, 3) != 3) || (signature[0] != 'n') || (signature[1] != 'v') || (signature[2] != 'g')) {
+            return false;
+        }
+
+        return in.read(NVG_VIEWPORT_INFO_OFFSET, viewport, 16) == 16;
+    }
+}
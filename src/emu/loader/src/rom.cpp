@@ -28,14 +28,17 @@
 
 #include <loader/rom.h>
 
+#include <cstring>
+#include <cwctype>
+
 namespace eka2l1::loader {
     enum class file_attrib {
         dir = 0x0010
     };
 
-    loader::rom_dir *rom::burn_tree_find_dir(const std::string &vir_path) {
+    static loader::rom_dir *walk_tree_find_dir(rom &romf, const std::string &vir_path) {
         auto ite = path_iterator(vir_path);
-        loader::rom_dir *last_dir_found = &(root.root_dirs[0].dir);
+        loader::rom_dir *last_dir_found = &(romf.root.root_dirs[0].dir);
 
         // Skip through the drive
         ite++;
@@ -67,8 +70,8 @@ namespace eka2l1::loader {
         return last_dir_found;
     }
 
-    std::optional<loader::rom_entry> rom::burn_tree_find_entry(const std::string &vir_path) {
-        loader::rom_dir *last_dir_found = burn_tree_find_dir(eka2l1::file_directory(vir_path, true));
+    static std::optional<loader::rom_entry> walk_tree_find_entry(rom &romf, const std::string &vir_path) {
+        loader::rom_dir *last_dir_found = walk_tree_find_dir(romf, eka2l1::file_directory(vir_path, true));
 
         if (!last_dir_found) {
             return std::nullopt;
@@ -87,6 +90,100 @@ namespace eka2l1::loader {
         return std::nullopt;
     }
 
+    // Drop the drive, lowercase, and collapse separators into a single backslash
+    static std::u16string make_index_key(const std::u16string &vir_path) {
+        std::u16string key;
+        key.reserve(vir_path.size());
+
+        std::size_t pos = 0;
+
+        while ((pos < vir_path.size()) && !eka2l1::is_separator(vir_path[pos])) {
+            pos++;
+        }
+
+        for (; pos < vir_path.size(); pos++) {
+            if (eka2l1::is_separator(vir_path[pos])) {
+                if (!key.empty() && (key.back() != u'\\')) {
+                    key.push_back(u'\\');
+                }
+
+                continue;
+            }
+
+            key.push_back(static_cast<char16_t>(std::towlower(vir_path[pos])));
+        }
+
+        if (!key.empty() && (key.back() == u'\\')) {
+            key.pop_back();
+        }
+
+        return key;
+    }
+
+    static void index_rom_dir(rom_index &index, rom_dir &dir, const std::u16string &prefix) {
+        for (auto &entry : dir.entries) {
+            if (!entry.dir) {
+                index.files.emplace(prefix + common::lowercase_ucs2_string(entry.name), &entry);
+            }
+        }
+
+        for (auto &subdir : dir.subdirs) {
+            const std::u16string key = prefix + common::lowercase_ucs2_string(subdir.name);
+
+            index.dirs.emplace(key, &subdir);
+            index_rom_dir(index, subdir, key + u'\\');
+        }
+    }
+
+    void rom::build_index() {
+        index.clear();
+
+        if (root.root_dirs.empty()) {
+            return;
+        }
+
+        index_rom_dir(index, root.root_dirs[0].dir, u"");
+    }
+
+    loader::rom_dir *rom::burn_tree_find_dir(const std::u16string &vir_path) {
+        if (index.empty()) {
+            return walk_tree_find_dir(*this, common::ucs2_to_utf8(vir_path));
+        }
+
+        auto ite = index.dirs.find(make_index_key(vir_path));
+        return (ite == index.dirs.end()) ? nullptr : ite->second;
+    }
+
+    loader::rom_dir *rom::burn_tree_find_dir(const std::string &vir_path) {
+        if (index.empty()) {
+            return walk_tree_find_dir(*this, vir_path);
+        }
+
+        return burn_tree_find_dir(common::utf8_to_ucs2(vir_path));
+    }
+
+    std::optional<loader::rom_entry> rom::burn_tree_find_entry(const std::u16string &vir_path) {
+        if (index.empty()) {
+            return walk_tree_find_entry(*this, common::ucs2_to_utf8(vir_path));
+        }
+
+        auto ite = index.files.find(make_index_key(vir_path));
+
+        if (ite == index.files.end()) {
+            return std::nullopt;
+        }
+
+        return *ite->second;
+    }
+
+    std::optional<loader::rom_entry> rom::burn_tree_find_entry(const std::string &vir_path) {
+        if (index.empty()) {
+            return walk_tree_find_entry(*this, vir_path);
+        }
+
+        return burn_tree_find_entry(common::utf8_to_ucs2(vir_path));
+    }
+
     uint32_t rom_to_offset(address romstart, address off) {
         return off - romstart;
     }
@@ -274,15 +371,185 @@ namespace eka2l1::loader {
         return list;
     }
 
-    std::optional<rom> load_rom(common::ro_stream *stream) {
+    static constexpr std::uint32_t ROM_INDEX_MAGIC = 0x58444952; // RIDX
+    static constexpr std::uint32_t ROM_INDEX_VERSION = 1;
+    static constexpr std::uint32_t MAX_INDEX_DIR_ENTRIES = 0xFFFF * 2;
+
+    struct rom_index_header {
+        std::uint32_t magic;
+        std::uint32_t version;
+        address rom_base;
+        std::uint32_t rom_size;
+        address rom_root_dir_list;
+        std::uint32_t checksum;
+        std::int64_t time;
+        std::uint32_t time_high;
+        std::uint32_t num_root_dirs;
+    };
+
+    // Compared as raw bytes, there must be no padding
+    static_assert(sizeof(rom_index_header) == 40);
+
+    static rom_index_header make_rom_index_header(const rom &romf) {
+        rom_index_header header;
+        header.magic = ROM_INDEX_MAGIC;
+        header.version = ROM_INDEX_VERSION;
+        header.rom_base = romf.header.rom_base;
+        header.rom_size = romf.header.rom_size;
+        header.rom_root_dir_list = romf.header.rom_root_dir_list;
+        header.checksum = romf.header.checksum;
+        header.time = romf.header.eka2_diff0.time;
+        header.time_high = romf.header.eka2_diff0.time_high;
+        header.num_root_dirs = static_cast<std::uint32_t>(romf.root.root_dirs.size());
+
+        return header;
+    }
+
+    // Entries are written in their sorted order, each directory entry followed by its directory.
+    static bool write_index_dir(common::wo_stream *stream, const rom_dir &dir) {
+        const std::uint32_t entry_count = static_cast<std::uint32_t>(dir.entries.size());
+
+        if ((stream->write(&dir.size, 4) != 4) || (stream->write(&entry_count, 4) != 4)) {
+            return false;
+        }
+
+        for (const auto &entry : dir.entries) {
+            const std::uint8_t has_dir = entry.dir ? 1 : 0;
+            const std::uint64_t name_size = entry.name.size() * sizeof(char16_t);
+
+            if ((stream->write(&entry.size, 4) != 4) || (stream->write(&entry.address_lin, 4) != 4)
+                || (stream->write(&entry.attrib, 1) != 1) || (stream->write(&entry.name_len, 1) != 1)
+                || (stream->write(&has_dir, 1) != 1) || (stream->write(entry.name.data(), name_size) != name_size)) {
+                return false;
+            }
+
+            if (entry.dir && !write_index_dir(stream, entry.dir.value())) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    static bool read_index_dir(common::ro_stream *stream, rom_dir &dir) {
+        std::uint32_t entry_count = 0;
+
+        if ((stream->read(&dir.size, 4) != 4) || (stream->read(&entry_count, 4) != 4)) {
+            return false;
+        }
+
+        // The ROM stores file and subdirectory counts of a directory in 16 bits each
+        if (entry_count > MAX_INDEX_DIR_ENTRIES) {
+            return false;
+        }
+
+        dir.entries.resize(entry_count);
+
+        for (auto &entry : dir.entries) {
+            std::uint8_t has_dir = 0;
+
+            if ((stream->read(&entry.size, 4) != 4) || (stream->read(&entry.address_lin, 4) != 4)
+                || (stream->read(&entry.attrib, 1) != 1) || (stream->read(&entry.name_len, 1) != 1)
+                || (stream->read(&has_dir, 1) != 1)) {
+                return false;
+            }
+
+            entry.name.resize(entry.name_len);
+
+            if (stream->read(entry.name.data(), entry.name_len * sizeof(char16_t)) != entry.name_len * sizeof(char16_t)) {
+                return false;
+            }
+
+            if (has_dir) {
+                entry.dir = std::make_optional<rom_dir>();
+
+                if (!read_index_dir(stream, entry.dir.value())) {
+                    return false;
+                }
+
+                entry.dir->name = entry.name;
+
+                // Entries are sorted, so subdirectories are pushed in sorted order too
+                dir.subdirs.push_back(entry.dir.value());
+            }
+        }
+
+        return true;
+    }
+
+    bool rom::save_index(common::wo_stream *stream) {
+        const rom_index_header index_header = make_rom_index_header(*this);
+
+        if (stream->write(&index_header, sizeof(index_header)) != sizeof(index_header)) {
+            return false;
+        }
+
+        for (const auto &root_dir : root.root_dirs) {
+            if ((stream->write(&root_dir.hardware_variant, 4) != 4) || (stream->write(&root_dir.addr_lin, 4) != 4)) {
+                return false;
+            }
+
+            if (!write_index_dir(stream, root_dir.dir)) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    bool rom::load_index(common::ro_stream *stream) {
+        rom_index_header expected_header = make_rom_index_header(*this);
+        rom_index_header index_header;
+
+        if (stream->read(&index_header, sizeof(index_header)) != sizeof(index_header)) {
+            return false;
+        }
+
+        // The root directory count comes from the index, the rest must match the ROM
+        expected_header.num_root_dirs = index_header.num_root_dirs;
+
+        if (std::memcmp(&expected_header, &index_header, sizeof(index_header)) != 0) {
+            return false;
+        }
+
+        root_dir_list restored_root;
+        restored_root.num_root_dirs = static_cast<int>(index_header.num_root_dirs);
+
+        for (std::uint32_t i = 0; i < index_header.num_root_dirs; i++) {
+            root_dir rdir;
+
+            if ((stream->read(&rdir.hardware_variant, 4) != 4) || (stream->read(&rdir.addr_lin, 4) != 4)) {
+                return false;
+            }
+
+            if (!read_index_dir(stream, rdir.dir)) {
+                return false;
+            }
+
+            restored_root.root_dirs.push_back(std::move(rdir));
+        }
+
+        root = std::move(restored_root);
+        build_index();
+
+        index.restored = true;
+        return true;
+    }
+
+    std::optional<rom> load_rom(common::ro_stream *stream, common::ro_stream *index_stream) {
         rom romf;
         romf.header = read_rom_header(stream);
 
+        if (index_stream && romf.load_index(index_stream)) {
+            return romf;
+        }
+
         // Seek to the first entry
         stream->seek(rom_to_offset(romf.header.rom_base, romf.header.rom_root_dir_list),
             common::seek_where::beg);
 
         romf.root = read_root_dir_list(romf, stream);
+        romf.build_index();
 
         return romf;
     }
@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2022 EKA2L1 Team.
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <mem/common.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+namespace eka2l1::mem {
+    /**
+     * @brief Track guest pages that the CPU has fetched code from.
+     *
+     * The translated code caches of our CPU backends are keyed by virtual address, so this
+     * tracker is too. A page is marked the first time code is read from it, and unmarked
+     * when its translation is invalidated. This allows unmaps and self-modifying writes
+     * to only invalidate pages that really have translated code, instead of flushing whole
+     * chunks or the whole cache.
+     *
+     * Cores running on other host threads mark and invalidate pages at the same time, so the
+     * bitmap and the counters are atomic.
+     */
+    class code_page_tracker {
+    public:
+        using invalidate_func = std::function<void(const vm_address, const std::size_t)>;
+
+    private:
+        std::unique_ptr<std::atomic<std::uint64_t>[]> bits_;
+        std::size_t word_count_;
+        std::uint32_t page_bits_;
+
+        std::atomic<std::size_t> marked_count_;
+        std::atomic<std::uint64_t> total_marked_;
+        std::atomic<std::uint64_t> total_invalidated_;
+
+        std::size_t invalidate_pages(const std::uint64_t page_start, const std::uint64_t page_end, invalidate_func callback,
+            const bool unmark);
+
+    public:
+        explicit code_page_tracker(const std::uint32_t page_bits);
+
+        /**
+         * @brief Mark the page containing the given address as holding translated code.
+         * @returns True if the page was not marked before.
+         */
+        bool mark(const vm_address addr);
+
+        bool is_marked(const vm_address addr) const {
+            const std::uint32_t page_index = addr >> page_bits_;
+            return bits_[page_index >> 6].load(std::memory_order_acquire) & (1ULL << (page_index & 63));
+        }
+
+        /**
+         * @brief Unmark all code pages in the given range, and report each contiguous run of them.
+         *
+         * @param addr          Start address of the range. Rounded down to page boundary.
+         * @param size          Size of the range in bytes.
+         * @param callback      Callback receiving the address and size of each run of code pages.
+         *
+         * @returns Number of pages that were unmarked.
+         */
+        std::size_t invalidate(const vm_address addr, const std::size_t size, invalidate_func callback);
+
+        /**
+         * @brief Report each contiguous run of code pages in the given range, keeping them marked.
+         *
+         * Used when the translations must go, but the pages may still hold code of another
+         * address space at the same virtual address.
+         *
+         * @returns Number of code pages in the range.
+         */
+        std::size_t for_each_marked_run(const vm_address addr, const std::size_t size, invalidate_func callback);
+
+        /**
+         * @brief Unmark every code page, reporting each contiguous run of them.
+         * @returns Number of pages that were unmarked.
+         */
+        std::size_t invalidate_all(invalidate_func callback);
+
+        std::size_t marked_count() const {
+            return marked_count_.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Get the number of times a page has been marked since creation.
+         *
+         * Every mark following an invalidation means the page has been retranslated, so
+         * comparing this against marked_count() measures retranslation volume.
+         */
+        std::uint64_t total_marked() const {
+            return total_marked_.load(std::memory_order_relaxed);
+        }
+
+        std::uint64_t total_invalidated() const {
+            return total_invalidated_.load(std::memory_order_relaxed);
+        }
+    };
+}
@@ -21,11 +21,15 @@
 
 #include <common/atomic.h>
 
+#include <mem/codetrack.h>
 #include <mem/common.h>
+#include <mem/mmu.h>
 #include <mem/page.h>
 
+#include <functional>
 #include <memory>
 #include <optional>
+#include <vector>
 
 namespace eka2l1 {
     namespace config {
@@ -47,6 +51,7 @@ namespace eka2l1::mem {
         MMU_ASSIGN_GLOBAL = 1 << 1
     };
 
+    class fastmem_arena;
     class mmu_base;
 
     class control_base {
@@ -55,6 +60,33 @@ namespace eka2l1::mem {
         config::state *conf_;
 
         arm::exclusive_monitor *exclusive_monitor_;
+        code_page_tracker code_tracker_;
+
+        bool fastmem_;
+
+        template <typename T>
+        static bool exclusive_read_callback(void *userdata, arm::core *cc, const address addr, T *data);
+
+        template <typename T>
+        static std::int32_t exclusive_write_callback(void *userdata, arm::core *cc, const address addr, T value, T expected);
+
+        /**
+         * \brief Run a function on the fastmem region of every MMU that has one.
+         */
+        void for_each_fastmem_arena(const std::function<void(fastmem_arena *)> &func);
+
+        /**
+         * \brief Run a function on every MMU managed by this controller.
+         */
+        virtual void for_each_mmu(const std::function<void(mmu_base *)> &func) = 0;
+
+        /**
+         * \brief Run a function on every CPU core that has an MMU managed by this controller.
+         *
+         * Cores that are running guest code on other host threads run it before they continue. Fastmem
+         * regions are remapped right away, outside of this.
+         */
+        void for_each_core(const mmu_base::maintenance_func &func);
 
     public:
         std::size_t page_size_bits_; ///< The number of bits of page size.
@@ -129,6 +161,80 @@ namespace eka2l1::mem {
             return static_cast<std::int32_t>(common::atomic_compare_and_swap<T>(real_ptr, value, expected));
         }
 
+        const code_page_tracker &code_tracker() const {
+            return code_tracker_;
+        }
+
+        /**
+         * \brief Mark the page at the given address as containing translated code.
+         *
+         * The first time a page is marked, its entry is dropped from every core's TLB, so that
+         * the next fill is done without write permission and guest writes to it are caught.
+         */
+        void track_code_page(const vm_address addr);
+
+        bool is_code_page(const vm_address addr) const {
+            return code_tracker_.is_marked(addr);
+        }
+
+        /**
+         * \brief Invalidate translated code of all tracked pages in the given range, on all cores.
+         *
+         * Pages in the range that no core has fetched code from are not touched.
+         *
+         * \param keep_marks Keep the pages tracked. Use it for ranges that are local to an address space,
+         *                   when other address spaces may have code at the same addresses.
+         */
+        void invalidate_code_range(const vm_address addr, const std::size_t size, const bool keep_marks = false);
+
+        /**
+         * \brief Invalidate translated code of every tracked page, on all cores.
+         */
+        void invalidate_all_code();
+
+        /**
+         * \brief Drop TLB entries of all pages in the given range, on all cores.
+         *
+         * Cores keep TLB entries of address spaces that are not running, so a page that is unmapped
+         * must be dropped from every core, not only from the ones that currently run its address space.
+         */
+        void invalidate_tlb_range(const vm_address addr, const std::size_t size);
+
+        /**
+         * \brief Drop TLB entries kept for an address space ID on all cores, before the ID is reused.
+         */
+        void flush_tlb_asid(const asid id);
+
+        /**
+         * \brief Reserve host memory to back guest pages with.
+         *
+         * With fastmem on, pages of this memory can be mirrored into the fastmem region of
+         * any address space.
+         */
+        void *reserve_host_memory(const std::size_t size);
+
+        bool fastmem_enabled() const {
+            return fastmem_;
+        }
+
+        /**
+         * \brief Check if an address is mapped to the same page in all address spaces.
+         *
+         * Fastmem regions keep such pages mirrored when the core switches address space.
+         */
+        virtual bool is_global_address(const vm_address addr) const {
+            return false;
+        }
+
+        /**
+         * \brief Get the permission a TLB entry should be filled with for the given page.
+         *
+         * Code pages are filled without write permission, so writes go through the slow path.
+         */
+        prot tlb_permission(const vm_address addr, const prot perm) const {
+            return is_code_page(addr) ? static_cast<prot>(perm & ~prot_write) : perm;
+        }
+
         /**
          * \brief Create a new page table.
          * 
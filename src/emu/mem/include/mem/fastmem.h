@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2022 EKA2L1 Team.
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <common/types.h>
+#include <mem/common.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+namespace eka2l1::mem {
+    /**
+     * @brief A host region where each guest address of the running address space lives at base + address.
+     *
+     * Each core has one. Guest pages are mirrored into the region as they are mapped to the CPU, so JIT
+     * code can load and store to them directly. Pages that are not mirrored stay inaccessible: an access
+     * to them faults, the CPU backend handles it through the memory callbacks, and the MMU mirrors the
+     * page for the next time.
+     *
+     * Pages shared by all address spaces stay when the core switches to another one. The others are
+     * dropped with unmirror_local.
+     */
+    class fastmem_arena {
+        std::uint8_t *base_;
+        std::size_t host_page_size_;
+
+        std::mutex local_lock_;
+        std::uint64_t local_start_; ///< Start of the range that holds all local pages mirrored.
+        std::uint64_t local_end_;
+
+    public:
+        static constexpr std::uint64_t ARENA_SIZE = 1ULL << 32;
+
+        explicit fastmem_arena();
+        ~fastmem_arena();
+
+        fastmem_arena(const fastmem_arena &) = delete;
+        fastmem_arena &operator=(const fastmem_arena &) = delete;
+
+        bool valid() const {
+            return base_ != nullptr;
+        }
+
+        std::uint8_t *base() const {
+            return base_;
+        }
+
+        /**
+         * @brief Show host pages at the given guest address range.
+         *
+         * @param addr      Guest address of the range. Must be host page aligned.
+         * @param size      Size of the range.
+         * @param host      Host memory backing the range, allocated by common::map_mirrorable_memory.
+         * @param perm      Protection the JIT sees the pages with.
+         * @param shared    True if the range is mapped the same way in all address spaces.
+         *
+         * @returns True on success.
+         */
+        bool mirror(const vm_address addr, const std::size_t size, void *host, const prot perm, const bool shared = false);
+
+        /**
+         * @brief Make a guest address range inaccessible again.
+         */
+        void unmirror(const vm_address addr, const std::size_t size);
+
+        /**
+         * @brief Make all pages not mirrored as shared inaccessible, before another address space runs.
+         */
+        void unmirror_local();
+
+        /**
+         * @brief Make the whole region inaccessible.
+         */
+        void unmirror_all();
+    };
+}
@@ -20,13 +20,16 @@
 #pragma once
 
 #include <common/atomic.h>
+#include <cpu/arm_interface.h>
 
 #include <mem/page.h>
-#include <memory>
 
-namespace eka2l1::arm {
-    class core;
-}
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 namespace eka2l1::config {
     struct state;
@@ -34,16 +37,101 @@ namespace eka2l1::config {
 
 namespace eka2l1::mem {
     class control_base;
+    class fastmem_arena;
 
     /**
      * \brief The base of memory management unit.
      */
     class mmu_base {
+    public:
+        using maintenance_func = std::function<void(arm::core *)>;
+
+    private:
+        // TLB and translation cache work asked for by other host threads, while the core runs guest code
+        std::mutex maintenance_lock_;
+        std::vector<maintenance_func> pending_maintenance_;
+        std::atomic<bool> has_pending_maintenance_;
+        bool maintenance_overflowed_;
+
+        // The host thread that runs the core. Unset until the core first runs.
+        std::atomic<std::thread::id> runner_;
+
     protected:
         friend class control_base;
 
         control_base *manager_;
 
+        std::unique_ptr<fastmem_arena> fastmem_; ///< Null if fastmem is off.
+        asid fastmem_asid_; ///< The address space whose local pages are mirrored in the fastmem region.
+
+        template <typename T>
+        bool read_data(page_info *inf, const vm_address addr, T *data);
+
+        template <typename T>
+        bool write_data(page_info *inf, const vm_address addr, T *data);
+
+        bool read_code_data(page_info *inf, const vm_address addr, std::uint32_t *data);
+
+        template <typename MMU, typename T>
+        static bool read_callback(void *userdata, const address addr, T *data) {
+            MMU *self = static_cast<MMU *>(userdata);
+            return self->read_data(self->lookup_page_info(addr), addr, data);
+        }
+
+        template <typename MMU, typename T>
+        static bool write_callback(void *userdata, const address addr, T *data) {
+            MMU *self = static_cast<MMU *>(userdata);
+            return self->write_data(self->lookup_page_info(addr), addr, data);
+        }
+
+        template <typename MMU>
+        static bool read_code_callback(void *userdata, const address addr, std::uint32_t *data) {
+            MMU *self = static_cast<MMU *>(userdata);
+            return self->read_code_data(self->lookup_page_info(addr), addr, data);
+        }
+
+        template <typename MMU, typename T>
+        static std::int32_t write_exclusive_callback(void *userdata, const address addr, T value, T expected) {
+            MMU *self = static_cast<MMU *>(userdata);
+            page_info *inf = self->lookup_page_info(addr);
+
+            if (!inf || !inf->host_addr) {
+                return -1;
+            }
+
+            return self->write_exclusive_host(reinterpret_cast<std::uint8_t *>(inf->host_addr) + (addr & self->page_offset_mask()),
+                addr, value, expected);
+        }
+
+        /**
+         * \brief Bind memory callbacks of the CPU to this MMU.
+         *
+         * Each callback becomes a direct call into the page lookup of the given memory model, with
+         * no allocation or type erasure on the way.
+         *
+         * \param self The MMU, as the most derived type that provides lookup_page_info.
+         */
+        template <typename MMU>
+        void bind_cpu_callbacks(MMU *self) {
+            cpu_->read_8bit.bind(read_callback<MMU, std::uint8_t>, self);
+            cpu_->read_16bit.bind(read_callback<MMU, std::uint16_t>, self);
+            cpu_->read_32bit.bind(read_callback<MMU, std::uint32_t>, self);
+            cpu_->read_64bit.bind(read_callback<MMU, std::uint64_t>, self);
+            cpu_->read_code.bind(read_code_callback<MMU>, self);
+
+            cpu_->write_8bit.bind(write_callback<MMU, std::uint8_t>, self);
+            cpu_->write_16bit.bind(write_callback<MMU, std::uint16_t>, self);
+            cpu_->write_32bit.bind(write_callback<MMU, std::uint32_t>, self);
+            cpu_->write_64bit.bind(write_callback<MMU, std::uint64_t>, self);
+
+            cpu_->exclusive_write_8bit.bind(write_exclusive_callback<MMU, std::uint8_t>, self);
+            cpu_->exclusive_write_16bit.bind(write_exclusive_callback<MMU, std::uint16_t>, self);
+            cpu_->exclusive_write_32bit.bind(write_exclusive_callback<MMU, std::uint32_t>, self);
+            cpu_->exclusive_write_64bit.bind(write_exclusive_callback<MMU, std::uint64_t>, self);
+        }
+
+        std::uint32_t page_offset_mask() const;
+
         bool read_8bit_data(const vm_address addr, std::uint8_t *data);
         bool read_16bit_data(const vm_address addr, std::uint16_t *data);
         bool read_32bit_data(const vm_address addr, std::uint32_t *data);
@@ -56,35 +144,96 @@ namespace eka2l1::mem {
 
         bool read_code(const vm_address addr, std::uint32_t *data);
 
+        void fill_tlb_entry(const vm_address addr, page_info *inf);
+
+        /**
+         * \brief Drop local pages of the previous address space from the fastmem region.
+         *
+         * Memory models call this after they switch the current address space.
+         */
+        void switch_fastmem_space();
+
+        /**
+         * \brief Invalidate translated code of the page at given address, if there is any.
+         */
+        void notify_code_write(const vm_address addr);
+
     public:
         arm::core *cpu_;
         config::state *conf_;
 
     public:
         explicit mmu_base(control_base *manager, arm::core *cpu, config::state *conf);
-        virtual ~mmu_base() {}
+        virtual ~mmu_base();
+
+        /**
+         * \brief Do TLB or translation cache work on the core of this MMU.
+         *
+         * The backends are not thread safe, so the core is only touched by the host thread that runs it.
+         * Other threads queue the work and interrupt the core, which does it before running guest code again.
+         */
+        void run_maintenance(const maintenance_func &func);
+
+        /**
+         * \brief Do the work queued by other host threads.
+         *
+         * Must be called by the host thread that runs the core, before each run. The caller becomes the
+         * thread that the core belongs to.
+         */
+        void apply_pending_maintenance();
 
         void map_to_cpu(const vm_address addr, const std::size_t size, void *ptr, const prot perm);
         void unmap_from_cpu(const vm_address addr, const std::size_t size);
 
+        /**
+         * \brief Get the host region that mirrors the current address space for the JIT.
+         *
+         * The region stays the same for the life of the MMU.
+         *
+         * \returns Nullptr if fastmem is off.
+         */
+        std::uint8_t *fastmem_base();
+
+        /**
+         * \brief Drop local pages from the fastmem region, if they belong to the given address space.
+         */
+        void drop_fastmem_space(const asid id);
+
         /**
          * \brief Get host pointer of a virtual address, in the specified address space.
          */
         virtual void *get_host_pointer(const vm_address addr) = 0;
         virtual page_info *get_page_info(const vm_address addr) = 0;
 
+        /**
+         * \brief Get page info of a virtual address, as seen by the CPU.
+         *
+         * Memory models hide this with a non-virtual version, used by the CPU callbacks.
+         */
+        page_info *lookup_page_info(const vm_address addr);
+
         /**
          * @brief   Execute an exclusive write.
          * @returns -1 on invalid address, 0 on write failure, 1 on success.
          */
         template <typename T>
         std::int32_t write_exclusive(const address addr, T value, T expected) {
-            auto *real_ptr = reinterpret_cast<volatile T *>(get_host_pointer(addr));
+            return write_exclusive_host(get_host_pointer(addr), addr, value, expected);
+        }
+
+        /**
+         * @brief   Execute an exclusive write, on an already translated address.
+         * @returns -1 on invalid address, 0 on write failure, 1 on success.
+         */
+        template <typename T>
+        std::int32_t write_exclusive_host(void *host_ptr, const address addr, T value, T expected) {
+            auto *real_ptr = reinterpret_cast<volatile T *>(host_ptr);
 
             if (!real_ptr) {
                 return -1;
             }
 
+            notify_code_write(addr);
             return static_cast<std::int32_t>(common::atomic_compare_and_swap<T>(real_ptr, value, expected));
         }
 
@@ -29,6 +29,17 @@
 #include <memory>
 
 namespace eka2l1::mem::flexible {
+    /**
+     * \brief Check if an address is mapped the same way in all processes, by the kernel directory.
+     */
+    inline bool is_address_all_visible_for_all_processes(const vm_address addr, const bool mem_map_old) {
+        if (!mem_map_old) {
+            return (((addr >= ram_code_addr) && (addr < dll_static_data_flexible)) || (addr >= rom));
+        }
+
+        return (((addr >= ram_code_addr_eka1) && (addr < ram_code_addr_eka1_end)) || (addr >= rom_eka1));
+    }
+
     struct control_flexible : public control_base {
     private:
         friend struct mmu_flexible;
@@ -47,6 +58,9 @@ namespace eka2l1::mem::flexible {
 
         std::vector<std::unique_ptr<mmu_flexible>> mmus_;
 
+    protected:
+        void for_each_mmu(const std::function<void(mmu_base *)> &func) override;
+
     public:
         explicit control_flexible(arm::exclusive_monitor *monitor, page_table_allocator *alloc, config::state *conf, std::size_t psize_bits = 10, const bool mem_map_old = false);
         ~control_flexible() override;
@@ -64,6 +78,10 @@ namespace eka2l1::mem::flexible {
 
         page_info *get_page_info(const asid id, const vm_address addr) override;
 
+        bool is_global_address(const vm_address addr) const override {
+            return is_address_all_visible_for_all_processes(addr, mem_map_old_);
+        }
+
         /**
          * \brief Create or renew an address space if possible.
          * 
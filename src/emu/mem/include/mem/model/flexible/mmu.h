@@ -24,6 +24,9 @@
 namespace eka2l1::mem::flexible {
     struct mmu_flexible : public mmu_base {
         page_directory *cur_dir_;
+        page_directory *kern_dir_;
+
+        bool mem_map_old_;
 
     public:
         explicit mmu_flexible(control_base *manager, arm::core *cpu, config::state *conf);
@@ -31,6 +34,8 @@ namespace eka2l1::mem::flexible {
         void *get_host_pointer(const vm_address addr) override;
         page_info *get_page_info(const vm_address addr) override;
 
+        page_info *lookup_page_info(const vm_address addr);
+
         const asid current_addr_space() const override;
         bool set_current_addr_space(const asid id) override;
     };
@@ -24,6 +24,21 @@
 #include <vector>
 
 namespace eka2l1::mem {
+    /**
+     * \brief Check if an address is served by the global page directory, for all processes.
+     */
+    inline bool should_addr_from_global(const vm_address addr, const bool mem_map_old) {
+        bool should_from_global = false;
+
+        if (mem_map_old) {
+            should_from_global = ((addr >= shared_data_eka1) && (addr <= kern_mapping_eka1_end)) || (addr >= dll_static_data_eka1_end);
+        } else {
+            should_from_global = ((addr >= shared_data) && (addr < dll_static_data_flexible)) || (addr >= rom);
+        }
+
+        return should_from_global;
+    }
+
     class control_multiple : public control_base {
     private:
         friend struct multiple_mem_model_process;
@@ -42,6 +57,9 @@ namespace eka2l1::mem {
 
         std::vector<std::unique_ptr<mmu_multiple>> mmus_;
 
+    protected:
+        void for_each_mmu(const std::function<void(mmu_base *)> &func) override;
+
     public:
         explicit control_multiple(arm::exclusive_monitor *monitor, page_table_allocator *alloc, config::state *conf, std::size_t psize_bits = 10, const bool mem_map_old = false);
         ~control_multiple() override;
@@ -59,6 +77,10 @@ namespace eka2l1::mem {
 
         page_info *get_page_info(const asid id, const vm_address addr) override;
 
+        bool is_global_address(const vm_address addr) const override {
+            return should_addr_from_global(addr, mem_map_old_);
+        }
+
         /**
          * \brief Create or renew an address space if possible.
          * 
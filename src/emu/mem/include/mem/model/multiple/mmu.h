@@ -31,6 +31,9 @@ namespace eka2l1::mem {
     class mmu_multiple : public mmu_base {
     protected:
         page_directory *cur_dir_;
+        page_directory *global_dir_;
+
+        bool mem_map_old_;
 
     public:
         explicit mmu_multiple(control_base *manager, arm::core *cpu, config::state *conf);
@@ -39,6 +42,8 @@ namespace eka2l1::mem {
         void *get_host_pointer(const vm_address addr) override;
         page_info *get_page_info(const vm_address addr) override;
 
+        page_info *lookup_page_info(const vm_address addr);
+
         const asid current_addr_space() const override;
         bool set_current_addr_space(const asid id) override;
 
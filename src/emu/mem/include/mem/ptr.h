@@ -21,6 +21,7 @@
 
 #include <cstdint>
 #include <memory>
+#include <type_traits>
 
 #include <common/chunkyseri.h>
 #include <mem/mem.h>
@@ -39,7 +40,15 @@ namespace eka2l1 {
     // Symbian is 32 bit
     using address = uint32_t;
 
-    void *get_raw_pointer(kernel::process *pr, address addr);
+    /**
+     * @brief Get the host pointer of a guest address, with the given number of bytes from it readable.
+     */
+    void *get_raw_pointer(kernel::process *pr, address addr, const std::size_t size);
+
+    /**
+     * @brief Make a host range of a process's memory readable, when only its host pointer is known.
+     */
+    void fill_raw_host_range(kernel::process *pr, const void *host, const std::size_t size);
 
     template <typename T>
     class ptr {
@@ -57,7 +66,18 @@ namespace eka2l1 {
         }
 
         T *get(kernel::process *pr) const {
-            return reinterpret_cast<T *>(get_raw_pointer(pr, mem_address));
+            if constexpr (std::is_void_v<T>) {
+                return get_raw_pointer(pr, mem_address, 1);
+            } else {
+                return reinterpret_cast<T *>(get_raw_pointer(pr, mem_address, sizeof(T)));
+            }
+        }
+
+        /**
+         * @brief Get the host pointer, with the given number of bytes from it readable.
+         */
+        T *get(kernel::process *pr, const std::size_t size) const {
+            return reinterpret_cast<T *>(get_raw_pointer(pr, mem_address, size));
         }
 
         T *get(memory_system *mem, const mem::asid optional_asid = -1) const {
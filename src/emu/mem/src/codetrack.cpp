@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) 2022 EKA2L1 Team.
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <mem/codetrack.h>
+
+#include <algorithm>
+
+namespace eka2l1::mem {
+    code_page_tracker::code_page_tracker(const std::uint32_t page_bits)
+        : page_bits_(page_bits)
+        , marked_count_(0)
+        , total_marked_(0)
+        , total_invalidated_(0) {
+        const std::uint64_t total_pages = 1ULL << (32 - page_bits);
+        word_count_ = static_cast<std::size_t>((total_pages + 63) >> 6);
+
+        // Value initialized, so every page starts unmarked
+        bits_ = std::make_unique<std::atomic<std::uint64_t>[]>(word_count_);
+    }
+
+    bool code_page_tracker::mark(const vm_address addr) {
+        const std::uint32_t page_index = addr >> page_bits_;
+        std::atomic<std::uint64_t> &word = bits_[page_index >> 6];
+        const std::uint64_t mask = 1ULL << (page_index & 63);
+
+        // Most fetches land on pages that are already marked, keep them to a load
+        if (word.load(std::memory_order_acquire) & mask) {
+            return false;
+        }
+
+        // Another core may mark the same page meanwhile, only one of them gets to drop the TLB entries
+        if (word.fetch_or(mask, std::memory_order_acq_rel) & mask) {
+            return false;
+        }
+
+        marked_count_.fetch_add(1, std::memory_order_relaxed);
+        total_marked_.fetch_add(1, std::memory_order_relaxed);
+
+        return true;
+    }
+
+    std::size_t code_page_tracker::invalidate_pages(const std::uint64_t page_start, const std::uint64_t page_end, invalidate_func callback,
+        const bool unmark) {
+        std::size_t total_unmarked = 0;
+
+        std::uint64_t run_start = 0;
+        std::uint64_t run_count = 0;
+
+        auto flush_run = [&]() {
+            if (run_count && callback) {
+                callback(static_cast<vm_address>(run_start << page_bits_), static_cast<std::size_t>(run_count << page_bits_));
+            }
+
+            run_count = 0;
+        };
+
+        for (std::uint64_t page = page_start; page < page_end;) {
+            std::atomic<std::uint64_t> &word = bits_[page >> 6];
+            const std::uint64_t word_value = word.load(std::memory_order_acquire);
+
+            // Skip the whole word if nothing is marked there
+            if ((word_value == 0) && ((page & 63) == 0) && (page + 64 <= page_end)) {
+                flush_run();
+                page += 64;
+
+                continue;
+            }
+
+            const std::uint64_t mask = 1ULL << (page & 63);
+
+            bool marked = (word_value & mask) != 0;
+
+            // When unmarking, the page only counts if this call is the one that cleared it
+            if (marked && unmark) {
+                marked = (word.fetch_and(~mask, std::memory_order_acq_rel) & mask) != 0;
+            }
+
+            if (marked) {
+                if (!run_count) {
+                    run_start = page;
+                }
+
+                run_count++;
+                total_unmarked++;
+            } else {
+                flush_run();
+            }
+
+            page++;
+        }
+
+        flush_run();
+
+        if (unmark) {
+            marked_count_.fetch_sub(total_unmarked, std::memory_order_relaxed);
+            total_invalidated_.fetch_add(total_unmarked, std::memory_order_relaxed);
+        }
+
+        return total_unmarked;
+    }
+
+    std::size_t code_page_tracker::invalidate(const vm_address addr, const std::size_t size, invalidate_func callback) {
+        if (!marked_count() || !size) {
+            return 0;
+        }
+
+        const std::uint64_t page_size = 1ULL << page_bits_;
+        const std::uint64_t page_start = addr >> page_bits_;
+        const std::uint64_t page_end = std::min<std::uint64_t>((static_cast<std::uint64_t>(addr) + size + page_size - 1) >> page_bits_,
+            static_cast<std::uint64_t>(word_count_) << 6);
+
+        return invalidate_pages(page_start, page_end, callback, true);
+    }
+
+    std::size_t code_page_tracker::for_each_marked_run(const vm_address addr, const std::size_t size, invalidate_func callback) {
+        if (!marked_count() || !size) {
+            return 0;
+        }
+
+        const std::uint64_t page_size = 1ULL << page_bits_;
+        const std::uint64_t page_start = addr >> page_bits_;
+        const std::uint64_t page_end = std::min<std::uint64_t>((static_cast<std::uint64_t>(addr) + size + page_size - 1) >> page_bits_,
+            static_cast<std::uint64_t>(word_count_) << 6);
+
+        return invalidate_pages(page_start, page_end, callback, false);
+    }
+
+    std::size_t code_page_tracker::invalidate_all(invalidate_func callback) {
+        if (!marked_count()) {
+            return 0;
+        }
+
+        return invalidate_pages(0, static_cast<std::uint64_t>(word_count_) << 6, callback, true);
+    }
+}
@@ -17,22 +17,52 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <common/log.h>
+#include <common/virtualmem.h>
+#include <config/config.h>
 #include <cpu/arm_interface.h>
 
 #include <mem/control.h>
+#include <mem/fastmem.h>
 #include <mem/mmu.h>
 
 #include <mem/model/flexible/control.h>
 #include <mem/model/multiple/control.h>
 
 namespace eka2l1::mem {
+    // Above this number of pages, a range is dropped from the TLB by flushing it
+    static constexpr std::size_t TLB_INVALIDATE_PAGE_LIMIT = 4096;
+
+    template <typename T>
+    bool control_base::exclusive_read_callback(void *userdata, arm::core *cc, const address addr, T *data) {
+        mmu_base *mm = static_cast<control_base *>(userdata)->get_or_create_mmu(cc);
+
+        if constexpr (sizeof(T) == 1) {
+            return mm->read_8bit_data(addr, data);
+        } else if constexpr (sizeof(T) == 2) {
+            return mm->read_16bit_data(addr, data);
+        } else if constexpr (sizeof(T) == 4) {
+            return mm->read_32bit_data(addr, data);
+        } else {
+            return mm->read_64bit_data(addr, data);
+        }
+    }
+
+    template <typename T>
+    std::int32_t control_base::exclusive_write_callback(void *userdata, arm::core *cc, const address addr, T value, T expected) {
+        mmu_base *mm = static_cast<control_base *>(userdata)->get_or_create_mmu(cc);
+        return mm->write_exclusive<T>(addr, value, expected);
+    }
+
     control_base::control_base(arm::exclusive_monitor *monitor, page_table_allocator *alloc, config::state *conf,
         std::size_t psize_bits, const bool mem_map_old)
         : alloc_(alloc)
         , conf_(conf)
         , page_size_bits_(psize_bits)
         , mem_map_old_(mem_map_old)
-        , exclusive_monitor_(monitor) {
+        , exclusive_monitor_(monitor)
+        , code_tracker_(static_cast<std::uint32_t>(psize_bits))
+        , fastmem_(false) {
         if (psize_bits == 20) {
             offset_mask_ = OFFSET_MASK_20B;
             page_table_index_shift_ = PAGE_TABLE_INDEX_SHIFT_20B;
@@ -53,52 +83,134 @@ namespace eka2l1::mem {
             page_per_tab_shift_ = PAGE_PER_TABLE_SHIFT_12B;
         }
 
+        if (conf_ && conf_->fastmem) {
+            // Guest pages are mirrored whole, so they must not be smaller than host pages
+            if ((sizeof(void *) < 8) || !common::is_memory_mirroring_supported() || (static_cast<std::size_t>(common::get_host_page_size()) > page_size())) {
+                LOG_WARN(MEMORY, "Fastmem is not supported on this host, memory accesses will go through the TLB");
+            } else {
+                fastmem_ = true;
+            }
+        }
+
         if (exclusive_monitor_) {
-            exclusive_monitor_->read_8bit = [this](arm::core *core, const vm_address addr, std::uint8_t *data) {
-                mmu_base *mm = get_or_create_mmu(core);
-                return mm->read_8bit_data(addr, data);
-            };
-
-            exclusive_monitor_->read_16bit = [this](arm::core *core, const vm_address addr, std::uint16_t *data) {
-                mmu_base *mm = get_or_create_mmu(core);
-                return mm->read_16bit_data(addr, data);
-            };
-
-            exclusive_monitor_->read_32bit = [this](arm::core *core, const vm_address addr, std::uint32_t *data) {
-                mmu_base *mm = get_or_create_mmu(core);
-                return mm->read_32bit_data(addr, data);
-            };
-
-            exclusive_monitor_->read_64bit = [this](arm::core *core, const vm_address addr, std::uint64_t *data) {
-                mmu_base *mm = get_or_create_mmu(core);
-                return mm->read_64bit_data(addr, data);
-            };
-
-            exclusive_monitor_->write_8bit = [this](arm::core *core, const vm_address addr, std::uint8_t value, std::uint8_t expected) {
-                mmu_base *mm = get_or_create_mmu(core);
-                return mm->write_exclusive<std::uint8_t>(addr, value, expected);
-            };
-
-            exclusive_monitor_->write_16bit = [this](arm::core *core, const vm_address addr, std::uint16_t value, std::uint16_t expected) {
-                mmu_base *mm = get_or_create_mmu(core);
-                return mm->write_exclusive<std::uint16_t>(addr, value, expected);
-            };
-
-            exclusive_monitor_->write_32bit = [this](arm::core *core, const vm_address addr, std::uint32_t value, std::uint32_t expected) {
-                mmu_base *mm = get_or_create_mmu(core);
-                return mm->write_exclusive<std::uint32_t>(addr, value, expected);
-            };
-
-            exclusive_monitor_->write_64bit = [this](arm::core *core, const vm_address addr, std::uint64_t value, std::uint64_t expected) {
-                mmu_base *mm = get_or_create_mmu(core);
-                return mm->write_exclusive<std::uint64_t>(addr, value, expected);
-            };
+            exclusive_monitor_->read_8bit.bind(exclusive_read_callback<std::uint8_t>, this);
+            exclusive_monitor_->read_16bit.bind(exclusive_read_callback<std::uint16_t>, this);
+            exclusive_monitor_->read_32bit.bind(exclusive_read_callback<std::uint32_t>, this);
+            exclusive_monitor_->read_64bit.bind(exclusive_read_callback<std::uint64_t>, this);
+
+            exclusive_monitor_->write_8bit.bind(exclusive_write_callback<std::uint8_t>, this);
+            exclusive_monitor_->write_16bit.bind(exclusive_write_callback<std::uint16_t>, this);
+            exclusive_monitor_->write_32bit.bind(exclusive_write_callback<std::uint32_t>, this);
+            exclusive_monitor_->write_64bit.bind(exclusive_write_callback<std::uint64_t>, this);
         }
     }
 
     control_base::~control_base() {
     }
 
+    void *control_base::reserve_host_memory(const std::size_t size) {
+        return fastmem_ ? common::map_mirrorable_memory(size) : common::map_memory(size);
+    }
+
+    void control_base::for_each_fastmem_arena(const std::function<void(fastmem_arena *)> &func) {
+        if (!fastmem_) {
+            return;
+        }
+
+        for_each_mmu([&func](mmu_base *mmu) {
+            if (mmu->fastmem_) {
+                func(mmu->fastmem_.get());
+            }
+        });
+    }
+
+    void control_base::for_each_core(const mmu_base::maintenance_func &func) {
+        for_each_mmu([&func](mmu_base *mmu) {
+            mmu->run_maintenance(func);
+        });
+    }
+
+    void control_base::track_code_page(const vm_address addr) {
+        if (!code_tracker_.mark(addr)) {
+            return;
+        }
+
+        // The page may already sit writable in some TLBs. Drop those entries so the next fill
+        // write-protects it.
+        const vm_address page_addr = addr & ~offset_mask_;
+
+        for_each_core([page_addr](arm::core *cc) {
+            cc->dirty_tlb_page(page_addr);
+        });
+
+        // Same for the fastmem mirrors, which JIT code writes to without asking
+        for_each_fastmem_arena([this, page_addr](fastmem_arena *arena) {
+            arena->unmirror(page_addr, page_size());
+        });
+    }
+
+    void control_base::invalidate_code_range(const vm_address addr, const std::size_t size, const bool keep_marks) {
+        auto invalidate_run = [this](const vm_address run_addr, const std::size_t run_size) {
+            for_each_core([run_addr, run_size](arm::core *cc) {
+                cc->imb_range(run_addr, run_size);
+            });
+        };
+
+        if (keep_marks) {
+            code_tracker_.for_each_marked_run(addr, size, invalidate_run);
+        } else {
+            code_tracker_.invalidate(addr, size, invalidate_run);
+        }
+    }
+
+    void control_base::invalidate_all_code() {
+        const std::size_t total_pages = code_tracker_.invalidate_all([this](const vm_address run_addr, const std::size_t run_size) {
+            for_each_core([run_addr, run_size](arm::core *cc) {
+                cc->imb_range(run_addr, run_size);
+            });
+        });
+
+        if (total_pages) {
+            LOG_TRACE(MEMORY, "Invalidated {} code pages, {} pages translated since boot", total_pages,
+                code_tracker_.total_marked());
+        }
+    }
+
+    void control_base::invalidate_tlb_range(const vm_address addr, const std::size_t size) {
+        const vm_address start_addr = addr & ~offset_mask_;
+        const std::size_t total_pages = (size + (addr - start_addr) + offset_mask_) >> page_size_bits_;
+
+        for_each_fastmem_arena([start_addr, total_pages, this](fastmem_arena *arena) {
+            arena->unmirror(start_addr, total_pages << page_size_bits_);
+        });
+
+        if (total_pages > TLB_INVALIDATE_PAGE_LIMIT) {
+            // Cheaper to start over than to walk the whole range
+            for_each_core([](arm::core *cc) {
+                cc->flush_tlb();
+            });
+
+            return;
+        }
+
+        for_each_core([start_addr, total_pages, this](arm::core *cc) {
+            for (std::size_t i = 0; i < total_pages; i++) {
+                cc->dirty_tlb_page(static_cast<vm_address>(start_addr + (i << page_size_bits_)));
+            }
+        });
+    }
+
+    void control_base::flush_tlb_asid(const asid id) {
+        for_each_core([id](arm::core *cc) {
+            cc->flush_tlb_asid(id);
+        });
+
+        // Pages of the old address space may still be mirrored on the cores that ran it last
+        for_each_mmu([id](mmu_base *mmu) {
+            mmu->drop_fastmem_space(id);
+        });
+    }
+
     page_table *control_base::create_new_page_table() {
         return alloc_->create_new(page_size_bits_);
     }
@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2022 EKA2L1 Team.
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <common/log.h>
+#include <common/virtualmem.h>
+#include <mem/fastmem.h>
+
+#include <algorithm>
+
+namespace eka2l1::mem {
+    fastmem_arena::fastmem_arena()
+        : base_(nullptr)
+        , host_page_size_(common::get_host_page_size())
+        , local_start_(ARENA_SIZE)
+        , local_end_(0) {
+        if (sizeof(void *) < 8) {
+            return;
+        }
+
+        base_ = reinterpret_cast<std::uint8_t *>(common::map_memory(static_cast<std::size_t>(ARENA_SIZE)));
+
+        if (!base_) {
+            LOG_WARN(MEMORY, "Unable to reserve host region for fastmem");
+        }
+    }
+
+    fastmem_arena::~fastmem_arena() {
+        if (base_) {
+            common::unmap_memory(base_, static_cast<std::size_t>(ARENA_SIZE));
+        }
+    }
+
+    bool fastmem_arena::mirror(const vm_address addr, const std::size_t size, void *host, const prot perm, const bool shared) {
+        if (!base_ || !host || ((addr | size) & (host_page_size_ - 1))) {
+            return false;
+        }
+
+        if (!shared) {
+            const std::lock_guard<std::mutex> guard(local_lock_);
+
+            local_start_ = std::min<std::uint64_t>(local_start_, addr);
+            local_end_ = std::max<std::uint64_t>(local_end_, static_cast<std::uint64_t>(addr) + size);
+        }
+
+        return common::mirror_memory(base_ + addr, host, size, perm);
+    }
+
+    void fastmem_arena::unmirror(const vm_address addr, const std::size_t size) {
+        if (!base_) {
+            return;
+        }
+
+        // Keep whole host pages that the range only partly covers inaccessible too
+        const std::uint64_t start = addr & ~static_cast<std::uint64_t>(host_page_size_ - 1);
+        const std::uint64_t end = std::min<std::uint64_t>((static_cast<std::uint64_t>(addr) + size + host_page_size_ - 1) & ~static_cast<std::uint64_t>(host_page_size_ - 1),
+            ARENA_SIZE);
+
+        if (start < end) {
+            common::unmirror_memory(base_ + start, static_cast<std::size_t>(end - start));
+        }
+    }
+
+    void fastmem_arena::unmirror_local() {
+        std::uint64_t start = 0;
+        std::uint64_t end = 0;
+
+        {
+            const std::lock_guard<std::mutex> guard(local_lock_);
+
+            start = local_start_;
+            end = local_end_;
+
+            local_start_ = ARENA_SIZE;
+            local_end_ = 0;
+        }
+
+        // One call for the whole range. Shared pages caught in it come back on their next access.
+        if (start < end) {
+            unmirror(static_cast<vm_address>(start), static_cast<std::size_t>(end - start));
+        }
+    }
+
+    void fastmem_arena::unmirror_all() {
+        if (base_) {
+            common::unmirror_memory(base_, static_cast<std::size_t>(ARENA_SIZE));
+
+            const std::lock_guard<std::mutex> guard(local_lock_);
+
+            local_start_ = ARENA_SIZE;
+            local_end_ = 0;
+        }
+    }
+}
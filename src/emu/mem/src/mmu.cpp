@@ -21,230 +21,256 @@
 #include <config/config.h>
 #include <cpu/arm_interface.h>
 #include <mem/control.h>
+#include <mem/fastmem.h>
 #include <mem/mmu.h>
 
 #include <mem/model/flexible/mmu.h>
 #include <mem/model/multiple/mmu.h>
 
 namespace eka2l1::mem {
+    // Past this, the queued work is replaced by dropping the whole TLB and translation cache
+    static constexpr std::size_t MAX_PENDING_MAINTENANCE = 256;
+
     mmu_base::mmu_base(control_base *manager, arm::core *cpu, config::state *conf)
-        : manager_(manager)
+        : has_pending_maintenance_(false)
+        , maintenance_overflowed_(false)
+        , manager_(manager)
+        , fastmem_asid_(-1)
         , cpu_(cpu)
         , conf_(conf) {
-        // Set CPU read/write functions
-        cpu->read_8bit = [this](const vm_address addr, std::uint8_t *data) { return read_8bit_data(addr, data); };
-        cpu->read_16bit = [this](const vm_address addr, std::uint16_t *data) { return read_16bit_data(addr, data); };
-        cpu->read_32bit = [this](const vm_address addr, std::uint32_t *data) { return read_32bit_data(addr, data); };
-        cpu->read_64bit = [this](const vm_address addr, std::uint64_t *data) { return read_64bit_data(addr, data); };
-        cpu->read_code = [this](const vm_address addr, std::uint32_t *data) { return read_code(addr, data); };
-
-        cpu->write_8bit = [this](const vm_address addr, std::uint8_t *data) { return write_8bit_data(addr, data); };
-        cpu->write_16bit = [this](const vm_address addr, std::uint16_t *data) { return write_16bit_data(addr, data); };
-        cpu->write_32bit = [this](const vm_address addr, std::uint32_t *data) { return write_32bit_data(addr, data); };
-        cpu->write_64bit = [this](const vm_address addr, std::uint64_t *data) { return write_64bit_data(addr, data); };
-
-        cpu->exclusive_write_8bit = [this](const vm_address addr, std::uint8_t value, std::uint8_t expected) {
-            return write_exclusive<std::uint8_t>(addr, value, expected);
-        };
-
-        cpu->exclusive_write_16bit = [this](const vm_address addr, std::uint16_t value, std::uint16_t expected) {
-            return write_exclusive<std::uint16_t>(addr, value, expected);
-        };
+        // Memory models bind their own page lookup later. This one works for any of them.
+        bind_cpu_callbacks(this);
 
-        cpu->exclusive_write_32bit = [this](const vm_address addr, std::uint32_t value, std::uint32_t expected) {
-            return write_exclusive<std::uint32_t>(addr, value, expected);
-        };
+        if (manager_->fastmem_enabled()) {
+            fastmem_ = std::make_unique<fastmem_arena>();
 
-        cpu->exclusive_write_64bit = [this](const vm_address addr, std::uint64_t value, std::uint64_t expected) {
-            return write_exclusive<std::uint64_t>(addr, value, expected);
-        };
+            if (!fastmem_->valid()) {
+                fastmem_.reset();
+            }
+        }
     }
 
-    void mmu_base::map_to_cpu(const vm_address addr, const std::size_t size, void *ptr, const prot perm) {
-        //cpu_->map_backing_mem(addr, size, reinterpret_cast<std::uint8_t *>(ptr), perm);
+    mmu_base::~mmu_base() {
     }
 
-    void mmu_base::unmap_from_cpu(const vm_address addr, const std::size_t size) {
-        const std::uint32_t psize = manager_->page_size();
-        vm_address addr_temp = addr;
+    void mmu_base::run_maintenance(const maintenance_func &func) {
+        const std::thread::id runner = runner_.load(std::memory_order_acquire);
 
-        for (std::size_t i = 0; i < size / psize; i++) {
-            cpu_->dirty_tlb_page(addr_temp);
-            addr_temp += psize;
+        // Also the case for the core's own memory callbacks, which run in the middle of guest code
+        if ((runner == std::thread::id()) || (runner == std::this_thread::get_id())) {
+            func(cpu_);
+            return;
         }
-    }
-
-    /// ================== MISCS ====================
 
-    bool mmu_base::read_8bit_data(const vm_address addr, std::uint8_t *data) {
-        page_info *inf = manager_->get_page_info(current_addr_space(), addr);
-        if (!inf || !inf->host_addr) {
-            return false;
-        }
+        {
+            const std::lock_guard<std::mutex> guard(maintenance_lock_);
 
-        std::uint8_t *ptr = reinterpret_cast<std::uint8_t *>(inf->host_addr) + (addr & manager_->offset_mask_);
+            if (!maintenance_overflowed_) {
+                if (pending_maintenance_.size() < MAX_PENDING_MAINTENANCE) {
+                    pending_maintenance_.push_back(func);
+                } else {
+                    pending_maintenance_.clear();
+                    pending_maintenance_.push_back([](arm::core *cc) {
+                        cc->flush_tlb();
+                        cc->clear_instruction_cache();
+                    });
 
-        *data = *ptr;
+                    maintenance_overflowed_ = true;
+                }
+            }
 
-        if (conf_->log_read) {
-            LOG_TRACE(MEMORY, "Read 1 byte from address 0x{:X}", addr);
+            has_pending_maintenance_.store(true, std::memory_order_release);
         }
 
-        cpu_->set_tlb_page(addr & ~manager_->offset_mask_, reinterpret_cast<std::uint8_t *>(inf->host_addr),
-            inf->perm);
-
-        return true;
+        // Get the core out of guest code, so the work is done before it runs what was invalidated
+        cpu_->stop();
     }
 
-    bool mmu_base::read_16bit_data(const vm_address addr, std::uint16_t *data) {
-        page_info *inf = manager_->get_page_info(current_addr_space(), addr);
-        if (!inf || !inf->host_addr) {
-            return false;
+    void mmu_base::apply_pending_maintenance() {
+        runner_.store(std::this_thread::get_id(), std::memory_order_release);
+
+        if (!has_pending_maintenance_.load(std::memory_order_acquire)) {
+            return;
         }
 
-        std::uint16_t *ptr = reinterpret_cast<std::uint16_t *>(reinterpret_cast<std::uint8_t *>(inf->host_addr) + (addr & manager_->offset_mask_));
+        std::vector<maintenance_func> pending;
 
-        *data = *ptr;
+        {
+            const std::lock_guard<std::mutex> guard(maintenance_lock_);
 
-        if (conf_->log_read) {
-            LOG_TRACE(MEMORY, "Read 2 bytes from address 0x{:X}", addr);
+            pending.swap(pending_maintenance_);
+            has_pending_maintenance_.store(false, std::memory_order_relaxed);
+            maintenance_overflowed_ = false;
         }
 
-        cpu_->set_tlb_page(addr & ~manager_->offset_mask_, reinterpret_cast<std::uint8_t *>(inf->host_addr),
-            inf->perm);
+        for (const maintenance_func &func : pending) {
+            func(cpu_);
+        }
+    }
 
-        return true;
+    page_info *mmu_base::lookup_page_info(const vm_address addr) {
+        return manager_->get_page_info(current_addr_space(), addr);
     }
 
-    bool mmu_base::read_32bit_data(const vm_address addr, std::uint32_t *data) {
-        page_info *inf = manager_->get_page_info(current_addr_space(), addr);
-        if (!inf || !inf->host_addr) {
-            return false;
+    std::uint32_t mmu_base::page_offset_mask() const {
+        return manager_->offset_mask_;
+    }
+
+    void mmu_base::map_to_cpu(const vm_address addr, const std::size_t size, void *ptr, const prot perm) {
+        // Freshly committed pages have no translated code yet, they can be mirrored as they are
+        if (fastmem_) {
+            fastmem_->mirror(addr, size, ptr, perm, manager_->is_global_address(addr));
         }
+    }
 
-        std::uint32_t *ptr = reinterpret_cast<std::uint32_t *>(reinterpret_cast<std::uint8_t *>(inf->host_addr) + (addr & manager_->offset_mask_));
+    void mmu_base::unmap_from_cpu(const vm_address addr, const std::size_t size) {
+        const std::uint32_t psize = manager_->page_size();
+        vm_address addr_temp = addr;
 
-        *data = *ptr;
+        for (std::size_t i = 0; i < size / psize; i++) {
+            cpu_->dirty_tlb_page(addr_temp);
+            addr_temp += psize;
+        }
 
-        if (conf_->log_read) {
-            LOG_TRACE(MEMORY, "Read 4 bytes from address 0x{:X}", addr);
+        if (fastmem_) {
+            fastmem_->unmirror(addr, size);
         }
+    }
 
-        cpu_->set_tlb_page(addr & ~manager_->offset_mask_, reinterpret_cast<std::uint8_t *>(inf->host_addr),
-            inf->perm);
+    std::uint8_t *mmu_base::fastmem_base() {
+        return fastmem_ ? fastmem_->base() : nullptr;
+    }
 
-        return true;
+    void mmu_base::switch_fastmem_space() {
+        const asid id = current_addr_space();
+
+        if (fastmem_ && (id != fastmem_asid_)) {
+            fastmem_->unmirror_local();
+        }
+
+        fastmem_asid_ = id;
     }
 
-    bool mmu_base::read_64bit_data(const vm_address addr, std::uint64_t *data) {
-        page_info *inf = manager_->get_page_info(current_addr_space(), addr);
-        if (!inf || !inf->host_addr) {
-            return false;
+    void mmu_base::drop_fastmem_space(const asid id) {
+        if (fastmem_ && (id == fastmem_asid_)) {
+            fastmem_->unmirror_local();
         }
+    }
 
-        std::uint64_t *ptr = reinterpret_cast<std::uint64_t *>(reinterpret_cast<std::uint8_t *>(inf->host_addr) + (addr & manager_->offset_mask_));
+    void mmu_base::fill_tlb_entry(const vm_address addr, page_info *inf) {
+        const vm_address page_addr = addr & ~manager_->offset_mask_;
+        const prot perm = manager_->tlb_permission(addr, inf->perm);
 
-        *data = *ptr;
+        cpu_->set_tlb_page(page_addr, reinterpret_cast<std::uint8_t *>(inf->host_addr), perm);
 
-        if (conf_->log_read) {
-            LOG_TRACE(MEMORY, "Read 8 bytes from address 0x{:X}", addr);
+        // Fastmem only misses on pages not mirrored yet, so the next access to this one does not
+        if (fastmem_) {
+            fastmem_->mirror(page_addr, manager_->page_size(), inf->host_addr, perm, manager_->is_global_address(page_addr));
         }
+    }
 
-        cpu_->set_tlb_page(addr & ~manager_->offset_mask_, reinterpret_cast<std::uint8_t *>(inf->host_addr),
-            inf->perm);
-
-        return true;
+    void mmu_base::notify_code_write(const vm_address addr) {
+        if (manager_->is_code_page(addr)) {
+            // Self-modifying code. Only drop translations of this page.
+            manager_->invalidate_code_range(addr & ~manager_->offset_mask_, manager_->page_size());
+        }
     }
 
-    bool mmu_base::write_8bit_data(const vm_address addr, std::uint8_t *data) {
-        page_info *inf = manager_->get_page_info(current_addr_space(), addr);
+    /// ================== MISCS ====================
+
+    template <typename T>
+    bool mmu_base::read_data(page_info *inf, const vm_address addr, T *data) {
         if (!inf || !inf->host_addr) {
             return false;
         }
 
-        std::uint8_t *ptr = reinterpret_cast<std::uint8_t *>(inf->host_addr) + (addr & manager_->offset_mask_);
+        const T *ptr = reinterpret_cast<const T *>(reinterpret_cast<std::uint8_t *>(inf->host_addr) + (addr & manager_->offset_mask_));
 
-        *ptr = *data;
+        *data = *ptr;
 
-        if (conf_->log_write) {
-            LOG_TRACE(MEMORY, "Write 1 byte to address 0x{:X}", addr);
+        if (conf_->log_read) {
+            LOG_TRACE(MEMORY, "Read {} bytes from address 0x{:X}", sizeof(T), addr);
         }
 
-        cpu_->set_tlb_page(addr & ~manager_->offset_mask_, reinterpret_cast<std::uint8_t *>(inf->host_addr),
-            inf->perm);
+        fill_tlb_entry(addr, inf);
 
         return true;
     }
 
-    bool mmu_base::write_16bit_data(const vm_address addr, std::uint16_t *data) {
-        page_info *inf = manager_->get_page_info(current_addr_space(), addr);
+    template <typename T>
+    bool mmu_base::write_data(page_info *inf, const vm_address addr, T *data) {
         if (!inf || !inf->host_addr) {
             return false;
         }
 
-        std::uint16_t *ptr = reinterpret_cast<std::uint16_t *>(reinterpret_cast<std::uint8_t *>(inf->host_addr) + (addr & manager_->offset_mask_));
+        T *ptr = reinterpret_cast<T *>(reinterpret_cast<std::uint8_t *>(inf->host_addr) + (addr & manager_->offset_mask_));
 
+        notify_code_write(addr);
         *ptr = *data;
 
         if (conf_->log_write) {
-            LOG_TRACE(MEMORY, "Write 2 bytes to address 0x{:X}", addr);
+            LOG_TRACE(MEMORY, "Write {} bytes to address 0x{:X}", sizeof(T), addr);
         }
 
-        cpu_->set_tlb_page(addr & ~manager_->offset_mask_, reinterpret_cast<std::uint8_t *>(inf->host_addr),
-            inf->perm);
+        fill_tlb_entry(addr, inf);
 
         return true;
     }
 
-    bool mmu_base::write_32bit_data(const vm_address addr, std::uint32_t *data) {
-        page_info *inf = manager_->get_page_info(current_addr_space(), addr);
-        if (!inf || !inf->host_addr) {
-            return false;
-        }
+    template bool mmu_base::read_data<std::uint8_t>(page_info *inf, const vm_address addr, std::uint8_t *data);
+    template bool mmu_base::read_data<std::uint16_t>(page_info *inf, const vm_address addr, std::uint16_t *data);
+    template bool mmu_base::read_data<std::uint32_t>(page_info *inf, const vm_address addr, std::uint32_t *data);
+    template bool mmu_base::read_data<std::uint64_t>(page_info *inf, const vm_address addr, std::uint64_t *data);
 
-        std::uint32_t *ptr = reinterpret_cast<std::uint32_t *>(reinterpret_cast<std::uint8_t *>(inf->host_addr) + (addr & manager_->offset_mask_));
+    template bool mmu_base::write_data<std::uint8_t>(page_info *inf, const vm_address addr, std::uint8_t *data);
+    template bool mmu_base::write_data<std::uint16_t>(page_info *inf, const vm_address addr, std::uint16_t *data);
+    template bool mmu_base::write_data<std::uint32_t>(page_info *inf, const vm_address addr, std::uint32_t *data);
+    template bool mmu_base::write_data<std::uint64_t>(page_info *inf, const vm_address addr, std::uint64_t *data);
 
-        *ptr = *data;
-
-        if (conf_->log_write) {
-            LOG_TRACE(MEMORY, "Write 4 bytes to address 0x{:X}", addr);
+    bool mmu_base::read_code_data(page_info *inf, const vm_address addr, std::uint32_t *data) {
+        if (!inf || !inf->host_addr) {
+            return false;
         }
 
-        cpu_->set_tlb_page(addr & ~manager_->offset_mask_, reinterpret_cast<std::uint8_t *>(inf->host_addr),
-            inf->perm);
+        manager_->track_code_page(addr);
 
+        *data = *reinterpret_cast<const std::uint32_t *>(reinterpret_cast<std::uint8_t *>(inf->host_addr) + (addr & manager_->offset_mask_));
         return true;
     }
 
-    bool mmu_base::write_64bit_data(const vm_address addr, std::uint64_t *data) {
-        page_info *inf = manager_->get_page_info(current_addr_space(), addr);
-        if (!inf || !inf->host_addr) {
-            return false;
-        }
+    bool mmu_base::read_8bit_data(const vm_address addr, std::uint8_t *data) {
+        return read_data(lookup_page_info(addr), addr, data);
+    }
 
-        std::uint64_t *ptr = reinterpret_cast<std::uint64_t *>(reinterpret_cast<std::uint8_t *>(inf->host_addr) + (addr & manager_->offset_mask_));
+    bool mmu_base::read_16bit_data(const vm_address addr, std::uint16_t *data) {
+        return read_data(lookup_page_info(addr), addr, data);
+    }
 
-        *ptr = *data;
+    bool mmu_base::read_32bit_data(const vm_address addr, std::uint32_t *data) {
+        return read_data(lookup_page_info(addr), addr, data);
+    }
 
-        if (conf_->log_write) {
-            LOG_TRACE(MEMORY, "Write 8 bytes to address 0x{:X}", addr);
-        }
+    bool mmu_base::read_64bit_data(const vm_address addr, std::uint64_t *data) {
+        return read_data(lookup_page_info(addr), addr, data);
+    }
 
-        cpu_->set_tlb_page(addr & ~manager_->offset_mask_, reinterpret_cast<std::uint8_t *>(inf->host_addr),
-            inf->perm);
+    bool mmu_base::write_8bit_data(const vm_address addr, std::uint8_t *data) {
+        return write_data(lookup_page_info(addr), addr, data);
+    }
 
-        return true;
+    bool mmu_base::write_16bit_data(const vm_address addr, std::uint16_t *data) {
+        return write_data(lookup_page_info(addr), addr, data);
     }
 
-    bool mmu_base::read_code(const vm_address addr, std::uint32_t *data) {
-        std::uint32_t *code = reinterpret_cast<std::uint32_t *>(manager_->get_host_pointer(
-            current_addr_space(), addr));
+    bool mmu_base::write_32bit_data(const vm_address addr, std::uint32_t *data) {
+        return write_data(lookup_page_info(addr), addr, data);
+    }
 
-        if (!code) {
-            return false;
-        }
+    bool mmu_base::write_64bit_data(const vm_address addr, std::uint64_t *data) {
+        return write_data(lookup_page_info(addr), addr, data);
+    }
 
-        *data = *code;
-        return true;
+    bool mmu_base::read_code(const vm_address addr, std::uint32_t *data) {
+        return read_code_data(lookup_page_info(addr), addr, data);
     }
 }
@@ -37,12 +37,9 @@ namespace eka2l1::mem::flexible {
     }
 
     flexible_mem_model_chunk::~flexible_mem_model_chunk() {
-        if (fixed_mapping_ && (flags_ & MEM_MODEL_CHUNK_REGION_USER_CODE)) {
-            control_flexible *control_mm = reinterpret_cast<control_flexible *>(control_);
-            for (auto &mmu : control_mm->mmus_) {
-                // Clear the instruction cache at that range, code may reuse it later
-                mmu->cpu_->imb_range(fixed_mapping_->base_, max_size_);
-            }
+        if (fixed_mapping_) {
+            // Clear translated code of pages in this range, code may reuse it later
+            control_->invalidate_code_range(fixed_mapping_->base_, max_size_);
         }
     }
 
@@ -40,6 +40,14 @@ namespace eka2l1::mem::flexible {
         chunk_mngr_.reset();
     }
 
+    void control_flexible::for_each_mmu(const std::function<void(mmu_base *)> &func) {
+        for (auto &inst : mmus_) {
+            if (inst) {
+                func(inst.get());
+            }
+        }
+    }
+
     mmu_base *control_flexible::get_or_create_mmu(arm::core *cc) {
         for (auto &inst : mmus_) {
             if (!inst) {
@@ -62,14 +70,6 @@ namespace eka2l1::mem::flexible {
         return mmus_.back().get();
     }
 
-    static inline address is_address_all_visible_for_all_processes(const vm_address addr, const bool mem_map_old) {
-        if (!mem_map_old) {
-            return (((addr >= ram_code_addr) && (addr < dll_static_data_flexible)) || (addr >= rom));
-        }
-
-        return (((addr >= ram_code_addr_eka1) && (addr < ram_code_addr_eka1_end)) || (addr >= rom_eka1));
-    }
-
     void *control_flexible::get_host_pointer(const asid id, const vm_address addr) {
         if ((id <= 0) || is_address_all_visible_for_all_processes(addr, mem_map_old_)) {
             // Directory của kernel
@@ -37,6 +37,9 @@ namespace eka2l1::mem::flexible {
                 dirs_[i]->occupied_ = true;
                 dirs_[i]->reset();
 
+                // Cores may still keep TLB entries of the previous owner
+                cntr->flush_tlb_asid(static_cast<asid>(i));
+
                 return dirs_[i].get();
             }
         }
@@ -36,7 +36,7 @@ namespace eka2l1::mem::flexible {
         if (data_) {
             external_ = true;
         } else {
-            data_ = common::map_memory(page_count * ctrl->page_size());
+            data_ = ctrl->reserve_host_memory(page_count * ctrl->page_size());
 
             if (!data_) {
                 LOG_ERROR(MEMORY, "Unable to allocate virtual memory for this memory object (page count = {})",
@@ -109,21 +109,16 @@ namespace eka2l1::mem::flexible {
             }
         }
 
-        control_flexible *ctrl_fx = reinterpret_cast<control_flexible *>(control_);
-
         // Unmap decomitted memory from all mappings
         for (auto &mapping : mappings_) {
             if (!mapping->unmap(page_offset, total_pages)) {
                 LOG_WARN(MEMORY, "Unable to unmap decommitted memory from a mapping!");
             }
 
-            for (auto &mm : ctrl_fx->mmus_) {
-                if (mapping->owner_->id() == mm->current_addr_space()) {
-                    // Unmap from to CPU right away
-                    mm->unmap_from_cpu(mapping->base_ + start_offset, size_to_decommit);
-                    break;
-                }
-            }
+            control_->invalidate_code_range(mapping->base_ + start_offset, size_to_decommit);
+
+            // Cores may still hold entries of the owner even when it is not running
+            control_->invalidate_tlb_range(mapping->base_ + start_offset, size_to_decommit);
         }
 
         page_arr_.alter(page_offset, static_cast<std::uint32_t>(total_pages), prot_none, true);
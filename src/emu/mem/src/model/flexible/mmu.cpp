@@ -24,10 +24,16 @@
 
 namespace eka2l1::mem::flexible {
     mmu_flexible::mmu_flexible(control_base *manager, arm::core *cpu, config::state *conf)
-        : mmu_base(manager, cpu, conf) {
+        : mmu_base(manager, cpu, conf)
+        , cur_dir_(nullptr)
+        , kern_dir_(nullptr)
+        , mem_map_old_(manager->using_old_mem_map()) {
         // Set kernel directory as the first one active
         control_flexible *ctrl_fx = reinterpret_cast<control_flexible *>(manager_);
+        kern_dir_ = ctrl_fx->kern_addr_space_->dir_;
+
         set_current_addr_space(ctrl_fx->kern_addr_space_->id());
+        bind_cpu_callbacks(this);
     }
 
     const asid mmu_flexible::current_addr_space() const {
@@ -45,6 +51,7 @@ namespace eka2l1::mem::flexible {
         }
 
         cur_dir_ = associated_dir;
+        switch_fastmem_space();
         return true;
     }
 
@@ -56,6 +63,15 @@ namespace eka2l1::mem::flexible {
         return cur_dir_->get_pointer(addr);
     }
 
+    page_info *mmu_flexible::lookup_page_info(const vm_address addr) {
+        // Same as what the controller does for the current address space, without the virtual calls
+        if (is_address_all_visible_for_all_processes(addr, mem_map_old_)) {
+            return kern_dir_->get_page_info(addr);
+        }
+
+        return cur_dir_->get_page_info(addr);
+    }
+
     page_info *mmu_flexible::get_page_info(const vm_address addr) {
         if (!cur_dir_) {
             return nullptr;
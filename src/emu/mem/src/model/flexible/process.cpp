@@ -141,8 +141,10 @@ namespace eka2l1::mem::flexible {
             return false;
         }
 
-        // Remove the mapping attached to this memory object
+        // Remove the mapping attached to this memory object. Translated code in it goes away with it.
         fl_chunk->mem_obj_->detach_mapping(chunk_ite->map_.get());
+        control_->invalidate_code_range(chunk_ite->map_->base_, fl_chunk->max_size_);
+        control_->invalidate_tlb_range(chunk_ite->map_->base_, fl_chunk->max_size_);
 
         attachs_.erase(chunk_ite);
         return true;
@@ -153,6 +155,8 @@ namespace eka2l1::mem::flexible {
 
         for (auto &attach: attachs_) {
             attach.chunk_->mem_obj_->detach_mapping(attach.map_.get());
+            control_->invalidate_code_range(attach.map_->base_, attach.chunk_->max_size_);
+
             fl_control->chunk_mngr_->destroy(reinterpret_cast<flexible_mem_model_chunk *>(attach.chunk_));
         }
     }
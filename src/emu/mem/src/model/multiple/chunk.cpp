@@ -174,9 +174,6 @@ namespace eka2l1::mem {
             const auto pt_base = (running_offset >> control_->chunk_shift_) << control_->chunk_shift_;
             const vm_address crr_base_addr = base_;
 
-            multiple_mem_model_process *mul_process = reinterpret_cast<multiple_mem_model_process *>(own_process_);
-            control_multiple *mul_ctrl = reinterpret_cast<control_multiple *>(control_);
-
             // Fill the entry
             for (int poff = ps_off; poff < ps_off + page_num; poff++) {
                 // If the entry has not yet been committed.
@@ -193,13 +190,8 @@ namespace eka2l1::mem {
                 } else {
                     // Map those just mapped to the CPU. It will love this
                     if (size_just_unmapped != 0) {
-                        // Use linear loop since the size is expected to be small
-                        for (auto &mm : mul_ctrl->mmus_) {
-                            if (!own_process_ || mul_process->addr_space_id_ == mm->current_addr_space()) {
-                                mm->unmap_from_cpu(off_start_just_unmapped, size_just_unmapped);
-                                break;
-                            }
-                        }
+                        control_->invalidate_code_range(off_start_just_unmapped, size_just_unmapped, is_local);
+                        control_->invalidate_tlb_range(off_start_just_unmapped, size_just_unmapped);
 
                         size_just_unmapped = 0;
                         off_start_just_unmapped = 0;
@@ -209,13 +201,11 @@ namespace eka2l1::mem {
 
             // Unmap the rest
             if (size_just_unmapped != 0) {
+                // Local addresses may hold code of other processes too, which must stay tracked
+                control_->invalidate_code_range(off_start_just_unmapped, size_just_unmapped, is_local);
+
                 //LOG_TRACE(MEMORY, "Unmapped from CPU: 0x{:X}, size 0x{:X}", off_start_just_unmapped, size_just_unmapped);
-                for (auto &mm : mul_ctrl->mmus_) {
-                    if (!own_process_ || mul_process->addr_space_id_ == mm->current_addr_space()) {
-                        mm->unmap_from_cpu(off_start_just_unmapped, size_just_unmapped);
-                        break;
-                    }
-                }
+                control_->invalidate_tlb_range(off_start_just_unmapped, size_just_unmapped);
             }
 
             // Decommit the memory from the host
@@ -355,7 +345,7 @@ namespace eka2l1::mem {
             host_base_ = create_info.host_map;
             is_external_host = true;
         } else {
-            host_base_ = common::map_memory(max_size_);
+            host_base_ = control_->reserve_host_memory(max_size_);
             is_external_host = false;
         }
 
@@ -389,7 +379,7 @@ namespace eka2l1::mem {
     }
 
     multiple_mem_model_chunk::~multiple_mem_model_chunk() {
-        // Decommit the whole things
+        // Decommit the whole things. This also drops translated code of the pages that had some.
         decommit(0, max_size_);
 
         // Free the region that previously allocated from the allocator
@@ -400,14 +390,6 @@ namespace eka2l1::mem {
                 sec->alloc_.deallocate((base_ - sec->beg_) >> control_->page_size_bits_, max_size_ >> control_->page_size_bits_);
         }
 
-        if (is_code) {
-            control_multiple *control_mm = reinterpret_cast<control_multiple *>(control_);
-            for (auto &mmu : control_mm->mmus_) {
-                // Clear the instruction cache at that range, code may reuse it later
-                mmu->cpu_->imb_range(base_, max_size_);
-            }
-        }
-
         // Ignore the result, just unmap things
         if (!is_external_host)
             common::unmap_memory(host_base_, max_size_);
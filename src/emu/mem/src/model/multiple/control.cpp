@@ -33,6 +33,14 @@ namespace eka2l1::mem {
     control_multiple::~control_multiple() {
     }
 
+    void control_multiple::for_each_mmu(const std::function<void(mmu_base *)> &func) {
+        for (auto &inst : mmus_) {
+            if (inst) {
+                func(inst.get());
+            }
+        }
+    }
+
     mmu_base *control_multiple::get_or_create_mmu(arm::core *cc) {
         for (auto &inst : mmus_) {
             if (!inst) {
@@ -60,6 +68,9 @@ namespace eka2l1::mem {
         for (std::size_t i = 0; i < dirs_.size(); i++) {
             if (!dirs_[i]->occupied()) {
                 dirs_[i]->occupied_ = true;
+
+                // Cores may still keep TLB entries of the previous owner
+                flush_tlb_asid(dirs_[i]->id());
                 return dirs_[i]->id();
             }
         }
@@ -120,18 +131,6 @@ namespace eka2l1::mem {
         }
     }
 
-    inline bool should_addr_from_global(const vm_address addr, const bool mem_map_old) {
-        bool should_from_global = false;
-
-        if (mem_map_old) {
-            should_from_global = ((addr >= shared_data_eka1) && (addr <= kern_mapping_eka1_end)) || (addr >= dll_static_data_eka1_end);
-        } else {
-            should_from_global = ((addr >= shared_data) && (addr < dll_static_data_flexible)) || (addr >= rom);
-        }
-
-        return should_from_global;
-    }
-
     void *control_multiple::get_host_pointer(const asid id, const vm_address addr) {
         if ((id > 0) && (dirs_.size() < id)) {
             return nullptr;
@@ -24,8 +24,13 @@
 namespace eka2l1::mem {
     mmu_multiple::mmu_multiple(control_base *manager, arm::core *cpu, config::state *conf)
         : mmu_base(manager, cpu, conf)
-        , cur_dir_(nullptr) {
-        cur_dir_ = &(reinterpret_cast<control_multiple *>(manager)->global_dir_);
+        , cur_dir_(nullptr)
+        , global_dir_(nullptr)
+        , mem_map_old_(manager->using_old_mem_map()) {
+        global_dir_ = &(reinterpret_cast<control_multiple *>(manager)->global_dir_);
+        cur_dir_ = global_dir_;
+
+        bind_cpu_callbacks(this);
     }
 
     bool mmu_multiple::set_current_addr_space(const asid id) {
@@ -33,6 +38,7 @@ namespace eka2l1::mem {
 
         if (id == 0) {
             cur_dir_ = &ctrl_mul->global_dir_;
+            switch_fastmem_space();
             return true;
         }
 
@@ -41,6 +47,7 @@ namespace eka2l1::mem {
         }
 
         cur_dir_ = ctrl_mul->dirs_[id - 1].get();
+        switch_fastmem_space();
         return true;
     }
 
@@ -64,6 +71,15 @@ namespace eka2l1::mem {
         return cur_dir_->get_pointer(addr);
     }
 
+    page_info *mmu_multiple::lookup_page_info(const vm_address addr) {
+        // Same as what the controller does for the current address space, without the virtual calls
+        if (should_addr_from_global(addr, mem_map_old_)) {
+            return global_dir_->get_page_info(addr);
+        }
+
+        return cur_dir_->get_page_info(addr);
+    }
+
     page_info *mmu_multiple::get_page_info(const vm_address addr) {
         if (!cur_dir_) {
             return nullptr;
@@ -140,6 +140,15 @@ namespace eka2l1::mem {
         // Remove it
         mul_chunk->attached_asids_.erase(result);
 
+        // Local chunk addresses are only valid in this address space, drop translated code there.
+        // Other processes may have their own code at these addresses, so keep the pages tracked.
+        if (mul_chunk->is_local) {
+            control_->invalidate_code_range(mul_chunk->base_, mul_chunk->max_size_, true);
+        }
+
+        // Its pages may still be in the TLB set that cores keep for this address space
+        control_->invalidate_tlb_range(mul_chunk->base_, mul_chunk->max_size_);
+
         // Unassign page tables
         for (std::size_t i = 0; i < mul_chunk->page_tabs_.size(); i++) {
             if (mul_chunk->page_tabs_[i] != 0xFFFFFFFF) {
@@ -27,6 +27,7 @@
 #include <mem/ptr.h>
 
 #include <cstring>
+#include <functional>
 #include <memory>
 #include <optional>
 #include <string>
@@ -35,11 +36,80 @@ namespace eka2l1 {
     class system;
 
     namespace epoc {
+        struct desc_base;
         struct security_info;
         struct security_policy;
     }
 
     namespace service {
+        /**
+         * \brief Host view of the data of a descriptor IPC argument.
+         */
+        struct descriptor_host_view {
+            epoc::desc_base *des_ = nullptr; ///< The descriptor, in host memory.
+            address data_address_ = 0; ///< Guest address of the descriptor data.
+            std::uint8_t *data_ = nullptr; ///< Host pointer to the descriptor data. Null if it's not mapped.
+
+            std::uint32_t length_ = 0; ///< Current length in bytes.
+            std::uint32_t max_length_ = 0; ///< Capacity in bytes.
+
+            /**
+             * Number of bytes from the start of the data that are mapped and contiguous in host memory,
+             * counted up to the size asked for on resolve.
+             */
+            std::uint32_t contiguous_length_ = 0;
+        };
+
+        /**
+         * \brief Callback getting a part of a descriptor's data in host memory.
+         * \returns Number of bytes handled in that part.
+         */
+        using descriptor_part_func = std::function<std::size_t(std::uint8_t *data, const std::size_t size)>;
+
+        /**
+         * \brief Callback translating a guest address to host memory. Returns null if it's not mapped.
+         */
+        using host_address_lookup_func = std::function<std::uint8_t *(const address addr)>;
+
+        /**
+         * \brief   Count the bytes from a guest address that are mapped and contiguous in host memory.
+         *
+         * \param   lookup     Translates guest addresses of the owning address space.
+         * \param   page_size  Page size of the memory model.
+         * \param   addr       The guest address.
+         * \param   host       Host pointer of the guest address.
+         * \param   size       Maximum number of bytes to count.
+         */
+        std::uint32_t host_contiguous_size(const host_address_lookup_func &lookup, const std::uint32_t page_size, const address addr,
+            const std::uint8_t *host, const std::uint32_t size);
+
+        /**
+         * \brief   Check if an IPC argument can be accessed as 8-bit descriptor data.
+         *
+         * 16-bit descriptors are rejected, since their lengths count characters instead of bytes.
+         */
+        bool is_byte_descriptor_argument(const ipc_arg_type arg_type, const bool is_eka1);
+
+        /**
+         * \brief   Fill the data of a resolved descriptor, in host-contiguous parts.
+         *
+         * The descriptor length is left untouched.
+         *
+         * \returns Number of bytes filled, or std::nullopt if the descriptor is constant.
+         * \sa      ipc_context::fill_descriptor_argument
+         */
+        std::optional<std::uint32_t> fill_descriptor_view(const host_address_lookup_func &lookup, const std::uint32_t page_size,
+            const descriptor_host_view &view, const std::uint32_t len, const descriptor_part_func &fill);
+
+        /**
+         * \brief   Hand the data of a resolved descriptor to a callback, in host-contiguous parts.
+         *
+         * \returns Number of bytes consumed.
+         * \sa      ipc_context::consume_descriptor_argument
+         */
+        std::uint32_t consume_descriptor_view(const host_address_lookup_func &lookup, const std::uint32_t page_size,
+            const descriptor_host_view &view, const std::uint32_t len, const descriptor_part_func &consume);
+
         /**
          * \brief Context struct, wrapping around IPC message object.
          * 
@@ -137,6 +207,50 @@ namespace eka2l1 {
             */
             std::uint8_t *get_descriptor_argument_ptr(int idx);
 
+            /**
+             * \brief   Resolve the host memory behind the data of an 8-bit descriptor argument.
+             * 
+             * The data is looked up through the memory model of the owning process, so the caller can
+             * tell how much of it can be accessed in place.
+             * 
+             * \param   idx         The index of the argument. Should be in the range [0, 3].
+             * \param   view        Receives the descriptor's host pointer, length and capacity.
+             * \param   check_size  Number of bytes to check for host contiguity. Clamped to the capacity.
+             * 
+             * \returns False if the index is out of range, or the IPC argument is not an 8-bit descriptor.
+             * 
+             * \sa      fill_descriptor_argument, consume_descriptor_argument
+             */
+            bool resolve_descriptor_argument(const int idx, descriptor_host_view &view, const std::uint32_t check_size = 0xFFFFFFFF);
+
+            /**
+             * \brief   Fill an 8-bit descriptor argument in place, then set its length to what was filled.
+             * 
+             * The callback writes straight into guest memory. If the data spans pages that are not contiguous
+             * in host memory, the callback is called once for each contiguous part, in order, and stops after
+             * a part that is not completely filled.
+             * 
+             * \param   idx   The index of the argument. Should be in the range [0, 3].
+             * \param   len   Number of bytes to fill. Clamped to the descriptor capacity.
+             * \param   fill  Callback writing to a part of the data.
+             * 
+             * \returns Number of bytes filled, or std::nullopt if the argument is not a modifiable descriptor.
+             */
+            std::optional<std::uint32_t> fill_descriptor_argument(const int idx, const std::uint32_t len, const descriptor_part_func &fill);
+
+            /**
+             * \brief   Hand the data of an 8-bit descriptor argument to a callback, without copying it.
+             * 
+             * Parts are handed over the same way as with fill_descriptor_argument.
+             * 
+             * \param   idx      The index of the argument. Should be in the range [0, 3].
+             * \param   len      Number of bytes to consume. Clamped to the descriptor length.
+             * \param   consume  Callback reading a part of the data.
+             * 
+             * \returns Number of bytes consumed, or std::nullopt if the argument is not a descriptor.
+             */
+            std::optional<std::uint32_t> consume_descriptor_argument(const int idx, const std::uint32_t len, const descriptor_part_func &consume);
+
             /**
              * \brief   Get the size of data stored in the IPC argument.
              * 
@@ -23,11 +23,17 @@
 #include <services/window/common.h>
 
 #include <deque>
+#include <list>
 #include <map>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
+namespace rbp {
+    class SkylineBinPack;
+}
+
 namespace eka2l1::drivers {
     class graphics_driver;
     class graphics_command_builder;
@@ -41,21 +47,53 @@ namespace eka2l1::epoc {
      * 
      * The atlas dimension is a square, and height is equals to font_size *
      * estimate_max_char_in_atlas.
+     * 
+     * Glyphs are rasterized on first use and placed by a skyline packer. When the atlas is full, it is
+     * rebuilt in a new bitmap with the glyphs used most recently, the rest are rasterized again when they
+     * are drawn. Only the region of the atlas that changed is uploaded.
      */
     struct font_atlas {
-        std::map<char16_t, adapter::character_info> characters_;
+        struct glyph_entry {
+            adapter::character_info info_;
+            std::list<char16_t>::iterator lru_ite_;
+
+            bool resident_ = false; ///< Bitmap is in the atlas, and x0 to y1 locate it.
+            bool queued_ = false;
+        };
+
+        // Metrics stay after a glyph is evicted, so layout never needs the bitmap
+        std::unordered_map<char16_t, glyph_entry> glyphs_;
+
+        // Resident glyphs, most recently used first
+        std::list<char16_t> lru_;
+
         drivers::handle atlas_handle_;
+
+        // Atlas replaced by compaction, destroyed after the draws already queued with it
+        drivers::handle retired_handle_;
+
         adapter::font_file_adapter_base *adapter_;
         std::uint32_t metric_identifier_;
         int size_;
 
-        std::vector<int> last_use_;
-
         std::pair<char16_t, char16_t> initial_range_;
         std::unique_ptr<std::uint8_t[]> atlas_data_;
+        std::unique_ptr<rbp::SkylineBinPack> packer_;
+
+        // Region of the atlas data that the driver has not received yet
+        eka2l1::rect dirty_;
 
         std::size_t typeface_idx_;
-        std::int32_t pack_handle_;
+
+        std::vector<int> to_rast_;
+        std::vector<eka2l1::rect> dest_rects_;
+        std::vector<eka2l1::rect> source_rects_;
+
+        bool rasterize(const std::size_t keep_count);
+        bool place_glyph(const char16_t code, glyph_entry &entry, const std::uint8_t *source, const int source_width);
+        void compact(const std::size_t keep_count);
+        void mark_dirty(const eka2l1::rect &region);
+        void upload(drivers::graphics_driver *driver, drivers::graphics_command_builder &builder);
 
     public:
         explicit font_atlas();
@@ -63,6 +101,8 @@ namespace eka2l1::epoc {
         explicit font_atlas(adapter::font_file_adapter_base *adapter, const std::size_t typeface_idx, const char16_t initial_start,
             const char16_t initial_char_count, const int font_size, const std::uint32_t metric_identifier_);
 
+        ~font_atlas();
+
         void init(adapter::font_file_adapter_base *adapter, const std::size_t typeface_idx, const char16_t initial_start,
             const char16_t initial_char_count, const int font_size, const std::uint32_t metric_identifier_);
 
@@ -75,6 +115,14 @@ namespace eka2l1::epoc {
             return draw_text(text, box, alignment, driver, builder, { scale_factor, scale_factor });
         }
 
+        /**
+         * \brief Draw a line of text with the brush color.
+         *
+         * Glyphs missing from the atlas are rasterized and uploaded first, through a separate command list.
+         * All glyphs of the text are then drawn by one batched command added to the given builder.
+         *
+         * \returns False if the glyphs could not be rasterized.
+         */
         bool draw_text(const std::u16string &text, const eka2l1::rect &box, const epoc::text_alignment alignment, drivers::graphics_driver *driver,
             drivers::graphics_command_builder &builder, const eka2l1::vec2f scale_vector);
 
@@ -82,4 +130,4 @@ namespace eka2l1::epoc {
             return size_;
         }
     };
-}
\ No newline at end of file
+}
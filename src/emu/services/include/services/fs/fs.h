@@ -23,6 +23,7 @@
 #include <kernel/server.h>
 #include <services/context.h>
 #include <services/framework.h>
+#include <services/fs/io_queue.h>
 #include <utils/des.h>
 
 #include <mem/ptr.h>
@@ -328,12 +329,16 @@ namespace eka2l1 {
         std::uint32_t flags;
         std::set<std::u16string> temporary_file_cleanset_;
 
+        std::unique_ptr<fs_io_queue> io_queue_;
+
         void init();
 
     public:
         explicit fs_server(system *sys);
         ~fs_server() override;
 
+        void finish_pending_requests() override;
+
         service::uid get_owner_secure_uid() const override {
             return 0x100039E3;
         }
@@ -347,5 +352,13 @@ namespace eka2l1 {
         symfile get_temp_file(const std::u16string &base_dir);
 
         fs_server_client *get_correspond_client(service::session *ss);
+
+        /**
+         * \brief Get the queue that runs slow operations on host threads.
+         * \returns Null if all operations run in place.
+         */
+        fs_io_queue *get_io_queue() {
+            return io_queue_.get();
+        }
     };
 }
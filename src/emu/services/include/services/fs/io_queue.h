@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2022 EKA2L1 Team.
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <kernel/common.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace eka2l1 {
+    class kernel_system;
+
+    namespace service {
+        struct ipc_context;
+    }
+
+    /**
+     * \brief Queue that runs slow file server operations on host worker threads.
+     *
+     * Each session is a strand: it has at most one operation in flight, and requests of the session that
+     * arrive meanwhile are deferred, then dispatched again in order once the operation finishes. Operations
+     * of different sessions run in parallel.
+     *
+     * The work of an operation runs without any lock, and should only touch host memory and the file it was
+     * given. Guest memory may be unmapped while the work runs, so data is staged in host buffers owned by the
+     * operation. Its finish step, where guest memory is updated and the request is completed, runs under the
+     * kernel lock, same as timer callbacks.
+     */
+    class fs_io_queue {
+    public:
+        using work_func = std::function<void()>;
+        using finish_func = std::function<void()>;
+        using deferred_func = std::function<void()>;
+
+    private:
+        struct operation {
+            kernel::uid session_;
+            work_func work_;
+            finish_func finish_;
+        };
+
+        struct strand {
+            bool busy_ = false;
+            std::deque<deferred_func> deferred_;
+        };
+
+        kernel_system *kern_;
+
+        std::vector<std::thread> workers_;
+        std::deque<operation> operations_;
+        std::unordered_map<kernel::uid, strand> strands_;
+
+        std::mutex lock_;
+        std::condition_variable operation_cond_;
+        std::condition_variable idle_cond_;
+
+        std::size_t max_outstanding_;
+        std::size_t outstanding_;
+        bool should_stop_;
+
+        void worker_loop();
+        void finish_operation(operation &op);
+
+    public:
+        /**
+         * \brief Create the queue and start its workers.
+         *
+         * \param kern              The kernel whose lock guards the finish steps. Null to run them unlocked.
+         * \param worker_count      Number of host worker threads.
+         * \param max_outstanding   Maximum number of operations that can be queued or running at once.
+         */
+        explicit fs_io_queue(kernel_system *kern, const std::size_t worker_count, const std::size_t max_outstanding);
+        ~fs_io_queue();
+
+        /**
+         * \brief Check if a session has an operation in flight.
+         *
+         * If this is true, new requests of the session must be deferred to keep them in order.
+         */
+        bool is_busy(const kernel::uid session);
+
+        /**
+         * \brief Check if a new operation can be queued without going over the outstanding limit.
+         *
+         * When there is no slot, the caller should do the operation in place.
+         */
+        bool has_slot();
+
+        /**
+         * \brief Queue an operation for a session that is not busy.
+         *
+         * \param session   The session that the operation belongs to.
+         * \param work      The host I/O to do on a worker thread.
+         * \param finish    Called after the work is done, under the kernel lock.
+         */
+        void submit(const kernel::uid session, work_func work, finish_func finish);
+
+        /**
+         * \brief Defer a request of a busy session.
+         *
+         * The function is called under the kernel lock, after all operations and deferred requests of the
+         * session that came before it are done.
+         */
+        void defer(const kernel::uid session, deferred_func func);
+
+        /**
+         * \brief Wait until every operation, and the deferred requests they release, are finished.
+         *
+         * Sessions must not be destroyed while one of their operations is in flight. Must be called
+         * without the kernel lock, since finish steps take it.
+         */
+        void drain();
+
+        std::size_t outstanding();
+    };
+
+    /**
+     * \brief Copy data staged by an I/O worker into an 8-bit descriptor argument, and set its length.
+     *
+     * Call this from a finish step. The data is copied part by part if the descriptor pages are scattered
+     * in host memory.
+     *
+     * \returns False if the argument is not a modifiable descriptor, or is not mapped anymore.
+     */
+    bool copy_staged_to_descriptor(service::ipc_context *ctx, const int idx, const std::vector<std::uint8_t> &data);
+}
@@ -28,8 +28,10 @@
 #include <drivers/graphics/common.h>
 #include <drivers/itc.h>
 #include <services/fbs/bitmap.h>
+#include <services/window/icon_cache.h>
 
 #include <array>
+#include <memory>
 
 namespace eka2l1 {
     class kernel_system;
@@ -62,6 +64,8 @@ namespace eka2l1::epoc {
 
         std::int64_t last_free{ 0 };
 
+        std::unique_ptr<nvg_icon_cache> icon_cache_;
+
     protected:
         std::uint64_t hash_bitwise_bitmap(epoc::bitwise_bitmap *bw_bmp);
 
@@ -105,5 +109,10 @@ namespace eka2l1::epoc {
         bool remove(epoc::bitwise_bitmap *bmp);
 
         void clean(drivers::graphics_driver *drv);
+
+        /**
+         * @brief Get the cache of rendered NVG icons, creating it from the current configuration if needed.
+         */
+        nvg_icon_cache *get_icon_cache();
     };
 }
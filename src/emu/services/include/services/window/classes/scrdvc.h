@@ -52,6 +52,8 @@ namespace eka2l1::epoc {
         void is_screen_mode_dynamic(eka2l1::service::ipc_context &ctx, eka2l1::ws_cmd &cmd);
         void get_rotation_list(eka2l1::service::ipc_context &ctx, eka2l1::ws_cmd &cmd);
         void set_app_screen_mode(eka2l1::service::ipc_context &ctx, eka2l1::ws_cmd &cmd);
+        void get_scan_line(eka2l1::service::ipc_context &ctx, eka2l1::ws_cmd &cmd);
+        void copy_screen_to_bitmap(eka2l1::service::ipc_context &ctx, eka2l1::ws_cmd &cmd, const bool has_rect);
 
         explicit screen_device(window_server_client_ptr client, epoc::screen *scr);
     };
@@ -31,6 +31,7 @@
 #include <unordered_map>
 
 #include <common/e32inc.h>
+#include <common/pixel.h>
 #include <common/vecx.h>
 #include <common/types.h>
 
@@ -91,6 +92,13 @@ namespace eka2l1::epoc {
     std::string display_mode_to_string(const epoc::display_mode disp_mode);
     epoc::display_mode get_display_mode_from_bpp(const int bpp, const bool has_color);
 
+    /**
+     * \brief Get the pixel layout of a display mode, for use with the common pixel converters.
+     *
+     * \returns std::nullopt if the mode does not describe a pixel layout.
+     */
+    std::optional<common::pixel_format> get_pixel_format_from_display_mode(const display_mode disp_mode);
+
     enum class pointer_cursor_mode {
         none, ///< The device don't have a pointer (touch)
         fixed, ///< Use the default system cursor
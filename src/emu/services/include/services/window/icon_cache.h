@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2022 EKA2L1 Team.
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <loader/nvg.h>
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace lunasvg {
+    class Document;
+}
+
+namespace eka2l1::epoc {
+    /**
+     * @brief Cache of rasterized NVG icons.
+     *
+     * Rendered pixels are keyed by the hash of the NVG data, the target size, the aspect ratio mode
+     * and the icon colour, and evicted in least-recently-used order once their total size goes over
+     * the memory budget. With a persistent root, rendered icons are also written to disk, and read
+     * back on a miss before anything is rendered.
+     *
+     * NVG data is converted and parsed once per content hash. The parsed document is kept and
+     * rendered at every other size with a matrix that places the view box in the target, so icons
+     * requested at several sizes (list, grid, status pane) skip the SVG text round trip.
+     */
+    class nvg_icon_cache {
+    private:
+        struct icon_entry {
+            std::uint64_t key_;
+            std::vector<std::uint8_t> pixels_;
+        };
+
+        struct document_entry {
+            std::uint64_t content_hash_;
+            std::unique_ptr<lunasvg::Document> document_;
+            float viewport_[4];
+        };
+
+        std::list<icon_entry> icons_;
+        std::unordered_map<std::uint64_t, std::list<icon_entry>::iterator> icon_lookup_;
+
+        std::list<document_entry> documents_;
+        std::unordered_map<std::uint64_t, std::list<document_entry>::iterator> document_lookup_;
+
+        std::string root_;
+        std::size_t memory_budget_;
+        std::size_t memory_usage_;
+
+        std::uint64_t total_hits_;
+        std::uint64_t total_disk_hits_;
+        std::uint64_t total_renders_;
+
+        std::string file_path(const std::uint64_t key) const;
+
+        bool load_icon(const std::uint64_t key, const int width, const int height, std::vector<std::uint8_t> &pixels);
+        void save_icon(const std::uint64_t key, const int width, const int height, const std::vector<std::uint8_t> &pixels);
+
+        void insert_icon(const std::uint64_t key, std::vector<std::uint8_t> &&pixels);
+
+        document_entry *get_document(const std::uint64_t content_hash, const std::uint8_t *nvg, const std::size_t nvg_size);
+
+        bool render_icon(document_entry &doc, const int width, const int height, const loader::nvg_aspect_ratio_mode mode,
+            std::uint8_t *dest);
+
+    public:
+        /**
+         * @brief Construct the cache.
+         *
+         * @param memory_budget Maximum number of bytes of rendered pixels kept in memory.
+         * @param root          Directory to persist rendered icons in. Empty to keep them in memory only.
+         */
+        explicit nvg_icon_cache(const std::size_t memory_budget, const std::string &root = "");
+        ~nvg_icon_cache();
+
+        static std::uint64_t content_hash(const std::uint8_t *nvg, const std::size_t nvg_size);
+
+        /**
+         * @brief Get the RGBA pixels of an NVG icon, rendering it if it is not cached.
+         *
+         * @param nvg       The NVG data, without the icon header.
+         * @param nvg_size  Size of the NVG data.
+         * @param width     Width of the target in pixels.
+         * @param height    Height of the target in pixels.
+         * @param mode      Aspect ratio mode stored in the icon header.
+         * @param color     Icon colour stored in the icon header.
+         * @param dest      Destination, must have space for width * height * 4 bytes.
+         *
+         * @returns False if the NVG data could not be rendered. The destination is cleared in that case.
+         */
+        bool get(const std::uint8_t *nvg, const std::size_t nvg_size, const int width, const int height,
+            const loader::nvg_aspect_ratio_mode mode, const std::uint32_t color, std::uint8_t *dest);
+
+        std::size_t memory_usage() const {
+            return memory_usage_;
+        }
+
+        std::size_t icon_count() const {
+            return icons_.size();
+        }
+
+        std::uint64_t hit_count() const {
+            return total_hits_;
+        }
+
+        std::uint64_t disk_hit_count() const {
+            return total_disk_hits_;
+        }
+
+        std::uint64_t render_count() const {
+            return total_renders_;
+        }
+    };
+}
@@ -27,6 +27,9 @@
 #include <common/uid.h>
 #include <common/vecx.h>
 
+#include <cstdint>
+#include <cstring>
+
 namespace eka2l1 {
     struct ws_cmd_header {
         uint16_t op;
@@ -40,6 +43,81 @@ namespace eka2l1 {
         void *data_ptr;
     };
 
+    /**
+     * @brief Walk the commands of a window server command buffer, in place.
+     *
+     * The data pointer of each command points into the buffer, so the buffer must outlive the
+     * commands. Anything kept after the IPC completes must be copied by the one keeping it.
+     */
+    class ws_cmd_reader {
+        static constexpr std::uint16_t NEW_HANDLE_FLAG = 0x8000;
+
+        std::uint8_t *current_;
+        std::uint8_t *end_;
+
+        std::uint32_t last_handle_ = 0;
+        bool truncated_ = false;
+
+    public:
+        explicit ws_cmd_reader(std::uint8_t *data, const std::size_t size)
+            : current_(data)
+            , end_(data + size) {
+        }
+
+        /**
+         * @brief Read the next command.
+         *
+         * A command without the new handle flag targets the same object as the previous one.
+         *
+         * @returns False when the buffer is done, or the rest of it is too short for a command.
+         */
+        bool next(ws_cmd &cmd) {
+            const std::size_t left = end_ - current_;
+
+            if (left == 0) {
+                return false;
+            }
+
+            if (left < sizeof(ws_cmd_header)) {
+                truncated_ = true;
+                return false;
+            }
+
+            std::memcpy(&cmd.header, current_, sizeof(ws_cmd_header));
+            std::size_t header_size = sizeof(ws_cmd_header);
+
+            if (cmd.header.op & NEW_HANDLE_FLAG) {
+                if (left < header_size + sizeof(std::uint32_t)) {
+                    truncated_ = true;
+                    return false;
+                }
+
+                cmd.header.op &= ~NEW_HANDLE_FLAG;
+                std::memcpy(&last_handle_, current_ + header_size, sizeof(std::uint32_t));
+
+                header_size += sizeof(std::uint32_t);
+            }
+
+            if (left - header_size < cmd.header.cmd_len) {
+                truncated_ = true;
+                return false;
+            }
+
+            cmd.obj_handle = last_handle_;
+            cmd.data_ptr = current_ + header_size;
+
+            current_ += header_size + cmd.header.cmd_len;
+            return true;
+        }
+
+        /**
+         * @brief Check if reading stopped at a command cut by the end of the buffer.
+         */
+        bool truncated() const {
+            return truncated_;
+        }
+    };
+
     struct ws_cmd_screen_device_header {
         int num_screen;
         uint32_t screen_dvc_ptr;
@@ -264,6 +342,11 @@ namespace eka2l1 {
         epoc::display_mode dmode;
     };
 
+    struct ws_cmd_copy_screen_to_bitmap2 {
+        eka2l1::rect rect;
+        std::uint32_t handle;
+    };
+
     struct ws_cmd_graphic_drawer_graphic_id {
         std::int32_t id;
         std::int32_t is_uid;
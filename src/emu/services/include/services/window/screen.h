@@ -26,11 +26,13 @@
 #include <services/window/classes/config.h>
 #include <services/window/common.h>
 
+#include <array>
 #include <cstdint>
 #include <functional>
 #include <map>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <vector>
 
 namespace eka2l1 {
@@ -53,6 +55,7 @@ namespace eka2l1::drivers {
 
 namespace eka2l1::epoc {
     const std::uint32_t WORD_PALETTE_ENTRIES_COUNT = 16;
+    const std::size_t SCREEN_READBACK_RING_SIZE = 3;
 
     struct window;
     struct window_group;
@@ -63,6 +66,39 @@ namespace eka2l1::epoc {
         focus_change_name
     };
 
+    /**
+     * @brief A read of the screen texture that has not been copied to the guest screen buffer yet.
+     */
+    struct screen_readback {
+        std::vector<std::uint8_t> staging_;
+        eka2l1::rect region_; ///< Area of the screen held in the staging buffer.
+
+        std::uint32_t staging_pitch_ = 0;
+        std::uint32_t buffer_pitch_ = 0; ///< Pitch of the guest screen buffer when the read was queued.
+        std::int32_t buffer_height_ = 0;
+        std::uint32_t bytes_per_pixel_ = 0;
+        bool flip_ = false; ///< Rows go bottom up in the guest screen buffer.
+
+        int status_ = -100; ///< Set by the graphics driver once the staging buffer is filled.
+        bool pending_ = false;
+    };
+
+    /**
+     * @brief Copy rows read back from the screen texture to the guest screen buffer.
+     *
+     * @param dest              Start of the guest screen buffer.
+     * @param dest_pitch        Number of bytes between two rows of the guest screen buffer.
+     * @param dest_height       Number of rows in the guest screen buffer.
+     * @param source            Rows read from the region, top one first.
+     * @param source_pitch      Number of bytes between two source rows.
+     * @param region            Area of the screen the rows were read from. Must be inside the guest buffer.
+     * @param bytes_per_pixel   Size of a pixel, same in both buffers.
+     * @param flip              True to store the rows bottom up, as done in 90 and 180 degrees modes.
+     */
+    void copy_screen_readback(std::uint8_t *dest, const std::uint32_t dest_pitch, const std::int32_t dest_height,
+        const std::uint8_t *source, const std::uint32_t source_pitch, const eka2l1::rect &region,
+        const std::uint32_t bytes_per_pixel, const bool flip);
+
     using focus_change_callback_handler = std::function<void(void *, window_group *, focus_change_property)>;
     using screen_redraw_callback_handler = std::function<void(void *, screen *, bool)>;
     using screen_mode_change_callback_handler = std::function<void(void *, screen *, const int)>;
@@ -114,6 +150,13 @@ namespace eka2l1::epoc {
 
         bool sync_screen_buffer = false;
 
+        std::array<screen_readback, SCREEN_READBACK_RING_SIZE> readbacks_;
+        drivers::handle readback_texture_ = 0; ///< Native sized copy of the screen, read from when the screen is scaled.
+        eka2l1::vec2 readback_texture_size_;
+        std::size_t readback_next_ = 0;
+        std::size_t readback_pending_count_ = 0;
+        eka2l1::rect readback_dirty_; ///< Area drawn since the last readback was queued.
+
         enum {
             FLAG_NEED_RECALC_VISIBLE = 1 << 0,
             FLAG_ORIENTATION_LOCK = 1 << 1,
@@ -167,6 +210,18 @@ namespace eka2l1::epoc {
          */
         std::uint8_t *screen_buffer_ptr();
 
+        /**
+         * @brief Get the start of a row of the screen in the guest screen buffer.
+         *
+         * Rows are stored bottom up in 90 and 180 degrees modes.
+         */
+        std::uint8_t *screen_buffer_row(const int y);
+
+        /**
+         * @brief Get the layout of pixels in the guest screen buffer, if it is one the pixel converter knows.
+         */
+        std::optional<common::pixel_format> screen_buffer_pixel_format() const;
+
         /**
          * \brief Get the size of this screen, in pixels.
          */
@@ -187,8 +242,32 @@ namespace eka2l1::epoc {
 
         const void get_max_num_colors(int &colors, int &greys) const;
 
+        /**
+         * @brief Make the guest screen buffer up to date with what has been drawn on the screen.
+         *
+         * Reads back what has been drawn since the last readback, then waits for all readbacks in
+         * flight and copies them to the guest buffer. Use this before the server reads the buffer.
+         */
         void sync_screen_buffer_data(drivers::graphics_driver *driver);
 
+        void add_screen_buffer_dirty_rect(eka2l1::rect area);
+
+        /**
+         * @brief Queue a read of the area drawn since the last readback into the next staging buffer.
+         *
+         * The read is done when the builder's command list is executed. Nothing is copied to the guest
+         * buffer until the readback is retired.
+         */
+        void queue_screen_buffer_readback(drivers::graphics_command_builder &builder, drivers::graphics_driver *driver);
+
+        /**
+         * @brief Copy finished readbacks to the guest screen buffer, oldest first.
+         *
+         * @param wait True to wait for readbacks still in flight, false to stop at the first one.
+         */
+        void retire_screen_buffer_readbacks(drivers::graphics_driver *driver, const bool wait);
+        bool retire_oldest_screen_buffer_readback(drivers::graphics_driver *driver, const bool wait);
+
         /**
          * \brief Set screen mode.
          */
@@ -170,6 +170,8 @@ namespace eka2l1::epoc {
         eka2l1::kernel::thread *client_thread;
         epoc::window_client_obj *last_obj;
 
+        std::vector<std::uint8_t> cmd_buffer_copy; ///< Only used when the command buffer is not contiguous in host memory.
+
         epoc::version cli_version;
 
         epoc::redraw_fifo redraws;
@@ -248,7 +250,7 @@ namespace eka2l1::epoc {
         void get_ready(service::ipc_context &ctx, ws_cmd *cmd, const event_listener_type type);
 
         void execute_command(service::ipc_context &ctx, ws_cmd cmd);
-        void execute_commands(service::ipc_context &ctx, std::vector<ws_cmd> cmds);
+        void execute_commands(service::ipc_context &ctx, ws_cmd_reader reader);
         void parse_command_buffer(service::ipc_context &ctx);
 
         std::uint32_t add_object(window_client_obj_ptr &obj);
@@ -19,6 +19,7 @@
  */
 
 #include <kernel/kernel.h>
+#include <kernel/process.h>
 #include <kernel/server.h>
 #include <mem/ptr.h>
 #include <system/epoc.h>
@@ -252,6 +253,150 @@ namespace eka2l1 {
             return nullptr;
         }
 
+        std::uint32_t host_contiguous_size(const host_address_lookup_func &lookup, const std::uint32_t page_size, const address addr,
+            const std::uint8_t *host, const std::uint32_t size) {
+            if (!host || !size) {
+                return 0;
+            }
+
+            std::uint32_t contiguous = common::min<std::uint32_t>(size, page_size - (addr & (page_size - 1)));
+
+            while (contiguous < size) {
+                const std::uint8_t *next = lookup(addr + contiguous);
+
+                if (next != host + contiguous) {
+                    break;
+                }
+
+                contiguous += common::min<std::uint32_t>(size - contiguous, page_size);
+            }
+
+            return contiguous;
+        }
+
+        bool is_byte_descriptor_argument(const ipc_arg_type arg_type, const bool is_eka1) {
+            if (is_eka1) {
+                // Argument types are not recorded, the service knows what it expects
+                return true;
+            }
+
+            // Lengths of 16-bit descriptors count characters, not bytes
+            return ((int)arg_type & (int)ipc_arg_type::flag_des) && !((int)arg_type & (int)ipc_arg_type::flag_16b);
+        }
+
+        static std::uint32_t process_descriptor_parts(const host_address_lookup_func &lookup, const std::uint32_t page_size,
+            const descriptor_host_view &view, const std::uint32_t len, const descriptor_part_func &func) {
+            if (view.contiguous_length_ >= len) {
+                return len ? static_cast<std::uint32_t>(func(view.data_, len)) : 0;
+            }
+
+            std::uint32_t done = 0;
+
+            while (done < len) {
+                const address part_addr = view.data_address_ + done;
+                std::uint8_t *part = lookup(part_addr);
+
+                const std::uint32_t part_size = host_contiguous_size(lookup, page_size, part_addr, part, len - done);
+
+                if (!part_size) {
+                    LOG_WARN(SERVICE_TRACK, "Descriptor data at 0x{:X} is not mapped", part_addr);
+                    break;
+                }
+
+                const std::size_t handled = func(part, part_size);
+                done += static_cast<std::uint32_t>(handled);
+
+                if (handled < part_size) {
+                    break;
+                }
+            }
+
+            return done;
+        }
+
+        std::optional<std::uint32_t> fill_descriptor_view(const host_address_lookup_func &lookup, const std::uint32_t page_size,
+            const descriptor_host_view &view, const std::uint32_t len, const descriptor_part_func &fill) {
+            const epoc::des_type dtype = view.des_->get_descriptor_type();
+
+            if ((dtype == epoc::buf_const) || (dtype == epoc::ptr_const)) {
+                return std::nullopt;
+            }
+
+            return process_descriptor_parts(lookup, page_size, view, common::min<std::uint32_t>(len, view.max_length_), fill);
+        }
+
+        std::uint32_t consume_descriptor_view(const host_address_lookup_func &lookup, const std::uint32_t page_size,
+            const descriptor_host_view &view, const std::uint32_t len, const descriptor_part_func &consume) {
+            return process_descriptor_parts(lookup, page_size, view, common::min<std::uint32_t>(len, view.length_), consume);
+        }
+
+        static host_address_lookup_func make_process_lookup(kernel::process *pr) {
+            return [pr](const address addr) {
+                return reinterpret_cast<std::uint8_t *>(pr->get_ptr_on_addr_space(addr));
+            };
+        }
+
+        bool ipc_context::resolve_descriptor_argument(const int idx, descriptor_host_view &view, const std::uint32_t check_size) {
+            if (idx >= 4 || idx < 0) {
+                return false;
+            }
+
+            if (!is_byte_descriptor_argument(msg->args.get_arg_type(idx), sys->get_kernel_system()->is_eka1())) {
+                return false;
+            }
+
+            kernel::process *own_pr = msg->own_thr->owning_process();
+            eka2l1::epoc::des8 *des = ptr<epoc::des8>(msg->args.args[idx]).get(own_pr);
+
+            if (!des || !des->is_valid_descriptor()) {
+                return false;
+            }
+
+            const std::uint32_t page_size = static_cast<std::uint32_t>(sys->get_memory_system()->get_page_size());
+
+            view.des_ = des;
+            view.data_address_ = des->get_pointer_address(own_pr, msg->args.args[idx]);
+            view.data_ = reinterpret_cast<std::uint8_t *>(own_pr->get_ptr_on_addr_space(view.data_address_));
+            view.length_ = des->get_length();
+            view.max_length_ = des->get_max_length(own_pr);
+            view.contiguous_length_ = host_contiguous_size(make_process_lookup(own_pr), page_size, view.data_address_, view.data_,
+                common::min<std::uint32_t>(check_size, view.max_length_));
+
+            return true;
+        }
+
+        std::optional<std::uint32_t> ipc_context::fill_descriptor_argument(const int idx, const std::uint32_t len, const descriptor_part_func &fill) {
+            descriptor_host_view view;
+
+            if (!resolve_descriptor_argument(idx, view, len)) {
+                return std::nullopt;
+            }
+
+            kernel::process *own_pr = msg->own_thr->owning_process();
+            const std::uint32_t page_size = static_cast<std::uint32_t>(sys->get_memory_system()->get_page_size());
+
+            const std::optional<std::uint32_t> filled = fill_descriptor_view(make_process_lookup(own_pr), page_size, view, len, fill);
+
+            if (filled) {
+                view.des_->set_length(own_pr, filled.value());
+            }
+
+            return filled;
+        }
+
+        std::optional<std::uint32_t> ipc_context::consume_descriptor_argument(const int idx, const std::uint32_t len, const descriptor_part_func &consume) {
+            descriptor_host_view view;
+
+            if (!resolve_descriptor_argument(idx, view, len)) {
+                return std::nullopt;
+            }
+
+            kernel::process *own_pr = msg->own_thr->owning_process();
+            const std::uint32_t page_size = static_cast<std::uint32_t>(sys->get_memory_system()->get_page_size());
+
+            return consume_descriptor_view(make_process_lookup(own_pr), page_size, view, len, consume);
+        }
+
         std::size_t ipc_context::get_argument_max_data_size(int idx) {
             if (idx >= 4 || idx < 0) {
                 return static_cast<std::size_t>(-1);
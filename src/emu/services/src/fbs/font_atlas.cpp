@@ -19,38 +19,73 @@
 #include <services/fbs/font_atlas.h>
 
 #include <common/algorithm.h>
+#include <common/log.h>
 #include <common/time.h>
 
+#include <SkylineBinPack.h>
+
+#include <cmath>
+#include <cstring>
+
 namespace eka2l1::epoc {
+    // Empty pixels kept between glyphs, so sampling one never picks up its neighbours
+    static constexpr int GLYPH_PADDING = 1;
+
+    // Part of the atlas area kept when it is rebuilt, the rest is left for new glyphs
+    static constexpr int COMPACT_KEEP_RATIO = 2;
+
+    static bool is_skipped_character(const char16_t chr) {
+        // TODO: Handle control characters properly
+        return (chr >= 0x200c && chr <= 0x200f) || (chr >= 0x202a && chr <= 0x202e) || (chr >= 0xfffe);
+    }
+
+    static void copy_glyph_pixels(std::uint8_t *dest, const int dest_width, const int dest_x, const int dest_y,
+        const std::uint8_t *source, const int source_width, const int source_x, const int source_y, const int width, const int height) {
+        for (int y = 0; y < height; y++) {
+            std::memcpy(dest + (dest_y + y) * dest_width + dest_x, source + (source_y + y) * source_width + source_x, width);
+        }
+    }
+
     font_atlas::font_atlas()
         : atlas_handle_(0)
+        , retired_handle_(0)
+        , adapter_(nullptr)
+        , metric_identifier_(0)
+        , size_(0)
         , atlas_data_(nullptr)
-        , pack_handle_(0) {
+        , typeface_idx_(0) {
     }
 
     font_atlas::font_atlas(adapter::font_file_adapter_base *adapter, const std::size_t typeface_idx, const char16_t initial_start,
         const char16_t initial_char_count, const int font_size, const std::uint32_t metric_identifier)
         : atlas_handle_(0)
+        , retired_handle_(0)
         , adapter_(adapter)
         , metric_identifier_(metric_identifier)
         , size_(font_size)
         , initial_range_(initial_start, initial_char_count)
-        , typeface_idx_(typeface_idx)
         , atlas_data_(nullptr)
-        , pack_handle_(0) {
+        , typeface_idx_(typeface_idx) {
+    }
+
+    font_atlas::~font_atlas() {
     }
 
     void font_atlas::init(adapter::font_file_adapter_base *adapter, const std::size_t typeface_idx, const char16_t initial_start,
         const char16_t initial_char_count, const int font_size, const std::uint32_t metric_identifier) {
         adapter_ = adapter;
         atlas_handle_ = 0;
+        retired_handle_ = 0;
         metric_identifier_ = metric_identifier;
         size_ = font_size;
         initial_range_ = { initial_start, initial_char_count };
         typeface_idx_ = typeface_idx;
-        pack_handle_ = 0;
 
         atlas_data_.reset();
+        packer_.reset();
+
+        glyphs_.clear();
+        lru_.clear();
     }
 
     void font_atlas::destroy(drivers::graphics_driver *driver) {
@@ -62,108 +97,274 @@ namespace eka2l1::epoc {
             driver->submit_command_list(retrieved);
 
             atlas_handle_ = 0;
-            atlas_data_.reset();
         }
 
-        if (pack_handle_) {
-            adapter_->end_get_atlas(pack_handle_);
-        }
+        atlas_data_.reset();
+        packer_.reset();
 
-        last_use_.clear();
-        characters_.clear();
+        glyphs_.clear();
+        lru_.clear();
     }
 
     int font_atlas::get_atlas_width() const {
         return common::align(ESTIMATE_MAX_CHAR_IN_ATLAS_WIDTH * size_, 1024);
     }
 
-    bool font_atlas::draw_text(const std::u16string &text, const eka2l1::rect &text_box, const epoc::text_alignment alignment, drivers::graphics_driver *driver, drivers::graphics_command_builder &builder, const eka2l1::vec2f scale_vector) {
-        const int width = get_atlas_width();
-        drivers::graphics_command_builder upload_builder;
+    void font_atlas::mark_dirty(const eka2l1::rect &region) {
+        if (dirty_.empty()) {
+            dirty_ = region;
+            return;
+        }
 
-        if (!atlas_data_) {
-            atlas_data_ = std::make_unique<std::uint8_t[]>(width * width);
-            auto cinfos = std::make_unique<adapter::character_info[]>(initial_range_.second);
+        const eka2l1::vec2 end = dirty_.top + dirty_.size;
+        const eka2l1::vec2 region_end = region.top + region.size;
+
+        dirty_.top = { common::min(dirty_.top.x, region.top.x), common::min(dirty_.top.y, region.top.y) };
+        dirty_.size = eka2l1::vec2(common::max(end.x, region_end.x), common::max(end.y, region_end.y)) - dirty_.top;
+    }
+
+    bool font_atlas::place_glyph(const char16_t code, glyph_entry &entry, const std::uint8_t *source, const int source_width) {
+        adapter::character_info &info = entry.info_;
+
+        const int width = info.x1 - info.x0;
+        const int height = info.y1 - info.y0;
 
-            pack_handle_ = adapter_->begin_get_atlas(atlas_data_.get(), { width, width });
+        if ((width != 0) && (height != 0)) {
+            const rbp::Rect placed = packer_->Insert(width + GLYPH_PADDING, height + GLYPH_PADDING, rbp::SkylineBinPack::LevelBottomLeft);
 
-            if (pack_handle_ == -1) {
+            if (placed.height == 0) {
                 return false;
             }
 
-            if (!adapter_->get_glyph_atlas(pack_handle_, typeface_idx_, initial_range_.first, nullptr, initial_range_.second,
-                    metric_identifier_, cinfos.get())) {
+            copy_glyph_pixels(atlas_data_.get(), get_atlas_width(), placed.x, placed.y, source, source_width,
+                info.x0, info.y0, width, height);
+
+            info.x0 = static_cast<std::uint16_t>(placed.x);
+            info.y0 = static_cast<std::uint16_t>(placed.y);
+            info.x1 = static_cast<std::uint16_t>(placed.x + width);
+            info.y1 = static_cast<std::uint16_t>(placed.y + height);
+
+            mark_dirty(eka2l1::rect({ placed.x, placed.y }, { width, height }));
+        }
+
+        entry.resident_ = true;
+        entry.lru_ite_ = lru_.insert(lru_.begin(), code);
+
+        return true;
+    }
+
+    void font_atlas::compact(const std::size_t keep_count) {
+        const int width = get_atlas_width();
+        const std::size_t keep_area = static_cast<std::size_t>(width) * width / COMPACT_KEEP_RATIO;
+
+        auto new_data = std::make_unique<std::uint8_t[]>(width * width);
+        auto new_packer = std::make_unique<rbp::SkylineBinPack>(width, width, false);
+
+        std::size_t used_area = 0;
+        std::size_t kept = 0;
+
+        // Glyphs of the text being drawn are at the front, and are kept no matter the area they take
+        for (auto ite = lru_.begin(); ite != lru_.end();) {
+            glyph_entry &entry = glyphs_[*ite];
+            adapter::character_info &info = entry.info_;
+
+            const int glyph_width = info.x1 - info.x0;
+            const int glyph_height = info.y1 - info.y0;
+            const std::size_t area = static_cast<std::size_t>(glyph_width + GLYPH_PADDING) * (glyph_height + GLYPH_PADDING);
+
+            bool keep = (kept < keep_count) || (used_area + area <= keep_area);
+
+            if (keep && (glyph_width != 0) && (glyph_height != 0)) {
+                const rbp::Rect placed = new_packer->Insert(glyph_width + GLYPH_PADDING, glyph_height + GLYPH_PADDING,
+                    rbp::SkylineBinPack::LevelBottomLeft);
+
+                if (placed.height == 0) {
+                    keep = false;
+                } else {
+                    copy_glyph_pixels(new_data.get(), width, placed.x, placed.y, atlas_data_.get(), width, info.x0, info.y0,
+                        glyph_width, glyph_height);
+
+                    info.x0 = static_cast<std::uint16_t>(placed.x);
+                    info.y0 = static_cast<std::uint16_t>(placed.y);
+                    info.x1 = static_cast<std::uint16_t>(placed.x + glyph_width);
+                    info.y1 = static_cast<std::uint16_t>(placed.y + glyph_height);
+                }
+            }
+
+            if (!keep) {
+                entry.resident_ = false;
+                ite = lru_.erase(ite);
+
+                continue;
+            }
+
+            used_area += area;
+            kept++;
+            ite++;
+        }
+
+        atlas_data_ = std::move(new_data);
+        packer_ = std::move(new_packer);
+
+        // Glyphs moved, and text queued before may still sample the old bitmap. Upload to a new one.
+        retired_handle_ = atlas_handle_;
+        atlas_handle_ = 0;
+    }
+
+    bool font_atlas::rasterize(const std::size_t keep_count) {
+        const int width = get_atlas_width();
+        const std::size_t count = to_rast_.size();
+
+        // Rasterize into a scratch atlas that fits the batch, then move each glyph to the real atlas.
+        // Start from a guess of two pixels per point for oversampling, and grow until the adapter manages.
+        const int grid = static_cast<int>(std::ceil(std::sqrt(static_cast<double>(count))));
+        int scratch_width = common::min(width, common::align((size_ * 2 + GLYPH_PADDING * 2) * grid, 64));
+
+        std::unique_ptr<std::uint8_t[]> scratch;
+        auto cinfos = std::make_unique<adapter::character_info[]>(count);
+
+        while (true) {
+            scratch = std::make_unique<std::uint8_t[]>(scratch_width * scratch_width);
+            const std::int32_t pack_handle = adapter_->begin_get_atlas(scratch.get(), { scratch_width, scratch_width });
+
+            if (pack_handle == -1) {
                 return false;
             }
 
-            // initialize the last used list and character map
-            for (char16_t i = 0; i < initial_range_.second; i++) {
-                last_use_.push_back(initial_range_.first + i);
-                characters_.emplace(initial_range_.first + i, cinfos[i]);
+            const bool result = adapter_->get_glyph_atlas(pack_handle, typeface_idx_, 0, to_rast_.data(), static_cast<char16_t>(count),
+                metric_identifier_, cinfos.get());
+
+            adapter_->end_get_atlas(pack_handle);
+
+            if (result) {
+                break;
             }
 
-            // Submit the bitmap through another queue, in case the command list above never got submitted
-            atlas_handle_ = drivers::create_bitmap(driver, { width, width }, 8);
+            if (scratch_width >= width) {
+                return false;
+            }
 
-            upload_builder.update_bitmap(atlas_handle_, reinterpret_cast<const char *>(atlas_data_.get()),
-                width * width, { 0, 0 }, { width, width });
-            upload_builder.set_texture_filter(atlas_handle_, false, drivers::filter_option::nearest);
+            scratch_width = common::min(width, scratch_width * 2);
         }
 
-        std::vector<int> to_rast;
-        std::vector<char16_t> unique_char;
+        std::vector<std::size_t> not_placed;
 
-        // Iterate through characters, and filter out characters which is not available in the atlas.
-        // Add character to last used, too.
-        for (auto &chr : text) {
-            if (characters_.find(chr) == characters_.end()) {
-                if (!std::binary_search(to_rast.begin(), to_rast.end(), chr)) {
-                    to_rast.push_back(chr);
-                    std::sort(to_rast.begin(), to_rast.end());
-                }
+        for (std::size_t i = 0; i < count; i++) {
+            glyph_entry &entry = glyphs_[static_cast<char16_t>(to_rast_[i])];
+            entry.info_ = cinfos[i];
+
+            if (!place_glyph(static_cast<char16_t>(to_rast_[i]), entry, scratch.get(), scratch_width)) {
+                not_placed.push_back(i);
             }
+        }
 
-            if (std::find(unique_char.begin(), unique_char.end(), chr) == unique_char.end()) {
-                last_use_.insert(last_use_.begin(), chr);
-                unique_char.push_back(chr);
+        if (not_placed.empty()) {
+            return true;
+        }
+
+        // Make room with the glyphs used the most recently. The new glyphs are kept too, they are already at the front
+        compact(keep_count + count - not_placed.size());
+
+        for (const std::size_t i : not_placed) {
+            const char16_t code = static_cast<char16_t>(to_rast_[i]);
+
+            // Coordinates were untouched on failure, they still point to the scratch atlas
+            if (!place_glyph(code, glyphs_[code], scratch.get(), scratch_width)) {
+                LOG_WARN(SERVICE_FBS, "Glyph 0x{:X} does not fit in the font atlas", static_cast<std::uint32_t>(code));
             }
         }
 
-        last_use_.erase(last_use_.end() - unique_char.size(), last_use_.end());
+        return true;
+    }
 
-        if (!to_rast.empty()) {
-            // Try to rasterize these
-            auto cinfos = std::make_unique<adapter::character_info[]>(to_rast.size());
+    void font_atlas::upload(drivers::graphics_driver *driver, drivers::graphics_command_builder &builder) {
+        const int width = get_atlas_width();
 
-            if (!adapter_->get_glyph_atlas(pack_handle_, typeface_idx_, 0, to_rast.data(), static_cast<char16_t>(to_rast.size()), metric_identifier_,
-                    cinfos.get())) {
-                // Try to redo the atlas, getting latest use characters.
-                adapter_->end_get_atlas(pack_handle_);
-                pack_handle_ = adapter_->begin_get_atlas(atlas_data_.get(), { width, width });
+        if (!atlas_handle_) {
+            atlas_handle_ = drivers::create_bitmap(driver, { width, width }, 8);
 
-                if (pack_handle_ == -1) {
-                    return false;
-                }
+            builder.update_bitmap(atlas_handle_, reinterpret_cast<const char *>(atlas_data_.get()),
+                width * width, { 0, 0 }, { width, width });
+            builder.set_texture_filter(atlas_handle_, false, drivers::filter_option::nearest);
 
-                if (!adapter_->get_glyph_atlas(pack_handle_, typeface_idx_, 0, &last_use_[0], static_cast<char16_t>(characters_.size() - 5),
-                        metric_identifier_, cinfos.get())) {
-                    return false;
-                }
+            dirty_ = eka2l1::rect{};
+            return;
+        }
 
-                for (std::size_t i = 0; i < characters_.size() - 5; i++) {
-                    characters_[last_use_[i]] = cinfos[i];
-                }
-            } else {
-                // Update the characters
-                for (char16_t i = 0; i < static_cast<char16_t>(to_rast.size()); i++) {
-                    characters_.emplace(to_rast[i], cinfos[i]);
+        if (dirty_.empty()) {
+            return;
+        }
+
+        // Rows of 8-bit pixels are unpacked with an alignment of four
+        const int left = dirty_.top.x & ~3;
+        const int right = common::min(width, common::align(dirty_.top.x + dirty_.size.x, 4));
+        const int region_width = right - left;
+        const int region_height = dirty_.size.y;
+
+        std::uint8_t *region_data = new std::uint8_t[region_width * region_height];
+        copy_glyph_pixels(region_data, region_width, 0, 0, atlas_data_.get(), width, left, dirty_.top.y, region_width, region_height);
+
+        // The driver takes ownership of the copy
+        builder.update_bitmap(atlas_handle_, reinterpret_cast<const char *>(region_data), region_width * region_height,
+            { left, dirty_.top.y }, { region_width, region_height }, 0, false);
+
+        dirty_ = eka2l1::rect{};
+    }
+
+    bool font_atlas::draw_text(const std::u16string &text, const eka2l1::rect &text_box, const epoc::text_alignment alignment, drivers::graphics_driver *driver, drivers::graphics_command_builder &builder, const eka2l1::vec2f scale_vector) {
+        const int width = get_atlas_width();
+        std::size_t touched_count = 0;
+
+        to_rast_.clear();
+
+        if (!atlas_data_) {
+            atlas_data_ = std::make_unique<std::uint8_t[]>(width * width);
+            packer_ = std::make_unique<rbp::SkylineBinPack>(width, width, false);
+
+            glyphs_.clear();
+            lru_.clear();
+
+            for (char16_t i = 0; i < initial_range_.second; i++) {
+                const char16_t code = initial_range_.first + i;
+
+                glyphs_[code].queued_ = true;
+                to_rast_.push_back(code);
+            }
+        }
+
+        // Move glyphs of this text to the front of the recently used list, and queue the missing ones.
+        // Repeated characters are counted again, which only makes compaction keep a few more glyphs.
+        for (const char16_t chr : text) {
+            glyph_entry &entry = glyphs_[chr];
+
+            if (entry.resident_) {
+                if (entry.lru_ite_ != lru_.begin()) {
+                    lru_.splice(lru_.begin(), lru_, entry.lru_ite_);
                 }
 
-                upload_builder.update_bitmap(atlas_handle_, reinterpret_cast<const char *>(atlas_data_.get()),
-                    width * width, { 0, 0 }, { width, width });
+                touched_count++;
+            } else if (!entry.queued_) {
+                entry.queued_ = true;
+                to_rast_.push_back(chr);
+            }
+        }
+
+        if (!to_rast_.empty()) {
+            const bool result = rasterize(common::min(touched_count, lru_.size()));
+
+            for (const int code : to_rast_) {
+                glyphs_[static_cast<char16_t>(code)].queued_ = false;
+            }
+
+            if (!result) {
+                return false;
             }
         }
 
+        // Submit the bitmap through another queue, in case the command list above never got submitted
+        drivers::graphics_command_builder upload_builder;
+        upload(driver, upload_builder);
+
         eka2l1::vec2 cur_pos = text_box.top;
 
         // Calculate size of the text to know where to put them
@@ -171,8 +372,8 @@ namespace eka2l1::epoc {
         if (alignment != epoc::text_alignment::left) {
             float size_length = 0;
 
-            for (auto &chr : text) {
-                size_length += static_cast<int>(characters_[chr].xadv * scale_vector[0]);
+            for (const char16_t chr : text) {
+                size_length += static_cast<int>(glyphs_[chr].info_.xadv * scale_vector[0]);
             }
 
             if (alignment == epoc::text_alignment::right) {
@@ -182,22 +383,18 @@ namespace eka2l1::epoc {
             }
         }
 
-        builder.set_feature(drivers::graphics_feature::blend, true);
-        builder.blend_formula(drivers::blend_equation::add, drivers::blend_equation::add,
-            drivers::blend_factor::frag_out_alpha, drivers::blend_factor::one_minus_frag_out_alpha,
-            drivers::blend_factor::one, drivers::blend_factor::one);
+        dest_rects_.clear();
+        source_rects_.clear();
 
-        // Start to render these texts.
-        for (auto &chr : text) {
-            if ((chr >= 0x200c && chr <= 0x200f) || (chr >= 0x202a && chr <= 0x202e) || (chr >= 0xfffe && chr <= 0xffff)) {
-                // Skip control characters
-                // TODO: Handle them properly
+        for (const char16_t chr : text) {
+            if (is_skipped_character(chr)) {
                 continue;
             }
 
-            eka2l1::rect source_rect;
-            adapter::character_info &info = characters_[chr];
+            const glyph_entry &entry = glyphs_[chr];
+            const adapter::character_info &info = entry.info_;
 
+            eka2l1::rect source_rect;
             source_rect.top = { info.x0, info.y0 };
             source_rect.size = eka2l1::object_size(info.x1 - info.x0, info.y1 - info.y0);
 
@@ -208,20 +405,37 @@ namespace eka2l1::epoc {
             dest_rect.size.x = static_cast<int>((info.xoff2 - info.xoff) * scale_vector[0]);
             dest_rect.size.y = static_cast<int>((info.yoff2 - info.yoff) * scale_vector[1]);
 
-            if ((dest_rect.size.x != 0) && (dest_rect.size.y != 0) && (source_rect.size.x != 0) && (source_rect.size.y != 0)) {
-                builder.draw_bitmap(atlas_handle_, 0, dest_rect, source_rect, eka2l1::vec2(0, 0), 0.0f,
-                    drivers::bitmap_draw_flag_use_brush);
+            if (entry.resident_ && (dest_rect.size.x != 0) && (dest_rect.size.y != 0) && (source_rect.size.x != 0) && (source_rect.size.y != 0)) {
+                dest_rects_.push_back(dest_rect);
+                source_rects_.push_back(source_rect);
             }
 
             // TODO: Newline
             cur_pos.x += static_cast<int>(std::round(info.xadv * scale_vector[0]));
         }
 
-        builder.set_feature(drivers::graphics_feature::blend, false);
+        if (!dest_rects_.empty()) {
+            builder.set_feature(drivers::graphics_feature::blend, true);
+            builder.blend_formula(drivers::blend_equation::add, drivers::blend_equation::add,
+                drivers::blend_factor::frag_out_alpha, drivers::blend_factor::one_minus_frag_out_alpha,
+                drivers::blend_factor::one, drivers::blend_factor::one);
 
-        drivers::command_list retrieved = upload_builder.retrieve_command_list();
-        driver->submit_command_list(retrieved);
+            builder.draw_bitmaps(atlas_handle_, dest_rects_.data(), source_rects_.data(), dest_rects_.size(),
+                drivers::bitmap_draw_flag_use_brush);
+
+            builder.set_feature(drivers::graphics_feature::blend, false);
+        }
+
+        if (retired_handle_) {
+            builder.destroy_bitmap(retired_handle_);
+            retired_handle_ = 0;
+        }
+
+        if (!upload_builder.is_empty()) {
+            drivers::command_list retrieved = upload_builder.retrieve_command_list();
+            driver->submit_command_list(retrieved);
+        }
 
         return true;
     }
-}
\ No newline at end of file
+}
@@ -26,6 +26,7 @@
 #include <common/cvt.h>
 #include <common/fileutils.h>
 #include <common/log.h>
+#include <common/pixel.h>
 #include <common/runlen.h>
 
 #include <services/fbs/fbs.h>
@@ -1396,164 +1397,48 @@ namespace eka2l1 {
                 byte_width = header.size_pixels.x * 3;
             }
 
-            switch (dpm) {
-            case epoc::display_mode::color256:
-                for (std::size_t y = 0; y < header.size_pixels.y; y++) {
-                    current_to_look->seek(y * byte_width, common::seek_where::beg);
-                    
-                    epoc::palette_256 &palette = epoc::get_suitable_palette_256(serv->get_kernel_object_owner()->get_epoc_version(),
-                        serv->get_system()->is_s80_device_active());
-
-                    for (std::size_t x = 0; x < header.size_pixels.x; x++) {
-                        std::uint8_t pixel = 0;
-                        if (current_to_look->read(&pixel, 1) != 1) {
-                            return false;
-                        }
-
-                        std::uint32_t palette_color = palette[pixel];
-
-                        std::uint8_t a = ((make_standard_mask) ? ((palette_color & 0xFFFFFF) == 0xFFFFFF) : 1) * 255;
-
-                        dest.write(reinterpret_cast<const char *>(&palette_color) + 0, 1);
-                        dest.write(reinterpret_cast<const char *>(&palette_color) + 1, 1);
-                        dest.write(reinterpret_cast<const char *>(&palette_color) + 2, 1);
-                        dest.write(&a, 1);
-                    }
-                }
-
-                break;
-
-            case epoc::display_mode::color4k:
-                for (std::size_t y = 0; y < header.size_pixels.y; y++) {
-                    current_to_look->seek(y * byte_width, common::seek_where::beg);
-
-                    for (std::size_t x = 0; x < header.size_pixels.x; x++) {
-                        std::uint16_t pixel = 0;
-                        if (current_to_look->read(&pixel, 2) != 2) {
-                            return false;
-                        }
-                        std::uint8_t r = static_cast<std::uint8_t>(((pixel >> 8) & 0xF) * 17);
-                        std::uint8_t g = static_cast<std::uint8_t>(((pixel >> 4) & 0xF) * 17);
-                        std::uint8_t b = static_cast<std::uint8_t>((pixel & 0xF) * 17);
-                        std::uint8_t a = ((make_standard_mask) ? ((r == 255) && (g == 255) && (b == 255)) : 1) * 255;
-                        dest.write(&r, 1);
-                        dest.write(&g, 1);
-                        dest.write(&b, 1);
-                        dest.write(&a, 1);
-                    }
-                }
-
-                break;
-
-            case epoc::display_mode::color64k:
-                for (std::size_t y = 0; y < header.size_pixels.y; y++) {
-                    current_to_look->seek(y * byte_width, common::seek_where::beg);
-
-                    for (std::size_t x = 0; x < header.size_pixels.x; x++) {
-                        std::uint16_t pixel = 0;
-                        if (current_to_look->read(&pixel, 2) != 2) {
-                            return false;
-                        }
-
-                        std::uint8_t r = static_cast<std::uint8_t>((pixel & 0xF800) >> 8);
-                        r += r >> 5;
-
-                        std::uint8_t g = static_cast<std::uint8_t>((pixel & 0x07E0) >> 3);
-                        g += g >> 6;
-
-                        std::uint8_t b = static_cast<std::uint8_t>((pixel & 0x001F) << 3);
-                        b += b >> 5;
-
-                        std::uint8_t a = ((make_standard_mask) ? ((r == 255) && (g == 255) && (b == 255)) : 1) * 255;
-                        dest.write(&r, 1);
-                        dest.write(&g, 1);
-                        dest.write(&b, 1);
-                        dest.write(&a, 1);
-                    }
-                }
-
-                break;
-
-            case epoc::display_mode::color16m:
-                for (std::size_t y = 0; y < header.size_pixels.y; y++) {
-                    current_to_look->seek(y * byte_width, common::seek_where::beg);
-
-                    for (std::size_t x = 0; x < header.size_pixels.x; x++) {
-                        std::uint8_t base[3];
-                        if (current_to_look->read(base, 3) != 3) {
-                            return false;
-                        }
+            const std::optional<common::pixel_format> source_format = epoc::get_pixel_format_from_display_mode(dpm);
+            if (!source_format.has_value()) {
+                LOG_ERROR(SERVICE_FBS, "Unsupported display mode to convert to ARGB8888 {}", static_cast<int>(dpm));
+                return false;
+            }
 
-                        std::uint8_t a = ((make_standard_mask) ? ((base[0] == 255) && (base[1] == 255) && (base[2] == 255)) : 1) * 255;
-                        dest.write(base + 2, 1);
-                        dest.write(base + 1, 1);
-                        dest.write(base, 1);
-                        dest.write(&a, 1);
-                    }
-                }
+            common::pixel_convert_params params;
 
-                break;
+            if (dpm == epoc::display_mode::color256) {
+                params.source_palette_ = epoc::get_suitable_palette_256(serv->get_kernel_object_owner()->get_epoc_version(),
+                    serv->get_system()->is_s80_device_active()).data();
+            } else if (dpm == epoc::display_mode::color16) {
+                params.source_palette_ = epoc::color_16_palette.data();
+            }
 
-            case epoc::display_mode::color16ma: {
-                for (std::size_t y = 0; y < header.size_pixels.y; y++) {    
-                    current_to_look->seek(y * byte_width, common::seek_where::beg);
+            const std::size_t width = header.size_pixels.x;
+            const std::size_t source_row_size = common::get_pixel_row_size(source_format.value(), width);
 
-                    for (std::size_t x = 0; x < header.size_pixels.x; x++) {
-                        std::uint8_t base[4];
-                        if (current_to_look->read(base, 4) != 3) {
-                            return false;
-                        }
+            std::vector<std::uint8_t> source_row(source_row_size);
+            std::vector<std::uint32_t> dest_row(width);
 
-                        dest.write(base + 2, 1);
-                        dest.write(base + 1, 1);
-                        dest.write(base, 1);
-                        dest.write(base + 3, 1);
-                    }
+            for (std::size_t y = 0; y < header.size_pixels.y; y++) {
+                current_to_look->seek(y * byte_width, common::seek_where::beg);
+                if (current_to_look->read(source_row.data(), source_row_size) != source_row_size) {
+                    return false;
                 }
 
-                break;
-            }
-
-            case epoc::display_mode::gray256:
-                for (std::size_t y = 0; y < header.size_pixels.y; y++) {
-                    current_to_look->seek(y * byte_width, common::seek_where::beg);
+                common::convert_pixel_row(common::pixel_format::rgba8888, dest_row.data(), source_format.value(), source_row.data(),
+                    width, params);
 
-                    for (std::size_t x = 0; x < header.size_pixels.x; x++) {
-                        std::uint8_t pixel = 0;
-                        if (current_to_look->read(&pixel, 1) != 1) {
-                            return false;
-                        }
-                        dest.write(&pixel, 1);
-                        dest.write(&pixel, 1);
-                        dest.write(&pixel, 1);
-                        dest.write(&pixel, 1);
+                if (epoc::is_display_mode_mono(dpm)) {
+                    // Grayscale bitmaps are mostly masks, the level is also the alpha
+                    for (std::uint32_t &pixel : dest_row) {
+                        pixel = (pixel & 0xFFFFFF) | (pixel << 24);
                     }
-                }
-
-                break;
-
-            case epoc::display_mode::gray2:
-                for (std::size_t y = 0; y < header.size_pixels.y; y++) {
-                    for (std::size_t x = 0; x < header.size_pixels.x; x++) {
-                        std::uint32_t color = 0;
-                        current_to_look->seek(y * byte_width + (x / 32) * 4, common::seek_where::beg);
-                        if (current_to_look->read(&color, 4) != 4) {
-                            return false;
-                        }
-                        std::uint32_t converted_color = 0;
-                        if (color & (1 << (x & 0x1F))) {
-                            converted_color = 0xFFFFFFFF;
-                        }
-
-                        dest.write(&converted_color, sizeof(converted_color));
+                } else if (make_standard_mask && !epoc::is_display_mode_alpha(dpm)) {
+                    for (std::uint32_t &pixel : dest_row) {
+                        pixel = ((pixel & 0xFFFFFF) == 0xFFFFFF) ? 0xFFFFFFFF : (pixel & 0xFFFFFF);
                     }
                 }
 
-                break;
-
-            default:
-                LOG_ERROR(SERVICE_FBS, "Unsupported display mode to convert to ARGB8888 {}", static_cast<int>(dpm));
-                return false;
+                dest.write(dest_row.data(), dest_row.size() * sizeof(std::uint32_t));
             }
 
             return true;
@@ -170,6 +170,57 @@ namespace eka2l1 {
         ctx->complete(epoc::error_none);
     }
 
+    struct packed_entries_result {
+        std::size_t written_ = 0;
+        std::size_t count_ = 0;
+        bool eof_ = false;
+    };
+
+    // Fill a buffer with as many entries as it can hold. Only touches the host, so it can run on an I/O worker.
+    static packed_entries_result pack_dir_entries(io_system *io, directory *dir, std::uint8_t *entry_buf,
+        std::uint8_t *entry_buf_end, const bool should_support_64bit_size) {
+        packed_entries_result result;
+        std::uint8_t *entry_buf_org = entry_buf;
+
+        // 4 is for info (length + descriptor type)
+        size_t entry_no_name_size = epoc::fs::entry_standard_size + 4 + 8;
+
+        while (entry_buf < entry_buf_end) {
+            epoc::fs::entry entry;
+            std::optional<entry_info> info = dir->peek_next_entry();
+
+            if (!info) {
+                result.eof_ = true;
+                break;
+            }
+
+            if (entry_buf + entry_no_name_size + common::align(common::utf8_to_ucs2(info->name).length() * 2, 4) + 4 > entry_buf_end) {
+                break;
+            }
+
+            epoc::fs::build_symbian_entry_from_emulator_entry(io, info.value(), entry);
+            const std::uint32_t entry_write_size = epoc::fs::entry_standard_size + 4;
+
+            memcpy(entry_buf, &entry, entry_write_size);
+            entry_buf += entry_write_size;
+
+            memcpy(entry_buf, &entry.name.data[0], info->name.length() * 2);
+            entry_buf += common::align(info->name.length() * 2, 4);
+
+            if (should_support_64bit_size) {
+                // Epoc10 uses two reserved bytes
+                memcpy(entry_buf, &entry.size_high, 8);
+                entry_buf += 8;
+            }
+
+            result.count_ += 1;
+            dir->get_next_entry();
+        }
+
+        result.written_ = entry_buf - entry_buf_org;
+        return result;
+    }
+
     void fs_server_client::read_dir_packed(service::ipc_context *ctx) {
         std::optional<std::int32_t> handle = ctx->get_argument_value<std::int32_t>(3);
         std::optional<std::int32_t> entry_arr_vir_ptr = ctx->get_argument_value<std::int32_t>(0);
@@ -195,57 +246,46 @@ namespace eka2l1 {
 
         std::uint8_t *entry_buf = reinterpret_cast<std::uint8_t *>(entry_arr->get_pointer(own_pr));
         std::uint8_t *entry_buf_end = entry_buf + entry_arr_buf->max_length;
-        std::uint8_t *entry_buf_org = entry_buf;
-
-        size_t queried_entries = 0;
-
-        // 4 is for info (length + descriptor type)
-        size_t entry_no_name_size = epoc::fs::entry_standard_size + 4 + 8;
 
         kernel_system *kern = ctx->sys->get_kernel_system();
         io_system *io = ctx->sys->get_io_system();
 
         const bool should_support_64bit_size = kern->get_epoc_version() >= epocver::epoc95;
 
-        while (entry_buf < entry_buf_end) {
-            epoc::fs::entry entry;
-            std::optional<entry_info> info = dir->peek_next_entry();
+        fs_io_queue *io_queue = server<fs_server>()->get_io_queue();
+        service::descriptor_host_view view;
 
-            if (!info) {
-                entry_arr->set_length(own_pr, static_cast<std::uint32_t>(entry_buf - entry_buf_org));
-                LOG_TRACE(SERVICE_EFSRV, "Queried entries: 0x{:x}", queried_entries);
-                ctx->complete(epoc::error_eof);
+        // Scanning opens every file for its UIDs, which is slow on large folders. Let a worker do it.
+        // The entries are packed into a staging buffer, the client's memory is only touched on finish.
+        if (io_queue && io_queue->has_slot() && ctx->resolve_descriptor_argument(0, view, 0)) {
+            std::shared_ptr<service::ipc_context> owned = ctx->move_to_new();
+            std::shared_ptr<packed_entries_result> result = std::make_shared<packed_entries_result>();
+            std::shared_ptr<std::vector<std::uint8_t>> staging = std::make_shared<std::vector<std::uint8_t>>(entry_arr_buf->max_length);
 
-                return;
-            }
+            io_queue->submit(
+                client_ss_uid_, [io, dir, should_support_64bit_size, result, staging]() {
+                    *result = pack_dir_entries(io, dir, staging->data(), staging->data() + staging->size(), should_support_64bit_size);
+                    staging->resize(result->written_);
+                },
+                [owned, result, staging]() {
+                    LOG_TRACE(SERVICE_EFSRV, "Queried entries: 0x{:x}", result->count_);
 
-            if (entry_buf + entry_no_name_size + common::align(common::utf8_to_ucs2(info->name).length() * 2, 4) + 4 > entry_buf_end) {
-                break;
-            }
+                    if (!copy_staged_to_descriptor(owned.get(), 0, *staging)) {
+                        owned->complete(epoc::error_argument);
+                        return;
+                    }
 
-            epoc::fs::build_symbian_entry_from_emulator_entry(io, info.value(), entry);
-            const std::uint32_t entry_write_size = epoc::fs::entry_standard_size + 4;
-
-            memcpy(entry_buf, &entry, entry_write_size);
-            entry_buf += entry_write_size;
-
-            memcpy(entry_buf, &entry.name.data[0], info->name.length() * 2);
-            entry_buf += common::align(info->name.length() * 2, 4);
-
-            if (should_support_64bit_size) {
-                // Epoc10 uses two reserved bytes
-                memcpy(entry_buf, &entry.size_high, 8);
-                entry_buf += 8;
-            }
+                    owned->complete(result->eof_ ? epoc::error_eof : epoc::error_none);
+                });
 
-            queried_entries += 1;
-            dir->get_next_entry();
+            return;
         }
 
-        entry_arr->set_length(own_pr, static_cast<std::uint32_t>(entry_buf - entry_buf_org));
+        const packed_entries_result result = pack_dir_entries(io, dir, entry_buf, entry_buf_end, should_support_64bit_size);
+        entry_arr->set_length(own_pr, static_cast<std::uint32_t>(result.written_));
 
-        LOG_TRACE(SERVICE_EFSRV, "Queried entries: 0x{:x}", queried_entries);
+        LOG_TRACE(SERVICE_EFSRV, "Queried entries: 0x{:x}", result.count_);
 
-        ctx->complete(epoc::error_none);
+        ctx->complete(result.eof_ ? epoc::error_eof : epoc::error_none);
     }
 }
@@ -35,6 +35,9 @@
 #include <services/fs/sec.h>
 
 namespace eka2l1 {
+    // Smaller transfers are done in place, handing them to a worker costs more than the copy
+    static constexpr std::uint32_t ASYNC_IO_MIN_SIZE = 16 * 1024;
+
     bool file_attrib::claim_exclusive(const kernel::uid pr_uid) {
         if (owner == pr_uid) {
             flags |= static_cast<std::uint32_t>(fs_file_attrib_flag::exclusive);
@@ -454,11 +457,17 @@ namespace eka2l1 {
             return;
         }
 
-        std::optional<std::string> write_data = ctx->get_argument_value<std::string>(0);
+        service::descriptor_host_view write_view;
+        std::optional<std::string> write_data;
 
-        if (!write_data) {
-            ctx->complete(epoc::error_argument);
-            return;
+        if (!ctx->resolve_descriptor_argument(0, write_view, 0)) {
+            // Can't be accessed in place, take a copy instead
+            write_data = ctx->get_argument_value<std::string>(0);
+
+            if (!write_data) {
+                ctx->complete(epoc::error_argument);
+                return;
+            }
         }
 
         fs_node *node = get_file_node(*handle_res);
@@ -500,7 +509,64 @@ namespace eka2l1 {
 
         // If this write pos is beyond the current end of file, use last pos
         vfs_file->seek(write_pos, file_seek_mode::beg);
-        size_t wrote_size = vfs_file->write_file(write_data.value().data(), 1, write_len);
+
+        fs_io_queue *io_queue = server<fs_server>()->get_io_queue();
+
+        if (write_data) {
+            write_len = common::min<std::int32_t>(write_len, static_cast<std::int32_t>(write_data->size()));
+        }
+
+        if (io_queue && (write_len >= static_cast<std::int32_t>(ASYNC_IO_MIN_SIZE)) && io_queue->has_slot()) {
+            // Stage the data now, the client's memory may be unmapped by the time the worker runs
+            std::shared_ptr<std::vector<std::uint8_t>> staging = std::make_shared<std::vector<std::uint8_t>>();
+
+            if (write_data) {
+                staging->assign(write_data->begin(), write_data->begin() + write_len);
+            } else {
+                staging->reserve(common::min<std::uint32_t>(static_cast<std::uint32_t>(write_len), write_view.length_));
+
+                std::optional<std::uint32_t> staged_size = ctx->consume_descriptor_argument(0, static_cast<std::uint32_t>(write_len),
+                    [&staging](std::uint8_t *data, const std::size_t size) {
+                        staging->insert(staging->end(), data, data + size);
+                        return size;
+                    });
+
+                if (!staged_size) {
+                    ctx->complete(epoc::error_argument);
+                    return;
+                }
+            }
+
+            std::shared_ptr<service::ipc_context> owned = ctx->move_to_new();
+
+            io_queue->submit(
+                client_ss_uid_, [vfs_file, staging]() {
+                    vfs_file->write_file(staging->data(), 1, static_cast<std::uint32_t>(staging->size()));
+                },
+                [owned]() {
+                    owned->complete(epoc::error_none);
+                });
+
+            return;
+        }
+
+        if (write_data) {
+            vfs_file->write_file(write_data->data(), 1, static_cast<std::uint32_t>(write_len));
+            ctx->complete(epoc::error_none);
+
+            return;
+        }
+
+        // Write straight from the client's buffer, part by part if its pages are scattered in host memory
+        std::optional<std::uint32_t> wrote_size = ctx->consume_descriptor_argument(0, static_cast<std::uint32_t>(write_len),
+            [vfs_file](std::uint8_t *data, const std::size_t size) {
+                return vfs_file->write_file(data, 1, static_cast<std::uint32_t>(size));
+            });
+
+        if (!wrote_size) {
+            ctx->complete(epoc::error_argument);
+            return;
+        }
 
         //LOG_TRACE(SERVICE_EFSRV, "File {} wroted with size: {}, at {}", common::ucs2_to_utf8(vfs_file->file_name()), wrote_size, write_pos);
 
@@ -555,11 +621,47 @@ namespace eka2l1 {
             read_len = static_cast<int>(size - read_pos);
         }
 
-        std::vector<char> read_data;
-        read_data.resize(read_len);
+        fs_io_queue *io_queue = server<fs_server>()->get_io_queue();
+        service::descriptor_host_view read_view;
+
+        if (io_queue && (read_len >= static_cast<int>(ASYNC_IO_MIN_SIZE)) && io_queue->has_slot()
+            && ctx->resolve_descriptor_argument(0, read_view, 0)) {
+            // Let the guest run other threads while the host reads. The worker reads into a staging buffer,
+            // the client's memory is only touched on finish, under the kernel lock.
+            const std::uint32_t to_read = common::min<std::uint32_t>(static_cast<std::uint32_t>(read_len), read_view.max_length_);
+
+            std::shared_ptr<service::ipc_context> owned = ctx->move_to_new();
+            std::shared_ptr<std::vector<std::uint8_t>> staging = std::make_shared<std::vector<std::uint8_t>>(to_read);
+
+            io_queue->submit(
+                client_ss_uid_, [vfs_file, staging]() {
+                    staging->resize(vfs_file->read_file(staging->data(), 1, static_cast<std::uint32_t>(staging->size())));
+                },
+                [owned, staging]() {
+                    owned->complete(copy_staged_to_descriptor(owned.get(), 0, *staging) ? epoc::error_none : epoc::error_argument);
+                });
+
+            return;
+        }
+
+        // Read straight into the client's buffer, no staging copy
+        std::optional<std::uint32_t> read_finish_len = ctx->fill_descriptor_argument(0, static_cast<std::uint32_t>(read_len),
+            [vfs_file](std::uint8_t *data, const std::size_t size) {
+                return vfs_file->read_file(data, 1, static_cast<std::uint32_t>(size));
+            });
+
+        if (!read_finish_len) {
+            // Can't be filled in place, nothing was read yet. Read into a copy instead.
+            std::vector<std::uint8_t> read_data(common::min<std::size_t>(static_cast<std::size_t>(read_len),
+                ctx->get_argument_max_data_size(0)));
 
-        size_t read_finish_len = vfs_file->read_file(read_data.data(), 1, read_len);
-        ctx->write_data_to_descriptor_argument(0, reinterpret_cast<uint8_t *>(read_data.data()), static_cast<std::uint32_t>(read_finish_len));
+            read_data.resize(vfs_file->read_file(read_data.data(), 1, static_cast<std::uint32_t>(read_data.size())));
+
+            if (!ctx->write_data_to_descriptor_argument(0, read_data.data(), static_cast<std::uint32_t>(read_data.size()))) {
+                ctx->complete(epoc::error_argument);
+                return;
+            }
+        }
 
         //LOG_TRACE(SERVICE_EFSRV, "Readed {} from {} to address 0x{:x}", read_finish_len, read_pos, ctx->msg->args.args[0]);
         ctx->complete(epoc::error_none);
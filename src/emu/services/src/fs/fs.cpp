@@ -35,6 +35,7 @@
 #include <common/path.h>
 #include <common/wildcard.h>
 
+#include <config/config.h>
 #include <kernel/kernel.h>
 #include <system/epoc.h>
 #include <vfs/vfs.h>
@@ -175,16 +176,44 @@ namespace eka2l1 {
 
         system_drive_prop->first = static_cast<int>(FS_UID);
         system_drive_prop->second = static_cast<int>(SYSTEM_DRIVE_KEY);
+
+        // Keep the number of requests in flight bounded, a client streaming a file should not take all the memory
+        static constexpr std::size_t MAX_OUTSTANDING_IO = 64;
+        const int worker_count = sys->get_config()->fs_io_worker_count;
+
+        if (worker_count > 0) {
+            io_queue_ = std::make_unique<fs_io_queue>(sys->get_kernel_system(), static_cast<std::size_t>(worker_count),
+                MAX_OUTSTANDING_IO);
+        }
     }
 
     fs_server::~fs_server() {
+        // Workers may still hold files of the sessions
+        io_queue_.reset();
+
         io_system *io = sys->get_io_system();
         for (const std::u16string &path: temporary_file_cleanset_) {
             io->delete_entry(path);
         }
     }
 
+    void fs_server::finish_pending_requests() {
+        if (io_queue_) {
+            io_queue_->drain();
+        }
+    }
+
     void fs_server_client::fetch(service::ipc_context *ctx) {
+        fs_io_queue *io_queue = server<fs_server>()->get_io_queue();
+
+        if (io_queue && io_queue->is_busy(client_ss_uid_)) {
+            // Keep the order of requests in this session, run this after what is in flight
+            std::shared_ptr<service::ipc_context> deferred = ctx->move_to_new();
+            io_queue->defer(client_ss_uid_, [this, deferred]() { fetch(deferred.get()); });
+
+            return;
+        }
+
         const epocver version = server<fs_server>()->sys->get_symbian_version_use();
 
         if (version < epocver::eka2) {
@@ -522,6 +551,16 @@ namespace eka2l1 {
     }
 
     void fs_server::disconnect(service::ipc_context &ctx) {
+        const kernel::uid session_uid = ctx.msg->msg_session->unique_id();
+
+        if (io_queue_ && io_queue_->is_busy(session_uid)) {
+            // The session's files are still in use by a worker
+            std::shared_ptr<service::ipc_context> deferred = ctx.move_to_new();
+            io_queue_->defer(session_uid, [this, deferred]() { typical_server::disconnect(*deferred); });
+
+            return;
+        }
+
         typical_server::disconnect(ctx);
     }
 
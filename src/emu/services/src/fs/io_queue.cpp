@@ -0,0 +1,165 @@
+/*
+ * Copyright (c) 2022 EKA2L1 Team.
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <services/fs/io_queue.h>
+
+#include <common/thread.h>
+#include <kernel/kernel.h>
+#include <services/context.h>
+
+#include <cstring>
+
+namespace eka2l1 {
+    fs_io_queue::fs_io_queue(kernel_system *kern, const std::size_t worker_count, const std::size_t max_outstanding)
+        : kern_(kern)
+        , max_outstanding_(max_outstanding)
+        , outstanding_(0)
+        , should_stop_(false) {
+        for (std::size_t i = 0; i < worker_count; i++) {
+            workers_.emplace_back([this]() { worker_loop(); });
+        }
+    }
+
+    fs_io_queue::~fs_io_queue() {
+        {
+            const std::lock_guard<std::mutex> guard(lock_);
+            should_stop_ = true;
+        }
+
+        operation_cond_.notify_all();
+
+        for (std::thread &worker : workers_) {
+            worker.join();
+        }
+    }
+
+    void fs_io_queue::worker_loop() {
+        common::set_thread_name("File server I/O worker");
+
+        while (true) {
+            operation op;
+
+            {
+                std::unique_lock<std::mutex> ulock(lock_);
+                operation_cond_.wait(ulock, [this]() { return should_stop_ || !operations_.empty(); });
+
+                if (should_stop_) {
+                    return;
+                }
+
+                op = std::move(operations_.front());
+                operations_.pop_front();
+            }
+
+            op.work_();
+
+            if (kern_) {
+                kern_->lock();
+            }
+
+            finish_operation(op);
+
+            if (kern_) {
+                kern_->unlock();
+            }
+        }
+    }
+
+    void fs_io_queue::finish_operation(operation &op) {
+        op.finish_();
+
+        std::unique_lock<std::mutex> ulock(lock_);
+        strand &target = strands_[op.session_];
+        target.busy_ = false;
+
+        // Dispatch the requests that came meanwhile, until one of them goes to the workers again
+        while (!target.busy_ && !target.deferred_.empty()) {
+            deferred_func next = std::move(target.deferred_.front());
+            target.deferred_.pop_front();
+
+            ulock.unlock();
+            next();
+            ulock.lock();
+        }
+
+        if (!target.busy_) {
+            strands_.erase(op.session_);
+        }
+
+        outstanding_--;
+
+        if (!outstanding_ && strands_.empty()) {
+            idle_cond_.notify_all();
+        }
+    }
+
+    bool fs_io_queue::is_busy(const kernel::uid session) {
+        const std::lock_guard<std::mutex> guard(lock_);
+        auto ite = strands_.find(session);
+
+        return (ite != strands_.end()) && ite->second.busy_;
+    }
+
+    bool fs_io_queue::has_slot() {
+        const std::lock_guard<std::mutex> guard(lock_);
+        return !workers_.empty() && (outstanding_ < max_outstanding_);
+    }
+
+    void fs_io_queue::submit(const kernel::uid session, work_func work, finish_func finish) {
+        {
+            const std::lock_guard<std::mutex> guard(lock_);
+
+            strands_[session].busy_ = true;
+            operations_.push_back(operation{ session, std::move(work), std::move(finish) });
+
+            outstanding_++;
+        }
+
+        operation_cond_.notify_one();
+    }
+
+    void fs_io_queue::defer(const kernel::uid session, deferred_func func) {
+        const std::lock_guard<std::mutex> guard(lock_);
+        strands_[session].deferred_.push_back(std::move(func));
+    }
+
+    void fs_io_queue::drain() {
+        std::unique_lock<std::mutex> ulock(lock_);
+        idle_cond_.wait(ulock, [this]() { return !outstanding_ && strands_.empty(); });
+    }
+
+    std::size_t fs_io_queue::outstanding() {
+        const std::lock_guard<std::mutex> guard(lock_);
+        return outstanding_;
+    }
+
+    bool copy_staged_to_descriptor(service::ipc_context *ctx, const int idx, const std::vector<std::uint8_t> &data) {
+        std::size_t copied = 0;
+
+        std::optional<std::uint32_t> filled = ctx->fill_descriptor_argument(idx, static_cast<std::uint32_t>(data.size()),
+            [&](std::uint8_t *dest, const std::size_t size) {
+                std::memcpy(dest, data.data() + copied, size);
+                copied += size;
+
+                return size;
+            });
+
+        return filled.has_value();
+    }
+}
@@ -26,6 +26,7 @@
 #include <services/window/bitmap_cache.h>
 #include <services/window/classes/gstore.h>
 
+#include <config/config.h>
 #include <kernel/chunk.h>
 #include <kernel/kernel.h>
 #include <system/epoc.h>
@@ -40,15 +41,14 @@
 
 #include <common/buffer.h>
 #include <common/log.h>
+#include <common/path.h>
+#include <common/pixel.h>
 #include <common/runlen.h>
 #include <common/time.h>
 
 #define XXH_INLINE_ALL
 #include <xxhash.h>
 
-// LunaSVG
-#include <lunasvg.h>
-
 namespace eka2l1::epoc {
     bitmap_cache::bitmap_cache(kernel_system *kern_)
         : fbss_(nullptr)
@@ -74,114 +74,50 @@ namespace eka2l1::epoc {
         drv->submit_command_list(retrieved);
     }
 
-    bool is_palette_bitmap(epoc::bitwise_bitmap *bw_bmp) {
-        epoc::display_mode dsp = bw_bmp->settings_.current_display_mode();
-        if (dsp == epoc::display_mode::none) {
-            dsp = bw_bmp->settings_.initial_display_mode();
-        }
+    nvg_icon_cache *bitmap_cache::get_icon_cache() {
+        if (!icon_cache_) {
+            config::state *conf = kern->get_config();
 
-        return (dsp == epoc::display_mode::color16) || (dsp == epoc::display_mode::color256);
-    }
-
-    static char *converted_one_bpp_to_twenty_four_bpp_bitmap(epoc::bitwise_bitmap *bw_bmp,
-        const std::uint32_t *original_ptr, std::size_t &raw_size) {
-        std::uint32_t byte_width_converted = common::align(bw_bmp->header_.size_pixels.x * 3, 4);
-        raw_size = byte_width_converted * bw_bmp->header_.size_pixels.y;
-
-        char *return_ptr = new char[raw_size];
-
-        for (std::size_t y = 0; y < bw_bmp->header_.size_pixels.y; y++) {
-            for (std::size_t x = 0; x < bw_bmp->header_.size_pixels.x; x++) {
-                std::uint32_t word_per_line = (bw_bmp->header_.size_pixels.x + 31) / 32;
-                std::uint32_t color = original_ptr[y * word_per_line + x / 32];
-                std::uint32_t converted_color = 0;
-                if (color & (1 << (x & 0x1F))) {
-                    converted_color = 0xFFFFFF;
-                }
+            const std::size_t budget = static_cast<std::size_t>(std::max(conf ? conf->icon_cache_size : 16, 1)) * 1024 * 1024;
+            std::string root;
 
-                std::memcpy(return_ptr + byte_width_converted * y + x * 3, reinterpret_cast<const char *>(&converted_color), 3);
+            if (conf && conf->persistent_icon_cache) {
+                root = eka2l1::add_path(conf->storage, "cache/nvg/");
             }
-        }
-        return return_ptr;
-    }
-    
-    static char *converted_gray_four_bpp_to_twenty_four_bpp_bitmap(epoc::bitwise_bitmap *bw_bmp,
-        const std::uint8_t *original_ptr, std::size_t &raw_size) {
-        std::uint32_t byte_width_converted = common::align(bw_bmp->header_.size_pixels.x * 3, 4);
-        raw_size = byte_width_converted * bw_bmp->header_.size_pixels.y;
-
-        char *return_ptr = new char[raw_size];
-        std::uint32_t scan_line_size = ((bw_bmp->header_.size_pixels.x + 7) >> 3) << 2;
-
-        for (std::size_t y = 0; y < bw_bmp->header_.size_pixels.y; y++) {
-            for (std::size_t x = 0; x < bw_bmp->header_.size_pixels.x / 2; x++) {
-                std::uint8_t gray_pack = original_ptr[y * scan_line_size + x];
-                std::uint8_t converted_color_comp_first = (gray_pack & 0xF) | ((gray_pack & 0xF) << 4);
-                std::uint8_t converted_color_comp_second = ((gray_pack & 0xF0) >> 4) | (gray_pack & 0xF0);
 
-                std::memset(return_ptr + y * byte_width_converted + x * 3 * 2, converted_color_comp_first, 3);
-                std::memset(return_ptr + y * byte_width_converted + x * 3 * 2 + 3, converted_color_comp_second, 3);
-            }
+            icon_cache_ = std::make_unique<nvg_icon_cache>(budget, root);
         }
 
-        return return_ptr;
+        return icon_cache_.get();
     }
 
-    static char *converted_palette_bitmap_to_twenty_four_bitmap(epoc::bitwise_bitmap *bw_bmp,
-        const std::uint8_t *original_ptr, epoc::palette_256 &the_palette, epoc::palette_16 &the_palette_16,
-        std::size_t &raw_size) {
-        std::uint32_t byte_width_converted = common::align(bw_bmp->header_.size_pixels.x * 3, 4);
-        raw_size = byte_width_converted * bw_bmp->header_.size_pixels.y;
-        char *return_ptr = new char[raw_size];
-
+    bool is_palette_bitmap(epoc::bitwise_bitmap *bw_bmp) {
         epoc::display_mode dsp = bw_bmp->settings_.current_display_mode();
         if (dsp == epoc::display_mode::none) {
             dsp = bw_bmp->settings_.initial_display_mode();
         }
 
-        std::uint32_t skip_width = 1;
-        if (dsp == epoc::display_mode::color16) {
-            skip_width = 2;
+        return (dsp == epoc::display_mode::color16) || (dsp == epoc::display_mode::color256);
+    }
+
+    static char *converted_bitmap_to_twenty_four_bpp(epoc::bitwise_bitmap *bw_bmp, const epoc::display_mode dsp,
+        const std::uint8_t *original_ptr, const common::rgba *palette, std::size_t &raw_size) {
+        const std::optional<common::pixel_format> source_format = epoc::get_pixel_format_from_display_mode(dsp);
+        if (!source_format.has_value()) {
+            LOG_ERROR(SERVICE_WINDOW, "Unhandled display mode to convert {}", static_cast<int>(dsp));
+            return nullptr;
         }
 
-        for (std::size_t y = 0; y < bw_bmp->header_.size_pixels.y; y++) {
-            for (std::size_t x = 0; x < bw_bmp->header_.size_pixels.x / skip_width; x++) {
-                switch (dsp) {
-                case epoc::display_mode::color256: {
-                    const std::uint8_t palette_index = original_ptr[y * bw_bmp->byte_width_ + x];
-                    const std::uint32_t palette_color = the_palette[palette_index];
-                    const std::size_t location = byte_width_converted * y + x * 3;
+        std::uint32_t byte_width_converted = common::align(bw_bmp->header_.size_pixels.x * 3, 4);
+        raw_size = byte_width_converted * bw_bmp->header_.size_pixels.y;
 
-                    return_ptr[location + 2] = palette_color & 0xFF;
-                    return_ptr[location + 1] = (palette_color >> 8) & 0xFF;
-                    return_ptr[location] = (palette_color >> 16) & 0xFF;
+        char *return_ptr = new char[raw_size];
 
-                    break;
-                }
+        common::pixel_convert_params params;
+        params.source_palette_ = palette;
 
-                case epoc::display_mode::color16: {
-                    const std::uint8_t palette_index_for_two = original_ptr[y * bw_bmp->byte_width_ + x];
-                    const std::uint32_t palette_color_first = the_palette[palette_index_for_two & 0xFFFF];
-                    const std::uint32_t palette_color_second = the_palette[(palette_index_for_two >> 4) & 0xFFFF];
-                    const std::size_t location = byte_width_converted * y + x * 3 * 2;
-
-                    return_ptr[location + 2] = palette_color_first & 0xFF;
-                    return_ptr[location + 1] = (palette_color_first >> 8) & 0xFF;
-                    return_ptr[location] = (palette_color_first >> 16) & 0xFF;
-
-                    return_ptr[location + 5] = palette_color_second & 0xFF;
-                    return_ptr[location + 4] = (palette_color_second >> 8) & 0xFF;
-                    return_ptr[location + 3] = (palette_color_second >> 16) & 0xFF;
-                    
-                    break;
-                }
-
-                default:
-                    LOG_ERROR(SERVICE_WINDOW, "Unhandled display mode to convert {}", static_cast<int>(dsp));
-                    break;
-                }
-            }
-        }
+        common::convert_pixels(common::pixel_format::color16m, return_ptr, byte_width_converted, source_format.value(), original_ptr,
+            bw_bmp->byte_width_, bw_bmp->header_.size_pixels.x, bw_bmp->header_.size_pixels.y, params);
 
         return return_ptr;
     }
@@ -192,7 +128,7 @@ namespace eka2l1::epoc {
             return 32;
         }
 
-        if (is_palette_bitmap(bmp) || (bmp->header_.bit_per_pixels == 1) || (bmp->header_.bit_per_pixels == 4)) {
+        if (is_palette_bitmap(bmp) || (bmp->header_.bit_per_pixels < 8)) {
             return 24;
         }
 
@@ -321,7 +257,8 @@ namespace eka2l1::epoc {
             if (bmp->uid_ == epoc::NVG_BITMAP_UID_REV2) {
                 // Skip the header!!
                 utils::akn_icon_header *header_icon = reinterpret_cast<utils::akn_icon_header *>(data_pointer);
-                data_pointer += header_icon->header_size_;
+                const char *nvg_data = data_pointer + header_icon->header_size_;
+                const std::uint32_t nvg_size = (compressed_size > header_icon->header_size_) ? (compressed_size - header_icon->header_size_) : 0;
 
                 std::size_t pixmap_size = bmp->header_.size_pixels.x * bmp->header_.size_pixels.y * 4;
                 pixels_per_line = bmp->header_.size_pixels.x;
@@ -335,42 +272,11 @@ namespace eka2l1::epoc {
                     std::fill(reinterpret_cast<std::uint32_t *>(data_pointer), reinterpret_cast<std::uint32_t *>(data_pointer + pixmap_size),
                         ((header_icon->icon_color_ & 0xFFFFFF) << 8) | 0xFF);
                 } else {
-                    common::ro_buf_stream nvg_in_stream(reinterpret_cast<std::uint8_t *>(data_pointer), compressed_size);
-                    common::wo_growable_buf_stream svg_out_stream;
-
-                    std::vector<loader::nvg_convert_error_description> errors;
-
-                    loader::nvg_options cvt_options;
-                    cvt_options.width = bmp->header_.size_pixels.x;
-                    cvt_options.height = bmp->header_.size_pixels.y;
-                    cvt_options.aspect_ratio_mode_ = static_cast<loader::nvg_aspect_ratio_mode>(header_icon->aspect_ratio_);
-
-                    if (!loader::convert_nvg_to_svg(nvg_in_stream, svg_out_stream, errors, &cvt_options)) {
-                        data_pointer = new char[pixmap_size];
-                        std::memset(data_pointer, 0, pixmap_size);
-
-                        LOG_ERROR(SERVICE_WINDOW, "Failed to convert NVG bitmap to SVG for rendering!");
-                    } else {
-                        data_pointer = new char[pixmap_size];
-
-                        // Render in-memory using lunasvg
-                        // Hope the performance is good! The icon/bitmap seems very small
-                        std::memset(data_pointer, 0, pixmap_size);
-
-                        const std::string svg_out_content = svg_out_stream.content();
-                        //LOG_DEBUG(SERVICE_WINDOW, "{}", svg_out_content);
-
-                        auto nvg_doc = lunasvg::Document::loadFromData(svg_out_content);
-                        if (!nvg_doc) {
-                            LOG_ERROR(SERVICE_WINDOW, "Error loading SVG in-memory, SVG content: {}", svg_out_content);
-                        } else {
-                            auto bitmap = lunasvg::Bitmap(reinterpret_cast<std::uint8_t *>(data_pointer), bmp->header_.size_pixels.x,
-                                bmp->header_.size_pixels.y, bmp->header_.size_pixels.x * 4);
+                    data_pointer = new char[pixmap_size];
 
-                            lunasvg::Matrix matrix{ 1, 0, 0, 1, 0, 0 };
-                            nvg_doc->render(bitmap, matrix);
-                        }
-                    }
+                    get_icon_cache()->get(reinterpret_cast<const std::uint8_t *>(nvg_data), nvg_size,
+                        bmp->header_.size_pixels.x, bmp->header_.size_pixels.y, static_cast<loader::nvg_aspect_ratio_mode>(header_icon->aspect_ratio_),
+                        header_icon->icon_color_, reinterpret_cast<std::uint8_t *>(data_pointer));
                 }
             } else {
                 const bitmap_file_compression comp = bmp->compression_type();
@@ -426,45 +332,30 @@ namespace eka2l1::epoc {
                 }
 
                 // GPU don't support them. Convert them on CPU
-                if (is_palette_bitmap(bmp) || (dsp == epoc::display_mode::gray16)) {
-                    char *new_pointer = nullptr;
-                    if (dsp == epoc::display_mode::gray16) {
-                        new_pointer = converted_gray_four_bpp_to_twenty_four_bpp_bitmap(bmp, reinterpret_cast<const std::uint8_t *>(data_pointer), raw_size_big);
+                if (is_palette_bitmap(bmp) || (bpp < 8)) {
+                    const common::rgba *palette = nullptr;
+
+                    if (dsp == epoc::display_mode::color256) {
+                        palette = epoc::get_suitable_palette_256(kern->get_epoc_version(), kern->get_system()->is_s80_device_active()).data();
+                    } else if (dsp == epoc::display_mode::color16) {
+                        palette = epoc::color_16_palette.data();
                     } else {
-                        new_pointer = converted_palette_bitmap_to_twenty_four_bitmap(bmp, reinterpret_cast<const std::uint8_t *>(data_pointer),
-                            epoc::get_suitable_palette_256(kern->get_epoc_version(), kern->get_system()->is_s80_device_active()),
-                            epoc::color_16_palette, raw_size_big);
+                        dsp = epoc::get_display_mode_from_bpp(bpp, false);
                     }
 
-                    bpp = 24;
-                    raw_size = static_cast<std::uint32_t>(raw_size_big);
+                    char *new_pointer = converted_bitmap_to_twenty_four_bpp(bmp, dsp, reinterpret_cast<const std::uint8_t *>(data_pointer),
+                        palette, raw_size_big);
 
-                    delete[] data_pointer;
-                    data_pointer = new_pointer;
+                    if (new_pointer) {
+                        bpp = 24;
+                        raw_size = static_cast<std::uint32_t>(raw_size_big);
 
-                    // Use default
-                    pixels_per_line = 0;
-                }
-
-                char *newly_pointer = nullptr;
-
-                switch (bpp) {
-                case 1:
-                    newly_pointer = converted_one_bpp_to_twenty_four_bpp_bitmap(bmp, reinterpret_cast<const std::uint32_t *>(data_pointer),
-                        raw_size_big);
-                    bpp = 24;
-                    raw_size = static_cast<std::uint32_t>(raw_size_big);
-                    pixels_per_line = 0;
-
-                    break;
+                        delete[] data_pointer;
+                        data_pointer = new_pointer;
 
-                default:
-                    break;
-                }
-
-                if (newly_pointer) {
-                    delete[] data_pointer;
-                    data_pointer = newly_pointer;
+                        // Use default
+                        pixels_per_line = 0;
+                    }
                 }
             }
 
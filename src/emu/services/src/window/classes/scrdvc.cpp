@@ -26,8 +26,14 @@
 
 #include <services/window/op.h>
 #include <services/window/opheader.h>
+#include <services/window/screen.h>
+#include <services/fbs/fbs.h>
 #include <utils/err.h>
 
+#include <common/algorithm.h>
+#include <common/pixel.h>
+#include <drivers/itc.h>
+
 #include <system/epoc.h>
 
 namespace eka2l1::epoc {
@@ -220,6 +226,107 @@ namespace eka2l1::epoc {
         ctx.complete(epoc::error_none);
     }
 
+    void screen_device::get_scan_line(eka2l1::service::ipc_context &ctx, eka2l1::ws_cmd &cmd) {
+        ws_cmd_get_scanline *scanline = reinterpret_cast<decltype(scanline)>(cmd.data_ptr);
+
+        const std::optional<common::pixel_format> source_format = scr->screen_buffer_pixel_format();
+        const std::optional<common::pixel_format> dest_format = get_pixel_format_from_display_mode(scanline->dmode);
+
+        if (!source_format || !dest_format) {
+            LOG_ERROR(SERVICE_WINDOW, "Unable to convert screen scanline to display mode {}", static_cast<int>(scanline->dmode));
+            ctx.complete(epoc::error_not_supported);
+            return;
+        }
+
+        const eka2l1::vec2 screen_size = scr->current_mode().size;
+
+        if ((scanline->start_pos.x < 0) || (scanline->start_pos.y < 0) || (scanline->start_pos.x >= screen_size.x)
+            || (scanline->start_pos.y >= screen_size.y) || (scanline->length < 0)) {
+            ctx.complete(epoc::error_argument);
+            return;
+        }
+
+        const std::int32_t length = common::min<std::int32_t>(scanline->length, screen_size.x - scanline->start_pos.x);
+
+        // The app is reading the screen, this is when the buffer must hold what was drawn
+        scr->sync_screen_buffer_data(client->get_ws().get_graphics_driver());
+
+        const std::uint8_t *source = scr->screen_buffer_row(scanline->start_pos.y) + scanline->start_pos.x
+            * common::get_pixel_format_bpp(source_format.value()) / 8;
+
+        std::vector<std::uint8_t> line(common::get_pixel_row_size(dest_format.value(), length));
+        common::convert_pixel_row(dest_format.value(), line.data(), source_format.value(), source, length);
+
+        ctx.write_data_to_descriptor_argument(reply_slot, line.data(), static_cast<std::uint32_t>(line.size()));
+        ctx.complete(epoc::error_none);
+    }
+
+    void screen_device::copy_screen_to_bitmap(eka2l1::service::ipc_context &ctx, eka2l1::ws_cmd &cmd, const bool has_rect) {
+        eka2l1::rect source_rect(eka2l1::vec2(0, 0), scr->current_mode().size);
+        std::uint32_t bitmap_handle = 0;
+
+        if (has_rect) {
+            ws_cmd_copy_screen_to_bitmap2 *copy_info = reinterpret_cast<decltype(copy_info)>(cmd.data_ptr);
+            eka2l1::rect copy_rect = copy_info->rect;
+            copy_rect.transform_from_symbian_rectangle();
+
+            source_rect = source_rect.intersect(copy_rect);
+            bitmap_handle = copy_info->handle;
+        } else {
+            bitmap_handle = *reinterpret_cast<std::uint32_t *>(cmd.data_ptr);
+        }
+
+        epoc::bitwise_bitmap *bmp = client->get_ws().get_bitmap(bitmap_handle);
+
+        if (!bmp) {
+            ctx.complete(epoc::error_bad_handle);
+            return;
+        }
+
+        if (bmp->compression_type() != epoc::bitmap_file_no_compression) {
+            LOG_ERROR(SERVICE_WINDOW, "Copying screen to a compressed bitmap is not supported");
+            ctx.complete(epoc::error_not_supported);
+            return;
+        }
+
+        fbs_server *serv = client->get_ws().get_fbs_server();
+
+        bool support_current_display_mode = true;
+        bool support_dirty_bitmap = true;
+
+        query_fbs_feature_support(serv, support_current_display_mode, support_dirty_bitmap);
+
+        const epoc::display_mode bmp_mode = support_current_display_mode ? bmp->settings_.current_display_mode() : bmp->settings_.initial_display_mode();
+        const std::optional<common::pixel_format> source_format = scr->screen_buffer_pixel_format();
+        const std::optional<common::pixel_format> dest_format = get_pixel_format_from_display_mode(bmp_mode);
+
+        if (!source_format || !dest_format) {
+            LOG_ERROR(SERVICE_WINDOW, "Unable to convert screen content to display mode {}", static_cast<int>(bmp_mode));
+            ctx.complete(epoc::error_not_supported);
+            return;
+        }
+
+        const int copy_width = common::min<int>(source_rect.size.x, bmp->header_.size_pixels.x);
+        const int copy_height = common::min<int>(source_rect.size.y, bmp->header_.size_pixels.y);
+
+        if ((copy_width <= 0) || (copy_height <= 0)) {
+            ctx.complete(epoc::error_none);
+            return;
+        }
+
+        scr->sync_screen_buffer_data(client->get_ws().get_graphics_driver());
+
+        const std::size_t source_offset = source_rect.top.x * common::get_pixel_format_bpp(source_format.value()) / 8;
+        std::uint8_t *dest = bmp->data_pointer(serv);
+
+        for (int y = 0; y < copy_height; y++) {
+            common::convert_pixel_row(dest_format.value(), dest + y * bmp->byte_width_, source_format.value(),
+                scr->screen_buffer_row(source_rect.top.y + y) + source_offset, copy_width);
+        }
+
+        ctx.complete(epoc::error_none);
+    }
+
     bool screen_device::execute_command(eka2l1::service::ipc_context &ctx, eka2l1::ws_cmd &cmd) {
         ws_screen_device_opcode op = static_cast<decltype(op)>(cmd.header.op);
         bool quit = false;
@@ -357,15 +464,15 @@ namespace eka2l1::epoc {
             break;
 
         case ws_sd_op_copy_screen_to_bitmap:
-        case ws_sd_op_copy_screen_to_bitmap2:
-            LOG_TRACE(SERVICE_WINDOW, "Copy screen to bitmap stubbed");
-            ctx.complete(epoc::error_none);
+            copy_screen_to_bitmap(ctx, cmd, false);
+            break;
 
+        case ws_sd_op_copy_screen_to_bitmap2:
+            copy_screen_to_bitmap(ctx, cmd, true);
             break;
 
         case ws_sd_op_get_scan_line:
-            LOG_TRACE(SERVICE_WINDOW, "Get scanline stubbed");
-            ctx.complete(epoc::error_none);
+            get_scan_line(ctx, cmd);
             break;
 
         default: {
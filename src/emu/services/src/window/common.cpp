@@ -125,6 +125,39 @@ namespace eka2l1::epoc {
         return epoc::display_mode::color_last;
     }
     
+    std::optional<common::pixel_format> get_pixel_format_from_display_mode(const display_mode disp_mode) {
+        switch (disp_mode) {
+        case epoc::display_mode::gray2:
+            return common::pixel_format::gray2;
+        case epoc::display_mode::gray4:
+            return common::pixel_format::gray4;
+        case epoc::display_mode::gray16:
+            return common::pixel_format::gray16;
+        case epoc::display_mode::gray256:
+            return common::pixel_format::gray256;
+        case epoc::display_mode::color16:
+            return common::pixel_format::color16;
+        case epoc::display_mode::color256:
+            return common::pixel_format::color256;
+        case epoc::display_mode::color4k:
+            return common::pixel_format::color4k;
+        case epoc::display_mode::color64k:
+            return common::pixel_format::color64k;
+        case epoc::display_mode::color16m:
+            return common::pixel_format::color16m;
+        case epoc::display_mode::color16mu:
+            return common::pixel_format::color16mu;
+        case epoc::display_mode::color16ma:
+            return common::pixel_format::color16ma;
+        case epoc::display_mode::color16map:
+            return common::pixel_format::color16map;
+        default:
+            break;
+        }
+
+        return std::nullopt;
+    }
+
     int get_byte_width(const std::uint32_t pixels_width, const std::uint8_t bits_per_pixel) {
         int word_width = 0;
 
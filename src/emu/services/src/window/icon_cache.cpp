@@ -0,0 +1,295 @@
+/*
+ * Copyright (c) 2022 EKA2L1 Team.
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <services/window/icon_cache.h>
+
+#include <common/buffer.h>
+#include <common/fileutils.h>
+#include <common/log.h>
+#include <common/path.h>
+
+#include <fmt/format.h>
+
+#define XXH_INLINE_ALL
+#include <xxhash.h>
+
+// LunaSVG
+#include <lunasvg.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace eka2l1::epoc {
+    static constexpr std::uint32_t NVG_ICON_CACHE_MAGIC = 0x4347564E; // NVGC
+    static constexpr std::uint32_t NVG_ICON_CACHE_VERSION = 1;
+
+    // Parsed documents are much larger than the NVG data, keep only the recently used ones
+    static constexpr std::size_t MAX_DOCUMENT_COUNT = 64;
+
+    struct nvg_icon_key_data {
+        std::uint64_t content_hash_;
+        std::int32_t width_;
+        std::int32_t height_;
+        std::uint32_t mode_;
+        std::uint32_t color_;
+    };
+
+    nvg_icon_cache::nvg_icon_cache(const std::size_t memory_budget, const std::string &root)
+        : root_(root)
+        , memory_budget_(memory_budget)
+        , memory_usage_(0)
+        , total_hits_(0)
+        , total_disk_hits_(0)
+        , total_renders_(0) {
+        if (!root_.empty()) {
+            common::create_directories(root_);
+        }
+    }
+
+    nvg_icon_cache::~nvg_icon_cache() {
+    }
+
+    std::uint64_t nvg_icon_cache::content_hash(const std::uint8_t *nvg, const std::size_t nvg_size) {
+        return XXH64(nvg, nvg_size, 0x4E564743);
+    }
+
+    std::string nvg_icon_cache::file_path(const std::uint64_t key) const {
+        return eka2l1::add_path(root_, fmt::format("{:016X}.nvgcache", key));
+    }
+
+    bool nvg_icon_cache::load_icon(const std::uint64_t key, const int width, const int height, std::vector<std::uint8_t> &pixels) {
+        common::ro_std_file_stream stream(file_path(key), true);
+
+        if (!stream.valid()) {
+            return false;
+        }
+
+        std::uint32_t header[4];
+        std::uint64_t stored_key = 0;
+
+        if (stream.read(header, sizeof(header)) != sizeof(header)) {
+            return false;
+        }
+
+        if ((header[0] != NVG_ICON_CACHE_MAGIC) || (header[1] != NVG_ICON_CACHE_VERSION) || (header[2] != static_cast<std::uint32_t>(width))
+            || (header[3] != static_cast<std::uint32_t>(height))) {
+            return false;
+        }
+
+        if ((stream.read(&stored_key, sizeof(stored_key)) != sizeof(stored_key)) || (stored_key != key)) {
+            return false;
+        }
+
+        pixels.resize(static_cast<std::size_t>(width) * height * 4);
+
+        if (stream.read(pixels.data(), pixels.size()) != pixels.size()) {
+            pixels.clear();
+            return false;
+        }
+
+        return true;
+    }
+
+    void nvg_icon_cache::save_icon(const std::uint64_t key, const int width, const int height, const std::vector<std::uint8_t> &pixels) {
+        common::wo_std_file_stream stream(file_path(key), true);
+
+        if (!stream.valid()) {
+            LOG_WARN(SERVICE_WINDOW, "Unable to write NVG icon cache file {}", file_path(key));
+            return;
+        }
+
+        const std::uint32_t header[4] = { NVG_ICON_CACHE_MAGIC, NVG_ICON_CACHE_VERSION, static_cast<std::uint32_t>(width),
+            static_cast<std::uint32_t>(height) };
+
+        stream.write(header, sizeof(header));
+        stream.write(&key, sizeof(key));
+        stream.write(pixels.data(), pixels.size());
+    }
+
+    void nvg_icon_cache::insert_icon(const std::uint64_t key, std::vector<std::uint8_t> &&pixels) {
+        memory_usage_ += pixels.size();
+
+        icons_.push_front(icon_entry{ key, std::move(pixels) });
+        icon_lookup_[key] = icons_.begin();
+
+        // Keep at least the icon just added, even if it alone is over the budget
+        while ((memory_usage_ > memory_budget_) && (icons_.size() > 1)) {
+            icon_entry &victim = icons_.back();
+
+            memory_usage_ -= victim.pixels_.size();
+            icon_lookup_.erase(victim.key_);
+            icons_.pop_back();
+        }
+    }
+
+    nvg_icon_cache::document_entry *nvg_icon_cache::get_document(const std::uint64_t content_hash, const std::uint8_t *nvg, const std::size_t nvg_size) {
+        auto ite = document_lookup_.find(content_hash);
+
+        if (ite != document_lookup_.end()) {
+            documents_.splice(documents_.begin(), documents_, ite->second);
+            return &documents_.front();
+        }
+
+        document_entry entry;
+        entry.content_hash_ = content_hash;
+
+        common::ro_buf_stream viewport_stream(const_cast<std::uint8_t *>(nvg), nvg_size);
+        if (!loader::get_nvg_viewport(viewport_stream, entry.viewport_) || (entry.viewport_[2] <= 0.0f) || (entry.viewport_[3] <= 0.0f)) {
+            LOG_ERROR(SERVICE_WINDOW, "NVG icon has no valid viewport!");
+            return nullptr;
+        }
+
+        common::ro_buf_stream nvg_in_stream(const_cast<std::uint8_t *>(nvg), nvg_size);
+        common::wo_growable_buf_stream svg_out_stream;
+
+        std::vector<loader::nvg_convert_error_description> errors;
+
+        // The document is laid out at the view box size, the target size and aspect ratio are applied at render
+        loader::nvg_options cvt_options;
+        cvt_options.width = std::max(1, static_cast<int>(std::round(entry.viewport_[2])));
+        cvt_options.height = std::max(1, static_cast<int>(std::round(entry.viewport_[3])));
+        cvt_options.aspect_ratio_mode_ = loader::NVG_NOT_PRESERVE_ASPECT_RATIO;
+
+        if (!loader::convert_nvg_to_svg(nvg_in_stream, svg_out_stream, errors, &cvt_options)) {
+            LOG_ERROR(SERVICE_WINDOW, "Failed to convert NVG bitmap to SVG for rendering!");
+            return nullptr;
+        }
+
+        const std::string svg_out_content = svg_out_stream.content();
+        entry.document_ = lunasvg::Document::loadFromData(svg_out_content);
+
+        if (!entry.document_) {
+            LOG_ERROR(SERVICE_WINDOW, "Error loading SVG in-memory, SVG content: {}", svg_out_content);
+            return nullptr;
+        }
+
+        documents_.push_front(std::move(entry));
+        document_lookup_[content_hash] = documents_.begin();
+
+        if (documents_.size() > MAX_DOCUMENT_COUNT) {
+            document_lookup_.erase(documents_.back().content_hash_);
+            documents_.pop_back();
+        }
+
+        return &documents_.front();
+    }
+
+    bool nvg_icon_cache::render_icon(document_entry &doc, const int width, const int height, const loader::nvg_aspect_ratio_mode mode,
+        std::uint8_t *dest) {
+        const double doc_width = doc.document_->width();
+        const double doc_height = doc.document_->height();
+
+        if ((doc_width <= 0.0) || (doc_height <= 0.0)) {
+            return false;
+        }
+
+        const double view_width = doc.viewport_[2];
+        const double view_height = doc.viewport_[3];
+
+        double scale_x = width / view_width;
+        double scale_y = height / view_height;
+
+        switch (mode) {
+        case loader::NVG_NOT_PRESERVE_ASPECT_RATIO:
+            break;
+
+        case loader::NVG_PRESERVE_ASPECT_RATIO_SLICE:
+            scale_x = scale_y = std::max(scale_x, scale_y);
+            break;
+
+        default:
+            scale_x = scale_y = std::min(scale_x, scale_y);
+            break;
+        }
+
+        double translate_x = 0.0;
+        double translate_y = 0.0;
+
+        // Remove unused space aligns to the top left (xMinYMin), the others center the view box (xMidYMid)
+        if ((mode == loader::NVG_PRESERVE_ASPECT_RATIO) || (mode == loader::NVG_PRESERVE_ASPECT_RATIO_SLICE)) {
+            translate_x = (width - view_width * scale_x) / 2.0;
+            translate_y = (height - view_height * scale_y) / 2.0;
+        }
+
+        // The document maps its view box to its own size, scale from there to the target
+        lunasvg::Bitmap bitmap(dest, width, height, width * 4);
+        lunasvg::Matrix matrix{ scale_x * view_width / doc_width, 0, 0, scale_y * view_height / doc_height, translate_x, translate_y };
+
+        doc.document_->render(bitmap, matrix);
+        return true;
+    }
+
+    bool nvg_icon_cache::get(const std::uint8_t *nvg, const std::size_t nvg_size, const int width, const int height,
+        const loader::nvg_aspect_ratio_mode mode, const std::uint32_t color, std::uint8_t *dest) {
+        const std::size_t pixmap_size = static_cast<std::size_t>(width) * height * 4;
+
+        if ((width <= 0) || (height <= 0)) {
+            return false;
+        }
+
+        nvg_icon_key_data key_data;
+        std::memset(&key_data, 0, sizeof(key_data));
+
+        key_data.content_hash_ = content_hash(nvg, nvg_size);
+        key_data.width_ = width;
+        key_data.height_ = height;
+        key_data.mode_ = static_cast<std::uint32_t>(mode);
+        key_data.color_ = color;
+
+        const std::uint64_t key = XXH64(&key_data, sizeof(key_data), 0);
+        auto ite = icon_lookup_.find(key);
+
+        if (ite != icon_lookup_.end()) {
+            icons_.splice(icons_.begin(), icons_, ite->second);
+            std::memcpy(dest, icons_.front().pixels_.data(), pixmap_size);
+
+            total_hits_++;
+            return true;
+        }
+
+        std::vector<std::uint8_t> pixels;
+
+        if (!root_.empty() && load_icon(key, width, height, pixels)) {
+            std::memcpy(dest, pixels.data(), pixmap_size);
+            insert_icon(key, std::move(pixels));
+
+            total_disk_hits_++;
+            return true;
+        }
+
+        std::memset(dest, 0, pixmap_size);
+
+        document_entry *doc = get_document(key_data.content_hash_, nvg, nvg_size);
+        if (!doc || !render_icon(*doc, width, height, mode, dest)) {
+            return false;
+        }
+
+        total_renders_++;
+
+        pixels.assign(dest, dest + pixmap_size);
+
+        if (!root_.empty()) {
+            save_icon(key, width, height, pixels);
+        }
+
+        insert_icon(key, std::move(pixels));
+        return true;
+    }
+}
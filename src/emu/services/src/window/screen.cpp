@@ -24,6 +24,8 @@
 #include <services/window/screen.h>
 #include <services/window/window.h>
 
+#include <common/algorithm.h>
+#include <common/log.h>
 #include <common/rgb.h>
 #include <common/time.h>
 #include <config/app_settings.h>
@@ -37,6 +39,7 @@ namespace eka2l1::epoc {
     struct window_drawer_walker : public window_tree_walker {
         drivers::graphics_command_builder &builder_;
         std::uint32_t total_redrawed_;
+        eka2l1::rect drawn_area_;
 
         explicit window_drawer_walker(drivers::graphics_command_builder &builder)
             : builder_(builder)
@@ -50,9 +53,16 @@ namespace eka2l1::epoc {
 
             epoc::canvas_base *cv = reinterpret_cast<epoc::canvas_base*>(win);
 
-            if (cv->draw(builder_))
+            if (cv->draw(builder_)) {
                 total_redrawed_++;
 
+                if (drawn_area_.empty()) {
+                    drawn_area_ = cv->abs_rect;
+                } else {
+                    drawn_area_.merge(cv->abs_rect);
+                }
+            }
+
             return false;
         }
     };
@@ -142,29 +152,141 @@ namespace eka2l1::epoc {
         }
     }
 
-    static void flip_screen_image(std::uint8_t *buffer, const std::uint32_t line_pitch, const std::uint32_t line_count) {
-        std::uint8_t *pitcher = new std::uint8_t[line_pitch];
+    void copy_screen_readback(std::uint8_t *dest, const std::uint32_t dest_pitch, const std::int32_t dest_height,
+        const std::uint8_t *source, const std::uint32_t source_pitch, const eka2l1::rect &region,
+        const std::uint32_t bytes_per_pixel, const bool flip) {
+        const std::size_t row_size = region.size.x * bytes_per_pixel;
+        dest += region.top.x * bytes_per_pixel;
 
-        for (std::size_t y = 0; y < line_count / 2; y++) {
-            std::memcpy(pitcher, buffer + y * line_pitch, line_pitch);
-            std::memmove(buffer + y * line_pitch, buffer + (line_count - y - 1) * line_pitch, line_pitch);
-            std::memmove(buffer + (line_count - y - 1) * line_pitch, pitcher, line_pitch);
+        for (std::int32_t y = 0; y < region.size.y; y++) {
+            const std::int32_t dest_y = flip ? (dest_height - 1 - region.top.y - y) : (region.top.y + y);
+            std::memcpy(dest + dest_y * dest_pitch, source + y * source_pitch, row_size);
         }
+    }
 
-        delete pitcher;
+    // The driver reads 8, 24 and 32 bpp as RGBA8888, and 12 and 16 bpp as 16-bit pixels.
+    static std::uint32_t get_screen_readback_pixel_size(const std::uint32_t bpp) {
+        return ((bpp == 12) || (bpp == 16)) ? 2 : 4;
     }
 
-    void screen::sync_screen_buffer_data(drivers::graphics_driver *driver) {
-        std::uint8_t *buffer_ptr = screen_buffer_ptr();
+    void screen::add_screen_buffer_dirty_rect(eka2l1::rect area) {
+        area = area.intersect(eka2l1::rect(eka2l1::vec2(0, 0), current_mode().size));
+
+        if (!area.valid()) {
+            return;
+        }
+
+        if (readback_dirty_.valid()) {
+            readback_dirty_.merge(area);
+        } else {
+            readback_dirty_ = area;
+        }
+    }
+
+    void screen::queue_screen_buffer_readback(drivers::graphics_command_builder &builder, drivers::graphics_driver *driver) {
+        if (!readback_dirty_.valid() || !screen_texture) {
+            return;
+        }
+
+        screen_readback &readback = readbacks_[readback_next_];
+
+        if (readback.pending_) {
+            // The ring is full. The oldest read owns this staging buffer, let it land first
+            retire_oldest_screen_buffer_readback(driver, true);
+        }
+
         const config::screen_mode &crrmode = current_mode();
+        const std::uint32_t bpp = get_bpp_from_display_mode(disp_mode);
+
+        readback.region_ = readback_dirty_;
+        readback.bytes_per_pixel_ = get_screen_readback_pixel_size(bpp);
+        readback.staging_pitch_ = common::align(readback.region_.size.x * readback.bytes_per_pixel_, 4);
+        readback.buffer_pitch_ = common::align(crrmode.size.x * readback.bytes_per_pixel_, 4);
+        readback.buffer_height_ = crrmode.size.y;
+        readback.flip_ = (crrmode.rotation == 90) || (crrmode.rotation == 180);
+        readback.status_ = -100;
+        readback.pending_ = true;
+        readback.staging_.resize(readback.staging_pitch_ * readback.region_.size.y);
+
+        drivers::handle read_source = screen_texture;
+
+        if (display_scale_factor != 1.0f) {
+            // The screen texture is scaled to fit the window. Scale the area back down to the guest size first.
+            if (!readback_texture_) {
+                readback_texture_ = drivers::create_bitmap(driver, crrmode.size, 32);
+                readback_texture_size_ = crrmode.size;
+            } else if (readback_texture_size_ != crrmode.size) {
+                builder.resize_bitmap(readback_texture_, crrmode.size);
+                readback_texture_size_ = crrmode.size;
+            }
+
+            eka2l1::rect scaled_region = readback.region_;
+            scaled_region.scale(display_scale_factor);
+
+            builder.bind_bitmap(readback_texture_);
+            builder.set_feature(drivers::graphics_feature::blend, false);
+            builder.set_feature(drivers::graphics_feature::clipping, false);
+            builder.draw_bitmap(screen_texture, 0, readback.region_, scaled_region);
+            builder.bind_bitmap(0);
+
+            read_source = readback_texture_;
+        }
+
+        builder.read_bitmap(read_source, readback.region_.top, readback.region_.size, bpp, readback.staging_.data(),
+            &readback.status_);
+
+        readback_next_ = (readback_next_ + 1) % SCREEN_READBACK_RING_SIZE;
+        readback_pending_count_++;
+        readback_dirty_.make_empty();
+    }
+
+    bool screen::retire_oldest_screen_buffer_readback(drivers::graphics_driver *driver, const bool wait) {
+        if (!readback_pending_count_) {
+            return false;
+        }
+
+        screen_readback &readback = readbacks_[(readback_next_ + SCREEN_READBACK_RING_SIZE - readback_pending_count_)
+            % SCREEN_READBACK_RING_SIZE];
+
+        if (wait) {
+            driver->wait_for(&readback.status_);
+        } else {
+            const std::unique_lock<std::mutex> ulock(driver->mut_);
+            if (readback.status_ == -100) {
+                return false;
+            }
+        }
+
+        if (readback.status_ <= 0) {
+            LOG_WARN(SERVICE_WINDOW, "Screen {} readback failed, the screen buffer may be out of date", number);
+        } else if (screen_buffer_chunk) {
+            copy_screen_readback(screen_buffer_ptr(), readback.buffer_pitch_, readback.buffer_height_, readback.staging_.data(),
+                readback.staging_pitch_, readback.region_, readback.bytes_per_pixel_, readback.flip_);
+        }
+
+        readback.pending_ = false;
+        readback_pending_count_--;
 
-        drivers::read_bitmap(driver, screen_texture, eka2l1::point(0, 0), eka2l1::object_size(crrmode.size),
-            get_bpp_from_display_mode(disp_mode), buffer_ptr);
+        return true;
+    }
+
+    void screen::retire_screen_buffer_readbacks(drivers::graphics_driver *driver, const bool wait) {
+        while (retire_oldest_screen_buffer_readback(driver, wait)) {
+        }
+    }
+
+    void screen::sync_screen_buffer_data(drivers::graphics_driver *driver) {
+        if (readback_dirty_.valid()) {
+            drivers::graphics_command_builder builder;
+            queue_screen_buffer_readback(builder, driver);
 
-        if ((crrmode.rotation == 90) || (crrmode.rotation == 180)) {
-            const std::uint32_t current_pitch = epoc::get_byte_width(crrmode.size.x, epoc::get_bpp_from_display_mode(disp_mode));
-            flip_screen_image(buffer_ptr, current_pitch, crrmode.size.y);
+            if (!builder.is_empty()) {
+                drivers::command_list retrieved = builder.retrieve_command_list();
+                driver->submit_command_list(retrieved);
+            }
         }
+
+        retire_screen_buffer_readbacks(driver, true);
     }
 
     bool screen::redraw(drivers::graphics_command_builder &builder, const bool need_bind) {
@@ -194,6 +316,12 @@ namespace eka2l1::epoc {
         window_drawer_walker adrawwalker(builder);
         root->walk_tree(&adrawwalker, window_tree_walk_style::bonjour_children);
 
+        if (flags_ & FLAG_SERVER_REDRAW_PENDING) {
+            add_screen_buffer_dirty_rect(eka2l1::rect(eka2l1::vec2(0, 0), current_mode().size));
+        } else if (adrawwalker.total_redrawed_) {
+            add_screen_buffer_dirty_rect(adrawwalker.drawn_area_);
+        }
+
         // Done! Unbind and submit this to the driver
         builder.bind_bitmap(0);
 
@@ -208,23 +336,33 @@ namespace eka2l1::epoc {
             set_screen_mode(nullptr, driver, crr_mode);
         }
 
+        if (sync_screen_buffer) {
+            // Reads queued with the previous frames have most likely landed by now. Apps that map the
+            // buffer read it without asking, so publish them, but never wait on the driver here.
+            retire_screen_buffer_readbacks(driver, false);
+        }
+
         // Make command list first, and bind our screen bitmap
         drivers::graphics_command_builder builder;
         const bool performed = redraw(builder, true);
+
+        if (performed && sync_screen_buffer) {
+            // Read back with the frame's own command list, only the area the walker drew
+            queue_screen_buffer_readback(builder, driver);
+        }
     
         eka2l1::drivers::command_list retrieved = builder.retrieve_command_list();
         driver->submit_command_list(retrieved);
 
-        if (performed && sync_screen_buffer && (display_scale_factor == 1.0f)) {
-            sync_screen_buffer_data(driver);
-        }
-
         fire_screen_redraw_callbacks(false);
     }
 
     void screen::deinit(drivers::graphics_driver *driver) {
         // Make command list first, and bind our screen bitmap
         if (driver) {
+            // Staging buffers die with the screen
+            retire_screen_buffer_readbacks(driver, true);
+
             drivers::graphics_command_builder builder;
 
             if (dsa_texture) {
@@ -235,6 +373,11 @@ namespace eka2l1::epoc {
                 builder.destroy_bitmap(screen_texture);
             }
 
+            if (readback_texture_) {
+                builder.destroy_bitmap(readback_texture_);
+                readback_texture_ = 0;
+            }
+
             eka2l1::drivers::command_list retrieved = builder.retrieve_command_list();
             driver->submit_command_list(retrieved);
         }
@@ -256,6 +399,10 @@ namespace eka2l1::epoc {
 
         eka2l1::vec2 screen_size_scaled = current_mode().size * display_scale_factor;
 
+        // The guest buffer layout changes with the mode, don't let older reads land in it
+        retire_screen_buffer_readbacks(driver, true);
+        add_screen_buffer_dirty_rect(eka2l1::rect(eka2l1::vec2(0, 0), current_mode().size));
+
         if (!screen_texture) {
             // Create new one!
             screen_texture = drivers::create_bitmap(driver, screen_size_scaled, 32);
@@ -268,12 +415,12 @@ namespace eka2l1::epoc {
 
         const bool performed = redraw(builder, need_bind);
 
-        eka2l1::drivers::command_list retrieved = builder.retrieve_command_list();
-        driver->submit_command_list(retrieved);
-
         if (performed && sync_screen_buffer) {
-            sync_screen_buffer_data(driver);
+            queue_screen_buffer_readback(builder, driver);
         }
+
+        eka2l1::drivers::command_list retrieved = builder.retrieve_command_list();
+        driver->submit_command_list(retrieved);
     }
 
     static epoc::window_group *find_group_to_focus(epoc::window *root) {
@@ -573,6 +720,30 @@ namespace eka2l1::epoc {
         return reinterpret_cast<std::uint8_t *>(screen_buffer_chunk->host_base()) + sizeof(std::uint16_t) * WORD_PALETTE_ENTRIES_COUNT;
     }
 
+    std::uint8_t *screen::screen_buffer_row(const int y) {
+        const config::screen_mode &crrmode = current_mode();
+        const std::uint32_t pitch = common::align(crrmode.size.x * get_screen_readback_pixel_size(get_bpp_from_display_mode(disp_mode)), 4);
+        const int row = ((crrmode.rotation == 90) || (crrmode.rotation == 180)) ? (crrmode.size.y - 1 - y) : y;
+
+        return screen_buffer_ptr() + row * pitch;
+    }
+
+    std::optional<common::pixel_format> screen::screen_buffer_pixel_format() const {
+        switch (get_bpp_from_display_mode(disp_mode)) {
+        case 12:
+            // Read back as RGBA4444, which no display mode uses
+            return std::nullopt;
+
+        case 16:
+            return common::pixel_format::color64k;
+
+        default:
+            break;
+        }
+
+        return common::pixel_format::rgba8888;
+    }
+
     struct window_visible_region_calc_walker: public window_tree_walker {
         common::region visible_left_region_;
         bool trigger_redraw_;
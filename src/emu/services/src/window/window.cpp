@@ -60,6 +60,7 @@
 
 #include <loader/rom.h>
 
+#include <cstring>
 #include <optional>
 #include <string>
 
@@ -128,38 +129,34 @@ namespace eka2l1::epoc {
     }
 
     void window_server_client::parse_command_buffer(service::ipc_context &ctx) {
-        std::optional<std::string> dat = ctx.get_argument_value<std::string>(cmd_slot);
+        service::descriptor_host_view view;
 
-        if (!dat) {
+        if (!ctx.resolve_descriptor_argument(cmd_slot, view) || !view.data_) {
             return;
         }
 
-        char *beg = dat->data();
-        char *end = dat->data() + dat->size();
+        std::uint8_t *data = view.data_;
 
-        std::vector<ws_cmd> cmds;
+        if (view.contiguous_length_ < view.length_) {
+            // The buffer crosses pages that are apart in host memory, gather them once
+            cmd_buffer_copy.resize(view.length_);
+            std::size_t copied = 0;
 
-        while (beg < end) {
-            ws_cmd cmd;
+            ctx.consume_descriptor_argument(cmd_slot, view.length_, [&](std::uint8_t *part, const std::size_t size) {
+                std::memcpy(cmd_buffer_copy.data() + copied, part, size);
+                copied += size;
 
-            cmd.header = *reinterpret_cast<ws_cmd_header *>(beg);
-
-            if (cmd.header.op & 0x8000) {
-                cmd.header.op &= ~0x8000;
-                cmd.obj_handle = *reinterpret_cast<std::uint32_t *>(beg + sizeof(ws_cmd_header));
+                return size;
+            });
 
-                beg += sizeof(ws_cmd_header) + sizeof(cmd.obj_handle);
-            } else {
-                beg += sizeof(ws_cmd_header);
+            if (copied != view.length_) {
+                return;
             }
 
-            cmd.data_ptr = reinterpret_cast<void *>(beg);
-            beg += cmd.header.cmd_len;
-
-            cmds.push_back(std::move(cmd));
+            data = cmd_buffer_copy.data();
         }
 
-        execute_commands(ctx, std::move(cmds));
+        execute_commands(ctx, ws_cmd_reader(data, view.length_));
     }
 
     window_server_client::window_server_client(service::session *guest_session, kernel::thread *own_thread, epoc::version ver)
@@ -171,8 +168,10 @@ namespace eka2l1::epoc {
         , uid_counter(0) {
     }
 
-    void window_server_client::execute_commands(service::ipc_context &ctx, std::vector<ws_cmd> cmds) {
-        for (auto &cmd : cmds) {
+    void window_server_client::execute_commands(service::ipc_context &ctx, ws_cmd_reader reader) {
+        ws_cmd cmd;
+
+        while (reader.next(cmd)) {
             if (cmd.obj_handle == guest_session->unique_id()) {
                 if (last_obj) {
                     last_obj->on_command_batch_done(ctx);
@@ -202,6 +201,10 @@ namespace eka2l1::epoc {
             last_obj->on_command_batch_done(ctx);
             last_obj = nullptr;
         }
+
+        if (reader.truncated()) {
+            LOG_WARN(SERVICE_WINDOW, "Command buffer ends in the middle of a command, the rest is skipped");
+        }
     }
 
     std::uint32_t window_server_client::queue_redraw(epoc::canvas_base *user, const eka2l1::rect &redraw_rect) {
@@ -23,6 +23,7 @@ namespace eka2l1::preset {
     static const char *ROM_FOLDER_PATH = "roms//";
     static const char *DRIVE_FOLDER_PATH = "drives//";
     static const char *ROM_FILENAME = "SYM.ROM";
+    static const char *ROM_INDEX_FILENAME = "SYM.ROM.IDX";
 
     enum system_cpu_hz {
         SYSTEM_CPU_HZ_S60V1 = 104000000,
@@ -21,6 +21,8 @@
 #include <common/configure.h>
 
 #include <common/algorithm.h>
+#include <common/benchmark.h>
+#include <common/buffer.h>
 #include <common/chunkyseri.h>
 #include <common/container.h>
 #include <common/cvt.h>
@@ -68,6 +70,7 @@
 #include <vfs/vfs.h>
 
 #include <cpu/arm_factory.h>
+#include <cpu/arm_tiered.h>
 #include <cpu/arm_utils.h>
 
 #include <config/app_settings.h>
@@ -80,6 +83,8 @@
 
 #include <miniz.h>
 
+#include <cstddef>
+
 namespace eka2l1 {
     // https://www.techiedelight.com/check-if-a-string-ends-with-another-string-in-cpp/
     // This should be in C++ 20. So put a temporary for now here.
@@ -188,8 +193,9 @@ namespace eka2l1 {
             debugger_ = new_debugger;
         }
 
-        void setup_outsider() {
+        void setup_outsider(common::stage_benchmarker &boot_timer) {
             service::init_services(parent_);
+            boot_timer.end_stage("services");
 
             // Try to set system language
             set_system_language(static_cast<language>(conf_->language));
@@ -201,6 +207,8 @@ namespace eka2l1 {
                 dispatcher_->set_graphics_driver(gdriver);
             }
 
+            boot_timer.end_stage("hal and dispatcher");
+
             winserv_ = reinterpret_cast<window_server *>(kern_->get_by_name<service::server>(eka2l1::get_winserv_name_by_epocver(
                 kern_->get_epoc_version())));
             packages_->var_resolver = [&](const int int_val) -> int {
@@ -569,7 +577,7 @@ namespace eka2l1 {
         void do_state(common::chunkyseri &seri);
 
         package::installation_result install_package(std::u16string path, drive_number drv);
-        bool load_rom(const std::string &path);
+        bool load_rom(const std::string &path, common::stage_benchmarker &boot_timer);
 
         void request_exit();
         bool should_exit() const {
@@ -600,6 +608,10 @@ namespace eka2l1 {
         exmonitor = arm::create_exclusive_monitor(cpu_type, 1);
         cpu = arm::create_core(exmonitor.get(), cpu_type);
 
+        if (cpu_type == arm_emulator_type::tiered) {
+            static_cast<arm::tiered_core *>(cpu.get())->set_hot_block_threshold(conf_->tiered_hot_block_threshold);
+        }
+
         kern_ = std::make_unique<kernel_system>(parent_, timing_.get(), io_.get(), conf_, app_settings_, &romf_, cpu.get(),
             disassembler_.get());
 
@@ -619,6 +631,16 @@ namespace eka2l1 {
 #else
         cpu_type = /*arm::string_to_arm_emulator_type(conf_->cpu_backend);*/ arm_emulator_type::dynarmic;
 #endif
+
+        // The tiered core uses the recompiler picked above for hot code, if it can translate ahead of time
+        if (arm::string_to_arm_emulator_type(conf_->cpu_backend) == arm_emulator_type::tiered) {
+#if EKA2L1_ARCH(ARM)
+            cpu_type = arm_emulator_type::tiered;
+#else
+            LOG_WARN(SYSTEM, "Tiered execution is only available with 12l1r on 32-bit ARM hosts, using {}",
+                arm::arm_emulator_type_to_string(cpu_type));
+#endif
+        }
         dvcmngr_ = std::make_unique<device_manager>(conf_);
 
         disassembler_ = std::make_unique<disasm>();
@@ -723,6 +745,8 @@ namespace eka2l1 {
         }
 
         if (to_run != nullptr) {
+            mem_->get_mmu(cpu.get())->apply_pending_maintenance();
+
             if (!should_step) {
                 cpu->run(to_run->get_remaining_screenticks());
             } else {
@@ -751,23 +775,61 @@ namespace eka2l1 {
         return packages_->install_package(path, drv);
     }
 
-    bool system_impl::load_rom(const std::string &path) {
-        symfile f = eka2l1::physical_file_proxy(path, READ_MODE | BIN_MODE);
+    bool system_impl::load_rom(const std::string &path, common::stage_benchmarker &boot_timer) {
+        address rom_base = 0;
+
+        {
+            // Only the base is needed to map the ROM, the rest of the header is parsed from the mapping
+            common::ro_std_file_stream rom_header_stream(path, true);
+
+            if (!rom_header_stream.valid()) {
+                LOG_ERROR(SYSTEM, "ROM file not present: {}", path);
+                return false;
+            }
+
+            rom_header_stream.seek(offsetof(loader::rom_header, rom_base), common::seek_where::beg);
+
+            if (rom_header_stream.read(&rom_base, sizeof(rom_base)) != sizeof(rom_base)) {
+                LOG_ERROR(SYSTEM, "ROM file is too small: {}", path);
+                return false;
+            }
+        }
 
-        if (!f || !f->valid()) {
-            LOG_ERROR(SYSTEM, "ROM file not present: {}", path);
+        if (!kern_->map_rom(rom_base, path)) {
             return false;
         }
 
-        eka2l1::ro_file_stream rom_fstream(f.get());
-        std::optional<loader::rom> romf_res = loader::load_rom(reinterpret_cast<common::ro_stream *>(
-            &rom_fstream));
+        boot_timer.end_stage("rom map");
+
+        // Parse from the mapping, instead of seeking and reading the file in small parts
+        common::ro_buf_stream rom_stream(const_cast<std::uint8_t *>(kern_->get_rom_map()), kern_->get_rom_size());
+
+        // The directory tree is saved next to the ROM, so later boots do not walk the whole ROM to build it
+        const std::string index_path = eka2l1::add_path(eka2l1::file_directory(path), preset::ROM_INDEX_FILENAME);
+        std::unique_ptr<common::ro_std_file_stream> index_stream;
+
+        if (conf_->persistent_rom_index) {
+            index_stream = std::make_unique<common::ro_std_file_stream>(index_path, true);
+
+            if (!index_stream->valid()) {
+                index_stream.reset();
+            }
+        }
+
+        std::optional<loader::rom> romf_res = loader::load_rom(reinterpret_cast<common::ro_stream *>(&rom_stream),
+            reinterpret_cast<common::ro_stream *>(index_stream.get()));
 
         if (!romf_res) {
             return false;
         }
 
-        rom_fstream.seek(0, common::seek_where::beg);
+        if (conf_->persistent_rom_index && !romf_res->index.restored) {
+            common::wo_std_file_stream index_out_stream(index_path, true);
+
+            if (!index_out_stream.valid() || !romf_res->save_index(&index_out_stream)) {
+                LOG_WARN(SYSTEM, "Unable to save ROM index to {}", index_path);
+            }
+        }
 
         romf_ = std::move(*romf_res);
 
@@ -784,12 +846,7 @@ namespace eka2l1 {
             rom_fs_id_ = io_->add_filesystem(rom_fs);
         }
 
-        bool res1 = kern_->map_rom(romf_.header.rom_base, path);
-
-        if (!res1) {
-            return false;
-        }
-
+        boot_timer.end_stage(romf_.index.restored ? "rom tree (saved index)" : "rom tree");
         return true;
     }
 
@@ -1159,6 +1216,8 @@ namespace eka2l1 {
             start_access();
         }
 
+        common::stage_benchmarker boot_timer;
+
         if ((index >= 0) && (static_cast<std::size_t>(index) >= dvcmngr_->total())) {
             if (lock_sys) {
                 end_access();
@@ -1183,10 +1242,7 @@ namespace eka2l1 {
             dispatcher_->shutdown(gdriver);
         }
 
-        if (cpu) {
-            cpu->clear_instruction_cache();
-        }
-
+        // Kernel reset invalidates translated code of the pages it unmaps
         if (kern_) {
             kern_->reset();
         }
@@ -1219,12 +1275,12 @@ namespace eka2l1 {
         io_->set_product_code(dvc->firmware_code);
         set_symbian_version_use(dvc->ver);
 
-        cpu->clear_instruction_cache();
+        boot_timer.end_stage("kernel reset");
 
         // Load ROM
         const std::string rom_path = add_path(conf_->storage, add_path(preset::ROM_FOLDER_PATH, add_path(common::lowercase_string(dvc->firmware_code), preset::ROM_FILENAME)));
 
-        if (!load_rom(rom_path)) {
+        if (!load_rom(rom_path, boot_timer)) {
             if (lock_sys) {
                 end_access();
             }
@@ -1241,8 +1297,12 @@ namespace eka2l1 {
         }
 
         // Setup outsiders
-        setup_outsider();
+        setup_outsider(boot_timer);
+
         invoke_system_reset_callbacks();
+        boot_timer.end_stage("reset callbacks");
+
+        LOG_INFO(SYSTEM, "Boot stages: {}", boot_timer.summary());
 
         if (lock_sys) {
             end_access();
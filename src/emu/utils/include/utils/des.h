@@ -85,7 +85,21 @@ namespace eka2l1::epoc {
             info |= (dtype << 28);
         }
 
-        void *get_pointer_raw(eka2l1::kernel::process *pr);
+        /**
+         * \brief Get the host pointer of the descriptor data.
+         *
+         * \param pr        The process which the descriptor belongs.
+         * \param char_size Size of a character in bytes. The whole capacity of the descriptor is made readable.
+         */
+        void *get_pointer_raw(eka2l1::kernel::process *pr, const std::uint32_t char_size = 1);
+
+        /**
+         * \brief Get the guest address of the descriptor data.
+         *
+         * \param pr   The process which the descriptor belongs.
+         * \param self Guest address of this descriptor.
+         */
+        address get_pointer_address(eka2l1::kernel::process *pr, const address self);
 
         int assign_raw(eka2l1::kernel::process *pr, const std::uint8_t *data,
             const std::uint32_t size);
@@ -99,7 +113,7 @@ namespace eka2l1::epoc {
     struct desc : public desc_base {
     public:
         T *get_pointer(eka2l1::kernel::process *pr) {
-            return reinterpret_cast<T *>(get_pointer_raw(pr));
+            return reinterpret_cast<T *>(get_pointer_raw(pr, sizeof(T)));
         }
 
         std::basic_string<T> to_std_string(eka2l1::kernel::process *pr) {
@@ -127,7 +141,7 @@ namespace eka2l1::epoc {
          */
         int assign(eka2l1::kernel::process *pr, const std::uint8_t *data,
             const std::uint32_t size) {
-            std::uint8_t *des_buf = reinterpret_cast<std::uint8_t *>(get_pointer_raw(pr));
+            std::uint8_t *des_buf = reinterpret_cast<std::uint8_t *>(get_pointer_raw(pr, sizeof(T)));
             des_type dtype = get_descriptor_type();
 
             std::uint32_t real_len = size / sizeof(T);
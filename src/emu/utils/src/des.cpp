@@ -69,33 +69,49 @@ namespace eka2l1::epoc {
         }
     }
 
-    void *desc_base::get_pointer_raw(eka2l1::kernel::process *pr) {
+    // Inline data follows the descriptor header. Literals live in code, where the data may run onto
+    // pages that are not filled yet, while the header page is.
+    static void *get_inline_data(eka2l1::kernel::process *pr, const desc_base *header, std::uint8_t *data, const std::size_t size) {
+        static constexpr std::uintptr_t PAGE_BITS = 12;
+
+        const std::uintptr_t header_page = reinterpret_cast<std::uintptr_t>(header) >> PAGE_BITS;
+        const std::uintptr_t last_page = (reinterpret_cast<std::uintptr_t>(data) + size - 1) >> PAGE_BITS;
+
+        if (pr && size && (last_page != header_page)) {
+            fill_raw_host_range(pr, data, size);
+        }
+
+        return data;
+    }
+
+    void *desc_base::get_pointer_raw(eka2l1::kernel::process *pr, const std::uint32_t char_size) {
         des_type dtype = get_descriptor_type();
+        const std::size_t data_size = static_cast<std::size_t>(get_max_length(pr)) * char_size;
 
         switch (dtype) {
         case ptr_const: {
             ptr_desc<std::uint8_t> *des = reinterpret_cast<decltype(des)>(this);
-            return des->data.cast<void>().get(pr);
+            return des->data.cast<void>().get(pr, data_size);
         }
 
         case ptr: {
             ptr_des<std::uint8_t> *des = reinterpret_cast<decltype(des)>(this);
-            return des->data.cast<void>().get(pr);
+            return des->data.cast<void>().get(pr, data_size);
         }
 
         case buf_const: {
             buf_desc<std::uint8_t> *des = reinterpret_cast<decltype(des)>(this);
-            return &(des->data[0]);
+            return get_inline_data(pr, this, &(des->data[0]), data_size);
         }
 
         case buf: {
             buf_des<std::uint8_t> *des = reinterpret_cast<decltype(des)>(this);
-            return &(des->data[0]);
+            return get_inline_data(pr, this, &(des->data[0]), data_size);
         }
 
         case ptr_to_buf: {
             ptr_des<std::uint8_t> *pbuf = reinterpret_cast<decltype(pbuf)>(this);
-            buf_desc<std::uint8_t> *hbufc = pbuf->data.cast<buf_desc<std::uint8_t>>().get(pr);
+            buf_desc<std::uint8_t> *hbufc = pbuf->data.cast<buf_desc<std::uint8_t>>().get(pr, sizeof(desc_base) + data_size);
 
             return &(hbufc->data[0]);
         }
@@ -107,6 +123,32 @@ namespace eka2l1::epoc {
         return nullptr;
     }
 
+    address desc_base::get_pointer_address(eka2l1::kernel::process *pr, const address self) {
+        des_type dtype = get_descriptor_type();
+
+        switch (dtype) {
+        case ptr_const:
+            return reinterpret_cast<ptr_desc<std::uint8_t> *>(this)->data.ptr_address();
+
+        case ptr:
+            return reinterpret_cast<ptr_des<std::uint8_t> *>(this)->data.ptr_address();
+
+        case buf_const:
+            return self + sizeof(desc<std::uint8_t>);
+
+        case buf:
+            return self + sizeof(des<std::uint8_t>);
+
+        case ptr_to_buf:
+            return reinterpret_cast<ptr_des<std::uint8_t> *>(this)->data.ptr_address() + sizeof(desc<std::uint8_t>);
+
+        default:
+            break;
+        }
+
+        return 0;
+    }
+
     rw_des_stream::rw_des_stream(epoc::des8 *des, kernel::process *pr)
         : des_(des)
         , pr_(pr)
@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2022 EKA2L1 Team.
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <common/types.h>
+#include <common/watcher.h>
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace eka2l1 {
+    /**
+     * \brief Cache of virtual paths resolved to host paths, for the physical filesystem.
+     *
+     * Paths are kept in a trie per drive, with one node per lowercased path component. A node remembers
+     * its host path, and whether the host entry exists and of what kind. Missing entries are cached too,
+     * since apps probe many resource paths that are not there.
+     *
+     * What is known about existence is kept coherent by watching the host directories that cached entries
+     * live in. A change in a directory drops what is known about the changed child and everything below it.
+     * Children of a missing entry are known missing without asking the host. When the watcher can not
+     * report changes on this platform, only host paths are cached.
+     */
+    class physical_path_cache {
+    public:
+        enum entry_kind {
+            entry_kind_unknown,
+            entry_kind_missing,
+            entry_kind_file,
+            entry_kind_directory
+        };
+
+    private:
+        struct watched_directory;
+
+        struct node {
+            node *parent_ = nullptr;
+            std::unordered_map<std::u16string, std::unique_ptr<node>> children_;
+
+            std::u16string host_path_;
+            entry_kind kind_ = entry_kind_unknown;
+            watched_directory *watch_ = nullptr;
+        };
+
+        struct watched_directory {
+            physical_path_cache *cache_;
+            std::string host_path_;
+            std::int32_t handle_ = 0;
+            std::vector<node *> nodes_;
+            bool stale_ = false;
+        };
+
+        // Drop everything once the trie gets this big, long sessions should not grow it forever
+        static constexpr std::size_t MAX_NODES = 32768;
+
+        std::array<std::unique_ptr<node>, drive_count> drives_;
+        std::unordered_map<std::string, std::unique_ptr<watched_directory>> watched_;
+
+        common::directory_watcher *watcher_;
+        std::mutex lock_;
+        std::size_t node_count_;
+
+        node *walk(const std::u16string &vert_path, const bool create, bool *has_trailing_separator = nullptr,
+            node **deepest = nullptr);
+
+        entry_kind query_kind(node *target);
+        bool ensure_watched(node *dir);
+
+        void forget_kinds(node *target);
+        void release_node(node *target);
+        void clear_drive_unlocked(const drive_number drv);
+
+        void handle_changes(watched_directory *dir, const common::directory_changes &changes);
+
+    public:
+        /**
+         * \brief Create the cache.
+         *
+         * \param watcher   Watcher used to keep existence coherent. Null to only cache host paths. It must stop
+         *                  calling back before the cache is destroyed.
+         */
+        explicit physical_path_cache(common::directory_watcher *watcher);
+
+        /**
+         * \brief Get the cached host path of a virtual path.
+         *
+         * The virtual path must already have the drive's path translations done.
+         */
+        std::optional<std::u16string> find_host_path(const std::u16string &vert_path);
+
+        /**
+         * \brief Remember the host path of a virtual path.
+         *
+         * Paths that are not in a plain form, such as ones with dot components or repeated separators,
+         * are not cached.
+         */
+        void add_host_path(const std::u16string &vert_path, const std::u16string &host_path);
+
+        /**
+         * \brief Get the kind of the host entry a virtual path resolves to.
+         *
+         * \returns Unknown if the path is not cached, or the kind can not be kept coherent. The caller
+         *          should ask the host in that case.
+         */
+        entry_kind get_entry_kind(const std::u16string &vert_path);
+
+        /**
+         * \brief Forget what is known about an entry, its parents and everything below it.
+         *
+         * Call this after changing the entry through the emulator, without waiting for the watcher.
+         */
+        void invalidate(const std::u16string &vert_path);
+
+        void clear_drive(const drive_number drv);
+        void clear();
+
+        std::size_t size();
+    };
+}
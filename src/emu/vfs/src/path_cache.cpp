@@ -0,0 +1,395 @@
+/*
+ * Copyright (c) 2022 EKA2L1 Team.
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <vfs/path_cache.h>
+
+#include <common/algorithm.h>
+#include <common/cvt.h>
+#include <common/fileutils.h>
+#include <common/path.h>
+
+#include <algorithm>
+#include <cwctype>
+
+namespace eka2l1 {
+    static constexpr const char16_t *VIRTUAL_SEPARATORS = u"\\/";
+
+    physical_path_cache::physical_path_cache(common::directory_watcher *watcher)
+        : watcher_(watcher)
+        , node_count_(0) {
+    }
+
+    physical_path_cache::node *physical_path_cache::walk(const std::u16string &vert_path, const bool create,
+        bool *has_trailing_separator, node **deepest) {
+        if (has_trailing_separator) {
+            *has_trailing_separator = false;
+        }
+
+        // Only take paths with a drive and at least one component after the root
+        if ((vert_path.size() < 4) || (vert_path[1] != u':') || !eka2l1::is_separator(vert_path[2])) {
+            return nullptr;
+        }
+
+        const char16_t letter = static_cast<char16_t>(std::towlower(vert_path[0]));
+
+        if ((letter < u'a') || (letter > u'z')) {
+            return nullptr;
+        }
+
+        std::unique_ptr<node> &root = drives_[letter - u'a'];
+
+        if (!root) {
+            if (!create) {
+                return nullptr;
+            }
+
+            root = std::make_unique<node>();
+            node_count_++;
+        }
+
+        node *current = root.get();
+        std::size_t pos = 3;
+
+        while (pos < vert_path.size()) {
+            std::size_t next = vert_path.find_first_of(VIRTUAL_SEPARATORS, pos);
+
+            if (next == std::u16string::npos) {
+                next = vert_path.size();
+            }
+
+            // Repeated separators do not resolve to the same host string, leave those alone
+            if (next == pos) {
+                return nullptr;
+            }
+
+            const std::u16string component = common::lowercase_ucs2_string(vert_path.substr(pos, next - pos));
+
+            if ((component == u".") || (component == u"..")) {
+                return nullptr;
+            }
+
+            auto ite = current->children_.find(component);
+
+            if (ite == current->children_.end()) {
+                if (!create) {
+                    if (deepest) {
+                        *deepest = current;
+                    }
+
+                    return nullptr;
+                }
+
+                std::unique_ptr<node> child = std::make_unique<node>();
+                child->parent_ = current;
+
+                ite = current->children_.emplace(component, std::move(child)).first;
+                node_count_++;
+            }
+
+            current = ite->second.get();
+            pos = next + 1;
+
+            if ((pos == vert_path.size()) && has_trailing_separator) {
+                *has_trailing_separator = true;
+            }
+        }
+
+        if (deepest) {
+            *deepest = current;
+        }
+
+        return current;
+    }
+
+    std::optional<std::u16string> physical_path_cache::find_host_path(const std::u16string &vert_path) {
+        const std::lock_guard<std::mutex> guard(lock_);
+
+        bool trailing_separator = false;
+        node *target = walk(vert_path, false, &trailing_separator);
+
+        if (!target || target->host_path_.empty()) {
+            return std::nullopt;
+        }
+
+        if (trailing_separator) {
+            return target->host_path_ + static_cast<char16_t>(eka2l1::get_separator());
+        }
+
+        return target->host_path_;
+    }
+
+    void physical_path_cache::add_host_path(const std::u16string &vert_path, const std::u16string &host_path) {
+        const std::lock_guard<std::mutex> guard(lock_);
+
+        if (node_count_ >= MAX_NODES) {
+            for (std::size_t i = 0; i < drives_.size(); i++) {
+                clear_drive_unlocked(static_cast<drive_number>(i));
+            }
+        }
+
+        bool trailing_separator = false;
+        node *target = walk(vert_path, true, &trailing_separator);
+
+        if (!target || !target->host_path_.empty()) {
+            return;
+        }
+
+        std::u16string path = host_path;
+
+        if (trailing_separator) {
+            while (!path.empty() && eka2l1::is_separator(path.back())) {
+                path.pop_back();
+            }
+        }
+
+        target->host_path_ = path;
+
+        // Components map one to one to the host, so parents resolve by stripping the last one
+        for (node *parent = target->parent_; parent && parent->host_path_.empty(); parent = parent->parent_) {
+            const std::size_t last_separator = path.find_last_of(VIRTUAL_SEPARATORS);
+
+            if (last_separator == std::u16string::npos) {
+                break;
+            }
+
+            path.erase(last_separator);
+            parent->host_path_ = path;
+        }
+    }
+
+    static physical_path_cache::entry_kind get_host_entry_kind(const std::u16string &host_path) {
+        switch (common::get_file_type(common::ucs2_to_utf8(host_path))) {
+        case common::FILE_INVALID:
+            return physical_path_cache::entry_kind_missing;
+
+        case common::FILE_DIRECTORY:
+            return physical_path_cache::entry_kind_directory;
+
+        default:
+            break;
+        }
+
+        return physical_path_cache::entry_kind_file;
+    }
+
+    physical_path_cache::entry_kind physical_path_cache::query_kind(node *target) {
+        if (target->kind_ != entry_kind_unknown) {
+            return target->kind_;
+        }
+
+        if (target->host_path_.empty()) {
+            return entry_kind_unknown;
+        }
+
+        if (!target->parent_) {
+            // Nothing watches a drive root from above, only remember that it is there
+            const entry_kind kind = get_host_entry_kind(target->host_path_);
+
+            if (kind == entry_kind_directory) {
+                target->kind_ = kind;
+            }
+
+            return kind;
+        }
+
+        const entry_kind parent_kind = query_kind(target->parent_);
+
+        if ((parent_kind == entry_kind_missing) || (parent_kind == entry_kind_file)) {
+            // Nothing can be inside. Stays valid for as long as the parent's kind is.
+            if (target->parent_->kind_ != entry_kind_unknown) {
+                target->kind_ = entry_kind_missing;
+            }
+
+            return entry_kind_missing;
+        }
+
+        const entry_kind kind = get_host_entry_kind(target->host_path_);
+
+        if ((parent_kind == entry_kind_directory) && ensure_watched(target->parent_)) {
+            target->kind_ = kind;
+        }
+
+        return kind;
+    }
+
+    bool physical_path_cache::ensure_watched(node *dir) {
+        if (!watcher_ || !watcher_->can_notify()) {
+            return false;
+        }
+
+        if (dir->watch_ && !dir->watch_->stale_ && (dir->watch_->handle_ > 0)) {
+            return true;
+        }
+
+        const std::string host_path = common::ucs2_to_utf8(dir->host_path_);
+        std::unique_ptr<watched_directory> &entry = watched_[host_path];
+
+        if (!entry) {
+            entry = std::make_unique<watched_directory>();
+            entry->cache_ = this;
+            entry->host_path_ = host_path;
+        }
+
+        watched_directory *watch = entry.get();
+
+        if ((watch->handle_ <= 0) || watch->stale_) {
+            // A directory that was removed and made again needs a new watch. Watching an existing
+            // one again is harmless.
+            watch->handle_ = watcher_->watch(
+                host_path, [](void *userdata, common::directory_changes &changes) {
+                    watched_directory *watch = reinterpret_cast<watched_directory *>(userdata);
+                    watch->cache_->handle_changes(watch, changes);
+                },
+                watch, common::directory_change_move | common::directory_change_last_write);
+
+            watch->stale_ = false;
+
+            if (watch->handle_ <= 0) {
+                watch->handle_ = 0;
+                return false;
+            }
+        }
+
+        if (dir->watch_ != watch) {
+            dir->watch_ = watch;
+            watch->nodes_.push_back(dir);
+        }
+
+        return true;
+    }
+
+    void physical_path_cache::forget_kinds(node *target) {
+        target->kind_ = entry_kind_unknown;
+
+        for (auto &[name, child] : target->children_) {
+            forget_kinds(child.get());
+        }
+    }
+
+    void physical_path_cache::handle_changes(watched_directory *watch, const common::directory_changes &changes) {
+        const std::lock_guard<std::mutex> guard(lock_);
+
+        static constexpr std::uint32_t STRUCTURE_CHANGES = common::directory_change_action_created | common::directory_change_action_delete
+            | common::directory_change_action_moved_from | common::directory_change_action_moved_to;
+
+        for (const common::directory_change &change : changes) {
+            // Recursive watchers report paths below the directory, the first component is what changed here
+            const std::string name = change.filename_.substr(0, change.filename_.find_first_of("\\/"));
+            const std::u16string name_lower = common::lowercase_ucs2_string(common::utf8_to_ucs2(name));
+
+            for (node *dir : watch->nodes_) {
+                if (name_lower.empty()) {
+                    forget_kinds(dir);
+                    continue;
+                }
+
+                auto ite = dir->children_.find(name_lower);
+
+                if (ite == dir->children_.end()) {
+                    continue;
+                }
+
+                forget_kinds(ite->second.get());
+
+                if ((change.change_ & STRUCTURE_CHANGES) && ite->second->watch_) {
+                    ite->second->watch_->stale_ = true;
+                }
+            }
+        }
+    }
+
+    physical_path_cache::entry_kind physical_path_cache::get_entry_kind(const std::u16string &vert_path) {
+        const std::lock_guard<std::mutex> guard(lock_);
+        node *target = walk(vert_path, false);
+
+        if (!target) {
+            return entry_kind_unknown;
+        }
+
+        return query_kind(target);
+    }
+
+    void physical_path_cache::invalidate(const std::u16string &vert_path) {
+        const std::lock_guard<std::mutex> guard(lock_);
+
+        node *deepest = nullptr;
+        walk(vert_path, false, nullptr, &deepest);
+
+        if (!deepest) {
+            return;
+        }
+
+        // Entries below a missing parent were never watched. If the parent now exists, all of them
+        // must be asked again.
+        node *top = deepest;
+
+        while (top->parent_ && (top->parent_->kind_ != entry_kind_directory)) {
+            top = top->parent_;
+        }
+
+        if (top->watch_) {
+            top->watch_->stale_ = true;
+        }
+
+        forget_kinds(top);
+    }
+
+    void physical_path_cache::release_node(node *target) {
+        if (target->watch_) {
+            std::vector<node *> &nodes = target->watch_->nodes_;
+            nodes.erase(std::remove(nodes.begin(), nodes.end(), target), nodes.end());
+        }
+
+        for (auto &[name, child] : target->children_) {
+            release_node(child.get());
+        }
+
+        node_count_--;
+    }
+
+    void physical_path_cache::clear_drive_unlocked(const drive_number drv) {
+        std::unique_ptr<node> &root = drives_[static_cast<std::size_t>(drv)];
+
+        if (!root) {
+            return;
+        }
+
+        // The host watches stay, and are reused if the same directories get cached again
+        release_node(root.get());
+        root.reset();
+    }
+
+    void physical_path_cache::clear_drive(const drive_number drv) {
+        const std::lock_guard<std::mutex> guard(lock_);
+        clear_drive_unlocked(drv);
+    }
+
+    void physical_path_cache::clear() {
+        const std::lock_guard<std::mutex> guard(lock_);
+
+        for (std::size_t i = 0; i < drives_.size(); i++) {
+            clear_drive_unlocked(static_cast<drive_number>(i));
+        }
+    }
+
+    std::size_t physical_path_cache::size() {
+        const std::lock_guard<std::mutex> guard(lock_);
+        return node_count_;
+    }
+}
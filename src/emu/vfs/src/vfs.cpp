@@ -29,6 +29,7 @@
 #include <loader/rom.h>
 #include <mem/mem.h>
 #include <mem/ptr.h>
+#include <vfs/path_cache.h>
 #include <vfs/vfs.h>
 
 #include <array>
@@ -586,6 +587,7 @@ namespace eka2l1 {
     class physical_file_system : public abstract_file_system {
         std::mutex fs_mutex;
         std::unique_ptr<common::directory_watcher> watcher_;
+        std::unique_ptr<physical_path_cache> path_cache_;
 
     protected:
         std::string firmcode;
@@ -653,11 +655,65 @@ namespace eka2l1 {
 
             // Mark as mapped
             mappings[static_cast<int>(drv)].second = true;
+            path_cache_->clear_drive(drv);
 
             return true;
         }
 
+        // Apply the path translations of the drive layout, in place
+        void translate_virtual_path(std::u16string &vert_path) {
+            if ((static_cast<int>(ver) >= static_cast<int>(epocver::eka2)) && (vert_path.size() > 2)) {
+                if (common::compare_ignore_case(u"\\system\\libs", vert_path.substr(2, 12)) == 0) {
+                    vert_path.replace(2, 12, u"\\sys\\bin");
+                } else if (common::compare_ignore_case(u"\\system\\programs", vert_path.substr(2, 16)) == 0) {
+                    vert_path.replace(2, 16, u"\\sys\\bin");
+                }
+            }
+        }
+
+        // Get the host entry type of a path resolved earlier, from the cache when it is known
+        common::file_type get_host_entry_type(const std::u16string &vert_path, const std::u16string &real_path) {
+            std::u16string lookup_path = vert_path;
+            translate_virtual_path(lookup_path);
+
+            switch (path_cache_->get_entry_kind(lookup_path)) {
+            case physical_path_cache::entry_kind_missing:
+                return common::FILE_INVALID;
+
+            case physical_path_cache::entry_kind_file:
+                return common::FILE_REGULAR;
+
+            case physical_path_cache::entry_kind_directory:
+                return common::FILE_DIRECTORY;
+
+            default:
+                break;
+            }
+
+            return common::get_file_type(common::ucs2_to_utf8(real_path));
+        }
+
+        // Forget cached existence of an entry the emulator is about to change
+        void invalidate_entry(const std::u16string &vert_path) {
+            std::u16string lookup_path = vert_path;
+            translate_virtual_path(lookup_path);
+
+            path_cache_->invalidate(lookup_path);
+        }
+
         std::optional<std::u16string> get_real_physical_path(const std::u16string &vert_path, bool *is_root = nullptr) {
+            std::u16string vert_path_copy = vert_path;
+            translate_virtual_path(vert_path_copy);
+
+            // Cached paths have no dot components and are never a drive root
+            if (std::optional<std::u16string> cached = path_cache_->find_host_path(vert_path_copy)) {
+                if (is_root) {
+                    *is_root = false;
+                }
+
+                return cached;
+            }
+
             const std::int32_t stack_level = path_stack_level(vert_path);
 
             if (stack_level < 0) {
@@ -670,7 +726,6 @@ namespace eka2l1 {
 
             std::string path_ucs8 = common::ucs2_to_utf8(vert_path);
             const std::string root = eka2l1::root_name(path_ucs8);
-            std::u16string vert_path_copy = vert_path;
 
             if (root == "" || !mappings[ascii_to_drive_number(static_cast<char>(std::towlower(root[0])))].second) {
                 return std::nullopt;
@@ -692,35 +747,38 @@ namespace eka2l1 {
                 map_path += common::utf8_to_ucs2(common::lowercase_string(firmcode));
             }
 
-            if (static_cast<int>(ver) >= static_cast<int>(epocver::eka2)) {
-                if (common::compare_ignore_case(u"\\system\\libs", vert_path_copy.substr(2, 12)) == 0) {
-                    vert_path_copy.replace(2, 12, u"\\sys\\bin");
-                } else if (common::compare_ignore_case(u"\\system\\programs", vert_path_copy.substr(2, 16)) == 0) {
-                    vert_path_copy.replace(2, 16, u"\\sys\\bin");
-                }
-            }
-
             std::u16string vert_path_no_root = vert_path_copy.substr(root.size());
 
             if (!common::is_system_case_insensitive()) {
                 vert_path_no_root = common::lowercase_ucs2_string(vert_path_no_root);
             }
 
-            return eka2l1::add_path(map_path, vert_path_no_root);
+            const std::u16string result = eka2l1::add_path(map_path, vert_path_no_root);
+            path_cache_->add_host_path(vert_path_copy, result);
+
+            return result;
         }
 
     public:
         explicit physical_file_system(epocver ver, const std::string &product_code)
             : ver(ver)
             , firmcode(product_code)
-            , watcher_(nullptr) {
+            , watcher_(std::make_unique<common::directory_watcher>()) {
             for (auto &[drv, mapped] : mappings) {
                 mapped = false;
             }
+
+            path_cache_ = std::make_unique<physical_path_cache>(watcher_.get());
+        }
+
+        ~physical_file_system() {
+            // Stop the change callbacks before the cache goes
+            watcher_.reset();
         }
 
         void set_epoc_ver(const epocver ever) override {
             ver = ever;
+            path_cache_->clear();
         }
 
         std::optional<std::u16string> get_raw_path(const std::u16string &path) override {
@@ -734,16 +792,20 @@ namespace eka2l1 {
                 return false;
             }
 
-            return common::remove(common::ucs2_to_utf8(*path_real));
+            const bool result = common::remove(common::ucs2_to_utf8(*path_real));
+            invalidate_entry(path);
+
+            return result;
         }
 
         void set_product_code(const std::string &pc) override {
             firmcode = pc;
+            path_cache_->clear();
         }
 
         bool exists(const std::u16string &path) override {
             std::optional<std::u16string> real_path = get_real_physical_path(path);
-            return real_path ? common::exists(common::ucs2_to_utf8(*real_path)) : false;
+            return real_path ? (get_host_entry_type(path, *real_path) != common::FILE_INVALID) : false;
         }
 
         bool replace(const std::u16string &old_path, const std::u16string &new_path) override {
@@ -754,8 +816,13 @@ namespace eka2l1 {
                 return false;
             }
 
-            return common::move_file(common::ucs2_to_utf8(*old_path_real),
+            const bool result = common::move_file(common::ucs2_to_utf8(*old_path_real),
                 common::ucs2_to_utf8(*new_path_real));
+
+            invalidate_entry(old_path);
+            invalidate_entry(new_path);
+
+            return result;
         }
 
         bool create_directories(const std::u16string &path) override {
@@ -766,6 +833,8 @@ namespace eka2l1 {
             }
 
             common::create_directories(common::ucs2_to_utf8(*real_path));
+            invalidate_entry(path);
+
             return true;
         }
 
@@ -777,6 +846,7 @@ namespace eka2l1 {
             }
 
             common::create_directory(common::ucs2_to_utf8(*real_path));
+            invalidate_entry(path);
 
             return true;
         }
@@ -793,6 +863,7 @@ namespace eka2l1 {
         bool unmount(const drive_number drv) override {
             if (mappings[static_cast<int>(drv)].second) {
                 mappings[static_cast<int>(drv)].second = false;
+                path_cache_->clear_drive(drv);
 
                 for (auto &watch_handle : watches[drv]) {
                     if (watcher_) {
@@ -853,7 +924,7 @@ namespace eka2l1 {
 
             std::string new_path_utf8 = common::ucs2_to_utf8(*new_path);
 
-            if (!common::exists(new_path_utf8)) {
+            if (get_host_entry_type(vir_path, *new_path) == common::FILE_INVALID) {
                 return std::unique_ptr<directory>(nullptr);
             }
 
@@ -872,15 +943,16 @@ namespace eka2l1 {
                 return std::nullopt;
             }
 
-            std::string real_path_utf8 = common::ucs2_to_utf8(*real_path);
+            const common::file_type host_type = get_host_entry_type(path, *real_path);
 
-            if (!common::exists(real_path_utf8)) {
+            if (host_type == common::FILE_INVALID) {
                 return std::nullopt;
             }
 
+            std::string real_path_utf8 = common::ucs2_to_utf8(*real_path);
             entry_info info;
 
-            if (common::is_file(real_path_utf8, common::FILE_DIRECTORY)) {
+            if (host_type == common::FILE_DIRECTORY) {
                 info.type = io_component_type::dir;
                 info.size = 0;
             } else {
@@ -930,13 +1002,22 @@ namespace eka2l1 {
                 return nullptr;
             }
 
-            std::string real_path_utf8 = common::ucs2_to_utf8(*real_path);
+            if (!(mode & WRITE_MODE)) {
+                const common::file_type host_type = get_host_entry_type(path, *real_path);
 
-            if (!(mode & WRITE_MODE) && (!common::exists(real_path_utf8) || common::is_file(real_path_utf8, common::FILE_DIRECTORY))) {
-                return nullptr;
+                if ((host_type == common::FILE_INVALID) || (host_type == common::FILE_DIRECTORY)) {
+                    return nullptr;
+                }
+            }
+
+            std::unique_ptr<physical_file> result = std::make_unique<physical_file>(path, *real_path, mode);
+
+            if (mode & WRITE_MODE) {
+                // Opening may have created the file
+                invalidate_entry(path);
             }
 
-            return std::make_unique<physical_file>(path, *real_path, mode);
+            return result;
         }
 
         std::int64_t watch_directory(const std::u16string &path, common::directory_watcher_callback callback,
@@ -1045,7 +1126,7 @@ namespace eka2l1 {
                 return abstract_file_system_err_code::no;
             }
 
-            if (rom_cache->burn_tree_find_entry(common::ucs2_to_utf8(path))) {
+            if (rom_cache->burn_tree_find_entry(path)) {
                 return abstract_file_system_err_code::ok;
             }
 
@@ -1073,7 +1154,7 @@ namespace eka2l1 {
                 }
             }
 
-            auto entry = rom_cache->burn_tree_find_entry(common::ucs2_to_utf8(new_path));
+            auto entry = rom_cache->burn_tree_find_entry(new_path);
             auto ff = physical_file_system::open_file(new_path, mode);
 
             // Dont change order!
@@ -1090,7 +1171,7 @@ namespace eka2l1 {
                 return std::nullopt;
             }
 
-            auto entry = rom_cache->burn_tree_find_entry(common::ucs2_to_utf8(path));
+            auto entry = rom_cache->burn_tree_find_entry(path);
 
             if (!entry) {
                 return physical_file_system::get_entry_info(path);
@@ -1112,7 +1193,7 @@ namespace eka2l1 {
             loader::rom_dir *the_base_dir = &(rom_cache->root.root_dirs[0].dir);
 
             if (!the_base_path.empty()) {
-                the_base_dir = rom_cache->burn_tree_find_dir(common::ucs2_to_utf8(clue));
+                the_base_dir = rom_cache->burn_tree_find_dir(clue);
             }
 
             if (!the_base_dir) {
@@ -0,0 +1,250 @@
+/*
+ * Copyright (c) 2022 EKA2L1 Team.
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+#include <common/log.h>
+#include <common/pixel.h>
+
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace eka2l1;
+
+static constexpr std::array<common::pixel_format, 13> ALL_PIXEL_FORMATS = {
+    common::pixel_format::gray2, common::pixel_format::gray4, common::pixel_format::gray16, common::pixel_format::gray256,
+    common::pixel_format::color16, common::pixel_format::color256, common::pixel_format::color4k, common::pixel_format::color64k,
+    common::pixel_format::color16m, common::pixel_format::color16mu, common::pixel_format::color16ma, common::pixel_format::color16map,
+    common::pixel_format::rgba8888
+};
+
+static std::vector<std::uint8_t> make_random_bytes(std::mt19937 &rng, const std::size_t size) {
+    std::vector<std::uint8_t> data(size);
+
+    for (auto &byte : data) {
+        byte = static_cast<std::uint8_t>(rng());
+    }
+
+    return data;
+}
+
+// Distinct colours, so that matching back to the palette is exact
+static std::array<common::rgba, 256> make_test_palette() {
+    std::array<common::rgba, 256> palette;
+
+    for (std::uint32_t i = 0; i < 256; i++) {
+        palette[i] = ((i * 37) & 0xFF) | (((i * 101 + 13) & 0xFF) << 8) | (((255 - i) & 0xFF) << 16);
+    }
+
+    return palette;
+}
+
+static std::uint32_t convert_to_rgba(const common::pixel_format format, const std::vector<std::uint8_t> &source, const std::size_t index,
+    const common::rgba *palette = nullptr) {
+    std::vector<std::uint32_t> result(index + 1);
+
+    common::pixel_convert_params params;
+    params.source_palette_ = palette;
+    params.kernels_ = common::pixel_kernel_set::scalar;
+
+    common::convert_pixel_row(common::pixel_format::rgba8888, result.data(), format, source.data(), index + 1, params);
+    return result[index];
+}
+
+TEST_CASE("pixel_scalar_reference", "pixel") {
+    REQUIRE(convert_to_rgba(common::pixel_format::color64k, { 0x00, 0xF8 }, 0) == 0xFF0000FF);
+    REQUIRE(convert_to_rgba(common::pixel_format::color64k, { 0xE0, 0x07 }, 0) == 0xFF00FF00);
+    REQUIRE(convert_to_rgba(common::pixel_format::color64k, { 0x1F, 0x00 }, 0) == 0xFFFF0000);
+    REQUIRE(convert_to_rgba(common::pixel_format::color4k, { 0x5A, 0x0F }, 0) == 0xFFAA55FF);
+    REQUIRE(convert_to_rgba(common::pixel_format::color16m, { 0x10, 0x20, 0x30 }, 0) == 0xFF102030);
+    REQUIRE(convert_to_rgba(common::pixel_format::color16mu, { 0x10, 0x20, 0x30, 0x00 }, 0) == 0xFF102030);
+    REQUIRE(convert_to_rgba(common::pixel_format::color16ma, { 0x10, 0x20, 0x30, 0x40 }, 0) == 0x40102030);
+
+    // Pixels smaller than a byte start from the lowest bits
+    REQUIRE(convert_to_rgba(common::pixel_format::gray2, { 0x05 }, 0) == 0xFFFFFFFF);
+    REQUIRE(convert_to_rgba(common::pixel_format::gray2, { 0x05 }, 1) == 0xFF000000);
+    REQUIRE(convert_to_rgba(common::pixel_format::gray2, { 0x05 }, 2) == 0xFFFFFFFF);
+    REQUIRE(convert_to_rgba(common::pixel_format::gray4, { 0xE4 }, 1) == 0xFF555555);
+    REQUIRE(convert_to_rgba(common::pixel_format::gray4, { 0xE4 }, 2) == 0xFFAAAAAA);
+    REQUIRE(convert_to_rgba(common::pixel_format::gray16, { 0x3C }, 0) == 0xFFCCCCCC);
+    REQUIRE(convert_to_rgba(common::pixel_format::gray16, { 0x3C }, 1) == 0xFF333333);
+
+    const std::array<common::rgba, 16> palette = { 0x00000000, 0x00112233, 0x00445566 };
+    REQUIRE(convert_to_rgba(common::pixel_format::color16, { 0x21 }, 0, palette.data()) == 0xFF112233);
+    REQUIRE(convert_to_rgba(common::pixel_format::color16, { 0x21 }, 1, palette.data()) == 0xFF445566);
+    REQUIRE(convert_to_rgba(common::pixel_format::color256, { 0x00, 0x02 }, 1, palette.data()) == 0xFF445566);
+
+    // Premultiplied (R 128, G 64, B 64, A 128) is (255, 128, 128) straight
+    REQUIRE(convert_to_rgba(common::pixel_format::color16map, { 64, 64, 128, 128 }, 0) == 0x808080FF);
+    REQUIRE(convert_to_rgba(common::pixel_format::color16map, { 10, 20, 30, 0 }, 0) == 0);
+
+    std::uint8_t premultiplied[4] = { 0 };
+    const std::uint32_t straight = 0x808080FF;
+
+    common::pixel_convert_params params;
+    params.kernels_ = common::pixel_kernel_set::scalar;
+
+    common::convert_pixel_row(common::pixel_format::color16map, premultiplied, common::pixel_format::rgba8888, &straight, 1, params);
+
+    REQUIRE(premultiplied[0] == 64);
+    REQUIRE(premultiplied[1] == 64);
+    REQUIRE(premultiplied[2] == 128);
+    REQUIRE(premultiplied[3] == 128);
+}
+
+TEST_CASE("pixel_round_trips_through_rgba8888", "pixel") {
+    static constexpr std::size_t PIXEL_COUNT = 520;
+
+    std::mt19937 rng(0x9E11);
+    const std::array<common::rgba, 256> palette = make_test_palette();
+
+    common::pixel_convert_params params;
+    params.source_palette_ = palette.data();
+    params.dest_palette_ = palette.data();
+
+    // The premultiplied format loses precision on the way, it is compared against the kernels instead
+    for (const common::pixel_format format : ALL_PIXEL_FORMATS) {
+        if (format == common::pixel_format::color16map) {
+            continue;
+        }
+
+        std::vector<std::uint8_t> source = make_random_bytes(rng, common::get_pixel_row_size(format, PIXEL_COUNT));
+
+        if (format == common::pixel_format::color4k) {
+            for (std::size_t i = 1; i < source.size(); i += 2) {
+                source[i] &= 0x0F;
+            }
+        } else if (format == common::pixel_format::color16mu) {
+            for (std::size_t i = 3; i < source.size(); i += 4) {
+                source[i] = 0xFF;
+            }
+        }
+
+        std::vector<std::uint8_t> rgba(PIXEL_COUNT * 4);
+        std::vector<std::uint8_t> back(source.size());
+
+        common::convert_pixel_row(common::pixel_format::rgba8888, rgba.data(), format, source.data(), PIXEL_COUNT, params);
+        common::convert_pixel_row(format, back.data(), common::pixel_format::rgba8888, rgba.data(), PIXEL_COUNT, params);
+
+        INFO("format " << static_cast<int>(format));
+        REQUIRE(back == source);
+    }
+}
+
+TEST_CASE("pixel_kernel_sets_match_scalar", "pixel") {
+    static constexpr std::size_t PIXEL_COUNTS[] = { 1, 7, 16, 33, 300, 1031 };
+    static constexpr common::pixel_kernel_set KERNEL_SETS[] = { common::pixel_kernel_set::sse2, common::pixel_kernel_set::avx2,
+        common::pixel_kernel_set::neon };
+
+    std::mt19937 rng(0x51D0);
+    const std::array<common::rgba, 256> palette = make_test_palette();
+
+    for (const common::pixel_kernel_set set : KERNEL_SETS) {
+        if (!common::is_pixel_kernel_set_supported(set)) {
+            continue;
+        }
+
+        for (const common::pixel_format source_format : ALL_PIXEL_FORMATS) {
+            for (const common::pixel_format dest_format : ALL_PIXEL_FORMATS) {
+                for (const std::size_t count : PIXEL_COUNTS) {
+                    // Start one byte in, so that no kernel relies on aligned rows
+                    const std::vector<std::uint8_t> source = make_random_bytes(rng, common::get_pixel_row_size(source_format, count) + 1);
+                    const std::size_t dest_size = common::get_pixel_row_size(dest_format, count) + 1;
+
+                    std::vector<std::uint8_t> expected(dest_size, 0xCD);
+                    std::vector<std::uint8_t> result(dest_size, 0xCD);
+
+                    common::pixel_convert_params params;
+                    params.source_palette_ = palette.data();
+                    params.dest_palette_ = palette.data() + 128;
+                    params.kernels_ = common::pixel_kernel_set::scalar;
+
+                    common::convert_pixel_row(dest_format, expected.data() + 1, source_format, source.data() + 1, count, params);
+
+                    params.kernels_ = set;
+                    common::convert_pixel_row(dest_format, result.data() + 1, source_format, source.data() + 1, count, params);
+
+                    INFO("set " << static_cast<int>(set) << " from " << static_cast<int>(source_format) << " to "
+                                << static_cast<int>(dest_format) << ", " << count << " pixels");
+                    REQUIRE(result == expected);
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("pixel_conversion_throughput", "pixel") {
+    static constexpr std::size_t WIDTH = 1024;
+    static constexpr std::size_t HEIGHT = 768;
+    static constexpr int ROUNDS = 8;
+
+    static constexpr std::pair<common::pixel_format, common::pixel_format> CONVERSIONS[] = {
+        { common::pixel_format::gray2, common::pixel_format::rgba8888 },
+        { common::pixel_format::gray256, common::pixel_format::rgba8888 },
+        { common::pixel_format::color256, common::pixel_format::rgba8888 },
+        { common::pixel_format::color64k, common::pixel_format::rgba8888 },
+        { common::pixel_format::color16m, common::pixel_format::rgba8888 },
+        { common::pixel_format::color16ma, common::pixel_format::rgba8888 },
+        { common::pixel_format::color16map, common::pixel_format::rgba8888 },
+        { common::pixel_format::rgba8888, common::pixel_format::color64k },
+        { common::pixel_format::rgba8888, common::pixel_format::color16map },
+        { common::pixel_format::color256, common::pixel_format::color16m }
+    };
+
+    std::mt19937 rng(0x7A57);
+    const std::array<common::rgba, 256> palette = make_test_palette();
+    const common::pixel_kernel_set best = common::get_best_pixel_kernel_set();
+
+    const auto time_conversion = [&](const common::pixel_format dest_format, std::vector<std::uint8_t> &dest,
+                                     const common::pixel_format source_format, const std::vector<std::uint8_t> &source,
+                                     const common::pixel_kernel_set set) {
+        common::pixel_convert_params params;
+        params.source_palette_ = palette.data();
+        params.kernels_ = set;
+
+        const auto start = std::chrono::steady_clock::now();
+
+        for (int i = 0; i < ROUNDS; i++) {
+            common::convert_pixels(dest_format, dest.data(), common::get_pixel_row_size(dest_format, WIDTH), source_format, source.data(),
+                common::get_pixel_row_size(source_format, WIDTH), WIDTH, HEIGHT, params);
+        }
+
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    };
+
+    for (const auto &[source_format, dest_format] : CONVERSIONS) {
+        const std::vector<std::uint8_t> source = make_random_bytes(rng, common::get_pixel_row_size(source_format, WIDTH) * HEIGHT);
+
+        std::vector<std::uint8_t> scalar_dest(common::get_pixel_row_size(dest_format, WIDTH) * HEIGHT);
+        std::vector<std::uint8_t> best_dest(scalar_dest.size());
+
+        const double scalar_seconds = time_conversion(dest_format, scalar_dest, source_format, source, common::pixel_kernel_set::scalar);
+        const double best_seconds = time_conversion(dest_format, best_dest, source_format, source, best);
+
+        const double megapixels = static_cast<double>(WIDTH * HEIGHT * ROUNDS) / 1000000.0;
+
+        LOG_INFO(COMMON, "Pixel conversion {} -> {}: scalar {:.0f} MP/s, kernel set {} {:.0f} MP/s ({:.2f}x)", static_cast<int>(source_format),
+            static_cast<int>(dest_format), megapixels / scalar_seconds, static_cast<int>(best), megapixels / best_seconds,
+            scalar_seconds / best_seconds);
+
+        REQUIRE(best_dest == scalar_dest);
+    }
+}
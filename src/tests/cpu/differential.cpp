@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2022 EKA2L1 Team.
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+#include <common/log.h>
+
+#include "harness.h"
+
+using namespace eka2l1;
+using namespace eka2l1::arm::test;
+
+static void run_differential(const workload &work) {
+    // The first available backend, normally the interpreter, is the reference. Every other backend
+    // must end in the exact same state.
+    const std::vector<arm_emulator_type> backends = available_backends();
+    run_result reference;
+    bool have_reference = false;
+
+    for (std::size_t i = 0; i < backends.size(); i++) {
+        cpu_env env(backends[i]);
+
+        if (!env.valid()) {
+            WARN("Backend " << backend_name(backends[i]) << " is not available");
+            continue;
+        }
+
+        const run_result result = env.run(work);
+
+        LOG_INFO(CPU, "{} on {}: {} instructions, {:.2f} MIPS, {:.2f} ms compile, {:.1f} callbacks/Minstr, {} code reads",
+            work.name_, backend_name(backends[i]), result.instructions_, result.mips(), result.compile_ms(),
+            result.callback_rate(), result.code_reads_);
+
+        INFO("Workload " << work.name_ << " on " << backend_name(backends[i]));
+        REQUIRE(result.finished_);
+
+        if (!have_reference) {
+            reference = result;
+            have_reference = true;
+
+            continue;
+        }
+
+        const std::vector<std::string> divergences = compare_results(reference, result);
+
+        for (const std::string &divergence : divergences) {
+            UNSCOPED_INFO(divergence);
+        }
+
+        REQUIRE(divergences.empty());
+    }
+}
+
+TEST_CASE("cpu_differential_standard_workloads", "cpu") {
+    for (const workload &work : standard_workloads()) {
+        run_differential(work);
+    }
+}
+
+TEST_CASE("cpu_warm_run_reuses_translation", "cpu") {
+    // Warm runs execute the same code again without translating or decoding any of it another time
+    const workload work = standard_workloads().front();
+
+    for (const arm_emulator_type type : available_backends()) {
+        cpu_env env(type);
+
+        if (!env.valid()) {
+            continue;
+        }
+
+        const run_result result = env.run(work, 2);
+
+        INFO("Backend " << backend_name(type));
+        REQUIRE(result.finished_);
+        REQUIRE(result.code_reads_ > 0);
+        REQUIRE(result.warm_instructions_ == result.instructions_ * 2);
+        REQUIRE(result.warm_code_reads_ == 0);
+    }
+}
@@ -0,0 +1,863 @@
+/*
+ * Copyright (c) 2022 EKA2L1 Team.
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "harness.h"
+
+#include <common/virtualmem.h>
+#include <cpu/arm_tiered.h>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <random>
+
+namespace eka2l1::arm::test {
+    static constexpr std::uint64_t MAX_INSTRUCTIONS_PER_WORKLOAD = 500000000;
+    static constexpr std::uint64_t FASTMEM_REGION_SIZE = 1ULL << 32;
+
+    // Low enough for loops of the standard workloads to move to the JIT early
+    static constexpr std::uint32_t TIERED_HOT_BLOCK_THRESHOLD = 16;
+
+    std::vector<std::uint32_t> thumb_code(std::initializer_list<std::uint16_t> halfwords) {
+        std::vector<std::uint32_t> words((halfwords.size() + 1) / 2, 0);
+        std::size_t index = 0;
+
+        for (const std::uint16_t hw : halfwords) {
+            words[index >> 1] |= static_cast<std::uint32_t>(hw) << ((index & 1) * 16);
+            index++;
+        }
+
+        return words;
+    }
+
+    double run_result::mips() const {
+        if (warm_seconds_ <= 0.0) {
+            return 0.0;
+        }
+
+        return static_cast<double>(instructions_) / warm_seconds_ / 1000000.0;
+    }
+
+    double run_result::compile_ms() const {
+        return std::max(cold_seconds_ - warm_seconds_, 0.0) * 1000.0;
+    }
+
+    double run_result::callback_rate() const {
+        if (instructions_ == 0) {
+            return 0.0;
+        }
+
+        return static_cast<double>(memory_callbacks_) * 1000000.0 / static_cast<double>(instructions_);
+    }
+
+    cpu_env::cpu_env(const arm_emulator_type type, const env_options &options)
+        : type_(type)
+        , options_(options)
+        , memory_(nullptr)
+        , fastmem_region_(nullptr)
+        , memory_callbacks_(0)
+        , code_reads_(0)
+        , current_asid_(0)
+        , halted_(false)
+        , faulted_(false) {
+        monitor_ = create_exclusive_monitor(type, 1);
+
+        if (!monitor_) {
+            return;
+        }
+
+        core_ = create_core(monitor_.get(), type);
+
+        if (!core_) {
+            return;
+        }
+
+        if (options_.fastmem_) {
+            // Mirror everything up front, like the MMU does for memory committed by the running process
+            if ((sizeof(void *) < 8) || !common::is_memory_mirroring_supported()) {
+                core_.reset();
+                return;
+            }
+
+            memory_ = reinterpret_cast<std::uint8_t *>(common::map_mirrorable_memory(ENV_MEMORY_SIZE));
+            fastmem_region_ = reinterpret_cast<std::uint8_t *>(common::map_memory(static_cast<std::size_t>(FASTMEM_REGION_SIZE)));
+
+            if (!memory_ || !fastmem_region_ || !common::commit(memory_, ENV_MEMORY_SIZE, prot_read_write)
+                || !common::mirror_memory(fastmem_region_, memory_, ENV_MEMORY_SIZE, prot_read_write)) {
+                core_.reset();
+                return;
+            }
+
+            core_->set_fastmem_base(fastmem_region_);
+            core_->set_tlb_asid(0);
+        } else {
+            memory_storage_.resize(ENV_MEMORY_SIZE, 0);
+            memory_ = memory_storage_.data();
+        }
+
+        if (type == arm_emulator_type::tiered) {
+            static_cast<tiered_core *>(core_.get())->set_hot_block_threshold(TIERED_HOT_BLOCK_THRESHOLD);
+        }
+
+        if (options_.bound_callbacks_) {
+            bind_callbacks();
+        } else {
+            assign_closures();
+        }
+
+        core_->system_call_handler = [this](const std::uint32_t svc) {
+            halted_ = true;
+            core_->stop();
+        };
+
+        core_->exception_handler = [this](exception_type type, const std::uint32_t data) {
+            faulted_ = true;
+            core_->stop();
+
+            return false;
+        };
+    }
+
+    cpu_env::~cpu_env() {
+        // The core may still point to the region
+        core_.reset();
+
+        if (fastmem_region_) {
+            common::unmap_memory(fastmem_region_, static_cast<std::size_t>(FASTMEM_REGION_SIZE));
+        }
+
+        if (memory_ && memory_storage_.empty()) {
+            common::unmap_memory(memory_, ENV_MEMORY_SIZE);
+        }
+    }
+
+    template <typename T>
+    bool cpu_env::read_callback(void *userdata, const address addr, T *data) {
+        return static_cast<cpu_env *>(userdata)->read(addr, data);
+    }
+
+    template <typename T>
+    bool cpu_env::write_callback(void *userdata, const address addr, T *data) {
+        return static_cast<cpu_env *>(userdata)->write(addr, data);
+    }
+
+    template <typename T>
+    std::int32_t cpu_env::exclusive_write_callback(void *userdata, const address addr, T value, T expected) {
+        return static_cast<cpu_env *>(userdata)->exclusive_write(addr, value, expected);
+    }
+
+    template <typename T>
+    bool cpu_env::monitor_read_callback(void *userdata, core *cc, const address addr, T *data) {
+        return static_cast<cpu_env *>(userdata)->read(addr, data);
+    }
+
+    template <typename T>
+    std::int32_t cpu_env::monitor_write_callback(void *userdata, core *cc, const address addr, T value, T expected) {
+        return static_cast<cpu_env *>(userdata)->exclusive_write(addr, value, expected);
+    }
+
+    bool cpu_env::read_code_callback(void *userdata, const address addr, std::uint32_t *data) {
+        return static_cast<cpu_env *>(userdata)->read_code(addr, data);
+    }
+
+    void cpu_env::bind_callbacks() {
+        core_->read_8bit.bind(read_callback<std::uint8_t>, this);
+        core_->read_16bit.bind(read_callback<std::uint16_t>, this);
+        core_->read_32bit.bind(read_callback<std::uint32_t>, this);
+        core_->read_64bit.bind(read_callback<std::uint64_t>, this);
+
+        core_->write_8bit.bind(write_callback<std::uint8_t>, this);
+        core_->write_16bit.bind(write_callback<std::uint16_t>, this);
+        core_->write_32bit.bind(write_callback<std::uint32_t>, this);
+        core_->write_64bit.bind(write_callback<std::uint64_t>, this);
+
+        core_->read_code.bind(read_code_callback, this);
+
+        core_->exclusive_write_8bit.bind(exclusive_write_callback<std::uint8_t>, this);
+        core_->exclusive_write_16bit.bind(exclusive_write_callback<std::uint16_t>, this);
+        core_->exclusive_write_32bit.bind(exclusive_write_callback<std::uint32_t>, this);
+        core_->exclusive_write_64bit.bind(exclusive_write_callback<std::uint64_t>, this);
+
+        monitor_->read_8bit.bind(monitor_read_callback<std::uint8_t>, this);
+        monitor_->read_16bit.bind(monitor_read_callback<std::uint16_t>, this);
+        monitor_->read_32bit.bind(monitor_read_callback<std::uint32_t>, this);
+        monitor_->read_64bit.bind(monitor_read_callback<std::uint64_t>, this);
+
+        monitor_->write_8bit.bind(monitor_write_callback<std::uint8_t>, this);
+        monitor_->write_16bit.bind(monitor_write_callback<std::uint16_t>, this);
+        monitor_->write_32bit.bind(monitor_write_callback<std::uint32_t>, this);
+        monitor_->write_64bit.bind(monitor_write_callback<std::uint64_t>, this);
+    }
+
+    template <typename R, typename... Args>
+    void cpu_env::assign_closure(fast_callback<R(Args...)> &callback, std::type_identity_t<std::function<R(Args...)>> closure) {
+        // Call through a std::function, like memory callbacks did before they were bound
+        auto stored = std::make_shared<std::function<R(Args...)>>(std::move(closure));
+
+        callback.bind([](void *userdata, Args... args) -> R {
+            return (*static_cast<std::function<R(Args...)> *>(userdata))(args...);
+        }, stored.get());
+
+        closures_.push_back(std::move(stored));
+    }
+
+    void cpu_env::assign_closures() {
+        // What every callback used to be, kept to measure the difference
+        assign_closure(core_->read_8bit, [this](const address addr, std::uint8_t *data) { return read(addr, data); });
+        assign_closure(core_->read_16bit, [this](const address addr, std::uint16_t *data) { return read(addr, data); });
+        assign_closure(core_->read_32bit, [this](const address addr, std::uint32_t *data) { return read(addr, data); });
+        assign_closure(core_->read_64bit, [this](const address addr, std::uint64_t *data) { return read(addr, data); });
+
+        assign_closure(core_->write_8bit, [this](const address addr, std::uint8_t *data) { return write(addr, data); });
+        assign_closure(core_->write_16bit, [this](const address addr, std::uint16_t *data) { return write(addr, data); });
+        assign_closure(core_->write_32bit, [this](const address addr, std::uint32_t *data) { return write(addr, data); });
+        assign_closure(core_->write_64bit, [this](const address addr, std::uint64_t *data) { return write(addr, data); });
+
+        assign_closure(core_->read_code, [this](const address addr, std::uint32_t *data) { return read_code(addr, data); });
+
+        assign_closure(core_->exclusive_write_8bit, [this](const address addr, std::uint8_t value, std::uint8_t expected) {
+            return exclusive_write(addr, value, expected);
+        });
+
+        assign_closure(core_->exclusive_write_16bit, [this](const address addr, std::uint16_t value, std::uint16_t expected) {
+            return exclusive_write(addr, value, expected);
+        });
+
+        assign_closure(core_->exclusive_write_32bit, [this](const address addr, std::uint32_t value, std::uint32_t expected) {
+            return exclusive_write(addr, value, expected);
+        });
+
+        assign_closure(core_->exclusive_write_64bit, [this](const address addr, std::uint64_t value, std::uint64_t expected) {
+            return exclusive_write(addr, value, expected);
+        });
+
+        assign_closure(monitor_->read_8bit, [this](core *cc, const address addr, std::uint8_t *data) { return read(addr, data); });
+        assign_closure(monitor_->read_16bit, [this](core *cc, const address addr, std::uint16_t *data) { return read(addr, data); });
+        assign_closure(monitor_->read_32bit, [this](core *cc, const address addr, std::uint32_t *data) { return read(addr, data); });
+        assign_closure(monitor_->read_64bit, [this](core *cc, const address addr, std::uint64_t *data) { return read(addr, data); });
+
+        assign_closure(monitor_->write_8bit, [this](core *cc, const address addr, std::uint8_t value, std::uint8_t expected) {
+            return exclusive_write(addr, value, expected);
+        });
+
+        assign_closure(monitor_->write_16bit, [this](core *cc, const address addr, std::uint16_t value, std::uint16_t expected) {
+            return exclusive_write(addr, value, expected);
+        });
+
+        assign_closure(monitor_->write_32bit, [this](core *cc, const address addr, std::uint32_t value, std::uint32_t expected) {
+            return exclusive_write(addr, value, expected);
+        });
+
+        assign_closure(monitor_->write_64bit, [this](core *cc, const address addr, std::uint64_t value, std::uint64_t expected) {
+            return exclusive_write(addr, value, expected);
+        });
+    }
+
+    std::uint8_t *cpu_env::pointer(const address addr, const std::size_t size) {
+        if (static_cast<std::size_t>(addr) + size > ENV_MEMORY_SIZE) {
+            return nullptr;
+        }
+
+        return memory_ + addr;
+    }
+
+    template <typename T>
+    bool cpu_env::read(const address addr, T *data) {
+        std::uint8_t *ptr = pointer(addr, sizeof(T));
+        if (!ptr) {
+            return false;
+        }
+
+        memory_callbacks_++;
+        std::memcpy(data, ptr, sizeof(T));
+
+        // Same as the MMU, let the next access to this page go through the fast path
+        if (options_.fill_tlb_) {
+            const address page_addr = addr & ~(ENV_PAGE_SIZE - 1);
+            core_->set_tlb_page(page_addr, memory_ + page_addr, prot_read_write_exec);
+        }
+
+        return true;
+    }
+
+    template <typename T>
+    bool cpu_env::write(const address addr, T *data) {
+        std::uint8_t *ptr = pointer(addr, sizeof(T));
+        if (!ptr) {
+            return false;
+        }
+
+        memory_callbacks_++;
+        std::memcpy(ptr, data, sizeof(T));
+
+        if (options_.fill_tlb_) {
+            const address page_addr = addr & ~(ENV_PAGE_SIZE - 1);
+            core_->set_tlb_page(page_addr, memory_ + page_addr, prot_read_write_exec);
+        }
+
+        return true;
+    }
+
+    template <typename T>
+    std::int32_t cpu_env::exclusive_write(const address addr, T value, T expected) {
+        std::uint8_t *ptr = pointer(addr, sizeof(T));
+        if (!ptr) {
+            return -1;
+        }
+
+        memory_callbacks_++;
+
+        T current{};
+        std::memcpy(&current, ptr, sizeof(T));
+
+        if (current != expected) {
+            return 0;
+        }
+
+        std::memcpy(ptr, &value, sizeof(T));
+        return 1;
+    }
+
+    bool cpu_env::read_code(const address addr, std::uint32_t *data) {
+        std::uint8_t *ptr = pointer(addr, sizeof(std::uint32_t));
+        if (!ptr) {
+            return false;
+        }
+
+        code_reads_++;
+        std::memcpy(data, ptr, sizeof(std::uint32_t));
+
+        return true;
+    }
+
+    void cpu_env::reset_state(const workload &work) {
+        std::fill(memory_, memory_ + ENV_MEMORY_SIZE, 0);
+        std::memcpy(memory_ + CODE_BASE, work.code_.data(), work.code_.size() * sizeof(std::uint32_t));
+
+        if (work.fill_data_) {
+            work.fill_data_(memory_ + DATA_BASE, DATA_SIZE);
+        }
+
+        for (std::size_t i = 0; i < 16; i++) {
+            core_->set_reg(i, 0);
+        }
+
+        for (std::size_t i = 0; i < 64; i++) {
+            core_->set_vfp(i, 0);
+        }
+
+        core_->set_sp(STACK_TOP);
+        core_->set_pc(CODE_BASE);
+        core_->set_cpsr(0x1D0 | (work.thumb_ ? 0x20 : 0));
+        core_->set_fpscr(0);
+
+        halted_ = false;
+        faulted_ = false;
+    }
+
+    bool cpu_env::run_until_halt(std::uint64_t &instructions) {
+        instructions = 0;
+
+        while (!halted_ && !faulted_ && (instructions < MAX_INSTRUCTIONS_PER_WORKLOAD)) {
+            core_->run(options_.slice_instructions_);
+
+            const std::uint32_t executed = core_->get_num_instruction_executed();
+            instructions += executed;
+
+            if ((executed == 0) && !halted_) {
+                // Stuck, nothing else we can do
+                break;
+            }
+
+            if (options_.address_spaces_) {
+                // All address spaces map the same memory, only the TLB sees the switch
+                current_asid_ = (current_asid_ + 1) % options_.address_spaces_;
+
+                if (options_.tagged_tlb_) {
+                    core_->set_tlb_asid(static_cast<std::int32_t>(current_asid_));
+                } else {
+                    core_->flush_tlb();
+                }
+            }
+        }
+
+        return halted_ && !faulted_;
+    }
+
+    static std::uint64_t hash_memory(const std::uint8_t *memory, const std::size_t size) {
+        // FNV-1a, enough to tell if two memory states diverge
+        std::uint64_t hash = 0xCBF29CE484222325ULL;
+
+        for (std::size_t i = 0; i < size; i++) {
+            hash ^= memory[i];
+            hash *= 0x100000001B3ULL;
+        }
+
+        return hash;
+    }
+
+    run_result cpu_env::run(const workload &work, const int warm_runs, const boot_cache *cache) {
+        run_result result;
+
+        reset_state(work);
+        memory_callbacks_ = 0;
+        code_reads_ = 0;
+
+        auto start = std::chrono::steady_clock::now();
+
+        if (cache) {
+            result.loaded_blocks_ = core_->import_decoded_blocks(CODE_BASE, memory_ + CODE_BASE, DATA_BASE - CODE_BASE, cache->decoded_);
+
+            for (const translated_block_info &block : cache->translated_) {
+                if (core_->precompile_block(block.addr_, block.thumb_, block.fpscr_)) {
+                    result.precompiled_blocks_++;
+                }
+            }
+
+            result.precompile_seconds_ = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            start = std::chrono::steady_clock::now();
+        }
+
+        result.finished_ = run_until_halt(result.instructions_);
+        result.cold_seconds_ = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        result.faulted_ = faulted_;
+        result.memory_callbacks_ = memory_callbacks_;
+        result.code_reads_ = code_reads_;
+
+        for (std::size_t i = 0; i < 16; i++) {
+            result.regs_[i] = core_->get_reg(i);
+        }
+
+        for (std::size_t i = 0; i < 64; i++) {
+            result.vfp_[i] = core_->get_vfp(i);
+        }
+
+        result.cpsr_ = core_->get_cpsr();
+        result.fpscr_ = core_->get_fpscr();
+        result.memory_hash_ = hash_memory(memory_, ENV_MEMORY_SIZE);
+        result.warm_seconds_ = result.cold_seconds_;
+
+        if (!result.finished_) {
+            return result;
+        }
+
+        // Translated code stays in the backend cache, the code bytes are rewritten identically.
+        for (int i = 0; i < warm_runs; i++) {
+            reset_state(work);
+
+            std::uint64_t warm_instructions = 0;
+            code_reads_ = 0;
+
+            start = std::chrono::steady_clock::now();
+            run_until_halt(warm_instructions);
+
+            result.warm_instructions_ += warm_instructions;
+            result.warm_code_reads_ += code_reads_;
+            result.warm_seconds_ = std::min(result.warm_seconds_,
+                std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+        }
+
+        return result;
+    }
+
+    boot_cache cpu_env::export_boot_cache() {
+        boot_cache cache;
+
+        core_->collect_translated_blocks(CODE_BASE, DATA_BASE, cache.translated_);
+        core_->export_decoded_blocks(CODE_BASE, DATA_BASE, cache.decoded_);
+
+        return cache;
+    }
+
+    std::vector<arm_emulator_type> available_backends() {
+        static const arm_emulator_type CANDIDATES[] = {
+            arm_emulator_type::dyncom,
+            arm_emulator_type::dynarmic,
+            arm_emulator_type::r12l1,
+            arm_emulator_type::tiered
+        };
+
+        std::vector<arm_emulator_type> backends;
+
+        // Ask the factory, which only knows the backends built for this host
+        for (const arm_emulator_type type : CANDIDATES) {
+            exclusive_monitor_instance monitor = create_exclusive_monitor(type, 1);
+
+            if (monitor && create_core(monitor.get(), type)) {
+                backends.push_back(type);
+            }
+        }
+
+        return backends;
+    }
+
+    const char *backend_name(const arm_emulator_type type) {
+        switch (type) {
+        case arm_emulator_type::dyncom:
+            return "dyncom";
+
+        case arm_emulator_type::dynarmic:
+            return "dynarmic";
+
+        case arm_emulator_type::r12l1:
+            return "12l1r";
+
+        case arm_emulator_type::tiered:
+            return "tiered";
+
+        default:
+            break;
+        }
+
+        return "unknown";
+    }
+
+    std::vector<std::string> compare_results(const run_result &reference, const run_result &other) {
+        std::vector<std::string> divergences;
+
+        if (reference.finished_ != other.finished_) {
+            divergences.push_back(fmt::format("Finish state: {} vs {}", reference.finished_, other.finished_));
+        }
+
+        for (std::size_t i = 0; i < 16; i++) {
+            if (reference.regs_[i] != other.regs_[i]) {
+                divergences.push_back(fmt::format("R{}: 0x{:X} vs 0x{:X}", i, reference.regs_[i], other.regs_[i]));
+            }
+        }
+
+        // Only NZCV and Thumb bit are guest visible here
+        static constexpr std::uint32_t CPSR_COMPARE_MASK = 0xF0000020;
+
+        if ((reference.cpsr_ & CPSR_COMPARE_MASK) != (other.cpsr_ & CPSR_COMPARE_MASK)) {
+            divergences.push_back(fmt::format("CPSR: 0x{:X} vs 0x{:X}", reference.cpsr_, other.cpsr_));
+        }
+
+        for (std::size_t i = 0; i < 64; i++) {
+            if (reference.vfp_[i] != other.vfp_[i]) {
+                divergences.push_back(fmt::format("S{}: 0x{:X} vs 0x{:X}", i, reference.vfp_[i], other.vfp_[i]));
+            }
+        }
+
+        if ((reference.fpscr_ & 0xF0000000) != (other.fpscr_ & 0xF0000000)) {
+            divergences.push_back(fmt::format("FPSCR: 0x{:X} vs 0x{:X}", reference.fpscr_, other.fpscr_));
+        }
+
+        if (reference.memory_hash_ != other.memory_hash_) {
+            divergences.push_back(fmt::format("Memory hash: 0x{:X} vs 0x{:X}", reference.memory_hash_, other.memory_hash_));
+        }
+
+        return divergences;
+    }
+
+    static workload make_generated_alu_workload(const std::uint32_t seed) {
+        workload work;
+        work.name_ = fmt::format("generated_alu_{}", seed);
+
+        // Load r0-r12 from the data region, then loop a random block of conditional data processing
+        work.code_ = {
+            0xE3A00701, // mov r0, #0x40000
+            0xE8901FFF, // ldm r0, {r0-r12}
+            0xE3A0EFFA // mov lr, #1000
+        };
+
+        const std::size_t block_start = work.code_.size();
+        std::mt19937 rng(seed);
+
+        for (int i = 0; i < 256; i++) {
+            const std::uint32_t cond = rng() % 15;
+            const std::uint32_t opcode = rng() % 16;
+            std::uint32_t set_flags = rng() & 1;
+            std::uint32_t rd = rng() % 13;
+
+            // TST, TEQ, CMP and CMN must set flags and have no destination
+            if ((opcode >= 8) && (opcode <= 11)) {
+                set_flags = 1;
+                rd = 0;
+            }
+
+            const std::uint32_t rn = rng() % 13;
+            const std::uint32_t rm = rng() % 13;
+            const std::uint32_t shift_imm = rng() % 32;
+            const std::uint32_t shift_type = rng() % 4;
+
+            work.code_.push_back((cond << 28) | (opcode << 21) | (set_flags << 20) | (rn << 16) | (rd << 12)
+                | (shift_imm << 7) | (shift_type << 5) | rm);
+        }
+
+        work.code_.push_back(0xE25EE001); // subs lr, lr, #1
+
+        const std::int32_t branch_offset = static_cast<std::int32_t>(block_start) - static_cast<std::int32_t>(work.code_.size() + 2);
+        work.code_.push_back(0x1A000000 | (static_cast<std::uint32_t>(branch_offset) & 0xFFFFFF)); // bne block_start
+        work.code_.push_back(0xEF000000); // svc #0
+
+        work.fill_data_ = [seed](std::uint8_t *data, const std::size_t size) {
+            std::mt19937 data_rng(seed ^ 0x5EED);
+            for (std::size_t i = 0; i < 13 * sizeof(std::uint32_t); i += sizeof(std::uint32_t)) {
+                const std::uint32_t value = data_rng();
+                std::memcpy(data + i, &value, sizeof(value));
+            }
+        };
+
+        return work;
+    }
+
+    std::vector<workload> standard_workloads() {
+        std::vector<workload> workloads;
+
+        workload int_kernel;
+        int_kernel.name_ = "int_kernel";
+        int_kernel.code_ = {
+            0xE3A00000, // mov r0, #0
+            0xE3A01000, // mov r1, #0
+            0xE3A02906, // mov r2, #0x18000
+            0xE0030191, // loop: mul r3, r1, r1
+            0xE0800003, // add r0, r0, r3
+            0xE0200181, // eor r0, r0, r1, lsl #3
+            0xE2811001, // add r1, r1, #1
+            0xE1510002, // cmp r1, r2
+            0x1AFFFFF9, // bne loop
+            0xEF000000 // svc #0
+        };
+
+        workloads.push_back(std::move(int_kernel));
+
+        workload memcpy_loop;
+        memcpy_loop.name_ = "memcpy_loop";
+        memcpy_loop.code_ = {
+            0xE3A05020, // mov r5, #32
+            0xE3A00701, // outer: mov r0, #0x40000
+            0xE2801801, // add r1, r0, #0x10000
+            0xE3A02902, // mov r2, #0x8000
+            0xE8B000D8, // inner: ldm r0!, {r3, r4, r6, r7}
+            0xE8A100D8, // stm r1!, {r3, r4, r6, r7}
+            0xE2522010, // subs r2, r2, #16
+            0x1AFFFFFB, // bne inner
+            0xE2555001, // subs r5, r5, #1
+            0x1AFFFFF6, // bne outer
+            0xEF000000 // svc #0
+        };
+
+        memcpy_loop.fill_data_ = [](std::uint8_t *data, const std::size_t size) {
+            for (std::size_t i = 0; i < 0x8000; i += sizeof(std::uint32_t)) {
+                const std::uint32_t value = static_cast<std::uint32_t>(i) * 0x9E3779B9;
+                std::memcpy(data + i, &value, sizeof(value));
+            }
+        };
+
+        workloads.push_back(std::move(memcpy_loop));
+
+        workload vfp_math;
+        vfp_math.name_ = "vfp_math";
+        vfp_math.code_ = {
+            0xE3A05040, // mov r5, #64
+            0xEE300A40, // vsub.f32 s0, s0, s0
+            0xE3A00701, // outer: mov r0, #0x40000
+            0xE3A02C01, // mov r2, #256
+            0xECB01A02, // inner: vldmia r0!, {s2, s3}
+            0xEE212A21, // vmul.f32 s4, s2, s3
+            0xEE300A02, // vadd.f32 s0, s0, s4
+            0xEE720A41, // vsub.f32 s1, s4, s2
+            0xEE000AA1, // vmla.f32 s0, s1, s3
+            0xEEFD2AC2, // vcvt.s32.f32 s5, s4
+            0xEE123A90, // vmov r3, s5
+            0xE0844003, // add r4, r4, r3
+            0xE2522001, // subs r2, r2, #1
+            0x1AFFFFF5, // bne inner
+            0xE2555001, // subs r5, r5, #1
+            0x1AFFFFF1, // bne outer
+            0xEE103A10, // vmov r3, s0
+            0xEF000000 // svc #0
+        };
+
+        vfp_math.fill_data_ = [](std::uint8_t *data, const std::size_t size) {
+            for (std::size_t i = 0; i < 512; i++) {
+                const float value = static_cast<float>(i % 17) * 0.25f + 1.0f;
+                std::memcpy(data + i * sizeof(float), &value, sizeof(float));
+            }
+        };
+
+        workloads.push_back(std::move(vfp_math));
+
+        workload exclusive_counter;
+        exclusive_counter.name_ = "ldrex_strex";
+        exclusive_counter.code_ = {
+            0xE3A00701, // mov r0, #0x40000
+            0xE3A05901, // mov r5, #0x4000
+            0xE1901F9F, // loop: ldrex r1, [r0]
+            0xE2811001, // add r1, r1, #1
+            0xE1802F91, // strex r2, r1, [r0]
+            0xE3520000, // cmp r2, #0
+            0x1AFFFFFA, // bne loop
+            0xE2555001, // subs r5, r5, #1
+            0x1AFFFFF8, // bne loop
+            0xEF000000 // svc #0
+        };
+
+        workloads.push_back(std::move(exclusive_counter));
+
+        // Collatz steps for 1..3199, odd steps go through a BL/PUSH/POP helper
+        workload thumb_branchy;
+        thumb_branchy.name_ = "thumb_branchy";
+        thumb_branchy.thumb_ = true;
+        thumb_branchy.code_ = thumb_code({
+            0x2000, // movs r0, #0
+            0x2101, // movs r1, #1
+            0x24C8, // movs r4, #200
+            0x0124, // lsls r4, r4, #4
+            0x460A, // outer: mov r2, r1
+            0x2A01, // inner: cmp r2, #1
+            0xD007, // beq next
+            0x0853, // lsrs r3, r2, #1
+            0xD202, // bcs odd
+            0x461A, // mov r2, r3
+            0x3001, // adds r0, #1
+            0xE7F8, // b inner
+            0xF000, // odd: bl odd_step
+            0xF805,
+            0xE7F5, // b inner
+            0x3101, // next: adds r1, #1
+            0x42A1, // cmp r1, r4
+            0xD1F1, // bne outer
+            0xDF00, // svc #0
+            0xB510, // odd_step: push {r4, lr}
+            0x0054, // lsls r4, r2, #1
+            0x18A2, // adds r2, r4, r2
+            0x3201, // adds r2, #1
+            0x3001, // adds r0, #1
+            0xBD10 // pop {r4, pc}
+        });
+
+        workloads.push_back(std::move(thumb_branchy));
+
+        // Calls a helper from a counted loop. Covers the Thumb idioms the interpreter fuses: PUSH/POP,
+        // LDR from a literal pool, and CMP with an immediate followed by a conditional branch.
+        workload thumb_idioms;
+        thumb_idioms.name_ = "thumb_idioms";
+        thumb_idioms.thumb_ = true;
+        thumb_idioms.code_ = thumb_code({
+            0x2000, // movs r0, #0
+            0x2500, // movs r5, #0
+            0x2100, // outer: movs r1, #0
+            0x4A08, // inner: ldr r2, [pc, #32]
+            0x1880, // adds r0, r0, r2
+            0xF000, // bl helper
+            0xF807,
+            0x3101, // adds r1, #1
+            0x29C8, // cmp r1, #200
+            0xD1F8, // bne inner
+            0x3501, // adds r5, #1
+            0x2DFF, // cmp r5, #255
+            0xD1F4, // bne outer
+            0xDF00, // svc #0
+            0xB530, // helper: push {r4, r5, lr}
+            0x4B03, // ldr r3, [pc, #12]
+            0x1C0C, // adds r4, r1, #0
+            0x405C, // eors r4, r3
+            0x1900, // adds r0, r0, r4
+            0xBD30, // pop {r4, r5, pc}
+            0x0003, // .word 3
+            0x0000,
+            0x5678, // .word 0x12345678
+            0x1234
+        });
+
+        workloads.push_back(std::move(thumb_idioms));
+
+        workloads.push_back(make_generated_alu_workload(1));
+        workloads.push_back(make_generated_alu_workload(2022));
+        workloads.push_back(memory_stress_workload());
+
+        return workloads;
+    }
+
+    workload memory_stress_workload() {
+        workload work;
+        work.name_ = "memory_stress";
+
+        // Every access of an inner iteration lands on a new page, to stress the TLB miss path
+        work.code_ = {
+            0xE3A05C01, // mov r5, #256
+            0xE3A00701, // outer: mov r0, #0x40000
+            0xE3A02080, // mov r2, #128
+            0xE5903000, // inner: ldr r3, [r0]
+            0xE0833002, // add r3, r3, r2
+            0xE5803004, // str r3, [r0, #4]
+            0xE5D04008, // ldrb r4, [r0, #8]
+            0xE1C040BC, // strh r4, [r0, #12]
+            0xE2800A01, // add r0, r0, #0x1000
+            0xE2522001, // subs r2, r2, #1
+            0x1AFFFFF7, // bne inner
+            0xE2555001, // subs r5, r5, #1
+            0x1AFFFFF3, // bne outer
+            0xEF000000 // svc #0
+        };
+
+        work.fill_data_ = [](std::uint8_t *data, const std::size_t size) {
+            for (std::size_t i = 0; i < size; i += 0x1000) {
+                const std::uint32_t value = static_cast<std::uint32_t>(i) * 0x9E3779B9;
+                std::memcpy(data + i, &value, sizeof(value));
+            }
+        };
+
+        return work;
+    }
+
+    workload app_boot_workload() {
+        static constexpr std::uint32_t BLOCK_COUNT = 2048;
+
+        workload work;
+        work.name_ = "app_boot";
+        work.code_.push_back(0xE3A04701); // mov r4, #0x40000
+
+        // Straight-line blocks with different operands, chained by branches to the next instruction
+        for (std::uint32_t i = 0; i < BLOCK_COUNT; i++) {
+            const std::uint32_t shift = (i % 31) + 1;
+            const std::uint32_t offset = (i * 4) & 0xFFC;
+
+            work.code_.insert(work.code_.end(), {
+                0xE2800000 | (i & 0xFF), // add r0, r0, #imm
+                0xE0211000 | (shift << 7), // eor r1, r1, r0, lsl #shift
+                0xE5942000 | offset, // ldr r2, [r4, #offset]
+                0xE0833002, // add r3, r3, r2
+                0xE1855061 | (shift << 7), // orr r5, r5, r1, ror #shift
+                0xE0266395, // mla r6, r5, r3, r6
+                0xE5843000 | offset, // str r3, [r4, #offset]
+                0xE1A07060 | (shift << 7), // mov r7, r0, ror #shift
+                0xE0477001, // sub r7, r7, r1
+                0xE1530007, // cmp r3, r7
+                0xC2888001, // addgt r8, r8, #1
+                0xEAFFFFFF // b next
+            });
+        }
+
+        work.code_.push_back(0xEF000000); // svc #0
+
+        work.fill_data_ = [](std::uint8_t *data, const std::size_t size) {
+            for (std::size_t i = 0; i < 0x1000; i += sizeof(std::uint32_t)) {
+                const std::uint32_t value = static_cast<std::uint32_t>(i) * 0x9E3779B9;
+                std::memcpy(data + i, &value, sizeof(value));
+            }
+        };
+
+        return work;
+    }
+}
@@ -0,0 +1,250 @@
+/*
+ * Copyright (c) 2022 EKA2L1 Team.
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <common/types.h>
+#include <cpu/arm_factory.h>
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace eka2l1::arm::test {
+    /**
+     * @brief A guest program run by the harness.
+     *
+     * The program is loaded at CODE_BASE, starts with all registers cleared and the stack pointer
+     * at STACK_TOP, and ends by calling SVC. The data region is pre-filled by the optional fill
+     * function before each run.
+     */
+    struct workload {
+        std::string name_;
+        std::vector<std::uint32_t> code_;
+        bool thumb_ = false;
+
+        std::function<void(std::uint8_t *data, const std::size_t size)> fill_data_;
+    };
+
+    /**
+     * @brief Pack Thumb halfwords into the code words of a workload.
+     */
+    std::vector<std::uint32_t> thumb_code(std::initializer_list<std::uint16_t> halfwords);
+
+    struct run_result {
+        std::array<std::uint32_t, 16> regs_;
+        std::array<std::uint32_t, 64> vfp_;
+        std::uint32_t cpsr_ = 0;
+        std::uint32_t fpscr_ = 0;
+        std::uint64_t memory_hash_ = 0;
+
+        bool finished_ = false;
+        bool faulted_ = false;
+
+        std::uint64_t instructions_ = 0;
+        std::uint64_t memory_callbacks_ = 0;
+        std::uint64_t code_reads_ = 0;
+
+        std::uint64_t warm_instructions_ = 0; ///< Instructions executed by all warm runs together.
+        std::uint64_t warm_code_reads_ = 0; ///< Code reads done by all warm runs together, each one is new translation work.
+
+        double cold_seconds_ = 0.0; ///< First run, including translation.
+        double warm_seconds_ = 0.0; ///< Best of the following runs, with code already translated.
+        double precompile_seconds_ = 0.0; ///< Time spent loading and translating blocks ahead of the first run.
+        std::size_t precompiled_blocks_ = 0;
+        std::size_t loaded_blocks_ = 0; ///< Decoded blocks loaded ahead of the first run.
+
+        /**
+         * @brief Guest MIPS on warm runs.
+         */
+        double mips() const;
+
+        /**
+         * @brief Estimated time spent translating code, in milliseconds.
+         */
+        double compile_ms() const;
+
+        /**
+         * @brief Memory callbacks per million guest instructions.
+         */
+        double callback_rate() const;
+    };
+
+    /**
+     * @brief What a persistent JIT cache keeps of a run, to load on the next boot.
+     */
+    struct boot_cache {
+        std::vector<translated_block_info> translated_;
+        std::vector<decoded_block_info> decoded_;
+
+        bool empty() const {
+            return translated_.empty() && decoded_.empty();
+        }
+    };
+
+    struct env_options {
+        bool fill_tlb_ = true; ///< Map a page in the CPU TLB on first access, like the MMU does.
+        bool bound_callbacks_ = true; ///< Bind memory callbacks to plain functions, instead of assigning closures.
+
+        std::uint32_t slice_instructions_ = 1000000; ///< Number of instructions run before control returns to the harness.
+        std::uint32_t address_spaces_ = 0; ///< Rotate between this many address spaces after every slice, like the scheduler. 0 to not switch.
+        bool tagged_tlb_ = true; ///< On a switch, select the TLB entries of the address space instead of flushing the TLB.
+        bool fastmem_ = false; ///< Mirror the memory into a 4 GiB host region that the JIT accesses directly.
+    };
+
+    /**
+     * @brief A flat guest memory environment bound to one CPU backend.
+     */
+    class cpu_env {
+    public:
+        enum : std::uint32_t {
+            ENV_PAGE_BITS = 12,
+            ENV_PAGE_SIZE = 1 << ENV_PAGE_BITS,
+            ENV_MEMORY_SIZE = 0x100000,
+            CODE_BASE = 0x10000,
+            DATA_BASE = 0x40000,
+            DATA_SIZE = 0x80000,
+            STACK_TOP = 0xF0000
+        };
+
+    private:
+        arm_emulator_type type_;
+        env_options options_;
+        std::vector<std::uint8_t> memory_storage_;
+        std::uint8_t *memory_;
+        std::uint8_t *fastmem_region_;
+
+        exclusive_monitor_instance monitor_;
+        core_instance core_;
+
+        std::uint64_t memory_callbacks_;
+        std::uint64_t code_reads_;
+
+        std::uint32_t current_asid_;
+
+        bool halted_;
+        bool faulted_;
+
+        std::uint8_t *pointer(const address addr, const std::size_t size);
+
+        template <typename T>
+        bool read(const address addr, T *data);
+
+        template <typename T>
+        bool write(const address addr, T *data);
+
+        template <typename T>
+        std::int32_t exclusive_write(const address addr, T value, T expected);
+
+        bool read_code(const address addr, std::uint32_t *data);
+
+        template <typename T>
+        static bool read_callback(void *userdata, const address addr, T *data);
+
+        template <typename T>
+        static bool write_callback(void *userdata, const address addr, T *data);
+
+        template <typename T>
+        static std::int32_t exclusive_write_callback(void *userdata, const address addr, T value, T expected);
+
+        template <typename T>
+        static bool monitor_read_callback(void *userdata, core *cc, const address addr, T *data);
+
+        template <typename T>
+        static std::int32_t monitor_write_callback(void *userdata, core *cc, const address addr, T value, T expected);
+
+        static bool read_code_callback(void *userdata, const address addr, std::uint32_t *data);
+
+        std::vector<std::shared_ptr<void>> closures_; ///< Called through by callbacks bound with assign_closure.
+
+        template <typename R, typename... Args>
+        void assign_closure(fast_callback<R(Args...)> &callback, std::type_identity_t<std::function<R(Args...)>> closure);
+
+        void bind_callbacks();
+        void assign_closures();
+
+        void reset_state(const workload &work);
+        bool run_until_halt(std::uint64_t &instructions);
+
+    public:
+        explicit cpu_env(const arm_emulator_type type, const env_options &options = env_options());
+        ~cpu_env();
+
+        cpu_env(const cpu_env &) = delete;
+        cpu_env &operator=(const cpu_env &) = delete;
+
+        bool valid() const {
+            return core_ != nullptr;
+        }
+
+        /**
+         * @brief Check if the backend can hand its translations to a later boot.
+         */
+        bool can_persist_translations() const {
+            return core_->can_import_decoded_blocks() || core_->can_translate_ahead();
+        }
+
+        /**
+         * @brief Run a workload once cold and a few more times warm.
+         *
+         * @param work          The workload to run.
+         * @param warm_runs     Number of runs after the cold one.
+         * @param cache         Optional blocks to load and translate before the cold run, like a persistent
+         *                      JIT cache would do on boot.
+         */
+        run_result run(const workload &work, const int warm_runs = 3, const boot_cache *cache = nullptr);
+
+        /**
+         * @brief Get all blocks the backend has translated or decoded in the code region.
+         */
+        boot_cache export_boot_cache();
+    };
+
+    /**
+     * @brief Get all CPU backends built for the host, which the factory can create.
+     */
+    std::vector<arm_emulator_type> available_backends();
+
+    const char *backend_name(const arm_emulator_type type);
+
+    /**
+     * @brief Compare two run results.
+     * @returns Description of each divergence. Empty if the results match.
+     */
+    std::vector<std::string> compare_results(const run_result &reference, const run_result &other);
+
+    std::vector<workload> standard_workloads();
+
+    /**
+     * @brief A workload doing loads and stores of all sizes, each on a different page.
+     */
+    workload memory_stress_workload();
+
+    /**
+     * @brief A workload of many blocks that each run once, like the startup of an app.
+     *
+     * Nearly all of its time is spent translating, which is what a persistent JIT cache saves.
+     */
+    workload app_boot_workload();
+}
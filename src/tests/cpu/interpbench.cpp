@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2022 EKA2L1 Team.
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+#include <common/log.h>
+#include <cpu/dyncom/arm_dyncom_cache.h>
+
+#include "harness.h"
+
+#include <algorithm>
+
+using namespace eka2l1;
+using namespace eka2l1::arm::test;
+
+static workload find_workload(const char *name) {
+    std::vector<workload> workloads = standard_workloads();
+    auto ite = std::find_if(workloads.begin(), workloads.end(), [name](const workload &work) {
+        return work.name_ == name;
+    });
+
+    REQUIRE(ite != workloads.end());
+    return *ite;
+}
+
+TEST_CASE("dyncom_block_cache_drops_overlapping_blocks", "cpu") {
+    arm::dyncom_block_cache cache;
+
+    cache.add(0x10000, 0x10020, 0);
+    cache.add(0x10021, 0x10040, 64);
+    cache.add(0x10FF0, 0x11004, 128);
+    cache.add(0x20000, 0x20010, 256);
+
+    // Same address, other instruction set
+    REQUIRE(cache.find(0x10000) == 0);
+    REQUIRE(cache.find(0x10001) == arm::dyncom_block_cache::NOT_FOUND);
+    REQUIRE(cache.find(0x10021) == 64);
+
+    // Only the block that crosses into the next page is hit
+    REQUIRE(cache.invalidate(0x11000, 4) == 1);
+    REQUIRE(cache.find(0x10FF0) == arm::dyncom_block_cache::NOT_FOUND);
+    REQUIRE(cache.find(0x10000) == 0);
+    REQUIRE(cache.size() == 3);
+
+    REQUIRE(cache.invalidate(0x10020, 2) == 1);
+    REQUIRE(cache.find(0x10021) == arm::dyncom_block_cache::NOT_FOUND);
+
+    // Retranslated blocks are found again
+    cache.add(0x10021, 0x10040, 512);
+    REQUIRE(cache.find(0x10021) == 512);
+
+    // Large ranges, like an unmapped chunk, walk the blocks instead of the pages
+    REQUIRE(cache.invalidate(0x0, 0x10000000) == 3);
+    REQUIRE(cache.size() == 0);
+    REQUIRE(cache.find(0x20000) == arm::dyncom_block_cache::NOT_FOUND);
+
+    cache.add(0x20000, 0x20010, 1024);
+    REQUIRE(cache.find(0x20000) == 1024);
+    REQUIRE(cache.invalidate(0x20000, 0x10) == 1);
+}
+
+TEST_CASE("cpu_interpreter_fused_thumb_idioms", "cpu") {
+    // CMP and the branch after it run as one handler. Slices that end between the two must still stop
+    // at the branch, and single steps never fuse across the budget.
+    const workload work = find_workload("thumb_idioms");
+
+    std::uint32_t expected = 0;
+    for (std::uint32_t outer = 0; outer < 255; outer++) {
+        for (std::uint32_t inner = 0; inner < 200; inner++) {
+            expected += 3 + (inner ^ 0x12345678);
+        }
+    }
+
+    run_result reference;
+
+    for (const std::uint32_t slice : { 1000000, 7, 1 }) {
+        env_options options;
+        options.slice_instructions_ = slice;
+
+        cpu_env env(arm_emulator_type::dyncom, options);
+        REQUIRE(env.valid());
+
+        const run_result result = env.run(work, 0);
+
+        INFO("Slice of " << slice << " instructions");
+        REQUIRE(result.finished_);
+        REQUIRE(result.regs_[0] == expected);
+        REQUIRE(result.regs_[13] == cpu_env::STACK_TOP);
+
+        if (slice == 1000000) {
+            reference = result;
+        } else {
+            REQUIRE(result.instructions_ == reference.instructions_);
+            REQUIRE(compare_results(reference, result).empty());
+        }
+    }
+}
+
+TEST_CASE("cpu_interpreter_throughput", "cpu") {
+    for (const workload &work : standard_workloads()) {
+        cpu_env env(arm_emulator_type::dyncom);
+        REQUIRE(env.valid());
+
+        const run_result result = env.run(work);
+
+        LOG_INFO(CPU, "{} on dyncom: {} instructions, {:.2f} MIPS warm, {:.3f} ms cold, {:.3f} ms warm", work.name_,
+            result.instructions_, result.mips(), result.cold_seconds_ * 1000.0, result.warm_seconds_ * 1000.0);
+
+        INFO("Workload " << work.name_);
+        REQUIRE(result.finished_);
+    }
+}
@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2022 EKA2L1 Team.
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+#include <common/log.h>
+
+#include "harness.h"
+
+using namespace eka2l1;
+using namespace eka2l1::arm::test;
+
+TEST_CASE("cpu_memory_stress_bound_callbacks", "cpu") {
+    // Without TLB fills every access is a callback. Compare closures stored in std::function, which
+    // is how memory callbacks used to be set, with callbacks bound to plain functions.
+    const workload work = memory_stress_workload();
+
+    env_options closures;
+    closures.fill_tlb_ = false;
+    closures.bound_callbacks_ = false;
+
+    env_options bound;
+    bound.fill_tlb_ = false;
+    bound.bound_callbacks_ = true;
+
+    for (const arm_emulator_type type : available_backends()) {
+        cpu_env closure_env(type, closures);
+        cpu_env bound_env(type, bound);
+
+        if (!closure_env.valid() || !bound_env.valid()) {
+            continue;
+        }
+
+        const run_result closure_result = closure_env.run(work);
+        const run_result bound_result = bound_env.run(work);
+
+        LOG_INFO(CPU, "memory_stress on {}: {:.2f} MIPS with closures, {:.2f} MIPS with bound callbacks, {:.1f} callbacks/Minstr",
+            backend_name(type), closure_result.mips(), bound_result.mips(), bound_result.callback_rate());
+
+        INFO("Backend " << backend_name(type));
+        REQUIRE(closure_result.finished_);
+        REQUIRE(bound_result.finished_);
+        REQUIRE(compare_results(closure_result, bound_result).empty());
+    }
+}
+
+TEST_CASE("cpu_memory_stress_context_switch", "cpu") {
+    // Switch address space every few thousand instructions, like a guest doing lots of IPC does.
+    // Every TLB miss is a memory callback, so the callback count tells how many entries had to be refilled.
+    const workload work = memory_stress_workload();
+
+    env_options flushed;
+    flushed.slice_instructions_ = 2000;
+    flushed.address_spaces_ = 4;
+    flushed.tagged_tlb_ = false;
+
+    env_options tagged = flushed;
+    tagged.tagged_tlb_ = true;
+
+    for (const arm_emulator_type type : available_backends()) {
+        cpu_env flushed_env(type, flushed);
+        cpu_env tagged_env(type, tagged);
+
+        if (!flushed_env.valid() || !tagged_env.valid()) {
+            continue;
+        }
+
+        const run_result flushed_result = flushed_env.run(work);
+        const run_result tagged_result = tagged_env.run(work);
+
+        LOG_INFO(CPU, "memory_stress with context switches on {}: {:.2f} MIPS, {:.1f} callbacks/Minstr when flushing, "
+            "{:.2f} MIPS, {:.1f} callbacks/Minstr with tagged TLB",
+            backend_name(type), flushed_result.mips(), flushed_result.callback_rate(), tagged_result.mips(),
+            tagged_result.callback_rate());
+
+        INFO("Backend " << backend_name(type));
+        REQUIRE(flushed_result.finished_);
+        REQUIRE(tagged_result.finished_);
+        REQUIRE(compare_results(flushed_result, tagged_result).empty());
+        REQUIRE(tagged_result.memory_callbacks_ <= flushed_result.memory_callbacks_);
+    }
+}
+
+TEST_CASE("cpu_memory_stress_fastmem", "cpu") {
+    // Same workload with loads and stores going through the TLB, and going straight to the mirrored region.
+    // Backends without fastmem support run the same way in both.
+    const workload work = memory_stress_workload();
+
+    env_options tlb;
+
+    env_options fastmem;
+    fastmem.fastmem_ = true;
+
+    for (const arm_emulator_type type : available_backends()) {
+        cpu_env tlb_env(type, tlb);
+        cpu_env fastmem_env(type, fastmem);
+
+        if (!tlb_env.valid() || !fastmem_env.valid()) {
+            continue;
+        }
+
+        const run_result tlb_result = tlb_env.run(work);
+        const run_result fastmem_result = fastmem_env.run(work);
+
+        LOG_INFO(CPU, "memory_stress on {}: {:.2f} MIPS, {:.1f} callbacks/Minstr through the TLB, {:.2f} MIPS, "
+            "{:.1f} callbacks/Minstr with fastmem",
+            backend_name(type), tlb_result.mips(), tlb_result.callback_rate(), fastmem_result.mips(),
+            fastmem_result.callback_rate());
+
+        INFO("Backend " << backend_name(type));
+        REQUIRE(tlb_result.finished_);
+        REQUIRE(fastmem_result.finished_);
+        REQUIRE(compare_results(tlb_result, fastmem_result).empty());
+    }
+}
@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2022 EKA2L1 Team.
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+#include <common/log.h>
+
+#include "harness.h"
+
+using namespace eka2l1;
+using namespace eka2l1::arm::test;
+
+TEST_CASE("cpu_precompiled_boot_matches_cold_boot", "cpu") {
+    // Simulate two boots: the first one records translated and decoded blocks, the second loads them
+    // before running, as the persistent JIT cache does.
+    for (const arm_emulator_type type : available_backends()) {
+        for (const workload &work : standard_workloads()) {
+            INFO("Workload " << work.name_ << " on " << backend_name(type));
+
+            boot_cache cache;
+            run_result cold_boot;
+            bool can_persist = false;
+
+            {
+                cpu_env first_boot(type);
+                REQUIRE(first_boot.valid());
+
+                cold_boot = first_boot.run(work, 0);
+                cache = first_boot.export_boot_cache();
+                can_persist = first_boot.can_persist_translations();
+            }
+
+            if (!can_persist) {
+                // Dynarmic only translates a block when it first runs it, and can not export the result
+                REQUIRE(cache.empty());
+                continue;
+            }
+
+            REQUIRE(!cache.empty());
+
+            cpu_env second_boot(type);
+            const run_result warm_boot = second_boot.run(work, 0, &cache);
+
+            LOG_INFO(CPU, "{} on {}: cold boot {:.3f} ms, warm boot {:.3f} ms + {:.3f} ms loading {} and translating {} blocks ahead",
+                work.name_, backend_name(type), cold_boot.cold_seconds_ * 1000.0, warm_boot.cold_seconds_ * 1000.0,
+                warm_boot.precompile_seconds_ * 1000.0, warm_boot.loaded_blocks_, warm_boot.precompiled_blocks_);
+
+            REQUIRE(warm_boot.loaded_blocks_ == cache.decoded_.size());
+            REQUIRE(warm_boot.precompiled_blocks_ == cache.translated_.size());
+            REQUIRE(compare_results(cold_boot, warm_boot).empty());
+        }
+    }
+}
+
+TEST_CASE("cpu_app_boot_cold_vs_warm", "cpu") {
+    // Code that runs once is almost all translation. A boot with the blocks of the previous one loaded
+    // should do none of it.
+    const workload work = app_boot_workload();
+
+    for (const arm_emulator_type type : available_backends()) {
+        INFO("Backend " << backend_name(type));
+
+        cpu_env first_boot(type);
+        REQUIRE(first_boot.valid());
+
+        const run_result cold_boot = first_boot.run(work, 0);
+        REQUIRE(cold_boot.finished_);
+
+        const boot_cache cache = first_boot.export_boot_cache();
+
+        if (!first_boot.can_persist_translations()) {
+            LOG_INFO(CPU, "app_boot on {}: cold boot {:.3f} ms, no warm boot, the backend can not persist its translations",
+                backend_name(type), cold_boot.cold_seconds_ * 1000.0);
+
+            REQUIRE(cache.empty());
+            continue;
+        }
+
+        cpu_env second_boot(type);
+        const run_result warm_boot = second_boot.run(work, 0, &cache);
+
+        LOG_INFO(CPU, "app_boot on {}: cold boot {:.3f} ms with {} code reads, warm boot {:.3f} ms + {:.3f} ms loading {} blocks "
+                      "with {} code reads",
+            backend_name(type), cold_boot.cold_seconds_ * 1000.0, cold_boot.code_reads_, warm_boot.cold_seconds_ * 1000.0,
+            warm_boot.precompile_seconds_ * 1000.0, warm_boot.loaded_blocks_ + warm_boot.precompiled_blocks_, warm_boot.code_reads_);
+
+        REQUIRE(compare_results(cold_boot, warm_boot).empty());
+        REQUIRE(warm_boot.loaded_blocks_ == cache.decoded_.size());
+
+        if (cache.translated_.empty()) {
+            // Every block was loaded decoded, nothing is left to read and decode
+            REQUIRE(!cache.decoded_.empty());
+            REQUIRE(warm_boot.code_reads_ == 0);
+        }
+    }
+}
@@ -18,7 +18,297 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <catch2/catch.hpp>
+#include <common/buffer.h>
+#include <common/bytepair.h>
+#include <common/crypt.h>
+#include <common/log.h>
 #include <kernel/libmanager.h>
 #include <loader/e32img.h>
 
 #include <vfs/vfs.h>
+
+#include <chrono>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace eka2l1;
+
+namespace {
+    static constexpr std::uint8_t TEST_FIRST_TOKEN = 0xF0;
+    static constexpr std::uint8_t TEST_MARKER = 0xFF;
+
+    // Instruction-like words. Bytes stay under the first token, so they never need a marker
+    static const std::uint32_t TEST_CODE_WORDS[] = {
+        0xE92D4070, 0xE1A05000, 0xE3A00001, 0xE8BD8070, 0xE59F3010, 0xE5930000, 0xEB000010, 0xE1A0E00E
+    };
+
+    /**
+     * Compress data with a fixed table of 15 pairs taken from the test words. Real images have better
+     * tables, but the layout is the same: a table header, the size of each page, then the pages.
+     */
+    std::vector<std::uint8_t> make_bytepair_stream(const std::vector<std::uint8_t> &data) {
+        std::vector<std::pair<std::uint8_t, std::uint8_t>> pairs;
+
+        for (const std::uint32_t word : TEST_CODE_WORDS) {
+            pairs.emplace_back(word & 0xFF, (word >> 8) & 0xFF);
+            pairs.emplace_back((word >> 16) & 0xFF, word >> 24);
+        }
+
+        pairs.resize(TEST_MARKER - TEST_FIRST_TOKEN);
+
+        const std::uint16_t page_count = static_cast<std::uint16_t>((data.size() + common::BYTEPAIR_PAGE_SIZE - 1) / common::BYTEPAIR_PAGE_SIZE);
+        std::vector<std::vector<std::uint8_t>> pages(page_count);
+
+        for (std::uint16_t i = 0; i < page_count; i++) {
+            std::vector<std::uint8_t> &page = pages[i];
+
+            page.push_back(static_cast<std::uint8_t>(pairs.size()));
+            page.push_back(TEST_MARKER);
+
+            for (std::size_t j = 0; j < pairs.size(); j++) {
+                page.push_back(static_cast<std::uint8_t>(TEST_FIRST_TOKEN + j));
+                page.push_back(pairs[j].first);
+                page.push_back(pairs[j].second);
+            }
+
+            const std::size_t start = i * common::BYTEPAIR_PAGE_SIZE;
+            const std::size_t end = std::min<std::size_t>(start + common::BYTEPAIR_PAGE_SIZE, data.size());
+
+            for (std::size_t j = start; j < end;) {
+                std::size_t token = pairs.size();
+
+                if (j + 1 < end) {
+                    for (token = 0; token < pairs.size(); token++) {
+                        if ((pairs[token].first == data[j]) && (pairs[token].second == data[j + 1])) {
+                            break;
+                        }
+                    }
+                }
+
+                if (token < pairs.size()) {
+                    page.push_back(static_cast<std::uint8_t>(TEST_FIRST_TOKEN + token));
+                    j += 2;
+                } else {
+                    page.push_back(data[j++]);
+                }
+            }
+        }
+
+        std::vector<std::uint8_t> stream(10 + page_count * sizeof(std::uint16_t));
+
+        const std::int32_t decompressed_size = static_cast<std::int32_t>(data.size());
+        std::memcpy(stream.data() + 4, &decompressed_size, 4);
+        std::memcpy(stream.data() + 8, &page_count, 2);
+
+        for (std::uint16_t i = 0; i < page_count; i++) {
+            const std::uint16_t page_size = static_cast<std::uint16_t>(pages[i].size());
+            std::memcpy(stream.data() + 10 + i * sizeof(std::uint16_t), &page_size, sizeof(std::uint16_t));
+
+            stream.insert(stream.end(), pages[i].begin(), pages[i].end());
+        }
+
+        const std::int32_t size_of_data = static_cast<std::int32_t>(stream.size());
+        std::memcpy(stream.data(), &size_of_data, 4);
+
+        return stream;
+    }
+
+    std::vector<std::uint8_t> make_test_text(const std::uint32_t size, const std::uint32_t seed) {
+        std::mt19937 rng(seed);
+        std::vector<std::uint8_t> text(size);
+
+        for (std::uint32_t i = 0; i + 4 <= size; i += 4) {
+            const std::uint32_t word = ((rng() % 8) == 0) ? (rng() & 0x6F6F6F6F) : TEST_CODE_WORDS[rng() % 8];
+            std::memcpy(&text[i], &word, 4);
+        }
+
+        return text;
+    }
+
+    struct test_e32img {
+        std::vector<std::uint8_t> file_;
+        std::vector<std::uint8_t> code_;
+    };
+
+    /**
+     * Build a bytepair compressed EXE with the given amount of text, followed by a small import address
+     * table and export directory, and a little data.
+     */
+    test_e32img make_test_e32img(const std::uint32_t text_size) {
+        static constexpr std::uint32_t IAT_SIZE = 12;
+        static constexpr std::uint32_t EXPORT_COUNT = 2;
+        static constexpr std::uint32_t DATA_SIZE = 16;
+        static constexpr std::uint32_t IMPORT_SECTION_SIZE = 4;
+
+        test_e32img result;
+        result.code_ = make_test_text(text_size, text_size);
+
+        loader::e32img_header header{};
+        header.uid1 = loader::e32_img_type::exe;
+        header.uid2 = 0x100039CE;
+        header.uid3 = 0xE0001234;
+        header.sig = 0x434F5045;
+        header.compression_type = 0x102822AA;
+        header.flags = 1 << 24;
+        header.cpu = loader::e32_cpu::armv5;
+
+        const std::uint32_t uids[3] = { static_cast<std::uint32_t>(header.uid1), header.uid2, header.uid3 };
+        header.check = crypt::calculate_checked_uid_checksum(uids);
+
+        const std::uint32_t code_offset = sizeof(loader::e32img_header) + 4;
+
+        header.text_size = text_size;
+        header.code_size = text_size + IAT_SIZE + EXPORT_COUNT * 4;
+        header.data_size = DATA_SIZE;
+        header.code_offset = code_offset;
+        header.export_dir_offset = code_offset + text_size + IAT_SIZE;
+        header.export_dir_count = EXPORT_COUNT;
+        header.data_offset = code_offset + header.code_size;
+        header.import_offset = header.data_offset + DATA_SIZE;
+
+        const std::uint32_t iat[3] = { 0x10203040, 0x10203044, 0 };
+        const std::uint32_t exports[EXPORT_COUNT] = { 0x101, 0x201 };
+
+        result.code_.resize(header.code_size);
+        std::memcpy(&result.code_[text_size], iat, sizeof(iat));
+        std::memcpy(&result.code_[text_size + IAT_SIZE], exports, sizeof(exports));
+
+        std::vector<std::uint8_t> rest(DATA_SIZE + IMPORT_SECTION_SIZE, 0x11);
+        const std::uint32_t import_section_size = IMPORT_SECTION_SIZE;
+        std::memcpy(&rest[DATA_SIZE], &import_section_size, 4);
+
+        const std::uint32_t uncompressed_size = header.code_size + static_cast<std::uint32_t>(rest.size());
+
+        result.file_.resize(code_offset);
+        std::memcpy(result.file_.data(), &header, sizeof(header));
+        std::memcpy(result.file_.data() + sizeof(header), &uncompressed_size, 4);
+
+        const std::vector<std::uint8_t> code_stream = make_bytepair_stream(result.code_);
+        const std::vector<std::uint8_t> rest_stream = make_bytepair_stream(rest);
+
+        result.file_.insert(result.file_.end(), code_stream.begin(), code_stream.end());
+        result.file_.insert(result.file_.end(), rest_stream.begin(), rest_stream.end());
+
+        return result;
+    }
+
+    std::optional<loader::e32img> parse_test_e32img(test_e32img &img, const bool page_code) {
+        common::ro_buf_stream stream(img.file_.data(), img.file_.size());
+        return loader::parse_e32img(reinterpret_cast<common::ro_stream *>(&stream), true, page_code);
+    }
+}
+
+TEST_CASE("bytepair_page_store_reads_single_pages", "e32img") {
+    const std::vector<std::uint8_t> text = make_test_text(common::BYTEPAIR_PAGE_SIZE * 3 + 200, 1);
+    const std::vector<std::uint8_t> stream = make_bytepair_stream(text);
+
+    common::bytepair_page_store store;
+    REQUIRE(store.load(stream.data(), stream.size()));
+    REQUIRE(store.page_count() == 4);
+    REQUIRE(store.decompressed_size() == text.size());
+    REQUIRE(store.consumed_size() == stream.size());
+    REQUIRE(store.compressed_size() < text.size());
+
+    // Out of order, like faults are
+    for (const std::uint32_t page : { 2, 0, 3, 1 }) {
+        std::vector<std::uint8_t> content(common::BYTEPAIR_PAGE_SIZE, 0xCD);
+        const std::uint32_t expected_size = std::min<std::uint32_t>(common::BYTEPAIR_PAGE_SIZE,
+            static_cast<std::uint32_t>(text.size()) - page * common::BYTEPAIR_PAGE_SIZE);
+
+        REQUIRE(store.read_page(content.data(), page) == expected_size);
+        REQUIRE(std::memcmp(content.data(), text.data() + page * common::BYTEPAIR_PAGE_SIZE, expected_size) == 0);
+    }
+
+    std::uint8_t unused[common::BYTEPAIR_PAGE_SIZE];
+    REQUIRE(store.read_page(unused, 4) == 0);
+
+    common::bytepair_page_store truncated;
+    REQUIRE_FALSE(truncated.load(stream.data(), stream.size() - 1));
+}
+
+TEST_CASE("e32img_paged_code_matches_full_parse", "e32img") {
+    test_e32img source = make_test_e32img(common::BYTEPAIR_PAGE_SIZE * 5 + 0x100);
+
+    std::optional<loader::e32img> full = parse_test_e32img(source, false);
+    std::optional<loader::e32img> paged = parse_test_e32img(source, true);
+
+    REQUIRE(full);
+    REQUIRE(paged);
+
+    REQUIRE_FALSE(full->code_pages);
+    REQUIRE(std::memcmp(&full->data[full->header.code_offset], source.code_.data(), source.code_.size()) == 0);
+
+    // The page with the end of the text also has the import address table and the exports
+    REQUIRE(paged->code_pages);
+    REQUIRE(paged->paged_code_size == common::BYTEPAIR_PAGE_SIZE * 5);
+    REQUIRE(paged->iat.its == full->iat.its);
+    REQUIRE(paged->ed.syms == full->ed.syms);
+    REQUIRE(paged->ed.syms.size() == 2);
+
+    const std::uint32_t code_offset = paged->header.code_offset;
+    REQUIRE(std::equal(paged->data.begin() + code_offset + paged->paged_code_size, paged->data.end(),
+        full->data.begin() + code_offset + paged->paged_code_size));
+
+    std::vector<std::uint8_t> page(common::BYTEPAIR_PAGE_SIZE);
+
+    for (std::uint32_t i = 0; i < paged->paged_code_size / common::BYTEPAIR_PAGE_SIZE; i++) {
+        REQUIRE(paged->code_pages->read_page(page.data(), i) == common::BYTEPAIR_PAGE_SIZE);
+        REQUIRE(std::memcmp(page.data(), source.code_.data() + i * common::BYTEPAIR_PAGE_SIZE, page.size()) == 0);
+    }
+
+    // Images with less than a page of text are not worth paging
+    test_e32img small_source = make_test_e32img(0x800);
+    std::optional<loader::e32img> small = parse_test_e32img(small_source, true);
+
+    REQUIRE(small);
+    REQUIRE_FALSE(small->code_pages);
+    REQUIRE(small->paged_code_size == 0);
+}
+
+TEST_CASE("e32img_paged_code_load_bench", "e32img") {
+    // A large game executable. Launching it touches a small part of its text, here one page in ten.
+    static constexpr std::uint32_t TEXT_SIZE = 8 * 1024 * 1024;
+    static constexpr std::uint32_t TOUCH_STRIDE = 10;
+    static constexpr int ITERATIONS = 5;
+
+    test_e32img source = make_test_e32img(TEXT_SIZE);
+
+    auto measure = [&](const bool page_code, std::size_t &resident) {
+        const auto start = std::chrono::steady_clock::now();
+
+        for (int i = 0; i < ITERATIONS; i++) {
+            std::optional<loader::e32img> img = parse_test_e32img(source, page_code);
+            REQUIRE(img);
+
+            resident = img->header.code_size;
+
+            if (img->code_pages) {
+                std::vector<std::uint8_t> page(common::BYTEPAIR_PAGE_SIZE);
+                const std::uint32_t page_count = img->paged_code_size / common::BYTEPAIR_PAGE_SIZE;
+
+                for (std::uint32_t j = 0; j < page_count; j += TOUCH_STRIDE) {
+                    img->code_pages->read_page(page.data(), j);
+                }
+
+                const std::uint32_t touched = (page_count + TOUCH_STRIDE - 1) / TOUCH_STRIDE;
+                resident = img->code_pages->compressed_size() + img->header.code_size - img->paged_code_size
+                    + touched * common::BYTEPAIR_PAGE_SIZE;
+            }
+        }
+
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / ITERATIONS;
+    };
+
+    std::size_t full_resident = 0;
+    std::size_t paged_resident = 0;
+
+    const double full_ms = measure(false, full_resident);
+    const double paged_ms = measure(true, paged_resident);
+
+    LOG_INFO(LOADER, "{} KB of text: full load {:.2f} ms, {} KB resident. Paged load and 1/{} touched {:.2f} ms, {} KB resident",
+        TEXT_SIZE / 1024, full_ms, full_resident / 1024, TOUCH_STRIDE, paged_ms, paged_resident / 1024);
+
+    REQUIRE(paged_resident < full_resident);
+}
@@ -0,0 +1,314 @@
+/*
+ * Copyright (c) 2022 EKA2L1 Team.
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+#include <common/buffer.h>
+#include <common/cvt.h>
+#include <common/log.h>
+#include <loader/rom.h>
+
+#include <fmt/format.h>
+
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace eka2l1;
+
+namespace {
+    struct test_rom_entry {
+        std::u16string name_;
+        std::uint32_t size_;
+        std::uint32_t address_;
+        bool is_dir_;
+    };
+
+    /**
+     * Lay out a ROM image with only a header and a directory tree. Directories are written before
+     * the entries pointing to them, so their address is known when the parent is added.
+     */
+    class test_rom_builder {
+        static constexpr std::uint32_t ROM_BASE = 0x80000000;
+        std::vector<std::uint8_t> data_;
+
+        template <typename T>
+        void put(const T &value) {
+            const std::uint8_t *bytes = reinterpret_cast<const std::uint8_t *>(&value);
+            data_.insert(data_.end(), bytes, bytes + sizeof(T));
+        }
+
+        void align() {
+            while (data_.size() % 4) {
+                data_.push_back(0);
+            }
+        }
+
+    public:
+        explicit test_rom_builder()
+            : data_(sizeof(loader::rom_header), 0) {
+        }
+
+        std::uint32_t add_dir(const std::vector<test_rom_entry> &entries) {
+            align();
+
+            const std::size_t dir_offset = data_.size();
+            put<std::int32_t>(0);
+
+            for (const auto &entry : entries) {
+                put<std::uint32_t>(entry.size_);
+                put<std::uint32_t>(entry.address_);
+                put<std::uint8_t>(entry.is_dir_ ? 0x10 : 0);
+                put<std::uint8_t>(static_cast<std::uint8_t>(entry.name_.size()));
+
+                data_.insert(data_.end(), reinterpret_cast<const std::uint8_t *>(entry.name_.data()),
+                    reinterpret_cast<const std::uint8_t *>(entry.name_.data() + entry.name_.size()));
+
+                align();
+            }
+
+            const std::int32_t dir_size = static_cast<std::int32_t>(data_.size() - dir_offset);
+            std::memcpy(&data_[dir_offset], &dir_size, sizeof(dir_size));
+
+            return ROM_BASE + static_cast<std::uint32_t>(dir_offset);
+        }
+
+        std::vector<std::uint8_t> finish(const std::uint32_t root_dir_address, const std::uint32_t checksum) {
+            align();
+
+            loader::rom_header header{};
+            header.rom_base = ROM_BASE;
+            header.rom_root_dir_list = ROM_BASE + static_cast<std::uint32_t>(data_.size());
+            header.checksum = checksum;
+
+            put<std::int32_t>(1);
+            put<std::uint32_t>(0);
+            put<std::uint32_t>(root_dir_address);
+
+            header.rom_size = static_cast<std::uint32_t>(data_.size());
+            std::memcpy(data_.data(), &header, sizeof(header));
+
+            return data_;
+        }
+    };
+}
+
+// Lay out Sys\Bin with mixed case names, plus numbered folders of numbered files. The paths of all files
+// are returned with the drive, in the case they were written.
+static std::vector<std::uint8_t> make_test_rom(const int folder_count, const int files_per_folder, std::vector<std::string> &file_paths,
+    const std::uint32_t checksum = 0x1234) {
+    test_rom_builder builder;
+    std::vector<test_rom_entry> root_entries;
+
+    std::vector<test_rom_entry> bin_entries = {
+        { u"EUser.dll", 0x1000, 0x80100000, false },
+        { u"eikcore.DLL", 0x2000, 0x80101000, false },
+        { u"Z.exe", 0x3000, 0x80103000, false }
+    };
+
+    for (const auto &entry : bin_entries) {
+        file_paths.push_back("Z:\\Sys\\Bin\\" + common::ucs2_to_utf8(entry.name_));
+    }
+
+    const std::uint32_t bin_address = builder.add_dir(bin_entries);
+    const std::uint32_t sys_address = builder.add_dir({ { u"Bin", 0, bin_address, true } });
+
+    root_entries.push_back({ u"Sys", 0, sys_address, true });
+
+    for (int i = 0; i < folder_count; i++) {
+        const std::u16string folder_name = common::utf8_to_ucs2(fmt::format("Folder{}", i));
+        std::vector<test_rom_entry> entries;
+
+        for (int j = 0; j < files_per_folder; j++) {
+            const std::string file_name = fmt::format("Resource{}.Rsc", j);
+
+            entries.push_back({ common::utf8_to_ucs2(file_name), static_cast<std::uint32_t>(j), static_cast<std::uint32_t>(i * files_per_folder + j), false });
+            file_paths.push_back(fmt::format("Z:\\{}\\{}", common::ucs2_to_utf8(folder_name), file_name));
+        }
+
+        root_entries.push_back({ folder_name, 0, builder.add_dir(entries), true });
+    }
+
+    return builder.finish(builder.add_dir(root_entries), checksum);
+}
+
+TEST_CASE("rom_index_lookup_ignores_case_and_separators", "rom") {
+    std::vector<std::string> file_paths;
+    std::vector<std::uint8_t> rom_data = make_test_rom(2, 4, file_paths);
+
+    common::ro_buf_stream stream(rom_data.data(), rom_data.size());
+    std::optional<loader::rom> romf = loader::load_rom(reinterpret_cast<common::ro_stream *>(&stream));
+
+    REQUIRE(romf);
+    REQUIRE_FALSE(romf->index.empty());
+    REQUIRE_FALSE(romf->index.restored);
+
+    auto entry = romf->burn_tree_find_entry(std::string("z:\\sys\\bin\\euser.dll"));
+    REQUIRE(entry);
+    REQUIRE(entry->address_lin == 0x80100000);
+    REQUIRE(entry->name == u"EUser.dll");
+
+    REQUIRE(romf->burn_tree_find_entry(u"Z:/SYS//BIN/EIKCORE.dll"));
+    REQUIRE(romf->burn_tree_find_entry(std::string("Z:\\Folder1\\resource3.rsc"))->size == 3);
+
+    REQUIRE_FALSE(romf->burn_tree_find_entry(std::string("Z:\\Sys\\Bin\\missing.dll")));
+    REQUIRE_FALSE(romf->burn_tree_find_entry(std::string("Z:\\Sys\\Bin")));
+
+    loader::rom_dir *bin_dir = romf->burn_tree_find_dir(std::string("z:\\SYS\\bin\\"));
+    REQUIRE(bin_dir);
+    REQUIRE(bin_dir->entries.size() == 3);
+
+    REQUIRE_FALSE(romf->burn_tree_find_dir(std::string("Z:\\")));
+    REQUIRE_FALSE(romf->burn_tree_find_dir(std::string("Z:\\Sys\\Lib")));
+}
+
+TEST_CASE("rom_index_matches_tree_walk", "rom") {
+    std::vector<std::string> file_paths;
+    std::vector<std::uint8_t> rom_data = make_test_rom(8, 16, file_paths);
+
+    common::ro_buf_stream stream(rom_data.data(), rom_data.size());
+    std::optional<loader::rom> romf = loader::load_rom(reinterpret_cast<common::ro_stream *>(&stream));
+
+    REQUIRE(romf);
+
+    std::vector<std::optional<loader::rom_entry>> indexed;
+
+    for (const auto &path : file_paths) {
+        indexed.push_back(romf->burn_tree_find_entry(common::lowercase_string(path)));
+        REQUIRE(indexed.back());
+    }
+
+    // Without the index, lookups walk the tree
+    romf->index.clear();
+
+    for (std::size_t i = 0; i < file_paths.size(); i++) {
+        auto walked = romf->burn_tree_find_entry(common::lowercase_string(file_paths[i]));
+
+        REQUIRE(walked);
+        REQUIRE(walked->address_lin == indexed[i]->address_lin);
+        REQUIRE(walked->size == indexed[i]->size);
+        REQUIRE(walked->name == indexed[i]->name);
+    }
+}
+
+TEST_CASE("rom_index_save_and_restore", "rom") {
+    std::vector<std::string> file_paths;
+    std::vector<std::uint8_t> rom_data = make_test_rom(4, 8, file_paths);
+
+    common::ro_buf_stream stream(rom_data.data(), rom_data.size());
+    std::optional<loader::rom> romf = loader::load_rom(reinterpret_cast<common::ro_stream *>(&stream));
+
+    REQUIRE(romf);
+
+    common::wo_growable_buf_stream index_out;
+    REQUIRE(romf->save_index(&index_out));
+
+    const std::string index_content = index_out.content();
+    std::vector<std::uint8_t> index_data(index_content.begin(), index_content.end());
+
+    {
+        common::ro_buf_stream rom_stream(rom_data.data(), rom_data.size());
+        common::ro_buf_stream index_stream(index_data.data(), index_data.size());
+
+        std::optional<loader::rom> restored = loader::load_rom(reinterpret_cast<common::ro_stream *>(&rom_stream),
+            reinterpret_cast<common::ro_stream *>(&index_stream));
+
+        REQUIRE(restored);
+        REQUIRE(restored->index.restored);
+        REQUIRE(restored->index.files.size() == romf->index.files.size());
+        REQUIRE(restored->index.dirs.size() == romf->index.dirs.size());
+
+        for (const auto &path : file_paths) {
+            auto entry = restored->burn_tree_find_entry(path);
+            auto original = romf->burn_tree_find_entry(path);
+
+            REQUIRE(entry);
+            REQUIRE(entry->address_lin == original->address_lin);
+            REQUIRE(entry->name == original->name);
+        }
+
+        REQUIRE(restored->burn_tree_find_dir(std::string("Z:\\Folder3"))->entries.size() == 8);
+    }
+
+    // An index of another ROM build is not used
+    std::vector<std::string> other_paths;
+    std::vector<std::uint8_t> other_rom_data = make_test_rom(4, 8, other_paths, 0x5678);
+
+    common::ro_buf_stream other_rom_stream(other_rom_data.data(), other_rom_data.size());
+    common::ro_buf_stream index_stream(index_data.data(), index_data.size());
+
+    std::optional<loader::rom> other = loader::load_rom(reinterpret_cast<common::ro_stream *>(&other_rom_stream),
+        reinterpret_cast<common::ro_stream *>(&index_stream));
+
+    REQUIRE(other);
+    REQUIRE_FALSE(other->index.restored);
+    REQUIRE(other->burn_tree_find_entry(other_paths.back()));
+
+    // Neither is a truncated one
+    common::ro_buf_stream short_rom_stream(rom_data.data(), rom_data.size());
+    common::ro_buf_stream short_index_stream(index_data.data(), index_data.size() / 2);
+
+    std::optional<loader::rom> fallback = loader::load_rom(reinterpret_cast<common::ro_stream *>(&short_rom_stream),
+        reinterpret_cast<common::ro_stream *>(&short_index_stream));
+
+    REQUIRE(fallback);
+    REQUIRE_FALSE(fallback->index.restored);
+    REQUIRE(fallback->index.files.size() == romf->index.files.size());
+}
+
+TEST_CASE("rom_resolve_all_files_bench", "rom") {
+    // Roughly the size of a S60v3 ROM: a few hundred folders and several thousand files
+    std::vector<std::string> file_paths;
+    std::vector<std::uint8_t> rom_data = make_test_rom(300, 24, file_paths);
+
+    common::ro_buf_stream stream(rom_data.data(), rom_data.size());
+
+    auto start = std::chrono::steady_clock::now();
+    std::optional<loader::rom> romf = loader::load_rom(reinterpret_cast<common::ro_stream *>(&stream));
+    const double load_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    REQUIRE(romf);
+
+    std::vector<std::u16string> lookup_paths;
+    for (const auto &path : file_paths) {
+        lookup_paths.push_back(common::utf8_to_ucs2(common::lowercase_string(path)));
+    }
+
+    auto resolve_all = [&]() {
+        std::size_t found = 0;
+        const auto resolve_start = std::chrono::steady_clock::now();
+
+        for (const auto &path : lookup_paths) {
+            if (romf->burn_tree_find_entry(path)) {
+                found++;
+            }
+        }
+
+        REQUIRE(found == lookup_paths.size());
+        return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - resolve_start).count() / lookup_paths.size();
+    };
+
+    const double indexed_ns = resolve_all();
+
+    romf->index.clear();
+    const double walked_ns = resolve_all();
+
+    LOG_INFO(LOADER, "Resolving {} ROM files: {:.0f} ns per lookup indexed, {:.0f} ns walking the tree, load with index {:.2f} ms",
+        lookup_paths.size(), indexed_ns, walked_ns, load_ms);
+}
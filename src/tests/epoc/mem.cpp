@@ -0,0 +1,441 @@
+/*
+ * Copyright (c) 2022 EKA2L1 Team.
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+#include <common/log.h>
+#include <common/virtualmem.h>
+#include <cpu/arm_interface.h>
+#include <mem/codetrack.h>
+#include <mem/control.h>
+#include <mem/chunk.h>
+#include <mem/fastmem.h>
+#include <mem/mem.h>
+#include <mem/mmu.h>
+#include <mem/process.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace eka2l1;
+
+TEST_CASE("code_tracker_mark_once", "code_page_tracker") {
+    mem::code_page_tracker tracker(12);
+
+    REQUIRE(tracker.mark(0x70001234));
+    REQUIRE_FALSE(tracker.mark(0x70001FFC));
+    REQUIRE(tracker.is_marked(0x70001000));
+    REQUIRE_FALSE(tracker.is_marked(0x70002000));
+    REQUIRE(tracker.marked_count() == 1);
+}
+
+TEST_CASE("code_tracker_invalidate_only_marked_runs", "code_page_tracker") {
+    mem::code_page_tracker tracker(12);
+
+    tracker.mark(0x70000000);
+    tracker.mark(0x70001000);
+    tracker.mark(0x70003000);
+    tracker.mark(0x80000000);
+
+    std::vector<std::pair<mem::vm_address, std::size_t>> runs;
+    const std::size_t total = tracker.invalidate(0x70000800, 0x10000, [&](const mem::vm_address addr, const std::size_t size) {
+        runs.emplace_back(addr, size);
+    });
+
+    REQUIRE(total == 3);
+    REQUIRE(runs.size() == 2);
+    REQUIRE(runs[0] == std::make_pair<mem::vm_address, std::size_t>(0x70000000, 0x2000));
+    REQUIRE(runs[1] == std::make_pair<mem::vm_address, std::size_t>(0x70003000, 0x1000));
+
+    // Pages outside the range are untouched
+    REQUIRE(tracker.is_marked(0x80000000));
+    REQUIRE(tracker.marked_count() == 1);
+}
+
+TEST_CASE("code_tracker_report_runs_keeps_marks", "code_page_tracker") {
+    mem::code_page_tracker tracker(12);
+
+    tracker.mark(0x00400000);
+    tracker.mark(0x00401000);
+
+    // A local chunk goes away in one process, another may still run code at the same address
+    std::vector<std::pair<mem::vm_address, std::size_t>> runs;
+    const std::size_t total = tracker.for_each_marked_run(0x00400000, 0x100000, [&](const mem::vm_address addr, const std::size_t size) {
+        runs.emplace_back(addr, size);
+    });
+
+    REQUIRE(total == 2);
+    REQUIRE(runs.size() == 1);
+    REQUIRE(runs[0] == std::make_pair<mem::vm_address, std::size_t>(0x00400000, 0x2000));
+
+    REQUIRE(tracker.is_marked(0x00400000));
+    REQUIRE(tracker.is_marked(0x00401000));
+    REQUIRE(tracker.marked_count() == 2);
+    REQUIRE(tracker.total_invalidated() == 0);
+}
+
+TEST_CASE("fastmem_arena_mirrors_host_pages", "fastmem_arena") {
+    if (!common::is_memory_mirroring_supported()) {
+        return;
+    }
+
+    mem::fastmem_arena arena;
+    REQUIRE(arena.valid());
+
+    const std::size_t page_size = common::get_host_page_size();
+
+    // Two pages of a chunk, mapped at a high guest address
+    std::uint8_t *host = reinterpret_cast<std::uint8_t *>(common::map_mirrorable_memory(page_size * 2));
+    REQUIRE(host);
+    REQUIRE(common::commit(host, page_size * 2, prot_read_write));
+
+    const mem::vm_address guest_addr = 0xC8000000;
+    REQUIRE(arena.mirror(guest_addr, page_size * 2, host, prot_read_write));
+
+    // Writes from either side are seen by the other
+    std::memcpy(host + 16, "EKA2L1", 6);
+    REQUIRE(std::memcmp(arena.base() + guest_addr + 16, "EKA2L1", 6) == 0);
+
+    arena.base()[guest_addr + page_size] = 0x5A;
+    REQUIRE(host[page_size] == 0x5A);
+
+    // Unaligned ranges are refused
+    REQUIRE_FALSE(arena.mirror(guest_addr + 1, page_size, host, prot_read_write));
+
+    // The source stays valid once the mirror is gone
+    arena.unmirror(guest_addr, page_size * 2);
+    REQUIRE(host[page_size] == 0x5A);
+
+    // Shared pages stay when the local ones are dropped for another address space
+    REQUIRE(arena.mirror(guest_addr, page_size, host, prot_read_write, true));
+    REQUIRE(arena.mirror(0x00400000, page_size, host + page_size, prot_read_write));
+
+    arena.unmirror_local();
+    REQUIRE(std::memcmp(arena.base() + guest_addr + 16, "EKA2L1", 6) == 0);
+
+    arena.unmirror_all();
+
+    common::unmap_memory(host, page_size * 2);
+}
+
+namespace {
+    // Stands in for a JIT backend. It keeps one translation of a code word, and counts the times its caches
+    // are touched by another host thread while it runs guest code.
+    class fake_jit_core : public arm::core {
+        std::atomic<bool> running_{ false };
+        std::atomic<bool> halt_{ false };
+        std::thread::id runner_;
+
+        std::optional<std::uint32_t> translated_;
+        std::uint32_t executed_ = 0;
+
+        void check_owner() {
+            if (running_ && (std::this_thread::get_id() != runner_)) {
+                foreign_touches_++;
+            }
+        }
+
+    public:
+        mem::control_base *control_ = nullptr;
+        std::atomic<std::uint32_t> *code_ = nullptr;
+        mem::vm_address code_addr_ = 0;
+
+        std::atomic<std::uint32_t> last_executed_{ 0 };
+        std::atomic<int> foreign_touches_{ 0 };
+
+        void run(const std::uint32_t instruction_count) override {
+            runner_ = std::this_thread::get_id();
+            running_ = true;
+
+            for (executed_ = 0; (executed_ < instruction_count) && !halt_; executed_++) {
+                if (!translated_) {
+                    // Same order as the MMU: the page is marked before the code is read
+                    control_->track_code_page(code_addr_);
+                    translated_ = code_->load();
+                }
+
+                last_executed_ = *translated_;
+            }
+
+            halt_ = false;
+            running_ = false;
+        }
+
+        void stop() override {
+            halt_ = true;
+        }
+
+        void imb_range(address addr, std::size_t size) override {
+            check_owner();
+            translated_.reset();
+        }
+
+        void clear_instruction_cache() override {
+            check_owner();
+            translated_.reset();
+        }
+
+        void dirty_tlb_page(const address addr) override {
+            check_owner();
+        }
+
+        void flush_tlb() override {
+            check_owner();
+        }
+
+        std::uint32_t get_num_instruction_executed() override {
+            return executed_;
+        }
+
+        void step() override {}
+        uint32_t get_reg(size_t idx) override { return 0; }
+        uint32_t get_sp() override { return 0; }
+        uint32_t get_pc() override { return 0; }
+        uint32_t get_vfp(size_t idx) override { return 0; }
+        void set_reg(size_t idx, uint32_t val) override {}
+        void set_cpsr(uint32_t val) override {}
+        void set_fpscr(uint32_t val) override {}
+        void set_pc(uint32_t val) override {}
+        void set_lr(uint32_t val) override {}
+        void set_sp(uint32_t val) override {}
+        void set_vfp(size_t idx, uint32_t val) override {}
+        uint32_t get_lr() override { return 0; }
+        uint32_t get_cpsr() override { return 0; }
+        std::uint32_t get_fpscr() override { return 0; }
+        void save_context(thread_context &ctx) override {}
+        void load_context(const thread_context &ctx) override {}
+        bool is_thumb_mode() override { return false; }
+        void set_tlb_page(const address vaddr, std::uint8_t *ptr, prot protection) override {}
+    };
+
+    class fake_mmu : public mem::mmu_base {
+    public:
+        explicit fake_mmu(mem::control_base *manager, arm::core *cpu)
+            : mem::mmu_base(manager, cpu, nullptr) {
+        }
+
+        void *get_host_pointer(const mem::vm_address addr) override { return nullptr; }
+        mem::page_info *get_page_info(const mem::vm_address addr) override { return nullptr; }
+        bool set_current_addr_space(const mem::asid id) override { return true; }
+        const mem::asid current_addr_space() const override { return 0; }
+    };
+
+    class fake_control : public mem::control_base {
+        std::vector<std::unique_ptr<fake_mmu>> mmus_;
+
+    protected:
+        void for_each_mmu(const std::function<void(mem::mmu_base *)> &func) override {
+            for (auto &mmu : mmus_) {
+                func(mmu.get());
+            }
+        }
+
+    public:
+        explicit fake_control()
+            : mem::control_base(nullptr, nullptr, nullptr, 12, false) {
+        }
+
+        mem::mmu_base *get_or_create_mmu(arm::core *cc) override {
+            for (auto &mmu : mmus_) {
+                if (mmu->cpu_ == cc) {
+                    return mmu.get();
+                }
+            }
+
+            mmus_.push_back(std::make_unique<fake_mmu>(this, cc));
+            return mmus_.back().get();
+        }
+
+        const mem::mem_model_type model_type() const override { return mem::mem_model_type::multiple; }
+        void *get_host_pointer(const mem::asid id, const mem::vm_address addr) override { return nullptr; }
+        mem::page_info *get_page_info(const mem::asid id, const mem::vm_address addr) override { return nullptr; }
+        mem::asid rollover_fresh_addr_space() override { return -1; }
+        void assign_page_table(mem::page_table *tab, const mem::vm_address linear_addr, const std::uint32_t flags, mem::asid *id_list, const std::uint32_t id_list_size) override {}
+    };
+}
+
+namespace {
+    // Counts the code each invalidation reaches
+    class imb_counting_core : public fake_jit_core {
+    public:
+        std::size_t invalidated_bytes_ = 0;
+        std::size_t invalidate_calls_ = 0;
+        std::size_t full_clears_ = 0;
+
+        void imb_range(address addr, std::size_t size) override {
+            invalidated_bytes_ += size;
+            invalidate_calls_++;
+        }
+
+        void clear_instruction_cache() override {
+            full_clears_++;
+        }
+    };
+}
+
+TEST_CASE("code_tracker_app_launch_exit_cycles", "code_page_tracker") {
+    // Launch and exit the same app a few times, through the memory model. Every launch creates the code chunk
+    // and a heap, runs code from some of the code pages, shrinks the heap and destroys everything on exit.
+    // Before pages were tracked, destroying the code chunk dropped the translations of all of it.
+    static constexpr int CYCLE_COUNT = 4;
+    static constexpr std::size_t CODE_CHUNK_SIZE = 0x30000;
+    static constexpr std::size_t EXECUTED_CODE_PAGES = 12;
+    static constexpr std::size_t HEAP_MAX_SIZE = 0x100000;
+    static constexpr std::size_t HEAP_COMMITTED = 0x20000;
+    static constexpr mem::vm_address ROM_CODE_ADDR = 0x80010000;
+
+    for (const mem::mem_model_type model : { mem::mem_model_type::multiple, mem::mem_model_type::flexible }) {
+        memory_system mem(nullptr, nullptr, model, false);
+        mem::control_base *control = mem.get_control();
+
+        imb_counting_core cc;
+        control->get_or_create_mmu(&cc);
+
+        // ROM code is translated once and never unmapped
+        control->track_code_page(ROM_CODE_ADDR);
+
+        std::size_t whole_chunk_pages = 0;
+
+        for (int cycle = 0; cycle < CYCLE_COUNT; cycle++) {
+            mem::mem_model_process_impl process = mem::make_new_mem_model_process(control, model);
+            REQUIRE(process);
+
+            mem::mem_model_chunk *code = nullptr;
+            mem::mem_model_chunk *heap = nullptr;
+
+            mem::mem_model_chunk_creation_info code_info{};
+            code_info.size = CODE_CHUNK_SIZE;
+            code_info.flags = mem::MEM_MODEL_CHUNK_REGION_USER_CODE | mem::MEM_MODEL_CHUNK_TYPE_NORMAL;
+            code_info.perm = prot_read_write_exec;
+
+            mem::mem_model_chunk_creation_info heap_info{};
+            heap_info.size = HEAP_MAX_SIZE;
+            heap_info.flags = mem::MEM_MODEL_CHUNK_REGION_USER_LOCAL | mem::MEM_MODEL_CHUNK_TYPE_NORMAL;
+            heap_info.perm = prot_read_write;
+
+            REQUIRE(process->create_chunk(code, code_info) == mem::MEM_MODEL_CHUNK_ERR_OK);
+            REQUIRE(process->create_chunk(heap, heap_info) == mem::MEM_MODEL_CHUNK_ERR_OK);
+
+            REQUIRE(code->commit(0, CODE_CHUNK_SIZE) != 0);
+            REQUIRE(heap->commit(0, HEAP_COMMITTED) != 0);
+
+            const mem::vm_address code_base = code->base(process.get());
+
+            for (std::size_t i = 0; i < EXECUTED_CODE_PAGES; i++) {
+                control->track_code_page(code_base + static_cast<mem::vm_address>((i * 3) << 12));
+            }
+
+            // Heap shrinks while the app runs, no code is in there
+            heap->decommit(HEAP_COMMITTED / 2, HEAP_COMMITTED / 2);
+
+            // Exit
+            process->delete_chunk(heap);
+            process->delete_chunk(code);
+
+            process.reset();
+
+            whole_chunk_pages += CODE_CHUNK_SIZE >> 12;
+        }
+
+        const std::size_t invalidated_pages = cc.invalidated_bytes_ >> 12;
+
+        LOG_INFO(MEMORY, "{} launch/exit cycles on the {} memory model: {} code pages translated, {} invalidated in {} calls, "
+            "{} with whole-chunk invalidation", CYCLE_COUNT, (model == mem::mem_model_type::multiple) ? "multiple" : "flexible",
+            control->code_tracker().total_marked(), invalidated_pages, cc.invalidate_calls_, whole_chunk_pages);
+
+        INFO("Memory model " << static_cast<int>(model));
+
+        // Only the pages code ran from are dropped, and the ROM code stays translated
+        REQUIRE(cc.full_clears_ == 0);
+        REQUIRE(invalidated_pages == EXECUTED_CODE_PAGES * CYCLE_COUNT);
+        REQUIRE(control->code_tracker().total_invalidated() == EXECUTED_CODE_PAGES * CYCLE_COUNT);
+        REQUIRE(control->code_tracker().total_marked() == EXECUTED_CODE_PAGES * CYCLE_COUNT + 1);
+        REQUIRE(control->is_code_page(ROM_CODE_ADDR));
+        REQUIRE(invalidated_pages < whole_chunk_pages);
+    }
+}
+
+TEST_CASE("code_write_on_other_core_reaches_running_core", "code_page_tracker") {
+    static constexpr std::uint32_t VERSION_COUNT = 200;
+    static constexpr mem::vm_address CODE_ADDR = 0x70001000;
+
+    fake_control control;
+    fake_jit_core writer_core;
+    fake_jit_core runner_core;
+
+    std::atomic<std::uint32_t> code{ 0 };
+
+    for (fake_jit_core *cc : { &writer_core, &runner_core }) {
+        cc->control_ = &control;
+        cc->code_ = &code;
+        cc->code_addr_ = CODE_ADDR;
+
+        control.get_or_create_mmu(cc);
+    }
+
+    mem::mmu_base *runner_mmu = control.get_or_create_mmu(&runner_core);
+    std::atomic<bool> done{ false };
+
+    std::thread runner([&]() {
+        while (!done) {
+            runner_mmu->apply_pending_maintenance();
+            runner_core.run(1000);
+        }
+    });
+
+    // Wait for the first translation, so the page is tracked
+    while (!control.is_code_page(CODE_ADDR)) {
+        std::this_thread::yield();
+    }
+
+    bool all_seen = true;
+
+    // The writer core patches the code, like a guest store does on a tracked page, while the other core runs it
+    control.get_or_create_mmu(&writer_core)->apply_pending_maintenance();
+
+    for (std::uint32_t version = 1; version <= VERSION_COUNT; version++) {
+        code = version;
+        control.invalidate_code_range(CODE_ADDR, 4);
+
+        const auto start = std::chrono::steady_clock::now();
+
+        while (runner_core.last_executed_ != version) {
+            if (std::chrono::steady_clock::now() - start > std::chrono::seconds(5)) {
+                all_seen = false;
+                break;
+            }
+
+            std::this_thread::yield();
+        }
+
+        if (!all_seen) {
+            break;
+        }
+    }
+
+    done = true;
+    runner.join();
+
+    REQUIRE(all_seen);
+    REQUIRE(runner_core.foreign_touches_ == 0);
+}
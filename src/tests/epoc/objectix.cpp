@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2022 EKA2L1 Team.
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+#include <kernel/common.h>
+#include <kernel/object_ix.h>
+
+#include <vector>
+
+using namespace eka2l1;
+
+namespace {
+    struct fake_kernel_object : public kernel::kernel_obj {
+        explicit fake_kernel_object()
+            : kernel::kernel_obj(nullptr) {
+        }
+
+        int decrease_access_count() override {
+            return --access_count;
+        }
+    };
+}
+
+TEST_CASE("object_ix_grows_with_open_handles", "object_ix") {
+    kernel::object_ix table;
+    fake_kernel_object obj;
+
+    REQUIRE(table.capacity() == 0);
+
+    std::vector<std::uint32_t> handles;
+    for (int i = 0; i < 100; i++) {
+        handles.push_back(table.add_object(&obj));
+    }
+
+    REQUIRE(table.total_open() == 100);
+    REQUIRE(table.capacity() == 128);
+    REQUIRE(obj.get_access_count() == 100);
+
+    for (std::size_t i = 0; i < handles.size(); i++) {
+        const kernel::handle_inspect_info info = kernel::inspect_handle(handles[i]);
+
+        // Thread local handles, lowest slots first
+        REQUIRE(info.handle_array_local);
+        REQUIRE(info.object_ix_index == static_cast<int>(i));
+        REQUIRE(table.get_object(handles[i]) == &obj);
+    }
+
+    REQUIRE(table.count(&obj) == 100);
+    REQUIRE(table.has(&obj));
+}
+
+TEST_CASE("object_ix_reuses_closed_slots", "object_ix") {
+    kernel::object_ix table;
+    fake_kernel_object first;
+    fake_kernel_object second;
+
+    const std::uint32_t first_handle = table.add_object(&first);
+    const std::uint32_t kept_handle = table.add_object(&first);
+
+    REQUIRE(table.close(first_handle) == 1);
+    REQUIRE(table.get_object(first_handle) == nullptr);
+    REQUIRE(table.close(first_handle) == -1);
+
+    const std::uint32_t second_handle = table.add_object(&second);
+
+    // Same slot, new instance
+    REQUIRE((second_handle & 0x7FFF) == (first_handle & 0x7FFF));
+    REQUIRE(second_handle != first_handle);
+
+    REQUIRE(table.get_object(second_handle) == &second);
+    REQUIRE(table.get_object(kept_handle) == &first);
+    REQUIRE(table.count(&first) == 1);
+    REQUIRE(table.capacity() == kernel::HANDLE_CHUNK_SIZE);
+}
+
+TEST_CASE("object_ix_limit_and_reset", "object_ix") {
+    kernel::object_ix table;
+    fake_kernel_object obj;
+
+    for (std::uint32_t i = 0; i < kernel::MAX_HANDLE_COUNT; i++) {
+        REQUIRE(table.add_object(&obj) != kernel::INVALID_HANDLE);
+    }
+
+    REQUIRE(table.add_object(&obj) == kernel::INVALID_HANDLE);
+    REQUIRE(table.capacity() == kernel::MAX_HANDLE_COUNT);
+
+    // Out of range handles miss instead of reading past the table
+    kernel::object_ix small_table;
+    REQUIRE(small_table.get_object(0x40000000 | 0x1234) == nullptr);
+    REQUIRE(small_table.close(0x40000000 | 0x1234) == -1);
+
+    table.reset();
+
+    REQUIRE(obj.get_access_count() == 0);
+    REQUIRE(table.total_open() == 0);
+    REQUIRE(table.capacity() == 0);
+}
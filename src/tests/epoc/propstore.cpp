@@ -0,0 +1,178 @@
+/*
+ * Copyright (c) 2022 EKA2L1 Team.
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+#include <kernel/property_store.h>
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+using namespace eka2l1;
+
+namespace {
+    // Identity and subscriptions like a property, without a kernel behind it
+    struct fake_property : public std::pair<int, int> {
+        int value_ = 0;
+        int subscribers_ = 0;
+        int published_ = 0;
+
+        void set(kernel::property_store<fake_property> &store, const int value) {
+            value_ = value;
+            store.queue_change(this);
+        }
+    };
+
+    using fake_store = kernel::property_store<fake_property>;
+
+    std::size_t publish_all(fake_store &store, std::size_t &completions) {
+        return store.flush([&](fake_property *prop) {
+            prop->published_++;
+
+            // Subscriptions are one shot, every waiting subscriber completes once
+            completions += prop->subscribers_;
+        });
+    }
+}
+
+TEST_CASE("property_store_identity_after_add", "property_store") {
+    fake_store store;
+    std::vector<std::unique_ptr<fake_property>> props;
+
+    for (int i = 0; i < 1000; i++) {
+        props.push_back(std::make_unique<fake_property>());
+        store.add(props.back().get());
+
+        // The kernel assigns the category and key after the object is created
+        props.back()->first = 0x10000000 + (i / 10);
+        props.back()->second = i % 10;
+    }
+
+    for (int i = 0; i < 1000; i++) {
+        REQUIRE(store.find(0x10000000 + (i / 10), i % 10) == props[i].get());
+    }
+
+    REQUIRE(store.find(0x10000000, 10) == nullptr);
+    REQUIRE(store.find(0x20000000, 0) == nullptr);
+
+    // Negative categories and keys are UIDs with the top bit set
+    fake_property negative;
+    store.add(&negative);
+    negative.first = static_cast<int>(0x80001234);
+    negative.second = -1;
+
+    REQUIRE(store.find(static_cast<int>(0x80001234), -1) == &negative);
+    REQUIRE(store.find(0x00001234, -1) == nullptr);
+
+    store.remove(props[5].get());
+    REQUIRE(store.find(0x10000000, 5) == nullptr);
+    REQUIRE(store.size() == 1000);
+}
+
+TEST_CASE("property_store_duplicate_identity", "property_store") {
+    fake_store store;
+    fake_property first;
+    fake_property second;
+
+    store.add(&first);
+    store.add(&second);
+
+    first.first = second.first = 0x101F8765;
+    first.second = second.second = 3;
+
+    // The first one created wins, like the linear search did
+    REQUIRE(store.find(0x101F8765, 3) == &first);
+
+    store.remove(&first);
+    REQUIRE(store.find(0x101F8765, 3) == &second);
+
+    store.remove(&second);
+    REQUIRE(store.find(0x101F8765, 3) == nullptr);
+    REQUIRE(store.size() == 0);
+}
+
+TEST_CASE("property_store_coalesce_changes", "property_store") {
+    fake_store store;
+    fake_property a;
+    fake_property b;
+
+    store.add(&a);
+    store.add(&b);
+
+    a.first = b.first = 0x10203040;
+    a.second = 1;
+    b.second = 2;
+
+    a.subscribers_ = 3;
+    b.subscribers_ = 1;
+
+    REQUIRE(store.queue_change(&a));
+    REQUIRE_FALSE(store.queue_change(&b));
+
+    for (int i = 0; i < 100; i++) {
+        a.set(store, i);
+    }
+
+    std::size_t completions = 0;
+    REQUIRE(publish_all(store, completions) == 2);
+    REQUIRE(completions == 4);
+    REQUIRE(a.published_ == 1);
+    REQUIRE(a.value_ == 99);
+    REQUIRE_FALSE(store.has_pending_changes());
+
+    // A new change after the flush must be scheduled again
+    REQUIRE(store.queue_change(&b));
+    store.remove(&b);
+    REQUIRE_FALSE(store.has_pending_changes());
+}
+
+TEST_CASE("property_store_publish_chains", "property_store") {
+    fake_store store;
+    fake_property source;
+    fake_property derived;
+    fake_property doomed;
+
+    for (fake_property *prop : { &source, &derived, &doomed }) {
+        store.add(prop);
+    }
+
+    source.first = derived.first = doomed.first = 0x10205030;
+    source.second = 1;
+    derived.second = 2;
+    doomed.second = 3;
+
+    source.set(store, 1);
+    doomed.set(store, 1);
+
+    // A property set while publishing is published in the same flush, and a property destroyed
+    // meanwhile is skipped.
+    const std::size_t published = store.flush([&](fake_property *prop) {
+        prop->published_++;
+
+        if (prop == &source) {
+            derived.set(store, source.value_ * 2);
+            store.remove(&doomed);
+        }
+    });
+
+    REQUIRE(published == 2);
+    REQUIRE(derived.published_ == 1);
+    REQUIRE(derived.value_ == 2);
+    REQUIRE(doomed.published_ == 0);
+}
@@ -0,0 +1,235 @@
+/*
+ * Copyright (c) 2022 EKA2L1 Team.
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+#include <kernel/registry.h>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace eka2l1;
+
+namespace {
+    static constexpr std::uint32_t ALIVE_MAGIC = 0xA11FE;
+
+    struct fake_object {
+        std::uint64_t uid_;
+        std::uint32_t magic_;
+
+        explicit fake_object(const std::uint64_t uid)
+            : uid_(uid)
+            , magic_(ALIVE_MAGIC) {
+        }
+
+        ~fake_object() {
+            magic_ = 0;
+        }
+
+        std::uint64_t unique_id() const {
+            return uid_;
+        }
+    };
+}
+
+TEST_CASE("object_registry_add_find_remove", "object_registry") {
+    kernel::object_registry<fake_object> registry;
+    std::vector<std::unique_ptr<fake_object>> objects;
+
+    for (std::uint64_t uid = 1; uid <= 5000; uid++) {
+        objects.push_back(std::make_unique<fake_object>(uid));
+        registry.add(uid, objects.back().get());
+    }
+
+    REQUIRE(registry.size() == 5000);
+
+    for (auto &obj : objects) {
+        REQUIRE(registry.find(obj->unique_id()) == obj.get());
+    }
+
+    REQUIRE(registry.find(0) == nullptr);
+    REQUIRE(registry.find(5001) == nullptr);
+
+    // Remove every other object, the rest must still be found past the holes
+    for (std::size_t i = 0; i < objects.size(); i += 2) {
+        REQUIRE(registry.remove(objects[i]->unique_id()));
+        REQUIRE_FALSE(registry.remove(objects[i]->unique_id()));
+    }
+
+    for (std::size_t i = 0; i < objects.size(); i++) {
+        REQUIRE(registry.find(objects[i]->unique_id()) == ((i % 2) ? objects[i].get() : nullptr));
+    }
+}
+
+TEST_CASE("object_registry_stale_id_misses", "object_registry") {
+    kernel::object_registry<fake_object> registry;
+
+    // Both IDs land in the same slot, the slot remembers which one it holds
+    fake_object first(3);
+    fake_object second(3 + 1024);
+
+    registry.add(first.unique_id(), &first);
+    registry.remove(first.unique_id());
+    registry.add(second.unique_id(), &second);
+
+    REQUIRE(registry.find(first.unique_id()) == nullptr);
+    REQUIRE(registry.find(second.unique_id()) == &second);
+
+    // And when both are alive, the later one probes further
+    registry.add(first.unique_id(), &first);
+    REQUIRE(registry.find(first.unique_id()) == &first);
+    REQUIRE(registry.find(second.unique_id()) == &second);
+}
+
+TEST_CASE("object_registry_retire_waits_for_readers", "object_registry") {
+    kernel::object_registry<fake_object> registry;
+
+    auto obj = std::make_unique<fake_object>(42);
+    fake_object *raw = obj.get();
+
+    registry.add(42, raw);
+
+    {
+        kernel::object_registry<fake_object>::read_guard guard(registry);
+        REQUIRE(registry.find(42) == raw);
+
+        registry.retire(42, std::move(obj));
+
+        // Gone from the table, but still usable by the reader
+        REQUIRE(registry.find(42) == nullptr);
+        REQUIRE(registry.pending_reclaim_count() == 1);
+        REQUIRE(raw->magic_ == ALIVE_MAGIC);
+    }
+
+    REQUIRE(registry.reclaim());
+    REQUIRE(registry.pending_reclaim_count() == 0);
+}
+
+TEST_CASE("object_registry_concurrent_readers", "object_registry") {
+    // The kernel thread creates and destroys objects while another thread, like the timer thread,
+    // keeps looking up recent IDs. A reader must never see a freed object.
+    kernel::object_registry<fake_object> registry;
+    std::vector<std::unique_ptr<fake_object>> live;
+
+    std::atomic<std::uint64_t> newest_uid = 0;
+    std::atomic<bool> stop = false;
+    std::atomic<std::uint64_t> bad_reads = 0;
+    std::atomic<std::uint64_t> hits = 0;
+
+    std::thread reader([&]() {
+        std::mt19937 rng(0x5EAD);
+
+        while (!stop) {
+            const std::uint64_t newest = newest_uid.load();
+            if (newest == 0) {
+                continue;
+            }
+
+            const std::uint64_t uid = newest - (rng() % std::min<std::uint64_t>(newest, 256));
+
+            kernel::object_registry<fake_object>::read_guard guard(registry);
+            fake_object *obj = registry.find(uid);
+
+            if (obj) {
+                if ((obj->magic_ != ALIVE_MAGIC) || (obj->unique_id() != uid)) {
+                    bad_reads++;
+                }
+
+                hits++;
+            }
+        }
+    });
+
+    std::mt19937 rng(0x3217E);
+
+    for (std::uint64_t uid = 1; uid <= 200000; uid++) {
+        live.push_back(std::make_unique<fake_object>(uid));
+        registry.add(uid, live.back().get());
+        newest_uid = uid;
+
+        if (live.size() > 128) {
+            const std::size_t victim = rng() % live.size();
+            const std::uint64_t victim_uid = live[victim]->unique_id();
+
+            registry.retire(victim_uid, std::move(live[victim]));
+            live.erase(live.begin() + victim);
+        }
+    }
+
+    stop = true;
+    reader.join();
+
+    INFO(hits.load() << " objects found by the reader");
+    REQUIRE(bad_reads == 0);
+    REQUIRE(registry.reclaim());
+    REQUIRE(registry.size() == live.size());
+}
+
+TEST_CASE("object_registry_reused_slot_never_mismatches", "object_registry") {
+    // All IDs land in the same slot. The writer keeps freeing the slot and giving it to the next ID,
+    // while the reader looks up IDs that held it before. A hit must always be the object asked for.
+    kernel::object_registry<fake_object> registry;
+    std::unique_ptr<fake_object> current;
+
+    static constexpr std::uint64_t SLOT_STRIDE = 1024;
+    static constexpr std::uint64_t ROUNDS = 200000;
+
+    std::atomic<std::uint64_t> newest_round = 0;
+    std::atomic<bool> stop = false;
+    std::atomic<std::uint64_t> bad_reads = 0;
+
+    std::thread reader([&]() {
+        while (!stop) {
+            const std::uint64_t round = newest_round.load();
+
+            for (std::uint64_t back = 0; back < 2 && back <= round; back++) {
+                const std::uint64_t uid = 7 + (round - back) * SLOT_STRIDE;
+
+                kernel::object_registry<fake_object>::read_guard guard(registry);
+                fake_object *obj = registry.find(uid);
+
+                if (obj && ((obj->magic_ != ALIVE_MAGIC) || (obj->unique_id() != uid))) {
+                    bad_reads++;
+                }
+            }
+        }
+    });
+
+    for (std::uint64_t round = 0; round < ROUNDS; round++) {
+        const std::uint64_t uid = 7 + round * SLOT_STRIDE;
+
+        if (current) {
+            const std::uint64_t old_uid = current->unique_id();
+            registry.retire(old_uid, std::move(current));
+        }
+
+        current = std::make_unique<fake_object>(uid);
+        registry.add(uid, current.get());
+        newest_round = round;
+    }
+
+    stop = true;
+    reader.join();
+
+    REQUIRE(bad_reads == 0);
+    REQUIRE(registry.find(current->unique_id()) == current.get());
+}
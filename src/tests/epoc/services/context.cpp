@@ -0,0 +1,241 @@
+/*
+ * Copyright (c) 2022 EKA2L1 Team.
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+#include <services/context.h>
+#include <utils/des.h>
+
+#include <cstring>
+#include <vector>
+
+using namespace eka2l1;
+
+namespace {
+    constexpr std::uint32_t TEST_PAGE_SIZE = 0x1000;
+    constexpr address TEST_DATA_BASE = 0x10000;
+
+    // Three guest pages, the second one is apart from the first in host memory, the third follows the second.
+    // Anything past them is not mapped.
+    struct split_address_space {
+        std::vector<std::uint8_t> host_;
+
+        split_address_space()
+            : host_(TEST_PAGE_SIZE * 4, 0) {
+        }
+
+        std::uint8_t *lookup(const address addr) {
+            if ((addr < TEST_DATA_BASE) || (addr >= TEST_DATA_BASE + TEST_PAGE_SIZE * 3)) {
+                return nullptr;
+            }
+
+            const std::uint32_t page = (addr - TEST_DATA_BASE) / TEST_PAGE_SIZE;
+            const std::uint32_t host_page = (page == 0) ? 0 : page + 1;
+
+            return host_.data() + host_page * TEST_PAGE_SIZE + (addr & (TEST_PAGE_SIZE - 1));
+        }
+
+        service::host_address_lookup_func lookup_func() {
+            return [this](const address addr) { return lookup(addr); };
+        }
+
+        service::descriptor_host_view view(epoc::desc_base &des, const address data_address, const std::uint32_t length,
+            const std::uint32_t max_length) {
+            service::descriptor_host_view result;
+            result.des_ = &des;
+            result.data_address_ = data_address;
+            result.data_ = lookup(data_address);
+            result.length_ = length;
+            result.max_length_ = max_length;
+            result.contiguous_length_ = service::host_contiguous_size(lookup_func(), TEST_PAGE_SIZE, data_address,
+                result.data_, max_length);
+
+            return result;
+        }
+    };
+
+    struct part_recorder {
+        std::vector<std::size_t> sizes_;
+        std::uint8_t next_ = 0;
+
+        service::descriptor_part_func fill() {
+            return [this](std::uint8_t *data, const std::size_t size) {
+                sizes_.push_back(size);
+
+                for (std::size_t i = 0; i < size; i++) {
+                    data[i] = next_++;
+                }
+
+                return size;
+            };
+        }
+
+        service::descriptor_part_func consume(std::vector<std::uint8_t> &out) {
+            return [this, &out](std::uint8_t *data, const std::size_t size) {
+                sizes_.push_back(size);
+                out.insert(out.end(), data, data + size);
+
+                return size;
+            };
+        }
+    };
+
+    epoc::desc_base make_descriptor(const epoc::des_type type) {
+        epoc::desc_base des;
+        des.set_descriptor_type(type);
+
+        return des;
+    }
+}
+
+TEST_CASE("descriptor_fill_contiguous_in_place", "ipc_context") {
+    split_address_space space;
+    epoc::desc_base des = make_descriptor(epoc::ptr);
+
+    const address data_address = TEST_DATA_BASE + 0x100;
+    const service::descriptor_host_view view = space.view(des, data_address, 0, 0x200);
+
+    REQUIRE(view.contiguous_length_ == 0x200);
+
+    part_recorder recorder;
+    const std::optional<std::uint32_t> filled = service::fill_descriptor_view(space.lookup_func(), TEST_PAGE_SIZE,
+        view, 0x200, recorder.fill());
+
+    REQUIRE(filled.value() == 0x200);
+    REQUIRE(recorder.sizes_ == std::vector<std::size_t>{ 0x200 });
+    REQUIRE(space.lookup(data_address)[0] == 0);
+    REQUIRE(space.lookup(data_address + 0x1FF)[0] == 0xFF);
+}
+
+TEST_CASE("descriptor_fill_split_pages", "ipc_context") {
+    split_address_space space;
+    epoc::desc_base des = make_descriptor(epoc::buf);
+
+    // Starts near the end of the first page, goes through the second one into the third
+    const address data_address = TEST_DATA_BASE + TEST_PAGE_SIZE - 0x10;
+    const std::uint32_t size = 0x10 + TEST_PAGE_SIZE + 0x20;
+    const service::descriptor_host_view view = space.view(des, data_address, 0, size);
+
+    REQUIRE(view.contiguous_length_ == 0x10);
+
+    part_recorder recorder;
+    const std::optional<std::uint32_t> filled = service::fill_descriptor_view(space.lookup_func(), TEST_PAGE_SIZE,
+        view, size, recorder.fill());
+
+    REQUIRE(filled.value() == size);
+
+    // The second and third page follow each other in host memory, so they are handed over as one part
+    REQUIRE(recorder.sizes_ == std::vector<std::size_t>{ 0x10, TEST_PAGE_SIZE + 0x20 });
+
+    for (std::uint32_t i = 0; i < size; i++) {
+        REQUIRE(space.lookup(data_address + i)[0] == static_cast<std::uint8_t>(i));
+    }
+
+    // Nothing in between the first and the second page in host memory is touched
+    REQUIRE(space.host_[TEST_PAGE_SIZE] == 0);
+    REQUIRE(space.host_[TEST_PAGE_SIZE * 2 - 1] == 0);
+}
+
+TEST_CASE("descriptor_consume_full_read", "ipc_context") {
+    split_address_space space;
+    epoc::desc_base des = make_descriptor(epoc::ptr_const);
+
+    const address data_address = TEST_DATA_BASE + TEST_PAGE_SIZE - 0x8;
+    const std::uint32_t length = 0x18;
+
+    for (std::uint32_t i = 0; i < length; i++) {
+        space.lookup(data_address + i)[0] = static_cast<std::uint8_t>(0xA0 + i);
+    }
+
+    const service::descriptor_host_view view = space.view(des, data_address, length, 0x40);
+
+    std::vector<std::uint8_t> read;
+    part_recorder recorder;
+
+    // Ask for more than the length, only the length is read
+    const std::uint32_t consumed = service::consume_descriptor_view(space.lookup_func(), TEST_PAGE_SIZE, view, 0x1000,
+        recorder.consume(read));
+
+    REQUIRE(consumed == length);
+    REQUIRE(recorder.sizes_ == std::vector<std::size_t>{ 0x8, 0x10 });
+    REQUIRE(read.size() == length);
+
+    for (std::uint32_t i = 0; i < length; i++) {
+        REQUIRE(read[i] == static_cast<std::uint8_t>(0xA0 + i));
+    }
+}
+
+TEST_CASE("descriptor_fill_capped_by_max_length", "ipc_context") {
+    split_address_space space;
+    epoc::desc_base des = make_descriptor(epoc::ptr);
+
+    const address data_address = TEST_DATA_BASE + 0x10;
+    const service::descriptor_host_view view = space.view(des, data_address, 0, 0x30);
+
+    part_recorder recorder;
+    const std::optional<std::uint32_t> filled = service::fill_descriptor_view(space.lookup_func(), TEST_PAGE_SIZE,
+        view, 0x100, recorder.fill());
+
+    REQUIRE(filled.value() == 0x30);
+    REQUIRE(recorder.sizes_ == std::vector<std::size_t>{ 0x30 });
+    REQUIRE(space.lookup(data_address + 0x30)[0] == 0);
+}
+
+TEST_CASE("descriptor_fill_stops_at_unmapped_page", "ipc_context") {
+    split_address_space space;
+    epoc::desc_base des = make_descriptor(epoc::ptr);
+
+    const address data_address = TEST_DATA_BASE + TEST_PAGE_SIZE * 3 - 0x20;
+    const service::descriptor_host_view view = space.view(des, data_address, 0, 0x40);
+
+    part_recorder recorder;
+    const std::optional<std::uint32_t> filled = service::fill_descriptor_view(space.lookup_func(), TEST_PAGE_SIZE,
+        view, 0x40, recorder.fill());
+
+    REQUIRE(filled.value() == 0x20);
+    REQUIRE(recorder.sizes_ == std::vector<std::size_t>{ 0x20 });
+}
+
+TEST_CASE("descriptor_fill_rejects_const", "ipc_context") {
+    split_address_space space;
+
+    for (const epoc::des_type type : { epoc::buf_const, epoc::ptr_const }) {
+        epoc::desc_base des = make_descriptor(type);
+        const service::descriptor_host_view view = space.view(des, TEST_DATA_BASE, 0x10, 0x10);
+
+        part_recorder recorder;
+        const std::optional<std::uint32_t> filled = service::fill_descriptor_view(space.lookup_func(), TEST_PAGE_SIZE,
+            view, 0x10, recorder.fill());
+
+        REQUIRE(!filled);
+        REQUIRE(recorder.sizes_.empty());
+        REQUIRE(space.lookup(TEST_DATA_BASE)[0] == 0);
+    }
+}
+
+TEST_CASE("descriptor_argument_rejects_16_bit", "ipc_context") {
+    REQUIRE(service::is_byte_descriptor_argument(ipc_arg_type::des8, false));
+    REQUIRE(service::is_byte_descriptor_argument(ipc_arg_type::desc8, false));
+    REQUIRE(!service::is_byte_descriptor_argument(ipc_arg_type::des16, false));
+    REQUIRE(!service::is_byte_descriptor_argument(ipc_arg_type::desc16, false));
+    REQUIRE(!service::is_byte_descriptor_argument(ipc_arg_type::handle, false));
+    REQUIRE(!service::is_byte_descriptor_argument(ipc_arg_type::unspecified, false));
+
+    // EKA1 does not record argument types
+    REQUIRE(service::is_byte_descriptor_argument(ipc_arg_type::unspecified, true));
+}
@@ -0,0 +1,753 @@
+/*
+ * Copyright (c) 2022 EKA2L1 Team.
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <drivers/graphics/graphics.h>
+#include <drivers/itc.h>
+#include <services/fbs/font_atlas.h>
+
+#include <common/algorithm.h>
+#include <common/log.h>
+
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace eka2l1;
+
+static constexpr int TEST_FONT_SIZE = 16;
+
+// Rasterized glyphs are solid blocks filled with a value derived from the code, spaces have no bitmap
+static std::uint8_t glyph_fill_value(const char16_t code) {
+    return static_cast<std::uint8_t>((code & 0x7F) | 0x80);
+}
+
+static eka2l1::vec2 glyph_bitmap_size(const char16_t code, const int font_size) {
+    if (code == u' ') {
+        return { 0, 0 };
+    }
+
+    // Two times oversampled, as the stb adapter does
+    return { font_size + (code % 7) * 2, font_size * 2 };
+}
+
+/**
+ * \brief Adapter which packs solid blocks row after row, like the real adapters keep packing on one context.
+ */
+class fake_glyph_adapter : public epoc::adapter::font_file_adapter_base {
+    struct pack_context {
+        std::uint8_t *dest_;
+        eka2l1::vec2 size_;
+        int x_ = 1;
+        int y_ = 1;
+        int row_height_ = 0;
+    };
+
+    std::map<std::int32_t, pack_context> contexts_;
+    std::int32_t next_handle_ = 0;
+
+protected:
+    std::uint32_t get_glyph_advance(const std::size_t face_index, const std::uint32_t codepoint, const std::uint32_t metric_identifier, const bool vertical) override {
+        return 0;
+    }
+
+public:
+    std::size_t rasterized_count_ = 0;
+
+    bool is_valid() override {
+        return true;
+    }
+
+    bool vectorizable() const override {
+        return true;
+    }
+
+    bool get_face_attrib(const std::size_t idx, epoc::open_font_face_attrib &face_attrib) override {
+        return false;
+    }
+
+    bool get_glyph_metric(const std::size_t idx, std::uint32_t code, epoc::open_font_character_metric &metric,
+        const std::int32_t baseline_horz_off, const std::uint32_t metric_identifier) override {
+        return false;
+    }
+
+    std::uint8_t *get_glyph_bitmap(const std::size_t idx, std::uint32_t code, const std::uint32_t metric_identifier,
+        int *rasterized_width, int *rasterized_height, std::uint32_t &total_size, epoc::glyph_bitmap_type *bmp_type) override {
+        return nullptr;
+    }
+
+    void free_glyph_bitmap(std::uint8_t *data) override {
+    }
+
+    epoc::glyph_bitmap_type get_output_bitmap_type() const override {
+        return epoc::glyph_bitmap_type::antialised_glyph_bitmap;
+    }
+
+    bool does_glyph_exist(std::size_t idx, std::uint32_t code, const std::uint32_t metric_identifier) override {
+        return true;
+    }
+
+    std::int32_t begin_get_atlas(std::uint8_t *atlas_ptr, const eka2l1::vec2 atlas_size) override {
+        pack_context context;
+        context.dest_ = atlas_ptr;
+        context.size_ = atlas_size;
+
+        contexts_.emplace(next_handle_, context);
+        return next_handle_++;
+    }
+
+    bool get_glyph_atlas(const std::int32_t handle, const std::size_t idx, const char16_t start_code, int *unicode_point,
+        const char16_t num_code, const std::uint32_t metric_identifier, epoc::adapter::character_info *info) override {
+        auto ite = contexts_.find(handle);
+        if (ite == contexts_.end()) {
+            return false;
+        }
+
+        pack_context &context = ite->second;
+        bool all_fit = true;
+
+        for (char16_t i = 0; i < num_code; i++) {
+            const char16_t code = unicode_point ? static_cast<char16_t>(unicode_point[i]) : static_cast<char16_t>(start_code + i);
+            const eka2l1::vec2 size = glyph_bitmap_size(code, static_cast<int>(metric_identifier));
+
+            if (context.x_ + size.x + 1 > context.size_.x) {
+                context.x_ = 1;
+                context.y_ += context.row_height_ + 1;
+                context.row_height_ = 0;
+            }
+
+            epoc::adapter::character_info cinfo{};
+
+            if (context.y_ + size.y + 1 > context.size_.y) {
+                all_fit = false;
+            } else {
+                for (int y = 0; y < size.y; y++) {
+                    std::memset(context.dest_ + (context.y_ + y) * context.size_.x + context.x_, glyph_fill_value(code), size.x);
+                }
+
+                cinfo.x0 = static_cast<std::uint16_t>(context.x_);
+                cinfo.y0 = static_cast<std::uint16_t>(context.y_);
+                cinfo.x1 = static_cast<std::uint16_t>(context.x_ + size.x);
+                cinfo.y1 = static_cast<std::uint16_t>(context.y_ + size.y);
+
+                context.x_ += size.x + 1;
+                context.row_height_ = std::max(context.row_height_, size.y);
+            }
+
+            cinfo.xoff = 0.0f;
+            cinfo.yoff = -static_cast<float>(metric_identifier);
+            cinfo.xoff2 = size.x / 2.0f;
+            cinfo.yoff2 = 0.0f;
+            cinfo.xadv = size.x / 2.0f + 1.0f;
+
+            if (info) {
+                info[i] = cinfo;
+            }
+        }
+
+        rasterized_count_ += num_code;
+        return all_fit;
+    }
+
+    void end_get_atlas(const std::int32_t handle) override {
+        contexts_.erase(handle);
+    }
+
+    std::size_t count() override {
+        return 1;
+    }
+
+    std::optional<epoc::open_font_metrics> get_metric_with_uid(const std::size_t face_index, const std::uint32_t uid,
+        std::uint32_t *metric_identifier) override {
+        return std::nullopt;
+    }
+
+    bool has_character(const std::size_t face_index, const std::int32_t codepoint, const std::uint32_t metric_identifier) override {
+        return true;
+    }
+
+    std::optional<epoc::open_font_metrics> get_nearest_supported_metric(const std::size_t face_index, const std::uint16_t targeted_font_size,
+        std::uint32_t *metric_identifier) override {
+        return std::nullopt;
+    }
+};
+
+/**
+ * \brief Driver which executes the commands the atlas emits on the caller thread.
+ *
+ * Uploads are applied to copies of the bitmaps, and each draw records the value found in the region it
+ * samples, so glyphs can be checked against what the GPU would have drawn at that point.
+ */
+class fake_atlas_driver : public drivers::graphics_driver {
+    struct fake_bitmap {
+        eka2l1::vec2 size_;
+        std::vector<std::uint8_t> data_;
+    };
+
+    std::map<drivers::handle, fake_bitmap> bitmaps_;
+    drivers::handle next_handle_ = 1;
+
+public:
+    struct sampled_glyph {
+        eka2l1::vec2 size_;
+        int value_; ///< Value filling the whole source region, or -1 if it's not uniform.
+    };
+
+    std::vector<sampled_glyph> last_samples_;
+
+    // Benchmarks only count the commands, so the time goes to the atlas
+    bool mirror_bitmaps_ = true;
+
+    std::size_t draw_commands_ = 0;
+    std::size_t upload_commands_ = 0;
+    std::size_t upload_bytes_ = 0;
+    std::size_t total_commands_ = 0;
+
+    explicit fake_atlas_driver()
+        : drivers::graphics_driver(drivers::graphic_api::opengl) {
+    }
+
+    void run() override {
+    }
+
+    void abort() override {
+    }
+
+    void update_bitmap(drivers::handle h, const std::size_t size, const eka2l1::vec2 &offset,
+        const eka2l1::vec2 &dim, const void *data, const std::size_t pixels_per_line) override {
+    }
+
+    void set_viewport(const eka2l1::rect &viewport) override {
+    }
+
+    void update_surface(void *surface) override {
+    }
+
+    void update_surface_size(const eka2l1::vec2 &size) override {
+    }
+
+    void set_upscale_shader(const std::string &name) override {
+    }
+
+    std::string get_active_upscale_shader() const override {
+        return "";
+    }
+
+    bool support_extension(const drivers::graphics_driver_extension ext) override {
+        return false;
+    }
+
+    bool query_extension_value(const drivers::graphics_driver_extension_query query, void *data_ptr) override {
+        return false;
+    }
+
+    void submit_command_list(drivers::command_list &cmd_list) override {
+        for (std::size_t i = 0; i < cmd_list.size_; i++) {
+            execute(cmd_list.base_[i]);
+        }
+
+        total_commands_ += cmd_list.size_;
+        delete[] cmd_list.base_;
+    }
+
+    std::size_t bitmap_count() const {
+        return bitmaps_.size();
+    }
+
+    void reset_counters() {
+        draw_commands_ = 0;
+        upload_commands_ = 0;
+        upload_bytes_ = 0;
+        total_commands_ = 0;
+    }
+
+private:
+    void sample(const drivers::handle h, const eka2l1::rect &source) {
+        if (!mirror_bitmaps_) {
+            return;
+        }
+
+        auto ite = bitmaps_.find(h);
+        REQUIRE(ite != bitmaps_.end());
+
+        const fake_bitmap &bmp = ite->second;
+        const std::uint8_t first = bmp.data_[source.top.y * bmp.size_.x + source.top.x];
+        int value = first;
+
+        for (int y = source.top.y; y < source.top.y + source.size.y; y++) {
+            const std::uint8_t *row = bmp.data_.data() + y * bmp.size_.x;
+
+            if (!std::all_of(row + source.top.x, row + source.top.x + source.size.x, [=](const std::uint8_t v) { return v == first; })) {
+                value = -1;
+            }
+        }
+
+        last_samples_.push_back({ source.size, value });
+    }
+
+    void execute(drivers::command &cmd) {
+        switch (cmd.opcode_) {
+        case drivers::graphics_driver_create_bitmap: {
+            fake_bitmap bmp;
+            drivers::unpack_u64_to_2u32(cmd.data_[0], bmp.size_.x, bmp.size_.y);
+            bmp.data_.assign(mirror_bitmaps_ ? bmp.size_.x * bmp.size_.y : 0, 0);
+
+            bitmaps_.emplace(next_handle_, std::move(bmp));
+            *reinterpret_cast<drivers::handle *>(cmd.data_[2]) = next_handle_++;
+
+            break;
+        }
+
+        case drivers::graphics_driver_destroy_bitmap:
+            REQUIRE(bitmaps_.erase(static_cast<drivers::handle>(cmd.data_[0])) == 1);
+            break;
+
+        case drivers::graphics_driver_update_bitmap: {
+            std::uint8_t *data = reinterpret_cast<std::uint8_t *>(cmd.data_[1]);
+            fake_bitmap &bmp = bitmaps_.at(static_cast<drivers::handle>(cmd.data_[0]));
+
+            eka2l1::vec2 offset;
+            eka2l1::vec2 dim;
+
+            drivers::unpack_u64_to_2u32(cmd.data_[3], offset.x, offset.y);
+            drivers::unpack_u64_to_2u32(cmd.data_[4], dim.x, dim.y);
+
+            REQUIRE(dim.x % 4 == 0);
+            REQUIRE(offset.x + dim.x <= bmp.size_.x);
+            REQUIRE(offset.y + dim.y <= bmp.size_.y);
+
+            for (int y = 0; mirror_bitmaps_ && (y < dim.y); y++) {
+                std::memcpy(bmp.data_.data() + (offset.y + y) * bmp.size_.x + offset.x, data + y * dim.x, dim.x);
+            }
+
+            upload_commands_++;
+            upload_bytes_ += static_cast<std::size_t>(cmd.data_[2]);
+
+            delete[] data;
+            break;
+        }
+
+        case drivers::graphics_driver_draw_bitmap: {
+            eka2l1::rect source;
+            drivers::unpack_u64_to_2u32(cmd.data_[4], source.top.x, source.top.y);
+            drivers::unpack_u64_to_2u32(cmd.data_[5], source.size.x, source.size.y);
+
+            sample(static_cast<drivers::handle>(cmd.data_[0]), source);
+            draw_commands_++;
+
+            break;
+        }
+
+        case drivers::graphics_driver_draw_bitmaps: {
+            const std::size_t count = static_cast<std::size_t>(cmd.data_[1]);
+            eka2l1::rect *rects = reinterpret_cast<eka2l1::rect *>(cmd.data_[2]);
+
+            for (std::size_t i = 0; i < count; i++) {
+                sample(static_cast<drivers::handle>(cmd.data_[0]), rects[count + i]);
+            }
+
+            draw_commands_++;
+
+            delete[] rects;
+            break;
+        }
+
+        default:
+            break;
+        }
+
+        if (cmd.status_) {
+            *cmd.status_ = 0;
+        }
+    }
+};
+
+/**
+ * \brief The atlas as it was before glyphs were packed on their own: a sorted LRU vector, a full
+ * atlas upload for every new glyph, and one draw command per glyph. Kept as the benchmark baseline.
+ */
+struct per_glyph_font_atlas {
+    std::map<char16_t, epoc::adapter::character_info> characters_;
+    std::vector<int> last_use_;
+
+    epoc::adapter::font_file_adapter_base *adapter_;
+    drivers::handle atlas_handle_ = 0;
+    std::unique_ptr<std::uint8_t[]> atlas_data_;
+    std::int32_t pack_handle_ = 0;
+    int size_;
+
+    explicit per_glyph_font_atlas(epoc::adapter::font_file_adapter_base *adapter, const int size)
+        : adapter_(adapter)
+        , size_(size) {
+    }
+
+    bool draw_text(const std::u16string &text, const eka2l1::vec2 &pos, drivers::graphics_driver *driver, drivers::graphics_command_builder &builder) {
+        const int width = common::align(ESTIMATE_MAX_CHAR_IN_ATLAS_WIDTH * size_, 1024);
+        drivers::graphics_command_builder upload_builder;
+
+        if (!atlas_data_) {
+            static constexpr char16_t INITIAL_COUNT = 0xFF - 0x20;
+
+            atlas_data_ = std::make_unique<std::uint8_t[]>(width * width);
+            auto cinfos = std::make_unique<epoc::adapter::character_info[]>(INITIAL_COUNT);
+
+            pack_handle_ = adapter_->begin_get_atlas(atlas_data_.get(), { width, width });
+            if (!adapter_->get_glyph_atlas(pack_handle_, 0, 0x20, nullptr, INITIAL_COUNT, size_, cinfos.get())) {
+                return false;
+            }
+
+            for (char16_t i = 0; i < INITIAL_COUNT; i++) {
+                last_use_.push_back(0x20 + i);
+                characters_.emplace(0x20 + i, cinfos[i]);
+            }
+
+            atlas_handle_ = drivers::create_bitmap(driver, { width, width }, 8);
+            upload_builder.update_bitmap(atlas_handle_, reinterpret_cast<const char *>(atlas_data_.get()),
+                width * width, { 0, 0 }, { width, width });
+        }
+
+        std::vector<int> to_rast;
+        std::vector<char16_t> unique_char;
+
+        for (auto &chr : text) {
+            if (characters_.find(chr) == characters_.end()) {
+                if (!std::binary_search(to_rast.begin(), to_rast.end(), chr)) {
+                    to_rast.push_back(chr);
+                    std::sort(to_rast.begin(), to_rast.end());
+                }
+            }
+
+            if (std::find(unique_char.begin(), unique_char.end(), chr) == unique_char.end()) {
+                last_use_.insert(last_use_.begin(), chr);
+                unique_char.push_back(chr);
+            }
+        }
+
+        last_use_.erase(last_use_.end() - unique_char.size(), last_use_.end());
+
+        if (!to_rast.empty()) {
+            auto cinfos = std::make_unique<epoc::adapter::character_info[]>(to_rast.size());
+
+            if (!adapter_->get_glyph_atlas(pack_handle_, 0, 0, to_rast.data(), static_cast<char16_t>(to_rast.size()), size_,
+                    cinfos.get())) {
+                return false;
+            }
+
+            for (std::size_t i = 0; i < to_rast.size(); i++) {
+                characters_.emplace(to_rast[i], cinfos[i]);
+            }
+
+            upload_builder.update_bitmap(atlas_handle_, reinterpret_cast<const char *>(atlas_data_.get()),
+                width * width, { 0, 0 }, { width, width });
+        }
+
+        eka2l1::vec2 cur_pos = pos;
+
+        builder.set_feature(drivers::graphics_feature::blend, true);
+
+        for (auto &chr : text) {
+            epoc::adapter::character_info &info = characters_[chr];
+
+            eka2l1::rect source_rect;
+            source_rect.top = { info.x0, info.y0 };
+            source_rect.size = eka2l1::object_size(info.x1 - info.x0, info.y1 - info.y0);
+
+            eka2l1::rect dest_rect;
+            dest_rect.top.x = cur_pos.x + static_cast<int>(info.xoff);
+            dest_rect.top.y = cur_pos.y + static_cast<int>(info.yoff);
+            dest_rect.size.x = static_cast<int>(info.xoff2 - info.xoff);
+            dest_rect.size.y = static_cast<int>(info.yoff2 - info.yoff);
+
+            if ((dest_rect.size.x != 0) && (dest_rect.size.y != 0) && (source_rect.size.x != 0) && (source_rect.size.y != 0)) {
+                builder.draw_bitmap(atlas_handle_, 0, dest_rect, source_rect, eka2l1::vec2(0, 0), 0.0f,
+                    drivers::bitmap_draw_flag_use_brush);
+            }
+
+            cur_pos.x += static_cast<int>(std::round(info.xadv));
+        }
+
+        builder.set_feature(drivers::graphics_feature::blend, false);
+
+        drivers::command_list retrieved = upload_builder.retrieve_command_list();
+        driver->submit_command_list(retrieved);
+
+        return true;
+    }
+};
+
+static void submit_builder(fake_atlas_driver &driver, drivers::graphics_command_builder &builder) {
+    drivers::command_list retrieved = builder.retrieve_command_list();
+    driver.submit_command_list(retrieved);
+}
+
+// Check that the glyphs drawn for a text sampled texture regions holding their bitmaps
+static void check_drawn_glyphs(const fake_atlas_driver &driver, const std::u16string &text) {
+    std::vector<char16_t> drawn;
+
+    for (const char16_t chr : text) {
+        if (glyph_bitmap_size(chr, TEST_FONT_SIZE).x != 0) {
+            drawn.push_back(chr);
+        }
+    }
+
+    REQUIRE(driver.last_samples_.size() == drawn.size());
+
+    for (std::size_t i = 0; i < drawn.size(); i++) {
+        REQUIRE(driver.last_samples_[i].size_ == glyph_bitmap_size(drawn[i], TEST_FONT_SIZE));
+        REQUIRE(driver.last_samples_[i].value_ == glyph_fill_value(drawn[i]));
+    }
+}
+
+static std::u16string make_text_line(const std::size_t seed, const std::size_t length, const char16_t extra_base, const std::size_t extra_every) {
+    static const std::u16string WORDS[] = {
+        u"Hello", u"meeting", u"tomorrow", u"at", u"the", u"office", u"Thanks!", u"See", u"you", u"soon",
+        u"Photo", u"received", u"12:45", u"Call", u"me", u"back", u"when", u"free", u"news", u"page"
+    };
+
+    std::u16string line;
+    std::size_t state = seed * 2654435761u + 1;
+
+    while (line.size() < length) {
+        state = state * 1103515245u + 12345u;
+        line += WORDS[(state >> 8) % (sizeof(WORDS) / sizeof(WORDS[0]))];
+
+        if (extra_every && ((state >> 4) % extra_every == 0)) {
+            // Accented letters, Greek and Cyrillic, as a page would have in a few of its words
+            line += static_cast<char16_t>(extra_base + ((state >> 12) % 96));
+        }
+
+        line += u' ';
+    }
+
+    line.resize(length);
+    return line;
+}
+
+TEST_CASE("font_atlas_uploads_only_new_glyphs", "font_atlas") {
+    fake_glyph_adapter adapter;
+    fake_atlas_driver driver;
+
+    epoc::font_atlas atlas(&adapter, 0, 0x20, 0xFF - 0x20, TEST_FONT_SIZE, TEST_FONT_SIZE);
+    drivers::graphics_command_builder builder;
+
+    const std::u16string first = u"Hello world";
+    REQUIRE(atlas.draw_text(first, eka2l1::rect({ 0, 20 }, { 240, 20 }), epoc::text_alignment::left, &driver, builder));
+    submit_builder(driver, builder);
+
+    // The whole atlas goes up once when created, and the text is one draw
+    const int width = atlas.get_atlas_width();
+    REQUIRE(driver.upload_commands_ == 1);
+    REQUIRE(driver.upload_bytes_ == static_cast<std::size_t>(width * width));
+    REQUIRE(driver.draw_commands_ == 1);
+    check_drawn_glyphs(driver, first);
+
+    // Glyphs of the prepacked range are drawn without rasterizing or uploading
+    const std::size_t rasterized = adapter.rasterized_count_;
+
+    driver.reset_counters();
+    driver.last_samples_.clear();
+
+    REQUIRE(atlas.draw_text(u"world Hello", eka2l1::rect({ 0, 20 }, { 240, 20 }), epoc::text_alignment::right, &driver, builder));
+    submit_builder(driver, builder);
+
+    REQUIRE(adapter.rasterized_count_ == rasterized);
+    REQUIRE(driver.upload_commands_ == 0);
+    REQUIRE(atlas.lru_.front() == u'o');
+
+    // New glyphs only upload the rows they are packed in
+    const std::u16string cyrillic = u"\u041F\u0440\u0438\u0432\u0435\u0442";
+
+    driver.reset_counters();
+    driver.last_samples_.clear();
+
+    REQUIRE(atlas.draw_text(cyrillic, eka2l1::rect({ 0, 20 }, { 240, 20 }), epoc::text_alignment::center, &driver, builder));
+    submit_builder(driver, builder);
+
+    REQUIRE(adapter.rasterized_count_ == rasterized + cyrillic.size());
+    REQUIRE(driver.upload_commands_ == 1);
+    REQUIRE(driver.upload_bytes_ < static_cast<std::size_t>(width * width / 8));
+    REQUIRE(driver.draw_commands_ == 1);
+    check_drawn_glyphs(driver, cyrillic);
+}
+
+TEST_CASE("font_atlas_evicts_least_recently_used", "font_atlas") {
+    fake_glyph_adapter adapter;
+    fake_atlas_driver driver;
+
+    epoc::font_atlas atlas(&adapter, 0, 0x20, 0xFF - 0x20, TEST_FONT_SIZE, TEST_FONT_SIZE);
+    drivers::graphics_command_builder builder;
+
+    // A line that stays in use the whole time, while lines of CJK ideographs fill the atlas many times over
+    const std::u16string pinned = u"Inbox (3)";
+    std::size_t resident_peak = 0;
+    std::size_t rebuild_count = 0;
+
+    for (char16_t line = 0; line < 120; line++) {
+        std::u16string text;
+
+        for (char16_t i = 0; i < 40; i++) {
+            text += static_cast<char16_t>(0x4E00 + line * 40 + i);
+        }
+
+        driver.last_samples_.clear();
+
+        // Both lines go in one frame, so the first is still queued when the second rebuilds the atlas
+        REQUIRE(atlas.draw_text(pinned, eka2l1::rect({ 0, 20 }, { 240, 20 }), epoc::text_alignment::left, &driver, builder));
+        const drivers::handle pinned_handle = atlas.atlas_handle_;
+
+        REQUIRE(atlas.draw_text(text, eka2l1::rect({ 0, 40 }, { 240, 20 }), epoc::text_alignment::left, &driver, builder));
+
+        if (atlas.atlas_handle_ != pinned_handle) {
+            rebuild_count++;
+        }
+
+        submit_builder(driver, builder);
+        check_drawn_glyphs(driver, pinned + text);
+
+        // The replaced bitmap is gone once the frame is done with it
+        REQUIRE(driver.bitmap_count() == 1);
+
+        resident_peak = std::max(resident_peak, atlas.lru_.size());
+    }
+
+    REQUIRE(rebuild_count > 1);
+
+    // Metrics of evicted glyphs stay, only the bitmaps go
+    REQUIRE(atlas.glyphs_.size() >= 120 * 40);
+    REQUIRE(resident_peak < 120 * 40);
+
+    const std::size_t evicted = std::count_if(atlas.glyphs_.begin(), atlas.glyphs_.end(), [](const auto &glyph) {
+        return !glyph.second.resident_;
+    });
+
+    REQUIRE(evicted > 0);
+    REQUIRE(evicted + atlas.lru_.size() == atlas.glyphs_.size());
+
+    // An evicted glyph is rasterized again when it is needed
+    const std::u16string first_line = std::u16string(1, static_cast<char16_t>(0x4E00));
+    REQUIRE_FALSE(atlas.glyphs_[first_line[0]].resident_);
+
+    driver.last_samples_.clear();
+
+    REQUIRE(atlas.draw_text(first_line, eka2l1::rect({ 0, 20 }, { 240, 20 }), epoc::text_alignment::left, &driver, builder));
+    submit_builder(driver, builder);
+    check_drawn_glyphs(driver, first_line);
+}
+
+TEST_CASE("font_atlas_text_scene_bench", "font_atlas") {
+    struct scene {
+        const char *name_;
+        std::size_t line_count_;
+        std::size_t line_length_;
+        char16_t extra_base_;
+        std::size_t extra_every_;
+    };
+
+    // A messaging list shows a dozen short rows, a web page fills the screen with long lines and
+    // picks up glyphs outside Latin-1 as it scrolls
+    static const scene SCENES[] = {
+        { "messaging list", 12, 32, 0xC0, 0 },
+        { "web page", 40, 90, 0x391, 6 }
+    };
+
+    static constexpr std::size_t FRAME_COUNT = 120;
+
+    for (const scene &current : SCENES) {
+        std::vector<std::vector<std::u16string>> frames(FRAME_COUNT);
+
+        for (std::size_t frame = 0; frame < FRAME_COUNT; frame++) {
+            for (std::size_t line = 0; line < current.line_count_; line++) {
+                // Scroll by one line every few frames
+                const std::size_t seed = line + frame / 4;
+                const char16_t extra_base = static_cast<char16_t>(current.extra_base_ + ((seed % 5) * 0x60) % 0x200);
+
+                frames[frame].push_back(make_text_line(seed, current.line_length_, extra_base, current.extra_every_));
+            }
+        }
+
+        std::size_t per_glyph_commands = 0;
+        std::size_t per_glyph_upload_bytes = 0;
+        std::size_t batched_commands = 0;
+        std::size_t batched_upload_bytes = 0;
+
+        fake_glyph_adapter per_glyph_adapter;
+        fake_atlas_driver per_glyph_driver;
+        per_glyph_driver.mirror_bitmaps_ = false;
+        per_glyph_font_atlas per_glyph_atlas(&per_glyph_adapter, TEST_FONT_SIZE);
+
+        const auto per_glyph_start = std::chrono::steady_clock::now();
+
+        for (const auto &lines : frames) {
+            drivers::graphics_command_builder builder;
+
+            for (std::size_t i = 0; i < lines.size(); i++) {
+                REQUIRE(per_glyph_atlas.draw_text(lines[i], { 0, static_cast<int>(i * 20) }, &per_glyph_driver, builder));
+            }
+
+            submit_builder(per_glyph_driver, builder);
+            per_glyph_driver.last_samples_.clear();
+        }
+
+        const double per_glyph_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - per_glyph_start).count();
+
+        per_glyph_commands = per_glyph_driver.total_commands_;
+        per_glyph_upload_bytes = per_glyph_driver.upload_bytes_;
+
+        fake_glyph_adapter adapter;
+        fake_atlas_driver driver;
+        driver.mirror_bitmaps_ = false;
+
+        epoc::font_atlas atlas(&adapter, 0, 0x20, 0xFF - 0x20, TEST_FONT_SIZE, TEST_FONT_SIZE);
+
+        const auto batched_start = std::chrono::steady_clock::now();
+
+        for (const auto &lines : frames) {
+            drivers::graphics_command_builder builder;
+
+            for (std::size_t i = 0; i < lines.size(); i++) {
+                REQUIRE(atlas.draw_text(lines[i], eka2l1::rect({ 0, static_cast<int>(i * 20) }, { 480, 20 }),
+                    epoc::text_alignment::left, &driver, builder));
+            }
+
+            submit_builder(driver, builder);
+            driver.last_samples_.clear();
+        }
+
+        const double batched_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - batched_start).count();
+
+        batched_commands = driver.total_commands_;
+        batched_upload_bytes = driver.upload_bytes_;
+
+        LOG_INFO(SERVICE_FBS, "Font atlas, {}: {:.1f} commands/frame, {} KB uploaded, {:.1f} us/frame per glyph; "
+            "{:.1f} commands/frame, {} KB uploaded, {:.1f} us/frame batched ({:.2f}x)",
+            current.name_, per_glyph_commands / static_cast<double>(FRAME_COUNT), per_glyph_upload_bytes / 1024,
+            per_glyph_seconds * 1000000.0 / FRAME_COUNT, batched_commands / static_cast<double>(FRAME_COUNT),
+            batched_upload_bytes / 1024, batched_seconds * 1000000.0 / FRAME_COUNT, per_glyph_seconds / batched_seconds);
+
+        // One draw and two blend state commands per line, against one draw per glyph
+        REQUIRE(driver.draw_commands_ == FRAME_COUNT * current.line_count_);
+        REQUIRE(batched_commands < per_glyph_commands);
+        REQUIRE(batched_upload_bytes <= per_glyph_upload_bytes);
+
+    }
+}
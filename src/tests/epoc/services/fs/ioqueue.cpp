@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2022 EKA2L1 Team.
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+#include <services/fs/io_queue.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace eka2l1;
+
+static void wait_until_idle(fs_io_queue &queue) {
+    while (queue.outstanding() != 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+TEST_CASE("fs_io_queue_keeps_session_order", "fs_io_queue") {
+    fs_io_queue queue(nullptr, 4, 64);
+
+    std::mutex order_lock;
+    std::vector<int> order;
+
+    auto record = [&](const int value) {
+        const std::lock_guard<std::mutex> guard(order_lock);
+        order.push_back(value);
+    };
+
+    std::atomic<bool> release_first = false;
+
+    queue.submit(
+        1, [&]() {
+            while (!release_first) {
+                std::this_thread::yield();
+            }
+        },
+        [&]() { record(1); });
+
+    REQUIRE(queue.is_busy(1));
+    REQUIRE_FALSE(queue.is_busy(2));
+
+    // The second deferred request goes to the workers again, the third one must wait for it
+    queue.defer(1, [&]() {
+        record(2);
+        queue.submit(
+            1, []() { std::this_thread::sleep_for(std::chrono::milliseconds(5)); }, [&]() { record(3); });
+    });
+
+    queue.defer(1, [&]() { record(4); });
+
+    // Other sessions are not held back
+    queue.submit(
+        2, []() {}, [&]() { record(10); });
+
+    while (queue.is_busy(2)) {
+        std::this_thread::yield();
+    }
+
+    release_first = true;
+    wait_until_idle(queue);
+
+    REQUIRE(order == std::vector<int>{ 10, 1, 2, 3, 4 });
+    REQUIRE_FALSE(queue.is_busy(1));
+}
+
+TEST_CASE("fs_io_queue_limits_outstanding", "fs_io_queue") {
+    fs_io_queue queue(nullptr, 1, 2);
+    std::atomic<bool> release = false;
+
+    auto blocked = [&]() {
+        while (!release) {
+            std::this_thread::yield();
+        }
+    };
+
+    REQUIRE(queue.has_slot());
+    queue.submit(1, blocked, []() {});
+    queue.submit(2, blocked, []() {});
+
+    REQUIRE_FALSE(queue.has_slot());
+
+    release = true;
+    wait_until_idle(queue);
+
+    REQUIRE(queue.has_slot());
+
+    fs_io_queue no_workers(nullptr, 0, 64);
+    REQUIRE_FALSE(no_workers.has_slot());
+}
+
+TEST_CASE("fs_io_queue_drain_waits_for_deferred_requests", "fs_io_queue") {
+    fs_io_queue queue(nullptr, 2, 64);
+
+    std::atomic<bool> release = false;
+    std::atomic<int> finished = 0;
+
+    queue.submit(
+        1, [&]() {
+            while (!release) {
+                std::this_thread::yield();
+            }
+        },
+        [&]() { finished++; });
+
+    // Released by the first finish, then goes to the workers again
+    queue.defer(1, [&]() {
+        queue.submit(
+            1, []() { std::this_thread::sleep_for(std::chrono::milliseconds(5)); }, [&]() { finished++; });
+    });
+
+    std::thread releaser([&]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        release = true;
+    });
+
+    queue.drain();
+    releaser.join();
+
+    REQUIRE(finished == 2);
+    REQUIRE(queue.outstanding() == 0);
+    REQUIRE_FALSE(queue.is_busy(1));
+
+    // Nothing in flight returns right away
+    queue.drain();
+}
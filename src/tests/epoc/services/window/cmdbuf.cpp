@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2022 EKA2L1 Team.
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <services/window/opheader.h>
+
+#include <catch2/catch.hpp>
+
+#include <cstring>
+#include <vector>
+
+using namespace eka2l1;
+
+static constexpr std::uint16_t NEW_HANDLE_FLAG = 0x8000;
+
+// Append a command the way the client buffer writes it: the handle is only there when it changes
+static void write_command(std::vector<std::uint8_t> &buffer, std::uint32_t &last_handle, const std::uint16_t op,
+    const std::uint32_t handle, const std::vector<std::uint8_t> &payload) {
+    ws_cmd_header header;
+    header.op = op;
+    header.cmd_len = static_cast<std::uint16_t>(payload.size());
+
+    if (handle != last_handle) {
+        header.op |= NEW_HANDLE_FLAG;
+    }
+
+    const std::size_t offset = buffer.size();
+    buffer.resize(offset + sizeof(header));
+    std::memcpy(buffer.data() + offset, &header, sizeof(header));
+
+    if (handle != last_handle) {
+        buffer.resize(buffer.size() + sizeof(handle));
+        std::memcpy(buffer.data() + buffer.size() - sizeof(handle), &handle, sizeof(handle));
+
+        last_handle = handle;
+    }
+
+    buffer.insert(buffer.end(), payload.begin(), payload.end());
+}
+
+TEST_CASE("ws_cmd_reader_in_place", "ws_cmd_reader") {
+    std::vector<std::uint8_t> buffer;
+    std::uint32_t last_handle = 0;
+
+    write_command(buffer, last_handle, 10, 0x40000001, { 1, 2, 3, 4, 5, 6, 7, 8 });
+    write_command(buffer, last_handle, 11, 0x40000001, { 9, 10, 11, 12 });
+    write_command(buffer, last_handle, 12, 0x40000002, {});
+
+    ws_cmd_reader reader(buffer.data(), buffer.size());
+    ws_cmd cmd;
+
+    REQUIRE(reader.next(cmd));
+    REQUIRE(cmd.header.op == 10);
+    REQUIRE(cmd.header.cmd_len == 8);
+    REQUIRE(cmd.obj_handle == 0x40000001);
+    REQUIRE(cmd.data_ptr == buffer.data() + sizeof(ws_cmd_header) + sizeof(std::uint32_t));
+
+    // Without the flag, the command goes to the object of the previous one
+    REQUIRE(reader.next(cmd));
+    REQUIRE(cmd.header.op == 11);
+    REQUIRE(cmd.obj_handle == 0x40000001);
+    REQUIRE(*reinterpret_cast<std::uint8_t *>(cmd.data_ptr) == 9);
+
+    REQUIRE(reader.next(cmd));
+    REQUIRE(cmd.header.op == 12);
+    REQUIRE(cmd.obj_handle == 0x40000002);
+
+    REQUIRE_FALSE(reader.next(cmd));
+    REQUIRE_FALSE(reader.truncated());
+}
+
+TEST_CASE("ws_cmd_reader_truncated", "ws_cmd_reader") {
+    std::vector<std::uint8_t> buffer;
+    std::uint32_t last_handle = 0;
+
+    write_command(buffer, last_handle, 10, 0x40000001, { 1, 2, 3, 4 });
+    write_command(buffer, last_handle, 11, 0x40000003, { 5, 6, 7, 8, 9, 10, 11, 12 });
+
+    // Cut in the payload, then in the handle, then in the header of the second command
+    for (const std::size_t cut : { buffer.size() - 1, std::size_t(12 + 6), std::size_t(12 + 2) }) {
+        ws_cmd_reader reader(buffer.data(), cut);
+        ws_cmd cmd;
+
+        REQUIRE(reader.next(cmd));
+        REQUIRE(cmd.header.op == 10);
+
+        REQUIRE_FALSE(reader.next(cmd));
+        REQUIRE(reader.truncated());
+    }
+}
@@ -0,0 +1,294 @@
+/*
+ * Copyright (c) 2022 EKA2L1 Team.
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <services/window/icon_cache.h>
+
+#include <common/fileutils.h>
+#include <common/log.h>
+
+#include <catch2/catch.hpp>
+
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <vector>
+
+using namespace eka2l1;
+
+static constexpr float ICON_VIEW_SIZE = 32.0f;
+
+template <typename T>
+static void write_value(std::vector<std::uint8_t> &data, const std::size_t offset, const T value) {
+    if (data.size() < offset + sizeof(T)) {
+        data.resize(offset + sizeof(T));
+    }
+
+    std::memcpy(data.data() + offset, &value, sizeof(T));
+}
+
+// Build an NVG icon with one filled rectangle per entry, path coordinates in 16-bit view box units
+static std::vector<std::uint8_t> make_nvg_icon(const std::vector<std::array<float, 4>> &rects, const std::uint32_t color) {
+    static constexpr std::uint16_t HEADER_SIZE = 52;
+
+    std::vector<std::uint8_t> data(HEADER_SIZE, 0);
+    data[0] = 'n';
+    data[1] = 'v';
+    data[2] = 'g';
+    data[3] = 1;
+
+    write_value<std::int16_t>(data, 4, HEADER_SIZE);
+    write_value<std::uint16_t>(data, 6, 0);
+    write_value<std::uint16_t>(data, 26, 2);
+
+    const float viewport[4] = { 0.0f, 0.0f, ICON_VIEW_SIZE, ICON_VIEW_SIZE };
+    std::memcpy(data.data() + 36, viewport, sizeof(viewport));
+
+    // One fill paint, then a path for each rectangle
+    const std::uint16_t vector_count = static_cast<std::uint16_t>(rects.size() + 1);
+    const std::size_t commands_offset = HEADER_SIZE + 2 + vector_count * 2;
+    const std::size_t data_offset = commands_offset + 2 + vector_count * 4;
+
+    write_value<std::uint16_t>(data, HEADER_SIZE, vector_count);
+    write_value<std::uint16_t>(data, commands_offset, vector_count);
+
+    std::size_t current = data_offset;
+
+    write_value<std::uint16_t>(data, HEADER_SIZE + 2, static_cast<std::uint16_t>(current));
+    write_value<std::uint32_t>(data, commands_offset + 2, (4 << 24) | (0xFF << 16));
+    write_value<std::uint32_t>(data, current, 1);
+    write_value<std::uint32_t>(data, current + 4, color);
+    current += 8;
+
+    for (std::size_t i = 0; i < rects.size(); i++) {
+        const std::uint16_t index = static_cast<std::uint16_t>(i + 1);
+
+        write_value<std::uint16_t>(data, HEADER_SIZE + 2 + index * 2, static_cast<std::uint16_t>(current));
+        write_value<std::uint32_t>(data, commands_offset + 2 + index * 4, (7 << 24) | 0x00020000 | index);
+
+        // Move, three lines, close
+        static const std::uint8_t SEGMENTS[] = { 2, 4, 4, 4, 0 };
+
+        write_value<std::uint16_t>(data, current, sizeof(SEGMENTS));
+        current += 2;
+
+        for (const std::uint8_t segment : SEGMENTS) {
+            write_value<std::uint8_t>(data, current++, segment);
+        }
+
+        current += current % 2;
+
+        const float x = rects[i][0] * 16;
+        const float y = rects[i][1] * 16;
+        const float r = rects[i][2] * 16;
+        const float b = rects[i][3] * 16;
+
+        const std::uint16_t coords[] = {
+            static_cast<std::uint16_t>(x), static_cast<std::uint16_t>(y),
+            static_cast<std::uint16_t>(r), static_cast<std::uint16_t>(y),
+            static_cast<std::uint16_t>(r), static_cast<std::uint16_t>(b),
+            static_cast<std::uint16_t>(x), static_cast<std::uint16_t>(b)
+        };
+
+        for (const std::uint16_t coord : coords) {
+            write_value<std::uint16_t>(data, current, coord);
+            current += 2;
+        }
+    }
+
+    return data;
+}
+
+static std::uint32_t pixel_at(const std::vector<std::uint8_t> &pixels, const int width, const int x, const int y) {
+    std::uint32_t value = 0;
+    std::memcpy(&value, pixels.data() + (y * width + x) * 4, 4);
+
+    return value;
+}
+
+TEST_CASE("icon_cache_hit_matches_render", "nvg_icon_cache") {
+    const std::vector<std::uint8_t> icon = make_nvg_icon({ { 4, 4, 28, 28 } }, 0xFF000000);
+    epoc::nvg_icon_cache cache(1024 * 1024);
+
+    std::vector<std::uint8_t> first(44 * 44 * 4);
+    std::vector<std::uint8_t> second(44 * 44 * 4);
+
+    REQUIRE(cache.get(icon.data(), icon.size(), 44, 44, loader::NVG_PRESERVE_ASPECT_RATIO, 0, first.data()));
+    REQUIRE(cache.get(icon.data(), icon.size(), 44, 44, loader::NVG_PRESERVE_ASPECT_RATIO, 0, second.data()));
+
+    REQUIRE(cache.render_count() == 1);
+    REQUIRE(cache.hit_count() == 1);
+    REQUIRE(first == second);
+
+    // Inside and outside of the rectangle
+    REQUIRE(pixel_at(first, 44, 22, 22) != 0);
+    REQUIRE(pixel_at(first, 44, 1, 1) == 0);
+
+    // Another colour is another entry
+    REQUIRE(cache.get(icon.data(), icon.size(), 44, 44, loader::NVG_PRESERVE_ASPECT_RATIO, 0xFF, second.data()));
+    REQUIRE(cache.render_count() == 2);
+}
+
+TEST_CASE("icon_cache_aspect_ratio_modes", "nvg_icon_cache") {
+    const std::vector<std::uint8_t> icon = make_nvg_icon({ { 0, 0, 32, 32 } }, 0xFF000000);
+    epoc::nvg_icon_cache cache(1024 * 1024);
+
+    static constexpr int WIDTH = 40;
+    static constexpr int HEIGHT = 20;
+
+    std::vector<std::uint8_t> pixels(WIDTH * HEIGHT * 4);
+
+    // The view box is centered, leaving ten columns on both sides
+    REQUIRE(cache.get(icon.data(), icon.size(), WIDTH, HEIGHT, loader::NVG_PRESERVE_ASPECT_RATIO, 0, pixels.data()));
+    REQUIRE(pixel_at(pixels, WIDTH, 5, 10) == 0);
+    REQUIRE(pixel_at(pixels, WIDTH, 20, 10) != 0);
+    REQUIRE(pixel_at(pixels, WIDTH, 35, 10) == 0);
+
+    // Unused space is removed from the right
+    REQUIRE(cache.get(icon.data(), icon.size(), WIDTH, HEIGHT, loader::NVG_PRESERVE_ASPECT_RATIO_AND_REMOVE_UNUSED_SPACE, 0, pixels.data()));
+    REQUIRE(pixel_at(pixels, WIDTH, 5, 10) != 0);
+    REQUIRE(pixel_at(pixels, WIDTH, 35, 10) == 0);
+
+    // Stretched and sliced both cover the whole target
+    REQUIRE(cache.get(icon.data(), icon.size(), WIDTH, HEIGHT, loader::NVG_NOT_PRESERVE_ASPECT_RATIO, 0, pixels.data()));
+    REQUIRE(pixel_at(pixels, WIDTH, 1, 10) != 0);
+    REQUIRE(pixel_at(pixels, WIDTH, 38, 10) != 0);
+
+    REQUIRE(cache.get(icon.data(), icon.size(), WIDTH, HEIGHT, loader::NVG_PRESERVE_ASPECT_RATIO_SLICE, 0, pixels.data()));
+    REQUIRE(pixel_at(pixels, WIDTH, 1, 1) != 0);
+    REQUIRE(pixel_at(pixels, WIDTH, 38, 18) != 0);
+
+    REQUIRE(cache.render_count() == 4);
+}
+
+TEST_CASE("icon_cache_respects_memory_budget", "nvg_icon_cache") {
+    static constexpr int ICON_SIZE = 32;
+    static constexpr std::size_t ICON_BYTES = ICON_SIZE * ICON_SIZE * 4;
+
+    epoc::nvg_icon_cache cache(ICON_BYTES * 4);
+    std::vector<std::uint8_t> pixels(ICON_BYTES);
+
+    std::vector<std::vector<std::uint8_t>> icons;
+
+    for (int i = 0; i < 8; i++) {
+        icons.push_back(make_nvg_icon({ { static_cast<float>(i), 0, 32, 32 } }, 0xFF000000));
+        REQUIRE(cache.get(icons.back().data(), icons.back().size(), ICON_SIZE, ICON_SIZE, loader::NVG_PRESERVE_ASPECT_RATIO, 0, pixels.data()));
+    }
+
+    REQUIRE(cache.icon_count() == 4);
+    REQUIRE(cache.memory_usage() == ICON_BYTES * 4);
+
+    // The most recent icons stay, the first ones are rendered again
+    REQUIRE(cache.get(icons[7].data(), icons[7].size(), ICON_SIZE, ICON_SIZE, loader::NVG_PRESERVE_ASPECT_RATIO, 0, pixels.data()));
+    REQUIRE(cache.hit_count() == 1);
+
+    REQUIRE(cache.get(icons[0].data(), icons[0].size(), ICON_SIZE, ICON_SIZE, loader::NVG_PRESERVE_ASPECT_RATIO, 0, pixels.data()));
+    REQUIRE(cache.render_count() == 9);
+}
+
+TEST_CASE("icon_cache_persists_to_disk", "nvg_icon_cache") {
+    static constexpr const char *CACHE_ROOT = "nvgiconcachetest/";
+    const std::vector<std::uint8_t> icon = make_nvg_icon({ { 2, 2, 30, 16 }, { 8, 18, 24, 30 } }, 0x00FF0000);
+
+    std::vector<std::uint8_t> rendered(48 * 48 * 4);
+    std::vector<std::uint8_t> loaded(48 * 48 * 4);
+
+    common::delete_folder(CACHE_ROOT);
+
+    {
+        epoc::nvg_icon_cache cache(1024 * 1024, CACHE_ROOT);
+        REQUIRE(cache.get(icon.data(), icon.size(), 48, 48, loader::NVG_PRESERVE_ASPECT_RATIO, 0, rendered.data()));
+        REQUIRE(cache.render_count() == 1);
+    }
+
+    {
+        epoc::nvg_icon_cache cache(1024 * 1024, CACHE_ROOT);
+        REQUIRE(cache.get(icon.data(), icon.size(), 48, 48, loader::NVG_PRESERVE_ASPECT_RATIO, 0, loaded.data()));
+        REQUIRE(cache.render_count() == 0);
+        REQUIRE(cache.disk_hit_count() == 1);
+    }
+
+    REQUIRE(rendered == loaded);
+    common::delete_folder(CACHE_ROOT);
+}
+
+TEST_CASE("icon_cache_menu_icon_set_bench", "nvg_icon_cache") {
+    // Synthetic stand-in for the S60 menu icon set: every application icon is requested at the
+    // grid, list and status pane sizes, like the menu, app shell and fast swap window do.
+    static constexpr int ICON_COUNT = 64;
+    static constexpr int SIZES[] = { 88, 44, 24 };
+    static constexpr int ROUNDS = 4;
+
+    std::vector<std::vector<std::uint8_t>> icons;
+
+    for (int i = 0; i < ICON_COUNT; i++) {
+        std::vector<std::array<float, 4>> rects;
+        for (int j = 0; j < 12; j++) {
+            const float offset = static_cast<float>((i + j) % 12);
+            rects.push_back({ offset, offset, 32.0f - offset / 2, 32.0f - offset / 3 });
+        }
+
+        icons.push_back(make_nvg_icon(rects, 0x00204000 | (static_cast<std::uint32_t>(i * 4) << 24)));
+    }
+
+    std::vector<std::uint8_t> pixels(SIZES[0] * SIZES[0] * 4);
+
+    auto render_set = [&](epoc::nvg_icon_cache &cache, const int size) {
+        for (const std::vector<std::uint8_t> &icon : icons) {
+            REQUIRE(cache.get(icon.data(), icon.size(), size, size, loader::NVG_PRESERVE_ASPECT_RATIO, 0, pixels.data()));
+        }
+    };
+
+    const auto time_of = [](auto func) {
+        const auto start = std::chrono::steady_clock::now();
+        func();
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    };
+
+    // Every request converts and parses the icon again, as the window server did before the cache
+    const double uncached_ms = time_of([&]() {
+        for (int i = 0; i < ROUNDS; i++) {
+            for (const int size : SIZES) {
+                epoc::nvg_icon_cache cache(0);
+                render_set(cache, size);
+            }
+        }
+    });
+
+    epoc::nvg_icon_cache cache(64 * 1024 * 1024);
+
+    const double first_ms = time_of([&]() {
+        for (const int size : SIZES) {
+            render_set(cache, size);
+        }
+    });
+
+    const double cached_ms = time_of([&]() {
+        for (int i = 0; i < ROUNDS; i++) {
+            for (const int size : SIZES) {
+                render_set(cache, size);
+            }
+        }
+    });
+
+    REQUIRE(cache.render_count() == ICON_COUNT * std::size(SIZES));
+    REQUIRE(cache.hit_count() == ICON_COUNT * std::size(SIZES) * ROUNDS);
+
+    LOG_INFO(SERVICE_WINDOW, "Menu icon set ({} icons, {} sizes): uncached {:.2f} ms/round, first render {:.2f} ms, cached {:.2f} ms/round",
+        ICON_COUNT, std::size(SIZES), uncached_ms / ROUNDS, first_ms, cached_ms / ROUNDS);
+}
@@ -0,0 +1,329 @@
+/*
+ * Copyright (c) 2022 EKA2L1 Team.
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <services/window/classes/winbase.h>
+#include <services/window/screen.h>
+
+#include <drivers/graphics/graphics.h>
+#include <drivers/itc.h>
+
+#include <catch2/catch.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <vector>
+
+using namespace eka2l1;
+
+static constexpr std::int32_t SCREEN_WIDTH = 8;
+static constexpr std::int32_t SCREEN_HEIGHT = 6;
+static constexpr std::uint32_t SCREEN_PITCH = SCREEN_WIDTH * 4;
+
+// Read the region out of a screen where each pixel holds its own coordinates, like the driver would
+static std::vector<std::uint8_t> make_readback(const eka2l1::rect &region, const std::uint32_t pitch) {
+    std::vector<std::uint8_t> staging(pitch * region.size.y, 0xCD);
+
+    for (std::int32_t y = 0; y < region.size.y; y++) {
+        for (std::int32_t x = 0; x < region.size.x; x++) {
+            std::uint8_t *pixel = staging.data() + y * pitch + x * 4;
+            pixel[0] = static_cast<std::uint8_t>(region.top.x + x);
+            pixel[1] = static_cast<std::uint8_t>(region.top.y + y);
+            pixel[2] = 0x55;
+            pixel[3] = 0xFF;
+        }
+    }
+
+    return staging;
+}
+
+TEST_CASE("copy_screen_readback_touches_only_region", "screen_readback") {
+    std::vector<std::uint8_t> buffer(SCREEN_PITCH * SCREEN_HEIGHT, 0);
+
+    // Source rows are padded wider than the region
+    const eka2l1::rect region(eka2l1::vec2(2, 1), eka2l1::vec2(3, 4));
+    const std::uint32_t source_pitch = 16;
+    const std::vector<std::uint8_t> staging = make_readback(region, source_pitch);
+
+    epoc::copy_screen_readback(buffer.data(), SCREEN_PITCH, SCREEN_HEIGHT, staging.data(), source_pitch, region, 4, false);
+
+    for (std::int32_t y = 0; y < SCREEN_HEIGHT; y++) {
+        for (std::int32_t x = 0; x < SCREEN_WIDTH; x++) {
+            const std::uint8_t *pixel = buffer.data() + y * SCREEN_PITCH + x * 4;
+            const bool inside = (x >= 2) && (x < 5) && (y >= 1) && (y < 5);
+
+            if (inside) {
+                REQUIRE(pixel[0] == x);
+                REQUIRE(pixel[1] == y);
+                REQUIRE(pixel[3] == 0xFF);
+            } else {
+                REQUIRE(pixel[3] == 0);
+            }
+        }
+    }
+}
+
+TEST_CASE("copy_screen_readback_flips_rows", "screen_readback") {
+    std::vector<std::uint8_t> buffer(SCREEN_PITCH * SCREEN_HEIGHT, 0);
+    const eka2l1::rect region(eka2l1::vec2(0, 0), eka2l1::vec2(SCREEN_WIDTH, 2));
+    const std::vector<std::uint8_t> staging = make_readback(region, SCREEN_PITCH);
+
+    epoc::copy_screen_readback(buffer.data(), SCREEN_PITCH, SCREEN_HEIGHT, staging.data(), SCREEN_PITCH, region, 4, true);
+
+    // Screen rows 0 and 1 are the last two rows of the buffer
+    REQUIRE(buffer[(SCREEN_HEIGHT - 1) * SCREEN_PITCH + 1] == 0);
+    REQUIRE(buffer[(SCREEN_HEIGHT - 2) * SCREEN_PITCH + 1] == 1);
+    REQUIRE(buffer[(SCREEN_HEIGHT - 1) * SCREEN_PITCH + 3] == 0xFF);
+    REQUIRE(buffer[(SCREEN_HEIGHT - 2) * SCREEN_PITCH + 3] == 0xFF);
+
+    for (std::int32_t y = 0; y < SCREEN_HEIGHT - 2; y++) {
+        REQUIRE(buffer[y * SCREEN_PITCH + 3] == 0);
+    }
+
+    // Reading back the whole screen in pieces must give the same buffer as in one go
+    std::vector<std::uint8_t> whole(SCREEN_PITCH * SCREEN_HEIGHT, 0);
+    std::vector<std::uint8_t> pieces(SCREEN_PITCH * SCREEN_HEIGHT, 0);
+
+    const eka2l1::rect full(eka2l1::vec2(0, 0), eka2l1::vec2(SCREEN_WIDTH, SCREEN_HEIGHT));
+    const std::vector<std::uint8_t> full_staging = make_readback(full, SCREEN_PITCH);
+    epoc::copy_screen_readback(whole.data(), SCREEN_PITCH, SCREEN_HEIGHT, full_staging.data(), SCREEN_PITCH, full, 4, true);
+
+    const eka2l1::rect top(eka2l1::vec2(0, 0), eka2l1::vec2(SCREEN_WIDTH, 3));
+    const eka2l1::rect bottom_left(eka2l1::vec2(0, 3), eka2l1::vec2(5, 3));
+    const eka2l1::rect bottom_right(eka2l1::vec2(5, 3), eka2l1::vec2(3, 3));
+
+    for (const eka2l1::rect &piece : { top, bottom_left, bottom_right }) {
+        const std::uint32_t pitch = piece.size.x * 4;
+        const std::vector<std::uint8_t> piece_staging = make_readback(piece, pitch);
+
+        epoc::copy_screen_readback(pieces.data(), SCREEN_PITCH, SCREEN_HEIGHT, piece_staging.data(), pitch, piece, 4, true);
+    }
+
+    REQUIRE(whole == pieces);
+}
+
+namespace {
+    /**
+     * \brief Driver keeping bitmaps as RGBA8888 pixels in host memory, enough for the screen readback path.
+     *
+     * Draws sample the nearest source pixel, which is what a scaled blit of a uniform block gives back.
+     */
+    class fake_screen_driver : public drivers::graphics_driver {
+        struct fake_bitmap {
+            eka2l1::vec2 size_;
+            std::vector<std::uint32_t> data_;
+        };
+
+        std::map<drivers::handle, fake_bitmap> bitmaps_;
+        drivers::handle next_handle_ = 1;
+        drivers::handle bound_ = 0;
+
+    public:
+        explicit fake_screen_driver()
+            : drivers::graphics_driver(drivers::graphic_api::opengl) {
+        }
+
+        void run() override {
+        }
+
+        void abort() override {
+        }
+
+        void update_bitmap(drivers::handle h, const std::size_t size, const eka2l1::vec2 &offset,
+            const eka2l1::vec2 &dim, const void *data, const std::size_t pixels_per_line) override {
+        }
+
+        void set_viewport(const eka2l1::rect &viewport) override {
+        }
+
+        void update_surface(void *surface) override {
+        }
+
+        void update_surface_size(const eka2l1::vec2 &size) override {
+        }
+
+        void set_upscale_shader(const std::string &name) override {
+        }
+
+        std::string get_active_upscale_shader() const override {
+            return "";
+        }
+
+        bool support_extension(const drivers::graphics_driver_extension ext) override {
+            return false;
+        }
+
+        bool query_extension_value(const drivers::graphics_driver_extension_query query, void *data_ptr) override {
+            return false;
+        }
+
+        void submit_command_list(drivers::command_list &cmd_list) override {
+            for (std::size_t i = 0; i < cmd_list.size_; i++) {
+                execute(cmd_list.base_[i]);
+            }
+
+            delete[] cmd_list.base_;
+        }
+
+        std::size_t bitmap_count() const {
+            return bitmaps_.size();
+        }
+
+        template <typename F>
+        void fill(const drivers::handle h, F pixel_func) {
+            fake_bitmap &bmp = bitmaps_.at(h);
+
+            for (int y = 0; y < bmp.size_.y; y++) {
+                for (int x = 0; x < bmp.size_.x; x++) {
+                    bmp.data_[y * bmp.size_.x + x] = pixel_func(x, y);
+                }
+            }
+        }
+
+    private:
+        void execute(drivers::command &cmd) {
+            int result = 0;
+
+            switch (cmd.opcode_) {
+            case drivers::graphics_driver_create_bitmap: {
+                fake_bitmap bmp;
+                drivers::unpack_u64_to_2u32(cmd.data_[0], bmp.size_.x, bmp.size_.y);
+                bmp.data_.assign(bmp.size_.x * bmp.size_.y, 0);
+
+                bitmaps_.emplace(next_handle_, std::move(bmp));
+                *reinterpret_cast<drivers::handle *>(cmd.data_[2]) = next_handle_++;
+
+                break;
+            }
+
+            case drivers::graphics_driver_destroy_bitmap:
+                REQUIRE(bitmaps_.erase(static_cast<drivers::handle>(cmd.data_[0])) == 1);
+                break;
+
+            case drivers::graphics_driver_bind_bitmap:
+                bound_ = static_cast<drivers::handle>(cmd.data_[0]);
+                break;
+
+            case drivers::graphics_driver_draw_bitmap: {
+                eka2l1::rect dest;
+                eka2l1::rect source;
+
+                drivers::unpack_u64_to_2u32(cmd.data_[2], dest.top.x, dest.top.y);
+                drivers::unpack_u64_to_2u32(cmd.data_[3], dest.size.x, dest.size.y);
+                drivers::unpack_u64_to_2u32(cmd.data_[4], source.top.x, source.top.y);
+                drivers::unpack_u64_to_2u32(cmd.data_[5], source.size.x, source.size.y);
+
+                const fake_bitmap &from = bitmaps_.at(static_cast<drivers::handle>(cmd.data_[0]));
+                fake_bitmap &to = bitmaps_.at(bound_);
+
+                for (int y = 0; y < dest.size.y; y++) {
+                    for (int x = 0; x < dest.size.x; x++) {
+                        const int sx = source.top.x + x * source.size.x / dest.size.x;
+                        const int sy = source.top.y + y * source.size.y / dest.size.y;
+
+                        to.data_[(dest.top.y + y) * to.size_.x + dest.top.x + x] = from.data_[sy * from.size_.x + sx];
+                    }
+                }
+
+                break;
+            }
+
+            case drivers::graphics_driver_read_bitmap: {
+                eka2l1::vec2 pos;
+                eka2l1::vec2 size;
+
+                drivers::unpack_u64_to_2u32(cmd.data_[1], pos.x, pos.y);
+                drivers::unpack_u64_to_2u32(cmd.data_[2], size.x, size.y);
+
+                const fake_bitmap &from = bitmaps_.at(static_cast<drivers::handle>(cmd.data_[0]));
+                std::uint8_t *dest = reinterpret_cast<std::uint8_t *>(cmd.data_[4]);
+
+                REQUIRE(pos.x + size.x <= from.size_.x);
+                REQUIRE(pos.y + size.y <= from.size_.y);
+
+                for (int y = 0; y < size.y; y++) {
+                    std::memcpy(dest + y * size.x * 4, from.data_.data() + (pos.y + y) * from.size_.x + pos.x, size.x * 4);
+                }
+
+                result = 1;
+                break;
+            }
+
+            default:
+                break;
+            }
+
+            // Sync commands are submitted with the driver lock held, so don't go through finish()
+            if (cmd.status_) {
+                *cmd.status_ = result;
+            }
+        }
+    };
+
+    std::uint32_t native_pixel(const int x, const int y) {
+        return 0xFF000000 | (static_cast<std::uint32_t>(y) << 8) | static_cast<std::uint32_t>(x);
+    }
+}
+
+TEST_CASE("screen_readback_scaled_screen_reads_native_pixels", "screen_readback") {
+    epoc::config::screen conf{};
+    conf.disp_mode = epoc::display_mode::color16ma;
+    conf.modes.push_back({ 0, 0, eka2l1::vec2(SCREEN_WIDTH, SCREEN_HEIGHT), 0, "" });
+
+    fake_screen_driver driver;
+    epoc::screen scr(0, conf);
+
+    // Fitted to a window twice as big, each guest pixel covers 2x2 pixels of the screen texture
+    scr.display_scale_factor = 2.0f;
+    scr.screen_texture = drivers::create_bitmap(&driver, eka2l1::vec2(SCREEN_WIDTH, SCREEN_HEIGHT) * 2, 32);
+
+    driver.fill(scr.screen_texture, [](const int x, const int y) {
+        return native_pixel(x / 2, y / 2);
+    });
+
+    const eka2l1::rect region(eka2l1::vec2(2, 1), eka2l1::vec2(3, 4));
+    scr.add_screen_buffer_dirty_rect(region);
+
+    drivers::graphics_command_builder builder;
+    scr.queue_screen_buffer_readback(builder, &driver);
+
+    drivers::command_list retrieved = builder.retrieve_command_list();
+    driver.submit_command_list(retrieved);
+
+    REQUIRE(scr.readback_pending_count_ == 1);
+
+    const epoc::screen_readback &readback = scr.readbacks_[0];
+    REQUIRE(readback.region_ == region);
+    REQUIRE(readback.staging_pitch_ == static_cast<std::uint32_t>(region.size.x * 4));
+
+    for (int y = 0; y < region.size.y; y++) {
+        for (int x = 0; x < region.size.x; x++) {
+            std::uint32_t pixel = 0;
+            std::memcpy(&pixel, readback.staging_.data() + y * readback.staging_pitch_ + x * 4, sizeof(pixel));
+
+            REQUIRE(pixel == native_pixel(region.top.x + x, region.top.y + y));
+        }
+    }
+
+    scr.retire_screen_buffer_readbacks(&driver, true);
+    REQUIRE(scr.readback_pending_count_ == 0);
+
+    scr.deinit(&driver);
+    REQUIRE(driver.bitmap_count() == 0);
+}
@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2022 EKA2L1 Team.
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+#include <kernel/smp/avail.h>
+#include <kernel/smp/balancer.h>
+
+#include <cstdlib>
+#include <vector>
+
+using namespace eka2l1;
+
+static kernel::smp::balance_candidate make_candidate(const std::uint32_t units, const std::uint32_t core,
+    const bool heavy = false, const bool movable = true) {
+    kernel::smp::balance_candidate candidate;
+    candidate.run_units_ = units;
+    candidate.heavy_ = heavy;
+    candidate.movable_ = movable;
+    candidate.current_core_ = core;
+    candidate.target_core_ = core;
+
+    return candidate;
+}
+
+static std::vector<std::int32_t> core_loads(const std::vector<kernel::smp::balance_candidate> &candidates,
+    const std::uint32_t core_count) {
+    std::vector<std::int32_t> loads(core_count, 0);
+
+    for (const auto &candidate : candidates) {
+        loads[candidate.target_core_] += candidate.run_units_;
+    }
+
+    return loads;
+}
+
+TEST_CASE("smp_load_units", "smp") {
+    REQUIRE(kernel::smp::calculate_load_units(0, 1000) == 0);
+    REQUIRE(kernel::smp::calculate_load_units(1000, 1000) == kernel::smp::cpu_availability::idle_unit);
+    REQUIRE(kernel::smp::calculate_load_units(500, 1000) == 2048);
+
+    // Can't use more than the whole core, and no time passed means no load
+    REQUIRE(kernel::smp::calculate_load_units(5000, 1000) == kernel::smp::cpu_availability::idle_unit);
+    REQUIRE(kernel::smp::calculate_load_units(100, 0) == 0);
+
+    // Long periods must not overflow
+    REQUIRE(kernel::smp::calculate_load_units(1ULL << 40, 1ULL << 41) == 2048);
+
+    REQUIRE(kernel::smp::is_heavy(30, 1000));
+    REQUIRE_FALSE(kernel::smp::is_heavy(25, 1000));
+    REQUIRE_FALSE(kernel::smp::is_heavy(30, kernel::smp::INACTIVE_LOAD_UNITS - 1));
+}
+
+TEST_CASE("smp_balance_spreads_load", "smp") {
+    // Everything started on core 0
+    std::vector<kernel::smp::balance_candidate> candidates = {
+        make_candidate(3000, 0),
+        make_candidate(2000, 0),
+        make_candidate(1000, 0),
+        make_candidate(1000, 0)
+    };
+
+    kernel::smp::balance(candidates, 2);
+    const std::vector<std::int32_t> loads = core_loads(candidates, 2);
+
+    // 3000 + 1000 against 2000 + 1000, the largest one stays where it was
+    REQUIRE(std::abs(loads[0] - loads[1]) == 1000);
+    REQUIRE(candidates[0].target_core_ == 0);
+    REQUIRE(candidates[1].target_core_ == 1);
+    REQUIRE(candidates[2].target_core_ == 1);
+    REQUIRE(candidates[3].target_core_ == 0);
+}
+
+TEST_CASE("smp_balance_keeps_pinned_groups", "smp") {
+    std::vector<kernel::smp::balance_candidate> candidates = {
+        make_candidate(3000, 1, false, false), // Running, can't move
+        make_candidate(kernel::smp::INACTIVE_LOAD_UNITS - 1, 1), // Too idle to bother
+        make_candidate(2000, 1),
+        make_candidate(500, 0)
+    };
+
+    kernel::smp::balance(candidates, 2);
+
+    REQUIRE(candidates[0].target_core_ == 1);
+    REQUIRE(candidates[1].target_core_ == 1);
+    REQUIRE(candidates[2].target_core_ == 0);
+    REQUIRE(candidates[3].target_core_ == 0);
+}
+
+TEST_CASE("smp_balance_heavy_groups_get_own_core", "smp") {
+    std::vector<kernel::smp::balance_candidate> candidates = {
+        make_candidate(100, 0, true),
+        make_candidate(200, 0, true),
+        make_candidate(3000, 0),
+        make_candidate(100, 0),
+    };
+
+    kernel::smp::balance(candidates, 4);
+
+    // The non-heavy ones spread over two cores, each heavy one gets one of the other two
+    REQUIRE(candidates[0].target_core_ != candidates[1].target_core_);
+    REQUIRE(candidates[2].target_core_ != candidates[3].target_core_);
+
+    for (int heavy = 0; heavy < 2; heavy++) {
+        REQUIRE(candidates[heavy].target_core_ != candidates[2].target_core_);
+        REQUIRE(candidates[heavy].target_core_ != candidates[3].target_core_);
+    }
+}
+
+TEST_CASE("smp_balance_single_core", "smp") {
+    std::vector<kernel::smp::balance_candidate> candidates = {
+        make_candidate(3000, 0, true),
+        make_candidate(2000, 3)
+    };
+
+    kernel::smp::balance(candidates, 1);
+
+    REQUIRE(candidates[0].target_core_ == 0);
+    REQUIRE(candidates[1].target_core_ == 0);
+}
@@ -0,0 +1,159 @@
+/*
+ * Copyright (c) 2022 EKA2L1 Team.
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <catch2/catch.hpp>
+#include <kernel/svc.h>
+#include <kernel/svctable.h>
+
+#include <string>
+#include <vector>
+
+using namespace eka2l1;
+
+static void svc_test_func_a(kernel_system *, kernel::process *, arm::core *) {
+}
+
+static void svc_test_func_b(kernel_system *, kernel::process *, arm::core *) {
+}
+
+static hle::epoc_import_func make_test_svc(const char *name, hle::import_func_ptr func) {
+    hle::epoc_import_func result;
+    result.func = func;
+    result.name = name;
+    result.direct = func;
+
+    return result;
+}
+
+TEST_CASE("svc_table_splits_group_and_index", "svc_table") {
+    const hle::func_map funcs = {
+        { 0x00000000, make_test_svc("slow_first", svc_test_func_a) },
+        { 0x00000005, make_test_svc("slow_sixth", svc_test_func_b) },
+        { 0x00800000, make_test_svc("fast_first", svc_test_func_a) },
+        { 0x0080000A, make_test_svc("fast_eleventh", svc_test_func_b) },
+        { 0x00FE0012, make_test_svc("last_group", svc_test_func_a) },
+        { 0x0001FFFF, make_test_svc("group_end", svc_test_func_b) }
+    };
+
+    hle::svc_table table;
+    REQUIRE(table.build(funcs) == 0);
+
+    for (const auto &[svcnum, func] : funcs) {
+        INFO("SVC 0x" << std::hex << svcnum);
+
+        hle::svc_table::slot *slot = table.find(svcnum);
+
+        REQUIRE(slot);
+        REQUIRE(slot->func_ == &func);
+    }
+
+    // Same index in another group is not mixed up
+    REQUIRE(table.find(0x00800005) == nullptr);
+    REQUIRE(table.find(0x0000000A) == nullptr);
+    REQUIRE(table.find(0x00010000) == nullptr);
+}
+
+TEST_CASE("svc_table_holes_and_out_of_range", "svc_table") {
+    const hle::func_map funcs = {
+        { 0x00000002, make_test_svc("two", svc_test_func_a) },
+        { 0x00000010, make_test_svc("sixteen", svc_test_func_b) },
+        { 0x01000000, make_test_svc("past_last_group", svc_test_func_a) },
+        { 0xFFFFFFFF, make_test_svc("all_ones", svc_test_func_b) }
+    };
+
+    hle::svc_table table;
+    REQUIRE(table.build(funcs) == 2);
+
+    // Holes inside a table
+    REQUIRE(table.find(0x00000000) == nullptr);
+    REQUIRE(table.find(0x00000003) == nullptr);
+    REQUIRE(table.find(0x0000000F) == nullptr);
+
+    // Past the end of a table, and in groups with no table
+    REQUIRE(table.find(0x00000011) == nullptr);
+    REQUIRE(table.find(0x0000FFFF) == nullptr);
+    REQUIRE(table.find(0x00800000) == nullptr);
+
+    // Numbers with a group too large are never dispatched
+    REQUIRE(table.find(0x01000000) == nullptr);
+    REQUIRE(table.find(0xFFFFFFFF) == nullptr);
+
+    REQUIRE(table.find(0x00000002)->func_->name == "two");
+    REQUIRE(table.find(0x00000010)->func_->name == "sixteen");
+}
+
+TEST_CASE("svc_table_dispatches_registered_svcs", "svc_table") {
+    // Each SVC must reach the function the old lookup by number found
+    const std::vector<const hle::func_map *> registers = {
+        &epoc::svc_register_funcs_v93,
+        &epoc::svc_register_funcs_v94,
+        &epoc::svc_register_funcs_v10,
+        &epoc::svc_register_funcs_v80,
+        &epoc::svc_register_funcs_v81a,
+        &epoc::svc_register_funcs_v6
+    };
+
+    for (const hle::func_map *funcs : registers) {
+        hle::svc_table table;
+        REQUIRE(table.build(*funcs) == 0);
+
+        for (const auto &[svcnum, func] : *funcs) {
+            INFO("SVC 0x" << std::hex << svcnum << " " << func.name);
+
+            const hle::svc_table::slot *slot = table.find(svcnum);
+
+            REQUIRE(slot);
+            REQUIRE(slot->func_ == &funcs->find(svcnum)->second);
+            REQUIRE(slot->func_->direct == func.direct);
+        }
+    }
+}
+
+TEST_CASE("svc_table_profile_output", "svc_table") {
+    const hle::func_map funcs = {
+        { 0x00000001, make_test_svc("cheap", svc_test_func_a) },
+        { 0x00800003, make_test_svc("expensive", svc_test_func_b) },
+        { 0x00000004, make_test_svc("never_called", svc_test_func_a) }
+    };
+
+    hle::svc_table table;
+    table.build(funcs);
+
+    REQUIRE(table.profile_json(100000000).empty());
+
+    table.find(0x00000001)->call_count_ = 10;
+    table.find(0x00000001)->host_time_ns_ = 5000;
+    table.find(0x00800003)->call_count_ = 2;
+    table.find(0x00800003)->host_time_ns_ = 40000;
+
+    // At 100 MHz, one nanosecond of host time is a tenth of a guest cycle
+    const std::string expected = "{\n"
+                                 "    \"svcs\": [\n"
+                                 "        { \"number\": \"0x800003\", \"name\": \"expensive\", \"calls\": 2, \"host_time_us\": 40, \"host_time_in_guest_cycles\": 4000 },\n"
+                                 "        { \"number\": \"0x1\", \"name\": \"cheap\", \"calls\": 10, \"host_time_us\": 5, \"host_time_in_guest_cycles\": 500 }\n"
+                                 "    ]\n"
+                                 "}\n";
+
+    REQUIRE(table.profile_json(100000000) == expected);
+
+    // Rebuilding starts counting again
+    table.build(funcs);
+    REQUIRE(table.profile_json(100000000).empty());
+}
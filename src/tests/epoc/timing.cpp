@@ -0,0 +1,203 @@
+/*
+ * Copyright (c) 2022 EKA2L1 Team.
+ *
+ * This file is part of EKA2L1 project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+#include <common/log.h>
+#include <kernel/timing.h>
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+
+using namespace eka2l1;
+
+static event make_event(const int type, const std::uint64_t time, const std::uint64_t userdata) {
+    event evt;
+    evt.event_type = type;
+    evt.event_time = time;
+    evt.event_user_data = userdata;
+
+    return evt;
+}
+
+TEST_CASE("event_queue_pops_in_due_order", "event_queue") {
+    event_queue queue;
+
+    queue.push(make_event(0, 300, 1));
+    queue.push(make_event(0, 100, 2));
+    queue.push(make_event(0, 200, 3));
+    queue.push(make_event(0, 100, 4));
+
+    REQUIRE(queue.size() == 4);
+    REQUIRE(queue.top()->event_user_data == 2);
+
+    // Same due time keeps the push order
+    REQUIRE(queue.pop().event_user_data == 2);
+    REQUIRE(queue.pop().event_user_data == 4);
+    REQUIRE(queue.pop().event_user_data == 3);
+    REQUIRE(queue.pop().event_user_data == 1);
+    REQUIRE(queue.empty());
+    REQUIRE(queue.top() == nullptr);
+}
+
+TEST_CASE("event_queue_cancel_by_handle", "event_queue") {
+    event_queue queue;
+
+    const event_handle first = queue.push(make_event(0, 100, 1));
+    const event_handle second = queue.push(make_event(0, 200, 2));
+
+    REQUIRE(first != INVALID_EVENT_HANDLE);
+    REQUIRE(queue.cancel(first));
+    REQUIRE_FALSE(queue.cancel(first));
+    REQUIRE(queue.top()->event_user_data == 2);
+
+    // The freed slot is reused, the old handle must not cancel the new event
+    const event_handle third = queue.push(make_event(0, 50, 3));
+    REQUIRE(third != first);
+    REQUIRE_FALSE(queue.cancel(first));
+    REQUIRE(queue.size() == 2);
+
+    queue.pop();
+    REQUIRE_FALSE(queue.cancel(third));
+    REQUIRE(queue.cancel(second));
+    REQUIRE(queue.empty());
+}
+
+TEST_CASE("event_queue_cancel_by_type_and_data", "event_queue") {
+    event_queue queue;
+
+    queue.push(make_event(0, 100, 7));
+    queue.push(make_event(1, 150, 7));
+    queue.push(make_event(0, 200, 7));
+
+    // The one due last goes first
+    REQUIRE(queue.cancel(0, 7));
+    REQUIRE_FALSE(queue.cancel(2, 7));
+    REQUIRE(queue.size() == 2);
+
+    REQUIRE(queue.pop().event_time == 100);
+    REQUIRE(queue.pop().event_time == 150);
+    REQUIRE_FALSE(queue.cancel(0, 7));
+}
+
+TEST_CASE("event_queue_matches_sorted_list", "event_queue") {
+    // Random pushes, cancels and pops against a plain list searched linearly.
+    struct reference_event {
+        event evt_;
+        std::uint64_t order_;
+        event_handle handle_;
+    };
+
+    std::mt19937 rng(0x71E);
+    event_queue queue;
+
+    std::vector<reference_event> reference;
+    std::uint64_t order = 0;
+
+    auto reference_earliest = [&]() {
+        return std::min_element(reference.begin(), reference.end(), [](const reference_event &lhs, const reference_event &rhs) {
+            return (lhs.evt_.event_time != rhs.evt_.event_time) ? (lhs.evt_.event_time < rhs.evt_.event_time) : (lhs.order_ < rhs.order_);
+        });
+    };
+
+    for (int i = 0; i < 20000; i++) {
+        const std::uint32_t action = rng() % 8;
+
+        if ((action < 4) || reference.empty()) {
+            const event evt = make_event(static_cast<int>(rng() % 4), rng() % 1000, rng() % 64);
+            reference.push_back({ evt, order++, queue.push(evt) });
+        } else if (action < 6) {
+            const std::size_t victim = rng() % reference.size();
+
+            REQUIRE(queue.cancel(reference[victim].handle_));
+            reference.erase(reference.begin() + victim);
+        } else {
+            auto earliest = reference_earliest();
+            const event evt = queue.pop();
+
+            REQUIRE(evt.event_time == earliest->evt_.event_time);
+            REQUIRE(evt.event_user_data == earliest->evt_.event_user_data);
+            REQUIRE(evt.event_type == earliest->evt_.event_type);
+
+            reference.erase(earliest);
+        }
+
+        REQUIRE(queue.size() == reference.size());
+    }
+}
+
+TEST_CASE("event_queue_schedule_cancel_bench", "event_queue") {
+    // Keep a few hundred timers live, like audio streams, RTimers and sleeping threads do, and move a
+    // clock forward. Each step reschedules some timers, cancels others, and fires what is due.
+    static constexpr std::size_t LIVE_EVENTS = 512;
+    static constexpr std::size_t STEPS = 100000;
+
+    std::mt19937 rng(0xBE7C);
+    event_queue queue;
+
+    std::vector<event_handle> handles;
+    std::vector<double> advance_ns;
+
+    advance_ns.reserve(STEPS);
+
+    std::uint64_t clock = 0;
+    std::uint64_t operations = 0;
+    std::uint64_t fired = 0;
+
+    for (std::size_t i = 0; i < LIVE_EVENTS; i++) {
+        handles.push_back(queue.push(make_event(0, rng() % 20000, i)));
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+
+    for (std::size_t step = 0; step < STEPS; step++) {
+        clock += 10;
+
+        const std::size_t victim = rng() % handles.size();
+        if (queue.cancel(handles[victim])) {
+            operations++;
+        }
+
+        handles[victim] = queue.push(make_event(0, clock + rng() % 20000, victim));
+        operations++;
+
+        const auto advance_start = std::chrono::steady_clock::now();
+
+        while (!queue.empty() && (queue.top()->event_time <= clock)) {
+            const event evt = queue.pop();
+            handles[evt.event_user_data] = queue.push(make_event(0, clock + rng() % 20000, evt.event_user_data));
+
+            operations += 2;
+            fired++;
+        }
+
+        advance_ns.push_back(std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - advance_start).count());
+    }
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::sort(advance_ns.begin(), advance_ns.end());
+
+    LOG_INFO(KERNEL, "event_queue with {} live events: {:.0f} ops/sec, {} fired, advance p50 {:.0f} ns, p99 {:.0f} ns, max {:.0f} ns",
+        LIVE_EVENTS, operations / seconds, fired, advance_ns[advance_ns.size() / 2], advance_ns[advance_ns.size() * 99 / 100],
+        advance_ns.back());
+
+    REQUIRE(queue.size() == LIVE_EVENTS);
+    REQUIRE(fired > 0);
+}
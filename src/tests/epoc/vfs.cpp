@@ -1,9 +1,18 @@
 #include <catch2/catch.hpp>
 #include <common/algorithm.h>
+#include <common/cvt.h>
+#include <common/log.h>
 #include <common/path.h>
 #include <common/types.h>
 #include <vfs/vfs.h>
 
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <vector>
+
 struct io_scope_guard {
     eka2l1::io_system *io;
 
@@ -37,3 +46,182 @@ TEST_CASE("get_physical", "vfs") {
 
     REQUIRE(eka2l1::common::compare_ignore_case(*actual_path_b, std::u16string(u"drive_b") + static_cast<char16_t>(eka2l1::get_separator()) + u"despacito3leak") == 0);
 }
+
+TEST_CASE("file_chunked_read_bench", "vfs") {
+    using namespace eka2l1;
+
+    // File server reads used to go into a staging vector and be copied to the client descriptor after.
+    // Compare that against reading straight into the target buffer, for the chunk sizes apps commonly use.
+    static constexpr std::size_t FILE_SIZE = 8 * 1024 * 1024;
+
+    const std::filesystem::path root = std::filesystem::temp_directory_path() / "eka2l1_vfs_bench";
+    std::filesystem::create_directories(root);
+
+    std::vector<char> content(FILE_SIZE);
+    for (std::size_t i = 0; i < FILE_SIZE; i++) {
+        content[i] = static_cast<char>(i * 31);
+    }
+
+    {
+        std::ofstream out(root / "chunks.bin", std::ios::binary);
+        out.write(content.data(), content.size());
+    }
+
+    eka2l1::io_system io;
+    io_scope_guard guard(io);
+
+    io.mount_physical_path(drive_number::drive_c, drive_media::physical, io_attrib_internal,
+        eka2l1::common::utf8_to_ucs2(root.string()));
+
+    for (const std::size_t chunk_size : { 4 * 1024, 16 * 1024, 64 * 1024 }) {
+        std::vector<char> target(chunk_size);
+        double mb_per_sec[2] = { 0, 0 };
+
+        for (int staged = 1; staged >= 0; staged--) {
+            std::unique_ptr<eka2l1::file> f = io.open_file(u"C:\\chunks.bin", READ_MODE | BIN_MODE);
+            REQUIRE(f);
+
+            std::size_t total = 0;
+            const auto start = std::chrono::steady_clock::now();
+
+            while (true) {
+                std::size_t read = 0;
+
+                if (staged) {
+                    std::vector<char> staging;
+                    staging.resize(chunk_size);
+
+                    read = f->read_file(staging.data(), 1, static_cast<std::uint32_t>(chunk_size));
+                    std::memcpy(target.data(), staging.data(), read);
+                } else {
+                    read = f->read_file(target.data(), 1, static_cast<std::uint32_t>(chunk_size));
+                }
+
+                if (!read) {
+                    break;
+                }
+
+                REQUIRE(std::memcmp(target.data(), content.data() + total, read) == 0);
+                total += read;
+            }
+
+            const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            mb_per_sec[staged] = (total / (1024.0 * 1024.0)) / seconds;
+
+            REQUIRE(total == FILE_SIZE);
+        }
+
+        LOG_INFO(VFS, "Reading in {} KB chunks: {:.0f} MB/s staged, {:.0f} MB/s in place", chunk_size / 1024,
+            mb_per_sec[1], mb_per_sec[0]);
+    }
+
+    std::filesystem::remove_all(root);
+}
+
+TEST_CASE("physical_path_cache_follows_host_changes", "vfs") {
+    namespace fs = std::filesystem;
+
+    const fs::path root = fs::temp_directory_path() / "eka2l1_path_cache";
+    fs::remove_all(root);
+    fs::create_directories(root);
+
+    eka2l1::io_system io;
+    io_scope_guard guard(io);
+
+    io.mount_physical_path(drive_number::drive_c, drive_media::physical, io_attrib_internal,
+        eka2l1::common::utf8_to_ucs2(root.string()));
+
+    // Asked twice, the second answer comes from the cache
+    REQUIRE_FALSE(io.exist(u"C:\\Resource\\Apps\\Demo.mif"));
+    REQUIRE_FALSE(io.exist(u"C:\\Resource\\Apps\\Demo.mif"));
+
+    // Made behind the emulator's back, only the watcher can tell
+    fs::create_directories(root / "resource" / "apps");
+    std::ofstream(root / "resource" / "apps" / "demo.mif") << "mif";
+
+    bool seen = false;
+
+    for (int i = 0; (i < 200) && !seen; i++) {
+        seen = io.exist(u"C:\\Resource\\Apps\\Demo.mif");
+
+        if (!seen) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+
+    REQUIRE(seen);
+
+    // Changes done through the emulator are seen right away
+    REQUIRE(io.delete_entry(u"C:\\Resource\\Apps\\Demo.mif"));
+    REQUIRE_FALSE(io.exist(u"C:\\Resource\\Apps\\Demo.mif"));
+
+    REQUIRE_FALSE(io.exist(u"C:\\Private\\10003a3f\\Import"));
+    REQUIRE(io.create_directories(u"C:\\Private\\10003a3f\\Import\\"));
+    REQUIRE(io.exist(u"C:\\Private\\10003a3f\\Import"));
+    REQUIRE(io.is_directory(u"C:\\Private\\10003a3f\\Import"));
+
+    io.unmount(drive_number::drive_c);
+    fs::remove_all(root);
+}
+
+TEST_CASE("physical_path_cache_startup_probe_bench", "vfs") {
+    // Apps look for their resources, icons and bitmaps at startup, across folders of a well filled C: drive,
+    // with many of the paths not there. Probe such a set once cold, then again as the next app would.
+    namespace fs = std::filesystem;
+
+    static constexpr int FOLDER_COUNT = 40;
+    static constexpr int FILES_PER_FOLDER = 100;
+    static constexpr int PROBE_ROUNDS = 4;
+
+    const fs::path root = fs::temp_directory_path() / "eka2l1_path_cache_bench";
+    fs::remove_all(root);
+
+    for (int folder = 0; folder < FOLDER_COUNT; folder++) {
+        const fs::path folder_path = root / "resource" / fmt::format("app{}", folder);
+        fs::create_directories(folder_path);
+
+        for (int i = 0; i < FILES_PER_FOLDER; i++) {
+            std::ofstream(folder_path / fmt::format("file{}.rsc", i)) << i;
+        }
+    }
+
+    std::vector<std::u16string> probes;
+
+    for (int folder = 0; folder < FOLDER_COUNT; folder++) {
+        for (int i = 0; i < FILES_PER_FOLDER; i += 4) {
+            probes.push_back(eka2l1::common::utf8_to_ucs2(fmt::format("C:\\Resource\\App{}\\File{}.rsc", folder, i)));
+            probes.push_back(eka2l1::common::utf8_to_ucs2(fmt::format("C:\\Resource\\App{}\\File{}.r01", folder, i)));
+            probes.push_back(eka2l1::common::utf8_to_ucs2(fmt::format("C:\\Resource\\Apps\\App{}_{}.mif", folder, i)));
+        }
+    }
+
+    eka2l1::io_system io;
+    io_scope_guard guard(io);
+
+    io.mount_physical_path(drive_number::drive_c, drive_media::physical, io_attrib_internal,
+        eka2l1::common::utf8_to_ucs2(root.string()));
+
+    double round_us[PROBE_ROUNDS] = {};
+    std::size_t found = 0;
+
+    for (int round = 0; round < PROBE_ROUNDS; round++) {
+        const auto start = std::chrono::steady_clock::now();
+
+        for (const std::u16string &probe : probes) {
+            if (io.exist(probe)) {
+                found++;
+            }
+        }
+
+        round_us[round] = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    using namespace eka2l1;
+    LOG_INFO(VFS, "Probing {} paths on a drive of {} files: cold {:.0f} us, warm {:.0f} us", probes.size(),
+        FOLDER_COUNT * FILES_PER_FOLDER, round_us[0], round_us[PROBE_ROUNDS - 1]);
+
+    REQUIRE(found == PROBE_ROUNDS * FOLDER_COUNT * (FILES_PER_FOLDER / 4));
+
+    io.unmount(drive_number::drive_c);
+    fs::remove_all(root);
+}